@@ -33,6 +33,18 @@ void printAll(const std::vector<BinaryFunction *> &BinaryFunctions);
 double extTSPScore(uint64_t SrcAddr, uint64_t SrcSize, uint64_t DstAddr,
                    uint64_t Count);
 
+/// The number of sampled accesses to a data object at a given address.
+struct DataObjectAccess {
+  uint64_t Address;
+  uint64_t Size;
+  uint64_t Count;
+};
+
+/// Calculate metrics related to data cache and d-TLB performance for the
+/// accesses to \p Objects, counting those to an object as evenly spread over
+/// its bytes.
+void printDataMetrics(const std::vector<DataObjectAccess> &Objects);
+
 } // namespace CacheMetrics
 } // namespace bolt
 } // namespace llvm
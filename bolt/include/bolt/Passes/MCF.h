@@ -26,6 +26,14 @@ enum MCFCostFunction : char {
 /// we only have bb count.
 void estimateEdgeCounts(BinaryFunction &BF);
 
+/// Recompute the block and edge counts of \p BF as the flow through its CFG
+/// that best agrees with the execution counts of the blocks that have one,
+/// while any count is allowed for the blocks whose execution count is
+/// COUNT_NO_PROFILE. This solves a min-cost flow problem with the profi
+/// algorithm of SampleProfileInference, and is used for the partial counts of
+/// a stale profile matched to the function.
+void inferFlowCounts(BinaryFunction &BF);
+
 /// Entry point for computing a min-cost flow for the CFG with the goal
 /// of fixing the flow of the CFG edges, that is, making sure it obeys the
 /// flow-conservation equation  SumInEdges = SumOutEdges.
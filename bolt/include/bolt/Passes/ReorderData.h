@@ -35,6 +35,16 @@ private:
   sortedByFunc(BinaryContext &BC, const BinarySection &Section,
                std::map<uint64_t, BinaryFunction> &BFs) const;
 
+  /// Cluster the symbols accessed together by the same basic blocks, up to a
+  /// page worth of them, then sort the clusters by access density.
+  std::pair<DataOrder, unsigned>
+  sortedByAffinity(BinaryContext &BC, const BinarySection &Section) const;
+
+  /// Print the cache metrics of the accessed symbols of \p Placed at their
+  /// input addresses and at the offsets they were given in \p Section.
+  void printCacheMetrics(const BinarySection &Section,
+                         const DataOrder &Placed) const;
+
   void printOrder(const BinarySection &Section, DataOrder::const_iterator Begin,
                   DataOrder::const_iterator End) const;
 
@@ -0,0 +1,70 @@
+//===- bolt/Profile/BinaryProfileFormat.h -----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implement a compact binary encoding of the profile that is otherwise written
+// in YAML.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef BOLT_PROFILE_BINARYPROFILEFORMAT_H
+#define BOLT_PROFILE_BINARYPROFILEFORMAT_H
+
+#include "bolt/Profile/ProfileYAMLMapping.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+namespace llvm {
+namespace bolt {
+
+/// The binary profile holds the same yaml::bolt::BinaryProfile as the YAML
+/// one. Integers are stored as LEB128, and indices and offsets as the signed
+/// difference with the previous one of the same kind, so that sorted ones are
+/// a byte each:
+///
+///   magic "BOLTPROF", version
+///   header: file name, build-id, flags, origin, event names
+///   number of functions, and for each function:
+///     name hash (8 bytes), name, ID delta, hash (8 bytes), execution count,
+///     number of basic blocks, number of profiled blocks, and for each block:
+///       index delta, number of instructions, hash (8 bytes), execution count,
+///       event count, number of call sites, and for each call site:
+///         offset delta, destination ID, entry discriminator, count, mispreds
+///       number of successors, and for each successor:
+///         index delta, count, mispreds
+///
+/// Strings are stored as their length followed by their contents, hashes and
+/// fixed-size fields in little-endian. The name hash is the xxHash64 of the
+/// name, and lets functions be looked up without comparing names.
+namespace BinaryProfileFormat {
+
+const char Magic[] = "BOLTPROF";
+const uint32_t Version = 1;
+
+/// Return the hash of the function name \p Name used in binary profiles.
+inline uint64_t getNameHash(StringRef Name) { return xxHash64(Name); }
+
+/// Check if \p Buffer contains a binary profile.
+inline bool isBinaryProfile(StringRef Buffer) {
+  return Buffer.startswith(StringRef(Magic, sizeof(Magic) - 1));
+}
+
+/// Write \p BP to \p OS.
+void writeBinaryProfile(raw_ostream &OS, const yaml::bolt::BinaryProfile &BP);
+
+/// Read the profile in \p Buffer into \p BP. If \p NameHashes is not null,
+/// also append the name hash of each function to it.
+Error readBinaryProfile(StringRef Buffer, yaml::bolt::BinaryProfile &BP,
+                        std::vector<uint64_t> *NameHashes = nullptr);
+
+} // namespace BinaryProfileFormat
+} // namespace bolt
+} // namespace llvm
+
+#endif
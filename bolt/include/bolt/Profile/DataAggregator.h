@@ -18,6 +18,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/Program.h"
+#include <map>
 #include <unordered_map>
 
 namespace llvm {
@@ -26,6 +27,7 @@ namespace bolt {
 class BinaryFunction;
 class BinaryContext;
 class BoltAddressTranslation;
+class PerfDataReader;
 
 /// DataAggregator inherits all parsing logic from DataReader as well as
 /// its data structures used to represent aggregated profile data in memory.
@@ -35,6 +37,10 @@ class BoltAddressTranslation;
 /// files to extract information about which PID was used for this binary.
 /// With the PID, we filter the samples and extract all LBR entries.
 ///
+/// Alternatively, with -native-perf-reader, the aggregator reads the same
+/// events from perf.data itself with PerfDataReader, without perf, and
+/// aggregates the LBR entries of the samples in parallel.
+///
 /// To aggregate LBR entries, we rely on a BinaryFunction map to locate the
 /// original function where the event happened. Then, we convert a raw address
 /// to an offset relative to the start of this function and aggregate branch
@@ -135,6 +141,24 @@ private:
   std::unordered_map<uint64_t, uint64_t> BasicSamples;
   std::vector<PerfMemSample> MemSamples;
 
+  /// Traces and statistics aggregated from a sequence of branch samples.
+  struct BranchAggregation {
+    std::unordered_map<Trace, BranchInfo, TraceHash> BranchLBRs;
+    std::unordered_map<Trace, FTInfo, TraceHash> FallthroughLBRs;
+    std::unordered_map<uint64_t, uint64_t> BasicSamples;
+    uint64_t NumTotalSamples{0};
+    uint64_t NumSamples{0};
+    uint64_t NumSamplesNoLBR{0};
+    uint64_t NumEntries{0};
+    uint64_t NumTraces{0};
+    uint64_t NumInvalidTraces{0};
+    uint64_t NumLongRangeTraces{0};
+    bool NeedsSkylakeFix{false};
+
+    /// Add the traces and statistics of \p Other to this aggregation.
+    void merge(const BranchAggregation &Other);
+  };
+
   template <typename T> void clear(T &Container) {
     T TempContainer;
     TempContainer.swap(Container);
@@ -317,6 +341,15 @@ private:
   /// Parse and pre-aggregate branch events.
   std::error_code parseBranchEvents();
 
+  /// Aggregate the LBR entries of \p Sample, a sample of the binary, into
+  /// \p Aggr.
+  void aggregateBranchSample(const PerfBranchSample &Sample,
+                             BranchAggregation &Aggr) const;
+
+  /// Use the traces aggregated in \p Aggr as the branch profile and report
+  /// its statistics.
+  void finishBranchEvents(BranchAggregation &Aggr);
+
   /// Process all branch events.
   void processBranchEvents();
 
@@ -356,6 +389,24 @@ private:
   /// to the set of tracked PIDs.
   std::error_code parseTaskEvents();
 
+  /// Record in \p GlobalMMapInfo the mapping \p Info of \p FileName unless
+  /// the file is mapped in that process already.
+  static void addMMapInfo(std::multimap<StringRef, MMapInfo> &GlobalMMapInfo,
+                          StringRef FileName, const MMapInfo &Info);
+
+  /// Find the mappings of the input binary in \p GlobalMMapInfo, the first
+  /// mappings of all files for all PIDs, and track their PIDs.
+  void processMMapInfo(std::multimap<StringRef, MMapInfo> &GlobalMMapInfo);
+
+  /// Stop tracking process \p PID, which ran execve, if it was forked.
+  void processCommExecEvent(int32_t PID);
+
+  /// Track the child of \p FI if its parent maps the input binary.
+  void processForkEvent(const ForkInfo &FI);
+
+  /// Report the PIDs associated with the input binary.
+  void reportBinaryPIDs() const;
+
   /// Parse a single pair of binary full path and associated build-id
   Optional<std::pair<StringRef, StringRef>> parseNameBuildIDPair();
 
@@ -363,6 +414,23 @@ private:
   /// and return a file name matching a given \p FileBuildID.
   Optional<StringRef> getFileNameForBuildID(StringRef FileBuildID);
 
+  /// Check \p FileName, the name of the file that has the build-id of the
+  /// input binary in the profile, if any, against the input binary.
+  void matchFileBuildID(Optional<StringRef> FileName);
+
+  /// Read the profile from perf.data with a PerfDataReader instead of perf.
+  /// Memory events are not read.
+  Error preprocessNativeProfile();
+
+  /// Counterparts of processFileBuildID(), parseMMapEvents(),
+  /// parseTaskEvents() and parseBranchEvents() for the records of \p Reader.
+  /// The samples of the chunks of \p Reader are aggregated in parallel.
+  void processNativeBuildID(const PerfDataReader &Reader,
+                            StringRef FileBuildID);
+  void parseNativeMMapEvents(const PerfDataReader &Reader);
+  void parseNativeTaskEvents(const PerfDataReader &Reader);
+  Error parseNativeBranchEvents(const PerfDataReader &Reader);
+
   /// Coordinate reading and parsing of pre-aggregated file
   ///
   /// The regular perf2bolt aggregation job is to read perf output directly.
@@ -0,0 +1,148 @@
+//===- bolt/Profile/PerfDataReader.h - Native perf.data reader --*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a reader of the perf.data files written by perf record
+// that does not depend on the perf tool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef BOLT_PROFILE_PERF_DATA_READER_H
+#define BOLT_PROFILE_PERF_DATA_READER_H
+
+#include "bolt/Profile/DataReader.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+namespace bolt {
+
+/// Reads the records of a perf.data file, written by perf record in file
+/// mode on a little-endian host, from a memory mapping of the file.
+///
+/// Opening the file scans the headers of all of its records once: the memory
+/// map and task records, which are few, are decoded right away, while the
+/// samples are only split into chunks of consecutive records. The samples of
+/// different chunks can then be decoded in parallel with forEachSample().
+class PerfDataReader {
+public:
+  /// A PERF_RECORD_MMAP2 record.
+  struct MMapEvent {
+    int32_t PID;
+    uint64_t Address;
+    uint64_t Size;
+    uint64_t Offset;
+    /// Time in micro seconds, or 0 if the samples have no time.
+    uint64_t Time;
+    StringRef FileName;
+  };
+
+  /// A PERF_RECORD_FORK record, or a PERF_RECORD_COMM record for an execve.
+  struct TaskEvent {
+    enum Kind : char { FORK, COMM_EXEC };
+    Kind Type;
+    /// The child process for a fork, the process that ran execve otherwise.
+    int32_t PID;
+    int32_t ParentPID;
+    /// Time in micro seconds.
+    uint64_t Time;
+  };
+
+  /// An entry of the HEADER_BUILD_ID feature section.
+  struct BuildIDEntry {
+    /// The build-id in hexadecimal.
+    std::string BuildID;
+    StringRef FileName;
+  };
+
+  /// A PERF_RECORD_SAMPLE record.
+  struct Sample {
+    /// The process, or -1 if the samples have no TID.
+    int32_t PID;
+    uint64_t PC;
+    /// The branch stack, most recent branch first.
+    ArrayRef<LBREntry> LBR;
+  };
+
+  /// A range of offsets of consecutive records in the file.
+  struct Chunk {
+    uint64_t Begin;
+    uint64_t End;
+  };
+
+  /// Open the perf.data file \p FileName. Its samples are split into chunks
+  /// of about \p ChunkSize bytes, and only the first \p MaxSamples of them
+  /// are read.
+  static Expected<std::unique_ptr<PerfDataReader>>
+  create(StringRef FileName, uint64_t ChunkSize, uint64_t MaxSamples);
+
+  ArrayRef<MMapEvent> getMMapEvents() const { return MMapEvents; }
+  ArrayRef<TaskEvent> getTaskEvents() const { return TaskEvents; }
+  ArrayRef<BuildIDEntry> getBuildIDs() const { return BuildIDs; }
+  ArrayRef<Chunk> getSampleChunks() const { return SampleChunks; }
+
+  /// Return the number of samples in all of the chunks.
+  uint64_t getNumSamples() const { return NumSamples; }
+
+  /// Decode the samples in \p C, in order, and call \p Callback on each.
+  /// This is safe to call concurrently.
+  Error forEachSample(const Chunk &C,
+                      function_ref<void(const Sample &)> Callback) const;
+
+private:
+  /// The parts of a perf_event_attr needed to decode the records of an event.
+  struct EventAttr {
+    uint64_t SampleType;
+    uint64_t ReadFormat;
+    uint64_t BranchSampleType;
+    bool SampleIDAll;
+  };
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  std::vector<EventAttr> Attrs;
+  /// The index in Attrs of the event with each sample ID.
+  DenseMap<uint64_t, unsigned> IDToAttr;
+
+  std::vector<MMapEvent> MMapEvents;
+  std::vector<TaskEvent> TaskEvents;
+  std::vector<BuildIDEntry> BuildIDs;
+  std::vector<Chunk> SampleChunks;
+  uint64_t NumSamples{0};
+
+  PerfDataReader(std::unique_ptr<MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  StringRef getData() const { return Buffer->getBuffer(); }
+
+  Error readHeader(uint64_t &DataOffset, uint64_t &DataSize,
+                   uint64_t &FeatureOffset, uint64_t &Features);
+  Error readAttrs(uint64_t Offset, uint64_t Size, uint64_t AttrSize);
+  Error readBuildIDs(uint64_t FeatureOffset, uint64_t Features);
+  Error readRecords(uint64_t DataOffset, uint64_t DataSize, uint64_t ChunkSize,
+                    uint64_t MaxSamples);
+
+  /// Return the attributes of the event that the sample record at \p Offset
+  /// belongs to, or of the non-sample record [\p Offset, \p End).
+  const EventAttr *getSampleAttr(uint64_t Offset) const;
+  const EventAttr *getRecordAttr(uint64_t End) const;
+
+  /// Return the time, in micro seconds, recorded in the sample ID at the end
+  /// of the non-sample record [\p Offset, \p End), or 0 if there is none.
+  uint64_t getRecordTime(uint64_t Offset, uint64_t End) const;
+};
+
+} // namespace bolt
+} // namespace llvm
+
+#endif
@@ -0,0 +1,65 @@
+//===- bolt/Profile/StaleProfileMatching.h ----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Match a profile collected on a different build of a function to its basic
+// blocks by their hashes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef BOLT_PROFILE_STALE_PROFILE_MATCHING_H
+#define BOLT_PROFILE_STALE_PROFILE_MATCHING_H
+
+#include "bolt/Profile/ProfileYAMLMapping.h"
+#include "llvm/ADT/DenseMap.h"
+#include <cstdint>
+
+namespace llvm {
+namespace bolt {
+
+class BinaryBasicBlock;
+class BinaryFunction;
+
+/// The hash of a basic block, blended from the hash of its opcodes and the
+/// hashes of the opcodes of its successors and of its predecessors. Blocks with
+/// the same opcodes are told apart by their neighbours, and still match when
+/// only the CFG around them has changed.
+struct BlendedBlockHash {
+  uint32_t OpcodeHash{0};
+  uint16_t SuccHash{0};
+  uint16_t PredHash{0};
+
+  BlendedBlockHash() = default;
+  explicit BlendedBlockHash(uint64_t Hash)
+      : OpcodeHash(Hash >> 32), SuccHash(Hash >> 16), PredHash(Hash) {}
+
+  uint64_t combine() const {
+    return uint64_t(OpcodeHash) << 32 | uint64_t(SuccHash) << 16 | PredHash;
+  }
+
+  /// Return how many of the neighbour hashes differ between this hash and
+  /// \p Other, which must have the same opcode hash.
+  unsigned distance(const BlendedBlockHash &Other) const {
+    return (SuccHash != Other.SuccHash) + (PredHash != Other.PredHash);
+  }
+};
+
+/// Return the blended hash of each basic block of \p BF.
+DenseMap<const BinaryBasicBlock *, uint64_t>
+computeBlockHashes(const BinaryFunction &BF);
+
+/// Assign the profile \p YamlBF, collected on a different build of \p BF, to
+/// \p BF: match its blocks to those of \p BF by hash, then infer the counts of
+/// the other blocks and of the edges with inferFlowCounts(). Return false if
+/// too few blocks matched, leaving \p BF without a profile.
+bool matchStaleProfile(BinaryFunction &BF,
+                       const yaml::bolt::BinaryFunctionProfile &YamlBF);
+
+} // namespace bolt
+} // namespace llvm
+
+#endif
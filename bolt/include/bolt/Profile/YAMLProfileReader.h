@@ -37,7 +37,8 @@ public:
 
   virtual bool mayHaveProfileData(const BinaryFunction &BF) override;
 
-  /// Check if the file contains YAML.
+  /// Check if the file contains YAML, or the binary encoding of the same
+  /// profile.
   static bool isYAML(StringRef Filename);
 
 private:
@@ -15,6 +15,7 @@
 #include "bolt/Core/BinaryBasicBlock.h"
 #include "bolt/Core/BinaryFunction.h"
 #include "llvm/Support/CommandLine.h"
+#include <algorithm>
 #include <unordered_map>
 
 using namespace llvm;
@@ -309,3 +310,55 @@ void CacheMetrics::printAll(const std::vector<BinaryFunction *> &BFs) {
   outs() << "  ExtTSP score: "
          << format("%.0lf\n", calcExtTSPScore(BFs, BBAddr, BBSize));
 }
+
+void CacheMetrics::printDataMetrics(
+    const std::vector<DataObjectAccess> &Objects) {
+  // The d-TLB is assumed to have the same geometry as the i-TLB.
+  constexpr uint64_t CacheLineSize = 64;
+  const uint64_t PageSize = opts::ITLBPageSize;
+
+  std::unordered_map<uint64_t, double> LineCounts;
+  std::unordered_map<uint64_t, double> PageCounts;
+  uint64_t TotalCount = 0;
+  uint64_t TotalSize = 0;
+  auto spread = [](std::unordered_map<uint64_t, double> &Counts,
+                   const DataObjectAccess &Object, uint64_t Granule) {
+    const uint64_t Begin = Object.Address;
+    const uint64_t End = Object.Address + Object.Size;
+    for (uint64_t I = Begin / Granule; I <= (End - 1) / Granule; ++I) {
+      const uint64_t Overlap =
+          std::min(End, (I + 1) * Granule) - std::max(Begin, I * Granule);
+      Counts[I] += double(Object.Count) * Overlap / Object.Size;
+    }
+  };
+  for (const DataObjectAccess &Object : Objects) {
+    if (!Object.Count || !Object.Size)
+      continue;
+    TotalCount += Object.Count;
+    TotalSize += Object.Size;
+    spread(LineCounts, Object, CacheLineSize);
+    spread(PageCounts, Object, PageSize);
+  }
+  if (!TotalCount)
+    return;
+
+  std::vector<double> Pages;
+  for (const std::pair<const uint64_t, double> &Page : PageCounts)
+    Pages.push_back(Page.second);
+  std::sort(Pages.rbegin(), Pages.rend());
+  double HottestPagesCount = 0;
+  for (size_t I = 0, E = std::min<size_t>(Pages.size(), opts::ITLBEntries);
+       I != E; ++I)
+    HottestPagesCount += Pages[I];
+
+  outs() << format("  Accessed data takes %zu bytes in %zu cache lines "
+                   "(%.2lf%% utilized) and %zu pages\n",
+                   size_t(TotalSize), LineCounts.size(),
+                   100.0 * TotalSize / (LineCounts.size() * CacheLineSize),
+                   PageCounts.size());
+  outs() << format("  Average accesses per cache line: %.1lf\n",
+                   double(TotalCount) / LineCounts.size());
+  outs() << format("  Accesses to the %u hottest pages: %.2lf%%\n",
+                   unsigned(opts::ITLBEntries),
+                   100.0 * HottestPagesCount / TotalCount);
+}
@@ -15,6 +15,7 @@
 #include "bolt/Passes/DataflowInfoManager.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/SampleProfileInference.h"
 #include <algorithm>
 #include <vector>
 
@@ -478,6 +479,114 @@ void estimateEdgeCounts(BinaryFunction &BF) {
   recalculateBBCounts(BF, /*AllEdges=*/false);
 }
 
+void inferFlowCounts(BinaryFunction &BF) {
+  // The flow can only go through the blocks reachable from an entry point or
+  // a landing pad, from which an exit is reachable.
+  std::vector<BinaryBasicBlock *> Roots;
+  for (BinaryBasicBlock &BB : BF)
+    if (BB.isEntryPoint() || BB.isLandingPad())
+      Roots.push_back(&BB);
+
+  std::vector<bool> Reachable(BF.size());
+  std::vector<BinaryBasicBlock *> Worklist(Roots);
+  for (BinaryBasicBlock *BB : Roots)
+    Reachable[BB->getIndex()] = true;
+  while (!Worklist.empty()) {
+    BinaryBasicBlock *BB = Worklist.back();
+    Worklist.pop_back();
+    for (BinaryBasicBlock *Succ : BB->successors())
+      if (!Reachable[Succ->getIndex()]) {
+        Reachable[Succ->getIndex()] = true;
+        Worklist.push_back(Succ);
+      }
+  }
+
+  std::vector<bool> ReachesExit(BF.size());
+  for (BinaryBasicBlock &BB : BF)
+    if (Reachable[BB.getIndex()] && BB.succ_empty()) {
+      ReachesExit[BB.getIndex()] = true;
+      Worklist.push_back(&BB);
+    }
+  while (!Worklist.empty()) {
+    BinaryBasicBlock *BB = Worklist.back();
+    Worklist.pop_back();
+    for (BinaryBasicBlock *Pred : BB->predecessors())
+      if (Reachable[Pred->getIndex()] && !ReachesExit[Pred->getIndex()]) {
+        ReachesExit[Pred->getIndex()] = true;
+        Worklist.push_back(Pred);
+      }
+  }
+
+  // Block 0 of the flow function is an artificial source with a jump to each
+  // root, so that the flow has a single entry.
+  std::vector<BinaryBasicBlock *> Blocks;
+  DenseMap<const BinaryBasicBlock *, uint64_t> BlockIndex;
+  for (BinaryBasicBlock &BB : BF)
+    if (ReachesExit[BB.getIndex()]) {
+      BlockIndex[&BB] = Blocks.size() + 1;
+      Blocks.push_back(&BB);
+    }
+
+  FlowFunction Func;
+  Func.Entry = 0;
+  Func.Blocks.resize(Blocks.size() + 1);
+  Func.Blocks[0].UnknownWeight = true;
+  for (uint64_t I = 0, E = Func.Blocks.size(); I != E; ++I)
+    Func.Blocks[I].Index = I;
+  for (BinaryBasicBlock *BB : Blocks) {
+    FlowBlock &Block = Func.Blocks[BlockIndex[BB]];
+    const uint64_t Count = BB->getExecutionCount();
+    Block.UnknownWeight = Count == BinaryBasicBlock::COUNT_NO_PROFILE;
+    Block.Weight = Block.UnknownWeight ? 0 : Count;
+  }
+
+  for (BinaryBasicBlock *BB : Roots)
+    if (ReachesExit[BB->getIndex()])
+      Func.Jumps.push_back({0, BlockIndex[BB]});
+  if (Func.Jumps.empty())
+    return;
+  for (BinaryBasicBlock *BB : Blocks) {
+    for (BinaryBasicBlock *Succ : BB->successors()) {
+      auto It = BlockIndex.find(Succ);
+      if (It == BlockIndex.end())
+        continue;
+      Func.Jumps.push_back({BlockIndex[BB], It->second});
+      if (BB == Succ)
+        Func.Blocks[It->second].HasSelfEdge = true;
+    }
+  }
+  for (FlowJump &Jump : Func.Jumps) {
+    Func.Blocks[Jump.Source].SuccJumps.push_back(&Jump);
+    Func.Blocks[Jump.Target].PredJumps.push_back(&Jump);
+  }
+
+  applyFlowInference(Func);
+
+  // Blocks and edges outside of the flow are never executed.
+  for (BinaryBasicBlock &BB : BF) {
+    BB.setExecutionCount(0);
+    for (BinaryBasicBlock::BinaryBranchInfo &BI : BB.branch_info()) {
+      BI.Count = 0;
+      BI.MispredictedCount = 0;
+    }
+  }
+  for (BinaryBasicBlock *BB : Blocks)
+    BB->setExecutionCount(Func.Blocks[BlockIndex[BB]].Flow);
+
+  uint64_t FunctionExecCount = 0;
+  for (const FlowJump &Jump : Func.Jumps) {
+    if (Jump.Source == 0) {
+      if (Blocks[Jump.Target - 1]->isEntryPoint())
+        FunctionExecCount += Jump.Flow;
+      continue;
+    }
+    BinaryBasicBlock *Source = Blocks[Jump.Source - 1];
+    BinaryBasicBlock *Target = Blocks[Jump.Target - 1];
+    Source->getBranchInfo(*Target).Count = Jump.Flow;
+  }
+  BF.setExecutionCount(FunctionExecCount);
+}
+
 void solveMCF(BinaryFunction &BF, MCFCostFunction CostFunction) {
   llvm_unreachable("not implemented");
 }
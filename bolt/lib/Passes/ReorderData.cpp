@@ -16,6 +16,7 @@
 // - estimate temporal locality by looking at CFG?
 
 #include "bolt/Passes/ReorderData.h"
+#include "bolt/Passes/CacheMetrics.h"
 #include <algorithm>
 
 #undef  DEBUG_TYPE
@@ -45,7 +46,8 @@ ReorderData("reorder-data",
 
 enum ReorderAlgo : char {
   REORDER_COUNT         = 0,
-  REORDER_FUNCS         = 1
+  REORDER_FUNCS         = 1,
+  REORDER_AFFINITY      = 2
 };
 
 static cl::opt<ReorderAlgo>
@@ -58,7 +60,18 @@ ReorderAlgorithm("reorder-data-algo",
       "sort hot data by read counts"),
     clEnumValN(REORDER_FUNCS,
       "funcs",
-      "sort hot data by hot function usage and count")),
+      "sort hot data by hot function usage and count"),
+    clEnumValN(REORDER_AFFINITY,
+      "affinity",
+      "cluster hot data accessed by the same basic blocks")),
+  cl::ZeroOrMore,
+  cl::cat(BoltOptCategory));
+
+static cl::opt<unsigned>
+ReorderDataClusterSize("reorder-data-cluster-size",
+  cl::desc("maximum size in bytes of a cluster of data accessed together, "
+           "with -reorder-data-algo=affinity"),
+  cl::init(4096),
   cl::ZeroOrMore,
   cl::cat(BoltOptCategory));
 
@@ -338,6 +351,160 @@ ReorderData::sortedByCount(BinaryContext &BC,
   return std::make_pair(Order, SplitPoint);
 }
 
+std::pair<DataOrder, unsigned>
+ReorderData::sortedByAffinity(BinaryContext &BC,
+                              const BinarySection &Section) const {
+  // The number of hottest symbols of each block related to each other, which
+  // bounds the quadratic number of pairs.
+  constexpr size_t MaxSymbolsPerBlock = 16;
+
+  DataOrder Order = baseOrder(BC, Section);
+  std::unordered_map<const BinaryData *, size_t> Index;
+  for (size_t I = 0; I != Order.size(); ++I)
+    Index[Order[I].first] = I;
+
+  // The affinity of a pair of symbols is the number of accesses to the less
+  // accessed of the two by the blocks that access both.
+  std::map<std::pair<size_t, size_t>, uint64_t> Affinity;
+  std::unordered_map<size_t, uint64_t> BlockCounts;
+  std::vector<std::pair<uint64_t, size_t>> BlockSymbols;
+  for (auto &BFI : BC.getBinaryFunctions()) {
+    const BinaryFunction &BF = BFI.second;
+    if (!BF.hasMemoryProfile())
+      continue;
+    for (const BinaryBasicBlock &BB : BF) {
+      BlockCounts.clear();
+      for (const MCInst &Inst : BB) {
+        auto ErrorOrMemAccesssProfile =
+            BC.MIB->tryGetAnnotationAs<MemoryAccessProfile>(
+                Inst, "MemoryAccessProfile");
+        if (!ErrorOrMemAccesssProfile)
+          continue;
+        for (const AddressAccess &AccessInfo :
+             ErrorOrMemAccesssProfile.get().AddressAccessInfo) {
+          if (!AccessInfo.MemoryObject)
+            continue;
+          auto It = Index.find(AccessInfo.MemoryObject->getAtomicRoot());
+          if (It != Index.end())
+            BlockCounts[It->second] += AccessInfo.Count;
+        }
+      }
+      if (BlockCounts.size() < 2)
+        continue;
+
+      BlockSymbols.clear();
+      for (const std::pair<const size_t, uint64_t> &Entry : BlockCounts)
+        BlockSymbols.emplace_back(Entry.second, Entry.first);
+      std::sort(BlockSymbols.rbegin(), BlockSymbols.rend());
+      if (BlockSymbols.size() > MaxSymbolsPerBlock)
+        BlockSymbols.resize(MaxSymbolsPerBlock);
+      for (size_t I = 0; I != BlockSymbols.size(); ++I)
+        for (size_t J = I + 1; J != BlockSymbols.size(); ++J)
+          Affinity[std::minmax(BlockSymbols[I].second,
+                               BlockSymbols[J].second)] +=
+              BlockSymbols[J].first;
+    }
+  }
+
+  // Merge the clusters of the most related pairs first, as long as the merged
+  // cluster fits the maximum size, joining them at the ends that hold the
+  // pair when possible.
+  auto getSize = [&](size_t I) {
+    const BinaryData *BD = Order[I].first;
+    return alignTo(BD->getSize(), std::max(BD->getAlignment(), MinAlignment));
+  };
+  std::vector<std::vector<size_t>> Clusters(Order.size());
+  std::vector<size_t> ClusterOf(Order.size());
+  std::vector<uint64_t> ClusterSize(Order.size());
+  for (size_t I = 0; I != Order.size(); ++I) {
+    Clusters[I].push_back(I);
+    ClusterOf[I] = I;
+    ClusterSize[I] = getSize(I);
+  }
+
+  std::vector<std::pair<uint64_t, std::pair<size_t, size_t>>> Edges;
+  for (const auto &Entry : Affinity)
+    Edges.emplace_back(Entry.second, Entry.first);
+  std::stable_sort(
+      Edges.begin(), Edges.end(),
+      [](const auto &A, const auto &B) { return A.first > B.first; });
+  for (const auto &Edge : Edges) {
+    size_t A = Edge.second.first;
+    size_t B = Edge.second.second;
+    size_t ClusterA = ClusterOf[A];
+    size_t ClusterB = ClusterOf[B];
+    if (ClusterA == ClusterB ||
+        ClusterSize[ClusterA] + ClusterSize[ClusterB] >
+            opts::ReorderDataClusterSize)
+      continue;
+    if (Clusters[ClusterA].back() != A && Clusters[ClusterB].back() == B) {
+      std::swap(A, B);
+      std::swap(ClusterA, ClusterB);
+    }
+    if (Clusters[ClusterA].back() != A && Clusters[ClusterA].front() == A)
+      std::reverse(Clusters[ClusterA].begin(), Clusters[ClusterA].end());
+    if (Clusters[ClusterB].front() != B && Clusters[ClusterB].back() == B)
+      std::reverse(Clusters[ClusterB].begin(), Clusters[ClusterB].end());
+    for (size_t I : Clusters[ClusterB])
+      ClusterOf[I] = ClusterA;
+    Clusters[ClusterA].insert(Clusters[ClusterA].end(),
+                              Clusters[ClusterB].begin(),
+                              Clusters[ClusterB].end());
+    Clusters[ClusterB].clear();
+    ClusterSize[ClusterA] += ClusterSize[ClusterB];
+  }
+
+  // Order the clusters with accesses by density, then the rest as they were.
+  std::vector<size_t> HotClusters;
+  std::vector<uint64_t> ClusterCount(Order.size());
+  for (size_t C = 0; C != Clusters.size(); ++C) {
+    for (size_t I : Clusters[C])
+      ClusterCount[C] += Order[I].second;
+    if (ClusterCount[C])
+      HotClusters.push_back(C);
+  }
+  std::stable_sort(HotClusters.begin(), HotClusters.end(),
+                   [&](size_t A, size_t B) {
+                     return double(ClusterCount[A]) / ClusterSize[A] >
+                            double(ClusterCount[B]) / ClusterSize[B];
+                   });
+
+  DataOrder NewOrder;
+  for (size_t C : HotClusters)
+    for (size_t I : Clusters[C])
+      NewOrder.push_back(Order[I]);
+  const unsigned SplitPoint = NewOrder.size();
+  for (size_t C = 0; C != Clusters.size(); ++C)
+    if (!ClusterCount[C])
+      for (size_t I : Clusters[C])
+        NewOrder.push_back(Order[I]);
+
+  return std::make_pair(NewOrder, SplitPoint);
+}
+
+void ReorderData::printCacheMetrics(const BinarySection &Section,
+                                    const DataOrder &Placed) const {
+  std::vector<CacheMetrics::DataObjectAccess> Before;
+  std::vector<CacheMetrics::DataObjectAccess> After;
+  for (const DataOrder::value_type &Entry : Placed) {
+    const BinaryData *BD = Entry.first;
+    if (!Entry.second)
+      continue;
+    Before.push_back({BD->getAddress() - Section.getAddress(), BD->getSize(),
+                      Entry.second});
+    After.push_back({BD->getOutputOffset(), BD->getSize(), Entry.second});
+  }
+  if (Before.empty())
+    return;
+
+  outs() << "BOLT-INFO: cache metrics for the reordered data of "
+         << Section.getName() << " before reordering:\n";
+  CacheMetrics::printDataMetrics(Before);
+  outs() << "BOLT-INFO: cache metrics for the reordered data of "
+         << Section.getName() << " after reordering:\n";
+  CacheMetrics::printDataMetrics(After);
+}
+
 // TODO
 // add option for cache-line alignment (or just use cache-line when section
 // is writeable)?
@@ -346,6 +513,7 @@ void ReorderData::setSectionOrder(BinaryContext &BC,
                                   DataOrder::iterator Begin,
                                   DataOrder::iterator End) {
   std::vector<BinaryData *> NewOrder;
+  DataOrder Placed;
   unsigned NumReordered = 0;
   uint64_t Offset = 0;
   uint64_t Count = 0;
@@ -403,6 +571,7 @@ void ReorderData::setSectionOrder(BinaryContext &BC,
     Offset += BD->getSize();
     Count += Begin->second;
     NewOrder.push_back(BD);
+    Placed.push_back(*Begin);
   }
 
   OutputSection.reorderContents(NewOrder, opts::ReorderInplace);
@@ -410,6 +579,8 @@ void ReorderData::setSectionOrder(BinaryContext &BC,
   outs() << "BOLT-INFO: reorder-data: " << Count << "/" << TotalCount
          << format(" (%.1f%%)", 100.0 * Count / TotalCount) << " events, "
          << Offset << " hot bytes\n";
+
+  printCacheMetrics(OutputSection, Placed);
 }
 
 bool ReorderData::markUnmoveableSymbols(BinaryContext &BC,
@@ -497,6 +668,9 @@ void ReorderData::runOnFunctions(BinaryContext &BC) {
     if (opts::ReorderAlgorithm == opts::ReorderAlgo::REORDER_COUNT) {
       outs() << "BOLT-INFO: reorder-sections: ordering data by count\n";
       std::tie(Order, SplitPointIdx) = sortedByCount(BC, *Section);
+    } else if (opts::ReorderAlgorithm == opts::ReorderAlgo::REORDER_AFFINITY) {
+      outs() << "BOLT-INFO: reorder-sections: ordering data by affinity\n";
+      std::tie(Order, SplitPointIdx) = sortedByAffinity(BC, *Section);
     } else {
       outs() << "BOLT-INFO: reorder-sections: ordering data by funcs\n";
       std::tie(Order, SplitPointIdx) =
@@ -0,0 +1,178 @@
+//===- bolt/Profile/BinaryProfileFormat.cpp - Binary profile format -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "bolt/Profile/BinaryProfileFormat.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/LEB128.h"
+
+namespace llvm {
+namespace bolt {
+namespace BinaryProfileFormat {
+
+static void writeString(raw_ostream &OS, StringRef Str) {
+  encodeULEB128(Str.size(), OS);
+  OS << Str;
+}
+
+static void writeDelta(raw_ostream &OS, uint64_t Value, uint64_t &Prev) {
+  encodeSLEB128(static_cast<int64_t>(Value - Prev), OS);
+  Prev = Value;
+}
+
+static uint64_t readDelta(DataExtractor &DE, DataExtractor::Cursor &C,
+                          uint64_t &Prev) {
+  Prev += static_cast<uint64_t>(DE.getSLEB128(C));
+  return Prev;
+}
+
+static std::string readString(DataExtractor &DE, DataExtractor::Cursor &C) {
+  const uint64_t Size = DE.getULEB128(C);
+  return DE.getBytes(C, Size).str();
+}
+
+void writeBinaryProfile(raw_ostream &OS, const yaml::bolt::BinaryProfile &BP) {
+  support::endian::Writer LE(OS, support::little);
+
+  OS << StringRef(Magic, sizeof(Magic) - 1);
+  encodeULEB128(Version, OS);
+  writeString(OS, BP.Header.FileName);
+  writeString(OS, BP.Header.Id);
+  encodeULEB128(BP.Header.Flags, OS);
+  writeString(OS, BP.Header.Origin);
+  writeString(OS, BP.Header.EventNames);
+
+  encodeULEB128(BP.Functions.size(), OS);
+  uint64_t PrevId = 0;
+  for (const yaml::bolt::BinaryFunctionProfile &BF : BP.Functions) {
+    LE.write<uint64_t>(getNameHash(BF.Name));
+    writeString(OS, BF.Name);
+    writeDelta(OS, BF.Id, PrevId);
+    LE.write<uint64_t>(BF.Hash);
+    encodeULEB128(BF.ExecCount, OS);
+    encodeULEB128(BF.NumBasicBlocks, OS);
+
+    encodeULEB128(BF.Blocks.size(), OS);
+    uint64_t PrevIndex = 0;
+    for (const yaml::bolt::BinaryBasicBlockProfile &BB : BF.Blocks) {
+      writeDelta(OS, BB.Index, PrevIndex);
+      encodeULEB128(BB.NumInstructions, OS);
+      LE.write<uint64_t>(BB.Hash);
+      encodeULEB128(BB.ExecCount, OS);
+      encodeULEB128(BB.EventCount, OS);
+
+      encodeULEB128(BB.CallSites.size(), OS);
+      uint64_t PrevOffset = 0;
+      for (const yaml::bolt::CallSiteInfo &CS : BB.CallSites) {
+        writeDelta(OS, CS.Offset, PrevOffset);
+        encodeULEB128(CS.DestId, OS);
+        encodeULEB128(CS.EntryDiscriminator, OS);
+        encodeULEB128(CS.Count, OS);
+        encodeULEB128(CS.Mispreds, OS);
+      }
+
+      encodeULEB128(BB.Successors.size(), OS);
+      uint64_t PrevSuccessor = BB.Index;
+      for (const yaml::bolt::SuccessorInfo &SI : BB.Successors) {
+        writeDelta(OS, SI.Index, PrevSuccessor);
+        encodeULEB128(SI.Count, OS);
+        encodeULEB128(SI.Mispreds, OS);
+      }
+    }
+  }
+}
+
+Error readBinaryProfile(StringRef Buffer, yaml::bolt::BinaryProfile &BP,
+                        std::vector<uint64_t> *NameHashes) {
+  if (!isBinaryProfile(Buffer))
+    return createStringError(errc::invalid_argument, "not a binary profile");
+
+  DataExtractor DE(Buffer, /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  DataExtractor::Cursor C(sizeof(Magic) - 1);
+  BP.Header.Version = DE.getULEB128(C);
+  if (C && BP.Header.Version != Version) {
+    consumeError(C.takeError());
+    return createStringError(errc::not_supported,
+                             "unsupported binary profile version %u",
+                             BP.Header.Version);
+  }
+  BP.Header.FileName = readString(DE, C);
+  BP.Header.Id = readString(DE, C);
+  BP.Header.Flags = DE.getULEB128(C);
+  BP.Header.Origin = readString(DE, C);
+  BP.Header.EventNames = readString(DE, C);
+
+  // Check the counts against the size of the buffer, in which each element
+  // takes at least a byte, before allocating for them.
+  bool BadCount = false;
+  auto readCount = [&]() -> uint64_t {
+    const uint64_t Count = DE.getULEB128(C);
+    if (!C)
+      return 0;
+    if (Count > Buffer.size() - C.tell()) {
+      BadCount = true;
+      return 0;
+    }
+    return Count;
+  };
+
+  const uint64_t NumFunctions = readCount();
+  BP.Functions.resize(NumFunctions);
+  uint64_t PrevId = 0;
+  for (yaml::bolt::BinaryFunctionProfile &BF : BP.Functions) {
+    const uint64_t NameHash = DE.getU64(C);
+    if (NameHashes)
+      NameHashes->push_back(NameHash);
+    BF.Name = readString(DE, C);
+    BF.Id = readDelta(DE, C, PrevId);
+    BF.Hash = DE.getU64(C);
+    BF.ExecCount = DE.getULEB128(C);
+    BF.NumBasicBlocks = DE.getULEB128(C);
+
+    BF.Blocks.resize(readCount());
+    uint64_t PrevIndex = 0;
+    for (yaml::bolt::BinaryBasicBlockProfile &BB : BF.Blocks) {
+      BB.Index = readDelta(DE, C, PrevIndex);
+      BB.NumInstructions = DE.getULEB128(C);
+      BB.Hash = DE.getU64(C);
+      BB.ExecCount = DE.getULEB128(C);
+      BB.EventCount = DE.getULEB128(C);
+
+      BB.CallSites.resize(readCount());
+      uint64_t PrevOffset = 0;
+      for (yaml::bolt::CallSiteInfo &CS : BB.CallSites) {
+        CS.Offset = readDelta(DE, C, PrevOffset);
+        CS.DestId = DE.getULEB128(C);
+        CS.EntryDiscriminator = DE.getULEB128(C);
+        CS.Count = DE.getULEB128(C);
+        CS.Mispreds = DE.getULEB128(C);
+      }
+
+      BB.Successors.resize(readCount());
+      uint64_t PrevSuccessor = BB.Index;
+      for (yaml::bolt::SuccessorInfo &SI : BB.Successors) {
+        SI.Index = readDelta(DE, C, PrevSuccessor);
+        SI.Count = DE.getULEB128(C);
+        SI.Mispreds = DE.getULEB128(C);
+      }
+    }
+    if (!C || BadCount)
+      break;
+  }
+  if (Error E = C.takeError())
+    return E;
+  if (BadCount)
+    return createStringError(errc::illegal_byte_sequence,
+                             "truncated binary profile");
+  return Error::success();
+}
+
+} // namespace BinaryProfileFormat
+} // namespace bolt
+} // namespace llvm
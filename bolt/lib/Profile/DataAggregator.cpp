@@ -14,8 +14,10 @@
 #include "bolt/Profile/DataAggregator.h"
 #include "bolt/Core/BinaryContext.h"
 #include "bolt/Core/BinaryFunction.h"
+#include "bolt/Core/ParallelUtilities.h"
 #include "bolt/Profile/BoltAddressTranslation.h"
 #include "bolt/Profile/Heatmap.h"
+#include "bolt/Profile/PerfDataReader.h"
 #include "bolt/Utils/CommandLineOpts.h"
 #include "bolt/Utils/Utils.h"
 #include "llvm/ADT/ScopeExit.h"
@@ -26,6 +28,7 @@
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
@@ -81,6 +84,13 @@ MaxSamples("max-samples",
   cl::Hidden,
   cl::cat(AggregatorCategory));
 
+static cl::opt<bool>
+NativePerfReader("native-perf-reader",
+  cl::desc("read perf.data directly instead of through perf script"),
+  cl::init(false),
+  cl::ZeroOrMore,
+  cl::cat(AggregatorCategory));
+
 static cl::opt<bool>
 ReadPreAggregated("pa",
   cl::desc("skip perf and read data from a pre-aggregated file format"),
@@ -116,6 +126,10 @@ namespace {
 const char TimerGroupName[] = "aggregator";
 const char TimerGroupDesc[] = "Aggregator";
 
+/// The size of the chunks of perf.data whose samples are aggregated in
+/// parallel by the native reader.
+const uint64_t PerfDataChunkSize = 16 << 20;
+
 std::vector<SectionNameAndRange> getTextSections(const BinaryContext *BC) {
   std::vector<SectionNameAndRange> sections;
   for (BinarySection &Section : BC->sections()) {
@@ -165,8 +179,8 @@ void DataAggregator::findPerfExecutable() {
 void DataAggregator::start() {
   outs() << "PERF2BOLT: Starting data aggregation job for " << Filename << "\n";
 
-  // Don't launch perf for pre-aggregated files
-  if (opts::ReadPreAggregated)
+  // Don't launch perf for pre-aggregated files or to read perf.data directly
+  if (opts::ReadPreAggregated || opts::NativePerfReader)
     return;
 
   findPerfExecutable();
@@ -207,10 +221,12 @@ void DataAggregator::abort() {
   std::string Error;
 
   // Kill subprocesses in case they are not finished
-  sys::Wait(TaskEventsPPI.PI, 1, false, &Error);
-  sys::Wait(MMapEventsPPI.PI, 1, false, &Error);
-  sys::Wait(MainEventsPPI.PI, 1, false, &Error);
-  sys::Wait(MemEventsPPI.PI, 1, false, &Error);
+  if (!opts::NativePerfReader) {
+    sys::Wait(TaskEventsPPI.PI, 1, false, &Error);
+    sys::Wait(MMapEventsPPI.PI, 1, false, &Error);
+    sys::Wait(MainEventsPPI.PI, 1, false, &Error);
+    sys::Wait(MemEventsPPI.PI, 1, false, &Error);
+  }
 
   deleteTempFiles();
 
@@ -314,7 +330,10 @@ void DataAggregator::processFileBuildID(StringRef FileBuildID) {
 
   Col = 0;
   Line = 1;
-  Optional<StringRef> FileName = getFileNameForBuildID(FileBuildID);
+  matchFileBuildID(getFileNameForBuildID(FileBuildID));
+}
+
+void DataAggregator::matchFileBuildID(Optional<StringRef> FileName) {
   if (!FileName) {
     errs() << "PERF2BOLT-ERROR: failed to match build-id from perf output. "
               "This indicates the input binary supplied for data aggregation "
@@ -329,8 +348,170 @@ void DataAggregator::processFileBuildID(StringRef FileBuildID) {
   } else {
     outs() << "PERF2BOLT: matched build-id and file name\n";
   }
+}
+
+Error DataAggregator::preprocessNativeProfile() {
+  if (opts::BasicAggregation || opts::HeatmapMode)
+    return createStringError(errc::not_supported,
+                             "-native-perf-reader only aggregates LBR samples");
+
+  outs() << "PERF2BOLT: reading " << Filename << "\n";
+  Expected<std::unique_ptr<PerfDataReader>> ReaderOrErr =
+      PerfDataReader::create(Filename, PerfDataChunkSize, opts::MaxSamples);
+  if (!ReaderOrErr)
+    return ReaderOrErr.takeError();
+  const PerfDataReader &Reader = **ReaderOrErr;
+
+  if (Optional<StringRef> FileBuildID = BC->getFileBuildID()) {
+    outs() << "BOLT-INFO: binary build-id is:     " << *FileBuildID << "\n";
+    processNativeBuildID(Reader, *FileBuildID);
+  } else {
+    errs() << "BOLT-WARNING: build-id will not be checked because we could "
+              "not read one from input binary\n";
+  }
+
+  // See preprocessProfile() for the linux kernel mode.
+  if (opts::LinuxKernelMode)
+    opts::IgnoreInterruptLBR = false;
+  else
+    parseNativeMMapEvents(Reader);
+  parseNativeTaskEvents(Reader);
+  filterBinaryMMapInfo();
+
+  if (Error E = parseNativeBranchEvents(Reader))
+    return E;
+
+  // We can finish early if the goal is just to generate data for autofdo
+  if (opts::WriteAutoFDOData) {
+    if (std::error_code EC = writeAutoFDOData(opts::OutputFilename))
+      errs() << "Error writing autofdo data to file: " << EC.message() << "\n";
+    exit(0);
+  }
+
+  return Error::success();
+}
+
+void DataAggregator::processNativeBuildID(const PerfDataReader &Reader,
+                                          StringRef FileBuildID) {
+  if (Reader.getBuildIDs().empty()) {
+    errs() << "PERF2BOLT-WARNING: build-id will not be checked because perf "
+              "data was recorded without it\n";
+    return;
+  }
+
+  Optional<StringRef> FileName;
+  for (const PerfDataReader::BuildIDEntry &Entry : Reader.getBuildIDs()) {
+    if (StringRef(Entry.BuildID).startswith(FileBuildID)) {
+      FileName = sys::path::filename(Entry.FileName);
+      break;
+    }
+  }
+  matchFileBuildID(FileName);
+}
+
+void DataAggregator::parseNativeMMapEvents(const PerfDataReader &Reader) {
+  outs() << "PERF2BOLT: parsing mmap events\n";
+  NamedRegionTimer T("parseMMapEvents", "Parsing mmap events", TimerGroupName,
+                     TimerGroupDesc, opts::TimeAggregator);
+
+  std::multimap<StringRef, MMapInfo> GlobalMMapInfo;
+  for (const PerfDataReader::MMapEvent &Event : Reader.getMMapEvents()) {
+    if (Event.FileName.startswith("//") || Event.FileName.startswith("["))
+      continue;
+
+    MMapInfo Info;
+    Info.MMapAddress = Event.Address;
+    Info.Size = Event.Size;
+    Info.Offset = Event.Offset;
+    Info.PID = Event.PID;
+    Info.Time = Event.Time;
+    addMMapInfo(GlobalMMapInfo, sys::path::filename(Event.FileName), Info);
+  }
+
+  processMMapInfo(GlobalMMapInfo);
+}
+
+void DataAggregator::parseNativeTaskEvents(const PerfDataReader &Reader) {
+  outs() << "PERF2BOLT: parsing task events\n";
+  NamedRegionTimer T("parseTaskEvents", "Parsing task events", TimerGroupName,
+                     TimerGroupDesc, opts::TimeAggregator);
+
+  for (const PerfDataReader::TaskEvent &Event : Reader.getTaskEvents()) {
+    if (Event.Type == PerfDataReader::TaskEvent::COMM_EXEC) {
+      processCommExecEvent(Event.PID);
+      continue;
+    }
+
+    ForkInfo FI;
+    FI.ParentPID = Event.ParentPID;
+    FI.ChildPID = Event.PID;
+    FI.Time = Event.Time;
+    processForkEvent(FI);
+  }
+
+  reportBinaryPIDs();
+}
 
-  return;
+Error DataAggregator::parseNativeBranchEvents(const PerfDataReader &Reader) {
+  outs() << "PERF2BOLT: parse branch events...\n";
+  NamedRegionTimer T("parseBranch", "Parsing branch events", TimerGroupName,
+                     TimerGroupDesc, opts::TimeAggregator);
+
+  // Each chunk of samples is aggregated on its own, and the aggregations are
+  // merged in order once all of them are done.
+  ArrayRef<PerfDataReader::Chunk> Chunks = Reader.getSampleChunks();
+  std::vector<BranchAggregation> ChunkAggrs(Chunks.size());
+  std::vector<Error> ChunkErrors;
+  for (size_t I = 0; I < Chunks.size(); ++I)
+    ChunkErrors.emplace_back(Error::success());
+
+  auto aggregateChunk = [&](size_t I) {
+    BranchAggregation &Aggr = ChunkAggrs[I];
+    PerfBranchSample Sample;
+    auto aggregateSample = [&](const PerfDataReader::Sample &S) {
+      ++Aggr.NumTotalSamples;
+      auto MMapInfoIter = BinaryMMapInfo.find(S.PID);
+      if (!opts::LinuxKernelMode && MMapInfoIter == BinaryMMapInfo.end())
+        return;
+      ++Aggr.NumSamples;
+
+      Sample.PC = S.PC;
+      Sample.LBR.clear();
+      for (LBREntry LBR : S.LBR) {
+        if (ignoreKernelInterrupt(LBR))
+          continue;
+        if (!BC->HasFixedLoadAddress)
+          adjustLBR(LBR, MMapInfoIter->second);
+        Sample.LBR.push_back(LBR);
+      }
+      aggregateBranchSample(Sample, Aggr);
+    };
+    ChunkErrors[I] = Reader.forEachSample(Chunks[I], aggregateSample);
+  };
+
+  if (opts::NoThreads || Chunks.size() < 2) {
+    for (size_t I = 0; I < Chunks.size(); ++I)
+      aggregateChunk(I);
+  } else {
+    ThreadPool &Pool = ParallelUtilities::getThreadPool();
+    for (size_t I = 0; I < Chunks.size(); ++I)
+      Pool.async(aggregateChunk, I);
+    Pool.wait();
+  }
+
+  Error Err = Error::success();
+  for (Error &E : ChunkErrors)
+    Err = joinErrors(std::move(Err), std::move(E));
+  if (Err)
+    return Err;
+
+  BranchAggregation Aggr;
+  if (!ChunkAggrs.empty())
+    Aggr = std::move(ChunkAggrs.front());
+  for (size_t I = 1; I < ChunkAggrs.size(); ++I)
+    Aggr.merge(ChunkAggrs[I]);
+  finishBranchEvents(Aggr);
+  return Error::success();
 }
 
 bool DataAggregator::checkPerfDataMagic(StringRef FileName) {
@@ -479,6 +660,9 @@ Error DataAggregator::preprocessProfile(BinaryContext &BC) {
     return Error::success();
   }
 
+  if (opts::NativePerfReader)
+    return preprocessNativeProfile();
+
   if (Optional<StringRef> FileBuildID = BC.getFileBuildID()) {
     outs() << "BOLT-INFO: binary build-id is:     " << *FileBuildID << "\n";
     processFileBuildID(*FileBuildID);
@@ -1403,15 +1587,9 @@ std::error_code DataAggregator::parseBranchEvents() {
   NamedRegionTimer T("parseBranch", "Parsing branch events", TimerGroupName,
                      TimerGroupDesc, opts::TimeAggregator);
 
-  uint64_t NumTotalSamples = 0;
-  uint64_t NumEntries = 0;
-  uint64_t NumSamples = 0;
-  uint64_t NumSamplesNoLBR = 0;
-  uint64_t NumTraces = 0;
-  bool NeedsSkylakeFix = false;
-
-  while (hasData() && NumTotalSamples < opts::MaxSamples) {
-    ++NumTotalSamples;
+  BranchAggregation Aggr;
+  while (hasData() && Aggr.NumTotalSamples < opts::MaxSamples) {
+    ++Aggr.NumTotalSamples;
 
     ErrorOr<PerfBranchSample> SampleRes = parseBranchSample();
     if (std::error_code EC = SampleRes.getError()) {
@@ -1419,97 +1597,140 @@ std::error_code DataAggregator::parseBranchEvents() {
         continue;
       return EC;
     }
-    ++NumSamples;
+    ++Aggr.NumSamples;
+    aggregateBranchSample(SampleRes.get(), Aggr);
+  }
 
-    PerfBranchSample &Sample = SampleRes.get();
-    if (opts::WriteAutoFDOData)
-      ++BasicSamples[Sample.PC];
+  finishBranchEvents(Aggr);
+  return std::error_code();
+}
 
-    if (Sample.LBR.empty()) {
-      ++NumSamplesNoLBR;
-      continue;
-    }
+void DataAggregator::aggregateBranchSample(const PerfBranchSample &Sample,
+                                           BranchAggregation &Aggr) const {
+  if (opts::WriteAutoFDOData)
+    ++Aggr.BasicSamples[Sample.PC];
 
-    NumEntries += Sample.LBR.size();
-    if (BAT && Sample.LBR.size() == 32 && !NeedsSkylakeFix) {
-      errs() << "PERF2BOLT-WARNING: using Intel Skylake bug workaround\n";
-      NeedsSkylakeFix = true;
-    }
+  if (Sample.LBR.empty()) {
+    ++Aggr.NumSamplesNoLBR;
+    return;
+  }
 
-    // LBRs are stored in reverse execution order. NextPC refers to the next
-    // recorded executed PC.
-    uint64_t NextPC = opts::UseEventPC ? Sample.PC : 0;
-    uint32_t NumEntry = 0;
-    for (const LBREntry &LBR : Sample.LBR) {
-      ++NumEntry;
-      // Hardware bug workaround: Intel Skylake (which has 32 LBR entries)
-      // sometimes record entry 32 as an exact copy of entry 31. This will cause
-      // us to likely record an invalid trace and generate a stale function for
-      // BAT mode (non BAT disassembles the function and is able to ignore this
-      // trace at aggregation time). Drop first 2 entries (last two, in
-      // chronological order)
-      if (NeedsSkylakeFix && NumEntry <= 2)
-        continue;
-      if (NextPC) {
-        // Record fall-through trace.
-        const uint64_t TraceFrom = LBR.To;
-        const uint64_t TraceTo = NextPC;
-        const BinaryFunction *TraceBF =
-            getBinaryFunctionContainingAddress(TraceFrom);
-        if (TraceBF && TraceBF->containsAddress(TraceTo)) {
-          FTInfo &Info = FallthroughLBRs[Trace(TraceFrom, TraceTo)];
-          if (TraceBF->containsAddress(LBR.From))
-            ++Info.InternCount;
-          else
-            ++Info.ExternCount;
+  Aggr.NumEntries += Sample.LBR.size();
+  if (BAT && Sample.LBR.size() == 32)
+    Aggr.NeedsSkylakeFix = true;
+
+  // LBRs are stored in reverse execution order. NextPC refers to the next
+  // recorded executed PC.
+  uint64_t NextPC = opts::UseEventPC ? Sample.PC : 0;
+  uint32_t NumEntry = 0;
+  for (const LBREntry &LBR : Sample.LBR) {
+    ++NumEntry;
+    // Hardware bug workaround: Intel Skylake (which has 32 LBR entries)
+    // sometimes record entry 32 as an exact copy of entry 31. This will cause
+    // us to likely record an invalid trace and generate a stale function for
+    // BAT mode (non BAT disassembles the function and is able to ignore this
+    // trace at aggregation time). Drop first 2 entries (last two, in
+    // chronological order)
+    if (Aggr.NeedsSkylakeFix && NumEntry <= 2)
+      continue;
+    if (NextPC) {
+      // Record fall-through trace.
+      const uint64_t TraceFrom = LBR.To;
+      const uint64_t TraceTo = NextPC;
+      const BinaryFunction *TraceBF =
+          getBinaryFunctionContainingAddress(TraceFrom);
+      if (TraceBF && TraceBF->containsAddress(TraceTo)) {
+        FTInfo &Info = Aggr.FallthroughLBRs[Trace(TraceFrom, TraceTo)];
+        if (TraceBF->containsAddress(LBR.From))
+          ++Info.InternCount;
+        else
+          ++Info.ExternCount;
+      } else {
+        if (TraceBF && getBinaryFunctionContainingAddress(TraceTo)) {
+          LLVM_DEBUG(dbgs()
+                     << "Invalid trace starting in "
+                     << TraceBF->getPrintName() << " @ "
+                     << Twine::utohexstr(TraceFrom - TraceBF->getAddress())
+                     << " and ending @ " << Twine::utohexstr(TraceTo)
+                     << '\n');
+          ++Aggr.NumInvalidTraces;
         } else {
-          if (TraceBF && getBinaryFunctionContainingAddress(TraceTo)) {
-            LLVM_DEBUG(dbgs()
-                       << "Invalid trace starting in "
-                       << TraceBF->getPrintName() << " @ "
-                       << Twine::utohexstr(TraceFrom - TraceBF->getAddress())
-                       << " and ending @ " << Twine::utohexstr(TraceTo)
-                       << '\n');
-            ++NumInvalidTraces;
-          } else {
-            LLVM_DEBUG(dbgs()
-                       << "Out of range trace starting in "
-                       << (TraceBF ? TraceBF->getPrintName() : "None") << " @ "
-                       << Twine::utohexstr(
-                              TraceFrom - (TraceBF ? TraceBF->getAddress() : 0))
-                       << " and ending in "
-                       << (getBinaryFunctionContainingAddress(TraceTo)
-                               ? getBinaryFunctionContainingAddress(TraceTo)
-                                     ->getPrintName()
-                               : "None")
-                       << " @ "
-                       << Twine::utohexstr(
-                              TraceTo -
-                              (getBinaryFunctionContainingAddress(TraceTo)
-                                   ? getBinaryFunctionContainingAddress(TraceTo)
-                                         ->getAddress()
-                                   : 0))
-                       << '\n');
-            ++NumLongRangeTraces;
-          }
+          LLVM_DEBUG(dbgs()
+                     << "Out of range trace starting in "
+                     << (TraceBF ? TraceBF->getPrintName() : "None") << " @ "
+                     << Twine::utohexstr(
+                            TraceFrom - (TraceBF ? TraceBF->getAddress() : 0))
+                     << " and ending in "
+                     << (getBinaryFunctionContainingAddress(TraceTo)
+                             ? getBinaryFunctionContainingAddress(TraceTo)
+                                   ->getPrintName()
+                             : "None")
+                     << " @ "
+                     << Twine::utohexstr(
+                            TraceTo -
+                            (getBinaryFunctionContainingAddress(TraceTo)
+                                 ? getBinaryFunctionContainingAddress(TraceTo)
+                                       ->getAddress()
+                                 : 0))
+                     << '\n');
+          ++Aggr.NumLongRangeTraces;
         }
-        ++NumTraces;
       }
-      NextPC = LBR.From;
-
-      uint64_t From = LBR.From;
-      if (!getBinaryFunctionContainingAddress(From))
-        From = 0;
-      uint64_t To = LBR.To;
-      if (!getBinaryFunctionContainingAddress(To))
-        To = 0;
-      if (!From && !To)
-        continue;
-      BranchInfo &Info = BranchLBRs[Trace(From, To)];
-      ++Info.TakenCount;
-      Info.MispredCount += LBR.Mispred;
+      ++Aggr.NumTraces;
     }
+    NextPC = LBR.From;
+
+    uint64_t From = LBR.From;
+    if (!getBinaryFunctionContainingAddress(From))
+      From = 0;
+    uint64_t To = LBR.To;
+    if (!getBinaryFunctionContainingAddress(To))
+      To = 0;
+    if (!From && !To)
+      continue;
+    BranchInfo &Info = Aggr.BranchLBRs[Trace(From, To)];
+    ++Info.TakenCount;
+    Info.MispredCount += LBR.Mispred;
   }
+}
+
+void DataAggregator::BranchAggregation::merge(const BranchAggregation &Other) {
+  for (const auto &LBR : Other.BranchLBRs) {
+    BranchInfo &Info = BranchLBRs[LBR.first];
+    Info.TakenCount += LBR.second.TakenCount;
+    Info.MispredCount += LBR.second.MispredCount;
+  }
+  for (const auto &LBR : Other.FallthroughLBRs) {
+    FTInfo &Info = FallthroughLBRs[LBR.first];
+    Info.InternCount += LBR.second.InternCount;
+    Info.ExternCount += LBR.second.ExternCount;
+  }
+  for (const auto &Sample : Other.BasicSamples)
+    BasicSamples[Sample.first] += Sample.second;
+  NumTotalSamples += Other.NumTotalSamples;
+  NumSamples += Other.NumSamples;
+  NumSamplesNoLBR += Other.NumSamplesNoLBR;
+  NumEntries += Other.NumEntries;
+  NumTraces += Other.NumTraces;
+  NumInvalidTraces += Other.NumInvalidTraces;
+  NumLongRangeTraces += Other.NumLongRangeTraces;
+  NeedsSkylakeFix |= Other.NeedsSkylakeFix;
+}
+
+void DataAggregator::finishBranchEvents(BranchAggregation &Aggr) {
+  if (Aggr.NeedsSkylakeFix)
+    errs() << "PERF2BOLT-WARNING: using Intel Skylake bug workaround\n";
+
+  BranchLBRs = std::move(Aggr.BranchLBRs);
+  FallthroughLBRs = std::move(Aggr.FallthroughLBRs);
+  BasicSamples = std::move(Aggr.BasicSamples);
+  NumInvalidTraces += Aggr.NumInvalidTraces;
+  NumLongRangeTraces += Aggr.NumLongRangeTraces;
+  const uint64_t NumTotalSamples = Aggr.NumTotalSamples;
+  const uint64_t NumSamples = Aggr.NumSamples;
+  const uint64_t NumSamplesNoLBR = Aggr.NumSamplesNoLBR;
+  const uint64_t NumEntries = Aggr.NumEntries;
+  const uint64_t NumTraces = Aggr.NumTraces;
 
   for (const auto &LBR : BranchLBRs) {
     const Trace &Trace = LBR.first;
@@ -1587,8 +1808,6 @@ std::error_code DataAggregator::parseBranchEvents() {
              "likely used bad data or your service observed a large shift in "
              "profile. You may want to audit this.\n";
   }
-
-  return std::error_code();
 }
 
 void DataAggregator::processBranchEvents() {
@@ -2006,21 +2225,27 @@ std::error_code DataAggregator::parseMMapEvents() {
     if (FileMMapInfo.second.PID == -1)
       continue;
 
-    // Consider only the first mapping of the file for any given PID
-    bool PIDExists = false;
-    auto Range = GlobalMMapInfo.equal_range(FileMMapInfo.first);
-    for (auto MI = Range.first; MI != Range.second; ++MI) {
-      if (MI->second.PID == FileMMapInfo.second.PID) {
-        PIDExists = true;
-        break;
-      }
-    }
-    if (PIDExists)
-      continue;
-
-    GlobalMMapInfo.insert(FileMMapInfo);
+    addMMapInfo(GlobalMMapInfo, FileMMapInfo.first, FileMMapInfo.second);
   }
 
+  processMMapInfo(GlobalMMapInfo);
+  return std::error_code();
+}
+
+void DataAggregator::addMMapInfo(
+    std::multimap<StringRef, MMapInfo> &GlobalMMapInfo, StringRef FileName,
+    const MMapInfo &Info) {
+  // Consider only the first mapping of the file for any given PID
+  auto Range = GlobalMMapInfo.equal_range(FileName);
+  for (auto MI = Range.first; MI != Range.second; ++MI)
+    if (MI->second.PID == Info.PID)
+      return;
+
+  GlobalMMapInfo.insert(std::make_pair(FileName, Info));
+}
+
+void DataAggregator::processMMapInfo(
+    std::multimap<StringRef, MMapInfo> &GlobalMMapInfo) {
   LLVM_DEBUG({
     dbgs() << "FileName -> mmap info:\n";
     for (const std::pair<const StringRef, MMapInfo> &Pair : GlobalMMapInfo)
@@ -2100,8 +2325,6 @@ std::error_code DataAggregator::parseMMapEvents() {
 
     exit(1);
   }
-
-  return std::error_code();
 }
 
 std::error_code DataAggregator::parseTaskEvents() {
@@ -2111,48 +2334,56 @@ std::error_code DataAggregator::parseTaskEvents() {
 
   while (hasData()) {
     if (Optional<int32_t> CommInfo = parseCommExecEvent()) {
-      // Remove forked child that ran execve
-      auto MMapInfoIter = BinaryMMapInfo.find(*CommInfo);
-      if (MMapInfoIter != BinaryMMapInfo.end() && MMapInfoIter->second.Forked)
-        BinaryMMapInfo.erase(MMapInfoIter);
+      processCommExecEvent(*CommInfo);
       consumeRestOfLine();
       continue;
     }
 
-    Optional<ForkInfo> ForkInfo = parseForkEvent();
-    if (!ForkInfo)
-      continue;
+    if (Optional<ForkInfo> ForkInfo = parseForkEvent())
+      processForkEvent(*ForkInfo);
+  }
 
-    if (ForkInfo->ParentPID == ForkInfo->ChildPID)
-      continue;
+  reportBinaryPIDs();
+  return std::error_code();
+}
 
-    if (ForkInfo->Time == 0) {
-      // Process was forked and mmaped before perf ran. In this case the child
-      // should have its own mmap entry unless it was execve'd.
-      continue;
-    }
+void DataAggregator::processCommExecEvent(int32_t PID) {
+  // Remove forked child that ran execve
+  auto MMapInfoIter = BinaryMMapInfo.find(PID);
+  if (MMapInfoIter != BinaryMMapInfo.end() && MMapInfoIter->second.Forked)
+    BinaryMMapInfo.erase(MMapInfoIter);
+}
 
-    auto MMapInfoIter = BinaryMMapInfo.find(ForkInfo->ParentPID);
-    if (MMapInfoIter == BinaryMMapInfo.end())
-      continue;
+void DataAggregator::processForkEvent(const ForkInfo &FI) {
+  if (FI.ParentPID == FI.ChildPID)
+    return;
 
-    MMapInfo MMapInfo = MMapInfoIter->second;
-    MMapInfo.PID = ForkInfo->ChildPID;
-    MMapInfo.Forked = true;
-    BinaryMMapInfo.insert(std::make_pair(MMapInfo.PID, MMapInfo));
+  if (FI.Time == 0) {
+    // Process was forked and mmaped before perf ran. In this case the child
+    // should have its own mmap entry unless it was execve'd.
+    return;
   }
 
+  auto MMapInfoIter = BinaryMMapInfo.find(FI.ParentPID);
+  if (MMapInfoIter == BinaryMMapInfo.end())
+    return;
+
+  MMapInfo MMapInfo = MMapInfoIter->second;
+  MMapInfo.PID = FI.ChildPID;
+  MMapInfo.Forked = true;
+  BinaryMMapInfo.insert(std::make_pair(MMapInfo.PID, MMapInfo));
+}
+
+void DataAggregator::reportBinaryPIDs() const {
   outs() << "PERF2BOLT: input binary is associated with "
          << BinaryMMapInfo.size() << " PID(s)\n";
 
   LLVM_DEBUG({
-    for (std::pair<const uint64_t, MMapInfo> &MMI : BinaryMMapInfo)
+    for (const std::pair<const uint64_t, MMapInfo> &MMI : BinaryMMapInfo)
       outs() << "  " << MMI.second.PID << (MMI.second.Forked ? " (forked)" : "")
              << ": (0x" << Twine::utohexstr(MMI.second.MMapAddress) << ": 0x"
              << Twine::utohexstr(MMI.second.Size) << ")\n";
   });
-
-  return std::error_code();
 }
 
 Optional<std::pair<StringRef, StringRef>>
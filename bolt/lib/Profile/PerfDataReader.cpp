@@ -0,0 +1,460 @@
+//===- bolt/Profile/PerfDataReader.cpp - Native perf.data reader ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a reader of the perf.data files written by perf record.
+// The layout of the file and of its records is described by
+// tools/perf/Documentation/perf.data-file-format.txt in the Linux sources and
+// by include/uapi/linux/perf_event.h.
+//
+//===----------------------------------------------------------------------===//
+
+#include "bolt/Profile/PerfDataReader.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+using namespace bolt;
+
+namespace {
+
+/// "PERFILE2" read as a little-endian integer.
+const uint64_t PerfMagic = 0x32454c4946524550ULL;
+
+/// The size of struct perf_file_header.
+const uint64_t FileHeaderSize = 104;
+
+/// The size of struct perf_event_header.
+const uint64_t RecordHeaderSize = 8;
+
+enum RecordType : uint32_t {
+  PERF_RECORD_COMM = 3,
+  PERF_RECORD_FORK = 7,
+  PERF_RECORD_SAMPLE = 9,
+  PERF_RECORD_MMAP2 = 10,
+  PERF_RECORD_AUXTRACE = 71,
+};
+
+enum : uint16_t {
+  PERF_RECORD_MISC_COMM_EXEC = 1 << 13,
+  PERF_RECORD_MISC_BUILD_ID_SIZE = 1 << 15,
+};
+
+enum : uint64_t {
+  PERF_SAMPLE_IP = 1 << 0,
+  PERF_SAMPLE_TID = 1 << 1,
+  PERF_SAMPLE_TIME = 1 << 2,
+  PERF_SAMPLE_ADDR = 1 << 3,
+  PERF_SAMPLE_READ = 1 << 4,
+  PERF_SAMPLE_CALLCHAIN = 1 << 5,
+  PERF_SAMPLE_ID = 1 << 6,
+  PERF_SAMPLE_CPU = 1 << 7,
+  PERF_SAMPLE_PERIOD = 1 << 8,
+  PERF_SAMPLE_STREAM_ID = 1 << 9,
+  PERF_SAMPLE_RAW = 1 << 10,
+  PERF_SAMPLE_BRANCH_STACK = 1 << 11,
+  PERF_SAMPLE_IDENTIFIER = 1 << 16,
+};
+
+enum : uint64_t {
+  PERF_FORMAT_TOTAL_TIME_ENABLED = 1 << 0,
+  PERF_FORMAT_TOTAL_TIME_RUNNING = 1 << 1,
+  PERF_FORMAT_ID = 1 << 2,
+  PERF_FORMAT_GROUP = 1 << 3,
+  PERF_FORMAT_LOST = 1 << 4,
+};
+
+const uint64_t PERF_SAMPLE_BRANCH_HW_INDEX = 1 << 17;
+
+/// The bit of perf_event_attr::sample_id_all in the flags of the attribute.
+const uint64_t SampleIDAllFlag = 1ULL << 18;
+
+/// The feature bit of the HEADER_BUILD_ID section.
+const unsigned HeaderBuildID = 2;
+
+Error malformed(const Twine &What, uint64_t Offset) {
+  return createStringError(errc::invalid_argument,
+                           "malformed perf.data file: %s at offset 0x%" PRIx64,
+                           What.str().c_str(), Offset);
+}
+
+/// Return the string at the start of \p Data, which is padded with nul
+/// characters.
+StringRef getPaddedString(StringRef Data) {
+  return Data.take_until([](char C) { return C == '\0'; });
+}
+
+} // namespace
+
+Expected<std::unique_ptr<PerfDataReader>>
+PerfDataReader::create(StringRef FileName, uint64_t ChunkSize,
+                       uint64_t MaxSamples) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+      MemoryBuffer::getFile(FileName, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (std::error_code EC = MB.getError())
+    return errorCodeToError(EC);
+
+  std::unique_ptr<PerfDataReader> Reader(new PerfDataReader(std::move(*MB)));
+  uint64_t DataOffset, DataSize, FeatureOffset, Features;
+  if (Error E =
+          Reader->readHeader(DataOffset, DataSize, FeatureOffset, Features))
+    return std::move(E);
+  if (Error E = Reader->readBuildIDs(FeatureOffset, Features))
+    return std::move(E);
+  if (Error E =
+          Reader->readRecords(DataOffset, DataSize, ChunkSize, MaxSamples))
+    return std::move(E);
+  return std::move(Reader);
+}
+
+Error PerfDataReader::readHeader(uint64_t &DataOffset, uint64_t &DataSize,
+                                 uint64_t &FeatureOffset, uint64_t &Features) {
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  DataExtractor::Cursor C(0);
+  const uint64_t Magic = DE.getU64(C);
+  const uint64_t HeaderSize = DE.getU64(C);
+  const uint64_t AttrSize = DE.getU64(C);
+  const uint64_t AttrsOffset = DE.getU64(C);
+  const uint64_t AttrsSize = DE.getU64(C);
+  DataOffset = DE.getU64(C);
+  DataSize = DE.getU64(C);
+  DE.skip(C, 16);
+  Features = DE.getU64(C);
+  if (Error E = C.takeError())
+    return E;
+
+  if (Magic == ByteSwap_64(PerfMagic))
+    return createStringError(errc::not_supported,
+                             "big-endian perf.data files are not supported");
+  if (Magic != PerfMagic)
+    return malformed("bad magic", 0);
+  if (HeaderSize != FileHeaderSize)
+    return createStringError(errc::not_supported,
+                             "perf.data files written in pipe mode are not "
+                             "supported");
+  if (DataOffset + DataSize > getData().size())
+    return malformed("data section out of bounds", DataOffset);
+
+  FeatureOffset = DataOffset + DataSize;
+  return readAttrs(AttrsOffset, AttrsSize, AttrSize);
+}
+
+Error PerfDataReader::readAttrs(uint64_t Offset, uint64_t Size,
+                                uint64_t AttrSize) {
+  // Each entry is a perf_event_attr followed by the section of its IDs.
+  if (AttrSize < 80 || Size % AttrSize != 0 || Size == 0)
+    return malformed("bad attribute section", Offset);
+
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  for (uint64_t Entry = Offset; Entry != Offset + Size; Entry += AttrSize) {
+    DataExtractor::Cursor C(Entry + 24);
+    EventAttr Attr;
+    Attr.SampleType = DE.getU64(C);
+    Attr.ReadFormat = DE.getU64(C);
+    Attr.SampleIDAll = DE.getU64(C) & SampleIDAllFlag;
+    DE.skip(C, 24);
+    Attr.BranchSampleType = DE.getU64(C);
+    C.seek(Entry + AttrSize - 16);
+    const uint64_t IDsOffset = DE.getU64(C);
+    const uint64_t IDsSize = DE.getU64(C);
+    C.seek(IDsOffset);
+    for (uint64_t I = 0; I < IDsSize / 8 && C; ++I)
+      IDToAttr[DE.getU64(C)] = Attrs.size();
+    if (Error E = C.takeError())
+      return E;
+    Attrs.push_back(Attr);
+  }
+
+  for (const EventAttr &Attr : Attrs) {
+    if (Attrs.size() > 1 && !(Attr.SampleType & PERF_SAMPLE_IDENTIFIER) &&
+        Attr.SampleType != Attrs[0].SampleType)
+      return createStringError(errc::not_supported,
+                               "events with different sample layouts need "
+                               "PERF_SAMPLE_IDENTIFIER");
+  }
+  return Error::success();
+}
+
+Error PerfDataReader::readBuildIDs(uint64_t FeatureOffset, uint64_t Features) {
+  if (!(Features & (1ULL << HeaderBuildID)))
+    return Error::success();
+
+  // The features sections are stored in the order of the feature bits.
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  DataExtractor::Cursor C(
+      FeatureOffset +
+      16 * countPopulation(Features & ((1ULL << HeaderBuildID) - 1)));
+  const uint64_t Offset = DE.getU64(C);
+  const uint64_t Size = DE.getU64(C);
+  if (Error E = C.takeError())
+    return E;
+  if (Offset + Size > getData().size())
+    return malformed("build-id section out of bounds", Offset);
+
+  // Each entry is a perf_record_header_build_id.
+  for (uint64_t Pos = Offset, End = Offset + Size; Pos < End;) {
+    C.seek(Pos);
+    DE.skip(C, 4);
+    const uint16_t Misc = DE.getU16(C);
+    const uint16_t RecordSize = DE.getU16(C);
+    DE.skip(C, 4);
+    StringRef ID = DE.getBytes(C, 24);
+    if (Error E = C.takeError())
+      return E;
+    if (RecordSize < RecordHeaderSize + 28 || Pos + RecordSize > End)
+      return malformed("bad build-id record", Pos);
+
+    unsigned IDSize = 20;
+    if (Misc & PERF_RECORD_MISC_BUILD_ID_SIZE)
+      IDSize = std::min<unsigned>(ID[20], 20);
+    BuildIDs.push_back(
+        {toHex(ID.take_front(IDSize), /*LowerCase=*/true),
+         getPaddedString(getData().slice(C.tell(), Pos + RecordSize))});
+    Pos += RecordSize;
+  }
+  return Error::success();
+}
+
+Error PerfDataReader::readRecords(uint64_t DataOffset, uint64_t DataSize,
+                                  uint64_t ChunkSize, uint64_t MaxSamples) {
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  Chunk Current{DataOffset, DataOffset};
+  uint64_t NumChunkSamples = 0;
+  bool CollectSamples = MaxSamples != 0;
+  auto finishChunk = [&](uint64_t End) {
+    Current.End = End;
+    if (NumChunkSamples)
+      SampleChunks.push_back(Current);
+    Current.Begin = End;
+    NumChunkSamples = 0;
+  };
+
+  const uint64_t DataEnd = DataOffset + DataSize;
+  for (uint64_t Pos = DataOffset; Pos + RecordHeaderSize <= DataEnd;) {
+    DataExtractor::Cursor C(Pos);
+    const uint32_t Type = DE.getU32(C);
+    const uint16_t Misc = DE.getU16(C);
+    const uint16_t Size = DE.getU16(C);
+    if (Error E = C.takeError())
+      return E;
+    uint64_t End = Pos + Size;
+    if (Size < RecordHeaderSize || End > DataEnd)
+      return malformed("bad record size", Pos);
+
+    switch (Type) {
+    case PERF_RECORD_SAMPLE:
+      if (!CollectSamples)
+        break;
+      ++NumSamples;
+      ++NumChunkSamples;
+      if (NumSamples == MaxSamples) {
+        finishChunk(End);
+        CollectSamples = false;
+      }
+      break;
+    case PERF_RECORD_MMAP2: {
+      // pid, tid, addr, len, pgoff, device and inode or build-id, prot and
+      // flags, filename.
+      MMapEvent Event;
+      Event.PID = DE.getU32(C);
+      DE.skip(C, 4);
+      Event.Address = DE.getU64(C);
+      Event.Size = DE.getU64(C);
+      Event.Offset = DE.getU64(C);
+      DE.skip(C, 32);
+      if (Error E = C.takeError())
+        return E;
+      if (C.tell() > End)
+        return malformed("bad mmap record", Pos);
+      Event.Time = getRecordTime(Pos, End);
+      Event.FileName = getPaddedString(getData().slice(C.tell(), End));
+      MMapEvents.push_back(Event);
+      break;
+    }
+    case PERF_RECORD_FORK: {
+      // pid, ppid, tid, ptid, time.
+      TaskEvent Event;
+      Event.Type = TaskEvent::FORK;
+      Event.PID = DE.getU32(C);
+      Event.ParentPID = DE.getU32(C);
+      DE.skip(C, 8);
+      Event.Time = DE.getU64(C) / 1000;
+      if (Error E = C.takeError())
+        return E;
+      if (C.tell() > End)
+        return malformed("bad fork record", Pos);
+      TaskEvents.push_back(Event);
+      break;
+    }
+    case PERF_RECORD_COMM: {
+      if (!(Misc & PERF_RECORD_MISC_COMM_EXEC))
+        break;
+      TaskEvent Event;
+      Event.Type = TaskEvent::COMM_EXEC;
+      Event.PID = DE.getU32(C);
+      Event.ParentPID = -1;
+      Event.Time = getRecordTime(Pos, End);
+      if (Error E = C.takeError())
+        return E;
+      TaskEvents.push_back(Event);
+      break;
+    }
+    case PERF_RECORD_AUXTRACE: {
+      // The trace data follows the record.
+      const uint64_t AuxSize = DE.getU64(C);
+      if (Error E = C.takeError())
+        return E;
+      End += AuxSize;
+      if (End > DataEnd)
+        return malformed("bad auxtrace record", Pos);
+      break;
+    }
+    default:
+      break;
+    }
+
+    Pos = End;
+    if (CollectSamples && Pos - Current.Begin >= ChunkSize)
+      finishChunk(Pos);
+  }
+  if (CollectSamples)
+    finishChunk(DataEnd);
+  return Error::success();
+}
+
+const PerfDataReader::EventAttr *
+PerfDataReader::getSampleAttr(uint64_t Offset) const {
+  const EventAttr &First = Attrs.front();
+  if (Attrs.size() == 1 || !(First.SampleType & PERF_SAMPLE_IDENTIFIER))
+    return &First;
+
+  // The identifier is the first field of the sample.
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  uint64_t IDOffset = Offset + RecordHeaderSize;
+  auto It = IDToAttr.find(DE.getU64(&IDOffset));
+  return It == IDToAttr.end() ? nullptr : &Attrs[It->second];
+}
+
+const PerfDataReader::EventAttr *
+PerfDataReader::getRecordAttr(uint64_t End) const {
+  const EventAttr &First = Attrs.front();
+  if (Attrs.size() == 1 || !(First.SampleType & PERF_SAMPLE_IDENTIFIER) ||
+      !First.SampleIDAll)
+    return &First;
+
+  // The identifier is the last field of the sample ID of the record.
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  uint64_t IDOffset = End - 8;
+  auto It = IDToAttr.find(DE.getU64(&IDOffset));
+  return It == IDToAttr.end() ? nullptr : &Attrs[It->second];
+}
+
+uint64_t PerfDataReader::getRecordTime(uint64_t Offset, uint64_t End) const {
+  const EventAttr *Attr = getRecordAttr(End);
+  if (!Attr || !Attr->SampleIDAll || !(Attr->SampleType & PERF_SAMPLE_TIME))
+    return 0;
+
+  // The sample ID holds the fields below, in this order, at the end of the
+  // record.
+  const uint64_t SampleIDFields = PERF_SAMPLE_TID | PERF_SAMPLE_TIME |
+                                  PERF_SAMPLE_ID | PERF_SAMPLE_STREAM_ID |
+                                  PERF_SAMPLE_CPU | PERF_SAMPLE_IDENTIFIER;
+  uint64_t TimeOffset =
+      End - 8 * countPopulation(Attr->SampleType & SampleIDFields);
+  if (Attr->SampleType & PERF_SAMPLE_TID)
+    TimeOffset += 8;
+  if (TimeOffset < Offset + RecordHeaderSize)
+    return 0;
+
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  return DE.getU64(&TimeOffset) / 1000;
+}
+
+Error PerfDataReader::forEachSample(
+    const Chunk &C, function_ref<void(const Sample &)> Callback) const {
+  DataExtractor DE(getData(), /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  SmallVector<LBREntry, 32> LBR;
+  for (uint64_t Pos = C.Begin; Pos < C.End;) {
+    uint64_t HeaderOffset = Pos;
+    const uint32_t Type = DE.getU32(&HeaderOffset);
+    DE.getU16(&HeaderOffset);
+    const uint64_t Size = DE.getU16(&HeaderOffset);
+    uint64_t End = Pos + Size;
+    if (Type == PERF_RECORD_AUXTRACE)
+      End += DE.getU64(&HeaderOffset);
+    if (Type != PERF_RECORD_SAMPLE) {
+      Pos = End;
+      continue;
+    }
+
+    const EventAttr *Attr = getSampleAttr(Pos);
+    if (!Attr)
+      return malformed("sample of unknown event", Pos);
+
+    // Read the record on its own so that its fields cannot overflow it.
+    DataExtractor RDE(getData().slice(Pos, End), /*IsLittleEndian=*/true,
+                      /*AddressSize=*/8);
+    DataExtractor::Cursor Cur(RecordHeaderSize);
+    const uint64_t SampleType = Attr->SampleType;
+    Sample S{-1, 0, {}};
+    if (SampleType & PERF_SAMPLE_IDENTIFIER)
+      RDE.skip(Cur, 8);
+    if (SampleType & PERF_SAMPLE_IP)
+      S.PC = RDE.getU64(Cur);
+    if (SampleType & PERF_SAMPLE_TID) {
+      S.PID = RDE.getU32(Cur);
+      RDE.skip(Cur, 4);
+    }
+    RDE.skip(Cur, 8 * countPopulation(SampleType & (PERF_SAMPLE_TIME |
+                                              PERF_SAMPLE_ADDR |
+                                              PERF_SAMPLE_ID |
+                                              PERF_SAMPLE_STREAM_ID |
+                                              PERF_SAMPLE_CPU |
+                                              PERF_SAMPLE_PERIOD)));
+    if (SampleType & PERF_SAMPLE_READ) {
+      const uint64_t Format = Attr->ReadFormat;
+      const uint64_t TimeSize =
+          8 * countPopulation(Format & (PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                        PERF_FORMAT_TOTAL_TIME_RUNNING));
+      const uint64_t ValueSize =
+          8 + 8 * countPopulation(Format & (PERF_FORMAT_ID | PERF_FORMAT_LOST));
+      if (Format & PERF_FORMAT_GROUP) {
+        const uint64_t NumValues = RDE.getU64(Cur);
+        RDE.skip(Cur, TimeSize + NumValues * ValueSize);
+      } else {
+        RDE.skip(Cur, TimeSize + ValueSize);
+      }
+    }
+    if (SampleType & PERF_SAMPLE_CALLCHAIN)
+      RDE.skip(Cur, 8 * RDE.getU64(Cur));
+    if (SampleType & PERF_SAMPLE_RAW)
+      RDE.skip(Cur, RDE.getU32(Cur));
+    LBR.clear();
+    if (SampleType & PERF_SAMPLE_BRANCH_STACK) {
+      const uint64_t NumEntries = RDE.getU64(Cur);
+      if (Attr->BranchSampleType & PERF_SAMPLE_BRANCH_HW_INDEX)
+        RDE.skip(Cur, 8);
+      for (uint64_t I = 0; I < NumEntries && Cur; ++I) {
+        LBREntry Entry;
+        Entry.From = RDE.getU64(Cur);
+        Entry.To = RDE.getU64(Cur);
+        Entry.Mispred = RDE.getU64(Cur) & 1;
+        LBR.push_back(Entry);
+      }
+    }
+    if (Error E = Cur.takeError())
+      return E;
+
+    S.LBR = LBR;
+    Callback(S);
+    Pos = End;
+  }
+  return Error::success();
+}
@@ -0,0 +1,188 @@
+//===- bolt/Profile/StaleProfileMatching.cpp - Stale profile matching -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A profile is stale when the function it was collected on has changed since,
+// so that its blocks no longer line up with the CFG of the function. The
+// blocks of such a profile are matched to the blocks of the function with the
+// same blended hash, or failing that, with the same opcodes and the most
+// similar neighbours. The counts of the matched blocks are then completed into
+// a consistent flow over the whole CFG.
+//
+//===----------------------------------------------------------------------===//
+
+#include "bolt/Profile/StaleProfileMatching.h"
+#include "bolt/Core/BinaryBasicBlock.h"
+#include "bolt/Core/BinaryFunction.h"
+#include "bolt/Passes/MCF.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <unordered_map>
+
+#undef  DEBUG_TYPE
+#define DEBUG_TYPE "bolt-prof"
+
+using namespace llvm;
+
+namespace opts {
+
+extern cl::OptionCategory BoltOptCategory;
+
+cl::opt<bool>
+InferStaleProfile("infer-stale-profile",
+  cl::desc("match the profile of functions that changed since it was "
+           "collected by basic block hashes, and infer the missing counts"),
+  cl::init(false),
+  cl::ZeroOrMore,
+  cl::cat(BoltOptCategory));
+
+static cl::opt<unsigned>
+StaleMatchingMinMatchedBlock("stale-matching-min-matched-block",
+  cl::desc("the percentage of the blocks of a stale profile that have to be "
+           "matched for the profile to be used"),
+  cl::init(50),
+  cl::ZeroOrMore,
+  cl::Hidden,
+  cl::cat(BoltOptCategory));
+
+} // namespace opts
+
+namespace llvm {
+namespace bolt {
+
+DenseMap<const BinaryBasicBlock *, uint64_t>
+computeBlockHashes(const BinaryFunction &BF) {
+  const BinaryContext &BC = BF.getBinaryContext();
+
+  // Hash the opcodes of each block, ignoring the same instructions as
+  // BinaryFunction::computeHash().
+  DenseMap<const BinaryBasicBlock *, uint32_t> OpcodeHashes;
+  for (const BinaryBasicBlock &BB : BF) {
+    std::string HashString;
+    for (const MCInst &Inst : BB) {
+      if (BC.MIB->isPseudo(Inst) || BC.MIB->isUnconditionalBranch(Inst))
+        continue;
+      unsigned Opcode = Inst.getOpcode();
+      if (Opcode == 0)
+        HashString.push_back(0);
+      while (Opcode) {
+        HashString.push_back(Opcode & 0xff);
+        Opcode = Opcode >> 8;
+      }
+    }
+    OpcodeHashes[&BB] = xxHash64(HashString);
+  }
+
+  auto hashNeighbours = [&](std::vector<uint32_t> &Hashes) {
+    return static_cast<uint16_t>(xxHash64(
+        StringRef(reinterpret_cast<const char *>(Hashes.data()),
+                  Hashes.size() * sizeof(uint32_t))));
+  };
+
+  DenseMap<const BinaryBasicBlock *, uint64_t> Hashes;
+  std::vector<uint32_t> NeighbourHashes;
+  for (const BinaryBasicBlock &BB : BF) {
+    BlendedBlockHash Hash;
+    Hash.OpcodeHash = OpcodeHashes[&BB];
+
+    // The order of the successors tells the taken branch from the fall-through
+    // while that of the predecessors is arbitrary.
+    NeighbourHashes.clear();
+    for (const BinaryBasicBlock *Succ : BB.successors())
+      NeighbourHashes.push_back(OpcodeHashes[Succ]);
+    Hash.SuccHash = hashNeighbours(NeighbourHashes);
+
+    NeighbourHashes.clear();
+    for (const BinaryBasicBlock *Pred : BB.predecessors())
+      NeighbourHashes.push_back(OpcodeHashes[Pred]);
+    llvm::sort(NeighbourHashes);
+    Hash.PredHash = hashNeighbours(NeighbourHashes);
+
+    Hashes[&BB] = Hash.combine();
+  }
+  return Hashes;
+}
+
+bool matchStaleProfile(BinaryFunction &BF,
+                       const yaml::bolt::BinaryFunctionProfile &YamlBF) {
+  if (BF.empty() || YamlBF.Blocks.empty())
+    return false;
+
+  // The profile numbers the blocks in the layout order, see
+  // YAMLProfileWriter.
+  DenseMap<const BinaryBasicBlock *, uint64_t> Hashes = computeBlockHashes(BF);
+  BF.updateLayoutIndices();
+  std::unordered_map<uint32_t, std::vector<BinaryBasicBlock *>>
+      BlocksByOpcodeHash;
+  for (BinaryBasicBlock *BB : BF.layout())
+    BlocksByOpcodeHash[BlendedBlockHash(Hashes[BB]).OpcodeHash].push_back(BB);
+
+  for (BinaryBasicBlock &BB : BF)
+    BB.setExecutionCount(BinaryBasicBlock::COUNT_NO_PROFILE);
+
+  // Match the blocks with the same hash first, then the rest to the blocks
+  // with the same opcodes and the fewest different neighbours. Ties go to the
+  // block closest to the one in the profile in the layout.
+  DenseSet<BinaryBasicBlock *> MatchedBlocks;
+  std::vector<bool> IsYamlBBMatched(YamlBF.Blocks.size());
+  for (const bool Exact : {true, false}) {
+    for (unsigned I = 0, E = YamlBF.Blocks.size(); I != E; ++I) {
+      const yaml::bolt::BinaryBasicBlockProfile &YamlBB = YamlBF.Blocks[I];
+      if (IsYamlBBMatched[I] || !YamlBB.Hash)
+        continue;
+      const BlendedBlockHash YamlHash(YamlBB.Hash);
+      auto It = BlocksByOpcodeHash.find(YamlHash.OpcodeHash);
+      if (It == BlocksByOpcodeHash.end())
+        continue;
+
+      BinaryBasicBlock *BestBB = nullptr;
+      std::pair<unsigned, unsigned> BestKey;
+      for (BinaryBasicBlock *BB : It->second) {
+        if (MatchedBlocks.count(BB))
+          continue;
+        const unsigned Distance =
+            YamlHash.distance(BlendedBlockHash(Hashes[BB]));
+        if (Exact && Distance)
+          continue;
+        const unsigned Index = BB->getLayoutIndex();
+        const std::pair<unsigned, unsigned> Key(
+            Distance, Index > YamlBB.Index ? Index - YamlBB.Index
+                                           : YamlBB.Index - Index);
+        if (!BestBB || Key < BestKey) {
+          BestBB = BB;
+          BestKey = Key;
+        }
+      }
+      if (!BestBB)
+        continue;
+
+      MatchedBlocks.insert(BestBB);
+      IsYamlBBMatched[I] = true;
+      BestBB->setExecutionCount(YamlBB.ExecCount);
+    }
+  }
+
+  LLVM_DEBUG(dbgs() << "BOLT-DEBUG: matched " << MatchedBlocks.size()
+                    << " of " << YamlBF.Blocks.size()
+                    << " blocks of the stale profile of " << BF << '\n');
+  if (MatchedBlocks.empty() ||
+      MatchedBlocks.size() * 100 <
+          YamlBF.Blocks.size() * opts::StaleMatchingMinMatchedBlock) {
+    for (BinaryBasicBlock *BB : MatchedBlocks)
+      BB->setExecutionCount(BinaryBasicBlock::COUNT_NO_PROFILE);
+    return false;
+  }
+
+  inferFlowCounts(BF);
+  return true;
+}
+
+} // namespace bolt
+} // namespace llvm
@@ -10,7 +10,9 @@
 #include "bolt/Core/BinaryBasicBlock.h"
 #include "bolt/Core/BinaryFunction.h"
 #include "bolt/Passes/MCF.h"
+#include "bolt/Profile/BinaryProfileFormat.h"
 #include "bolt/Profile/ProfileYAMLMapping.h"
+#include "bolt/Profile/StaleProfileMatching.h"
 #include "bolt/Utils/Utils.h"
 #include "llvm/Support/CommandLine.h"
 
@@ -20,6 +22,7 @@ namespace opts {
 
 extern cl::opt<unsigned> Verbosity;
 extern cl::OptionCategory BoltOptCategory;
+extern cl::opt<bool> InferStaleProfile;
 
 static llvm::cl::opt<bool>
 IgnoreHash("profile-ignore-hash",
@@ -40,7 +43,8 @@ bool YAMLProfileReader::isYAML(const StringRef Filename) {
   if (std::error_code EC = MB.getError())
     report_error(Filename, EC);
   StringRef Buffer = MB.get()->getBuffer();
-  if (Buffer.startswith("---\n"))
+  if (Buffer.startswith("---\n") ||
+      BinaryProfileFormat::isBinaryProfile(Buffer))
     return true;
   return false;
 }
@@ -247,14 +251,22 @@ Error YAMLProfileReader::preprocessProfile(BinaryContext &BC) {
     errs() << "ERROR: cannot open " << Filename << ": " << EC.message() << "\n";
     return errorCodeToError(EC);
   }
-  yaml::Input YamlInput(MB.get()->getBuffer());
-
-  // Consume YAML file.
-  YamlInput >> YamlBP;
-  if (YamlInput.error()) {
-    errs() << "BOLT-ERROR: syntax error parsing profile in " << Filename
-           << " : " << YamlInput.error().message() << '\n';
-    return errorCodeToError(YamlInput.error());
+  StringRef Buffer = MB.get()->getBuffer();
+
+  if (BinaryProfileFormat::isBinaryProfile(Buffer)) {
+    if (Error E = BinaryProfileFormat::readBinaryProfile(Buffer, YamlBP)) {
+      errs() << "BOLT-ERROR: malformed binary profile in " << Filename << '\n';
+      return E;
+    }
+  } else {
+    // Consume YAML file.
+    yaml::Input YamlInput(Buffer);
+    YamlInput >> YamlBP;
+    if (YamlInput.error()) {
+      errs() << "BOLT-ERROR: syntax error parsing profile in " << Filename
+             << " : " << YamlInput.error().message() << '\n';
+      return errorCodeToError(YamlInput.error());
+    }
   }
 
   // Sanity check.
@@ -396,19 +408,40 @@ Error YAMLProfileReader::readProfile(BinaryContext &BC) {
   NormalizeByInsnCount = usesEvent("cycles") || usesEvent("instructions");
   NormalizeByCalls = usesEvent("branches");
 
+  // Profiles of functions that changed since they were collected are matched
+  // by block hashes instead, with -infer-stale-profile.
+  const bool MatchStale = opts::InferStaleProfile && !opts::IgnoreHash &&
+                          (YamlBP.Header.Flags & BinaryFunction::PF_LBR);
+
   uint64_t NumUnused = 0;
+  uint64_t NumStale = 0;
+  uint64_t NumStaleMatched = 0;
   for (yaml::bolt::BinaryFunctionProfile &YamlBF : YamlBP.Functions) {
     if (YamlBF.Id >= YamlProfileToFunction.size()) {
       // Such profile was ignored.
       ++NumUnused;
       continue;
     }
-    if (BinaryFunction *BF = YamlProfileToFunction[YamlBF.Id])
-      parseFunctionProfile(*BF, YamlBF);
-    else
+    BinaryFunction *BF = YamlProfileToFunction[YamlBF.Id];
+    if (!BF) {
       ++NumUnused;
+      continue;
+    }
+    if (MatchStale && YamlBF.Hash != static_cast<uint64_t>(BF->getHash())) {
+      ++NumStale;
+      if (matchStaleProfile(*BF, YamlBF)) {
+        BF->markProfiled(YamlBP.Header.Flags);
+        ++NumStaleMatched;
+      }
+      continue;
+    }
+    parseFunctionProfile(*BF, YamlBF);
   }
 
+  if (NumStale)
+    outs() << "BOLT-INFO: inferred the profile of " << NumStaleMatched
+           << " out of " << NumStale << " functions with a stale profile\n";
+
   BC.setNumUnusedProfiledObjects(NumUnused);
 
   return Error::success();
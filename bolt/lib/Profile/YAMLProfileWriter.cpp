@@ -9,15 +9,31 @@
 #include "bolt/Profile/YAMLProfileWriter.h"
 #include "bolt/Core/BinaryBasicBlock.h"
 #include "bolt/Core/BinaryFunction.h"
+#include "bolt/Profile/BinaryProfileFormat.h"
 #include "bolt/Profile/ProfileReaderBase.h"
+#include "bolt/Profile/StaleProfileMatching.h"
 #include "bolt/Profile/ProfileYAMLMapping.h"
 #include "bolt/Rewrite/RewriteInstance.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "bolt-prof"
 
+namespace opts {
+
+extern llvm::cl::OptionCategory BoltOutputCategory;
+
+static llvm::cl::opt<bool>
+WriteBinaryProfile("w-binary",
+  llvm::cl::desc("save the profile written with -w in the compact binary "
+                 "format instead of YAML"),
+  llvm::cl::ZeroOrMore,
+  llvm::cl::cat(BoltOutputCategory));
+
+} // namespace opts
+
 namespace llvm {
 namespace bolt {
 
@@ -34,10 +50,14 @@ void convert(const BinaryFunction &BF,
   YamlBF.NumBasicBlocks = BF.size();
   YamlBF.ExecCount = BF.getKnownExecutionCount();
 
+  const DenseMap<const BinaryBasicBlock *, uint64_t> BlockHashes =
+      computeBlockHashes(BF);
+
   for (const BinaryBasicBlock *BB : BF.dfs()) {
     yaml::bolt::BinaryBasicBlockProfile YamlBB;
     YamlBB.Index = BB->getLayoutIndex();
     YamlBB.NumInstructions = BB->getNumNonPseudos();
+    YamlBB.Hash = BlockHashes.lookup(BB);
 
     if (!LBRProfile) {
       YamlBB.EventCount = BB->getKnownExecutionCount();
@@ -196,6 +216,10 @@ std::error_code YAMLProfileWriter::writeProfile(const RewriteInstance &RI) {
   }
 
   // Write the profile.
+  if (opts::WriteBinaryProfile) {
+    BinaryProfileFormat::writeBinaryProfile(*OS, BP);
+    return std::error_code();
+  }
   yaml::Output Out(*OS, nullptr, 0);
   Out << BP;
 
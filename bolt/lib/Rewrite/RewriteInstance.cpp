@@ -3863,7 +3863,23 @@ void RewriteInstance::mapExtraSections(RuntimeDyld &RTDyld) {
 }
 
 void RewriteInstance::updateOutputValues(const MCAsmLayout &Layout) {
-  for (BinaryFunction *Function : BC->getAllBinaryFunctions())
+  NamedRegionTimer T("updateOutputValues", "update output values",
+                     TimerGroupName, TimerGroupDesc, opts::TimeRewrite);
+
+  // The layout of a section is only computed when an offset in it is first
+  // queried. Compute it for all sections so that the functions can then read
+  // their symbol offsets from it in parallel.
+  for (const MCSection *Section : Layout.getSectionOrder())
+    Layout.getSectionAddressSize(Section);
+
+  ParallelUtilities::WorkFuncTy WorkFun = [&](BinaryFunction &BF) {
+    BF.updateOutputValues(Layout);
+  };
+  ParallelUtilities::runOnEachFunction(
+      *BC, ParallelUtilities::SchedulingPolicy::SP_BB_LINEAR, WorkFun,
+      /*SkipPredicate=*/nullptr, "updateOutputValues");
+
+  for (BinaryFunction *Function : BC->getInjectedBinaryFunctions())
     Function->updateOutputValues(Layout);
 }
 
@@ -0,0 +1,100 @@
+# Check that -reorder-data-algo=affinity places data accessed by the same basic
+# block next to each other, and that the data cache metrics show the hot data
+# in fewer cache lines after reordering.
+
+# REQUIRES: system-linux
+
+# RUN: llvm-mc -filetype=obj -triple x86_64-unknown-unknown %s -o %t.o
+# RUN: %clang %cflags -no-pie -nostdlib %t.o -o %t.exe -Wl,-q,-e,main
+# RUN: echo "4 main 0 4 a 0 100" > %t.fdata
+# RUN: echo "4 main 6 4 b 0 10" >> %t.fdata
+# RUN: echo "4 g 0 4 x 0 50" >> %t.fdata
+# RUN: echo "4 g 6 4 y 0 50" >> %t.fdata
+# RUN: llvm-bolt %t.exe -o %t.out -data %t.fdata -reorder-data=.data \
+# RUN:   -reorder-data-algo=affinity -print-reordered-data | FileCheck %s
+# RUN: llvm-nm -n %t.out | FileCheck %s --check-prefix=CHECK-NM
+
+## Ordering by count alone puts the hotter x and y between a and b.
+# RUN: llvm-bolt %t.exe -o %t.count -data %t.fdata -reorder-data=.data \
+# RUN:   -reorder-data-algo=count -print-reordered-data \
+# RUN:   | FileCheck %s --check-prefix=CHECK-COUNT
+
+# CHECK: BOLT-INFO: reorder-sections: ordering data by affinity
+# CHECK-NEXT: BOLT-INFO: Hot global symbols for .data:
+# CHECK-NEXT: BOLT-INFO: (object: a, {{.*}}), moveable=1, weight=3.12500
+# CHECK-NEXT: BOLT-INFO: (object: b, {{.*}}), moveable=1, weight=0.31250
+# CHECK-NEXT: BOLT-INFO: (object: x, {{.*}}), moveable=1, weight=1.56250
+# CHECK-NEXT: BOLT-INFO: (object: y, {{.*}}), moveable=1, weight=1.56250
+# CHECK-NEXT: BOLT-INFO: Total hot symbol size = 128
+# CHECK-NEXT: BOLT-INFO: reorder-data: 210/210 (100.0%) events, 128 hot bytes
+# CHECK-NEXT: BOLT-INFO: cache metrics for the reordered data of .data before reordering:
+# CHECK-NEXT:   Accessed data takes 128 bytes in 3 cache lines (66.67% utilized) and 1 pages
+# CHECK-NEXT:   Average accesses per cache line: 70.0
+# CHECK-NEXT:   Accesses to the 16 hottest pages: 100.00%
+# CHECK-NEXT: BOLT-INFO: cache metrics for the reordered data of .data after reordering:
+# CHECK-NEXT:   Accessed data takes 128 bytes in 2 cache lines (100.00% utilized) and 1 pages
+# CHECK-NEXT:   Average accesses per cache line: 105.0
+# CHECK-NEXT:   Accesses to the 16 hottest pages: 100.00%
+
+# CHECK-NM: {{ D a$}}
+# CHECK-NM: {{ D b$}}
+# CHECK-NM: {{ D x$}}
+# CHECK-NM: {{ D y$}}
+
+# CHECK-COUNT: BOLT-INFO: reorder-sections: ordering data by count
+# CHECK-COUNT-NEXT: BOLT-INFO: Hot global symbols for .data:
+# CHECK-COUNT-NEXT: BOLT-INFO: (object: a, {{.*}})
+# CHECK-COUNT-NEXT: BOLT-INFO: (object: x, {{.*}})
+# CHECK-COUNT-NEXT: BOLT-INFO: (object: y, {{.*}})
+# CHECK-COUNT-NEXT: BOLT-INFO: (object: b, {{.*}})
+
+  .text
+  .globl main
+  .type main, @function
+main:
+  movl a(%rip), %eax
+  addl b(%rip), %eax
+  callq g
+  retq
+  .size main, .-main
+
+  .globl g
+  .type g, @function
+g:
+  movl x(%rip), %eax
+  addl y(%rip), %eax
+  retq
+  .size g, .-g
+
+## The cold z pushes x, y and b out of the cache line of a, into two more.
+  .data
+  .p2align 6
+  .globl a
+  .type a, @object
+a:
+  .zero 32
+  .size a, 32
+
+  .globl z
+  .type z, @object
+z:
+  .zero 64
+  .size z, 64
+
+  .globl x
+  .type x, @object
+x:
+  .zero 32
+  .size x, 32
+
+  .globl y
+  .type y, @object
+y:
+  .zero 32
+  .size y, 32
+
+  .globl b
+  .type b, @object
+b:
+  .zero 32
+  .size b, 32
@@ -10,14 +10,26 @@
 //
 //   $ merge-fdata 1.fdata 2.fdata 3.fdata > merged.fdata
 //
+// Profiles in YAML, or in its binary encoding, are parsed and merged in
+// parallel. The merged profile can be written in either format and merged
+// again with newer profiles:
+//
+//   $ merge-fdata -binary -o merged.bprof merged.bprof 4.yaml 5.yaml
+//
 //===----------------------------------------------------------------------===//
 
+#include "bolt/Profile/BinaryProfileFormat.h"
 #include "bolt/Profile/ProfileYAMLMapping.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include <atomic>
 #include <unordered_map>
 
 using namespace llvm;
@@ -41,6 +53,40 @@ InputDataFilenames(
   cl::OneOrMore,
   cl::cat(MergeFdataCategory));
 
+static cl::opt<bool>
+BinaryOutput("binary",
+  cl::desc("write the merged profile in the compact binary format instead of "
+           "YAML"),
+  cl::init(false),
+  cl::Optional,
+  cl::cat(MergeFdataCategory));
+
+static cl::opt<bool>
+MatchStaleProfiles("match-stale",
+  cl::desc("merge the profile of a function collected on a different build of "
+           "it by matching its basic blocks by hash, instead of failing; the "
+           "first profile of each function, which should be the newest one, "
+           "defines its blocks"),
+  cl::init(false),
+  cl::Optional,
+  cl::cat(MergeFdataCategory));
+
+static cl::opt<unsigned>
+NumThreads("j",
+  cl::desc("number of threads to parse and merge profiles with (0 for all "
+           "hardware threads)"),
+  cl::init(0),
+  cl::Optional,
+  cl::cat(MergeFdataCategory));
+
+static cl::opt<std::string>
+OutputFilename("o",
+  cl::desc("write the merged profile to <file> instead of stdout"),
+  cl::value_desc("file"),
+  cl::init("-"),
+  cl::Optional,
+  cl::cat(MergeFdataCategory));
+
 static cl::opt<SortType>
 PrintFunctionList("print",
   cl::desc("print the list of objects with count to stderr"),
@@ -131,9 +177,12 @@ void mergeBasicBlockProfile(BinaryBasicBlockProfile &MergedBB,
   if (BB.NumInstructions != MergedBB.NumInstructions)
     report_error(BF.Name + " : BB #" + Twine(BB.Index),
                  "number of instructions in block mismatch");
-  if (BB.Hash != MergedBB.Hash)
+  // Profiles written before block hashes were added do not have them.
+  if (BB.Hash && MergedBB.Hash && BB.Hash != MergedBB.Hash)
     report_error(BF.Name + " : BB #" + Twine(BB.Index),
                  "basic block hash mismatch");
+  if (!MergedBB.Hash)
+    MergedBB.Hash = BB.Hash;
 
   // Update the execution count.
   MergedBB.ExecCount += BB.ExecCount;
@@ -186,8 +235,105 @@ void mergeBasicBlockProfile(BinaryBasicBlockProfile &MergedBB,
       MergedBB.Successors.emplace_back(std::move(*SI));
 }
 
+/// Statistics of the profiles merged with mergeStaleFunctionProfile().
+struct {
+  std::atomic<uint64_t> NumFunctions{0};
+  std::atomic<uint64_t> NumMatchedBlocks{0};
+  std::atomic<uint64_t> NumDroppedBlocks{0};
+} StaleStats;
+
+/// Merge the profile \p BF, collected on a different build of the function
+/// than \p MergedBF, into it. If the function has the same CFG in both builds,
+/// the blocks are matched by index, and otherwise by hash, and only if the
+/// hash is unique in both profiles. The call sites of \p BF are dropped since
+/// their destinations are numbered as in the other build.
+void mergeStaleFunctionProfile(BinaryFunctionProfile &MergedBF,
+                               BinaryFunctionProfile &&BF) {
+  ++StaleStats.NumFunctions;
+  const bool SameCFG = BF.Hash == MergedBF.Hash &&
+                       BF.NumBasicBlocks == MergedBF.NumBasicBlocks;
+
+  std::unordered_map<uint64_t, unsigned> HashCount;
+  for (const BinaryBasicBlockProfile &BB : BF.Blocks)
+    ++HashCount[BB.Hash];
+  std::unordered_map<uint64_t, BinaryBasicBlockProfile *> MergedBlockByKey;
+  for (BinaryBasicBlockProfile &MergedBB : MergedBF.Blocks) {
+    const uint64_t Key =
+        SameCFG ? uint64_t(MergedBB.Index) : uint64_t(MergedBB.Hash);
+    auto It = MergedBlockByKey.emplace(Key, &MergedBB);
+    if (!It.second)
+      It.first->second = nullptr;
+  }
+
+  // Map the indices of the blocks of BF to those of MergedBF.
+  std::unordered_map<uint32_t, uint32_t> IndexMap;
+  std::vector<std::pair<BinaryBasicBlockProfile *, BinaryBasicBlockProfile *>>
+      Matches;
+  std::vector<BinaryBasicBlockProfile *> NewBlocks;
+  for (BinaryBasicBlockProfile &BB : BF.Blocks) {
+    if (SameCFG) {
+      IndexMap[BB.Index] = BB.Index;
+      auto It = MergedBlockByKey.find(BB.Index);
+      if (It == MergedBlockByKey.end())
+        NewBlocks.push_back(&BB);
+      else
+        Matches.emplace_back(It->second, &BB);
+      continue;
+    }
+    auto It = MergedBlockByKey.find(BB.Hash);
+    if (!BB.Hash || HashCount[BB.Hash] != 1 || It == MergedBlockByKey.end() ||
+        !It->second) {
+      ++StaleStats.NumDroppedBlocks;
+      continue;
+    }
+    IndexMap[BB.Index] = It->second->Index;
+    Matches.emplace_back(It->second, &BB);
+  }
+  StaleStats.NumMatchedBlocks += Matches.size() + NewBlocks.size();
+
+  auto remapSuccessors = [&](BinaryBasicBlockProfile &MergedBB,
+                             const BinaryBasicBlockProfile &BB) {
+    for (const SuccessorInfo &SI : BB.Successors) {
+      auto It = IndexMap.find(SI.Index);
+      if (It == IndexMap.end())
+        continue;
+      auto MergedSI = llvm::find_if(MergedBB.Successors,
+                                    [&](const SuccessorInfo &MergedSI) {
+                                      return MergedSI.Index == It->second;
+                                    });
+      if (MergedSI == MergedBB.Successors.end()) {
+        MergedBB.Successors.emplace_back(SI);
+        MergedBB.Successors.back().Index = It->second;
+        continue;
+      }
+      MergedSI->Count += SI.Count;
+      MergedSI->Mispreds += SI.Mispreds;
+    }
+  };
+  for (auto &Match : Matches) {
+    BinaryBasicBlockProfile &MergedBB = *Match.first;
+    BinaryBasicBlockProfile &BB = *Match.second;
+    MergedBB.ExecCount += BB.ExecCount;
+    MergedBB.EventCount += BB.EventCount;
+    remapSuccessors(MergedBB, BB);
+  }
+  for (BinaryBasicBlockProfile *BB : NewBlocks) {
+    BB->CallSites.clear();
+    MergedBF.Blocks.emplace_back(std::move(*BB));
+  }
+
+  MergedBF.ExecCount += BF.ExecCount;
+}
+
 void mergeFunctionProfile(BinaryFunctionProfile &MergedBF,
                           BinaryFunctionProfile &&BF) {
+  if (opts::MatchStaleProfiles &&
+      (BF.NumBasicBlocks != MergedBF.NumBasicBlocks ||
+       BF.Id != MergedBF.Id || BF.Hash != MergedBF.Hash)) {
+    mergeStaleFunctionProfile(MergedBF, std::move(BF));
+    return;
+  }
+
   // Validate that we are merging the correct function.
   if (BF.NumBasicBlocks != MergedBF.NumBasicBlocks)
     report_error(BF.Name, "number of basic blocks mismatch");
@@ -224,17 +370,56 @@ void mergeFunctionProfile(BinaryFunctionProfile &MergedBF,
       MergedBF.Blocks.emplace_back(std::move(*BB));
 }
 
+/// Check if \p Filename holds a profile in YAML or in its binary encoding.
 bool isYAML(const StringRef Filename) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
       MemoryBuffer::getFileOrSTDIN(Filename);
   if (std::error_code EC = MB.getError())
     report_error(Filename, EC);
   StringRef Buffer = MB.get()->getBuffer();
-  if (Buffer.startswith("---\n"))
+  if (Buffer.startswith("---\n") ||
+      bolt::BinaryProfileFormat::isBinaryProfile(Buffer))
     return true;
   return false;
 }
 
+/// A parsed profile, with the hash of the name of each of its functions.
+struct InputProfile {
+  BinaryProfile BP;
+  std::vector<uint64_t> NameHashes;
+  /// Why the profile could not be read, if it could not.
+  std::string ErrorMessage;
+};
+
+/// Read the profile in YAML or in the binary format in \p Filename.
+void readProfile(StringRef Filename, InputProfile &Input) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+      MemoryBuffer::getFileOrSTDIN(Filename);
+  if (std::error_code EC = MB.getError()) {
+    Input.ErrorMessage = EC.message();
+    return;
+  }
+  StringRef Buffer = MB.get()->getBuffer();
+
+  if (bolt::BinaryProfileFormat::isBinaryProfile(Buffer)) {
+    if (Error E = bolt::BinaryProfileFormat::readBinaryProfile(
+            Buffer, Input.BP, &Input.NameHashes))
+      Input.ErrorMessage = toString(std::move(E));
+    return;
+  }
+
+  yaml::Input YamlInput(Buffer);
+  YamlInput >> Input.BP;
+  if (YamlInput.error()) {
+    Input.ErrorMessage = YamlInput.error().message();
+    return;
+  }
+  Input.NameHashes.reserve(Input.BP.Functions.size());
+  for (const BinaryFunctionProfile &BF : Input.BP.Functions)
+    Input.NameHashes.push_back(
+        bolt::BinaryProfileFormat::getNameHash(BF.Name));
+}
+
 void mergeLegacyProfiles(const cl::list<std::string> &Filenames) {
   errs() << "Using legacy profile format.\n";
   bool BoltedCollection = false;
@@ -309,28 +494,28 @@ int main(int argc, char **argv) {
     return 0;
   }
 
+  parallel::strategy = hardware_concurrency(opts::NumThreads);
+
+  // Parse the profiles in parallel.
+  const size_t NumInputs = opts::InputDataFilenames.size();
+  std::vector<InputProfile> Inputs(NumInputs);
+  parallelForEachN(0, NumInputs, [&](size_t I) {
+    readProfile(opts::InputDataFilenames[I], Inputs[I]);
+  });
+
   // Merged header.
   BinaryProfileHeader MergedHeader;
   MergedHeader.Version = 1;
 
-  // Merged information for all functions.
-  StringMap<BinaryFunctionProfile> MergedBFs;
-
-  for (std::string &InputDataFilename : opts::InputDataFilenames) {
-    ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
-        MemoryBuffer::getFileOrSTDIN(InputDataFilename);
-    if (std::error_code EC = MB.getError())
-      report_error(InputDataFilename, EC);
-    yaml::Input YamlInput(MB.get()->getBuffer());
+  for (size_t I = 0; I != NumInputs; ++I) {
+    const std::string &InputDataFilename = opts::InputDataFilenames[I];
+    if (!Inputs[I].ErrorMessage.empty())
+      report_error(InputDataFilename, Inputs[I].ErrorMessage);
 
     errs() << "Merging data from " << InputDataFilename << "...\n";
 
-    BinaryProfile BP;
-    YamlInput >> BP;
-    if (YamlInput.error())
-      report_error(InputDataFilename, YamlInput.error());
-
     // Sanity check.
+    const BinaryProfile &BP = Inputs[I].BP;
     if (BP.Header.Version != 1) {
       errs() << "Unable to merge data from profile using version "
              << BP.Header.Version << '\n';
@@ -339,37 +524,78 @@ int main(int argc, char **argv) {
 
     // Merge the header.
     mergeProfileHeaders(MergedHeader, BP.Header);
+  }
 
-    // Do the function merge.
-    for (BinaryFunctionProfile &BF : BP.Functions) {
-      if (!MergedBFs.count(BF.Name)) {
-        MergedBFs.insert(std::make_pair(BF.Name, BF));
-        continue;
+  // Do the function merge, in shards of the functions with the same name hash
+  // modulo NumShards. Each shard goes through the inputs in order, so that the
+  // result does not depend on the number of threads.
+  const unsigned NumShards = 256;
+  std::vector<std::vector<std::vector<uint32_t>>> ShardFunctions(NumInputs);
+  parallelForEachN(0, NumInputs, [&](size_t I) {
+    ShardFunctions[I].resize(NumShards);
+    for (uint32_t F = 0, E = Inputs[I].NameHashes.size(); F != E; ++F)
+      ShardFunctions[I][Inputs[I].NameHashes[F] % NumShards].push_back(F);
+  });
+
+  std::vector<std::vector<BinaryFunctionProfile>> MergedShards(NumShards);
+  parallelForEachN(0, NumShards, [&](size_t S) {
+    std::vector<BinaryFunctionProfile> &MergedBFs = MergedShards[S];
+    std::unordered_map<uint64_t, size_t> MergedBFByHash;
+    for (size_t I = 0; I != NumInputs; ++I) {
+      for (uint32_t F : ShardFunctions[I][S]) {
+        BinaryFunctionProfile &BF = Inputs[I].BP.Functions[F];
+        auto It =
+            MergedBFByHash.emplace(Inputs[I].NameHashes[F], MergedBFs.size());
+        if (It.second) {
+          MergedBFs.emplace_back(std::move(BF));
+          continue;
+        }
+
+        BinaryFunctionProfile &MergedBF = MergedBFs[It.first->second];
+        if (MergedBF.Name != BF.Name)
+          report_error(BF.Name, "name hash collides with " + MergedBF.Name);
+        mergeFunctionProfile(MergedBF, std::move(BF));
       }
-
-      BinaryFunctionProfile &MergedBF = MergedBFs.find(BF.Name)->second;
-      mergeFunctionProfile(MergedBF, std::move(BF));
     }
-  }
+  });
+
+  BinaryProfile MergedProfile;
+  MergedProfile.Header = MergedHeader;
+  for (std::vector<BinaryFunctionProfile> &MergedBFs : MergedShards)
+    for (BinaryFunctionProfile &BF : MergedBFs)
+      MergedProfile.Functions.emplace_back(std::move(BF));
+
+  // For consistency, sort functions by their IDs.
+  llvm::sort(MergedProfile.Functions, [](const BinaryFunctionProfile &A,
+                                         const BinaryFunctionProfile &B) {
+    return std::tie(A.Id, A.Name) < std::tie(B.Id, B.Name);
+  });
+  const std::vector<BinaryFunctionProfile> &MergedBFs =
+      MergedProfile.Functions;
 
   if (!opts::SuppressMergedDataOutput) {
-    yaml::Output YamlOut(outs());
-
-    BinaryProfile MergedProfile;
-    MergedProfile.Header = MergedHeader;
-    MergedProfile.Functions.resize(MergedBFs.size());
-    std::transform(
-        MergedBFs.begin(), MergedBFs.end(), MergedProfile.Functions.begin(),
-        [](StringMapEntry<BinaryFunctionProfile> &V) { return V.second; });
-
-    // For consistency, sort functions by their IDs.
-    std::sort(MergedProfile.Functions.begin(), MergedProfile.Functions.end(),
-              [](const BinaryFunctionProfile &A,
-                 const BinaryFunctionProfile &B) { return A.Id < B.Id; });
-
-    YamlOut << MergedProfile;
+    std::error_code EC;
+    ToolOutputFile Out(opts::OutputFilename, EC,
+                       opts::BinaryOutput ? sys::fs::OF_None
+                                          : sys::fs::OF_Text);
+    if (EC)
+      report_error(opts::OutputFilename, EC);
+
+    if (opts::BinaryOutput) {
+      bolt::BinaryProfileFormat::writeBinaryProfile(Out.os(), MergedProfile);
+    } else {
+      yaml::Output YamlOut(Out.os());
+      YamlOut << MergedProfile;
+    }
+    Out.keep();
   }
 
+  if (StaleStats.NumFunctions)
+    errs() << "Profiles of " << StaleStats.NumFunctions
+           << " stale functions merged: " << StaleStats.NumMatchedBlocks
+           << " blocks matched, " << StaleStats.NumDroppedBlocks
+           << " dropped.\n";
+
   errs() << "Data for " << MergedBFs.size()
          << " unique objects successfully merged.\n";
 
@@ -377,20 +603,18 @@ int main(int argc, char **argv) {
     // List of function names with execution count.
     std::vector<std::pair<uint64_t, StringRef>> FunctionList(MergedBFs.size());
     using CountFuncType = std::function<std::pair<uint64_t, StringRef>(
-        const StringMapEntry<BinaryFunctionProfile> &)>;
-    CountFuncType ExecCountFunc =
-        [](const StringMapEntry<BinaryFunctionProfile> &V) {
-          return std::make_pair(V.second.ExecCount, StringRef(V.second.Name));
-        };
-    CountFuncType BranchCountFunc =
-        [](const StringMapEntry<BinaryFunctionProfile> &V) {
-          // Return total branch count.
-          uint64_t BranchCount = 0;
-          for (const BinaryBasicBlockProfile &BI : V.second.Blocks)
-            for (const SuccessorInfo &SI : BI.Successors)
-              BranchCount += SI.Count;
-          return std::make_pair(BranchCount, StringRef(V.second.Name));
-        };
+        const BinaryFunctionProfile &)>;
+    CountFuncType ExecCountFunc = [](const BinaryFunctionProfile &V) {
+      return std::make_pair(V.ExecCount, StringRef(V.Name));
+    };
+    CountFuncType BranchCountFunc = [](const BinaryFunctionProfile &V) {
+      // Return total branch count.
+      uint64_t BranchCount = 0;
+      for (const BinaryBasicBlockProfile &BI : V.Blocks)
+        for (const SuccessorInfo &SI : BI.Successors)
+          BranchCount += SI.Count;
+      return std::make_pair(BranchCount, StringRef(V.Name));
+    };
 
     CountFuncType CountFunc = (opts::PrintFunctionList == opts::ST_EXEC_COUNT)
                                   ? ExecCountFunc
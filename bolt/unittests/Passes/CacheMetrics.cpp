@@ -0,0 +1,73 @@
+//===- bolt/unittest/Passes/CacheMetrics.cpp ------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "bolt/Passes/CacheMetrics.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace bolt;
+
+namespace {
+
+using DataObjectAccess = CacheMetrics::DataObjectAccess;
+
+std::string captureDataMetrics(const std::vector<DataObjectAccess> &Objects) {
+  testing::internal::CaptureStdout();
+  CacheMetrics::printDataMetrics(Objects);
+  outs().flush();
+  return testing::internal::GetCapturedStdout();
+}
+
+} // namespace
+
+TEST(CacheMetricsTest, PackedDataTakesFewerCacheLines) {
+  EXPECT_EQ(captureDataMetrics({{0, 16, 10}, {64, 16, 10}, {128, 16, 10},
+                                {192, 16, 10}}),
+            "  Accessed data takes 64 bytes in 4 cache lines (25.00% utilized) "
+            "and 1 pages\n"
+            "  Average accesses per cache line: 10.0\n"
+            "  Accesses to the 16 hottest pages: 100.00%\n");
+  EXPECT_EQ(captureDataMetrics({{0, 16, 10}, {16, 16, 10}, {32, 16, 10},
+                                {48, 16, 10}}),
+            "  Accessed data takes 64 bytes in 1 cache lines (100.00% "
+            "utilized) and 1 pages\n"
+            "  Average accesses per cache line: 40.0\n"
+            "  Accesses to the 16 hottest pages: 100.00%\n");
+}
+
+TEST(CacheMetricsTest, ObjectSpansCacheLines) {
+  EXPECT_EQ(captureDataMetrics({{32, 64, 10}}),
+            "  Accessed data takes 64 bytes in 2 cache lines (50.00% utilized) "
+            "and 1 pages\n"
+            "  Average accesses per cache line: 5.0\n"
+            "  Accesses to the 16 hottest pages: 100.00%\n");
+}
+
+TEST(CacheMetricsTest, CountsHottestPages) {
+  // One access to each of 17 pages, one more than the d-TLB holds, except for
+  // the first page, which has two.
+  std::vector<DataObjectAccess> Objects;
+  for (uint64_t I = 0; I != 17; ++I)
+    Objects.push_back({I * 4096, 64, I ? 1u : 2u});
+  EXPECT_EQ(captureDataMetrics(Objects),
+            "  Accessed data takes 1088 bytes in 17 cache lines (100.00% "
+            "utilized) and 17 pages\n"
+            "  Average accesses per cache line: 1.1\n"
+            "  Accesses to the 16 hottest pages: 94.44%\n");
+}
+
+TEST(CacheMetricsTest, IgnoresUnaccessedData) {
+  EXPECT_EQ(captureDataMetrics({}), "");
+  EXPECT_EQ(captureDataMetrics({{0, 64, 0}, {64, 0, 10}}), "");
+  EXPECT_EQ(captureDataMetrics({{0, 64, 0}, {128, 32, 4}}),
+            "  Accessed data takes 32 bytes in 1 cache lines (50.00% utilized) "
+            "and 1 pages\n"
+            "  Average accesses per cache line: 4.0\n"
+            "  Accesses to the 16 hottest pages: 100.00%\n");
+}
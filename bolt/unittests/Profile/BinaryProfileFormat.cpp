@@ -0,0 +1,144 @@
+//===- bolt/unittest/Profile/BinaryProfileFormat.cpp ----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "bolt/Profile/BinaryProfileFormat.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace bolt;
+
+namespace {
+
+// Block indices, call site offsets and successors go both up and down, so that
+// the deltas are both positive and negative.
+const char *const ProfileYAML = R"(---
+header:
+  profile-version: 1
+  binary-name:     'a.out'
+  binary-build-id: '0123456789abcdef'
+  profile-flags:   [ lbr ]
+  profile-origin:  branch profile reader
+  profile-events:  ''
+functions:
+  - name:    main
+    fid:     7
+    hash:    0xFEDCBA9876543210
+    exec:    100
+    nblocks: 4
+    blocks:
+      - bid:   0
+        insns: 5
+        hash:  0x1234
+        exec:  100
+        calls: [ { off: 0x10, fid: 3, cnt: 90, mis: 2 },
+                 { off: 0x4, fid: 3, disc: 1, cnt: 10 } ]
+        succ:  [ { bid: 3, cnt: 60, mis: 5 }, { bid: 1, cnt: 40 } ]
+      - bid:   3
+        insns: 1
+        exec:  60
+        events: 12
+      - bid:   1
+        insns: 2
+        exec:  40
+        succ:  [ { bid: 3, cnt: 40 } ]
+  - name:    _Z3fooi
+    fid:     3
+    hash:    0x0
+    exec:    100
+    nblocks: 1
+...
+)";
+
+std::string toYAML(yaml::bolt::BinaryProfile &BP) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  yaml::Output YamlOut(OS);
+  YamlOut << BP;
+  return OS.str();
+}
+
+std::string writeBinary(const yaml::bolt::BinaryProfile &BP) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  BinaryProfileFormat::writeBinaryProfile(OS, BP);
+  return OS.str();
+}
+
+class BinaryProfileFormatTest : public testing::Test {
+protected:
+  void SetUp() override {
+    yaml::Input YamlIn(ProfileYAML);
+    YamlIn >> BP;
+    ASSERT_FALSE(YamlIn.error());
+    ASSERT_EQ(BP.Functions.size(), 2u);
+  }
+
+  yaml::bolt::BinaryProfile BP;
+};
+
+} // namespace
+
+TEST_F(BinaryProfileFormatTest, RoundTrip) {
+  const std::string Binary = writeBinary(BP);
+  ASSERT_TRUE(BinaryProfileFormat::isBinaryProfile(Binary));
+
+  yaml::bolt::BinaryProfile Read;
+  std::vector<uint64_t> NameHashes;
+  ASSERT_THAT_ERROR(
+      BinaryProfileFormat::readBinaryProfile(Binary, Read, &NameHashes),
+      Succeeded());
+  EXPECT_EQ(toYAML(Read), toYAML(BP));
+  ASSERT_EQ(NameHashes.size(), 2u);
+  EXPECT_EQ(NameHashes[0], BinaryProfileFormat::getNameHash("main"));
+  EXPECT_EQ(NameHashes[1], BinaryProfileFormat::getNameHash("_Z3fooi"));
+
+  // Writing the profile that was read gives the same bytes.
+  EXPECT_EQ(writeBinary(Read), Binary);
+}
+
+TEST_F(BinaryProfileFormatTest, RejectsNonBinaryProfile) {
+  yaml::bolt::BinaryProfile Read;
+  EXPECT_FALSE(BinaryProfileFormat::isBinaryProfile(ProfileYAML));
+  EXPECT_THAT_ERROR(BinaryProfileFormat::readBinaryProfile(ProfileYAML, Read),
+                    Failed());
+}
+
+TEST_F(BinaryProfileFormatTest, RejectsTruncatedProfile) {
+  const std::string Binary = writeBinary(BP);
+  // Every proper prefix that still has the magic is either cut in the middle
+  // of a field or misses some of the functions, blocks or edges it announces.
+  const size_t MagicSize = sizeof(BinaryProfileFormat::Magic) - 1;
+  for (size_t Size = MagicSize; Size != Binary.size(); ++Size) {
+    yaml::bolt::BinaryProfile Read;
+    StringRef Truncated = StringRef(Binary).take_front(Size);
+    EXPECT_THAT_ERROR(BinaryProfileFormat::readBinaryProfile(Truncated, Read),
+                      Failed())
+        << "truncated to " << Size << " bytes";
+  }
+}
+
+TEST_F(BinaryProfileFormatTest, RejectsUnsupportedVersion) {
+  std::string Binary;
+  raw_string_ostream OS(Binary);
+  OS << StringRef(BinaryProfileFormat::Magic,
+                  sizeof(BinaryProfileFormat::Magic) - 1);
+  encodeULEB128(BinaryProfileFormat::Version + 1, OS);
+  OS.str();
+  // The rest of a valid profile follows, so only the version is wrong.
+  Binary += writeBinary(BP).substr(Binary.size());
+
+  yaml::bolt::BinaryProfile Read;
+  Error E = BinaryProfileFormat::readBinaryProfile(Binary, Read);
+  ASSERT_TRUE(bool(E));
+  EXPECT_EQ(errorToErrorCode(std::move(E)),
+            std::make_error_code(std::errc::not_supported));
+}
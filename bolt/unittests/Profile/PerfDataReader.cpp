@@ -0,0 +1,316 @@
+//===- bolt/unittest/Profile/PerfDataReader.cpp ---------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "bolt/Profile/PerfDataReader.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace bolt;
+
+namespace {
+
+const uint64_t SampleIP = 1 << 0;
+const uint64_t SampleTID = 1 << 1;
+const uint64_t SampleTime = 1 << 2;
+const uint64_t SampleBranchStack = 1 << 11;
+const uint64_t SampleIDAll = 1ULL << 18;
+
+/// Builds a perf.data file with a single event that samples the IP, TID, time
+/// and branch stack, and records sample IDs with all of its other records.
+class PerfDataBuilder {
+public:
+  void addMMap2(uint32_t PID, uint64_t Address, uint64_t Size, uint64_t Offset,
+                uint64_t TimeNs, StringRef FileName) {
+    std::string Body;
+    raw_string_ostream OS(Body);
+    support::endian::Writer W(OS, support::little);
+    W.write<uint32_t>(PID);
+    W.write<uint32_t>(PID);
+    W.write<uint64_t>(Address);
+    W.write<uint64_t>(Size);
+    W.write<uint64_t>(Offset);
+    // Device, inode, prot and flags.
+    OS.write_zeros(32);
+    writePadded(OS, FileName);
+    writeSampleID(W, PID, TimeNs);
+    addRecord(/*PERF_RECORD_MMAP2*/ 10, 0, Body);
+  }
+
+  void addFork(uint32_t PID, uint32_t ParentPID, uint64_t TimeNs) {
+    std::string Body;
+    raw_string_ostream OS(Body);
+    support::endian::Writer W(OS, support::little);
+    W.write<uint32_t>(PID);
+    W.write<uint32_t>(ParentPID);
+    W.write<uint32_t>(PID);
+    W.write<uint32_t>(ParentPID);
+    W.write<uint64_t>(TimeNs);
+    writeSampleID(W, PID, TimeNs);
+    addRecord(/*PERF_RECORD_FORK*/ 7, 0, Body);
+  }
+
+  void addComm(uint32_t PID, StringRef Comm, bool Exec, uint64_t TimeNs) {
+    std::string Body;
+    raw_string_ostream OS(Body);
+    support::endian::Writer W(OS, support::little);
+    W.write<uint32_t>(PID);
+    W.write<uint32_t>(PID);
+    writePadded(OS, Comm);
+    writeSampleID(W, PID, TimeNs);
+    addRecord(/*PERF_RECORD_COMM*/ 3, Exec ? 1 << 13 : 0, Body);
+  }
+
+  void addSample(uint32_t PID, uint64_t PC, ArrayRef<LBREntry> LBR) {
+    std::string Body;
+    raw_string_ostream OS(Body);
+    support::endian::Writer W(OS, support::little);
+    W.write<uint64_t>(PC);
+    W.write<uint32_t>(PID);
+    W.write<uint32_t>(PID);
+    W.write<uint64_t>(0);
+    W.write<uint64_t>(LBR.size());
+    for (const LBREntry &Entry : LBR) {
+      W.write<uint64_t>(Entry.From);
+      W.write<uint64_t>(Entry.To);
+      W.write<uint64_t>(Entry.Mispred);
+    }
+    addRecord(/*PERF_RECORD_SAMPLE*/ 9, 0, Body);
+  }
+
+  void addBuildID(uint32_t PID, StringRef ID, StringRef FileName) {
+    std::string Body;
+    raw_string_ostream OS(Body);
+    support::endian::Writer W(OS, support::little);
+    W.write<uint32_t>(PID);
+    OS << ID;
+    OS.write_zeros(20 - ID.size());
+    OS << char(ID.size());
+    OS.write_zeros(3);
+    writePadded(OS, FileName);
+    std::string Record;
+    raw_string_ostream ROS(Record);
+    support::endian::Writer RW(ROS, support::little);
+    RW.write<uint32_t>(0);
+    // PERF_RECORD_MISC_BUILD_ID_SIZE.
+    RW.write<uint16_t>(1 << 15);
+    RW.write<uint16_t>(8 + Body.size());
+    ROS << Body;
+    BuildIDs += Record;
+  }
+
+  /// Write the file to \p Path.
+  void write(StringRef Path, bool BigEndian = false) {
+    const uint64_t HeaderSize = 104;
+    const uint64_t AttrSize = 128 + 16;
+    const uint64_t DataOffset = HeaderSize + AttrSize;
+    const uint64_t FeatureOffset = DataOffset + Data.size();
+
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, sys::fs::OF_None);
+    ASSERT_FALSE(EC);
+    support::endian::Writer W(OS,
+                              BigEndian ? support::big : support::little);
+    W.write<uint64_t>(0x32454c4946524550ULL);
+    W.write<uint64_t>(HeaderSize);
+    W.write<uint64_t>(AttrSize);
+    W.write<uint64_t>(HeaderSize);
+    W.write<uint64_t>(AttrSize);
+    W.write<uint64_t>(DataOffset);
+    W.write<uint64_t>(Data.size());
+    // The event types section.
+    OS.write_zeros(16);
+    // The features bitmap, with HEADER_BUILD_ID set if there are build-ids.
+    W.write<uint64_t>(BuildIDs.empty() ? 0 : 1 << 2);
+    OS.write_zeros(24);
+
+    // The perf_event_attr, then the empty section of its IDs.
+    W.write<uint32_t>(0);
+    W.write<uint32_t>(128);
+    OS.write_zeros(16);
+    W.write<uint64_t>(SampleIP | SampleTID | SampleTime | SampleBranchStack);
+    W.write<uint64_t>(0);
+    W.write<uint64_t>(SampleIDAll);
+    OS.write_zeros(24);
+    W.write<uint64_t>(0);
+    OS.write_zeros(128 - 80);
+    OS.write_zeros(16);
+
+    OS << Data;
+    if (!BuildIDs.empty()) {
+      W.write<uint64_t>(FeatureOffset + 16);
+      W.write<uint64_t>(BuildIDs.size());
+      OS << BuildIDs;
+    }
+  }
+
+private:
+  std::string Data;
+  std::string BuildIDs;
+
+  static void writePadded(raw_ostream &OS, StringRef S) {
+    OS << S;
+    OS.write_zeros(8 - S.size() % 8);
+  }
+
+  static void writeSampleID(support::endian::Writer &W, uint32_t PID,
+                            uint64_t TimeNs) {
+    W.write<uint32_t>(PID);
+    W.write<uint32_t>(PID);
+    W.write<uint64_t>(TimeNs);
+  }
+
+  void addRecord(uint32_t Type, uint16_t Misc, StringRef Body) {
+    raw_string_ostream OS(Data);
+    support::endian::Writer W(OS, support::little);
+    W.write<uint32_t>(Type);
+    W.write<uint16_t>(Misc);
+    W.write<uint16_t>(8 + Body.size());
+    OS << Body;
+  }
+};
+
+struct PerfDataReaderTest : public testing::Test {
+  void SetUp() override {
+    ASSERT_FALSE(
+        sys::fs::createTemporaryFile("PerfDataReaderTest", "data", Path));
+    Remover.setFile(Path);
+  }
+
+  SmallString<128> Path;
+  FileRemover Remover;
+};
+
+TEST_F(PerfDataReaderTest, ReadsRecords) {
+  PerfDataBuilder B;
+  B.addComm(100, "bench", /*Exec=*/true, 1000000);
+  B.addComm(100, "bench-thread", /*Exec=*/false, 1500000);
+  B.addMMap2(100, 0x400000, 0x2000, 0x1000, 2000000, "/usr/bin/bench");
+  B.addFork(101, 100, 3000000);
+  B.addSample(100, 0x401000,
+              {{0x401010, 0x401100, true}, {0x401200, 0x401004, false}});
+  B.addSample(101, 0x401020, {});
+  B.addBuildID(100, "\x01\x23\x45\x67\x89\xab", "/usr/bin/bench");
+  B.write(Path);
+
+  auto ReaderOrErr = PerfDataReader::create(Path, /*ChunkSize=*/1 << 24,
+                                            /*MaxSamples=*/-1ULL);
+  ASSERT_TRUE(!!ReaderOrErr) << toString(ReaderOrErr.takeError());
+  PerfDataReader &Reader = **ReaderOrErr;
+
+  ASSERT_EQ(Reader.getMMapEvents().size(), 1u);
+  const PerfDataReader::MMapEvent &MMap = Reader.getMMapEvents()[0];
+  EXPECT_EQ(MMap.PID, 100);
+  EXPECT_EQ(MMap.Address, 0x400000u);
+  EXPECT_EQ(MMap.Size, 0x2000u);
+  EXPECT_EQ(MMap.Offset, 0x1000u);
+  EXPECT_EQ(MMap.Time, 2000u);
+  EXPECT_EQ(MMap.FileName, "/usr/bin/bench");
+
+  // The COMM record that is not for an execve is skipped.
+  ASSERT_EQ(Reader.getTaskEvents().size(), 2u);
+  const PerfDataReader::TaskEvent &Exec = Reader.getTaskEvents()[0];
+  EXPECT_EQ(Exec.Type, PerfDataReader::TaskEvent::COMM_EXEC);
+  EXPECT_EQ(Exec.PID, 100);
+  EXPECT_EQ(Exec.Time, 1000u);
+  const PerfDataReader::TaskEvent &Fork = Reader.getTaskEvents()[1];
+  EXPECT_EQ(Fork.Type, PerfDataReader::TaskEvent::FORK);
+  EXPECT_EQ(Fork.PID, 101);
+  EXPECT_EQ(Fork.ParentPID, 100);
+  EXPECT_EQ(Fork.Time, 3000u);
+
+  ASSERT_EQ(Reader.getBuildIDs().size(), 1u);
+  EXPECT_EQ(Reader.getBuildIDs()[0].BuildID, "0123456789ab");
+  EXPECT_EQ(Reader.getBuildIDs()[0].FileName, "/usr/bin/bench");
+
+  EXPECT_EQ(Reader.getNumSamples(), 2u);
+  ASSERT_EQ(Reader.getSampleChunks().size(), 1u);
+  std::vector<PerfDataReader::Sample> Samples;
+  std::vector<std::vector<LBREntry>> LBRs;
+  ASSERT_FALSE(errorToBool(Reader.forEachSample(
+      Reader.getSampleChunks()[0], [&](const PerfDataReader::Sample &S) {
+        Samples.push_back(S);
+        LBRs.emplace_back(S.LBR.begin(), S.LBR.end());
+      })));
+  ASSERT_EQ(Samples.size(), 2u);
+  EXPECT_EQ(Samples[0].PID, 100);
+  EXPECT_EQ(Samples[0].PC, 0x401000u);
+  ASSERT_EQ(LBRs[0].size(), 2u);
+  EXPECT_EQ(LBRs[0][0].From, 0x401010u);
+  EXPECT_EQ(LBRs[0][0].To, 0x401100u);
+  EXPECT_TRUE(LBRs[0][0].Mispred);
+  EXPECT_EQ(LBRs[0][1].From, 0x401200u);
+  EXPECT_EQ(LBRs[0][1].To, 0x401004u);
+  EXPECT_FALSE(LBRs[0][1].Mispred);
+  EXPECT_EQ(Samples[1].PID, 101);
+  EXPECT_EQ(Samples[1].PC, 0x401020u);
+  EXPECT_TRUE(LBRs[1].empty());
+}
+
+TEST_F(PerfDataReaderTest, SplitsSamplesIntoChunks) {
+  PerfDataBuilder B;
+  B.addMMap2(100, 0x400000, 0x2000, 0, 0, "/usr/bin/bench");
+  for (uint64_t I = 0; I != 10; ++I)
+    B.addSample(100, 0x401000 + I, {{0x401000 + I, 0x402000, false}});
+  B.write(Path);
+
+  // Chunks of one record each: the memory map record has no samples and does
+  // not make a chunk.
+  auto ReaderOrErr = PerfDataReader::create(Path, /*ChunkSize=*/1,
+                                            /*MaxSamples=*/-1ULL);
+  ASSERT_TRUE(!!ReaderOrErr) << toString(ReaderOrErr.takeError());
+  PerfDataReader &Reader = **ReaderOrErr;
+  EXPECT_EQ(Reader.getNumSamples(), 10u);
+  ASSERT_EQ(Reader.getSampleChunks().size(), 10u);
+  for (uint64_t I = 0; I != 10; ++I) {
+    std::vector<uint64_t> PCs;
+    ASSERT_FALSE(errorToBool(Reader.forEachSample(
+        Reader.getSampleChunks()[I],
+        [&](const PerfDataReader::Sample &S) { PCs.push_back(S.PC); })));
+    EXPECT_EQ(PCs, std::vector<uint64_t>{0x401000 + I});
+  }
+
+  // Only the first samples are read.
+  ReaderOrErr = PerfDataReader::create(Path, /*ChunkSize=*/1 << 24,
+                                       /*MaxSamples=*/4);
+  ASSERT_TRUE(!!ReaderOrErr) << toString(ReaderOrErr.takeError());
+  EXPECT_EQ((*ReaderOrErr)->getNumSamples(), 4u);
+  ASSERT_EQ((*ReaderOrErr)->getSampleChunks().size(), 1u);
+  unsigned NumSamples = 0;
+  ASSERT_FALSE(errorToBool((*ReaderOrErr)->forEachSample(
+      (*ReaderOrErr)->getSampleChunks()[0],
+      [&](const PerfDataReader::Sample &) { ++NumSamples; })));
+  EXPECT_EQ(NumSamples, 4u);
+}
+
+TEST_F(PerfDataReaderTest, RejectsUnsupportedFiles) {
+  PerfDataBuilder B;
+  B.addSample(100, 0x401000, {});
+  B.write(Path, /*BigEndian=*/true);
+  auto ReaderOrErr = PerfDataReader::create(Path, 1 << 24, -1ULL);
+  ASSERT_FALSE(!!ReaderOrErr);
+  EXPECT_EQ(toString(ReaderOrErr.takeError()),
+            "big-endian perf.data files are not supported");
+
+  std::error_code EC;
+  {
+    raw_fd_ostream OS(Path, EC, sys::fs::OF_None);
+    ASSERT_FALSE(EC);
+    OS << "not a perf.data file";
+    OS.write_zeros(128);
+  }
+  ReaderOrErr = PerfDataReader::create(Path, 1 << 24, -1ULL);
+  ASSERT_FALSE(!!ReaderOrErr);
+  EXPECT_EQ(toString(ReaderOrErr.takeError()),
+            "malformed perf.data file: bad magic at offset 0x0");
+}
+
+} // namespace
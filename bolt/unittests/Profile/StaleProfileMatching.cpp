@@ -0,0 +1,106 @@
+#include "bolt/Profile/StaleProfileMatching.h"
+#include "bolt/Core/BinaryBasicBlock.h"
+#include "bolt/Core/BinaryFunction.h"
+#include "bolt/Rewrite/RewriteInstance.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/Object/ELFObjectFile.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace llvm::ELF;
+using namespace bolt;
+
+namespace {
+struct StaleProfileMatchingTester
+    : public testing::TestWithParam<Triple::ArchType> {
+  void SetUp() override {
+    initalizeLLVM();
+    prepareElf();
+    initializeBolt();
+  }
+
+protected:
+  void initalizeLLVM() {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmParsers();
+    llvm::InitializeAllDisassemblers();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllAsmPrinters();
+  }
+
+  void prepareElf() {
+    memcpy(ElfBuf, "\177ELF", 4);
+    ELF64LE::Ehdr *EHdr = reinterpret_cast<typename ELF64LE::Ehdr *>(ElfBuf);
+    EHdr->e_ident[llvm::ELF::EI_CLASS] = llvm::ELF::ELFCLASS64;
+    EHdr->e_ident[llvm::ELF::EI_DATA] = llvm::ELF::ELFDATA2LSB;
+    EHdr->e_machine = EM_X86_64;
+    MemoryBufferRef Source(StringRef(ElfBuf, sizeof(ElfBuf)), "ELF");
+    ObjFile = cantFail(ObjectFile::createObjectFile(Source));
+  }
+
+  void initializeBolt() {
+    BC = cantFail(BinaryContext::createBinaryContext(
+        ObjFile.get(), true, DWARFContext::create(*ObjFile.get())));
+    ASSERT_FALSE(!BC);
+    BC->initializeTarget(std::unique_ptr<MCPlusBuilder>(createMCPlusBuilder(
+        GetParam(), BC->MIA.get(), BC->MII.get(), BC->MRI.get())));
+  }
+
+  char ElfBuf[sizeof(typename ELF64LE::Ehdr)] = {};
+  std::unique_ptr<ObjectFile> ObjFile;
+  std::unique_ptr<BinaryContext> BC;
+};
+} // namespace
+
+#ifdef X86_AVAILABLE
+
+INSTANTIATE_TEST_SUITE_P(X86, StaleProfileMatchingTester,
+                         ::testing::Values(Triple::x86_64));
+
+#endif
+
+TEST_P(StaleProfileMatchingTester, TiesGoToTheClosestBlockInLayout) {
+  // The entry block falls through to one of two identical returns, so the
+  // hashes of the returns are the same, and only their position in the layout
+  // tells them apart. The DFS order visits them the other way around.
+  BinaryFunction *BF = BC->createInjectedBinaryFunction("f");
+  BinaryBasicBlock *Entry = BF->addBasicBlock(0);
+  BinaryBasicBlock *Ret1 = BF->addBasicBlock(1);
+  BinaryBasicBlock *Ret2 = BF->addBasicBlock(2);
+  MCInst Inst;
+  BC->MIB->createNoop(Inst);
+  Entry->addInstruction(Inst);
+  BC->MIB->createReturn(Inst);
+  Ret1->addInstruction(Inst);
+  Ret2->addInstruction(Inst);
+  Entry->addSuccessor(Ret1);
+  Entry->addSuccessor(Ret2);
+  ASSERT_NE(BF->dfs()[1], Ret1);
+
+  DenseMap<const BinaryBasicBlock *, uint64_t> Hashes = computeBlockHashes(*BF);
+  ASSERT_EQ(Hashes[Ret1], Hashes[Ret2]);
+  yaml::bolt::BinaryFunctionProfile YamlBF;
+  YamlBF.Name = "f";
+  YamlBF.NumBasicBlocks = 3;
+  YamlBF.ExecCount = 100;
+  const std::pair<BinaryBasicBlock *, uint64_t> Counts[] = {
+      {Entry, 100}, {Ret1, 30}, {Ret2, 70}};
+  uint32_t Index = 0;
+  for (const std::pair<BinaryBasicBlock *, uint64_t> &BBCount : Counts) {
+    yaml::bolt::BinaryBasicBlockProfile YamlBB;
+    YamlBB.Index = Index++;
+    YamlBB.NumInstructions = 1;
+    YamlBB.Hash = Hashes[BBCount.first];
+    YamlBB.ExecCount = BBCount.second;
+    YamlBF.Blocks.push_back(YamlBB);
+  }
+
+  ASSERT_TRUE(matchStaleProfile(*BF, YamlBF));
+  EXPECT_EQ(Entry->getKnownExecutionCount(), 100u);
+  EXPECT_EQ(Ret1->getKnownExecutionCount(), 30u);
+  EXPECT_EQ(Ret2->getKnownExecutionCount(), 70u);
+}
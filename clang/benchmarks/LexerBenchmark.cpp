@@ -0,0 +1,70 @@
+#include "benchmark/benchmark.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/Token.h"
+#include <string>
+
+using namespace clang;
+
+/// Returns about \p Size bytes of source repeating \p Line.
+static std::string repeatLine(const std::string &Line, size_t Size) {
+  std::string Source;
+  while (Source.size() < Size)
+    Source += Line;
+  return Source;
+}
+
+static void lexAll(benchmark::State &State, const std::string &Source) {
+  LangOptions LangOpts;
+  LangOpts.CPlusPlus = true;
+  LangOpts.CPlusPlus11 = true;
+  LangOpts.LineComment = true;
+  for (auto _ : State) {
+    Lexer L(SourceLocation(), LangOpts, Source.data(), Source.data(),
+            Source.data() + Source.size());
+    Token Tok;
+    unsigned NumTokens = 0;
+    while (!L.LexFromRawLexer(Tok))
+      ++NumTokens;
+    benchmark::DoNotOptimize(NumTokens);
+  }
+  State.SetBytesProcessed(int64_t(State.iterations()) * Source.size());
+}
+
+static void BM_LexIdentifiers(benchmark::State &State) {
+  lexAll(State, repeatLine("std::unordered_map<SourceLocation, "
+                           "DiagnosticMappingInfo> LocalDiagnosticMappings;\n",
+                           1 << 20));
+}
+BENCHMARK(BM_LexIdentifiers);
+
+static void BM_LexWhitespace(benchmark::State &State) {
+  lexAll(State, repeatLine("x                                  "
+                           "\t\t\t\t                = y;\n",
+                           1 << 20));
+}
+BENCHMARK(BM_LexWhitespace);
+
+static void BM_LexLineComments(benchmark::State &State) {
+  lexAll(State, repeatLine("// Returns the location of the first character of "
+                           "the token, skipping any leading whitespace.\n",
+                           1 << 20));
+}
+BENCHMARK(BM_LexLineComments);
+
+static void BM_LexBlockComments(benchmark::State &State) {
+  lexAll(State, repeatLine("/* Returns the location of the first character of "
+                           "the token, skipping any leading whitespace. */\n",
+                           1 << 20));
+}
+BENCHMARK(BM_LexBlockComments);
+
+static void BM_LexRawStrings(benchmark::State &State) {
+  lexAll(State, repeatLine("R\"json({\"name\": \"clang\", \"args\": [1, 2, 3], "
+                           "\"enabled\": true})json\"\n",
+                           1 << 20));
+}
+BENCHMARK(BM_LexRawStrings);
+
+BENCHMARK_MAIN();
@@ -89,6 +89,11 @@ struct SkippedRange {
 bool computeSkippedRanges(ArrayRef<Token> Input,
                           llvm::SmallVectorImpl<SkippedRange> &Range);
 
+/// The version of the output of the minimizer and of its skipped ranges. Bump
+/// it whenever either changes, since it keys the caches of minimized files
+/// that outlive a process.
+constexpr unsigned Version = 1;
+
 } // end namespace minimize_source_to_dependency_directives
 
 /// Minimize the input down to the preprocessor directives that might have
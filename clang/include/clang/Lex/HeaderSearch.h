@@ -20,6 +20,7 @@
 #include "clang/Lex/ModuleMap.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
@@ -48,6 +49,7 @@ class FileManager;
 class HeaderSearch;
 class HeaderSearchOptions;
 class IdentifierInfo;
+class IncludeGuardCache;
 class LangOptions;
 class Module;
 class Preprocessor;
@@ -330,10 +332,21 @@ class HeaderSearch {
   /// Entity used to look up stored header file information.
   ExternalHeaderFileInfoSource *ExternalSource = nullptr;
 
+  /// The controlling macros of headers recorded by earlier compilations, if
+  /// -include-guard-cache is given. Loaded on first use.
+  std::unique_ptr<IncludeGuardCache> GuardCache;
+
+  /// The headers that were skipped because of the include guard cache,
+  /// without being entered.
+  llvm::SetVector<const FileEntry *> FilesSkippedByGuardCache;
+
+  IncludeGuardCache *getIncludeGuardCache();
+
 public:
   HeaderSearch(std::shared_ptr<HeaderSearchOptions> HSOpts,
                SourceManager &SourceMgr, DiagnosticsEngine &Diags,
                const LangOptions &LangOpts, const TargetInfo *Target);
+  ~HeaderSearch();
   HeaderSearch(const HeaderSearch &) = delete;
   HeaderSearch &operator=(const HeaderSearch &) = delete;
 
@@ -535,6 +548,22 @@ public:
     getFileInfo(File).ControllingMacro = ControllingMacro;
   }
 
+  /// Record the controlling macro of the specified file in the include guard
+  /// cache, if there is one, so that later compilations can skip the file
+  /// before lexing it.
+  void CacheFileControllingMacro(const FileEntry *File,
+                                 const IdentifierInfo *ControllingMacro);
+
+  /// Write the include guard cache back, if there is one.
+  void SaveIncludeGuardCache();
+
+  /// Return the headers that were skipped because of the include guard cache.
+  /// They have no file ID, but are inputs of the translation unit all the
+  /// same.
+  ArrayRef<const FileEntry *> getFilesSkippedByIncludeGuardCache() const {
+    return FilesSkippedByGuardCache.getArrayRef();
+  }
+
   /// Determine whether this file is intended to be safe from
   /// multiple inclusions, e.g., it has \#pragma once or a controlling
   /// macro.
@@ -124,6 +124,9 @@ public:
   /// The module/pch container format.
   std::string ModuleFormat;
 
+  /// The file holding the include guard cache, shared between compilations.
+  std::string IncludeGuardCachePath;
+
   /// Whether we should disable the use of the hash string within the
   /// module cache.
   ///
@@ -219,6 +222,15 @@ public:
   /// diagnostics.
   unsigned ModulesStrictContextHash : 1;
 
+  /// Whether module and PCH files are memory mapped, and their source location
+  /// entries and identifiers are only read when they are first used instead
+  /// of being preloaded when the file is imported.
+  unsigned ModulesLazyLoad : 1;
+
+  /// Whether implicitly built module files are written as chunked module
+  /// files, whose chunks are stored once in the module cache.
+  unsigned ModulesCacheDedup : 1;
+
   HeaderSearchOptions(StringRef _Sysroot = "/")
       : Sysroot(_Sysroot), ModuleFormat("raw"), DisableModuleHash(false),
         ImplicitModuleMaps(false), ModuleMapFileHomeIsCwd(false),
@@ -229,7 +241,8 @@ public:
         ModulesValidateSystemHeaders(false),
         ValidateASTInputFilesContent(false), UseDebugInfo(false),
         ModulesValidateDiagnosticOptions(true), ModulesHashContent(false),
-        ModulesStrictContextHash(false) {}
+        ModulesStrictContextHash(false), ModulesLazyLoad(false),
+        ModulesCacheDedup(false) {}
 
   /// AddPath - Add the \p Path path to the specified \p Group list.
   void AddPath(StringRef Path, frontend::IncludeDirGroup Group,
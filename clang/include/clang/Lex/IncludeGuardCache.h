@@ -0,0 +1,96 @@
+//===--- IncludeGuardCache.h - Persistent include guard cache ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the IncludeGuardCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_INCLUDEGUARDCACHE_H
+#define LLVM_CLANG_LEX_INCLUDEGUARDCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem/UniqueID.h"
+#include <ctime>
+#include <string>
+
+namespace clang {
+
+class FileEntry;
+
+/// Records the controlling macros of the headers lexed by a compilation in a
+/// file shared by all the compilations that use it.
+///
+/// The multiple-include optimization only knows the controlling macro of a
+/// header once the header has been lexed in the current compilation. With this
+/// cache, a header whose controlling macro is already defined at its first
+/// inclusion is skipped without being read, provided that it has not changed
+/// since the compilation that recorded its controlling macro. A header
+/// is identified by the unique ID of its file, and is considered unchanged
+/// while its size and modification time are, as for the input files of AST
+/// files.
+///
+/// Compilations running concurrently may lose each other's updates to the
+/// cache, in which case the lost entries are recorded again by later
+/// compilations.
+///
+/// The cache holds at most a fixed number of entries. When it grows past
+/// that, the entries that the compilation saving it did not use are dropped
+/// first.
+class IncludeGuardCache {
+public:
+  /// The default maximum number of entries of a cache.
+  static constexpr unsigned DefaultMaxEntries = 1 << 16;
+
+  /// Loads the cache from \p Path. A cache that cannot be read, for instance
+  /// because it does not exist yet, is empty.
+  explicit IncludeGuardCache(StringRef Path,
+                             unsigned MaxEntries = DefaultMaxEntries);
+
+  /// Returns the controlling macro of \p File, or an empty string if it is
+  /// unknown or \p File changed since it was recorded.
+  StringRef lookup(const FileEntry *File) const;
+
+  /// Records that \p File is guarded by \p ControllingMacro.
+  void insert(const FileEntry *File, StringRef ControllingMacro);
+
+  /// Writes the cache back if entries were added, merging them with the ones
+  /// other compilations wrote meanwhile, and dropping entries that exceed
+  /// the maximum number.
+  llvm::Error save();
+
+private:
+  struct Entry {
+    uint64_t Size;
+    time_t ModTime;
+    std::string ControllingMacro;
+    /// Whether this compilation looked the entry up or inserted it.
+    mutable bool Used = false;
+  };
+
+  using EntryMap = llvm::DenseMap<llvm::sys::fs::UniqueID, Entry>;
+
+  /// Adds the entries of the cache file to \p Entries, unless \p Entries
+  /// already has an entry for the same file.
+  void read(EntryMap &Entries) const;
+
+  /// Drops entries until there are at most MaxEntries, starting with the
+  /// ones that are not used.
+  void prune();
+
+  std::string Path;
+  unsigned MaxEntries;
+  EntryMap Entries;
+  bool Modified = false;
+};
+
+} // namespace clang
+
+#endif // LLVM_CLANG_LEX_INCLUDEGUARDCACHE_H
@@ -67,6 +67,7 @@ class ASTConsumer;
 class ASTContext;
 class ASTDeserializationListener;
 class ASTReader;
+class ASTRecordPrefetcher;
 class ASTRecordReader;
 class CXXTemporary;
 class Decl;
@@ -425,6 +426,11 @@ private:
   /// The module manager which manages modules and their dependencies
   ModuleManager ModuleMgr;
 
+  /// Decodes declaration and type records ahead of their deserialization, if
+  /// enabled. This is declared after the module manager so that it is
+  /// destroyed, and waits for its threads, before the module files are.
+  std::unique_ptr<ASTRecordPrefetcher> Prefetcher;
+
   /// A dummy identifier resolver used to merge TU-scope declarations in
   /// C, for the cases where we don't have a Sema object to provide a real
   /// identifier resolver.
@@ -1383,6 +1389,21 @@ private:
 
   RecordLocation DeclCursorForID(serialization::DeclID ID,
                                  SourceLocation &Location);
+
+  /// Reads the record at \p Offset of the declarations and types block of
+  /// \p F into \p Record and returns its code, taking the record from the
+  /// prefetcher if it was decoded ahead of time. The cursor of the block is
+  /// left just past the record.
+  Expected<unsigned> readDeclsBlockRecord(ASTRecordReader &Record,
+                                          ModuleFile &F, uint64_t Offset);
+
+  /// Starts decoding ahead of time the records of the declarations that
+  /// follow the one at \p LocalIndex in \p F and are not loaded yet.
+  void prefetchDeclRecords(ModuleFile &F, unsigned LocalIndex);
+
+  /// Starts decoding ahead of time the records of the types that follow the
+  /// one at \p LocalIndex in \p F and are not loaded yet.
+  void prefetchTypeRecords(ModuleFile &F, unsigned LocalIndex);
   void loadDeclUpdateRecords(PendingUpdateRecord &Record);
   void loadPendingDeclChain(Decl *D, uint64_t LocalOffset);
   void loadObjCCategories(serialization::GlobalDeclID ID, ObjCInterfaceDecl *D,
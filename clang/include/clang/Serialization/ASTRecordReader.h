@@ -49,6 +49,13 @@ public:
   Expected<unsigned> readRecord(llvm::BitstreamCursor &Cursor,
                                 unsigned AbbrevID);
 
+  /// Takes over a record that was already read from the stream, resetting
+  /// the internal state.
+  void setRecord(RecordData &&NewRecord) {
+    Idx = 0;
+    Record = std::move(NewRecord);
+  }
+
   /// Is this a module file for a module (rather than a PCH or similar).
   bool isModule() const { return F->isModule(); }
 
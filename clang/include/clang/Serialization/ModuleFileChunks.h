@@ -0,0 +1,56 @@
+//===- ModuleFileChunks.h - Deduplicated module file storage ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file declares the functions that write module files to the module
+//  cache as lists of content-defined chunks, and read them back.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_SERIALIZATION_MODULEFILECHUNKS_H
+#define LLVM_CLANG_SERIALIZATION_MODULEFILECHUNKS_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include <memory>
+
+namespace llvm {
+class MemoryBuffer;
+class raw_ostream;
+} // namespace llvm
+
+namespace clang {
+
+/// The name of the directory of the module cache holding the chunks of the
+/// chunked module files.
+///
+/// Module files built with -fmodules-cache-dedup are split into chunks at
+/// boundaries that depend on their contents, so that the blocks two builds of
+/// the same module have in common, such as identifier tables, types and
+/// declarations, end up in identical chunks. Each chunk is stored once in this
+/// directory, named after its hash, and the module file itself only holds the
+/// list of its chunks.
+constexpr llvm::StringLiteral ModuleFileChunkStoreName = "chunks";
+
+/// Returns whether \p Data is the list of chunks of a chunked module file.
+bool isChunkedModuleFile(StringRef Data);
+
+/// Splits the module file \p Data into chunks, stores the chunks that are not
+/// present yet in \p ChunkStore, and writes the list of chunks to \p OS.
+llvm::Error writeChunkedModuleFile(llvm::raw_ostream &OS, StringRef Data,
+                                   StringRef ChunkStore);
+
+/// If \p Buffer holds the list of chunks of a chunked module file, replaces it
+/// with the contents of the module file, read from the chunk store. Fails if
+/// a chunk is missing or does not match its hash.
+llvm::Error
+expandChunkedModuleFile(std::unique_ptr<llvm::MemoryBuffer> &Buffer);
+
+} // namespace clang
+
+#endif // LLVM_CLANG_SERIALIZATION_MODULEFILECHUNKS_H
@@ -28,6 +28,10 @@ struct PCHBuffer {
   ASTFileSignature Signature;
   llvm::SmallVector<char, 0> Data;
   bool IsComplete;
+
+  /// If not empty, the directory of the chunks of the module file, which is
+  /// then written as a chunked module file (see ModuleFileChunks.h).
+  std::string ChunkStore;
 };
 
 /// This abstract interface provides operations for creating
@@ -14,8 +14,11 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include <atomic>
+#include <functional>
 #include <mutex>
 
 namespace clang {
@@ -40,6 +43,9 @@ struct CachedFileContents {
   /// Skipped range mapping of the minimized contents.
   /// This is initialized iff `MinimizedAccess != nullptr`.
   PreprocessorSkippedRangeMapping PPSkippedRangeMapping;
+  /// Owning storage for the entry of the persistent cache that the minimized
+  /// contents were read from, if any.
+  std::unique_ptr<llvm::MemoryBuffer> PersistentStorage;
 };
 
 /// An in-memory representation of a file system entity that is of interest to
@@ -144,6 +150,55 @@ private:
   CachedFileContents *Contents;
 };
 
+/// This class is an on-disk cache of minimized file contents, that is shared
+/// between dependency scanning processes running concurrently or one after
+/// another.
+///
+/// Each entry holds the minimized contents of a file and their skipped range
+/// mapping, and is keyed by a hash of the original contents, so it stays
+/// valid when a file is touched or copied. The versions of clang and of the
+/// minimizer are part of the hash too, so that an upgrade doesn't reuse
+/// entries it would minimize differently. Entries are written to a temporary
+/// file and renamed into place, so concurrent processes never observe a
+/// partial entry, and they are memory mapped when read. The entries are named
+/// like the ones of \c llvm::localCache, so the directory can be pruned with
+/// \c llvm::pruneCache.
+class DependencyScanningPersistentCache {
+public:
+  /// Opens the cache in the given directory, creating the directory if it
+  /// doesn't exist yet.
+  static llvm::Expected<std::unique_ptr<DependencyScanningPersistentCache>>
+  create(StringRef Directory);
+
+  /// The minimized contents of a file read from the cache.
+  struct Entry {
+    /// Owning storage for the entry, which \c Minimized points into.
+    std::unique_ptr<llvm::MemoryBuffer> Storage;
+    /// The minimized contents, which are null terminated.
+    StringRef Minimized;
+    /// Skipped range mapping of the minimized contents.
+    PreprocessorSkippedRangeMapping PPSkippedRangeMapping;
+  };
+
+  /// Returns the minimized form of the given original contents, or None if
+  /// the cache has no valid entry for them.
+  Optional<Entry> lookup(StringRef Original) const;
+
+  /// Stores the minimized form of the given original contents. Failures are
+  /// ignored, since the cache is only an optimization.
+  void store(StringRef Original, StringRef Minimized,
+             const PreprocessorSkippedRangeMapping &Mapping) const;
+
+private:
+  DependencyScanningPersistentCache(StringRef Directory)
+      : Directory(Directory) {}
+
+  /// Returns the path of the entry for the given original contents.
+  std::string getEntryPath(StringRef Original) const;
+
+  std::string Directory;
+};
+
 /// This class is a shared cache, that caches the 'stat' and 'open' calls to the
 /// underlying real file system. It distinguishes between minimized and original
 /// files.
@@ -204,9 +259,48 @@ public:
   CacheShard &getShardForFilename(StringRef Filename) const;
   CacheShard &getShardForUID(llvm::sys::fs::UniqueID UID) const;
 
+  /// Removes the entries of the given filenames, the entries of the files
+  /// they refer to, and the entries of the other filenames of those files, so
+  /// that the files are read again the next time they are accessed. The
+  /// removed entries stay allocated, since ongoing scans may still use them.
+  void invalidate(ArrayRef<std::string> Filenames);
+
+  /// Returns the number of times the cache was invalidated. Workers that cache
+  /// entries locally must drop them when this changes.
+  uint64_t getGeneration() const { return Generation.load(); }
+
+  /// Sets a function that is called with the filename of each entry that is
+  /// added to the cache. It may be called concurrently from multiple threads,
+  /// and more than once for a filename.
+  void setFilenameAddedCallback(std::function<void(StringRef)> Callback) {
+    FilenameAdded = std::move(Callback);
+  }
+
+  /// Calls the callback set by \c setFilenameAddedCallback, if any.
+  void notifyFilenameAdded(StringRef Filename) const {
+    if (FilenameAdded)
+      FilenameAdded(Filename);
+  }
+
+  /// Returns the persistent cache of minimized contents, or nullptr if there
+  /// is none.
+  const DependencyScanningPersistentCache *getPersistentCache() const {
+    return PersistentCache.get();
+  }
+
+  /// Sets the persistent cache that minimized contents are read from and
+  /// written to.
+  void setPersistentCache(
+      std::unique_ptr<DependencyScanningPersistentCache> Cache) {
+    PersistentCache = std::move(Cache);
+  }
+
 private:
   std::unique_ptr<CacheShard[]> CacheShards;
   unsigned NumShards;
+  std::unique_ptr<DependencyScanningPersistentCache> PersistentCache;
+  std::atomic<uint64_t> Generation{0};
+  std::function<void(StringRef)> FilenameAdded;
 };
 
 /// This class is a local cache, that caches the 'stat' and 'open' calls to the
@@ -231,6 +325,9 @@ public:
     assert(InsertedEntry == &Entry && "entry already present");
     return *InsertedEntry;
   }
+
+  /// Removes all entries.
+  void clear() { Cache.clear(); }
 };
 
 /// Reference to a CachedFileSystemEntry.
@@ -306,6 +403,10 @@ public:
   /// Enable minimization of all files.
   void enableMinimizationOfAllFiles() { NotToBeMinimized.clear(); }
 
+  /// Drop the entries cached locally by this worker, so that the next accesses
+  /// go through the shared cache again.
+  void clearLocalCache() { LocalCache.clear(); }
+
 private:
   /// Check whether the file should be minimized.
   bool shouldMinimize(StringRef Filename, llvm::sys::fs::UniqueID UID);
@@ -82,6 +82,10 @@ private:
   /// The file manager that is reused across multiple invocations by this
   /// worker. If null, the file manager will not be reused.
   llvm::IntrusiveRefCntPtr<FileManager> Files;
+  /// The cache of the file system state shared between workers.
+  DependencyScanningFilesystemSharedCache &SharedCache;
+  /// The generation of the shared cache when the previous invocation started.
+  uint64_t SharedCacheGeneration;
   ScanningOutputFormat Format;
   /// Whether to optimize the modules' command-line arguments.
   bool OptimizeArgs;
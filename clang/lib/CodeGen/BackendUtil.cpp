@@ -25,11 +25,13 @@
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Bitcode/BitcodeWriterPass.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/SchedulerRegistry.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IRPrintingPasses.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
@@ -161,6 +163,14 @@ class EmitAssemblyHelper {
                           std::unique_ptr<raw_pwrite_stream> &OS,
                           std::unique_ptr<llvm::ToolOutputFile> &DwoOS);
 
+  /// Check whether the module can be split into partitions that are
+  /// code generated in parallel, as requested by -fparallel-codegen=.
+  bool canRunParallelCodegen(BackendAction Action) const;
+
+  /// Split the module into partitions, generate an object for each of them on
+  /// a separate thread, and combine the objects into the one written to \p OS.
+  void RunParallelCodegen(raw_pwrite_stream &OS);
+
   /// Check whether we should emit a module summary for regular LTO.
   /// The module summary should be emitted by default for regular LTO
   /// except for ld64 targets.
@@ -969,6 +979,11 @@ void EmitAssemblyHelper::RunOptimizationPipeline(
 void EmitAssemblyHelper::RunCodegenPipeline(
     BackendAction Action, std::unique_ptr<raw_pwrite_stream> &OS,
     std::unique_ptr<llvm::ToolOutputFile> &DwoOS) {
+  if (canRunParallelCodegen(Action)) {
+    RunParallelCodegen(*OS);
+    return;
+  }
+
   // We still use the legacy PM to run the codegen pipeline since the new PM
   // does not work with the codegen pipeline.
   // FIXME: make the new PM work with the codegen pipeline.
@@ -1002,6 +1017,56 @@ void EmitAssemblyHelper::RunCodegenPipeline(
   }
 }
 
+bool EmitAssemblyHelper::canRunParallelCodegen(BackendAction Action) const {
+  if (CodeGenOpts.ParallelCodeGenPartitions <= 1 || Action != Backend_EmitObj)
+    return false;
+
+  // The partitions are code generated without the pass setup of
+  // AddEmitPasses, which only matters when optimizing, and combined by an ELF
+  // relocatable link, which does not support MIPS relocations.
+  if (CodeGenOpts.OptimizationLevel != 0 ||
+      !TargetTriple.isOSBinFormatELF() || TargetTriple.isMIPS())
+    return false;
+
+  // Each partition is code generated in a context of its own, without the
+  // diagnostic handler of the frontend, so anything that reports diagnostics
+  // or writes side files from the backend has to run serially.
+  if (!CodeGenOpts.SplitDwarfOutput.empty() ||
+      !CodeGenOpts.StackUsageOutput.empty() ||
+      CodeGenOpts.WarnStackSize != UINT_MAX ||
+      !CodeGenOpts.OptRecordFile.empty() ||
+      CodeGenOpts.OptimizationRemark.hasValidPattern() ||
+      CodeGenOpts.OptimizationRemarkMissed.hasValidPattern() ||
+      CodeGenOpts.OptimizationRemarkAnalysis.hasValidPattern())
+    return false;
+
+  // Inline assembly is parsed by the backend, which reports its errors.
+  if (!TheModule->getModuleInlineAsm().empty())
+    return false;
+  for (const Function &F : *TheModule)
+    for (const Instruction &I : instructions(F))
+      if (const auto *CB = dyn_cast<CallBase>(&I))
+        if (CB->isInlineAsm())
+          return false;
+  return true;
+}
+
+void EmitAssemblyHelper::RunParallelCodegen(raw_pwrite_stream &OS) {
+  auto CreateTargetMachine = [&]() {
+    return std::unique_ptr<TargetMachine>(TM->getTarget().createTargetMachine(
+        TM->getTargetTriple().str(), TM->getTargetCPU(),
+        TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+        TM->getCodeModel(), TM->getOptLevel()));
+  };
+
+  PrettyStackTraceString CrashInfo("Parallel code generation");
+  llvm::TimeTraceScope TimeScope("ParallelCodeGen");
+  if (Error E = splitCodeGenToObject(*TheModule,
+                                     CodeGenOpts.ParallelCodeGenPartitions, OS,
+                                     CreateTargetMachine))
+    Diags.Report(diag::err_fe_error_backend) << toString(std::move(E));
+}
+
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       std::unique_ptr<raw_pwrite_stream> OS) {
   TimeRegion Region(CodeGenOpts.TimePasses ? &CodeGenerationTime : nullptr);
@@ -37,6 +37,7 @@
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/GlobalModuleIndex.h"
 #include "clang/Serialization/InMemoryModuleCache.h"
+#include "clang/Serialization/ModuleFileChunks.h"
 #include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/BuryPointer.h"
@@ -1595,12 +1596,17 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
     if (!llvm::sys::fs::is_directory(Dir->path()))
       continue;
 
+    // The chunks of chunked module files are read whenever the module files
+    // are, so unused chunks are pruned the same way as unused module files.
+    bool IsChunkStore =
+        llvm::sys::path::filename(Dir->path()) == ModuleFileChunkStoreName;
+
     // Walk all of the files within this directory.
     for (llvm::sys::fs::directory_iterator File(Dir->path(), EC), FileEnd;
          File != FileEnd && !EC; File.increment(EC)) {
       // We only care about module and global module index files.
       StringRef Extension = llvm::sys::path::extension(File->path());
-      if (Extension != ".pcm" && Extension != ".timestamp" &&
+      if (!IsChunkStore && Extension != ".pcm" && Extension != ".timestamp" &&
           llvm::sys::path::filename(File->path()) != "modules.idx")
         continue;
 
@@ -26,6 +26,7 @@
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/ASTWriter.h"
 #include "clang/Serialization/ModuleFile.h"
+#include "clang/Serialization/ModuleFileChunks.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -193,6 +194,13 @@ GenerateModuleAction::CreateASTConsumer(CompilerInstance &CI,
   std::string Sysroot;
 
   auto Buffer = std::make_shared<PCHBuffer>();
+  const HeaderSearchOptions &HSOpts = CI.getHeaderSearchOpts();
+  if (HSOpts.ModulesCacheDedup && CI.getFrontendOpts().BuildingImplicitModule &&
+      !HSOpts.ModuleCachePath.empty()) {
+    SmallString<128> ChunkStore(HSOpts.ModuleCachePath);
+    llvm::sys::path::append(ChunkStore, ModuleFileChunkStoreName);
+    Buffer->ChunkStore = std::string(ChunkStore);
+  }
   std::vector<std::unique_ptr<ASTConsumer>> Consumers;
 
   Consumers.push_back(std::make_unique<PCHGenerator>(
@@ -20,6 +20,7 @@
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/HeaderMap.h"
 #include "clang/Lex/HeaderSearchOptions.h"
+#include "clang/Lex/IncludeGuardCache.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/ModuleMap.h"
 #include "clang/Lex/Preprocessor.h"
@@ -54,6 +55,9 @@ ALWAYS_ENABLED_STATISTIC(NumIncluded, "Number of attempted #includes.");
 ALWAYS_ENABLED_STATISTIC(
     NumMultiIncludeFileOptzn,
     "Number of #includes skipped due to the multi-include optimization.");
+ALWAYS_ENABLED_STATISTIC(
+    NumIncludeGuardCacheHits,
+    "Number of #includes skipped due to the include guard cache.");
 ALWAYS_ENABLED_STATISTIC(NumFrameworkLookups, "Number of framework lookups.");
 ALWAYS_ENABLED_STATISTIC(NumSubFrameworkLookups,
                          "Number of subframework lookups.");
@@ -87,6 +91,8 @@ HeaderSearch::HeaderSearch(std::shared_ptr<HeaderSearchOptions> HSOpts,
       FileMgr(SourceMgr.getFileManager()), FrameworkMap(64),
       ModMap(SourceMgr, Diags, LangOpts, Target, *this) {}
 
+HeaderSearch::~HeaderSearch() = default;
+
 void HeaderSearch::PrintStats() {
   llvm::errs() << "\n*** HeaderSearch Stats:\n"
                << FileInfo.size() << " files tracked.\n";
@@ -97,7 +103,9 @@ void HeaderSearch::PrintStats() {
 
   llvm::errs() << "  " << NumIncluded << " #include/#include_next/#import.\n"
                << "    " << NumMultiIncludeFileOptzn
-               << " #includes skipped due to the multi-include optimization.\n";
+               << " #includes skipped due to the multi-include optimization.\n"
+               << "    " << NumIncludeGuardCacheHits
+               << " #includes skipped due to the include guard cache.\n";
 
   llvm::errs() << NumFrameworkLookups << " framework lookups.\n"
                << NumSubFrameworkLookups << " subframework lookups.\n";
@@ -1440,6 +1448,19 @@ bool HeaderSearch::ShouldEnterIncludeFile(Preprocessor &PP,
       ++NumMultiIncludeFileOptzn;
       return false;
     }
+  } else if (!M && !PP.alreadyIncluded(File) &&
+             !PP.getSourceManager().isFileOverridden(File)) {
+    // The file has not been lexed yet. If an earlier compilation found its
+    // controlling macro and the macro is already defined, we can skip the file
+    // without reading it.
+    if (IncludeGuardCache *Cache = getIncludeGuardCache()) {
+      StringRef Macro = Cache->lookup(File);
+      if (!Macro.empty() && PP.isMacroDefined(Macro)) {
+        ++NumIncludeGuardCacheHits;
+        FilesSkippedByGuardCache.insert(File);
+        return false;
+      }
+    }
   }
 
   IsFirstIncludeOfFile = PP.markIncluded(File);
@@ -1447,6 +1468,26 @@ bool HeaderSearch::ShouldEnterIncludeFile(Preprocessor &PP,
   return true;
 }
 
+IncludeGuardCache *HeaderSearch::getIncludeGuardCache() {
+  if (!GuardCache && !HSOpts->IncludeGuardCachePath.empty())
+    GuardCache =
+        std::make_unique<IncludeGuardCache>(HSOpts->IncludeGuardCachePath);
+  return GuardCache.get();
+}
+
+void HeaderSearch::CacheFileControllingMacro(
+    const FileEntry *File, const IdentifierInfo *ControllingMacro) {
+  if (IncludeGuardCache *Cache = getIncludeGuardCache())
+    Cache->insert(File, ControllingMacro->getName());
+}
+
+void HeaderSearch::SaveIncludeGuardCache() {
+  // The cache only speeds up later compilations, so failing to write it is
+  // not an error.
+  if (GuardCache)
+    llvm::consumeError(GuardCache->save());
+}
+
 size_t HeaderSearch::getTotalMemory() const {
   return SearchDirs.capacity()
     + llvm::capacity_in_bytes(FileInfo)
@@ -0,0 +1,133 @@
+//===--- IncludeGuardCache.cpp - Persistent include guard cache -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the IncludeGuardCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/IncludeGuardCache.h"
+#include "clang/Basic/CharInfo.h"
+#include "clang/Basic/FileEntry.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+// The cache file has one line per header, holding the device and file numbers
+// of its unique ID, its size, its modification time and its controlling macro,
+// separated by spaces.
+static constexpr llvm::StringLiteral IncludeGuardCacheMagic =
+    "include-guard-cache v1\n";
+
+IncludeGuardCache::IncludeGuardCache(StringRef Path, unsigned MaxEntries)
+    : Path(Path), MaxEntries(MaxEntries) {
+  read(Entries);
+}
+
+void IncludeGuardCache::read(EntryMap &Entries) const {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                  /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return;
+  StringRef Rest = (*Buffer)->getBuffer();
+  if (!Rest.consume_front(IncludeGuardCacheMagic))
+    return;
+
+  // Lines that are malformed, for instance because the file was truncated,
+  // are ignored.
+  while (!Rest.empty()) {
+    StringRef Line;
+    std::tie(Line, Rest) = Rest.split('\n');
+    SmallVector<StringRef, 5> Fields;
+    Line.split(Fields, ' ');
+    uint64_t Device, File, Size;
+    long long ModTime;
+    if (Fields.size() != 5 || Fields[0].getAsInteger(10, Device) ||
+        Fields[1].getAsInteger(10, File) || Fields[2].getAsInteger(10, Size) ||
+        Fields[3].getAsInteger(10, ModTime) ||
+        !isValidAsciiIdentifier(Fields[4]))
+      continue;
+    Entries.try_emplace(llvm::sys::fs::UniqueID(Device, File),
+                        Entry{Size, static_cast<time_t>(ModTime),
+                              Fields[4].str()});
+  }
+}
+
+StringRef IncludeGuardCache::lookup(const FileEntry *File) const {
+  auto It = Entries.find(File->getUniqueID());
+  if (It == Entries.end() ||
+      It->second.Size != static_cast<uint64_t>(File->getSize()) ||
+      It->second.ModTime != File->getModificationTime())
+    return StringRef();
+  It->second.Used = true;
+  return It->second.ControllingMacro;
+}
+
+void IncludeGuardCache::insert(const FileEntry *File,
+                               StringRef ControllingMacro) {
+  if (lookup(File) == ControllingMacro)
+    return;
+  Entries[File->getUniqueID()] =
+      Entry{static_cast<uint64_t>(File->getSize()),
+            File->getModificationTime(), ControllingMacro.str(),
+            /*Used=*/true};
+  Modified = true;
+}
+
+void IncludeGuardCache::prune() {
+  if (Entries.size() <= MaxEntries)
+    return;
+  SmallVector<llvm::sys::fs::UniqueID, 0> Dropped;
+  size_t NumDropped = Entries.size() - MaxEntries;
+  for (bool DropUsed : {false, true})
+    for (const auto &E : Entries)
+      if (Dropped.size() != NumDropped && E.second.Used == DropUsed)
+        Dropped.push_back(E.first);
+  for (const llvm::sys::fs::UniqueID &ID : Dropped)
+    Entries.erase(ID);
+}
+
+llvm::Error IncludeGuardCache::save() {
+  if (!Modified)
+    return llvm::Error::success();
+  read(Entries);
+  prune();
+
+  // Write the cache to a temporary file that is renamed into place, so that
+  // the compilations reading the cache concurrently never see a partial one.
+  SmallString<128> Model(Path);
+  Model += "-%%%%%%%%.tmp";
+  llvm::Expected<llvm::sys::fs::TempFile> Temp =
+      llvm::sys::fs::TempFile::create(Model);
+  if (!Temp)
+    return Temp.takeError();
+  {
+    llvm::raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << IncludeGuardCacheMagic;
+    for (const auto &E : Entries)
+      OS << E.first.getDevice() << ' ' << E.first.getFile() << ' '
+         << E.second.Size << ' ' << static_cast<long long>(E.second.ModTime)
+         << ' ' << E.second.ControllingMacro << '\n';
+    OS.flush();
+    if (std::error_code EC = OS.error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return llvm::createFileError(Path, EC);
+    }
+  }
+  if (llvm::Error E = Temp->keep(Path)) {
+    consumeError(Temp->discard());
+    return E;
+  }
+  Modified = false;
+  return llvm::Error::success();
+}
@@ -47,8 +47,183 @@
 #include <tuple>
 #include <utility>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
+
 using namespace clang;
 
+//===----------------------------------------------------------------------===//
+// Vectorized Scanning
+//===----------------------------------------------------------------------===//
+
+// The functions below skip 16 characters at a time over the runs of characters
+// the lexer spends most of its time on: identifiers, horizontal whitespace,
+// line comments and raw string literals. They only skip characters that the
+// character-at-a-time loops following them would skip too, and leave the
+// character that ends the run, and the last few characters of the buffer, to
+// those loops. SSE2 and NEON are part of the baseline of x86-64 and AArch64,
+// so there is no need to detect them at run time.
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+namespace {
+
+#ifdef __SSE2__
+using CharVector = __m128i;
+
+CharVector loadChars(const char *Ptr) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+}
+
+CharVector matchChar(CharVector V, char C) {
+  return _mm_cmpeq_epi8(V, _mm_set1_epi8(C));
+}
+
+/// Matches the characters in [Lo, Lo + Count).
+CharVector matchRange(CharVector V, char Lo, unsigned char Count) {
+  // SSE2 only has signed comparisons, so bias the characters such that those
+  // in the range become the smallest signed values.
+  CharVector Biased = _mm_add_epi8(V, _mm_set1_epi8(char(0x80 - Lo)));
+  return _mm_cmplt_epi8(Biased, _mm_set1_epi8(char(0x80 + Count)));
+}
+
+CharVector matchEither(CharVector A, CharVector B) {
+  return _mm_or_si128(A, B);
+}
+
+CharVector setBits(CharVector V, char Bits) {
+  return _mm_or_si128(V, _mm_set1_epi8(Bits));
+}
+
+/// Returns the index of the first matched character, or 16 if there is none.
+unsigned firstMatch(CharVector M) {
+  unsigned Mask = _mm_movemask_epi8(M);
+  return Mask ? llvm::countTrailingZeros(Mask) : 16;
+}
+
+/// Returns the index of the first unmatched character, or 16 if there is none.
+unsigned firstMismatch(CharVector M) {
+  unsigned Mask = ~_mm_movemask_epi8(M) & 0xFFFF;
+  return Mask ? llvm::countTrailingZeros(Mask) : 16;
+}
+#else
+using CharVector = uint8x16_t;
+
+CharVector loadChars(const char *Ptr) {
+  return vld1q_u8(reinterpret_cast<const uint8_t *>(Ptr));
+}
+
+CharVector matchChar(CharVector V, char C) {
+  return vceqq_u8(V, vdupq_n_u8(C));
+}
+
+/// Matches the characters in [Lo, Lo + Count).
+CharVector matchRange(CharVector V, char Lo, unsigned char Count) {
+  return vcltq_u8(vsubq_u8(V, vdupq_n_u8(Lo)), vdupq_n_u8(Count));
+}
+
+CharVector matchEither(CharVector A, CharVector B) { return vorrq_u8(A, B); }
+
+CharVector setBits(CharVector V, char Bits) {
+  return vorrq_u8(V, vdupq_n_u8(Bits));
+}
+
+/// Returns the index of the first matched character, or 16 if there is none.
+unsigned firstMatch(CharVector M) {
+  // NEON has no movemask: narrow each 8-bit lane to 4 bits instead.
+  uint64_t Mask = vget_lane_u64(
+      vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(M), 4)), 0);
+  return Mask ? llvm::countTrailingZeros(Mask) / 4 : 16;
+}
+
+/// Returns the index of the first unmatched character, or 16 if there is none.
+unsigned firstMismatch(CharVector M) { return firstMatch(vmvnq_u8(M)); }
+#endif
+
+/// Returns a pointer to the first character in [Ptr, End - 15) that does not
+/// satisfy \p Matches, or to a character at most 15 characters before \p End.
+template <typename MatchFn>
+const char *skipMatching(const char *Ptr, const char *End, MatchFn Matches) {
+  while (End - Ptr >= 16) {
+    unsigned Index = firstMismatch(Matches(loadChars(Ptr)));
+    Ptr += Index;
+    if (Index != 16)
+      break;
+  }
+  return Ptr;
+}
+
+/// Returns a pointer to the first character in [Ptr, End - 15) that satisfies
+/// \p Matches, or to a character at most 15 characters before \p End.
+template <typename MatchFn>
+const char *findMatching(const char *Ptr, const char *End, MatchFn Matches) {
+  while (End - Ptr >= 16) {
+    unsigned Index = firstMatch(Matches(loadChars(Ptr)));
+    Ptr += Index;
+    if (Index != 16)
+      break;
+  }
+  return Ptr;
+}
+
+} // namespace
+
+/// Skips the characters matched by isAsciiIdentifierContinue.
+static const char *skipAsciiIdentifierContinue(const char *Ptr,
+                                               const char *End) {
+  return skipMatching(Ptr, End, [](CharVector V) {
+    // Setting bit 5 maps the upper case letters, and only them, to the lower
+    // case ones.
+    CharVector Letters = matchRange(setBits(V, 0x20), 'a', 26);
+    CharVector Digits = matchRange(V, '0', 10);
+    return matchEither(matchEither(Letters, Digits), matchChar(V, '_'));
+  });
+}
+
+/// Skips the characters matched by isHorizontalWhitespace.
+static const char *skipHorizontalWhitespace(const char *Ptr, const char *End) {
+  return skipMatching(Ptr, End, [](CharVector V) {
+    // '\v' and '\f' are adjacent, but '\n' separates them from '\t'.
+    return matchEither(matchEither(matchChar(V, ' '), matchChar(V, '\t')),
+                       matchRange(V, '\v', 2));
+  });
+}
+
+/// Finds the first character that may end a line comment.
+static const char *findLineCommentEnd(const char *Ptr, const char *End) {
+  return findMatching(Ptr, End, [](CharVector V) {
+    return matchEither(matchEither(matchChar(V, '\n'), matchChar(V, '\r')),
+                       matchChar(V, '\0'));
+  });
+}
+
+/// Finds the first character that may end a raw string literal.
+static const char *findRawStringEnd(const char *Ptr, const char *End) {
+  return findMatching(Ptr, End, [](CharVector V) {
+    return matchEither(matchChar(V, ')'), matchChar(V, '\0'));
+  });
+}
+#else
+static const char *skipAsciiIdentifierContinue(const char *Ptr,
+                                               const char *) {
+  return Ptr;
+}
+static const char *skipHorizontalWhitespace(const char *Ptr, const char *) {
+  return Ptr;
+}
+static const char *findLineCommentEnd(const char *Ptr, const char *) {
+  return Ptr;
+}
+static const char *findRawStringEnd(const char *Ptr, const char *) {
+  return Ptr;
+}
+#endif
+
 //===----------------------------------------------------------------------===//
 // Token Class Implementation
 //===----------------------------------------------------------------------===//
@@ -1763,6 +1938,7 @@ bool Lexer::LexUnicodeIdentifierStart(Token &Result, uint32_t C,
 bool Lexer::LexIdentifierContinue(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched an identifier start.
   while (true) {
+    CurPtr = skipAsciiIdentifierContinue(CurPtr, BufferEnd);
     unsigned char C = *CurPtr;
     // Fast path.
     if (isAsciiIdentifierContinue(C)) {
@@ -2124,6 +2300,7 @@ bool Lexer::LexRawStringLiteral(Token &Result, const char *CurPtr,
   CurPtr += PrefixLen + 1; // skip over prefix and '('
 
   while (true) {
+    CurPtr = findRawStringEnd(CurPtr, BufferEnd);
     char C = *CurPtr++;
 
     if (C == ')') {
@@ -2317,6 +2494,10 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr,
   // Skip consecutive spaces efficiently.
   while (true) {
     // Skip horizontal whitespace very aggressively.
+    if (isHorizontalWhitespace(Char)) {
+      CurPtr = skipHorizontalWhitespace(CurPtr, BufferEnd);
+      Char = *CurPtr;
+    }
     while (isHorizontalWhitespace(Char))
       Char = *++CurPtr;
 
@@ -2395,6 +2576,7 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr,
   // character that ends the line comment.
   char C;
   while (true) {
+    CurPtr = findLineCommentEnd(CurPtr, BufferEnd);
     C = *CurPtr;
     // Skip over characters in the fast loop.
     while (C != 0 &&                // Potentially EOF.
@@ -2616,13 +2798,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr, Lexer *L,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
@@ -2693,6 +2868,9 @@ bool Lexer::SkipBlockComment(Token &Result, const char *CurPtr,
         }
         CurPtr += 16;
       }
+#elif defined(__ARM_NEON)
+      CurPtr = findMatching(CurPtr, BufferEnd,
+                            [](CharVector V) { return matchChar(V, '/'); });
 #elif __ALTIVEC__
       __vector unsigned char Slashes = {
         '/', '/', '/', '/',  '/', '/', '/', '/',
@@ -3326,9 +3504,11 @@ LexNextToken:
 
   // Small amounts of horizontal whitespace is very common between tokens.
   if (isHorizontalWhitespace(*CurPtr)) {
-    do {
+    ++CurPtr;
+    if (isHorizontalWhitespace(*CurPtr))
+      CurPtr = skipHorizontalWhitespace(CurPtr, BufferEnd);
+    while (isHorizontalWhitespace(*CurPtr))
       ++CurPtr;
-    } while (isHorizontalWhitespace(*CurPtr));
 
     // If we are keeping whitespace and other tokens, just return what we just
     // skipped.  The next lexer invocation will return the token after the
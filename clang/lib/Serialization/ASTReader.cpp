@@ -12,6 +12,7 @@
 
 #include "ASTCommon.h"
 #include "ASTReaderInternals.h"
+#include "ASTRecordPrefetcher.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/ASTMutationListener.h"
@@ -83,6 +84,7 @@
 #include "clang/Serialization/GlobalModuleIndex.h"
 #include "clang/Serialization/InMemoryModuleCache.h"
 #include "clang/Serialization/ModuleFile.h"
+#include "clang/Serialization/ModuleFileChunks.h"
 #include "clang/Serialization/ModuleFileExtension.h"
 #include "clang/Serialization/ModuleManager.h"
 #include "clang/Serialization/PCHContainerOperations.h"
@@ -4249,6 +4251,10 @@ ASTReader::ASTReadResult ASTReader::ReadAST(StringRef FileName,
           ReadASTCore(FileName, Type, ImportLoc,
                       /*ImportedBy=*/nullptr, Loaded, 0, 0, ASTFileSignature(),
                       ClientLoadCapabilities)) {
+    // The records being decoded ahead of time may belong to the modules being
+    // removed.
+    if (Prefetcher)
+      Prefetcher->clear();
     ModuleMgr.removeModules(ModuleMgr.begin() + NumModules,
                             PP.getLangOpts().Modules
                                 ? &PP.getHeaderSearchInfo().getModuleMap()
@@ -4300,12 +4306,19 @@ ASTReader::ASTReadResult ASTReader::ReadAST(StringRef FileName,
     GlobalBitOffsetsMap.insert(std::make_pair(F.GlobalBitOffset, &F));
   }
 
-  // Preload source locations and interesting indentifiers.
+  // Preload source locations and interesting indentifiers. When loading
+  // lazily, source location entries are read when they are first used, and
+  // only the identifiers that already exist are marked out of date: the
+  // others are looked up in the AST files when they are created.
+  bool LazyLoad =
+      PP.getHeaderSearchInfo().getHeaderSearchOpts().ModulesLazyLoad;
+  IdentifierTable &Idents = PP.getIdentifierTable();
   for (ImportedModule &M : Loaded) {
     ModuleFile &F = *M.Mod;
 
     // Preload SLocEntries.
-    for (unsigned I = 0, N = F.PreloadSLocEntries.size(); I != N; ++I) {
+    for (unsigned I = 0, N = LazyLoad ? 0 : F.PreloadSLocEntries.size(); I != N;
+         ++I) {
       int Index = int(F.PreloadSLocEntries[I] - 1) + F.SLocEntryBaseID;
       // Load it through the SourceManager and don't call ReadSLocEntry()
       // directly because the entry may have already been loaded in which case
@@ -4329,7 +4342,9 @@ ASTReader::ASTReadResult ASTReader::ReadAST(StringRef FileName,
       ASTIdentifierLookupTrait Trait(*this, F);
       auto KeyDataLen = Trait.ReadKeyDataLength(Data);
       auto Key = Trait.ReadKey(Data, KeyDataLen.first);
-      auto &II = PP.getIdentifierTable().getOwn(Key);
+      if (LazyLoad && Idents.find(Key) == Idents.end())
+        continue;
+      auto &II = Idents.getOwn(Key);
       II.setOutOfDate(true);
 
       // Mark this identifier as being from an AST file so that we can track
@@ -5080,6 +5095,11 @@ std::string ASTReader::getOriginalSourceFile(
         << ASTFileName << Buffer.getError().message();
     return std::string();
   }
+  if (llvm::Error Err = expandChunkedModuleFile(*Buffer)) {
+    Diags.Report(diag::err_fe_unable_to_read_pch_file)
+        << ASTFileName << toString(std::move(Err));
+    return std::string();
+  }
 
   // Initialize the stream
   BitstreamCursor Stream(PCHContainerRdr.ExtractPCH(**Buffer));
@@ -5190,6 +5210,10 @@ bool ASTReader::readASTFileControlBlock(
   if (!Buffer) {
     return true;
   }
+  if (llvm::Error Err = expandChunkedModuleFile(*Buffer)) {
+    consumeError(std::move(Err));
+    return true;
+  }
 
   // Initialize the stream
   StringRef Bytes = PCHContainerRdr.ExtractPCH(**Buffer);
@@ -6388,6 +6412,65 @@ void ASTReader::ReadPragmaDiagnosticMappings(DiagnosticsEngine &Diag) {
 }
 
 /// Get the correct cursor and offset for loading a type.
+Expected<unsigned> ASTReader::readDeclsBlockRecord(ASTRecordReader &Record,
+                                                  ModuleFile &F,
+                                                  uint64_t Offset) {
+  BitstreamCursor &Cursor = F.DeclsCursor;
+  ASTRecordPrefetcher::PrefetchedRecord Prefetched;
+  if (Prefetcher && Prefetcher->take(F, Offset, Prefetched)) {
+    if (llvm::Error Err = Cursor.JumpToBit(Prefetched.EndBit))
+      return std::move(Err);
+    Record.setRecord(std::move(Prefetched.Data));
+    return Prefetched.Code;
+  }
+
+  if (llvm::Error Err = Cursor.JumpToBit(Offset))
+    return std::move(Err);
+  Expected<unsigned> Code = Cursor.ReadCode();
+  if (!Code)
+    return Code.takeError();
+  return Record.readRecord(Cursor, Code.get());
+}
+
+/// The number of records following the one being read that are considered
+/// for decoding ahead of time. Records are decoded in batches, and a new
+/// batch is only started once there are enough records in this window that
+/// are neither loaded nor being decoded.
+static const unsigned PrefetchWindow = 4 * ASTRecordPrefetcher::BatchSize;
+
+void ASTReader::prefetchDeclRecords(ModuleFile &F, unsigned LocalIndex) {
+  SmallVector<uint64_t, ASTRecordPrefetcher::BatchSize> Offsets;
+  unsigned End = std::min(F.LocalNumDecls, LocalIndex + 1 + PrefetchWindow);
+  for (unsigned I = LocalIndex + 1;
+       I < End && Offsets.size() != ASTRecordPrefetcher::BatchSize; ++I) {
+    if (DeclsLoaded[F.BaseDeclID + I])
+      continue;
+    uint64_t Offset = F.DeclOffsets[I].getBitOffset(F.DeclsBlockStartOffset);
+    if (!Prefetcher->isScheduled(F, Offset))
+      Offsets.push_back(Offset);
+  }
+  if (Offsets.size() == ASTRecordPrefetcher::BatchSize ||
+      End == F.LocalNumDecls)
+    Prefetcher->schedule(F, Offsets);
+}
+
+void ASTReader::prefetchTypeRecords(ModuleFile &F, unsigned LocalIndex) {
+  SmallVector<uint64_t, ASTRecordPrefetcher::BatchSize> Offsets;
+  unsigned End = std::min(F.LocalNumTypes, LocalIndex + 1 + PrefetchWindow);
+  for (unsigned I = LocalIndex + 1;
+       I < End && Offsets.size() != ASTRecordPrefetcher::BatchSize; ++I) {
+    if (!TypesLoaded[F.BaseTypeIndex + I].isNull())
+      continue;
+    uint64_t Offset =
+        F.TypeOffsets[I].getBitOffset() + F.DeclsBlockStartOffset;
+    if (!Prefetcher->isScheduled(F, Offset))
+      Offsets.push_back(Offset);
+  }
+  if (Offsets.size() == ASTRecordPrefetcher::BatchSize ||
+      End == F.LocalNumTypes)
+    Prefetcher->schedule(F, Offsets);
+}
+
 ASTReader::RecordLocation ASTReader::TypeCursorForIndex(unsigned Index) {
   GlobalTypeMapType::iterator I = GlobalTypeMap.find(Index);
   assert(I != GlobalTypeMap.end() && "Corrupted global type map");
@@ -6427,22 +6510,14 @@ QualType ASTReader::readTypeRecord(unsigned Index) {
   // Note that we are loading a type record.
   Deserializing AType(this);
 
-  if (llvm::Error Err = DeclsCursor.JumpToBit(Loc.Offset)) {
-    Error(std::move(Err));
-    return QualType();
-  }
-  Expected<unsigned> RawCode = DeclsCursor.ReadCode();
-  if (!RawCode) {
-    Error(RawCode.takeError());
-    return QualType();
-  }
-
   ASTRecordReader Record(*this, *Loc.F);
-  Expected<unsigned> Code = Record.readRecord(DeclsCursor, RawCode.get());
+  Expected<unsigned> Code = readDeclsBlockRecord(Record, *Loc.F, Loc.Offset);
   if (!Code) {
     Error(Code.takeError());
     return QualType();
   }
+  if (Prefetcher)
+    prefetchTypeRecords(*Loc.F, Index - Loc.F->BaseTypeIndex);
   if (Code.get() == TYPE_EXT_QUAL) {
     QualType baseType = Record.readQualType();
     Qualifiers quals = Record.readQualifiers();
@@ -11609,6 +11684,7 @@ ASTReader::ASTReader(Preprocessor &PP, InMemoryModuleCache &ModuleCache,
       ValidateSystemInputs(ValidateSystemInputs),
       ValidateASTInputFilesContent(ValidateASTInputFilesContent),
       UseGlobalIndex(UseGlobalIndex), CurrSwitchCaseStmts(&SwitchCaseStmts) {
+  Prefetcher = ASTRecordPrefetcher::create();
   SourceMgr.setExternalSLocEntrySource(this);
 
   for (const auto &Ext : Extensions) {
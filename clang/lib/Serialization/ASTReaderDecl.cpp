@@ -3526,22 +3526,16 @@ Decl *ASTReader::ReadDeclRecord(DeclID ID) {
                              ": " + toString(std::move(Err)));
   };
 
-  if (llvm::Error JumpFailed = DeclsCursor.JumpToBit(Loc.Offset))
-    Fail("jumping", std::move(JumpFailed));
   ASTRecordReader Record(*this, *Loc.F);
   ASTDeclReader Reader(*this, Record, Loc, ID, DeclLoc);
-  Expected<unsigned> MaybeCode = DeclsCursor.ReadCode();
-  if (!MaybeCode)
-    Fail("reading code", MaybeCode.takeError());
-  unsigned Code = MaybeCode.get();
-
   ASTContext &Context = getContext();
   Decl *D = nullptr;
-  Expected<unsigned> MaybeDeclCode = Record.readRecord(DeclsCursor, Code);
+  Expected<unsigned> MaybeDeclCode =
+      readDeclsBlockRecord(Record, *Loc.F, Loc.Offset);
   if (!MaybeDeclCode)
-    llvm::report_fatal_error(
-        Twine("ASTReader::readDeclRecord failed reading decl code: ") +
-        toString(MaybeDeclCode.takeError()));
+    Fail("reading decl record", MaybeDeclCode.takeError());
+  if (Prefetcher)
+    prefetchDeclRecords(*Loc.F, ID - Loc.F->BaseDeclID - NUM_PREDEF_DECL_IDS);
   switch ((DeclCode)MaybeDeclCode.get()) {
   case DECL_CONTEXT_LEXICAL:
   case DECL_CONTEXT_VISIBLE:
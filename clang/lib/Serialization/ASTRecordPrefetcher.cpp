@@ -0,0 +1,111 @@
+//===- ASTRecordPrefetcher.cpp - Read AST records ahead of time -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the ASTRecordPrefetcher class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ASTRecordPrefetcher.h"
+#include "clang/Serialization/ModuleFile.h"
+#include "llvm/Bitstream/BitstreamReader.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace clang;
+using namespace clang::serialization;
+
+static llvm::cl::opt<unsigned> ASTReaderThreads(
+    "ast-reader-threads", llvm::cl::init(1), llvm::cl::Hidden,
+    llvm::cl::desc("Number of threads decoding declaration and type records "
+                   "of AST files ahead of their deserialization (0 = all "
+                   "hardware threads)"));
+
+std::unique_ptr<ASTRecordPrefetcher> ASTRecordPrefetcher::create() {
+  if (ASTReaderThreads == 1)
+    return nullptr;
+  return std::make_unique<ASTRecordPrefetcher>(ASTReaderThreads);
+}
+
+ASTRecordPrefetcher::ASTRecordPrefetcher(unsigned NumThreads)
+    : Pool(llvm::hardware_concurrency(NumThreads)) {}
+
+ASTRecordPrefetcher::~ASTRecordPrefetcher() { Pool.wait(); }
+
+void ASTRecordPrefetcher::schedule(ModuleFile &F,
+                                   ArrayRef<uint64_t> BitOffsets) {
+  if (BitOffsets.empty())
+    return;
+  if (Pending.size() + BitOffsets.size() > MaxPending) {
+    dropDecodedBatches();
+    if (Pending.size() + BitOffsets.size() > MaxPending)
+      return;
+  }
+
+  auto B = std::make_shared<Batch>();
+  B->Records.resize(BitOffsets.size());
+  for (unsigned I = 0, N = BitOffsets.size(); I != N; ++I)
+    Pending[{&F, BitOffsets[I]}] = {B, I};
+
+  // The task works on its own copy of the cursor. It shares the abbreviations
+  // of the block and the buffer of the module file, which are not modified
+  // while the module file is loaded.
+  Pool.async([B, Cursor = F.DeclsCursor,
+              Offsets = std::vector<uint64_t>(BitOffsets.begin(),
+                                              BitOffsets.end())]() mutable {
+    for (unsigned I = 0, N = Offsets.size(); I != N; ++I) {
+      PrefetchedRecord &R = B->Records[I];
+      if (llvm::Error Err = Cursor.JumpToBit(Offsets[I])) {
+        llvm::consumeError(std::move(Err));
+        continue;
+      }
+      Expected<unsigned> AbbrevID = Cursor.ReadCode();
+      if (!AbbrevID) {
+        llvm::consumeError(AbbrevID.takeError());
+        continue;
+      }
+      Expected<unsigned> Code = Cursor.readRecord(AbbrevID.get(), R.Data);
+      if (!Code) {
+        llvm::consumeError(Code.takeError());
+        continue;
+      }
+      R.Code = Code.get();
+      R.EndBit = Cursor.GetCurrentBitNo();
+      R.Valid = true;
+    }
+    B->Done.store(true, std::memory_order_release);
+  });
+}
+
+bool ASTRecordPrefetcher::take(ModuleFile &F, uint64_t BitOffset,
+                               PrefetchedRecord &Result) {
+  auto It = Pending.find({&F, BitOffset});
+  if (It == Pending.end())
+    return false;
+  std::shared_ptr<Batch> B = std::move(It->second.first);
+  unsigned I = It->second.second;
+  Pending.erase(It);
+
+  // Records that failed to decode are read again by the caller, which reports
+  // the error.
+  if (!B->Done.load(std::memory_order_acquire) || !B->Records[I].Valid)
+    return false;
+  Result = std::move(B->Records[I]);
+  return true;
+}
+
+void ASTRecordPrefetcher::clear() {
+  Pool.wait();
+  Pending.clear();
+}
+
+void ASTRecordPrefetcher::dropDecodedBatches() {
+  for (auto It = Pending.begin(), End = Pending.end(); It != End;) {
+    auto Current = It++;
+    if (Current->second.first->Done.load(std::memory_order_acquire))
+      Pending.erase(Current);
+  }
+}
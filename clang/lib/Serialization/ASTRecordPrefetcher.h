@@ -0,0 +1,110 @@
+//===- ASTRecordPrefetcher.h - Read AST records ahead of time ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the ASTRecordPrefetcher class, which decodes the records
+//  of declarations and types of AST files on a thread pool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_SERIALIZATION_ASTRECORDPREFETCHER_H
+#define LLVM_CLANG_LIB_SERIALIZATION_ASTRECORDPREFETCHER_H
+
+#include "clang/Serialization/ASTReader.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/ThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace clang {
+
+/// Reads the records of declarations and types from the declarations and
+/// types block of AST files before the ASTReader asks for them.
+///
+/// Building a declaration or a type from its record touches the ASTContext,
+/// so it has to happen on the thread that owns the ASTReader. Decoding the
+/// abbreviated record from the bitstream does not, so the reader hands the
+/// offsets of the records it expects to need next to the prefetcher, which
+/// decodes them on its own threads. All the member functions of the
+/// prefetcher are called from the thread that owns the ASTReader.
+class ASTRecordPrefetcher {
+public:
+  /// A record that was decoded ahead of time.
+  struct PrefetchedRecord {
+    /// The code of the record.
+    unsigned Code = 0;
+
+    /// The operands of the record.
+    ASTReader::RecordData Data;
+
+    /// The bit offset just past the end of the record.
+    uint64_t EndBit = 0;
+
+    /// Whether the record was decoded successfully.
+    bool Valid = false;
+  };
+
+  /// The number of records that are decoded by a single task.
+  static constexpr unsigned BatchSize = 16;
+
+  /// The maximum number of records that are decoded ahead of time.
+  static constexpr unsigned MaxPending = 1024;
+
+  /// Creates a prefetcher if -ast-reader-threads asks for more than one
+  /// thread.
+  static std::unique_ptr<ASTRecordPrefetcher> create();
+
+  explicit ASTRecordPrefetcher(unsigned NumThreads);
+  ~ASTRecordPrefetcher();
+
+  /// Returns whether the record at \p BitOffset of \p F is being decoded
+  /// ahead of time.
+  bool isScheduled(serialization::ModuleFile &F, uint64_t BitOffset) const {
+    return Pending.count({&F, BitOffset});
+  }
+
+  /// Starts decoding the records at the given bit offsets of the declarations
+  /// and types block of \p F.
+  void schedule(serialization::ModuleFile &F, ArrayRef<uint64_t> BitOffsets);
+
+  /// Moves the record at \p BitOffset of \p F into \p Result if it has been
+  /// decoded ahead of time. Never waits for a record that is still being
+  /// decoded: the caller reads such records itself.
+  bool take(serialization::ModuleFile &F, uint64_t BitOffset,
+            PrefetchedRecord &Result);
+
+  /// Waits for all the records being decoded and drops them. This must be
+  /// called before module files are removed from the module manager.
+  void clear();
+
+private:
+  /// The records decoded by a single task.
+  struct Batch {
+    std::vector<PrefetchedRecord> Records;
+
+    /// Set by the task once all the records are decoded.
+    std::atomic<bool> Done{false};
+  };
+
+  /// Drops the batches that were decoded but not taken.
+  void dropDecodedBatches();
+
+  llvm::ThreadPool Pool;
+
+  /// The batch and index in that batch of the records being decoded, by
+  /// module file and bit offset.
+  llvm::DenseMap<std::pair<serialization::ModuleFile *, uint64_t>,
+                 std::pair<std::shared_ptr<Batch>, unsigned>>
+      Pending;
+};
+
+} // namespace clang
+
+#endif // LLVM_CLANG_LIB_SERIALIZATION_ASTRECORDPREFETCHER_H
@@ -1524,6 +1524,19 @@ void ASTWriter::WriteInputFiles(
   // Get all ContentCache objects for files, sorted by whether the file is a
   // system one or not. System files go at the back, users files at the front.
   std::deque<InputFileEntry> SortedFiles;
+  auto addSortedFile = [&](const InputFileEntry &Entry) {
+    if (Entry.IsSystemFile)
+      SortedFiles.push_back(Entry);
+    else
+      SortedFiles.push_front(Entry);
+  };
+  auto setContentHash = [](InputFileEntry &Entry, hash_code ContentHash) {
+    auto CH = llvm::APInt(64, ContentHash);
+    Entry.ContentHash[0] =
+        static_cast<uint32_t>(CH.getLoBits(32).getZExtValue());
+    Entry.ContentHash[1] =
+        static_cast<uint32_t>(CH.getHiBits(32).getZExtValue());
+  };
   for (unsigned I = 1, N = SourceMgr.local_sloc_entry_size(); I != N; ++I) {
     // Get this source location entry.
     const SrcMgr::SLocEntry *SLoc = &SourceMgr.getLocalSLocEntry(I);
@@ -1567,16 +1580,31 @@ void ASTWriter::WriteInputFiles(
         PP->Diag(SourceLocation(), diag::err_module_unable_to_hash_content)
             << Entry.File->getName();
     }
-    auto CH = llvm::APInt(64, ContentHash);
-    Entry.ContentHash[0] =
-        static_cast<uint32_t>(CH.getLoBits(32).getZExtValue());
-    Entry.ContentHash[1] =
-        static_cast<uint32_t>(CH.getHiBits(32).getZExtValue());
+    setContentHash(Entry, ContentHash);
+    addSortedFile(Entry);
+  }
 
-    if (Entry.IsSystemFile)
-      SortedFiles.push_back(Entry);
-    else
-      SortedFiles.push_front(Entry);
+  // The headers skipped because of the include guard cache were never
+  // entered, but the AST file depends on them as much as if they had been.
+  HeaderSearch &HS = PP->getHeaderSearchInfo();
+  for (const FileEntry *File : HS.getFilesSkippedByIncludeGuardCache()) {
+    InputFileEntry Entry;
+    Entry.File = File;
+    Entry.IsSystemFile = isSystem(HS.getFileDirFlavor(File));
+    Entry.IsTransient = false;
+    Entry.BufferOverridden = false;
+    Entry.IsTopLevelModuleMap = false;
+
+    auto ContentHash = hash_code(-1);
+    if (HSOpts.ValidateASTInputFilesContent) {
+      if (auto MemBuff = PP->getFileManager().getBufferForFile(File))
+        ContentHash = hash_value((*MemBuff)->getBuffer());
+      else
+        PP->Diag(SourceLocation(), diag::err_module_unable_to_hash_content)
+            << File->getName();
+    }
+    setContentHash(Entry, ContentHash);
+    addSortedFile(Entry);
   }
 
   unsigned UserFilesNum = 0;
@@ -0,0 +1,223 @@
+//===- ModuleFileChunks.cpp - Deduplicated module file storage ------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the storage of module files as lists of
+//  content-defined chunks.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Serialization/ModuleFileChunks.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/BLAKE3.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <array>
+#include <cstring>
+
+using namespace clang;
+
+/// The magic number and version at the start of a chunked module file. The
+/// magic number differs from the one of AST files, so that readers that do
+/// not expand chunked module files reject them.
+static constexpr llvm::StringLiteral ChunkedModuleFileMagic = "CPCK";
+static constexpr uint32_t ChunkedModuleFileVersion = 1;
+
+/// The bounds of the size of a chunk. The average size of a chunk is about
+/// 2^ChunkBoundaryBits bytes past the minimum size.
+static constexpr size_t MinChunkSize = 2 * 1024;
+static constexpr size_t MaxChunkSize = 64 * 1024;
+static constexpr unsigned ChunkBoundaryBits = 13;
+
+using ChunkHash = std::array<uint8_t, 32>;
+
+/// Returns the table of random values of the gear hash used to find chunk
+/// boundaries. The values must never change, or chunks written by different
+/// compilers would stop being shared.
+static const std::array<uint64_t, 256> &getGearTable() {
+  static const std::array<uint64_t, 256> Table = [] {
+    std::array<uint64_t, 256> Result;
+    // SplitMix64, seeded with a fixed value.
+    uint64_t State = 0x6a09e667f3bcc908ULL;
+    for (uint64_t &Value : Result) {
+      uint64_t Z = (State += 0x9e3779b97f4a7c15ULL);
+      Z = (Z ^ (Z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      Z = (Z ^ (Z >> 27)) * 0x94d049bb133111ebULL;
+      Value = Z ^ (Z >> 31);
+    }
+    return Result;
+  }();
+  return Table;
+}
+
+/// Returns the size of the chunk at the start of \p Data. A boundary is placed
+/// after the bytes on which the rolling hash of the last 64 bytes has its top
+/// ChunkBoundaryBits bits clear, so boundaries only depend on the contents
+/// around them and move along with them.
+static size_t getChunkSize(StringRef Data) {
+  if (Data.size() <= MinChunkSize)
+    return Data.size();
+  const std::array<uint64_t, 256> &Gear = getGearTable();
+  size_t End = std::min(Data.size(), MaxChunkSize);
+  uint64_t Hash = 0;
+  for (size_t I = 0; I != End; ++I) {
+    Hash = (Hash << 1) + Gear[static_cast<uint8_t>(Data[I])];
+    if (I >= MinChunkSize && (Hash >> (64 - ChunkBoundaryBits)) == 0)
+      return I + 1;
+  }
+  return End;
+}
+
+static std::string getChunkPath(StringRef ChunkStore, const ChunkHash &Hash) {
+  SmallString<256> Path(ChunkStore);
+  llvm::sys::path::append(Path, llvm::toHex(Hash, /*LowerCase=*/true));
+  return std::string(Path);
+}
+
+/// Stores \p Chunk in \p ChunkStore unless it is there already.
+static llvm::Error storeChunk(StringRef ChunkStore, StringRef Chunk,
+                              const ChunkHash &Hash) {
+  std::string Path = getChunkPath(ChunkStore, Hash);
+  if (llvm::sys::fs::exists(Path))
+    return llvm::Error::success();
+
+  // Write the chunk to a temporary file that is renamed into place, so that
+  // concurrent builds never observe a partial chunk. Another build may store
+  // the same chunk meanwhile, which is fine, since it has the same contents.
+  SmallString<256> Model(ChunkStore);
+  llvm::sys::path::append(Model, "chunk-%%%%%%.tmp");
+  llvm::Expected<llvm::sys::fs::TempFile> Temp =
+      llvm::sys::fs::TempFile::create(Model);
+  if (!Temp)
+    return Temp.takeError();
+  {
+    llvm::raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Chunk;
+    OS.flush();
+    if (std::error_code EC = OS.error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return llvm::createFileError(Path, EC);
+    }
+  }
+  if (llvm::Error E = Temp->keep(Path)) {
+    consumeError(Temp->discard());
+    return E;
+  }
+  return llvm::Error::success();
+}
+
+bool clang::isChunkedModuleFile(StringRef Data) {
+  return Data.startswith(ChunkedModuleFileMagic);
+}
+
+// A chunked module file consists of the magic number, the version, the path of
+// the chunk store, the size of the module file, and the size and hash of each
+// chunk. All integers are little endian.
+llvm::Error clang::writeChunkedModuleFile(llvm::raw_ostream &OS,
+                                          StringRef Data,
+                                          StringRef ChunkStore) {
+  SmallString<256> StorePath(ChunkStore);
+  if (std::error_code EC = llvm::sys::fs::make_absolute(StorePath))
+    return llvm::createFileError(ChunkStore, EC);
+  if (std::error_code EC = llvm::sys::fs::create_directories(StorePath))
+    return llvm::createFileError(StorePath, EC);
+
+  SmallVector<std::pair<uint32_t, ChunkHash>, 64> Chunks;
+  for (StringRef Rest = Data; !Rest.empty();) {
+    StringRef Chunk = Rest.take_front(getChunkSize(Rest));
+    Rest = Rest.drop_front(Chunk.size());
+    ChunkHash Hash = llvm::BLAKE3::hash(llvm::arrayRefFromStringRef(Chunk));
+    if (llvm::Error E = storeChunk(StorePath, Chunk, Hash))
+      return E;
+    Chunks.push_back({Chunk.size(), Hash});
+  }
+
+  llvm::support::endian::Writer W(OS, llvm::support::little);
+  OS << ChunkedModuleFileMagic;
+  W.write<uint32_t>(ChunkedModuleFileVersion);
+  W.write<uint32_t>(StorePath.size());
+  OS << StorePath;
+  W.write<uint64_t>(Data.size());
+  W.write<uint32_t>(Chunks.size());
+  for (const auto &Chunk : Chunks) {
+    W.write<uint32_t>(Chunk.first);
+    OS.write(reinterpret_cast<const char *>(Chunk.second.data()),
+             Chunk.second.size());
+  }
+  return llvm::Error::success();
+}
+
+llvm::Error
+clang::expandChunkedModuleFile(std::unique_ptr<llvm::MemoryBuffer> &Buffer) {
+  StringRef Manifest = Buffer->getBuffer();
+  if (!isChunkedModuleFile(Manifest))
+    return llvm::Error::success();
+
+  StringRef FileName = Buffer->getBufferIdentifier();
+  auto Malformed = [&] {
+    return llvm::createStringError(std::errc::illegal_byte_sequence,
+                                   "malformed chunked module file '%s'",
+                                   FileName.str().c_str());
+  };
+
+  llvm::DataExtractor Data(Manifest, /*IsLittleEndian=*/true,
+                           /*AddressSize=*/8);
+  llvm::DataExtractor::Cursor C(ChunkedModuleFileMagic.size());
+  if (Data.getU32(C) != ChunkedModuleFileVersion) {
+    consumeError(C.takeError());
+    return Malformed();
+  }
+  StringRef ChunkStore = Data.getBytes(C, Data.getU32(C));
+  uint64_t Size = Data.getU64(C);
+  uint32_t NumChunks = Data.getU32(C);
+  if (!C) {
+    consumeError(C.takeError());
+    return Malformed();
+  }
+
+  std::unique_ptr<llvm::WritableMemoryBuffer> Result =
+      llvm::WritableMemoryBuffer::getNewUninitMemBuffer(Size, FileName);
+  if (!Result)
+    return llvm::createStringError(std::errc::not_enough_memory,
+                                   "cannot allocate module file '%s'",
+                                   FileName.str().c_str());
+  uint64_t Offset = 0;
+  for (uint32_t I = 0; I != NumChunks; ++I) {
+    uint32_t ChunkSize = Data.getU32(C);
+    StringRef HashBytes = Data.getBytes(C, sizeof(ChunkHash));
+    if (!C || ChunkSize > Size - Offset) {
+      consumeError(C.takeError());
+      return Malformed();
+    }
+    ChunkHash Hash;
+    std::memcpy(Hash.data(), HashBytes.data(), Hash.size());
+
+    std::string Path = getChunkPath(ChunkStore, Hash);
+    auto Chunk = llvm::MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                             /*RequiresNullTerminator=*/false);
+    if (!Chunk)
+      return llvm::createFileError(Path, Chunk.getError());
+    StringRef Contents = (*Chunk)->getBuffer();
+    if (Contents.size() != ChunkSize ||
+        llvm::BLAKE3::hash(llvm::arrayRefFromStringRef(Contents)) != Hash)
+      return llvm::createStringError(std::errc::illegal_byte_sequence,
+                                     "corrupted chunk '%s'", Path.c_str());
+    std::memcpy(Result->getBufferStart() + Offset, Contents.data(), ChunkSize);
+    Offset += ChunkSize;
+  }
+  if (Offset != Size || !Data.eof(C))
+    return Malformed();
+
+  Buffer = std::move(Result);
+  return llvm::Error::success();
+}
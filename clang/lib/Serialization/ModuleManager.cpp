@@ -15,9 +15,11 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/LLVM.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderSearchOptions.h"
 #include "clang/Lex/ModuleMap.h"
 #include "clang/Serialization/GlobalModuleIndex.h"
 #include "clang/Serialization/InMemoryModuleCache.h"
+#include "clang/Serialization/ModuleFileChunks.h"
 #include "clang/Serialization/ModuleFile.h"
 #include "clang/Serialization/PCHContainerOperations.h"
 #include "llvm/ADT/STLExtras.h"
@@ -210,11 +212,14 @@ ModuleManager::addModule(StringRef FileName, ModuleKind Type,
       // Get a buffer of the file and close the file descriptor when done.
       // The file is volatile because in a parallel build we expect multiple
       // compiler processes to use the same module file rebuilding it if needed.
+      // When loading lazily, the file is mapped anyway so that only the pages
+      // that are used are read: module files are always replaced by renaming
+      // a new file over them, which leaves the mapped file intact.
       //
       // RequiresNullTerminator is false because module files don't need it, and
       // this allows the file to still be mmapped.
-      Buf = FileMgr.getBufferForFile(NewModule->File,
-                                     /*IsVolatile=*/true,
+      bool IsVolatile = !HeaderSearchInfo.getHeaderSearchOpts().ModulesLazyLoad;
+      Buf = FileMgr.getBufferForFile(NewModule->File, IsVolatile,
                                      /*RequiresNullTerminator=*/false);
     }
 
@@ -223,6 +228,13 @@ ModuleManager::addModule(StringRef FileName, ModuleKind Type,
       return Missing;
     }
 
+    // A chunked module file whose chunks were pruned or corrupted has to be
+    // rebuilt.
+    if (llvm::Error Err = expandChunkedModuleFile(*Buf)) {
+      ErrorStr = toString(std::move(Err));
+      return OutOfDate;
+    }
+
     NewModule->Buffer = &getModuleCache().addPCM(FileName, std::move(*Buf));
   }
 
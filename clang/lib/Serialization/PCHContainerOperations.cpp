@@ -13,6 +13,7 @@
 #include "clang/Serialization/PCHContainerOperations.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/Lex/ModuleLoader.h"
+#include "clang/Serialization/ModuleFileChunks.h"
 #include "llvm/Bitstream/BitstreamReader.h"
 #include "llvm/Support/raw_ostream.h"
 #include <utility>
@@ -38,8 +39,12 @@ public:
 
   void HandleTranslationUnit(ASTContext &Ctx) override {
     if (Buffer->IsComplete) {
+      StringRef Data(Buffer->Data.data(), Buffer->Data.size());
+      // If the chunks cannot be stored, write the module file as a whole.
+      if (Buffer->ChunkStore.empty() ||
+          errorToBool(writeChunkedModuleFile(*OS, Data, Buffer->ChunkStore)))
+        *OS << Data;
       // Make sure it hits disk now.
-      *OS << Buffer->Data;
       OS->flush();
     }
     // Free the space of the temporary buffer.
@@ -7,10 +7,19 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Tooling/DependencyScanning/DependencyScanningFilesystem.h"
+#include "clang/Basic/Version.h"
 #include "clang/Lex/DependencyDirectivesSourceMinimizer.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/BLAKE3.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SmallVectorMemoryBuffer.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
 using namespace tooling;
@@ -60,6 +69,23 @@ EntryRef DependencyScanningWorkerFilesystem::minimizeIfNecessary(
   if (Contents->MinimizedAccess.load())
     return EntryRef(/*Minimized=*/true, Filename, Entry);
 
+  // Reuse the minimized contents computed by an earlier scan if possible.
+  const DependencyScanningPersistentCache *PersistentCache =
+      SharedCache.getPersistentCache();
+  if (PersistentCache) {
+    if (Optional<DependencyScanningPersistentCache::Entry> Cached =
+            PersistentCache->lookup(Contents->Original->getBuffer())) {
+      Contents->PPSkippedRangeMapping =
+          std::move(Cached->PPSkippedRangeMapping);
+      Contents->MinimizedStorage = llvm::MemoryBuffer::getMemBuffer(
+          Cached->Minimized, Cached->Storage->getBufferIdentifier());
+      Contents->PersistentStorage = std::move(Cached->Storage);
+      // See the comment on assigning `MinimizedAccess` below.
+      Contents->MinimizedAccess.store(Contents->MinimizedStorage.get());
+      return EntryRef(/*Minimized=*/true, Filename, Entry);
+    }
+  }
+
   llvm::SmallString<1024> MinimizedFileContents;
   // Minimize the file down to directives that might affect the dependencies.
   SmallVector<minimize_source_to_dependency_directives::Token, 64> Tokens;
@@ -93,6 +119,9 @@ EntryRef DependencyScanningWorkerFilesystem::minimizeIfNecessary(
     }
     Mapping[Range.Offset] = Range.Length;
   }
+  if (PersistentCache)
+    PersistentCache->store(Contents->Original->getBuffer(),
+                           MinimizedFileContents, Mapping);
   Contents->PPSkippedRangeMapping = std::move(Mapping);
 
   Contents->MinimizedStorage = std::make_unique<llvm::SmallVectorMemoryBuffer>(
@@ -106,6 +135,119 @@ EntryRef DependencyScanningWorkerFilesystem::minimizeIfNecessary(
   return EntryRef(/*Minimized=*/true, Filename, Entry);
 }
 
+/// The magic number and version at the start of a persistent cache entry.
+static constexpr llvm::StringLiteral PersistentCacheMagic = "SDMC";
+static constexpr uint32_t PersistentCacheVersion = 1;
+
+llvm::Expected<std::unique_ptr<DependencyScanningPersistentCache>>
+DependencyScanningPersistentCache::create(StringRef Directory) {
+  if (std::error_code EC = llvm::sys::fs::create_directories(Directory))
+    return llvm::createFileError(Directory, EC);
+  return std::unique_ptr<DependencyScanningPersistentCache>(
+      new DependencyScanningPersistentCache(Directory));
+}
+
+std::string
+DependencyScanningPersistentCache::getEntryPath(StringRef Original) const {
+  // Entries written by a different clang or minimizer may not match what this
+  // one would produce, so both versions are part of the key.
+  llvm::BLAKE3 Hasher;
+  unsigned MinimizerVersion = minimize_source_to_dependency_directives::Version;
+  Hasher.update(getClangFullRepositoryVersion() + '\0' +
+                llvm::utostr(MinimizerVersion) + '\0');
+  Hasher.update(Original);
+  auto Hash = Hasher.final<16>();
+  SmallString<256> Path(Directory);
+  llvm::sys::path::append(Path, "llvmcache-scan-deps-" +
+                                    llvm::toHex(Hash, /*LowerCase=*/true));
+  return std::string(Path);
+}
+
+// An entry consists of the magic number, the version, the size of the original
+// contents, the skipped range mapping as pairs of offset and length, and the
+// minimized contents followed by a null terminator. All integers are little
+// endian.
+Optional<DependencyScanningPersistentCache::Entry>
+DependencyScanningPersistentCache::lookup(StringRef Original) const {
+  auto MaybeBuffer = llvm::MemoryBuffer::getFile(
+      getEntryPath(Original), /*IsText=*/false,
+      /*RequiresNullTerminator=*/false);
+  if (!MaybeBuffer)
+    return None;
+
+  Entry Result;
+  Result.Storage = std::move(*MaybeBuffer);
+  llvm::DataExtractor Data(Result.Storage->getBuffer(),
+                           /*IsLittleEndian=*/true, /*AddressSize=*/8);
+  llvm::DataExtractor::Cursor C(0);
+  if (Data.getBytes(C, PersistentCacheMagic.size()) != PersistentCacheMagic ||
+      Data.getU32(C) != PersistentCacheVersion ||
+      Data.getU64(C) != Original.size()) {
+    consumeError(C.takeError());
+    return None;
+  }
+  uint32_t NumRanges = Data.getU32(C);
+  for (uint32_t I = 0; I != NumRanges && C; ++I) {
+    uint32_t Offset = Data.getU32(C);
+    Result.PPSkippedRangeMapping[Offset] = Data.getU32(C);
+  }
+  uint32_t Size = Data.getU32(C);
+  Result.Minimized = Data.getBytes(C, Size);
+  // The minimized contents must be null terminated, and nothing may follow
+  // them.
+  if (Data.getU8(C) != '\0' || !C || !Data.eof(C)) {
+    consumeError(C.takeError());
+    return None;
+  }
+  return Result;
+}
+
+void DependencyScanningPersistentCache::store(
+    StringRef Original, StringRef Minimized,
+    const PreprocessorSkippedRangeMapping &Mapping) const {
+  // Write the entry to a temporary file that is renamed into place, so that
+  // concurrent scans never observe a partial entry. The temporary file isn't
+  // named like an entry, so that pruning the cache doesn't remove it.
+  SmallString<256> Model(Directory);
+  llvm::sys::path::append(Model, "scan-deps-%%%%%%.tmp");
+  llvm::Expected<llvm::sys::fs::TempFile> Temp =
+      llvm::sys::fs::TempFile::create(Model);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+
+  bool WriteFailed;
+  {
+    llvm::raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    llvm::support::endian::Writer W(OS, llvm::support::little);
+    OS << PersistentCacheMagic;
+    W.write<uint32_t>(PersistentCacheVersion);
+    W.write<uint64_t>(Original.size());
+    W.write<uint32_t>(Mapping.size());
+    for (const auto &Range : Mapping) {
+      W.write<uint32_t>(Range.first);
+      W.write<uint32_t>(Range.second);
+    }
+    W.write<uint32_t>(Minimized.size());
+    OS << Minimized << '\0';
+    OS.flush();
+    WriteFailed = OS.has_error();
+    OS.clear_error();
+  }
+
+  if (WriteFailed) {
+    consumeError(Temp->discard());
+    return;
+  }
+  // Another scan may have stored the same entry meanwhile, which is fine,
+  // since it has the same contents.
+  if (llvm::Error E = Temp->keep(getEntryPath(Original))) {
+    consumeError(std::move(E));
+    consumeError(Temp->discard());
+  }
+}
+
 DependencyScanningFilesystemSharedCache::
     DependencyScanningFilesystemSharedCache() {
   // This heuristic was chosen using a empirical testing on a
@@ -131,6 +273,51 @@ DependencyScanningFilesystemSharedCache::getShardForUID(
   return CacheShards[Hash % NumShards];
 }
 
+void DependencyScanningFilesystemSharedCache::invalidate(
+    ArrayRef<std::string> Filenames) {
+  // The entries of the files that the filenames refer to. Other filenames may
+  // refer to the same files, e.g. through symlinks, so they must go as well.
+  llvm::SmallPtrSet<const CachedFileSystemEntry *, 8> Removed;
+  for (const std::string &Filename : Filenames) {
+    const CachedFileSystemEntry *Entry;
+    {
+      CacheShard &Shard = getShardForFilename(Filename);
+      std::lock_guard<std::mutex> LockGuard(Shard.CacheLock);
+      auto It = Shard.EntriesByFilename.find(Filename);
+      if (It == Shard.EntriesByFilename.end())
+        continue;
+      Entry = It->getValue();
+      Shard.EntriesByFilename.erase(It);
+    }
+    if (Entry->isError())
+      continue;
+    Removed.insert(Entry);
+
+    CacheShard &Shard = getShardForUID(Entry->getUniqueID());
+    std::lock_guard<std::mutex> LockGuard(Shard.CacheLock);
+    auto It = Shard.EntriesByUID.find(Entry->getUniqueID());
+    if (It != Shard.EntriesByUID.end() && It->second == Entry)
+      Shard.EntriesByUID.erase(It);
+  }
+
+  if (!Removed.empty()) {
+    for (unsigned I = 0; I < NumShards; ++I) {
+      CacheShard &Shard = CacheShards[I];
+      std::lock_guard<std::mutex> LockGuard(Shard.CacheLock);
+      for (auto It = Shard.EntriesByFilename.begin(),
+                End = Shard.EntriesByFilename.end();
+           It != End;) {
+        auto Current = It++;
+        if (Removed.count(Current->getValue()))
+          Shard.EntriesByFilename.erase(Current);
+      }
+    }
+  }
+  // Only bump the generation once the entries are gone, so that workers that
+  // observe it can't pick the stale entries up again.
+  ++Generation;
+}
+
 const CachedFileSystemEntry *
 DependencyScanningFilesystemSharedCache::CacheShard::findEntryByFilename(
     StringRef Filename) const {
@@ -253,11 +440,18 @@ DependencyScanningWorkerFilesystem::computeAndStoreResult(StringRef Filename) {
       return Stat.getError();
     const auto &Entry =
         getOrEmplaceSharedEntryForFilename(Filename, Stat.getError());
+    SharedCache.notifyFilenameAdded(Filename);
     return insertLocalEntryForFilename(Filename, Entry);
   }
 
-  if (const auto *Entry = findSharedEntryByUID(*Stat))
-    return insertLocalEntryForFilename(Filename, *Entry);
+  if (const auto *Entry = findSharedEntryByUID(*Stat)) {
+    // Associate the filename with the entry in the shared cache as well, so
+    // that invalidating the filename also invalidates the entry.
+    const auto &SharedEntry =
+        getOrInsertSharedEntryForFilename(Filename, *Entry);
+    SharedCache.notifyFilenameAdded(Filename);
+    return insertLocalEntryForFilename(Filename, SharedEntry);
+  }
 
   auto TEntry =
       Stat->isDirectory() ? TentativeEntry(*Stat) : readFile(Filename);
@@ -270,6 +464,7 @@ DependencyScanningWorkerFilesystem::computeAndStoreResult(StringRef Filename) {
     return &getOrEmplaceSharedEntryForFilename(Filename, TEntry.getError());
   }();
 
+  SharedCache.notifyFilenameAdded(Filename);
   return insertLocalEntryForFilename(Filename, *SharedEntry);
 }
 
@@ -272,7 +272,9 @@ private:
 
 DependencyScanningWorker::DependencyScanningWorker(
     DependencyScanningService &Service)
-    : Format(Service.getFormat()), OptimizeArgs(Service.canOptimizeArgs()) {
+    : SharedCache(Service.getSharedCache()),
+      SharedCacheGeneration(SharedCache.getGeneration()),
+      Format(Service.getFormat()), OptimizeArgs(Service.canOptimizeArgs()) {
   PCHContainerOps = std::make_shared<PCHContainerOperations>();
   PCHContainerOps->registerReader(
       std::make_unique<ObjectFilePCHContainerReader>());
@@ -315,6 +317,17 @@ runWithDiags(DiagnosticOptions *DiagOpts,
 llvm::Error DependencyScanningWorker::computeDependencies(
     StringRef WorkingDirectory, const std::vector<std::string> &CommandLine,
     DependencyConsumer &Consumer, llvm::Optional<StringRef> ModuleName) {
+  // Forget what was cached about files that changed since the previous worker
+  // invocation.
+  uint64_t Generation = SharedCache.getGeneration();
+  if (Generation != SharedCacheGeneration) {
+    SharedCacheGeneration = Generation;
+    if (DepFS)
+      DepFS->clearLocalCache();
+    if (Files)
+      Files = new FileManager(FileSystemOptions(), RealFS);
+  }
+
   // Reset what might have been modified in the previous worker invocation.
   RealFS->setCurrentWorkingDirectory(WorkingDirectory);
   if (Files)
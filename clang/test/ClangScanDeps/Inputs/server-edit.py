@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+"""Scans main.c with clang-scan-deps -server, edits the headers it includes
+between the scans, and prints the dependencies the server reports.
+
+Usage: server-edit.py <clang-scan-deps> <directory>
+"""
+
+import json
+import os
+import subprocess
+import sys
+import time
+
+scan_deps, directory = sys.argv[1], sys.argv[2]
+server = subprocess.Popen([scan_deps, '-server', '-j', '1'],
+                          stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                          universal_newlines=True)
+next_id = [0]
+
+
+def scan():
+    request = {'id': next_id[0], 'directory': directory,
+               'arguments': ['clang', '-c', 'main.c', '-o', 'main.o']}
+    next_id[0] += 1
+    server.stdin.write(json.dumps(request) + '\n')
+    server.stdin.flush()
+    response = json.loads(server.stdout.readline())
+    if 'error' in response:
+        sys.exit('error: ' + response['error'])
+    return response['dependencies'].replace('\\\n', ' ').split()
+
+
+def edit(header, include):
+    with open(os.path.join(directory, header), 'w') as f:
+        f.write('#include "%s"\n' % include)
+
+
+def scan_until(header):
+    # The watcher reports changes asynchronously, so give it some time.
+    deadline = time.time() + 30
+    while True:
+        deps = scan()
+        if any(os.path.basename(d) == header for d in deps) or \
+                time.time() > deadline:
+            return deps
+        time.sleep(0.1)
+
+
+def show(deps):
+    print(' '.join(sorted(os.path.basename(d) for d in deps[1:])))
+
+
+show(scan())
+# The second scan watches the directory of the files cached by the first.
+show(scan())
+
+# a.h is cached and its directory is watched.
+edit('a.h', 'b.h')
+show(scan_until('b.h'))
+
+# b.h was cached by the previous scan only, after its directory was watched.
+edit('b.h', 'c.h')
+show(scan_until('c.h'))
+
+server.stdin.close()
+sys.exit(server.wait())
@@ -0,0 +1,15 @@
+// Check that the server mode sees the headers that were edited between scans.
+
+// REQUIRES: shell
+// RUN: rm -rf %t.dir
+// RUN: mkdir -p %t.dir
+// RUN: cp %s %t.dir/main.c
+// RUN: touch %t.dir/a.h %t.dir/b.h %t.dir/c.h
+// RUN: %python %S/Inputs/server-edit.py clang-scan-deps %t.dir | FileCheck %s
+
+#include "a.h"
+
+// CHECK:      a.h main.c
+// CHECK-NEXT: a.h main.c
+// CHECK-NEXT: a.h b.h main.c
+// CHECK-NEXT: a.h b.h c.h main.c
@@ -0,0 +1,28 @@
+// REQUIRES: x86-registered-target
+
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-obj -fdata-sections \
+// RUN:   -fparallel-codegen=2 %s -o %t.o
+// RUN: llvm-readelf -S -s %t.o | FileCheck %s
+
+/// The partitions together have more sections than symbols can refer to
+/// without an extended section index table, which the combined object can't
+/// have. The module is code generated as a whole instead, with its local
+/// symbols still local.
+
+// CHECK: .symtab_shndx
+// CHECK: OBJECT LOCAL DEFAULT {{.*}} counter
+// CHECK: OBJECT GLOBAL DEFAULT {{.*}} va00000000
+
+#define V(x) int v##x = 1;
+#define V4(x) V(x##0) V(x##1) V(x##2) V(x##3)
+#define V16(x) V4(x##0) V4(x##1) V4(x##2) V4(x##3)
+#define V64(x) V16(x##0) V16(x##1) V16(x##2) V16(x##3)
+#define V256(x) V64(x##0) V64(x##1) V64(x##2) V64(x##3)
+#define V1K(x) V256(x##0) V256(x##1) V256(x##2) V256(x##3)
+#define V4K(x) V1K(x##0) V1K(x##1) V1K(x##2) V1K(x##3)
+#define V16K(x) V4K(x##0) V4K(x##1) V4K(x##2) V4K(x##3)
+#define V64K(x) V16K(x##0) V16K(x##1) V16K(x##2) V16K(x##3)
+V64K(a)
+
+static int counter = 1;
+int *get_counter(void) { return &counter; }
@@ -0,0 +1,31 @@
+// REQUIRES: x86-registered-target
+
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-obj \
+// RUN:   -fparallel-codegen=4 %s -o %t.o
+// RUN: llvm-nm %t.o | FileCheck %s --check-prefix=NM
+// RUN: llvm-nm -u %t.o | count 0
+// RUN: llvm-objdump -dr %t.o | FileCheck %s --check-prefix=RELOCS
+
+/// The objects of the partitions are combined into one object in which each
+/// symbol is defined once, the static ones are local again, and the calls
+/// between partitions refer to the combined symbols.
+
+// NM: b counter
+// NM: T get_name
+// NM: t inc
+// NM: t name
+// NM: T thrice
+// NM: T twice
+
+// RELOCS-LABEL: <twice>:
+// RELOCS:         R_X86_64_PLT32 inc-0x4
+// RELOCS-LABEL: <thrice>:
+// RELOCS:         R_X86_64_PLT32 twice-0x4
+// RELOCS:         R_X86_64_PLT32 inc-0x4
+
+static int counter;
+static int inc(void) { return ++counter; }
+int twice(void) { return inc() + inc(); }
+int thrice(void) { return twice() + inc(); }
+static const char *name(void) { return "name"; }
+const char *get_name(void) { return name(); }
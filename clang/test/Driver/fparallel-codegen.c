@@ -0,0 +1,6 @@
+// RUN: %clang -### -c -fparallel-codegen=4 %s 2>&1 | FileCheck %s
+// RUN: %clang -### -c %s 2>&1 | FileCheck --check-prefix=NONE %s
+
+// CHECK: "-cc1"
+// CHECK-SAME: "-fparallel-codegen=4"
+// NONE-NOT: "-fparallel-codegen
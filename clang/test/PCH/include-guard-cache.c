@@ -0,0 +1,30 @@
+// A header skipped because of the include guard cache while building a PCH is
+// still an input of the PCH, which is out of date once the header changes.
+
+// RUN: rm -rf %t && split-file %s %t
+// RUN: %clang_cc1 -include-guard-cache %t/guards -fsyntax-only %t/prime.c
+// RUN: %clang_cc1 -include-guard-cache %t/guards -x c-header -emit-pch \
+// RUN:   -o %t/prefix.pch %t/prefix.h
+// RUN: %clang_cc1 -include-pch %t/prefix.pch -fsyntax-only %t/use.c
+// RUN: echo "int more;" >> %t/a.h
+// RUN: not %clang_cc1 -include-pch %t/prefix.pch -fsyntax-only %t/use.c 2>&1 \
+// RUN:   | FileCheck %s
+
+// CHECK: file '{{.*}}a.h' has been modified since the precompiled header
+
+//--- a.h
+#ifndef A_H
+#define A_H
+int a;
+#endif
+
+//--- prime.c
+#include "a.h"
+
+//--- prefix.h
+#define A_H
+#include "a.h"
+int prefix;
+
+//--- use.c
+int use(void) { return prefix; }
@@ -6,6 +6,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "clang/DirectoryWatcher/DirectoryWatcher.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/DependencyScanning/DependencyScanningService.h"
@@ -22,6 +23,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
@@ -183,14 +185,28 @@ llvm::cl::opt<unsigned>
 
 llvm::cl::opt<std::string>
     CompilationDB("compilation-database",
-                  llvm::cl::desc("Compilation database"), llvm::cl::Required,
+                  llvm::cl::desc("Compilation database"),
                   llvm::cl::cat(DependencyScannerCategory));
 
+llvm::cl::opt<bool> ServerMode(
+    "server",
+    llvm::cl::desc("Instead of scanning a compilation database, read scan "
+                   "requests from stdin and write the results to stdout, one "
+                   "JSON object per line. Cached files are invalidated when "
+                   "they change on disk."),
+    llvm::cl::init(false), llvm::cl::cat(DependencyScannerCategory));
+
 llvm::cl::opt<bool> ReuseFileManager(
     "reuse-filemanager",
     llvm::cl::desc("Reuse the file manager and its cache between invocations."),
     llvm::cl::init(true), llvm::cl::cat(DependencyScannerCategory));
 
+llvm::cl::opt<std::string> PersistentCachePath(
+    "persistent-cache-path", llvm::cl::Optional,
+    llvm::cl::desc("Directory of a cache of minimized sources that is shared "
+                   "with other invocations of clang-scan-deps"),
+    llvm::cl::cat(DependencyScannerCategory));
+
 llvm::cl::opt<std::string> ModuleName(
     "module-name", llvm::cl::Optional,
     llvm::cl::desc("the module of which the dependencies are to be computed"),
@@ -426,31 +442,325 @@ static bool handleFullDependencyToolResult(
   return false;
 }
 
+namespace {
+
+/// Watches the directories of the files cached by the dependency scanning
+/// service, and invalidates the cached state of the files that change on disk.
+class CacheInvalidator {
+public:
+  CacheInvalidator(DependencyScanningFilesystemSharedCache &SharedCache)
+      : SharedCache(SharedCache) {
+    SharedCache.setFilenameAddedCallback(
+        [this](StringRef Filename) { addFile(Filename); });
+  }
+
+  ~CacheInvalidator() { SharedCache.setFilenameAddedCallback(nullptr); }
+
+  /// Starts watching the directories of the files that were cached since the
+  /// previous call, and invalidates the files that can't be watched. This
+  /// must be called before each scan, but not concurrently with itself.
+  void update();
+
+private:
+  /// The state of a directory that contains cached files.
+  struct Directory {
+    /// The watcher of the directory, or null if it isn't watched yet.
+    std::unique_ptr<DirectoryWatcher> Watcher;
+    /// Whether the watcher stopped working and must be recreated.
+    bool Stale = false;
+    /// Maps the names of the cached files in the directory to their full
+    /// filenames in the cache.
+    llvm::StringMap<std::string> Files;
+  };
+
+  /// Records a file that was added to the cache. If its directory is known
+  /// already, the file is registered right away, so that changes to it are
+  /// seen even before the next call to \c update.
+  void addFile(StringRef Filename) {
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    StringRef Dir = llvm::sys::path::parent_path(Filename);
+    if (llvm::sys::path::is_absolute(Filename) && !Dir.empty()) {
+      auto It = Directories.find(Dir);
+      if (It != Directories.end()) {
+        It->second.Files[llvm::sys::path::filename(Filename)] = Filename.str();
+        return;
+      }
+    }
+    PendingFiles.push_back(Filename.str());
+  }
+
+  /// Invalidates the files affected by the given events.
+  void handleEvents(StringRef Dir, ArrayRef<DirectoryWatcher::Event> Events);
+
+  DependencyScanningFilesystemSharedCache &SharedCache;
+
+  /// The mutex that must be locked before accessing the members below.
+  std::mutex Lock;
+  llvm::StringMap<Directory> Directories;
+  std::vector<std::string> PendingFiles;
+};
+
+} // end anonymous namespace
+
+void CacheInvalidator::update() {
+  std::vector<std::string> Unwatched;
+  std::vector<std::string> NewDirectories;
+  std::vector<std::unique_ptr<DirectoryWatcher>> StaleWatchers;
+  {
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    for (std::string &Filename : PendingFiles) {
+      StringRef Dir = llvm::sys::path::parent_path(Filename);
+      // Relative filenames can't be mapped to a directory reliably.
+      if (!llvm::sys::path::is_absolute(Filename) || Dir.empty()) {
+        Unwatched.push_back(std::move(Filename));
+        continue;
+      }
+      Directory &D = Directories[Dir];
+      if (!D.Watcher && D.Files.empty())
+        NewDirectories.push_back(Dir.str());
+      D.Files[llvm::sys::path::filename(Filename)] = std::move(Filename);
+    }
+    PendingFiles.clear();
+
+    for (auto &Entry : Directories) {
+      if (!Entry.second.Stale)
+        continue;
+      StaleWatchers.push_back(std::move(Entry.second.Watcher));
+      Entry.second.Stale = false;
+      NewDirectories.push_back(Entry.first().str());
+    }
+  }
+  // Destroy the stale watchers without holding the lock, since that waits for
+  // their event handlers.
+  StaleWatchers.clear();
+
+  for (const std::string &Dir : NewDirectories) {
+    std::unique_ptr<DirectoryWatcher> Watcher;
+    if (llvm::sys::fs::is_directory(Dir)) {
+      auto MaybeWatcher = DirectoryWatcher::create(
+          Dir,
+          [this, Dir](ArrayRef<DirectoryWatcher::Event> Events,
+                      bool IsInitial) { handleEvents(Dir, Events); },
+          /*WaitForInitialSync=*/false);
+      if (MaybeWatcher)
+        Watcher = std::move(*MaybeWatcher);
+      else
+        llvm::consumeError(MaybeWatcher.takeError());
+    }
+
+    // The files were cached before the directory was watched, so they may
+    // already be out of date. If the directory can't be watched, forget about
+    // it until its files are cached again.
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    Directory &D = Directories[Dir];
+    for (auto &File : D.Files)
+      Unwatched.push_back(std::move(File.second));
+    D.Files.clear();
+    if (Watcher)
+      D.Watcher = std::move(Watcher);
+    else
+      Directories.erase(Dir);
+  }
+
+  if (!Unwatched.empty())
+    SharedCache.invalidate(Unwatched);
+}
+
+void CacheInvalidator::handleEvents(StringRef Dir,
+                                    ArrayRef<DirectoryWatcher::Event> Events) {
+  std::vector<std::string> Changed;
+  {
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    auto It = Directories.find(Dir);
+    if (It == Directories.end())
+      return;
+    Directory &D = It->second;
+    for (const DirectoryWatcher::Event &Event : Events) {
+      switch (Event.Kind) {
+      case DirectoryWatcher::Event::EventKind::Modified:
+      case DirectoryWatcher::Event::EventKind::Removed: {
+        auto File = D.Files.find(Event.Filename);
+        if (File == D.Files.end())
+          break;
+        Changed.push_back(std::move(File->second));
+        D.Files.erase(File);
+        break;
+      }
+      case DirectoryWatcher::Event::EventKind::WatchedDirRemoved:
+      case DirectoryWatcher::Event::EventKind::WatcherGotInvalidated:
+        // Changes may have been missed, so invalidate every file of the
+        // directory and watch it again.
+        for (auto &File : D.Files)
+          Changed.push_back(std::move(File.second));
+        D.Files.clear();
+        D.Stale = true;
+        break;
+      }
+    }
+  }
+  if (!Changed.empty())
+    SharedCache.invalidate(Changed);
+}
+
+namespace {
+
+/// Reads lines from stdin.
+class LineReader {
+public:
+  /// Reads the next line into \p Line, without the line terminator. Returns
+  /// false at the end of the input.
+  bool readLine(std::string &Line) {
+    while (true) {
+      size_t End = Buffer.find('\n', Start);
+      if (End != std::string::npos) {
+        Line = StringRef(Buffer).slice(Start, End).rtrim('\r').str();
+        Start = End + 1;
+        return true;
+      }
+      Buffer.erase(0, Start);
+      Start = 0;
+
+      char Chunk[4096];
+      auto BytesRead =
+          llvm::sys::fs::readNativeFile(llvm::sys::fs::getStdinHandle(), Chunk);
+      if (!BytesRead || !*BytesRead) {
+        llvm::consumeError(BytesRead.takeError());
+        // Treat a final line without terminator as a line.
+        if (Buffer.empty())
+          return false;
+        Line = std::move(Buffer);
+        Buffer.clear();
+        return true;
+      }
+      Buffer.append(Chunk, *BytesRead);
+    }
+  }
+
+private:
+  std::string Buffer;
+  size_t Start = 0;
+};
+
+} // end anonymous namespace
+
+/// Serves scan requests read from stdin until the end of the input. Each
+/// request is a JSON object with the "directory" and "arguments" of a
+/// compilation, an optional "module-name", and an "id" that is echoed in the
+/// response. A response has either the "dependencies" in make format or an
+/// "error". Requests are served concurrently, so responses may be written out
+/// of order.
+static int runServer(DependencyScanningService &Service,
+                     const tooling::ArgumentsAdjuster &AdjustArgs,
+                     SharedStream &OS) {
+  CacheInvalidator Invalidator(Service.getSharedCache());
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+  std::vector<std::unique_ptr<DependencyScanningTool>> WorkerTools;
+  // The workers that aren't serving a request.
+  SmallVector<DependencyScanningTool *> IdleTools;
+  for (unsigned I = 0; I < Pool.getThreadCount(); ++I) {
+    WorkerTools.push_back(std::make_unique<DependencyScanningTool>(Service));
+    IdleTools.push_back(WorkerTools.back().get());
+  }
+  std::mutex Lock;
+  std::condition_variable ToolReturned;
+
+  auto Respond = [&OS](llvm::json::Object Response) {
+    OS.applyLocked([&](raw_ostream &OS) {
+      OS << llvm::json::Value(std::move(Response)) << "\n";
+    });
+  };
+
+  LineReader Reader;
+  std::string Line;
+  while (Reader.readLine(Line)) {
+    if (StringRef(Line).trim().empty())
+      continue;
+
+    llvm::Expected<llvm::json::Value> Request = llvm::json::parse(Line);
+    if (!Request) {
+      Respond(llvm::json::Object{
+          {"id", nullptr},
+          {"error",
+           "invalid request: " + llvm::toString(Request.takeError())}});
+      continue;
+    }
+    llvm::json::Value Id = nullptr;
+    std::string Directory;
+    std::vector<std::string> Arguments;
+    Optional<std::string> ModuleName;
+    llvm::json::Path::Root Root;
+    llvm::json::ObjectMapper Mapper(*Request, Root);
+    if (!Mapper || !Mapper.map("directory", Directory) ||
+        !Mapper.map("arguments", Arguments) ||
+        !Mapper.mapOptional("module-name", ModuleName)) {
+      if (const llvm::json::Object *Object = Request->getAsObject())
+        if (const llvm::json::Value *RequestId = Object->get("id"))
+          Id = *RequestId;
+      Respond(llvm::json::Object{
+          {"id", std::move(Id)},
+          {"error", "invalid request: " + llvm::toString(Root.getError())}});
+      continue;
+    }
+    if (const llvm::json::Value *RequestId =
+            Request->getAsObject()->get("id"))
+      Id = *RequestId;
+
+    // Apply the changes to the files that were cached so far.
+    Invalidator.update();
+
+    DependencyScanningTool *Tool;
+    {
+      std::unique_lock<std::mutex> LockGuard(Lock);
+      ToolReturned.wait(LockGuard, [&] { return !IdleTools.empty(); });
+      Tool = IdleTools.pop_back_val();
+    }
+    Pool.async([&, Tool, Id = std::move(Id), Directory = std::move(Directory),
+                Arguments = AdjustArgs(Arguments, ""),
+                ModuleName = std::move(ModuleName)]() mutable {
+      Optional<StringRef> MaybeModuleName;
+      if (ModuleName)
+        MaybeModuleName = *ModuleName;
+      auto MaybeFile =
+          Tool->getDependencyFile(Arguments, Directory, MaybeModuleName);
+      llvm::json::Object Response{{"id", std::move(Id)}};
+      if (MaybeFile)
+        Response["dependencies"] = std::move(*MaybeFile);
+      else
+        Response["error"] = llvm::toString(MaybeFile.takeError());
+      Respond(std::move(Response));
+
+      std::lock_guard<std::mutex> LockGuard(Lock);
+      IdleTools.push_back(Tool);
+      ToolReturned.notify_one();
+    });
+  }
+  Pool.wait();
+  return 0;
+}
+
 int main(int argc, const char **argv) {
   llvm::InitLLVM X(argc, argv);
   llvm::cl::HideUnrelatedOptions(DependencyScannerCategory);
   if (!llvm::cl::ParseCommandLineOptions(argc, argv))
     return 1;
 
-  std::string ErrorMessage;
-  std::unique_ptr<tooling::JSONCompilationDatabase> Compilations =
-      tooling::JSONCompilationDatabase::loadFromFile(
-          CompilationDB, ErrorMessage,
-          tooling::JSONCommandLineSyntax::AutoDetect);
-  if (!Compilations) {
-    llvm::errs() << "error: " << ErrorMessage << "\n";
+  if (ServerMode) {
+    if (Format != ScanningOutputFormat::Make ||
+        ScanMode != ScanningMode::MinimizedSourcePreprocessing) {
+      llvm::errs() << "error: -server requires -format=make and "
+                      "-mode=preprocess-minimized-sources\n";
+      return 1;
+    }
+  } else if (CompilationDB.empty()) {
+    llvm::errs() << "error: no compilation database specified\n";
     return 1;
   }
 
   llvm::cl::PrintOptionValues();
 
   // The command options are rewritten to run Clang in preprocessor only mode.
-  auto AdjustingCompilations =
-      std::make_unique<tooling::ArgumentsAdjustingCompilations>(
-          std::move(Compilations));
   ResourceDirectoryCache ResourceDirCache;
-
-  AdjustingCompilations->appendArgumentsAdjuster(
+  tooling::ArgumentsAdjuster AdjustArgs =
       [&ResourceDirCache](const tooling::CommandLineArguments &Args,
                           StringRef FileName) {
         std::string LastO;
@@ -507,7 +817,7 @@ int main(int argc, const char **argv) {
         }
         AdjustedArgs.insert(AdjustedArgs.end(), FlagsEnd, Args.end());
         return AdjustedArgs;
-      });
+      };
 
   SharedStream Errs(llvm::errs());
   // Print out the dependency results to STDOUT by default.
@@ -515,6 +825,33 @@ int main(int argc, const char **argv) {
 
   DependencyScanningService Service(ScanMode, Format, ReuseFileManager,
                                     OptimizeArgs);
+  if (!PersistentCachePath.empty()) {
+    auto Cache = DependencyScanningPersistentCache::create(PersistentCachePath);
+    if (!Cache) {
+      llvm::errs() << "error: " << llvm::toString(Cache.takeError()) << "\n";
+      return 1;
+    }
+    Service.getSharedCache().setPersistentCache(std::move(*Cache));
+  }
+
+  if (ServerMode)
+    return runServer(Service, AdjustArgs, DependencyOS);
+
+  std::string ErrorMessage;
+  std::unique_ptr<tooling::JSONCompilationDatabase> Compilations =
+      tooling::JSONCompilationDatabase::loadFromFile(
+          CompilationDB, ErrorMessage,
+          tooling::JSONCommandLineSyntax::AutoDetect);
+  if (!Compilations) {
+    llvm::errs() << "error: " << ErrorMessage << "\n";
+    return 1;
+  }
+
+  auto AdjustingCompilations =
+      std::make_unique<tooling::ArgumentsAdjustingCompilations>(
+          std::move(Compilations));
+  AdjustingCompilations->appendArgumentsAdjuster(AdjustArgs);
+
   llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
   std::vector<std::unique_ptr<DependencyScanningTool>> WorkerTools;
   for (unsigned I = 0; I < Pool.getThreadCount(); ++I)
@@ -0,0 +1,229 @@
+//===- unittests/Lex/IncludeGuardCacheTest.cpp - Include guard cache tests ===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/IncludeGuardCache.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TargetOptions.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderSearchOptions.h"
+#include "clang/Lex/ModuleLoader.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace clang;
+
+namespace {
+
+// Counts the times a header is entered.
+class EnteredFileCounter : public PPCallbacks {
+public:
+  EnteredFileCounter(SourceManager &SM, StringRef FileName)
+      : SM(SM), FileName(FileName) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (Reason != EnterFile)
+      return;
+    if (const FileEntry *FE = SM.getFileEntryForID(SM.getFileID(Loc)))
+      if (llvm::sys::path::filename(FE->getName()) == FileName)
+        ++Count;
+  }
+
+  SourceManager &SM;
+  StringRef FileName;
+  unsigned Count = 0;
+};
+
+class IncludeGuardCacheTest : public ::testing::Test {
+protected:
+  IncludeGuardCacheTest()
+      : DiagID(new DiagnosticIDs()),
+        Diags(DiagID, new DiagnosticOptions, new IgnoringDiagConsumer()),
+        TargetOpts(new TargetOptions) {
+    TargetOpts->Triple = "x86_64-apple-darwin11.1.0";
+    Target = TargetInfo::CreateTargetInfo(Diags, TargetOpts);
+  }
+
+  void SetUp() override {
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("include-guard-cache", Dir));
+    CachePath = Dir;
+    llvm::sys::path::append(CachePath, "guards");
+  }
+
+  void TearDown() override { llvm::sys::fs::remove_directories(Dir); }
+
+  void writeFile(StringRef Name, StringRef Contents) {
+    SmallString<128> Path(Dir);
+    llvm::sys::path::append(Path, Name);
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path, EC);
+    ASSERT_FALSE(EC);
+    OS << Contents;
+  }
+
+  /// Preprocesses \p Source as a separate compilation, and returns the number
+  /// of times it entered a.h. The names of the headers that the cache made it
+  /// skip are added to \p Skipped.
+  unsigned preprocess(StringRef Source,
+                      std::vector<std::string> *Skipped = nullptr) {
+    FileManager FileMgr((FileSystemOptions()));
+    SourceManager SourceMgr(Diags, FileMgr);
+    SourceMgr.setMainFileID(
+        SourceMgr.createFileID(llvm::MemoryBuffer::getMemBuffer(Source)));
+
+    auto HSOpts = std::make_shared<HeaderSearchOptions>();
+    HSOpts->IncludeGuardCachePath = std::string(CachePath);
+    HeaderSearch HeaderInfo(HSOpts, SourceMgr, Diags, LangOpts, Target.get());
+    DirectoryLookup DL(*FileMgr.getOptionalDirectoryRef(Dir), SrcMgr::C_User,
+                       /*isFramework=*/false);
+    HeaderInfo.AddSearchPath(DL, /*isAngled=*/false);
+
+    TrivialModuleLoader ModLoader;
+    Preprocessor PP(std::make_shared<PreprocessorOptions>(), Diags, LangOpts,
+                    SourceMgr, HeaderInfo, ModLoader,
+                    /*IILookup =*/nullptr,
+                    /*OwnsHeaderSearch =*/false);
+    PP.Initialize(*Target);
+    auto *Counter = new EnteredFileCounter(SourceMgr, "a.h");
+    PP.addPPCallbacks(std::unique_ptr<PPCallbacks>(Counter));
+    PP.EnterMainSourceFile();
+    Token Tok;
+    do
+      PP.Lex(Tok);
+    while (Tok.isNot(tok::eof));
+    PP.EndSourceFile();
+    if (Skipped)
+      for (const FileEntry *File :
+           HeaderInfo.getFilesSkippedByIncludeGuardCache())
+        Skipped->push_back(llvm::sys::path::filename(File->getName()).str());
+    return Counter->Count;
+  }
+
+  SmallString<128> Dir;
+  SmallString<128> CachePath;
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagID;
+  DiagnosticsEngine Diags;
+  LangOptions LangOpts;
+  std::shared_ptr<TargetOptions> TargetOpts;
+  IntrusiveRefCntPtr<TargetInfo> Target;
+};
+
+TEST_F(IncludeGuardCacheTest, SkipsHeaderWhoseGuardIsDefined) {
+  writeFile("a.h", "#ifndef A_H\n#define A_H\nint a;\n#endif\n");
+  EXPECT_EQ(preprocess("#include \"a.h\"\n"), 1u);
+  EXPECT_TRUE(llvm::sys::fs::exists(CachePath));
+
+  EXPECT_EQ(preprocess("#define A_H\n#include \"a.h\"\n"), 0u);
+  EXPECT_EQ(preprocess("#define B_H\n#include \"a.h\"\n#include \"a.h\"\n"),
+            1u);
+}
+
+TEST_F(IncludeGuardCacheTest, RecordsSkippedHeaders) {
+  writeFile("a.h", "#ifndef A_H\n#define A_H\nint a;\n#endif\n");
+  std::vector<std::string> Skipped;
+  EXPECT_EQ(preprocess("#include \"a.h\"\n", &Skipped), 1u);
+  EXPECT_TRUE(Skipped.empty());
+
+  EXPECT_EQ(preprocess("#define A_H\n#include \"a.h\"\n#include \"a.h\"\n",
+                       &Skipped),
+            0u);
+  EXPECT_EQ(Skipped, std::vector<std::string>{"a.h"});
+}
+
+TEST_F(IncludeGuardCacheTest, ReadsChangedHeader) {
+  writeFile("a.h", "#ifndef A_H\n#define A_H\nint a;\n#endif\n");
+  EXPECT_EQ(preprocess("#include \"a.h\"\n"), 1u);
+
+  writeFile("a.h", "int a;\n");
+  EXPECT_EQ(preprocess("#define A_H\n#include \"a.h\"\n"), 1u);
+}
+
+TEST_F(IncludeGuardCacheTest, SkipsUnguardedHeader) {
+  writeFile("a.h", "#ifndef A_H\n#define A_H\n#endif\nint a;\n");
+  EXPECT_EQ(preprocess("#include \"a.h\"\n"), 1u);
+  EXPECT_EQ(preprocess("#define A_H\n#include \"a.h\"\n"), 1u);
+}
+
+TEST_F(IncludeGuardCacheTest, IgnoresMalformedCache) {
+  writeFile("guards", "include-guard-cache v1\n1 2\n\n1 2 3 4 -\n");
+  writeFile("a.h", "#ifndef A_H\n#define A_H\n#endif\n");
+  EXPECT_EQ(preprocess("#include \"a.h\"\n"), 1u);
+  EXPECT_EQ(preprocess("#define A_H\n#include \"a.h\"\n"), 0u);
+}
+
+TEST_F(IncludeGuardCacheTest, KeepsEntriesOfOtherCompilations) {
+  writeFile("a.h", "#ifndef A_H\n#define A_H\n#endif\n");
+  writeFile("b.h", "#ifndef B_H\n#define B_H\n#endif\n");
+  FileManager FileMgr((FileSystemOptions()));
+  SmallString<128> A(Dir), B(Dir);
+  llvm::sys::path::append(A, "a.h");
+  llvm::sys::path::append(B, "b.h");
+  auto FileA = FileMgr.getFile(A);
+  auto FileB = FileMgr.getFile(B);
+  ASSERT_TRUE(FileA && FileB);
+
+  IncludeGuardCache First(CachePath), Second(CachePath);
+  First.insert(*FileA, "A_H");
+  Second.insert(*FileB, "B_H");
+  ASSERT_FALSE(llvm::errorToBool(First.save()));
+  ASSERT_FALSE(llvm::errorToBool(Second.save()));
+
+  IncludeGuardCache Merged(CachePath);
+  EXPECT_EQ(Merged.lookup(*FileA), "A_H");
+  EXPECT_EQ(Merged.lookup(*FileB), "B_H");
+}
+
+TEST_F(IncludeGuardCacheTest, DropsUnusedEntriesPastLimit) {
+  writeFile("a.h", "#ifndef A_H\n#define A_H\n#endif\n");
+  writeFile("b.h", "#ifndef B_H\n#define B_H\n#endif\n");
+  writeFile("c.h", "#ifndef C_H\n#define C_H\n#endif\n");
+  FileManager FileMgr((FileSystemOptions()));
+  SmallString<128> A(Dir), B(Dir), C(Dir);
+  llvm::sys::path::append(A, "a.h");
+  llvm::sys::path::append(B, "b.h");
+  llvm::sys::path::append(C, "c.h");
+  auto FileA = FileMgr.getFile(A);
+  auto FileB = FileMgr.getFile(B);
+  auto FileC = FileMgr.getFile(C);
+  ASSERT_TRUE(FileA && FileB && FileC);
+
+  {
+    IncludeGuardCache First(CachePath);
+    First.insert(*FileA, "A_H");
+    First.insert(*FileB, "B_H");
+    ASSERT_FALSE(llvm::errorToBool(First.save()));
+  }
+
+  // This compilation uses b.h and adds c.h, so a.h is the one to go.
+  {
+    IncludeGuardCache Second(CachePath, /*MaxEntries=*/2);
+    EXPECT_EQ(Second.lookup(*FileB), "B_H");
+    Second.insert(*FileC, "C_H");
+    ASSERT_FALSE(llvm::errorToBool(Second.save()));
+  }
+
+  IncludeGuardCache Pruned(CachePath);
+  EXPECT_EQ(Pruned.lookup(*FileA), "");
+  EXPECT_EQ(Pruned.lookup(*FileB), "B_H");
+  EXPECT_EQ(Pruned.lookup(*FileC), "C_H");
+}
+
+} // anonymous namespace
@@ -659,4 +659,50 @@ TEST_F(LexerTest, RawAndNormalLexSameForLineComments) {
   }
   EXPECT_TRUE(ToksView.empty());
 }
+
+TEST_F(LexerTest, LongRunsOfCharacters) {
+  // The lexer skips identifiers, whitespace, line comments and raw string
+  // literals 16 characters at a time, so make every run end at a different
+  // position within a block of 16 characters.
+  LangOpts.CPlusPlus = true;
+  LangOpts.CPlusPlus11 = true;
+  LangOpts.LineComment = true;
+  LangOpts.DollarIdents = true;
+  for (unsigned Length = 1; Length != 40; ++Length) {
+    std::string Ident = "_aZ9";
+    while (Ident.size() < Length + 4)
+      Ident += "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+          [Ident.size() * 7 % 63];
+    std::string Spaces;
+    for (unsigned I = 0; I != Length; ++I)
+      Spaces += " \t\f\v"[I % 4];
+    std::string Comment(Length, '*');
+    std::string Raw =
+        std::string(Length, 'x') + ")y)z\")" + std::string(20, 'z');
+
+    std::string Source = Ident + "$" + Ident + Spaces + "x[" + Spaces + "]//" +
+                         Comment + "\n\"" + Ident + "\"//" + Comment +
+                         "\\\n;\nR\"y(" + Raw + ")y\"" + Spaces + Ident;
+    std::vector<Token> Toks =
+        CheckLex(Source, {tok::identifier, tok::identifier, tok::l_square,
+                          tok::r_square, tok::string_literal,
+                          tok::string_literal, tok::identifier});
+    if (Toks.size() != 7)
+      continue;
+    EXPECT_EQ(getSourceText(Toks[0], Toks[0]), Ident + "$" + Ident);
+    EXPECT_EQ(getSourceText(Toks[1], Toks[1]), "x");
+    EXPECT_EQ(getSourceText(Toks[4], Toks[4]), "\"" + Ident + "\"");
+    EXPECT_EQ(getSourceText(Toks[5], Toks[5]), "R\"y(" + Raw + ")y\"");
+    // The identifier at the end of the buffer.
+    EXPECT_EQ(getSourceText(Toks[6], Toks[6]), Ident);
+  }
+}
+
+TEST_F(LexerTest, LongUnterminatedRawString) {
+  LangOpts.CPlusPlus = true;
+  LangOpts.CPlusPlus11 = true;
+  std::vector<Token> Toks = CheckLex("R\"a(" + std::string(100, 'x') + ")b\"",
+                                     {tok::unknown});
+  EXPECT_EQ(Toks[0].getLength(), 107u);
+}
 } // anonymous namespace
@@ -13,6 +13,7 @@
 #include "clang/Frontend/Utils.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -181,4 +182,106 @@ TEST_F(ModuleCacheTest, CachedModuleNewPathAllowErrors) {
   ASSERT_TRUE(Diags->hasErrorOccurred());
 }
 
+TEST_F(ModuleCacheTest, ReadRecordsAhead) {
+  std::string Header;
+  llvm::raw_string_ostream HeaderOS(Header);
+  for (unsigned I = 0; I != 200; ++I)
+    HeaderOS << "struct S" << I << " { int X; struct S" << I << " *Next; };\n"
+             << "static inline int f" << I << "(struct S" << I
+             << " *P) { return P->X + " << I << "; }\n";
+  addFile("frameworks/M.framework/Headers/m.h", HeaderOS.str());
+  addFile("frameworks/M.framework/Modules/module.modulemap", R"cpp(
+      framework module M [system] {
+        header "m.h"
+        export *
+      }
+  )cpp");
+  std::string Source = "@import M;\nint g(void) {\n  int Sum = 0;\n";
+  for (unsigned I = 0; I != 200; I += 3)
+    Source += "  { struct S" + std::to_string(I) + " V = {1, 0}; Sum += f" +
+              std::to_string(I) + "(&V); }\n";
+  Source += "  return Sum;\n}\n";
+  addFile("test.m", Source);
+
+  auto &Opts = llvm::cl::getRegisteredOptions();
+  auto *Threads = static_cast<cl::opt<unsigned> *>(Opts["ast-reader-threads"]);
+  ASSERT_TRUE(Threads);
+  unsigned OldThreads = *Threads;
+  *Threads = 4;
+
+  SmallString<256> MCPArg("-fmodules-cache-path=");
+  MCPArg.append(ModuleCachePath);
+  IntrusiveRefCntPtr<DiagnosticsEngine> Diags =
+      CompilerInstance::createDiagnostics(new DiagnosticOptions());
+  CreateInvocationOptions CIOpts;
+  CIOpts.Diags = Diags;
+  const char *Args[] = {"clang",        "-fmodules",          "-Fframeworks",
+                        MCPArg.c_str(), "-working-directory", TestDir.c_str(),
+                        "test.m"};
+
+  // The first compilation builds the module, the second one only reads it.
+  for (unsigned Run = 0; Run != 2; ++Run) {
+    std::shared_ptr<CompilerInvocation> Invocation =
+        createInvocation(Args, CIOpts);
+    ASSERT_TRUE(Invocation);
+    CompilerInstance Instance;
+    Instance.setDiagnostics(Diags.get());
+    Instance.setInvocation(Invocation);
+    SyntaxOnlyAction Action;
+    EXPECT_TRUE(Instance.ExecuteAction(Action));
+    EXPECT_FALSE(Diags->hasErrorOccurred());
+  }
+  *Threads = OldThreads;
+}
+
+TEST_F(ModuleCacheTest, LazyLoad) {
+  addFile("test.m", R"cpp(
+      @import Top;
+      int g(void) { return h(); }
+  )cpp");
+  addFile("frameworks/Top.framework/Headers/top.h", R"cpp(
+      @import M;
+      static inline int h(void) { return foo(); }
+  )cpp");
+  addFile("frameworks/Top.framework/Modules/module.modulemap", R"cpp(
+      framework module Top [system] {
+        header "top.h"
+        export *
+      }
+  )cpp");
+  addFile("frameworks/M.framework/Headers/m.h", R"cpp(
+      int foo(void);
+  )cpp");
+  addFile("frameworks/M.framework/Modules/module.modulemap", R"cpp(
+      framework module M [system] {
+        header "m.h"
+        export *
+      }
+  )cpp");
+
+  SmallString<256> MCPArg("-fmodules-cache-path=");
+  MCPArg.append(ModuleCachePath);
+  IntrusiveRefCntPtr<DiagnosticsEngine> Diags =
+      CompilerInstance::createDiagnostics(new DiagnosticOptions());
+  CreateInvocationOptions CIOpts;
+  CIOpts.Diags = Diags;
+  const char *Args[] = {"clang",        "-fmodules",          "-Fframeworks",
+                        MCPArg.c_str(), "-working-directory", TestDir.c_str(),
+                        "-Xclang",      "-fmodules-lazy-load", "test.m"};
+
+  // The first compilation builds the modules, the second one only reads them.
+  for (unsigned Run = 0; Run != 2; ++Run) {
+    std::shared_ptr<CompilerInvocation> Invocation =
+        createInvocation(Args, CIOpts);
+    ASSERT_TRUE(Invocation);
+    EXPECT_TRUE(Invocation->getHeaderSearchOpts().ModulesLazyLoad);
+    CompilerInstance Instance;
+    Instance.setDiagnostics(Diags.get());
+    Instance.setInvocation(Invocation);
+    SyntaxOnlyAction Action;
+    EXPECT_TRUE(Instance.ExecuteAction(Action));
+    EXPECT_FALSE(Diags->hasErrorOccurred());
+  }
+}
+
 } // anonymous namespace
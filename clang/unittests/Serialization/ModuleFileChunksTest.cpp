@@ -0,0 +1,120 @@
+//===- unittests/Serialization/ModuleFileChunksTest.cpp -------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Serialization/ModuleFileChunks.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Testing/Support/Error.h"
+
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+class ModuleFileChunksTest : public ::testing::Test {
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("modulefilechunks-test",
+                                                ChunkStore));
+  }
+
+  void TearDown() override { sys::fs::remove_directories(ChunkStore); }
+
+public:
+  SmallString<256> ChunkStore;
+
+  /// Returns pseudo-random contents that do not compress into few chunks.
+  static std::string makeContents(size_t Size, uint32_t Seed) {
+    std::string Result(Size, '\0');
+    for (char &C : Result) {
+      Seed = Seed * 1664525 + 1013904223;
+      C = static_cast<char>(Seed >> 24);
+    }
+    return Result;
+  }
+
+  unsigned countChunks() {
+    unsigned Count = 0;
+    std::error_code EC;
+    for (sys::fs::directory_iterator File(ChunkStore, EC), End;
+         File != End && !EC; File.increment(EC))
+      ++Count;
+    return Count;
+  }
+
+  std::string write(StringRef Data) {
+    std::string Manifest;
+    raw_string_ostream OS(Manifest);
+    EXPECT_THAT_ERROR(writeChunkedModuleFile(OS, Data, ChunkStore),
+                      Succeeded());
+    return OS.str();
+  }
+};
+
+TEST_F(ModuleFileChunksTest, RoundTrip) {
+  std::string Data = makeContents(300 * 1024, 1);
+  std::string Manifest = write(Data);
+  EXPECT_TRUE(isChunkedModuleFile(Manifest));
+  EXPECT_FALSE(isChunkedModuleFile(Data));
+  EXPECT_LT(Manifest.size(), Data.size() / 100);
+
+  std::unique_ptr<MemoryBuffer> Buffer =
+      MemoryBuffer::getMemBufferCopy(Manifest, "a.pcm");
+  ASSERT_THAT_ERROR(expandChunkedModuleFile(Buffer), Succeeded());
+  EXPECT_EQ(Buffer->getBuffer(), Data);
+  EXPECT_EQ(Buffer->getBufferIdentifier(), "a.pcm");
+
+  // Buffers that are not chunked are left alone.
+  ASSERT_THAT_ERROR(expandChunkedModuleFile(Buffer), Succeeded());
+  EXPECT_EQ(Buffer->getBuffer(), Data);
+}
+
+TEST_F(ModuleFileChunksTest, SharesCommonContents) {
+  std::string Common = makeContents(256 * 1024, 2);
+  std::string A = makeContents(1024, 3) + Common;
+  std::string B = makeContents(3000, 4) + Common + makeContents(1024, 5);
+
+  write(A);
+  unsigned ChunksOfA = countChunks();
+  write(B);
+  unsigned ChunksOfB = countChunks() - ChunksOfA;
+  // Only the chunks around the differing prefix and suffix are new.
+  EXPECT_GT(ChunksOfA, 8u);
+  EXPECT_LE(ChunksOfB, 6u);
+}
+
+TEST_F(ModuleFileChunksTest, MissingChunk) {
+  std::string Manifest = write(makeContents(64 * 1024, 6));
+  ASSERT_FALSE(sys::fs::remove_directories(ChunkStore));
+
+  std::unique_ptr<MemoryBuffer> Buffer =
+      MemoryBuffer::getMemBufferCopy(Manifest, "a.pcm");
+  EXPECT_THAT_ERROR(expandChunkedModuleFile(Buffer), Failed());
+}
+
+TEST_F(ModuleFileChunksTest, CorruptedChunk) {
+  std::string Manifest = write(makeContents(4096, 7));
+  std::error_code EC;
+  sys::fs::directory_iterator File(ChunkStore, EC);
+  ASSERT_FALSE(EC);
+  {
+    raw_fd_ostream OS(File->path(), EC);
+    ASSERT_FALSE(EC);
+    OS << makeContents(4096, 8);
+  }
+
+  std::unique_ptr<MemoryBuffer> Buffer =
+      MemoryBuffer::getMemBufferCopy(Manifest, "a.pcm");
+  EXPECT_THAT_ERROR(expandChunkedModuleFile(Buffer), Failed());
+}
+
+} // anonymous namespace
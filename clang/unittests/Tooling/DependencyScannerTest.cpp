@@ -18,6 +18,7 @@
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
@@ -251,6 +252,102 @@ TEST(DependencyScanningFilesystem, IgnoredFilesAreCachedSeparately2) {
   EXPECT_EQ(StatusMinimized1->getName(), StringRef("/mod.h"));
 }
 
+TEST(DependencyScanningFilesystem, InvalidatedFilesAreReadAgain) {
+  auto VFS1 = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  VFS1->addFile("/data.json", 0, llvm::MemoryBuffer::getMemBuffer("// old\n"));
+  auto VFS2 = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  VFS2->addFile("/data.json", 0, llvm::MemoryBuffer::getMemBuffer("// new!\n"));
+
+  DependencyScanningFilesystemSharedCache SharedCache;
+  std::vector<std::string> Added;
+  SharedCache.setFilenameAddedCallback(
+      [&](StringRef Filename) { Added.push_back(Filename.str()); });
+  ExcludedPreprocessorDirectiveSkipMapping Mappings;
+  DependencyScanningWorkerFilesystem DepFS1(SharedCache, VFS1, Mappings);
+  auto Status1 = DepFS1.status("/data.json");
+  ASSERT_TRUE(Status1);
+  EXPECT_EQ(Status1->getSize(), 7u);
+  EXPECT_EQ(Added, std::vector<std::string>{"/data.json"});
+
+  // Files that aren't minimized are cached as well. The second worker sees the
+  // cached entry until it is invalidated.
+  DependencyScanningWorkerFilesystem DepFS2(SharedCache, VFS2, Mappings);
+  auto Status2 = DepFS2.status("/data.json");
+  ASSERT_TRUE(Status2);
+  EXPECT_EQ(Status2->getSize(), 7u);
+
+  uint64_t Generation = SharedCache.getGeneration();
+  SharedCache.invalidate({"/data.json"});
+  EXPECT_NE(SharedCache.getGeneration(), Generation);
+  DepFS2.clearLocalCache();
+  auto Status3 = DepFS2.status("/data.json");
+  ASSERT_TRUE(Status3);
+  EXPECT_EQ(Status3->getSize(), 8u);
+}
+
+TEST(DependencyScanningFilesystem, InvalidatingAFileInvalidatesItsAliases) {
+  auto VFS1 = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  VFS1->addFile("/data.json", 0, llvm::MemoryBuffer::getMemBuffer("// old\n"));
+  VFS1->addHardLink("/alias.json", "/data.json");
+  auto VFS2 = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  VFS2->addFile("/data.json", 0, llvm::MemoryBuffer::getMemBuffer("// new!\n"));
+  VFS2->addHardLink("/alias.json", "/data.json");
+
+  DependencyScanningFilesystemSharedCache SharedCache;
+  ExcludedPreprocessorDirectiveSkipMapping Mappings;
+  DependencyScanningWorkerFilesystem DepFS1(SharedCache, VFS1, Mappings);
+  ASSERT_TRUE(DepFS1.status("/data.json"));
+  auto Status1 = DepFS1.status("/alias.json");
+  ASSERT_TRUE(Status1);
+  EXPECT_EQ(Status1->getSize(), 7u);
+
+  // Invalidating the file through one of its names also drops the entry of
+  // the other name.
+  SharedCache.invalidate({"/data.json"});
+  DependencyScanningWorkerFilesystem DepFS2(SharedCache, VFS2, Mappings);
+  auto Status2 = DepFS2.status("/alias.json");
+  ASSERT_TRUE(Status2);
+  EXPECT_EQ(Status2->getSize(), 8u);
+}
+
+TEST(DependencyScanningFilesystem, PersistentCacheIsSharedBetweenScans) {
+  llvm::SmallString<128> CacheDir;
+  ASSERT_FALSE(
+      llvm::sys::fs::createUniqueDirectory("scan-deps-cache", CacheDir));
+
+  auto VFS = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  VFS->addFile("/mod.h", 0,
+               llvm::MemoryBuffer::getMemBuffer("#include <foo.h>\n"
+                                                "// hi there!\n"));
+
+  // Each scan has its own shared cache, as separate processes would.
+  auto Scan = [&]() {
+    auto PersistentCache = DependencyScanningPersistentCache::create(CacheDir);
+    EXPECT_TRUE(bool(PersistentCache));
+    DependencyScanningFilesystemSharedCache SharedCache;
+    SharedCache.setPersistentCache(std::move(*PersistentCache));
+    ExcludedPreprocessorDirectiveSkipMapping Mappings;
+    DependencyScanningWorkerFilesystem DepFS(SharedCache, VFS, Mappings);
+    auto File = DepFS.openFileForRead("/mod.h");
+    EXPECT_TRUE(File);
+    auto Buffer = (*File)->getBuffer("/mod.h");
+    EXPECT_TRUE(Buffer);
+    return (*Buffer)->getBuffer().str();
+  };
+
+  EXPECT_EQ(Scan(), "#include <foo.h>\n");
+  auto PersistentCache = DependencyScanningPersistentCache::create(CacheDir);
+  ASSERT_TRUE(bool(PersistentCache));
+  auto Entry = (*PersistentCache)->lookup("#include <foo.h>\n"
+                                          "// hi there!\n");
+  ASSERT_TRUE(Entry);
+  EXPECT_EQ(Entry->Minimized, "#include <foo.h>\n");
+  EXPECT_FALSE((*PersistentCache)->lookup("#include <bar.h>\n"));
+  EXPECT_EQ(Scan(), "#include <foo.h>\n");
+
+  llvm::sys::fs::remove_directories(CacheDir);
+}
+
 } // end namespace dependencies
 } // end namespace tooling
 } // end namespace clang
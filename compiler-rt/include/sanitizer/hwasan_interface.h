@@ -69,6 +69,12 @@ extern "C" {
   // Print one-line report about the memory usage of the current process.
   void __hwasan_print_memory_usage();
 
+  // Check the memory accesses of about one in every `period` calls, in each
+  // thread, to the functions compiled with -mllvm -hwasan-sample-checks. A
+  // period of 1 checks every call. This is meant to be adjusted at run time to
+  // bound the overhead of the checks.
+  void __hwasan_set_sample_checks_period(unsigned period);
+
   /* Returns the offset of the first byte in the memory range that can not be
    * accessed through the pointer in x, or -1 if the whole range is good. */
   intptr_t __hwasan_test_shadow(const volatile void *x, size_t size);
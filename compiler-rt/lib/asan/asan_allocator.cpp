@@ -276,6 +276,8 @@ QuarantineCache *GetQuarantineCache(AsanThreadLocalMallocStorage *ms) {
 void AllocatorOptions::SetFrom(const Flags *f, const CommonFlags *cf) {
   quarantine_size_mb = f->quarantine_size_mb;
   thread_local_quarantine_size_kb = f->thread_local_quarantine_size_kb;
+  quarantine_shards = f->quarantine_shards;
+  quarantine_background_recycle = f->quarantine_background_recycle;
   min_redzone = f->redzone;
   max_redzone = f->max_redzone;
   may_return_null = cf->allocator_may_return_null;
@@ -286,6 +288,8 @@ void AllocatorOptions::SetFrom(const Flags *f, const CommonFlags *cf) {
 void AllocatorOptions::CopyTo(Flags *f, CommonFlags *cf) {
   f->quarantine_size_mb = quarantine_size_mb;
   f->thread_local_quarantine_size_kb = thread_local_quarantine_size_kb;
+  f->quarantine_shards = quarantine_shards;
+  f->quarantine_background_recycle = quarantine_background_recycle;
   f->redzone = min_redzone;
   f->max_redzone = max_redzone;
   cf->allocator_may_return_null = may_return_null;
@@ -293,6 +297,47 @@ void AllocatorOptions::CopyTo(Flags *f, CommonFlags *cf) {
   cf->allocator_release_to_os_interval_ms = release_to_os_interval_ms;
 }
 
+namespace {
+
+// Recycles the quarantine shards whose recycling was deferred by Put(), so
+// that freeing threads do not pay for it.
+class QuarantineRecycleThread {
+ public:
+  constexpr QuarantineRecycleThread() = default;
+  void NewWorkNotify();
+  // Stops the thread, which is restarted on the next notification after
+  // Unlock(). This is done around fork(), so that the thread is not holding
+  // the quarantine locks and the child gets a thread of its own.
+  void LockAndStop() SANITIZER_NO_THREAD_SAFETY_ANALYSIS;
+  void Unlock() SANITIZER_NO_THREAD_SAFETY_ANALYSIS;
+
+ private:
+  enum class State {
+    NotStarted = 0,
+    Started,
+    Failed,
+  };
+
+  void Run();
+
+  bool WaitForWork() {
+    semaphore_.Wait();
+    return atomic_load(&run_, memory_order_acquire);
+  }
+
+  Semaphore semaphore_ = {};
+  StaticSpinMutex mutex_ = {};
+  State state_ SANITIZER_GUARDED_BY(mutex_) = State::NotStarted;
+  void *thread_ SANITIZER_GUARDED_BY(mutex_) = nullptr;
+  atomic_uint8_t run_ = {};
+  // Set while a wake up is pending, to not post the semaphore for every free.
+  atomic_uint8_t pending_ = {};
+};
+
+static QuarantineRecycleThread quarantine_recycle_thread;
+
+}  // namespace
+
 struct Allocator {
   static const uptr kMaxAllowedMallocSize =
       FIRST_32_SECOND_64(3UL << 30, 1ULL << 40);
@@ -321,12 +366,16 @@ struct Allocator {
     CHECK_LE(options.max_redzone, 2048);
     CHECK(IsPowerOfTwo(options.min_redzone));
     CHECK(IsPowerOfTwo(options.max_redzone));
+    CHECK_GE(options.quarantine_shards, 1);
+    CHECK_LE(options.quarantine_shards, AsanQuarantine::kMaxShards);
   }
 
   void SharedInitCode(const AllocatorOptions &options) {
     CheckOptions(options);
     quarantine.Init((uptr)options.quarantine_size_mb << 20,
-                    (uptr)options.thread_local_quarantine_size_kb << 10);
+                    (uptr)options.thread_local_quarantine_size_kb << 10,
+                    options.quarantine_shards,
+                    options.quarantine_background_recycle);
     atomic_store(&alloc_dealloc_mismatch, options.alloc_dealloc_mismatch,
                  memory_order_release);
     atomic_store(&min_redzone, options.min_redzone, memory_order_release);
@@ -389,6 +438,8 @@ struct Allocator {
   void GetOptions(AllocatorOptions *options) const {
     options->quarantine_size_mb = quarantine.GetSize() >> 20;
     options->thread_local_quarantine_size_kb = quarantine.GetCacheSize() >> 10;
+    options->quarantine_shards = quarantine.GetNumShards();
+    options->quarantine_background_recycle = quarantine.DefersRecycle();
     options->min_redzone = atomic_load(&min_redzone, memory_order_acquire);
     options->max_redzone = atomic_load(&max_redzone, memory_order_acquire);
     options->may_return_null = AllocatorMayReturnNull();
@@ -648,17 +699,30 @@ struct Allocator {
     thread_stats.freed += m->UsedSize();
 
     // Push into quarantine.
+    bool recycle_deferred;
     if (t) {
       AsanThreadLocalMallocStorage *ms = &t->malloc_storage();
       AllocatorCache *ac = GetAllocatorCache(ms);
-      quarantine.Put(GetQuarantineCache(ms), QuarantineCallback(ac, stack), m,
-                     m->UsedSize());
+      recycle_deferred = quarantine.Put(GetQuarantineCache(ms),
+                                        QuarantineCallback(ac, stack), m,
+                                        m->UsedSize());
     } else {
       SpinMutexLock l(&fallback_mutex);
       AllocatorCache *ac = &fallback_allocator_cache;
-      quarantine.Put(&fallback_quarantine_cache, QuarantineCallback(ac, stack),
-                     m, m->UsedSize());
+      recycle_deferred = quarantine.Put(&fallback_quarantine_cache,
+                                        QuarantineCallback(ac, stack), m,
+                                        m->UsedSize());
     }
+    if (recycle_deferred)
+      quarantine_recycle_thread.NewWorkNotify();
+  }
+
+  // Called by the quarantine recycle thread, which has no thread local caches.
+  void RecycleQuarantine() {
+    BufferedStackTrace stack;
+    SpinMutexLock l(&fallback_mutex);
+    quarantine.RecycleShards(
+        QuarantineCallback(&fallback_allocator_cache, &stack));
   }
 
   void Deallocate(void *ptr, uptr delete_size, uptr delete_alignment,
@@ -750,7 +814,8 @@ struct Allocator {
 
   void CommitBack(AsanThreadLocalMallocStorage *ms, BufferedStackTrace *stack) {
     AllocatorCache *ac = GetAllocatorCache(ms);
-    quarantine.Drain(GetQuarantineCache(ms), QuarantineCallback(ac, stack));
+    if (quarantine.Drain(GetQuarantineCache(ms), QuarantineCallback(ac, stack)))
+      quarantine_recycle_thread.NewWorkNotify();
     allocator.SwallowCache(ac);
   }
 
@@ -857,6 +922,59 @@ static AsanAllocator &get_allocator() {
   return instance.allocator;
 }
 
+void QuarantineRecycleThread::NewWorkNotify() {
+  if (atomic_exchange(&pending_, 1, memory_order_acq_rel))
+    return;
+  {
+    SpinMutexLock l(&mutex_);
+    if (state_ == State::NotStarted) {
+      atomic_store(&run_, 1, memory_order_release);
+      CHECK_EQ(nullptr, thread_);
+      thread_ = internal_start_thread(
+          [](void *arg) -> void * {
+            reinterpret_cast<QuarantineRecycleThread *>(arg)->Run();
+            return nullptr;
+          },
+          this);
+      state_ = thread_ ? State::Started : State::Failed;
+    }
+    if (state_ == State::Started) {
+      semaphore_.Post();
+      return;
+    }
+  }
+  // Recycle inline if the thread could not be started.
+  atomic_store(&pending_, 0, memory_order_release);
+  instance.RecycleQuarantine();
+}
+
+void QuarantineRecycleThread::Run() {
+  VPrintf(1, "%s: quarantine recycle thread started\n", SanitizerToolName);
+  while (WaitForWork()) {
+    atomic_store(&pending_, 0, memory_order_release);
+    instance.RecycleQuarantine();
+  }
+  VPrintf(1, "%s: quarantine recycle thread stopped\n", SanitizerToolName);
+}
+
+void QuarantineRecycleThread::LockAndStop() {
+  mutex_.Lock();
+  if (state_ != State::Started)
+    return;
+  CHECK_NE(nullptr, thread_);
+
+  atomic_store(&run_, 0, memory_order_release);
+  semaphore_.Post();
+  internal_join_thread(thread_);
+  // Allow to restart after Unlock() if needed. The shards that are still over
+  // their share notify again on the next drain.
+  state_ = State::NotStarted;
+  thread_ = nullptr;
+  atomic_store(&pending_, 0, memory_order_release);
+}
+
+void QuarantineRecycleThread::Unlock() { mutex_.Unlock(); }
+
 bool AsanChunkView::IsValid() const {
   return chunk_ && atomic_load(&chunk_->chunk_state, memory_order_relaxed) !=
                        CHUNK_INVALID;
@@ -1062,6 +1180,14 @@ void asan_mz_force_unlock() SANITIZER_NO_THREAD_SAFETY_ANALYSIS {
   instance.ForceUnlock();
 }
 
+void QuarantineRecycleThreadLockBeforeFork() {
+  quarantine_recycle_thread.LockAndStop();
+}
+
+void QuarantineRecycleThreadUnlockAfterFork() {
+  quarantine_recycle_thread.Unlock();
+}
+
 }  // namespace __asan
 
 // --- Implementation of LSan-specific functions --- {{{1
@@ -34,6 +34,8 @@ class AsanChunk;
 struct AllocatorOptions {
   u32 quarantine_size_mb;
   u32 thread_local_quarantine_size_kb;
+  u32 quarantine_shards;
+  u8 quarantine_background_recycle;
   u16 min_redzone;
   u16 max_redzone;
   u8 may_return_null;
@@ -226,6 +228,11 @@ uptr asan_mz_size(const void *ptr);
 void asan_mz_force_lock();
 void asan_mz_force_unlock();
 
+// Stop the quarantine_background_recycle thread around fork(). It is
+// restarted when needed after the unlock, in both the parent and the child.
+void QuarantineRecycleThreadLockBeforeFork();
+void QuarantineRecycleThreadUnlockAfterFork();
+
 void PrintInternalAllocatorStats();
 void AsanSoftRssLimitExceededCallback(bool exceeded);
 
@@ -185,6 +185,10 @@ void InitializeFlags() {
            "quarantine_size_mb is set to 0\n", SanitizerToolName);
     Die();
   }
+  if (f->quarantine_shards < 1 || f->quarantine_shards > 64) {
+    Report("%s: quarantine_shards must be in [1, 64]\n", SanitizerToolName);
+    Die();
+  }
   if (!f->replace_str && common_flags()->intercept_strlen) {
     Report("WARNING: strlen interceptor is enabled even though replace_str=0. "
            "Use intercept_strlen=0 to disable it.");
@@ -125,6 +125,8 @@ bool HandleDlopenInit();
 
 void InstallAtExitCheckLeaks();
 
+void InstallAtForkHandler();
+
 #define ASAN_ON_ERROR() \
   if (&__asan_on_error) \
   __asan_on_error()
@@ -21,6 +21,7 @@
 #  include <sys/time.h>
 #  include <unistd.h>
 
+#  include "asan_allocator.h"
 #  include "asan_interceptors.h"
 #  include "asan_internal.h"
 #  include "asan_mapping.h"
@@ -142,6 +143,14 @@ void PlatformTSDDtor(void *tsd) {
 }
 #endif
 
+void InstallAtForkHandler() {
+  if (!flags()->quarantine_background_recycle)
+    return;
+  auto before = []() { QuarantineRecycleThreadLockBeforeFork(); };
+  auto after = []() { QuarantineRecycleThreadUnlockAfterFork(); };
+  pthread_atfork(before, after, after);
+}
+
 void InstallAtExitCheckLeaks() {
   if (CAN_SANITIZE_LEAKS) {
     if (common_flags()->detect_leaks && common_flags()->leak_check_at_exit) {
@@ -196,11 +196,13 @@ struct GlobalEnv {
     return Job;
   }
 
-  void RunOneMergeJob(FuzzJob *Job) {
+  // Add the inputs found by \p Job with new features to \p MergeCandidates.
+  void CollectMergeCandidates(FuzzJob *Job,
+                              std::vector<SizedFile> *MergeCandidates) {
     auto Stats = ParseFinalStatsFromLog(Job->LogPath);
     NumRuns += Stats.number_of_executed_units;
 
-    std::vector<SizedFile> TempFiles, MergeCandidates;
+    std::vector<SizedFile> TempFiles;
     // Read all newly created inputs and their feature sets.
     // Choose only those inputs that have new features.
     GetSizedFilesFromDir(Job->CorpusDir, &TempFiles);
@@ -214,7 +216,7 @@ struct GlobalEnv {
       memcpy(NewFeatures.data(), FeatureBytes.data(), FeatureBytes.size());
       for (auto Ft : NewFeatures) {
         if (!Features.count(Ft)) {
-          MergeCandidates.push_back(F);
+          MergeCandidates->push_back(F);
           break;
         }
       }
@@ -225,8 +227,15 @@ struct GlobalEnv {
            NumRuns, Cov.size(), Features.size(), Files.size(),
            Stats.average_exec_per_sec, NumOOMs, NumTimeouts, NumCrashes,
            secondsSinceProcessStartUp(), Job->JobId, Job->DftTimeInSeconds);
+  }
 
+  // Merge \p MergeCandidates into the main corpus with a single merge process,
+  // using \p Job's control file.
+  void MergeJobs(FuzzJob *Job, std::vector<SizedFile> &MergeCandidates) {
     if (MergeCandidates.empty()) return;
+    // The candidates of several jobs are merged together, so sort them as the
+    // inputs of a single job are.
+    std::sort(MergeCandidates.begin(), MergeCandidates.end());
 
     std::vector<std::string> FilesToAdd;
     std::set<uint32_t> NewFeatures, NewCov;
@@ -298,6 +307,15 @@ struct JobQueue {
     Qu.pop();
     return Job;
   }
+  // Pop a job if one is queued, without waiting.
+  bool TryPop(FuzzJob **Job) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    if (Qu.empty() || !Qu.front())
+      return false;
+    *Job = Qu.front();
+    Qu.pop();
+    return true;
+  }
 };
 
 void WorkerThread(JobQueue *FuzzQ, JobQueue *MergeQ) {
@@ -382,21 +400,39 @@ void FuzzWithFork(Random &Rand, const FuzzingOptions &Options,
   }
 
   while (true) {
-    std::unique_ptr<FuzzJob> Job(MergeQ.Pop());
-    if (!Job)
+    std::vector<std::unique_ptr<FuzzJob>> Jobs;
+    Jobs.emplace_back(MergeQ.Pop());
+    if (!Jobs.back())
       break;
-    ExitCode = Job->ExitCode;
-    if (ExitCode == Options.InterruptExitCode) {
-      Printf("==%lu== libFuzzer: a child was interrupted; exiting\n", GetPid());
+    // Also take the other jobs that are already done, so that a single merge
+    // process handles all of them. With many workers and a fast target, jobs
+    // finish faster than they can be merged one by one.
+    FuzzJob *DoneJob;
+    while (MergeQ.TryPop(&DoneJob))
+      Jobs.emplace_back(DoneJob);
+
+    bool Interrupted = false;
+    std::vector<SizedFile> MergeCandidates;
+    for (auto &Job : Jobs) {
+      ExitCode = Job->ExitCode;
+      if (ExitCode == Options.InterruptExitCode) {
+        Printf("==%lu== libFuzzer: a child was interrupted; exiting\n",
+               GetPid());
+        Interrupted = true;
+        break;
+      }
+      Env.CollectMergeCandidates(Job.get(), &MergeCandidates);
+    }
+    if (Interrupted) {
       StopJobs();
       break;
     }
     Fuzzer::MaybeExitGracefully();
 
-    Env.RunOneMergeJob(Job.get());
+    Env.MergeJobs(Jobs.back().get(), MergeCandidates);
 
     // merge the corpus .
-    JobExecuted++;
+    JobExecuted += Jobs.size();
     if (Env.Group && JobExecuted >= MergeCycle) {
       std::vector<SizedFile> CurrentSeedFiles;
       for (auto &Dir : CorpusDirs)
@@ -434,28 +470,36 @@ void FuzzWithFork(Random &Rand, const FuzzingOptions &Options,
     else
       Env.NumCorpuses = 80;
 
-    // Continue if our crash is one of the ignored ones.
-    if (Options.IgnoreTimeouts && ExitCode == Options.TimeoutExitCode)
-      Env.NumTimeouts++;
-    else if (Options.IgnoreOOMs && ExitCode == Options.OOMExitCode)
-      Env.NumOOMs++;
-    else if (ExitCode != 0) {
-      Env.NumCrashes++;
-      if (Options.IgnoreCrashes) {
-        std::ifstream In(Job->LogPath);
-        std::string Line;
-        while (std::getline(In, Line, '\n'))
-          if (Line.find("ERROR:") != Line.npos ||
-              Line.find("runtime error:") != Line.npos)
-            Printf("%s\n", Line.c_str());
-      } else {
-        // And exit if we don't ignore this crash.
-        Printf("INFO: log from the inner process:\n%s",
-               FileToString(Job->LogPath).c_str());
-        StopJobs();
-        break;
+    bool Crashed = false;
+    for (auto &Job : Jobs) {
+      ExitCode = Job->ExitCode;
+      // Continue if our crash is one of the ignored ones.
+      if (Options.IgnoreTimeouts && ExitCode == Options.TimeoutExitCode)
+        Env.NumTimeouts++;
+      else if (Options.IgnoreOOMs && ExitCode == Options.OOMExitCode)
+        Env.NumOOMs++;
+      else if (ExitCode != 0) {
+        Env.NumCrashes++;
+        if (Options.IgnoreCrashes) {
+          std::ifstream In(Job->LogPath);
+          std::string Line;
+          while (std::getline(In, Line, '\n'))
+            if (Line.find("ERROR:") != Line.npos ||
+                Line.find("runtime error:") != Line.npos)
+              Printf("%s\n", Line.c_str());
+        } else {
+          // And exit if we don't ignore this crash.
+          Printf("INFO: log from the inner process:\n%s",
+                 FileToString(Job->LogPath).c_str());
+          Crashed = true;
+          break;
+        }
       }
     }
+    if (Crashed) {
+      StopJobs();
+      break;
+    }
 
     // Stop if we are over the time budget.
     // This is not precise, since other threads are still running
@@ -475,7 +519,8 @@ void FuzzWithFork(Random &Rand, const FuzzingOptions &Options,
       break;
     }
 
-    FuzzQ.Push(Env.CreateNewJob(JobId++));
+    for (size_t i = 0; i < Jobs.size(); i++)
+      FuzzQ.Push(Env.CreateNewJob(JobId++));
   }
 
   for (auto &T : Threads)
@@ -52,6 +52,10 @@ bool hwasan_init_is_running;
 
 int hwasan_report_count = 0;
 
+// The average number of calls to the functions compiled with
+// -hwasan-sample-checks, in a thread, per call whose accesses are checked.
+static atomic_uint32_t sample_checks_period = {1};
+
 uptr kLowShadowStart;
 uptr kLowShadowEnd;
 uptr kHighShadowStart;
@@ -331,6 +335,7 @@ __attribute__((constructor(0))) void __hwasan_init() {
 
   CacheBinaryName();
   InitializeFlags();
+  __hwasan_set_sample_checks_period(Max(flags()->sample_checks_period, 1));
 
   // Install tool-specific callbacks in sanitizer_common.
   SetCheckUnwindCallback(CheckUnwind);
@@ -576,6 +581,32 @@ u8 __hwasan_generate_tag() {
   return t->GenerateRandomTag();
 }
 
+SANITIZER_INTERFACE_ATTRIBUTE THREADLOCAL s32 __hwasan_sample_countdown;
+
+// The number of calls that are checked between two refills when every call is
+// checked. A new period is picked up within that many calls.
+static const s32 kCheckedCallsPerRefill = 1024;
+
+void __hwasan_sample_refill() {
+  u32 period = atomic_load_relaxed(&sample_checks_period);
+  if (period <= 1) {
+    __hwasan_sample_countdown = -kCheckedCallsPerRefill;
+    return;
+  }
+  // Skip between period / 2 and 3 * period / 2 calls, so that the sampled
+  // calls do not follow a pattern of the program.
+  u32 skip = period / 2;
+  if (Thread *t = GetCurrentThread())
+    skip += (u64)t->GenerateRandomTag(8) * period / 256;
+  __hwasan_sample_countdown = skip;
+}
+
+void __hwasan_set_sample_checks_period(u32 period) {
+  atomic_store_relaxed(&sample_checks_period, Max(period, 1U));
+  // Make the calling thread pick up the new period on its next check.
+  __hwasan_sample_countdown = 0;
+}
+
 #if !SANITIZER_SUPPORTS_WEAK_HOOKS
 extern "C" {
 SANITIZER_INTERFACE_ATTRIBUTE SANITIZER_WEAK_ATTRIBUTE
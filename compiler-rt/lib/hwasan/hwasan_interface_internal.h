@@ -118,6 +118,12 @@ void __hwasan_tag_mismatch4(uptr addr, uptr access_info, uptr *registers_frame,
 SANITIZER_INTERFACE_ATTRIBUTE
 u8 __hwasan_generate_tag();
 
+SANITIZER_INTERFACE_ATTRIBUTE
+void __hwasan_sample_refill();
+
+SANITIZER_INTERFACE_ATTRIBUTE
+void __hwasan_set_sample_checks_period(u32 period);
+
 // Returns the offset of the first tag mismatch or -1 if the whole range is
 // good.
 SANITIZER_INTERFACE_ATTRIBUTE
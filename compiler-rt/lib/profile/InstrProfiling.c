@@ -20,6 +20,9 @@
 #define INSTR_PROF_VALUE_PROF_DATA
 #include "profile/InstrProfData.inc"
 
+COMPILER_RT_VISIBILITY void (*ThreadCountersMergeHook)(void) = NULL;
+COMPILER_RT_VISIBILITY void (*ThreadCountersResetHook)(void) = NULL;
+
 COMPILER_RT_VISIBILITY uint64_t __llvm_profile_get_magic(void) {
   return sizeof(void *) == sizeof(uint64_t) ? (INSTR_PROF_RAW_MAGIC_64)
                                             : (INSTR_PROF_RAW_MAGIC_32);
@@ -48,6 +51,8 @@ COMPILER_RT_VISIBILITY void __llvm_profile_reset_counters(void) {
   char ResetValue =
       (__llvm_profile_get_version() & VARIANT_MASK_BYTE_COVERAGE) ? 0xFF : 0;
   memset(I, ResetValue, E - I);
+  if (ThreadCountersResetHook)
+    ThreadCountersResetHook();
 
   const __llvm_profile_data *DataBegin = __llvm_profile_begin_data();
   const __llvm_profile_data *DataEnd = __llvm_profile_end_data();
@@ -63,6 +63,15 @@ void __llvm_profile_enable_continuous_mode(void);
  */
 void __llvm_profile_set_page_size(unsigned PageSize);
 
+/*!
+ * \brief Turn counting on or off for the calling thread.
+ *
+ * Only code instrumented with -instrprof-sample-gate checks this gate, which
+ * is off in every thread until it is set. Functions read it once on entry,
+ * so a change only applies to the calls made after it.
+ */
+void __llvm_profile_set_sample_gate(int Enabled);
+
 /*!
  * \brief Get number of bytes necessary to pad the argument to eight
  * byte boundary.
@@ -25,6 +25,16 @@ static int ContinuouslySyncProfile = 0;
  * unavailable. */
 static unsigned PageSize = 0;
 
+/* Set to 1 when continuous mode maps the counter section itself onto the
+ * profile, which requires the counters to start at a page-aligned file offset.
+ * This is always the case on Darwin. On Linux, it is only done when the
+ * counters are not relocated with a runtime bias. */
+#if defined(__APPLE__)
+static int CountersMappedInPlace = 1;
+#else
+static int CountersMappedInPlace = 0;
+#endif
+
 COMPILER_RT_VISIBILITY int __llvm_profile_is_continuous_mode_enabled(void) {
   return ContinuouslySyncProfile && PageSize;
 }
@@ -37,6 +47,14 @@ COMPILER_RT_VISIBILITY void __llvm_profile_set_page_size(unsigned PS) {
   PageSize = PS;
 }
 
+COMPILER_RT_VISIBILITY int lprofCountersMappedInPlace(void) {
+  return CountersMappedInPlace;
+}
+
+COMPILER_RT_VISIBILITY void lprofSetCountersMappedInPlace(int InPlace) {
+  CountersMappedInPlace = InPlace;
+}
+
 COMPILER_RT_VISIBILITY
 uint64_t __llvm_profile_get_size_for_buffer(void) {
   const __llvm_profile_data *DataBegin = __llvm_profile_begin_data();
@@ -93,11 +111,7 @@ static uint64_t calculateBytesNeededToPageAlign(uint64_t Offset) {
 }
 
 static int needsCounterPadding(void) {
-#if defined(__APPLE__)
-  return __llvm_profile_is_continuous_mode_enabled();
-#else
-  return 0;
-#endif
+  return CountersMappedInPlace && __llvm_profile_is_continuous_mode_enabled();
 }
 
 COMPILER_RT_VISIBILITY
@@ -113,9 +127,10 @@ void __llvm_profile_get_padding_sizes_for_counters(
   }
 
   // In continuous mode, the file offsets for headers and for the start of
-  // counter sections need to be page-aligned.
-  *PaddingBytesBeforeCounters =
-      calculateBytesNeededToPageAlign(sizeof(__llvm_profile_header) + DataSize);
+  // counter sections need to be page-aligned. The binary ids, if any, are
+  // written between the header and the data.
+  *PaddingBytesBeforeCounters = calculateBytesNeededToPageAlign(
+      sizeof(__llvm_profile_header) + __llvm_write_binary_ids(NULL) + DataSize);
   *PaddingBytesAfterCounters = calculateBytesNeededToPageAlign(CountersSize);
   *PaddingBytesAfterNames = calculateBytesNeededToPageAlign(NamesSize);
 }
@@ -92,16 +92,20 @@ static lprofFilename lprofCurFilename = {0,   0, 0, {0}, NULL,
                                          {0}, 0, 0, 0,   PNS_unknown};
 
 static int ProfileMergeRequested = 0;
+
+/* The per-thread gate that sampled instrumentation checks before incrementing
+ * the counters. */
+COMPILER_RT_VISIBILITY COMPILER_RT_THREAD_LOCAL char
+    INSTR_PROF_PROFILE_SAMPLE_GATE_VAR = 0;
 static int getProfileFileSizeForMerging(FILE *ProfileFile,
                                         uint64_t *ProfileFileSize);
 
-#if defined(__APPLE__)
-static const int ContinuousModeSupported = 1;
-static const int UseBiasVar = 0;
-static const char *FileOpenMode = "a+b";
-static void *BiasAddr = NULL;
-static void *BiasDefaultAddr = NULL;
-static int mmapForContinuousMode(uint64_t CurrentFileOffset, FILE *File) {
+#if defined(__APPLE__) || defined(__linux__)
+/* Map the counter section onto the profile in place, at \p CurrentFileOffset
+ * within \p File, so that the counters are written to the file as they are
+ * incremented. This requires the counter section to start and end on page
+ * boundaries, so that no other data shares the pages that are mapped. */
+static int mmapCountersInPlace(uint64_t CurrentFileOffset, FILE *File) {
   /* Get the sizes of various profile data sections. Taken from
    * __llvm_profile_get_size_for_buffer(). */
   const __llvm_profile_data *DataBegin = __llvm_profile_begin_data();
@@ -123,11 +127,23 @@ static int mmapForContinuousMode(uint64_t CurrentFileOffset, FILE *File) {
              CountersBegin, PageSize);
     return 1;
   }
+#if defined(__APPLE__)
   if ((intptr_t)DataBegin % PageSize != 0) {
     PROF_ERR("Data section not page-aligned (start = %p, pagesz = %u).\n",
              DataBegin, PageSize);
     return 1;
   }
+#else
+  /* The linker only pads the end of the counter section when the runtime's
+   * page-aligned end marker is the last input in it. Anything else sharing the
+   * last page would be clobbered by the mapping. */
+  if ((intptr_t)CountersEnd % PageSize != 0) {
+    PROF_ERR("Counters section does not end on a page boundary (end = %p, "
+             "pagesz = %u).\n",
+             CountersEnd, PageSize);
+    return 1;
+  }
+#endif
   int Fileno = fileno(File);
   /* Determine how much padding is needed before/after the counters and
    * after the names. */
@@ -138,9 +154,9 @@ static int mmapForContinuousMode(uint64_t CurrentFileOffset, FILE *File) {
       &PaddingBytesAfterCounters, &PaddingBytesAfterNames);
 
   uint64_t PageAlignedCountersLength = CountersSize + PaddingBytesAfterCounters;
-  uint64_t FileOffsetToCounters = CurrentFileOffset +
-                                  sizeof(__llvm_profile_header) + DataSize +
-                                  PaddingBytesBeforeCounters;
+  uint64_t FileOffsetToCounters =
+      CurrentFileOffset + sizeof(__llvm_profile_header) +
+      __llvm_write_binary_ids(NULL) + DataSize + PaddingBytesBeforeCounters;
   void *CounterMmap = mmap((void *)CountersBegin, PageAlignedCountersLength,
                            PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED,
                            Fileno, FileOffsetToCounters);
@@ -157,6 +173,17 @@ static int mmapForContinuousMode(uint64_t CurrentFileOffset, FILE *File) {
   }
   return 0;
 }
+#endif
+
+#if defined(__APPLE__)
+static const int ContinuousModeSupported = 1;
+static const int UseBiasVar = 0;
+static const char *FileOpenMode = "a+b";
+static void *BiasAddr = NULL;
+static void *BiasDefaultAddr = NULL;
+static int mmapForContinuousMode(uint64_t CurrentFileOffset, FILE *File) {
+  return mmapCountersInPlace(CurrentFileOffset, File);
+}
 #elif defined(__ELF__) || defined(_WIN32)
 
 #define INSTR_PROF_PROFILE_COUNTER_BIAS_DEFAULT_VAR                            \
@@ -191,6 +218,11 @@ static const char *FileOpenMode = "w+b";
 static void *BiasAddr = &INSTR_PROF_PROFILE_COUNTER_BIAS_VAR;
 static void *BiasDefaultAddr = &INSTR_PROF_PROFILE_COUNTER_BIAS_DEFAULT_VAR;
 static int mmapForContinuousMode(uint64_t CurrentFileOffset, FILE *File) {
+#if defined(__linux__)
+  if (lprofCountersMappedInPlace())
+    return mmapCountersInPlace(CurrentFileOffset, File);
+#endif
+
   /* Get the sizes of various profile data sections. Taken from
    * __llvm_profile_get_size_for_buffer(). */
   const __llvm_profile_data *DataBegin = __llvm_profile_begin_data();
@@ -572,8 +604,15 @@ static void initializeProfileForContinuousMode(void) {
     return;
   }
   if (UseBiasVar && BiasAddr == BiasDefaultAddr) {
+#if defined(__linux__)
+    /* The counters are not relocated: map the counter section itself onto the
+     * profile instead. This has to be decided before the profile is written,
+     * as it needs the counters to be padded to a page boundary. */
+    lprofSetCountersMappedInPlace(1);
+#else
     PROF_ERR("%s\n", "__llvm_profile_counter_bias is undefined");
     return;
+#endif
   }
 
   /* Get the sizes of counter section. */
@@ -1009,6 +1048,15 @@ void __llvm_profile_set_filename(const char *FilenamePat) {
   parseAndSetFilename(FilenamePat, PNS_runtime_api, 1);
 }
 
+/* This API is directly called by the user application code to turn counting
+ * on or off in the calling thread, for code instrumented with
+ * -instrprof-sample-gate.
+ */
+COMPILER_RT_VISIBILITY
+void __llvm_profile_set_sample_gate(int Enabled) {
+  INSTR_PROF_PROFILE_SAMPLE_GATE_VAR = Enabled != 0;
+}
+
 /* The public API for writing profile data into the file with name
  * set by previous calls to __llvm_profile_set_filename or
  * __llvm_profile_override_default_filename or
@@ -183,6 +183,13 @@ uint64_t lprofGetLoadModuleSignature();
 unsigned lprofProfileDumped(void);
 void lprofSetProfileDumped(unsigned);
 
+/*
+ * Return non zero value if continuous mode maps the counter section itself
+ * onto the profile file, rather than relocating the counters with a bias.
+ */
+int lprofCountersMappedInPlace(void);
+void lprofSetCountersMappedInPlace(int);
+
 COMPILER_RT_VISIBILITY extern void (*FreeHook)(void *);
 COMPILER_RT_VISIBILITY extern uint8_t *DynamicBufferIOBuffer;
 COMPILER_RT_VISIBILITY extern uint32_t VPBufferSize;
@@ -191,6 +198,10 @@ COMPILER_RT_VISIBILITY extern uint32_t VPMaxNumValsPerSite;
 COMPILER_RT_VISIBILITY extern ValueProfNode *CurrentVNode;
 COMPILER_RT_VISIBILITY extern ValueProfNode *EndVNode;
 extern void (*VPMergeHook)(struct ValueProfData *, __llvm_profile_data *);
+/* Set once a thread has its own copy of the counters, to sum the copies into
+ * the counter section before it is written, and to reset them with it. */
+COMPILER_RT_VISIBILITY extern void (*ThreadCountersMergeHook)(void);
+COMPILER_RT_VISIBILITY extern void (*ThreadCountersResetHook)(void);
 
 /*
  * Write binary ids into profiles if writer is given.
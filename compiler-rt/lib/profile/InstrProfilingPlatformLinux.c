@@ -88,6 +88,24 @@ COMPILER_RT_VISIBILITY ValueProfNode *__llvm_profile_end_vnodes(void) {
 COMPILER_RT_VISIBILITY ValueProfNode *CurrentVNode = &PROF_VNODES_START;
 COMPILER_RT_VISIBILITY ValueProfNode *EndVNode = &PROF_VNODES_STOP;
 
+#if defined(__linux__)
+/* The largest page size of the target, which continuous mode needs the counter
+ * section to be aligned to when it is mapped onto the profile in place. */
+#if defined(__aarch64__) || defined(__powerpc64__)
+#define PROF_CNTS_PAGE_ALIGN 65536
+#else
+#define PROF_CNTS_PAGE_ALIGN 4096
+#endif
+
+/* A zero length, page-aligned variable in the counter section. It raises the
+ * alignment of the whole section to a page and, as the runtime comes last on
+ * the link line, it is also placed after all the counters, so that the end of
+ * the section is page-aligned too. */
+COMPILER_RT_VISIBILITY char __llvm_profile_cnts_page_align[0]
+    COMPILER_RT_SECTION(COMPILER_RT_SEG INSTR_PROF_CNTS_SECT_NAME)
+        COMPILER_RT_ALIGNAS(PROF_CNTS_PAGE_ALIGN);
+#endif
+
 #ifdef NT_GNU_BUILD_ID
 static size_t RoundUp(size_t size, size_t align) {
   return (size + align - 1) & ~(align - 1);
@@ -0,0 +1,133 @@
+/*===- InstrProfilingThreadCounters.c - Per-thread profile counters -------===*\
+|*
+|* Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+|* See https://llvm.org/LICENSE.txt for license information.
+|* SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+|*
+\*===----------------------------------------------------------------------===*/
+
+/* Code instrumented with -instrprof-per-thread-counters increments a copy of
+ * the counter section that belongs to the running thread, so that threads do
+ * not contend for the counters' cache lines. Each thread gets its copy, or
+ * shard, the first time it runs an instrumented function, and the shards are
+ * summed into the counter section whenever the profile is written. */
+
+#if !defined(_WIN32)
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "InstrProfiling.h"
+#include "InstrProfilingInternal.h"
+#include "InstrProfilingPort.h"
+
+typedef struct CounterShard {
+  /* The next shard that was allocated. */
+  struct CounterShard *Next;
+  /* The next shard that no thread increments anymore. */
+  struct CounterShard *NextFree;
+  uint64_t Counters[];
+} CounterShard;
+
+/* The distance from the counter section to the shard of this thread, or 0
+ * until the thread has a shard. */
+COMPILER_RT_VISIBILITY COMPILER_RT_THREAD_LOCAL intptr_t
+    INSTR_PROF_PROFILE_THREAD_COUNTER_BIAS_VAR = 0;
+
+static pthread_mutex_t ShardsLock = PTHREAD_MUTEX_INITIALIZER;
+static CounterShard *Shards = NULL;
+static CounterShard *FreeShards = NULL;
+static pthread_once_t ShardKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t ShardKey;
+
+/* The counts of an exiting thread stay in its shard until they are merged, so
+ * the shard can be handed to the next new thread as it is. */
+static void releaseShard(void *Arg) {
+  CounterShard *Shard = (CounterShard *)Arg;
+  INSTR_PROF_PROFILE_THREAD_COUNTER_BIAS_VAR = 0;
+  pthread_mutex_lock(&ShardsLock);
+  Shard->NextFree = FreeShards;
+  FreeShards = Shard;
+  pthread_mutex_unlock(&ShardsLock);
+}
+
+static void createShardKey(void) {
+  pthread_key_create(&ShardKey, releaseShard);
+}
+
+static void mergeThreadCounters(void) {
+  uint64_t *Counters = (uint64_t *)__llvm_profile_begin_counters();
+  uint64_t NumCounters = __llvm_profile_get_num_counters(
+      __llvm_profile_begin_counters(), __llvm_profile_end_counters());
+  CounterShard *Shard;
+  uint64_t I;
+
+  /* Only counter increments are sharded, not coverage bytes. */
+  if (__llvm_profile_get_version() & VARIANT_MASK_BYTE_COVERAGE)
+    return;
+
+  pthread_mutex_lock(&ShardsLock);
+  for (Shard = Shards; Shard; Shard = Shard->Next)
+    for (I = 0; I < NumCounters; ++I) {
+      /* Move the counts over. The owner of the shard may increment it at the
+       * same time, which can only lose that increment. */
+      uint64_t Count = Shard->Counters[I];
+      if (!Count)
+        continue;
+      Counters[I] += Count;
+      Shard->Counters[I] -= Count;
+    }
+  pthread_mutex_unlock(&ShardsLock);
+}
+
+static void resetThreadCounters(void) {
+  size_t CountersSize =
+      __llvm_profile_end_counters() - __llvm_profile_begin_counters();
+  CounterShard *Shard;
+
+  pthread_mutex_lock(&ShardsLock);
+  for (Shard = Shards; Shard; Shard = Shard->Next)
+    memset(Shard->Counters, 0, CountersSize);
+  pthread_mutex_unlock(&ShardsLock);
+}
+
+COMPILER_RT_VISIBILITY intptr_t INSTR_PROF_THREAD_COUNTERS_ALLOC_FUNC(void) {
+  char *CountersBegin = __llvm_profile_begin_counters();
+  size_t CountersSize = __llvm_profile_end_counters() - CountersBegin;
+  CounterShard *Shard;
+
+  pthread_once(&ShardKeyOnce, createShardKey);
+
+  pthread_mutex_lock(&ShardsLock);
+  Shard = FreeShards;
+  if (Shard)
+    FreeShards = Shard->NextFree;
+  pthread_mutex_unlock(&ShardsLock);
+
+  if (!Shard) {
+    /* Shards are mapped rather than allocated with malloc(), which may not be
+     * usable from the first function a thread runs, and so that no two shards
+     * share a page. The mapping is zero-filled. */
+    void *Mem =
+        mmap(NULL, sizeof(CounterShard) + CountersSize, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    /* Keep incrementing the counter section itself. */
+    if (Mem == MAP_FAILED)
+      return 0;
+    Shard = (CounterShard *)Mem;
+    pthread_mutex_lock(&ShardsLock);
+    Shard->Next = Shards;
+    Shards = Shard;
+    ThreadCountersMergeHook = &mergeThreadCounters;
+    ThreadCountersResetHook = &resetThreadCounters;
+    pthread_mutex_unlock(&ShardsLock);
+  }
+
+  pthread_setspecific(ShardKey, Shard);
+  INSTR_PROF_PROFILE_THREAD_COUNTER_BIAS_VAR =
+      (intptr_t)Shard->Counters - (intptr_t)CountersBegin;
+  return INSTR_PROF_PROFILE_THREAD_COUNTER_BIAS_VAR;
+}
+
+#endif
@@ -241,6 +241,10 @@ static int writeValueProfData(ProfDataWriter *Writer,
 COMPILER_RT_VISIBILITY int lprofWriteData(ProfDataWriter *Writer,
                                           VPDataReaderType *VPDataReader,
                                           int SkipNameDataWrite) {
+  /* Sum the per-thread counters, if any, into the ones that are written. */
+  if (ThreadCountersMergeHook)
+    ThreadCountersMergeHook();
+
   /* Match logic in __llvm_profile_write_buffer(). */
   const __llvm_profile_data *DataBegin = __llvm_profile_begin_data();
   const __llvm_profile_data *DataEnd = __llvm_profile_end_data();
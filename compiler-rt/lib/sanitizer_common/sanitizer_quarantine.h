@@ -10,6 +10,9 @@
 // Quarantine caches some specified amount of memory in per-thread caches,
 // then evicts to global FIFO queue. When the queue reaches specified threshold,
 // oldest memory is recycled.
+// The global queue can be split in shards, each with its own locks and an equal
+// share of the threshold, and its recycling can be deferred to a background
+// thread of the tool.
 //
 //===----------------------------------------------------------------------===//
 
@@ -77,29 +80,40 @@ class Quarantine {
  public:
   typedef QuarantineCache<Callback> Cache;
 
-  explicit Quarantine(LinkerInitialized)
-      : cache_(LINKER_INITIALIZED) {
-  }
+  static const uptr kMaxShards = 64;
+
+  explicit Quarantine(LinkerInitialized) {}
 
-  void Init(uptr size, uptr cache_size) {
+  void Init(uptr size, uptr cache_size, uptr num_shards = 1,
+            bool defer_recycle = false) {
     // Thread local quarantine size can be zero only when global quarantine size
     // is zero (it allows us to perform just one atomic read per Put() call).
     CHECK((size == 0 && cache_size == 0) || cache_size != 0);
+    CHECK_GE(num_shards, 1);
+    CHECK_LE(num_shards, kMaxShards);
 
     atomic_store_relaxed(&max_size_, size);
     atomic_store_relaxed(&min_size_, size / 10 * 9);  // 90% of max size.
     atomic_store_relaxed(&max_cache_size_, cache_size);
+    atomic_store_relaxed(&num_shards_, num_shards);
+    atomic_store_relaxed(&defer_recycle_, defer_recycle);
 
-    cache_mutex_.Init();
-    recycle_mutex_.Init();
+    for (uptr i = 0; i < kMaxShards; i++) {
+      shards_[i].cache_mutex.Init();
+      shards_[i].recycle_mutex.Init();
+    }
   }
 
   uptr GetSize() const { return atomic_load_relaxed(&max_size_); }
   uptr GetCacheSize() const {
     return atomic_load_relaxed(&max_cache_size_);
   }
+  uptr GetNumShards() const { return atomic_load_relaxed(&num_shards_); }
+  bool DefersRecycle() const { return atomic_load_relaxed(&defer_recycle_); }
 
-  void Put(Cache *c, Callback cb, Node *ptr, uptr size) {
+  // Returns true if the cache was drained into a shard whose recycling is left
+  // to RecycleShards().
+  bool Put(Cache *c, Callback cb, Node *ptr, uptr size) {
     uptr cache_size = GetCacheSize();
     if (cache_size) {
       c->Enqueue(cb, ptr, size);
@@ -109,58 +123,109 @@ class Quarantine {
     }
     // Check cache size anyway to accommodate for runtime cache_size change.
     if (c->Size() > cache_size)
-      Drain(c, cb);
+      return Drain(c, cb);
+    return false;
   }
 
-  void NOINLINE Drain(Cache *c, Callback cb) {
+  bool NOINLINE Drain(Cache *c, Callback cb) {
+    Shard *s = GetShard(c);
     {
-      SpinMutexLock l(&cache_mutex_);
-      cache_.Transfer(c);
+      SpinMutexLock l(&s->cache_mutex);
+      s->cache.Transfer(c);
     }
-    if (cache_.Size() > GetSize() && recycle_mutex_.TryLock())
-      Recycle(atomic_load_relaxed(&min_size_), cb);
+    uptr num_shards = GetNumShards();
+    uptr max_size = GetSize() / num_shards;
+    if (s->cache.Size() <= max_size)
+      return false;
+    // Leave the recycling to the tool's background thread, unless it falls
+    // too far behind.
+    if (atomic_load_relaxed(&defer_recycle_) &&
+        s->cache.Size() <= 2 * max_size)
+      return true;
+    if (s->recycle_mutex.TryLock())
+      Recycle(s, atomic_load_relaxed(&min_size_) / num_shards, cb);
+    return false;
   }
 
   void NOINLINE DrainAndRecycle(Cache *c, Callback cb) {
+    Shard *s = GetShard(c);
     {
-      SpinMutexLock l(&cache_mutex_);
-      cache_.Transfer(c);
+      SpinMutexLock l(&s->cache_mutex);
+      s->cache.Transfer(c);
+    }
+    for (uptr i = 0, n = GetNumShards(); i < n; i++) {
+      shards_[i].recycle_mutex.Lock();
+      Recycle(&shards_[i], 0, cb);
+    }
+  }
+
+  // Recycles the shards over their share of the quarantine size. It is
+  // expected to be called by the background thread of the tool when Put() or
+  // Drain() return true.
+  void NOINLINE RecycleShards(Callback cb) {
+    uptr num_shards = GetNumShards();
+    uptr max_size = GetSize() / num_shards;
+    uptr min_size = atomic_load_relaxed(&min_size_) / num_shards;
+    for (uptr i = 0; i < num_shards; i++) {
+      Shard *s = &shards_[i];
+      if (s->cache.Size() <= max_size)
+        continue;
+      s->recycle_mutex.Lock();
+      Recycle(s, min_size, cb);
     }
-    recycle_mutex_.Lock();
-    Recycle(0, cb);
   }
 
   void PrintStats() const {
     // It assumes that the world is stopped, just as the allocator's PrintStats.
     Printf("Quarantine limits: global: %zdMb; thread local: %zdKb\n",
            GetSize() >> 20, GetCacheSize() >> 10);
-    cache_.PrintStats();
+    for (uptr i = 0, n = GetNumShards(); i < n; i++)
+      shards_[i].cache.PrintStats();
   }
 
  private:
+  struct Shard {
+    Shard() : cache(LINKER_INITIALIZED) {}
+
+    StaticSpinMutex cache_mutex;
+    StaticSpinMutex recycle_mutex;
+    Cache cache;
+    char pad[kCacheLineSize];
+  };
+
   // Read-only data.
   char pad0_[kCacheLineSize];
   atomic_uintptr_t max_size_;
   atomic_uintptr_t min_size_;
   atomic_uintptr_t max_cache_size_;
+  atomic_uintptr_t num_shards_;
+  atomic_uint8_t defer_recycle_;
   char pad1_[kCacheLineSize];
-  StaticSpinMutex cache_mutex_;
-  StaticSpinMutex recycle_mutex_;
-  Cache cache_;
-  char pad2_[kCacheLineSize];
+  Shard shards_[kMaxShards];
+
+  // Each thread local cache always drains into the same shard, which keeps the
+  // shard FIFO for the chunks of that thread.
+  Shard *GetShard(Cache *c) {
+    uptr num_shards = GetNumShards();
+    if (num_shards == 1)
+      return &shards_[0];
+    u64 hash = (reinterpret_cast<uptr>(c) >> 6) * 0x9E3779B97F4A7C15ULL;
+    return &shards_[(hash >> 32) % num_shards];
+  }
 
-  void NOINLINE Recycle(uptr min_size, Callback cb)
-      SANITIZER_REQUIRES(recycle_mutex_) SANITIZER_RELEASE(recycle_mutex_) {
+  void NOINLINE Recycle(Shard *s, uptr min_size, Callback cb)
+      SANITIZER_REQUIRES(s->recycle_mutex)
+          SANITIZER_RELEASE(s->recycle_mutex) {
     Cache tmp;
     {
-      SpinMutexLock l(&cache_mutex_);
+      SpinMutexLock l(&s->cache_mutex);
       // Go over the batches and merge partially filled ones to
       // save some memory, otherwise batches themselves (since the memory used
       // by them is counted against quarantine limit) can overcome the actual
       // user's quarantined chunks, which diminishes the purpose of the
       // quarantine.
-      uptr cache_size = cache_.Size();
-      uptr overhead_size = cache_.OverheadSize();
+      uptr cache_size = s->cache.Size();
+      uptr overhead_size = s->cache.OverheadSize();
       CHECK_GE(cache_size, overhead_size);
       // Do the merge only when overhead exceeds this predefined limit (might
       // require some tuning). It saves us merge attempt when the batch list
@@ -169,15 +234,15 @@ class Quarantine {
       if (cache_size > overhead_size &&
           overhead_size * (100 + kOverheadThresholdPercents) >
               cache_size * kOverheadThresholdPercents) {
-        cache_.MergeBatches(&tmp);
+        s->cache.MergeBatches(&tmp);
       }
       // Extract enough chunks from the quarantine to get below the max
       // quarantine size and leave some leeway for the newly quarantined chunks.
-      while (cache_.Size() > min_size) {
-        tmp.EnqueueBatch(cache_.DequeueBatch());
+      while (s->cache.Size() > min_size) {
+        tmp.EnqueueBatch(s->cache.DequeueBatch());
       }
     }
-    recycle_mutex_.Unlock();
+    s->recycle_mutex.Unlock();
     DoRecycle(&tmp, cb);
   }
 
@@ -176,4 +176,40 @@ TEST(SanitizerCommon, QuarantineCacheMergeBatchesALotOfBatches) {
   DeallocateCache(&to_deallocate);
 }
 
+TEST(SanitizerCommon, QuarantineDeferredRecycle) {
+  static Quarantine<QuarantineCallback, void> quarantine(LINKER_INITIALIZED);
+  const uptr kSize = 1 << 20;
+  const uptr kNumShards = 4;
+  const uptr kCacheSize = 1 << 16;
+  const uptr kChunkSize = 1 << 10;
+  quarantine.Init(kSize, kCacheSize, kNumShards, /*defer_recycle=*/true);
+  EXPECT_EQ(kNumShards, quarantine.GetNumShards());
+  EXPECT_TRUE(quarantine.DefersRecycle());
+  Cache cache;
+
+  // The recycling is deferred once the shard of the cache goes over its share
+  // of the quarantine size.
+  uptr num_puts = 0;
+  while (!quarantine.Put(&cache, cb, kFakePtr, kChunkSize))
+    num_puts++;
+  EXPECT_GE(num_puts * kChunkSize, kSize / kNumShards / 2);
+  EXPECT_LE(num_puts * kChunkSize, kSize / kNumShards);
+
+  // Once recycled, it is not over its share anymore.
+  quarantine.RecycleShards(cb);
+  EXPECT_FALSE(quarantine.Put(&cache, cb, kFakePtr, kChunkSize));
+
+  // Without RecycleShards(), it is recycled inline once it reaches twice its
+  // share.
+  while (!quarantine.Put(&cache, cb, kFakePtr, kChunkSize)) {
+  }
+  num_puts = 0;
+  while (quarantine.Put(&cache, cb, kFakePtr, kChunkSize)) {
+    num_puts++;
+    ASSERT_LE(num_puts * kChunkSize, 2 * kSize / kNumShards);
+  }
+
+  quarantine.DrainAndRecycle(&cache, cb);
+}
+
 }  // namespace __sanitizer
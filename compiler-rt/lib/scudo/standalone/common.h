@@ -130,6 +130,11 @@ inline uptr getPageSizeCached() {
 // Returns 0 if the number of CPUs could not be determined.
 u32 getNumberOfCPUs();
 
+// Returns the CPU the calling thread is running on, or -1 if it can't be read
+// cheaply, which on Linux requires a registered rseq area. The thread can
+// migrate at any point, so it is only a hint.
+s32 getCurrentCPU();
+
 const char *getEnv(const char *Name);
 
 u64 getMonotonicTime();
@@ -147,11 +152,14 @@ bool getRandom(void *Buffer, uptr Length, bool Blocking = false);
 #define MAP_NOACCESS (1U << 1)
 #define MAP_RESIZABLE (1U << 2)
 #define MAP_MEMTAG (1U << 3)
+#define MAP_HUGEPAGE (1U << 4)
 
 // Our platform memory mapping use is restricted to 3 scenarios:
 // - reserve memory at a random address (MAP_NOACCESS);
 // - commit memory in a previously reserved space;
 // - commit memory at a random address.
+// MAP_HUGEPAGE is a hint that the memory should be backed by huge pages, which
+// platforms without transparent huge pages ignore.
 // As such, only a subset of parameters combinations is valid, which is checked
 // by the function implementation. The Data parameter allows to pass opaque
 // platform specific data to the function.
@@ -69,6 +69,11 @@ void *map(void *Addr, uptr Size, UNUSED const char *Name, uptr Flags,
 #if SCUDO_ANDROID
   if (Name)
     prctl(ANDROID_PR_SET_VMA, ANDROID_PR_SET_VMA_ANON_NAME, P, Size, Name);
+#endif
+#if defined(MADV_HUGEPAGE)
+  // This is only a hint, which fails if transparent huge pages are disabled.
+  if (Flags & MAP_HUGEPAGE)
+    madvise(P, Size, MADV_HUGEPAGE);
 #endif
   return P;
 }
@@ -143,6 +148,40 @@ u32 getNumberOfCPUs() {
   return static_cast<u32>(CPU_COUNT(&CPUs));
 }
 
+#if !SCUDO_ANDROID && (defined(__x86_64__) || defined(__aarch64__))
+// Exported by glibc 2.35+, which registers a restartable sequences area for
+// every thread, at this offset from the thread pointer. The kernel keeps the
+// current CPU number up to date in the area.
+extern "C" WEAK const ptrdiff_t __rseq_offset;
+extern "C" WEAK const unsigned int __rseq_size;
+
+// The beginning of struct rseq from <linux/rseq.h>.
+struct RseqArea {
+  u32 CpuIdStart;
+  u32 CpuId;
+};
+#define SCUDO_HAS_RSEQ 1
+#else
+#define SCUDO_HAS_RSEQ 0
+#endif
+
+// sched_getcpu() is not used as a fallback: it is a system call on aarch64 and
+// on Android, which is far slower than the TSD lock it would help avoid.
+s32 getCurrentCPU() {
+#if SCUDO_HAS_RSEQ
+  if (&__rseq_size && __rseq_size != 0) {
+    const RseqArea *Rseq = reinterpret_cast<const RseqArea *>(
+        reinterpret_cast<uptr>(__builtin_thread_pointer()) + __rseq_offset);
+    // A value with the sign bit set means that the registration failed.
+    const s32 CPU = static_cast<s32>(
+        __atomic_load_n(&Rseq->CpuId, __ATOMIC_RELAXED));
+    if (LIKELY(CPU >= 0))
+      return CPU;
+  }
+#endif
+  return -1;
+}
+
 u32 getThreadID() {
 #if SCUDO_ANDROID
   return static_cast<u32>(gettid());
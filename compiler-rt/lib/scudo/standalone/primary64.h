@@ -34,6 +34,10 @@ namespace scudo {
 // they belong to. The Blocks created are shuffled to prevent predictable
 // address patterns (the predictability increases with the size of the Blocks).
 //
+// If PrimaryEnableHugePages is set, the mappings of a Region that outgrew a
+// huge page end on a huge page boundary and are backed by transparent huge
+// pages, and only the whole free huge pages of such a Region are released.
+//
 // The 1st Region (for size class 0) holds the TransferBatches. This is a
 // structure used to transfer arrays of available pointers from the class size
 // freelist to the thread specific freelist, and back.
@@ -159,17 +163,29 @@ public:
     uptr TotalMapped = 0;
     uptr PoppedBlocks = 0;
     uptr PushedBlocks = 0;
+    uptr HugePageRegions = 0;
+    uptr HugePageMapped = 0;
+    uptr HugePageKept = 0;
     for (uptr I = 0; I < NumClasses; I++) {
       RegionInfo *Region = getRegionInfo(I);
       if (Region->MappedUser)
         TotalMapped += Region->MappedUser;
       PoppedBlocks += Region->Stats.PoppedBlocks;
       PushedBlocks += Region->Stats.PushedBlocks;
+      if (Region->HugePages) {
+        HugePageRegions++;
+        HugePageMapped += Region->MappedUser;
+        HugePageKept += Region->ReleaseInfo.LastKeptBytes;
+      }
     }
     Str->append("Stats: SizeClassAllocator64: %zuM mapped (%uM rss) in %zu "
                 "allocations; remains %zu\n",
                 TotalMapped >> 20, 0U, PoppedBlocks,
                 PoppedBlocks - PushedBlocks);
+    if (hugePagesEnabled())
+      Str->append("Stats: SizeClassAllocator64: %zuM mapped with huge pages in "
+                  "%zu regions; %zuK free but kept in partial huge pages\n",
+                  HugePageMapped >> 20, HugePageRegions, HugePageKept >> 10);
 
     for (uptr I = 0; I < NumClasses; I++)
       getStats(Str, I, 0);
@@ -275,6 +291,8 @@ private:
   static const uptr PrimarySize = RegionSize * NumClasses;
 
   static const uptr MapSizeIncrement = Config::PrimaryMapSizeIncrement;
+  // Transparent huge page size on the 64-bit platforms with 4K pages.
+  static const uptr HugePageSize = 1UL << 21;
   // Fill at most this number of batches from the newly map'd memory.
   static const u32 MaxNumBatches = SCUDO_ANDROID ? 4U : 8U;
 
@@ -287,6 +305,8 @@ private:
     uptr PushedBlocksAtLastRelease;
     uptr RangesReleased;
     uptr LastReleasedBytes;
+    // Free bytes kept by the last release in partially free huge pages.
+    uptr LastKeptBytes;
     u64 LastReleaseAtNs;
   };
 
@@ -301,6 +321,7 @@ private:
     MapPlatformData Data = {};
     ReleaseToOsInfo ReleaseInfo = {};
     bool Exhausted = false;
+    bool HugePages = false; // Mapped with huge pages past the first one.
   };
   struct RegionInfo : UnpaddedRegionInfo {
     char Padding[SCUDO_CACHE_LINE_SIZE -
@@ -318,6 +339,11 @@ private:
     return &RegionInfoArray[ClassId];
   }
 
+  static bool hugePagesEnabled() {
+    return Config::PrimaryEnableHugePages &&
+           getPageSizeCached() < HugePageSize;
+  }
+
   uptr getRegionBaseByClassId(uptr ClassId) const {
     return PrimaryBase + (ClassId << Config::PrimaryRegionSizeLog);
   }
@@ -341,8 +367,16 @@ private:
     // Map more space for blocks, if necessary.
     if (TotalUserBytes > MappedUser) {
       // Do the mmap for the user memory.
-      const uptr MapSize =
-          roundUpTo(TotalUserBytes - MappedUser, MapSizeIncrement);
+      uptr MapSize = roundUpTo(TotalUserBytes - MappedUser, MapSizeIncrement);
+      // Only the Regions that outgrow a huge page use huge pages, so that the
+      // colder size classes do not fault in whole huge pages. Ending the
+      // mapping on a huge page boundary keeps the following ones aligned.
+      const bool UseHugePages =
+          hugePagesEnabled() && MappedUser + MapSize > HugePageSize;
+      if (UseHugePages) {
+        const uptr MapBeg = RegionBeg + MappedUser;
+        MapSize = roundUpTo(MapBeg + MapSize, HugePageSize) - MapBeg;
+      }
       const uptr RegionBase = RegionBeg - getRegionBaseByClassId(ClassId);
       if (UNLIKELY(RegionBase + MappedUser + MapSize > RegionSize)) {
         if (!Region->Exhausted) {
@@ -362,10 +396,12 @@ private:
               reinterpret_cast<void *>(RegionBeg + MappedUser), MapSize,
               "scudo:primary",
               MAP_ALLOWNOMEM | MAP_RESIZABLE |
-                  (useMemoryTagging<Config>(Options.load()) ? MAP_MEMTAG : 0),
+                  (useMemoryTagging<Config>(Options.load()) ? MAP_MEMTAG : 0) |
+                  (UseHugePages ? MAP_HUGEPAGE : 0),
               &Region->Data)))
         return nullptr;
       Region->MappedUser += MapSize;
+      Region->HugePages |= UseHugePages;
       C->getStats().add(StatMapped, MapSize);
     }
 
@@ -435,7 +471,7 @@ private:
     const uptr BytesInFreeList =
         Region->AllocatedUser -
         (Region->Stats.PoppedBlocks - Region->Stats.PushedBlocks) * BlockSize;
-    if (BytesInFreeList < PageSize)
+    if (BytesInFreeList < (Region->HugePages ? HugePageSize : PageSize))
       return 0; // No chance to release anything.
     const uptr BytesPushed = (Region->Stats.PushedBlocks -
                               Region->ReleaseInfo.PushedBlocksAtLastRelease) *
@@ -466,23 +502,42 @@ private:
       }
     }
 
-    ReleaseRecorder Recorder(Region->RegionBeg, &Region->Data);
+    uptr ReleasedRangesCount, ReleasedBytes;
+    if (Region->HugePages) {
+      HugePageReleaseRecorder Recorder(Region->RegionBeg, HugePageSize,
+                                       &Region->Data);
+      releaseRegionToOS(Region, ClassId, &Recorder);
+      ReleasedRangesCount = Recorder.getReleasedRangesCount();
+      ReleasedBytes = Recorder.getReleasedBytes();
+      Region->ReleaseInfo.LastKeptBytes = Recorder.getKeptBytes();
+    } else {
+      ReleaseRecorder Recorder(Region->RegionBeg, &Region->Data);
+      releaseRegionToOS(Region, ClassId, &Recorder);
+      ReleasedRangesCount = Recorder.getReleasedRangesCount();
+      ReleasedBytes = Recorder.getReleasedBytes();
+    }
+
+    if (ReleasedRangesCount > 0) {
+      Region->ReleaseInfo.PushedBlocksAtLastRelease =
+          Region->Stats.PushedBlocks;
+      Region->ReleaseInfo.RangesReleased += ReleasedRangesCount;
+      Region->ReleaseInfo.LastReleasedBytes = ReleasedBytes;
+    }
+    Region->ReleaseInfo.LastReleaseAtNs = getMonotonicTime();
+    return ReleasedBytes;
+  }
+
+  template <class ReleaseRecorderT>
+  void releaseRegionToOS(RegionInfo *Region, uptr ClassId,
+                         ReleaseRecorderT *Recorder) {
     const uptr CompactPtrBase = getCompactPtrBaseByClassId(ClassId);
     auto DecompactPtr = [CompactPtrBase](CompactPtrT CompactPtr) {
       return decompactPtrInternal(CompactPtrBase, CompactPtr);
     };
     auto SkipRegion = [](UNUSED uptr RegionIndex) { return false; };
     releaseFreeMemoryToOS(Region->FreeList, Region->AllocatedUser, 1U,
-                          BlockSize, &Recorder, DecompactPtr, SkipRegion);
-
-    if (Recorder.getReleasedRangesCount() > 0) {
-      Region->ReleaseInfo.PushedBlocksAtLastRelease =
-          Region->Stats.PushedBlocks;
-      Region->ReleaseInfo.RangesReleased += Recorder.getReleasedRangesCount();
-      Region->ReleaseInfo.LastReleasedBytes = Recorder.getReleasedBytes();
-    }
-    Region->ReleaseInfo.LastReleaseAtNs = getMonotonicTime();
-    return Recorder.getReleasedBytes();
+                          getSizeByClassId(ClassId), Recorder, DecompactPtr,
+                          SkipRegion);
   }
 };
 
@@ -41,6 +41,44 @@ private:
   MapPlatformData *Data = nullptr;
 };
 
+// A ReleaseRecorder that only releases the huge pages fully contained in the
+// ranges, so that the partially free huge pages at their ends, which are likely
+// backed by a transparent huge page, are not broken up.
+class HugePageReleaseRecorder {
+public:
+  HugePageReleaseRecorder(uptr Base, uptr HugePageSize,
+                          MapPlatformData *Data = nullptr)
+      : Recorder(Base, Data), HugePageSize(HugePageSize) {}
+
+  uptr getReleasedRangesCount() const {
+    return Recorder.getReleasedRangesCount();
+  }
+
+  uptr getReleasedBytes() const { return Recorder.getReleasedBytes(); }
+
+  // Free bytes that were kept because they are not a whole huge page.
+  uptr getKeptBytes() const { return KeptBytes; }
+
+  uptr getBase() const { return Recorder.getBase(); }
+
+  void releasePageRangeToOS(uptr From, uptr To) {
+    const uptr Base = getBase();
+    const uptr HugeFrom = roundUpTo(Base + From, HugePageSize) - Base;
+    const uptr HugeTo = roundDownTo(Base + To, HugePageSize) - Base;
+    if (HugeFrom >= HugeTo) {
+      KeptBytes += To - From;
+      return;
+    }
+    KeptBytes += (HugeFrom - From) + (To - HugeTo);
+    Recorder.releasePageRangeToOS(HugeFrom, HugeTo);
+  }
+
+private:
+  ReleaseRecorder Recorder;
+  const uptr HugePageSize;
+  uptr KeptBytes = 0;
+};
+
 // A packed array of Counters. Each counter occupies 2^N bits, enough to store
 // counter's MaxValue. Ctor will try to use a static buffer first, and if that
 // fails (the buffer is too small or already locked), will allocate the
@@ -31,6 +31,7 @@ struct TestConfig1 {
   static const scudo::uptr PrimaryCompactPtrScale = 0;
   static const bool PrimaryEnableRandomOffset = true;
   static const scudo::uptr PrimaryMapSizeIncrement = 1UL << 18;
+  static const bool PrimaryEnableHugePages = false;
 };
 
 struct TestConfig2 {
@@ -47,6 +48,7 @@ struct TestConfig2 {
   static const scudo::uptr PrimaryCompactPtrScale = 0;
   static const bool PrimaryEnableRandomOffset = true;
   static const scudo::uptr PrimaryMapSizeIncrement = 1UL << 18;
+  static const bool PrimaryEnableHugePages = false;
 };
 
 struct TestConfig3 {
@@ -63,6 +65,7 @@ struct TestConfig3 {
   static const scudo::uptr PrimaryCompactPtrScale = 0;
   static const bool PrimaryEnableRandomOffset = true;
   static const scudo::uptr PrimaryMapSizeIncrement = 1UL << 18;
+  static const bool PrimaryEnableHugePages = false;
 };
 
 template <typename BaseConfig, typename SizeClassMapT>
@@ -153,6 +156,7 @@ struct SmallRegionsConfig {
   static const scudo::uptr PrimaryCompactPtrScale = 0;
   static const bool PrimaryEnableRandomOffset = true;
   static const scudo::uptr PrimaryMapSizeIncrement = 1UL << 18;
+  static const bool PrimaryEnableHugePages = false;
 };
 
 // The 64-bit SizeClassAllocator can be easily OOM'd with small region sizes.
@@ -193,6 +197,48 @@ TEST(ScudoPrimaryTest, Primary64OOM) {
   Allocator.unmapTestOnly();
 }
 
+struct HugePagesConfig {
+  static const scudo::uptr PrimaryRegionSizeLog = 26U;
+  static const scudo::s32 PrimaryMinReleaseToOsIntervalMs = INT32_MIN;
+  static const scudo::s32 PrimaryMaxReleaseToOsIntervalMs = INT32_MAX;
+  static const bool MaySupportMemoryTagging = false;
+  typedef scudo::uptr PrimaryCompactPtrT;
+  static const scudo::uptr PrimaryCompactPtrScale = 0;
+  static const bool PrimaryEnableRandomOffset = true;
+  static const scudo::uptr PrimaryMapSizeIncrement = 1UL << 18;
+  static const bool PrimaryEnableHugePages = true;
+};
+
+// With huge pages, only whole free huge pages are released.
+TEST(ScudoPrimaryTest, Primary64HugePages) {
+  using Primary = TestAllocator<HugePagesConfig, scudo::DefaultSizeClassMap>;
+  const scudo::uptr HugePageSize = 1UL << 21;
+  if (scudo::getPageSizeCached() >= HugePageSize)
+    return;
+  std::unique_ptr<Primary> Allocator(new Primary);
+  Allocator->init(/*ReleaseToOsInterval=*/-1);
+  typename Primary::CacheT Cache;
+  Cache.init(nullptr, Allocator.get());
+  const scudo::uptr Size = 1024U;
+  const scudo::uptr ClassId = Primary::SizeClassMap::getClassIdBySize(Size);
+  std::vector<void *> Pointers;
+  for (scudo::uptr I = 0; I < (4 * HugePageSize) / Size; I++) {
+    void *P = Cache.allocate(ClassId);
+    memset(P, 'B', Size);
+    Pointers.push_back(P);
+  }
+  for (void *P : Pointers)
+    Cache.deallocate(ClassId, P);
+  Cache.destroy(nullptr);
+  const scudo::uptr Released = Allocator->releaseToOS();
+  EXPECT_GT(Released, 0U);
+  EXPECT_EQ(Released % HugePageSize, 0U);
+  scudo::ScopedString Str;
+  Allocator->getStats(&Str);
+  EXPECT_NE(strstr(Str.data(), "mapped with huge pages in 1 regions"),
+            nullptr);
+}
+
 SCUDO_TYPED_TEST(ScudoPrimaryTest, PrimaryIterate) {
   using Primary = TestAllocator<TypeParam, scudo::DefaultSizeClassMap>;
   std::unique_ptr<Primary> Allocator(new Primary);
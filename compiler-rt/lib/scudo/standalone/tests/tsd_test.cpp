@@ -17,6 +17,11 @@
 #include <mutex>
 #include <set>
 #include <thread>
+#include <vector>
+
+#if SCUDO_LINUX
+#include <sched.h>
+#endif
 
 // We mock out an allocator with a TSD registry, mostly using empty stubs. The
 // cache contains a single volatile uptr, to be able to test that several
@@ -64,6 +69,11 @@ struct SharedCaches {
   using TSDRegistryT = scudo::TSDRegistrySharedT<Allocator, 16U, 8U>;
 };
 
+struct PerCPUCaches {
+  template <class Allocator>
+  using TSDRegistryT = scudo::TSDRegistrySharedT<Allocator, 16U, 8U, true>;
+};
+
 struct ExclusiveCaches {
   template <class Allocator>
   using TSDRegistryT = scudo::TSDRegistryExT<Allocator>;
@@ -116,6 +126,7 @@ template <class AllocatorT> static void testRegistry() {
 TEST(ScudoTSDTest, TSDRegistryBasic) {
   testRegistry<MockAllocator<OneCache>>();
   testRegistry<MockAllocator<SharedCaches>>();
+  testRegistry<MockAllocator<PerCPUCaches>>();
 #if !SCUDO_FUCHSIA
   testRegistry<MockAllocator<ExclusiveCaches>>();
 #endif
@@ -174,6 +185,7 @@ template <class AllocatorT> static void testRegistryThreaded() {
 TEST(ScudoTSDTest, TSDRegistryThreaded) {
   testRegistryThreaded<MockAllocator<OneCache>>();
   testRegistryThreaded<MockAllocator<SharedCaches>>();
+  testRegistryThreaded<MockAllocator<PerCPUCaches>>();
 #if !SCUDO_FUCHSIA
   testRegistryThreaded<MockAllocator<ExclusiveCaches>>();
 #endif
@@ -248,3 +260,59 @@ TEST(ScudoTSDTest, TSDRegistryTSDsCount) {
   // We should get 16 distinct TSDs back.
   EXPECT_EQ(Pointers.size(), 16U);
 }
+
+#if SCUDO_LINUX
+static bool pinToCPU(int CPU) {
+  cpu_set_t CPUs;
+  CPU_ZERO(&CPUs);
+  CPU_SET(CPU, &CPUs);
+  return sched_setaffinity(0, sizeof(CPUs), &CPUs) == 0;
+}
+
+TEST(ScudoTSDTest, TSDRegistryPerCPU) {
+  using AllocatorT = MockAllocator<PerCPUCaches>;
+  cpu_set_t Affinity;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(Affinity), &Affinity), 0);
+  // Pick 2 CPUs that map to different TSDs.
+  const int NumberOfTSDs = std::min(CPU_COUNT(&Affinity), 16);
+  std::vector<int> CPUs;
+  for (int I = 0; I < CPU_SETSIZE && CPUs.size() < 2; I++)
+    if (CPU_ISSET(I, &Affinity) &&
+        (CPUs.empty() || CPUs[0] % NumberOfTSDs != I % NumberOfTSDs))
+      CPUs.push_back(I);
+  if (CPUs.size() < 2 || scudo::getCurrentCPU() < 0)
+    GTEST_SKIP() << "Needs at least 2 CPUs and rseq";
+
+  std::thread Thread([&CPUs]() {
+    auto Deleter = [](AllocatorT *A) {
+      A->unmapTestOnly();
+      delete A;
+    };
+    std::unique_ptr<AllocatorT, decltype(Deleter)> Allocator(new AllocatorT,
+                                                             Deleter);
+    auto Registry = Allocator->getTSDRegistry();
+    Registry->initThreadMaybe(Allocator.get(), /*MinimalInit=*/false);
+    auto GetTSD = [Registry]() {
+      bool UnlockRequired;
+      auto TSD = Registry->getTSDAndLock(&UnlockRequired);
+      EXPECT_NE(TSD, nullptr);
+      if (UnlockRequired)
+        TSD->unlock();
+      return TSD;
+    };
+    // The TSD follows the CPU the thread runs on.
+    if (!pinToCPU(CPUs[0]))
+      return;
+    auto TSD0 = GetTSD();
+    EXPECT_EQ(GetTSD(), TSD0);
+    if (!pinToCPU(CPUs[1]))
+      return;
+    auto TSD1 = GetTSD();
+    EXPECT_NE(TSD1, TSD0);
+    if (!pinToCPU(CPUs[0]))
+      return;
+    EXPECT_EQ(GetTSD(), TSD0);
+  });
+  Thread.join();
+}
+#endif
@@ -22,7 +22,14 @@
 
 namespace scudo {
 
-template <class Allocator, u32 TSDsArraySize, u32 DefaultTSDCount>
+// With PerCPU, a thread uses the TSD of the CPU it is running on rather than
+// the one it was assigned, so that with up to TSDsArraySize CPUs, the TSD lock
+// is only contended when a thread is preempted or migrated while holding it.
+// It is only enabled if getCurrentCPU() works when the registry is initialized,
+// that is if the platform registers an rseq area for each thread. Threads fall
+// back to their assigned TSD if the current CPU is unknown.
+template <class Allocator, u32 TSDsArraySize, u32 DefaultTSDCount,
+          bool PerCPU = false>
 struct TSDRegistrySharedT {
   void init(Allocator *Instance) {
     DCHECK(!Initialized);
@@ -30,8 +37,14 @@ struct TSDRegistrySharedT {
     for (u32 I = 0; I < TSDsArraySize; I++)
       TSDs[I].init(Instance);
     const u32 NumberOfCPUs = getNumberOfCPUs();
-    setNumberOfTSDs((NumberOfCPUs == 0) ? DefaultTSDCount
-                                        : Min(NumberOfCPUs, DefaultTSDCount));
+    if (PerCPU && NumberOfCPUs != 0 && getCurrentCPU() >= 0) {
+      NumberOfPerCPUTSDs = Min(NumberOfCPUs, TSDsArraySize);
+      setNumberOfTSDs(NumberOfPerCPUTSDs);
+    } else {
+      setNumberOfTSDs((NumberOfCPUs == 0)
+                          ? DefaultTSDCount
+                          : Min(NumberOfCPUs, DefaultTSDCount));
+    }
     Initialized = true;
   }
 
@@ -48,6 +61,7 @@ struct TSDRegistrySharedT {
       TSDs[I] = {};
     }
     setCurrentTSD(nullptr);
+    NumberOfPerCPUTSDs = 0;
     Initialized = false;
   }
 
@@ -62,6 +76,11 @@ struct TSDRegistrySharedT {
     TSD<Allocator> *TSD = getCurrentTSD();
     DCHECK(TSD);
     *UnlockRequired = true;
+    if (PerCPU && LIKELY(NumberOfPerCPUTSDs)) {
+      const s32 CPU = getCurrentCPU();
+      if (LIKELY(CPU >= 0))
+        TSD = &TSDs[static_cast<u32>(CPU) % NumberOfPerCPUTSDs];
+    }
     // Try to lock the currently associated context.
     if (TSD->tryLock())
       return TSD;
@@ -203,6 +222,8 @@ private:
 
   atomic_u32 CurrentIndex = {};
   u32 NumberOfTSDs = 0;
+  // Non-zero if the TSDs are picked by CPU, only written by init().
+  u32 NumberOfPerCPUTSDs = 0;
   u32 NumberOfCoPrimes = 0;
   u32 CoPrimes[TSDsArraySize] = {};
   bool Initialized = false;
@@ -369,8 +369,6 @@ Context::Context()
         return new (Alloc(sizeof(ThreadContext))) ThreadContext(tid);
       }),
       racy_mtx(MutexTypeRacy),
-      racy_stacks(),
-      racy_addresses(),
       fired_suppressions_mtx(MutexTypeFired),
       slot_mtx(MutexTypeSlots),
       resetting() {
@@ -30,6 +30,7 @@
 #include "sanitizer_common/sanitizer_asm.h"
 #include "sanitizer_common/sanitizer_common.h"
 #include "sanitizer_common/sanitizer_deadlock_detector_interface.h"
+#include "sanitizer_common/sanitizer_dense_map.h"
 #include "sanitizer_common/sanitizer_libignore.h"
 #include "sanitizer_common/sanitizer_suppressions.h"
 #include "sanitizer_common/sanitizer_thread_registry.h"
@@ -284,9 +285,19 @@ struct RacyStacks {
   bool operator==(const RacyStacks &other) const;
 };
 
-struct RacyAddress {
-  uptr addr_min;
-  uptr addr_max;
+// The stacks of a race are unordered, so the hash ignores their order too.
+struct RacyStacksInfo {
+  static RacyStacks getEmptyKey() { return {}; }
+  static RacyStacks getTombstoneKey() {
+    return {{{{~0ull, ~0ull}}, {{~0ull, ~0ull}}}};
+  }
+  static unsigned getHashValue(const RacyStacks &stacks) {
+    return DenseMapInfo<u64>::getHashValue(stacks.hash[0].hash[0] ^
+                                           stacks.hash[1].hash[0]);
+  }
+  static bool isEqual(const RacyStacks &lhs, const RacyStacks &rhs) {
+    return lhs == rhs;
+  }
 };
 
 struct FiredSuppression {
@@ -315,8 +326,11 @@ struct Context {
   ThreadRegistry thread_registry;
 
   Mutex racy_mtx;
-  Vector<RacyStacks> racy_stacks;
-  Vector<RacyAddress> racy_addresses;
+  // Reported stack pairs, so that the same race is reported once.
+  DenseMap<RacyStacks, bool, RacyStacksInfo> racy_stacks;
+  // Bytes of the reported shadow cells, indexed by their address, so that
+  // races on overlapping accesses are reported once.
+  DenseMap<uptr, u8> racy_addresses;
   // Number of fired suppressions may be large enough.
   Mutex fired_suppressions_mtx;
   InternalMmapVector<FiredSuppression> fired_suppressions;
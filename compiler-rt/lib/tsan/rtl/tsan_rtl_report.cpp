@@ -602,13 +602,10 @@ bool RacyStacks::operator==(const RacyStacks &other) const {
 }
 
 static bool FindRacyStacks(const RacyStacks &hash) {
-  for (uptr i = 0; i < ctx->racy_stacks.Size(); i++) {
-    if (hash == ctx->racy_stacks[i]) {
-      VPrintf(2, "ThreadSanitizer: suppressing report as doubled (stack)\n");
-      return true;
-    }
-  }
-  return false;
+  if (!ctx->racy_stacks.count(hash))
+    return false;
+  VPrintf(2, "ThreadSanitizer: suppressing report as doubled (stack)\n");
+  return true;
 }
 
 static bool HandleRacyStacks(ThreadState *thr, VarSizeStackTrace traces[2]) {
@@ -625,36 +622,36 @@ static bool HandleRacyStacks(ThreadState *thr, VarSizeStackTrace traces[2]) {
   Lock lock(&ctx->racy_mtx);
   if (FindRacyStacks(hash))
     return true;
-  ctx->racy_stacks.PushBack(hash);
+  ctx->racy_stacks[hash] = true;
   return false;
 }
 
-static bool FindRacyAddress(const RacyAddress &ra0) {
-  for (uptr i = 0; i < ctx->racy_addresses.Size(); i++) {
-    RacyAddress ra2 = ctx->racy_addresses[i];
-    uptr maxbeg = max(ra0.addr_min, ra2.addr_min);
-    uptr minend = min(ra0.addr_max, ra2.addr_max);
-    if (maxbeg < minend) {
-      VPrintf(2, "ThreadSanitizer: suppressing report as doubled (addr)\n");
-      return true;
-    }
-  }
-  return false;
+static bool FindRacyAddress(uptr cell, u8 bytes) {
+  auto *it = ctx->racy_addresses.find(cell);
+  if (!it || !(it->second & bytes))
+    return false;
+  VPrintf(2, "ThreadSanitizer: suppressing report as doubled (addr)\n");
+  return true;
 }
 
-static bool HandleRacyAddress(ThreadState *thr, uptr addr_min, uptr addr_max) {
+// Both accesses of a race are in the shadow cell at addr, so two races overlap
+// iff they are in the same cell and share a byte of it.
+static bool HandleRacyAddress(ThreadState *thr, uptr addr, uptr addr_min,
+                              uptr addr_max) {
   if (!flags()->suppress_equal_addresses)
     return false;
-  RacyAddress ra0 = {addr_min, addr_max};
+  DCHECK_LE(addr, addr_min);
+  DCHECK_LE(addr_max, addr + kShadowCell);
+  const u8 bytes = ((1u << (addr_max - addr_min)) - 1) << (addr_min - addr);
   {
     ReadLock lock(&ctx->racy_mtx);
-    if (FindRacyAddress(ra0))
+    if (FindRacyAddress(addr, bytes))
       return true;
   }
   Lock lock(&ctx->racy_mtx);
-  if (FindRacyAddress(ra0))
+  if (FindRacyAddress(addr, bytes))
     return true;
-  ctx->racy_addresses.PushBack(ra0);
+  ctx->racy_addresses[addr] |= bytes;
   return false;
 }
 
@@ -761,7 +758,7 @@ void ReportRace(ThreadState *thr, RawShadow *shadow_mem, Shadow cur, Shadow old,
   uptr addr_max = max(end0, end1);
   if (IsExpectedReport(addr_min, addr_max - addr_min))
     return;
-  if (HandleRacyAddress(thr, addr_min, addr_max))
+  if (HandleRacyAddress(thr, addr, addr_min, addr_max))
     return;
 
   ReportType rep_typ = ReportTypeRace;
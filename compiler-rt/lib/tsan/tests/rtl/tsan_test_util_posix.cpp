@@ -33,7 +33,7 @@ static __thread bool expect_report_reported;
 static __thread __tsan::ReportType expect_report_type;
 
 void ThreadSanitizer::TearDown() {
-  __tsan::ctx->racy_stacks.Reset();
+  __tsan::ctx->racy_stacks.clear();
 }
 
 static void *BeforeInitThread(void *param) {
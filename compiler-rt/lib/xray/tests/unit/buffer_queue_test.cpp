@@ -17,12 +17,14 @@
 #include <future>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
 namespace __xray {
 namespace {
 
 static constexpr size_t kSize = 4096;
 
+using ::testing::ElementsAre;
 using ::testing::Eq;
 
 TEST(BufferQueueTest, API) {
@@ -120,6 +122,65 @@ TEST(BufferQueueTest, Apply) {
   ASSERT_EQ(Count, 10);
 }
 
+TEST(BufferQueueTest, Drain) {
+  bool Success = false;
+  BufferQueue Buffers(kSize, 4, Success);
+  ASSERT_TRUE(Success);
+  BufferQueue::Buffer Live, B;
+  ASSERT_EQ(Buffers.getBuffer(Live), BufferQueue::ErrorCode::Ok);
+  for (int I = 0; I < 2; ++I) {
+    ASSERT_EQ(Buffers.getBuffer(B), BufferQueue::ErrorCode::Ok);
+    atomic_store(B.Extents, 1, memory_order_release);
+    ASSERT_EQ(Buffers.releaseBuffer(B), BufferQueue::ErrorCode::Ok);
+  }
+
+  // Only the released buffers are drained, and only once.
+  int Count = 0;
+  Buffers.drain([&](const BufferQueue::Buffer &B) {
+    EXPECT_NE(B.Data, Live.Data);
+    EXPECT_EQ(atomic_load(B.Extents, memory_order_acquire), 1u);
+    ++Count;
+  });
+  EXPECT_EQ(Count, 2);
+  Buffers.drain([&](const BufferQueue::Buffer &) { ++Count; });
+  EXPECT_EQ(Count, 2);
+
+  // The drained buffers are handed out again, while the live one is still
+  // written at the end.
+  Count = 0;
+  Buffers.apply([&](const BufferQueue::Buffer &) { ++Count; });
+  EXPECT_EQ(Count, 1);
+  for (int I = 0; I < 3; ++I) {
+    ASSERT_EQ(Buffers.getBuffer(B), BufferQueue::ErrorCode::Ok);
+    ASSERT_EQ(Buffers.releaseBuffer(B), BufferQueue::ErrorCode::Ok);
+  }
+  ASSERT_EQ(Buffers.releaseBuffer(Live), BufferQueue::ErrorCode::Ok);
+}
+
+TEST(BufferQueueTest, DrainFromMostRecent) {
+  bool Success = false;
+  BufferQueue Buffers(kSize, 3, Success);
+  ASSERT_TRUE(Success);
+  BufferQueue::Buffer B;
+  for (unsigned I = 1; I <= 3; ++I) {
+    ASSERT_EQ(Buffers.getBuffer(B), BufferQueue::ErrorCode::Ok);
+    atomic_store(B.Extents, I, memory_order_release);
+    ASSERT_EQ(Buffers.releaseBuffer(B), BufferQueue::ErrorCode::Ok);
+  }
+
+  // The buffer handed out next is the oldest one, so it is drained last and
+  // handing it out does not have to wait for the drain.
+  std::vector<uint64_t> Drained;
+  BufferQueue::Buffer Other;
+  Buffers.drain([&](const BufferQueue::Buffer &B) {
+    if (Drained.empty())
+      EXPECT_EQ(Buffers.getBuffer(Other), BufferQueue::ErrorCode::Ok);
+    Drained.push_back(atomic_load(B.Extents, memory_order_acquire));
+  });
+  EXPECT_THAT(Drained, ElementsAre(3u, 2u));
+  ASSERT_EQ(Buffers.releaseBuffer(Other), BufferQueue::ErrorCode::Ok);
+}
+
 TEST(BufferQueueTest, GenerationalSupport) {
   bool Success = false;
   BufferQueue Buffers(kSize, 10, Success);
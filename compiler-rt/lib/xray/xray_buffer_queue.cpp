@@ -132,6 +132,7 @@ BufferQueue::ErrorCode BufferQueue::init(size_t BS, size_t BC) {
     Buf.ExtentsBackingStore = ExtentsBackingStore;
     Buf.Count = BufferCount;
     T.Used = false;
+    T.Draining = false;
   }
 
   Next = Buffers;
@@ -165,7 +166,7 @@ BufferQueue::ErrorCode BufferQueue::getBuffer(Buffer &Buf) {
   BufferRep *B = nullptr;
   {
     SpinMutexLock Guard(&Mutex);
-    if (LiveBuffers == BufferCount)
+    if (LiveBuffers == BufferCount || Next->Draining)
       return ErrorCode::NotEnoughMemory;
     B = Next++;
     if (Next == (Buffers + BufferCount))
@@ -202,19 +203,50 @@ BufferQueue::ErrorCode BufferQueue::releaseBuffer(Buffer &Buf) {
     B = First++;
     if (First == (Buffers + BufferCount))
       First = Buffers;
+
+    // Now that the buffer has been released, we mark it as "used". We do this
+    // under the lock, so that drain(...) does not see the buffer before it is
+    // filled in.
+    B->Buff = Buf;
+    B->Used = true;
+    atomic_store(B->Buff.Extents,
+                 atomic_load(Buf.Extents, memory_order_acquire),
+                 memory_order_release);
   }
 
-  // Now that the buffer has been released, we mark it as "used".
-  B->Buff = Buf;
-  B->Used = true;
   decRefCount(Buf.BackingStore, Buf.Size, Buf.Count);
   decRefCount(Buf.ExtentsBackingStore, kExtentsSize, Buf.Count);
-  atomic_store(B->Buff.Extents, atomic_load(Buf.Extents, memory_order_acquire),
-               memory_order_release);
   Buf = {};
   return ErrorCode::Ok;
 }
 
+BufferQueue::BufferRep *BufferQueue::takeReleasedBuffer() {
+  SpinMutexLock Guard(&Mutex);
+  // The buffers that are not handed out are the ones from Next up to First.
+  // releaseBuffer(...) only stores into a handed out buffer, under the lock.
+  // Start from the most recently released one, next to First, as the one at
+  // Next is the first that getBuffer(...) hands out and it fails while that
+  // buffer is being drained.
+  BufferRep *B = First;
+  for (size_t I = LiveBuffers; I < BufferCount; ++I) {
+    if (B == Buffers)
+      B = Buffers + BufferCount;
+    --B;
+    if (B->Used && !B->Draining) {
+      B->Draining = true;
+      return B;
+    }
+  }
+  return nullptr;
+}
+
+void BufferQueue::finishDraining(BufferRep *B) {
+  SpinMutexLock Guard(&Mutex);
+  atomic_store(B->Buff.Extents, 0, memory_order_release);
+  B->Used = false;
+  B->Draining = false;
+}
+
 BufferQueue::ErrorCode BufferQueue::finalize() {
   if (atomic_exchange(&Finalizing, 1, memory_order_acq_rel))
     return ErrorCode::QueueFinalizing;
@@ -71,6 +71,10 @@ public:
     // This is true if the buffer has been returned to the available queue, and
     // is considered "used" by another thread.
     bool Used = false;
+
+    // This is true while the buffer is being drained, during which it is not
+    // handed out.
+    bool Draining = false;
   };
 
 private:
@@ -166,6 +170,14 @@ private:
   /// Releases references to the buffers backed by the current buffer queue.
   void cleanupBuffers();
 
+  /// Returns the most recently released buffer that is not handed out, marked
+  /// as draining, or nullptr if there are none.
+  BufferRep *takeReleasedBuffer();
+
+  /// Makes a buffer returned by takeReleasedBuffer() available as an empty
+  /// buffer again.
+  void finishDraining(BufferRep *B);
+
 public:
   enum class ErrorCode : unsigned {
     Ok,
@@ -258,6 +270,27 @@ public:
       Fn(*I);
   }
 
+  /// Applies the provided function F to each Buffer that has been released,
+  /// and not handed out again since, then makes it available as an empty
+  /// Buffer. This lets F write the Buffers out while the queue is in use,
+  /// rather than have them overwritten.
+  ///
+  /// The Buffers are drained from the most recently released one, so that the
+  /// one getBuffer(...) hands out next is drained last. The lock is not held
+  /// while F runs. In the meantime, getBuffer(...) fails with
+  /// ErrorCode::NotEnoughMemory if the next Buffer is being drained.
+  template <class F> void drain(F Fn) XRAY_NEVER_INSTRUMENT {
+    // Buffers released while we drain are left for the next call, so that we
+    // do not keep a busy queue locked out.
+    for (size_t I = 0; I < BufferCount; ++I) {
+      BufferRep *B = takeReleasedBuffer();
+      if (B == nullptr)
+        return;
+      Fn(static_cast<const Buffer &>(B->Buff));
+      finishDraining(B);
+    }
+  }
+
   using const_iterator = Iterator<const Buffer>;
   using iterator = Iterator<Buffer>;
 
@@ -89,6 +89,13 @@ static atomic_uint64_t TicksPerSec{0};
 static atomic_sint32_t LogFlushStatus = {
     XRayLogFlushStatus::XRAY_LOG_NOT_FLUSHING};
 
+// With stream_interval_ms, the log that the released buffers are written to
+// while logging, and the thread writing them.
+static LogWriter *StreamLW = nullptr;
+static pthread_t StreamThread;
+static bool StreamThreadStarted = false;
+static atomic_uint8_t StreamStopping{0};
+
 // This function will initialize the thread-local data structure used by the FDR
 // logging implementation and return a reference to it. The implementation
 // details require a bit of care to maintain.
@@ -275,6 +282,72 @@ XRayBuffer fdrIterator(const XRayBuffer B) {
   return Result;
 }
 
+static void writeBufferToLog(LogWriter *LW, const BufferQueue::Buffer &B)
+    XRAY_NEVER_INSTRUMENT {
+  // Starting at version 2 of the FDR logging implementation, we only write
+  // the records identified by the extents of the buffer. We use the Extents
+  // from the Buffer and write that out as the first record in the buffer.  We
+  // still use a Metadata record, but fill in the extents instead for the
+  // data.
+  MetadataRecord ExtentsRecord;
+  auto BufferExtents = atomic_load(B.Extents, memory_order_acquire);
+  DCHECK(BufferExtents <= B.Size);
+  ExtentsRecord.Type = uint8_t(RecordType::Metadata);
+  ExtentsRecord.RecordKind =
+      uint8_t(MetadataRecord::RecordKinds::BufferExtents);
+  internal_memcpy(ExtentsRecord.Data, &BufferExtents, sizeof(BufferExtents));
+  if (BufferExtents > 0) {
+    LW->WriteAll(reinterpret_cast<char *>(&ExtentsRecord),
+                 reinterpret_cast<char *>(&ExtentsRecord) +
+                     sizeof(MetadataRecord));
+    LW->WriteAll(reinterpret_cast<char *>(B.Data),
+                 reinterpret_cast<char *>(B.Data) + BufferExtents);
+  }
+}
+
+static void writeLogHeader(LogWriter *LW) XRAY_NEVER_INSTRUMENT {
+  XRayFileHeader Header = fdrCommonHeaderInfo();
+  Header.FdrData = FdrAdditionalHeaderData{BQ->ConfiguredBufferSize()};
+  LW->WriteAll(reinterpret_cast<char *>(&Header),
+               reinterpret_cast<char *>(&Header) + sizeof(Header));
+}
+
+static void *streamBuffers(void *) XRAY_NEVER_INSTRUMENT {
+  // Each buffer starts with the metadata records of its thread, including its
+  // wallclock time, so the buffers can be written in any order.
+  while (!atomic_load(&StreamStopping, memory_order_acquire)) {
+    SleepForMillis(fdrFlags()->stream_interval_ms);
+    BQ->drain([](const BufferQueue::Buffer &B) XRAY_NEVER_INSTRUMENT {
+      writeBufferToLog(StreamLW, B);
+    });
+  }
+  return nullptr;
+}
+
+static void startStreaming() XRAY_NEVER_INSTRUMENT {
+  StreamLW = LogWriter::Open();
+  if (StreamLW == nullptr) {
+    Report("XRay FDR: Failed to open the log, buffers are written when the "
+           "log is flushed.\n");
+    return;
+  }
+  writeLogHeader(StreamLW);
+  atomic_store(&StreamStopping, 0, memory_order_release);
+  StreamThreadStarted =
+      pthread_create(&StreamThread, nullptr, streamBuffers, nullptr) == 0;
+  if (!StreamThreadStarted)
+    Report("XRay FDR: Failed to start the thread streaming the buffers, they "
+           "are written when the log is flushed.\n");
+}
+
+static void stopStreaming() XRAY_NEVER_INSTRUMENT {
+  if (!StreamThreadStarted)
+    return;
+  atomic_store(&StreamStopping, 1, memory_order_release);
+  pthread_join(StreamThread, nullptr);
+  StreamThreadStarted = false;
+}
+
 // Must finalize before flushing.
 XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   if (atomic_load(&LoggingStatus, memory_order_acquire) !=
@@ -302,6 +375,9 @@ XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   // finalised before attempting to flush the log.
   SleepForMillis(fdrFlags()->grace_period_ms);
 
+  // The remaining buffers are written below, to the same log.
+  stopStreaming();
+
   // At this point, we're going to uninstall the iterator implementation, before
   // we decide to do anything further with the global buffer queue.
   __xray_log_remove_buffer_iterator();
@@ -337,18 +413,21 @@ XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   //      (fixed-sized) and let the tools reading the buffers deal with the data
   //      afterwards.
   //
-  LogWriter *LW = LogWriter::Open();
+  //  With stream_interval_ms, the header and the buffers released so far are
+  //  already in the streamed log.
+  //
+  LogWriter *LW = StreamLW;
+  StreamLW = nullptr;
   if (LW == nullptr) {
-    auto Result = XRayLogFlushStatus::XRAY_LOG_NOT_FLUSHING;
-    atomic_store(&LogFlushStatus, Result, memory_order_release);
-    return Result;
+    LW = LogWriter::Open();
+    if (LW == nullptr) {
+      auto Result = XRayLogFlushStatus::XRAY_LOG_NOT_FLUSHING;
+      atomic_store(&LogFlushStatus, Result, memory_order_release);
+      return Result;
+    }
+    writeLogHeader(LW);
   }
 
-  XRayFileHeader Header = fdrCommonHeaderInfo();
-  Header.FdrData = FdrAdditionalHeaderData{BQ->ConfiguredBufferSize()};
-  LW->WriteAll(reinterpret_cast<char *>(&Header),
-               reinterpret_cast<char *>(&Header) + sizeof(Header));
-
   // Release the current thread's buffer before we attempt to write out all the
   // buffers. This ensures that in case we had only a single thread going, that
   // we are able to capture the data nonetheless.
@@ -356,27 +435,7 @@ XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   if (TLD.Controller != nullptr)
     TLD.Controller->flush();
 
-  BQ->apply([&](const BufferQueue::Buffer &B) {
-    // Starting at version 2 of the FDR logging implementation, we only write
-    // the records identified by the extents of the buffer. We use the Extents
-    // from the Buffer and write that out as the first record in the buffer.  We
-    // still use a Metadata record, but fill in the extents instead for the
-    // data.
-    MetadataRecord ExtentsRecord;
-    auto BufferExtents = atomic_load(B.Extents, memory_order_acquire);
-    DCHECK(BufferExtents <= B.Size);
-    ExtentsRecord.Type = uint8_t(RecordType::Metadata);
-    ExtentsRecord.RecordKind =
-        uint8_t(MetadataRecord::RecordKinds::BufferExtents);
-    internal_memcpy(ExtentsRecord.Data, &BufferExtents, sizeof(BufferExtents));
-    if (BufferExtents > 0) {
-      LW->WriteAll(reinterpret_cast<char *>(&ExtentsRecord),
-                   reinterpret_cast<char *>(&ExtentsRecord) +
-                       sizeof(MetadataRecord));
-      LW->WriteAll(reinterpret_cast<char *>(B.Data),
-                   reinterpret_cast<char *>(B.Data) + BufferExtents);
-    }
-  });
+  BQ->apply([&](const BufferQueue::Buffer &B) { writeBufferToLog(LW, B); });
 
   atomic_store(&LogFlushStatus, XRayLogFlushStatus::XRAY_LOG_FLUSHED,
                memory_order_release);
@@ -704,6 +763,9 @@ XRayLogInitStatus fdrLoggingInit(size_t, size_t, void *Options,
                atomic_load_relaxed(&TicksPerSec) *
                    fdrFlags()->func_duration_threshold_us / 1000000,
                memory_order_release);
+
+  if (fdrFlags()->stream_interval_ms > 0 && !fdrFlags()->no_file_flush)
+    startStreaming();
   // Arg1 handler should go in first to avoid concurrent code accidentally
   // falling back to arg0 when it should have ran arg1.
   __xray_set_handler_arg1(fdrLoggingHandleArg1);
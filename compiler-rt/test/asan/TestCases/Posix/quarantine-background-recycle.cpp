@@ -0,0 +1,64 @@
+// Check the sharded quarantine recycled by a background thread, including
+// across fork().
+// RUN: %clangxx_asan -O0 %s -o %t -pthread
+// RUN: %env_asan_opts=quarantine_shards=8:quarantine_background_recycle=1:quarantine_size_mb=1:thread_local_quarantine_size_kb=64:verbosity=1 \
+// RUN:   %run %t 2>&1 | FileCheck %s
+// RUN: %env_asan_opts=quarantine_shards=8:quarantine_background_recycle=1 \
+// RUN:   not %run %t uaf 2>&1 | FileCheck %s --check-prefix=UAF
+// RUN: %env_asan_opts=quarantine_shards=0 not %run %t 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=INVALID
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void *Churn(void *) {
+  for (int i = 0; i < 10000; i++) {
+    char *p = (char *)malloc(1024);
+    memset(p, i, 1024);
+    free(p);
+  }
+  return nullptr;
+}
+
+static void ChurnInThreads() {
+  pthread_t threads[4];
+  for (pthread_t &t : threads)
+    pthread_create(&t, nullptr, Churn, nullptr);
+  for (pthread_t &t : threads)
+    pthread_join(t, nullptr);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "uaf")) {
+    char *volatile p = (char *)malloc(16);
+    free(p);
+    return p[0];
+    // UAF: heap-use-after-free
+  }
+
+  ChurnInThreads();
+  // CHECK: quarantine recycle thread started
+
+  // The recycle thread is stopped around fork(), so that the child can use the
+  // quarantine, and it is started again in both processes.
+  pid_t pid = fork();
+  if (pid == 0) {
+    ChurnInThreads();
+    fprintf(stderr, "child done\n");
+    _exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  ChurnInThreads();
+  fprintf(stderr, "parent done: %d\n", WEXITSTATUS(status));
+  // CHECK: quarantine recycle thread started
+  // CHECK: child done
+  // CHECK: parent done: 0
+  return 0;
+}
+
+// INVALID: quarantine_shards must be in [1, 64]
@@ -0,0 +1,28 @@
+// RUN: %clang_hwasan -mllvm -hwasan-sample-checks -O0 %s -o %t
+// RUN: not %run %t 2>&1 | FileCheck %s
+// RUN: %env_hwasan_opts=sample_checks_period=1000000 %run %t 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SAMPLED
+
+// REQUIRES: stable-runtime
+
+#include <sanitizer/hwasan_interface.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+__attribute__((noinline)) int load(char *volatile p) { return p[5]; }
+
+int main() {
+  // The first call of the thread is always checked, and the countdown then
+  // skips the next calls.
+  __hwasan_enable_allocator_tagging();
+  char *volatile x = (char *)malloc(10);
+  free(x);
+  int r = 0;
+  for (int i = 0; i < 10; ++i)
+    r += load(x);
+  // CHECK: ERROR: HWAddressSanitizer: tag-mismatch
+  // CHECK: in load
+  fprintf(stderr, "done\n");
+  // SAMPLED: done
+  return r == -1;
+}
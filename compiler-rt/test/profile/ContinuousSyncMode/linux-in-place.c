@@ -0,0 +1,26 @@
+// REQUIRES: linux
+
+// Without runtime counter relocation, the counter section itself is mapped
+// onto the profile, so the counts are in the file even though the program
+// exits without writing it.
+
+// RUN: %clang -fprofile-instr-generate -fcoverage-mapping -o %t.exe %s
+// RUN: echo "garbage" > %t.profraw
+// RUN: env LLVM_PROFILE_FILE="%c%t.profraw" %run %t.exe
+// RUN: llvm-profdata show --counts --function=foo %t.profraw | FileCheck %s
+
+// CHECK: foo:
+// CHECK: Function count: 3
+
+#include <unistd.h>
+
+extern int __llvm_profile_is_continuous_mode_enabled(void);
+
+void foo(void) {}
+
+int main() {
+  foo();
+  foo();
+  foo();
+  _exit(!__llvm_profile_is_continuous_mode_enabled());
+}
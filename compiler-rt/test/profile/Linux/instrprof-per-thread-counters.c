@@ -0,0 +1,33 @@
+// The counts of every thread are summed when the profile is written.
+
+// RUN: %clang_profgen -O2 -mllvm -instrprof-per-thread-counters -o %t %s -pthread
+// RUN: env LLVM_PROFILE_FILE=%t.profraw %run %t
+// RUN: llvm-profdata show --counts --function=foo %t.profraw | FileCheck %s
+
+// CHECK: foo:
+// CHECK: Function count: 40000
+// CHECK: Block counts: [20000]
+
+#include <pthread.h>
+
+__attribute__((noinline)) int foo(int X) {
+  if (X & 1)
+    return X + 1;
+  return 0;
+}
+
+static void *work(void *Arg) {
+  int R = 0;
+  for (int I = 0; I < 10000; ++I)
+    R += foo(I);
+  return (void *)(long)R;
+}
+
+int main() {
+  pthread_t Threads[4];
+  for (int I = 0; I < 4; ++I)
+    pthread_create(&Threads[I], 0, work, 0);
+  for (int I = 0; I < 4; ++I)
+    pthread_join(Threads[I], 0);
+  return 0;
+}
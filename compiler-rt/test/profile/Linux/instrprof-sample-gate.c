@@ -0,0 +1,30 @@
+// Only the calls made while the thread's sample gate is set are counted.
+
+// RUN: %clang_profgen -O0 -mllvm -instrprof-sample-gate -o %t %s
+// RUN: env LLVM_PROFILE_FILE=%t.profraw %run %t
+// RUN: llvm-profdata show --counts --function=foo %t.profraw | FileCheck %s
+
+// CHECK: foo:
+// CHECK: Function count: 3
+// CHECK: Block counts: [2]
+
+void __llvm_profile_set_sample_gate(int Enabled);
+
+__attribute__((noinline)) int foo(int X) {
+  if (X)
+    return X + 1;
+  return 0;
+}
+
+int main() {
+  int R = 0;
+  for (int I = 0; I < 5; ++I)
+    R += foo(I);
+  __llvm_profile_set_sample_gate(1);
+  R += foo(0);
+  R += foo(1);
+  R += foo(2);
+  __llvm_profile_set_sample_gate(0);
+  R += foo(3);
+  return R == 0;
+}
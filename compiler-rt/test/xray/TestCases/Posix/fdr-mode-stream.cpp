@@ -0,0 +1,50 @@
+// RUN: %clangxx_xray -g -std=c++11 %s -o %t
+// RUN: rm -f fdr-stream-test-*
+// RUN: XRAY_OPTIONS="patch_premain=false xray_logfile_base=fdr-stream-test- \
+// RUN:     verbosity=1" \
+// RUN: XRAY_FDR_OPTIONS="func_duration_threshold_us=0 stream_interval_ms=1" \
+// RUN:     %run %t 2>&1 | FileCheck --check-prefix=LOG %s
+// RUN: %llvm_xray account --format=csv --sort=funcid --instr_map=%t \
+// RUN:     "`ls fdr-stream-test-* | head -n1`" | FileCheck %s
+// RUN: rm -f fdr-stream-test-*
+//
+// REQUIRES: x86_64-target-arch
+// REQUIRES: built-in-llvm-tree
+
+// With stream_interval_ms, the buffers released while logging are written to
+// the log and reused, so a queue of a few small buffers holds every call.
+
+#include "xray/xray_log_interface.h"
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+[[clang::xray_always_instrument]] void __attribute__((noinline)) early() {}
+[[clang::xray_always_instrument]] void __attribute__((noinline)) late() {}
+
+int main(int argc, char *argv[]) {
+  auto status = __xray_log_init_mode(
+      "xray-fdr", "buffer_size=4096:buffer_max=4:func_duration_threshold_us=0:"
+                  "stream_interval_ms=1");
+  assert(status == XRayLogInitStatus::XRAY_LOG_INITIALIZED);
+  __xray_patch();
+
+  // Each round fills a couple of buffers, then gives the streaming thread the
+  // time to write them out.
+  for (int round = 0; round != 50; ++round) {
+    for (int i = 0; i != 200; ++i)
+      round < 25 ? early() : late();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  __xray_unpatch();
+  assert(__xray_log_finalize() == XRayLogInitStatus::XRAY_LOG_FINALIZED);
+  assert(__xray_log_flushLog() == XRayLogFlushStatus::XRAY_LOG_FLUSHED);
+  return 0;
+}
+
+// LOG: XRay FDR init successful.
+
+// CHECK: funcid,count,min,median,90%ile,99%ile,max,sum,debug,function
+// CHECK-NEXT: {{[0-9]+}},5000,{{.*}},{{.*}}early{{.*}}
+// CHECK-NEXT: {{[0-9]+}},5000,{{.*}},{{.*}}late{{.*}}
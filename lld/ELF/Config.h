@@ -10,6 +10,7 @@
 #define LLD_ELF_CONFIG_H
 
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
@@ -25,10 +26,15 @@
 #include <memory>
 #include <vector>
 
+namespace llvm {
+class MemoryBuffer;
+} // namespace llvm
+
 namespace lld {
 namespace elf {
 
 class InputFile;
+class OutputSection;
 class InputSectionBase;
 class Symbol;
 
@@ -47,6 +53,9 @@ enum class BsymbolicKind { None, NonWeakFunctions, Functions, All };
 // For --build-id.
 enum class BuildIdKind { None, Fast, Md5, Sha1, Hexstring, Uuid };
 
+// For --compress-debug-sections={none,zlib,zstd}.
+enum class DebugCompressionKind { None, Zlib, Zstd };
+
 // For --discard-{all,locals,none}.
 enum class DiscardPolicy { Default, All, Locals, None };
 
@@ -110,7 +119,9 @@ struct Configuration {
   llvm::StringRef entry;
   llvm::StringRef emulation;
   llvm::StringRef fini;
+  llvm::StringRef icfCache;
   llvm::StringRef init;
+  llvm::StringRef linkReport;
   llvm::StringRef ltoAAPipeline;
   llvm::StringRef ltoCSProfileFile;
   llvm::StringRef ltoNewPmPasses;
@@ -160,7 +171,7 @@ struct Configuration {
   bool callGraphProfileSort;
   bool checkSections;
   bool checkDynamicRelocs;
-  bool compressDebugSections;
+  DebugCompressionKind compressDebugSections;
   bool cref;
   std::vector<std::pair<llvm::GlobPattern, uint64_t>> deadRelocInNonAlloc;
   bool demangle = true;
@@ -183,6 +194,7 @@ struct Configuration {
   bool hasDynSymTab;
   bool ignoreDataAddressEquality;
   bool ignoreFunctionAddressEquality;
+  bool incremental;
   bool ltoCSProfileGenerate;
   bool ltoPGOWarnMismatch;
   bool ltoDebugPassManager;
@@ -281,6 +293,7 @@ struct Configuration {
   unsigned ltoo;
   unsigned optimize;
   StringRef thinLTOJobs;
+  uint64_t thinLTOMemoryBudget;
   unsigned timeTraceGranularity;
   int32_t splitStackAdjustSize;
 
@@ -315,12 +328,12 @@ struct Configuration {
   bool isMips64EL;
 
   // True if we need to reserve two .got entries for local-dynamic TLS model.
-  bool needsTlsLd = false;
+  std::atomic<bool> needsTlsLd{false};
 
   // True if we need to set the DF_STATIC_TLS flag to an output file, which
   // works as a hint to the dynamic loader that the shared object contains code
   // compiled with the initial-exec TLS model.
-  bool hasTlsIe = false;
+  std::atomic<bool> hasTlsIe{false};
 
   // Holds set of ELF header flags for the target.
   uint32_t eflags = 0;
@@ -378,6 +391,27 @@ struct Ctx {
   SmallVector<std::pair<Symbol *, unsigned>, 0> nonPrevailingSyms;
   // True if SHT_LLVM_SYMPART is used.
   std::atomic<bool> hasSympart{false};
+  // mmapped input file buffers sorted by address. See releaseInputPages().
+  SmallVector<llvm::MemoryBuffer *, 0> mmappedBuffers;
+
+  // Phase timers and statistics for --link-report=.
+  Timer rootTimer{"Total Link Time"};
+  Timer inputFileTimer{"Input File Reading", rootTimer};
+  Timer icfTimer{"ICF", rootTimer};
+  Timer finalizeTimer{"Finalize Sections", rootTimer};
+  Timer scanRelocTimer{"Scan Relocations", finalizeTimer};
+  Timer writeTimer{"Write Output File", rootTimer};
+  struct SectionStats {
+    uint64_t bytes = 0;
+    uint64_t relocations = 0;
+    size_t inputSections = 0;
+    double writeMillis = 0;
+  };
+  llvm::MapVector<const OutputSection *, SectionStats> outputSectionStats;
+  llvm::MapVector<const InputFile *, SectionStats> inputFileStats;
+  unsigned icfIterations = 0;
+  size_t duplicateCandidates = 0;
+  size_t peakMallocUsage = 0;
 };
 
 // The only instance of Ctx struct.
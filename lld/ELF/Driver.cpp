@@ -43,6 +43,7 @@
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/TargetOptionsCommandFlags.h"
+#include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringExtras.h"
@@ -55,6 +56,7 @@
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GlobPattern.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
@@ -62,6 +64,7 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include <cstdlib>
 #include <utility>
 
@@ -506,6 +509,110 @@ static void checkZOptions(opt::InputArgList &args) {
       warn("unknown -z value: " + StringRef(arg->getValue()));
 }
 
+// --incremental lets us skip a link whose result would be identical to the
+// output files left by a previous --incremental link. We record a digest of
+// the command line and the contents of every file we have read, along with
+// the size and timestamp of every file the link wrote, in a state file next to
+// the output. If the digest matches and none of the outputs has been touched
+// since, there is nothing to do. Any mismatch results in a full link.
+static std::string getIncrementalStatePath() {
+  return (config->outputFile + ".lld-state").str();
+}
+
+// Returns the files written by a link: the output file followed by the side
+// outputs that were asked for, such as the -Map file and the dependency file.
+// The names are part of the command line and so of the digest, so the order
+// is stable across links.
+static SmallVector<StringRef, 0> getIncrementalOutputs() {
+  SmallVector<StringRef, 0> v = {config->outputFile};
+  for (StringRef path :
+       {config->mapFile, config->dependencyFile, config->whyExtract,
+        config->printArchiveStats, config->printSymbolOrder})
+    if (!path.empty())
+      v.push_back(path);
+  return v;
+}
+
+static uint64_t computeInputDigest(ArrayRef<const char *> argsArr) {
+  llvm::TimeTraceScope timeScope("Compute input digest");
+  std::string buf;
+  raw_string_ostream os(buf);
+  os << getLLDVersion() << '\0';
+  SmallString<128> cwd;
+  if (!sys::fs::current_path(cwd))
+    os << cwd << '\0';
+  for (const char *arg : argsArr)
+    os << arg << '\0';
+
+  // Hash file contents in parallel; the combined digest depends only on the
+  // order of memoryBuffers, which is deterministic.
+  std::vector<uint64_t> hashes(memoryBuffers.size());
+  parallelForEachN(0, memoryBuffers.size(), [&](size_t i) {
+    hashes[i] = xxHash64(memoryBuffers[i]->getBuffer());
+  });
+  for (size_t i = 0, e = memoryBuffers.size(); i != e; ++i)
+    os << memoryBuffers[i]->getBufferIdentifier() << '\0'
+       << utohexstr(hashes[i]) << '\0';
+  return xxHash64(os.str());
+}
+
+static uint64_t getModificationTime(const sys::fs::file_status &st) {
+  return st.getLastModificationTime().time_since_epoch().count();
+}
+
+static bool isOutputUpToDate(uint64_t digest) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(getIncrementalStatePath(), /*IsText=*/true);
+  if (!mbOrErr)
+    return false;
+
+  // The state file holds the digest followed by the size and the timestamp of
+  // each output, in the order of getIncrementalOutputs().
+  SmallVector<StringRef, 0> outputs = getIncrementalOutputs();
+  SmallVector<StringRef, 8> fields;
+  (*mbOrErr)->getBuffer().trim().split(fields, ' ');
+  uint64_t savedDigest;
+  if (fields.size() != 2 + 2 * outputs.size() || fields[0] != "v2" ||
+      fields[1].getAsInteger(16, savedDigest) || savedDigest != digest)
+    return false;
+
+  for (size_t i = 0, e = outputs.size(); i != e; ++i) {
+    // A side output written to stdout has to be written again.
+    sys::fs::file_status st;
+    if (outputs[i] == "-" || sys::fs::status(outputs[i], st))
+      return false;
+    uint64_t savedSize, savedTime;
+    if (fields[2 + 2 * i].getAsInteger(10, savedSize) ||
+        fields[3 + 2 * i].getAsInteger(10, savedTime) ||
+        savedSize != st.getSize() || savedTime != getModificationTime(st))
+      return false;
+  }
+  return true;
+}
+
+static void writeIncrementalState(uint64_t digest) {
+  std::string path = getIncrementalStatePath();
+  std::string buf;
+  raw_string_ostream state(buf);
+  state << "v2 " << utohexstr(digest);
+  for (StringRef output : getIncrementalOutputs()) {
+    sys::fs::file_status st;
+    if (errorCount() || output == "-" || sys::fs::status(output, st)) {
+      sys::fs::remove(path);
+      return;
+    }
+    state << ' ' << st.getSize() << ' ' << getModificationTime(st);
+  }
+
+  std::error_code ec;
+  raw_fd_ostream os(path, ec, sys::fs::OF_Text);
+  if (ec) {
+    warn("cannot open " + path + ": " + ec.message());
+    return;
+  }
+  os << state.str() << '\n';
+}
+
 void LinkerDriver::linkerMain(ArrayRef<const char *> argsArr) {
   ELFOptTable parser;
   opt::InputArgList args = parser.parse(argsArr.slice(1));
@@ -572,8 +679,12 @@ void LinkerDriver::linkerMain(ArrayRef<const char *> argsArr) {
   {
     llvm::TimeTraceScope timeScope("ExecuteLinker");
 
+    ScopedTimer rootTimer(ctx->rootTimer);
     initLLVM();
-    createFiles(args);
+    {
+      ScopedTimer t(ctx->inputFileTimer);
+      createFiles(args);
+    }
     if (errorCount())
       return;
 
@@ -588,7 +699,18 @@ void LinkerDriver::linkerMain(ArrayRef<const char *> argsArr) {
     // values such as a default image base address.
     target = getTarget();
 
-    link(args);
+    // An output file name of "-" means stdout, which cannot be reused.
+    bool incremental = config->incremental && config->outputFile != "-";
+    uint64_t digest = incremental ? computeInputDigest(argsArr) : 0;
+    if (incremental && isOutputUpToDate(digest)) {
+      log("--incremental: " + config->outputFile + " is up to date");
+    } else {
+      link(args);
+      if (incremental)
+        writeIncrementalState(digest);
+    }
+    rootTimer.stop();
+    writeLinkReport();
   }
 
   if (config->timeTraceEnabled) {
@@ -948,15 +1070,20 @@ template <class ELFT> static void readCallGraphsFromObjectFiles() {
   }
 }
 
-static bool getCompressDebugSections(opt::InputArgList &args) {
+static DebugCompressionKind getCompressDebugSections(opt::InputArgList &args) {
   StringRef s = args.getLastArgValue(OPT_compress_debug_sections, "none");
   if (s == "none")
-    return false;
+    return DebugCompressionKind::None;
+  if (s == "zstd") {
+    if (!zstd::isAvailable())
+      error("--compress-debug-sections: zstd is not available");
+    return DebugCompressionKind::Zstd;
+  }
   if (s != "zlib")
     error("unknown --compress-debug-sections value: " + s);
   if (!zlib::isAvailable())
     error("--compress-debug-sections: zlib is not available");
-  return true;
+  return DebugCompressionKind::Zlib;
 }
 
 static StringRef getAliasSpelling(opt::Arg *arg) {
@@ -1090,11 +1217,15 @@ static void readConfigs(opt::InputArgList &args) {
   config->gnuUnique = args.hasFlag(OPT_gnu_unique, OPT_no_gnu_unique, true);
   config->gdbIndex = args.hasFlag(OPT_gdb_index, OPT_no_gdb_index, false);
   config->icf = getICF(args);
+  config->icfCache = args.getLastArgValue(OPT_icf_cache);
   config->ignoreDataAddressEquality =
       args.hasArg(OPT_ignore_data_address_equality);
   config->ignoreFunctionAddressEquality =
       args.hasArg(OPT_ignore_function_address_equality);
+  config->incremental =
+      args.hasFlag(OPT_incremental, OPT_no_incremental, false);
   config->init = args.getLastArgValue(OPT_init, "_init");
+  config->linkReport = args.getLastArgValue(OPT_link_report);
   config->ltoAAPipeline = args.getLastArgValue(OPT_lto_aa_pipeline);
   config->ltoCSProfileGenerate = args.hasArg(OPT_lto_cs_profile_generate);
   config->ltoCSProfileFile = args.getLastArgValue(OPT_lto_cs_profile_file);
@@ -1328,8 +1459,19 @@ static void readConfigs(opt::InputArgList &args) {
     parallel::strategy = hardware_concurrency(threads);
     config->thinLTOJobs = v;
   }
+  parallel::executorKind =
+      args.hasFlag(OPT_work_stealing, OPT_no_work_stealing, false)
+          ? parallel::ExecutorKind::WorkStealing
+          : parallel::ExecutorKind::SharedQueue;
   if (auto *arg = args.getLastArg(OPT_thinlto_jobs))
     config->thinLTOJobs = arg->getValue();
+  int64_t thinLTOMemoryBudget =
+      args::getInteger(args, OPT_thinlto_memory_budget, 0);
+  if (thinLTOMemoryBudget < 0)
+    error("--thinlto-memory-budget: expected a non-negative integer, but got " +
+          Twine(thinLTOMemoryBudget));
+  config->thinLTOMemoryBudget = std::max<int64_t>(thinLTOMemoryBudget, 0)
+                                << 20;
 
   if (config->ltoo > 3)
     error("invalid optimization level for LTO: " + Twine(config->ltoo));
@@ -2351,6 +2493,16 @@ static uint32_t getAndFeatures() {
   return ret;
 }
 
+template <class ELFT> static void prehashGlobalNames(InputFile *file) {
+  if (auto *f = dyn_cast<ObjFile<ELFT>>(file))
+    f->prehashGlobalNames();
+}
+
+template <class ELFT> static void releaseGlobalNames(InputFile *file) {
+  if (auto *f = dyn_cast<ObjFile<ELFT>>(file))
+    f->releaseGlobalNames();
+}
+
 static void initializeLocalSymbols(ELFFileBase *file) {
   switch (config->ekind) {
   case ELF32LEKind:
@@ -2444,12 +2596,24 @@ void LinkerDriver::link(opt::InputArgList &args) {
   // symbols that we need to the symbol table. This process might
   // add files to the link, via autolinking, these files are always
   // appended to the Files vector.
+  //
+  // Symbol resolution is serial, so read and hash global symbol names for all
+  // files in parallel first. Lazy archive members that are never extracted
+  // keep their names until the loop is done, so release them afterwards.
   {
     llvm::TimeTraceScope timeScope("Parse input files");
+    parallelForEach(files, [](InputFile *file) {
+      if (file->isElf() && file->ekind == config->ekind)
+        invokeELFT(prehashGlobalNames, file);
+    });
     for (size_t i = 0; i < files.size(); ++i) {
       llvm::TimeTraceScope timeScope("Parse input files", files[i]->getName());
       parseFile(files[i]);
     }
+    parallelForEach(files, [](InputFile *file) {
+      if (file->isElf() && file->ekind == config->ekind)
+        invokeELFT(releaseGlobalNames, file);
+    });
   }
 
   // Now that we have every file, we can decide if we will need a
@@ -2524,6 +2688,7 @@ void LinkerDriver::link(opt::InputArgList &args) {
     cast<Undefined>(sym).nonPrevailing = true;
   }
   ctx->nonPrevailingSyms.clear();
+  ctx->duplicateCandidates += ctx->duplicates.size();
   for (const DuplicateSymbol &d : ctx->duplicates)
     reportDuplicate(*d.sym, d.file, d.section, d.value);
   ctx->duplicates.clear();
@@ -2599,6 +2764,7 @@ void LinkerDriver::link(opt::InputArgList &args) {
   auto newObjectFiles = makeArrayRef(objectFiles).slice(numObjsBeforeLTO);
   parallelForEach(newObjectFiles, initializeLocalSymbols);
   parallelForEach(newObjectFiles, postParseObjectFile);
+  ctx->duplicateCandidates += ctx->duplicates.size();
   for (const DuplicateSymbol &d : ctx->duplicates)
     reportDuplicate(*d.sym, d.file, d.section, d.value);
 
@@ -2752,6 +2918,7 @@ void LinkerDriver::link(opt::InputArgList &args) {
   // Two input sections with different output sections should not be folded.
   // ICF runs after processSectionCommands() so that we know the output sections.
   if (config->icf != ICFLevel::None) {
+    ScopedTimer t(ctx->icfTimer);
     invokeELFT(findKeepUniqueSections, args);
     invokeELFT(doIcf);
   }
@@ -2767,3 +2934,93 @@ void LinkerDriver::link(opt::InputArgList &args) {
   // Write the result to the file.
   invokeELFT(writeResult);
 }
+
+// Calls fn on each phase timer in pre-order and then on the root timer.
+static void forEachPhase(function_ref<void(const Timer &)> fn) {
+  std::function<void(const Timer &)> visit = [&](const Timer &t) {
+    for (const Timer *child : t.getChildren()) {
+      fn(*child);
+      visit(*child);
+    }
+  };
+  visit(ctx->rootTimer);
+  fn(ctx->rootTimer);
+}
+
+static void writeLinkReportCsv(raw_ostream &os) {
+  os << "kind,name,bytes,relocations,input_sections,millis\n";
+  auto quote = [](StringRef s) {
+    std::string ret = "\"";
+    for (char c : s) {
+      if (c == '"')
+        ret += '"';
+      ret += c;
+    }
+    return ret + '"';
+  };
+  forEachPhase([&](const Timer &t) {
+    os << "phase," << quote(t.getName()) << ",,,," << t.millis() << '\n';
+  });
+  for (auto &it : ctx->outputSectionStats)
+    os << "output_section," << quote(it.first->name) << ',' << it.second.bytes
+       << ',' << it.second.relocations << ',' << it.second.inputSections << ','
+       << it.second.writeMillis << '\n';
+  for (auto &it : ctx->inputFileStats)
+    os << "input_file," << quote(toString(it.first)) << ','
+       << it.second.bytes << ',' << it.second.relocations << ','
+       << it.second.inputSections << ",\n";
+}
+
+static void writeLinkReportJson(raw_ostream &os) {
+  json::OStream j(os, 2);
+  j.object([&] {
+    j.attributeObject("phases", [&] {
+      forEachPhase(
+          [&](const Timer &t) { j.attribute(t.getName(), t.millis()); });
+    });
+    j.attribute("icfIterations", ctx->icfIterations);
+    j.attribute("duplicateSymbolCandidates", ctx->duplicateCandidates);
+    j.attribute("peakMallocUsage", ctx->peakMallocUsage);
+    j.attributeArray("outputSections", [&] {
+      for (auto &it : ctx->outputSectionStats)
+        j.object([&] {
+          j.attribute("name", it.first->name);
+          j.attribute("size", it.first->size);
+          j.attribute("bytesCopied", it.second.bytes);
+          j.attribute("relocations", it.second.relocations);
+          j.attribute("inputSections", it.second.inputSections);
+          j.attribute("writeMillis", it.second.writeMillis);
+        });
+    });
+    j.attributeArray("inputFiles", [&] {
+      for (auto &it : ctx->inputFileStats)
+        j.object([&] {
+          j.attribute("name", toString(it.first));
+          j.attribute("bytesCopied", it.second.bytes);
+          j.attribute("relocations", it.second.relocations);
+          j.attribute("inputSections", it.second.inputSections);
+        });
+    });
+  });
+  os << '\n';
+}
+
+// Handle --link-report=. This is meant to be used to find out which inputs
+// and output sections make a link slow, and to track that over time.
+void LinkerDriver::writeLinkReport() const {
+  if (config->linkReport.empty())
+    return;
+
+  std::error_code ec;
+  raw_fd_ostream os(config->linkReport, ec, sys::fs::OF_None);
+  if (ec) {
+    error("--link-report=: cannot open " + config->linkReport + ": " +
+          ec.message());
+    return;
+  }
+
+  if (config->linkReport.endswith_insensitive(".csv"))
+    writeLinkReportCsv(os);
+  else
+    writeLinkReportJson(os);
+}
@@ -35,6 +35,7 @@ private:
   template <class ELFT> void compileBitcodeFiles(bool skipLinkedOutput);
   void writeArchiveStats() const;
   void writeWhyExtract() const;
+  void writeLinkReport() const;
   void reportBackrefs() const;
 
   // True if we are in --whole-archive and --no-whole-archive.
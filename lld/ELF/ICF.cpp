@@ -82,6 +82,10 @@
 #include "SyntheticSections.h"
 #include "llvm/BinaryFormat/ELF.h"
 #include "llvm/Object/ELF.h"
+#include "llvm/Support/BLAKE3.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Parallel.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/xxhash.h"
@@ -120,8 +124,19 @@ private:
 
   void forEachClass(llvm::function_ref<void(size_t, size_t)> fn);
 
+  using Digest = BLAKE3Result<16>;
+  template <class RelTy>
+  static Digest getDigest(const InputSection *sec, ArrayRef<RelTy> rels);
+  void computeDigests();
+  void readCache();
+  void writeCache();
+
   SmallVector<InputSection *, 0> sections;
 
+  // For --icf-cache=. digests[i] is the digest of the section that was
+  // sections[i] before sections were sorted.
+  SmallVector<std::pair<InputSection *, Digest>, 0> digests;
+
   // We repeat the main loop while `Repeat` is true.
   std::atomic<bool> repeat;
 
@@ -449,6 +464,134 @@ static void combineRelocHashes(unsigned cnt, InputSection *isec,
   isec->eqClass[(cnt + 1) % 2] = hash | (1U << 31);
 }
 
+// --icf-cache= maps a digest of each eligible section to the equivalence
+// class it ended up in during the previous link. We use the cached class as
+// part of the initial hash, so the main loop starts from (almost) the final
+// partition and converges in a few iterations. This is always safe: the
+// main loop still verifies every equivalence, and starting from a finer
+// partition can only result in fewer folds, never in wrong folds.
+//
+// For this to not lose any folds, sections that end up in the same class
+// must have the same digest, so the digest only covers what the main loop
+// compares: the section contents and, for each relocation, its type, offset
+// and what it refers to. A reference to an eligible section is described by
+// that section's initial content hash and the offset within it, not by the
+// name of the symbol, so that it is the same for any two references that the
+// main loop may find equal. Other InputSections are described by their size
+// and absolute symbols by their value. Everything else, such as references to
+// merge sections, is left out. Sections with equal digests may still be
+// different; that just makes the seed coarser.
+static constexpr char icfCacheMagic[] = "LLDICF02";
+
+template <class ELFT>
+template <class RelTy>
+typename ICF<ELFT>::Digest ICF<ELFT>::getDigest(const InputSection *sec,
+                                                ArrayRef<RelTy> rels) {
+  BLAKE3 hasher;
+  auto add = [&](uint64_t v) {
+    uint8_t buf[8];
+    support::endian::write64le(buf, v);
+    hasher.update(buf);
+  };
+  add(sec->flags);
+  add(sec->rawData.size());
+  hasher.update(sec->rawData);
+  for (const RelTy &rel : rels) {
+    add(rel.getType(config->isMips64EL));
+    add(rel.r_offset);
+    Symbol &sym = sec->template getFile<ELFT>()->getRelocTargetSym(rel);
+    auto *d = dyn_cast<Defined>(&sym);
+    if (!d || d->scriptDefined || d->isPreemptible) {
+      add(0);
+      continue;
+    }
+    uint64_t addend = getAddend<ELFT>(rel);
+    if (!d->section) {
+      add(1);
+      add(d->value + addend);
+    } else if (auto *isec = dyn_cast<InputSection>(d->section)) {
+      // This runs before the relocation hashes are propagated, so eqClass[0]
+      // is still the content hash for eligible sections. Other sections have
+      // a unique ID, which differs between links, so we use their size.
+      uint32_t eqClass = isec->eqClass[0];
+      add(2);
+      add(eqClass & (1U << 31) ? eqClass : isec->getSize());
+      add(d->value + addend);
+    } else {
+      add(3);
+    }
+  }
+  return hasher.final<16>();
+}
+
+template <class ELFT> void ICF<ELFT>::computeDigests() {
+  digests.resize(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    InputSection *s = sections[i];
+    const RelsOrRelas<ELFT> rels = s->template relsOrRelas<ELFT>();
+    digests[i] = {s, rels.areRelocsRel() ? getDigest(s, rels.rels)
+                                         : getDigest(s, rels.relas)};
+  });
+}
+
+template <class ELFT> void ICF<ELFT>::readCache() {
+  llvm::TimeTraceScope timeScope("Read ICF cache");
+
+  // A missing or malformed cache is not an error; we just start afresh.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(config->icfCache, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (!mbOrErr)
+    return;
+  StringRef buf = (*mbOrErr)->getBuffer();
+  const size_t entSize = sizeof(Digest) + 4;
+  const size_t hdrSize = sizeof(icfCacheMagic) - 1;
+  if (!buf.startswith(icfCacheMagic) || (buf.size() - hdrSize) % entSize) {
+    warn("--icf-cache=: ignoring malformed file " + config->icfCache);
+    return;
+  }
+
+  DenseMap<CachedHashStringRef, uint32_t> classes;
+  for (size_t off = hdrSize; off != buf.size(); off += entSize) {
+    StringRef key = buf.substr(off, sizeof(Digest));
+    classes[CachedHashStringRef(key)] =
+        support::endian::read32le(buf.data() + off + sizeof(Digest));
+  }
+
+  parallelForEach(digests, [&](std::pair<InputSection *, Digest> &p) {
+    StringRef key(reinterpret_cast<const char *>(p.second.data()),
+                  p.second.size());
+    auto it = classes.find(CachedHashStringRef(key));
+    if (it != classes.end())
+      p.first->eqClass[0] =
+          hash_combine(p.first->eqClass[0], it->second) | (1U << 31);
+  });
+}
+
+template <class ELFT> void ICF<ELFT>::writeCache() {
+  // Label each final class by the position of its first member.
+  DenseMap<const InputSection *, uint32_t> labels;
+  forEachClassRange(0, sections.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i != end; ++i)
+      labels[sections[i]] = begin + 1;
+  });
+
+  std::error_code ec;
+  raw_fd_ostream os(config->icfCache, ec, sys::fs::OF_None);
+  if (ec) {
+    error("--icf-cache=: cannot open " + config->icfCache + ": " +
+          ec.message());
+    return;
+  }
+  os << icfCacheMagic;
+  for (const std::pair<InputSection *, Digest> &p : digests) {
+    uint8_t label[4];
+    support::endian::write32le(label, labels.lookup(p.first));
+    os.write(reinterpret_cast<const char *>(p.second.data()), p.second.size());
+    os.write(reinterpret_cast<const char *>(label), sizeof(label));
+  }
+}
+
 static void print(const Twine &s) {
   if (config->printIcfSections)
     message(s);
@@ -495,6 +638,9 @@ template <class ELFT> void ICF<ELFT>::run() {
     s->eqClass[0] = xxHash64(s->rawData) | (1U << 31);
   });
 
+  if (!config->icfCache.empty())
+    computeDigests();
+
   // Perform 2 rounds of relocation hash propagation. 2 is an empirical value to
   // reduce the average sizes of equivalence classes, i.e. segregate() which has
   // a large time complexity will have less work to do.
@@ -508,6 +654,9 @@ template <class ELFT> void ICF<ELFT>::run() {
     });
   }
 
+  if (!config->icfCache.empty())
+    readCache();
+
   // From now on, sections in Sections vector are ordered so that sections
   // in the same equivalence class are consecutive in the vector.
   llvm::stable_sort(sections, [](const InputSection *a, const InputSection *b) {
@@ -531,6 +680,10 @@ template <class ELFT> void ICF<ELFT>::run() {
   } while (repeat);
 
   log("ICF needed " + Twine(cnt) + " iterations");
+  ctx->icfIterations = cnt;
+
+  if (!config->icfCache.empty())
+    writeCache();
 
   // Merge sections by the equivalence class.
   forEachClassRange(0, sections.size(), [&](size_t begin, size_t end) {
@@ -130,6 +130,37 @@ Optional<MemoryBufferRef> elf::readFile(StringRef path) {
   return mbref;
 }
 
+void elf::collectMmappedBuffers() {
+  ctx->mmappedBuffers.clear();
+  for (std::unique_ptr<MemoryBuffer> &mb : memoryBuffers)
+    if (mb->getBufferKind() == MemoryBuffer::MemoryBuffer_MMap)
+      ctx->mmappedBuffers.push_back(mb.get());
+  llvm::sort(ctx->mmappedBuffers, [](MemoryBuffer *a, MemoryBuffer *b) {
+    return a->getBufferStart() < b->getBufferStart();
+  });
+}
+
+void elf::releaseInputPages(ArrayRef<uint8_t> data) {
+  // Small sections rarely cover a whole page, and releasing them is not
+  // worth a system call.
+  if (data.size() < 64 * 1024)
+    return;
+
+  // Find the buffer containing `data`. It may not exist because `data` may
+  // be heap-allocated, e.g. decompressed section contents.
+  const char *start = reinterpret_cast<const char *>(data.data());
+  auto it = llvm::upper_bound(
+      ctx->mmappedBuffers, start, [](const char *p, MemoryBuffer *mb) {
+        return p < mb->getBufferStart();
+      });
+  if (it == ctx->mmappedBuffers.begin())
+    return;
+  MemoryBuffer *mb = *--it;
+  if (start + data.size() > mb->getBufferEnd())
+    return;
+  mb->dontNeedIfMmap(start - mb->getBufferStart(), data.size());
+}
+
 // All input object files must be for the same architecture
 // (e.g. it does not make sense to link x86 object files with
 // MIPS object files.) This function checks for that error.
@@ -1011,15 +1042,14 @@ InputSectionBase *ObjFile<ELFT>::createInputSection(uint32_t idx,
 // its corresponding ELF symbol table.
 template <class ELFT>
 void ObjFile<ELFT>::initializeSymbols(const object::ELFFile<ELFT> &obj) {
-  SymbolTable &symtab = *elf::symtab;
-
   ArrayRef<Elf_Sym> eSyms = this->getELFSyms<ELFT>();
   symbols.resize(eSyms.size());
 
   // Some entries have been filled by LazyObjFile.
   for (size_t i = firstGlobal, end = eSyms.size(); i != end; ++i)
     if (!symbols[i])
-      symbols[i] = symtab.insert(CHECK(eSyms[i].getName(stringTable), this));
+      symbols[i] = insertGlobal(i);
+  globalNames = {};
 
   // Perform symbol resolution on non-local symbols.
   SmallVector<unsigned, 32> undefineds;
@@ -1747,14 +1777,38 @@ InputFile *elf::createLazyFile(MemoryBufferRef mb, StringRef archiveName,
   return file;
 }
 
+// Reads and hashes the names of global symbols ahead of symbol resolution.
+// Symbol resolution must be serial because its outcome depends on the order
+// in which files are visited, but locating names in the string table and
+// hashing them does not, so this is called for all input files in parallel.
+template <class ELFT> void ObjFile<ELFT>::prehashGlobalNames() {
+  ArrayRef<Elf_Sym> eSyms = this->getGlobalELFSyms<ELFT>();
+  globalNames.resize(eSyms.size());
+  for (size_t i = 0, e = eSyms.size(); i != e; ++i) {
+    // Leave entries with a broken name empty. insertGlobal will report the
+    // error on the serial path, where calling fatal() is safe.
+    Expected<StringRef> name = eSyms[i].getName(stringTable);
+    if (name)
+      globalNames[i] = SymbolTable::prehash(*name);
+    else
+      consumeError(name.takeError());
+  }
+}
+
+template <class ELFT> Symbol *ObjFile<ELFT>::insertGlobal(size_t i) {
+  if (!globalNames.empty() && globalNames[i - firstGlobal].data)
+    return symtab->insert(globalNames[i - firstGlobal]);
+  const Elf_Sym &eSym = this->getELFSyms<ELFT>()[i];
+  return symtab->insert(CHECK(eSym.getName(stringTable), this));
+}
+
 template <class ELFT> void ObjFile<ELFT>::parseLazy() {
   const ArrayRef<typename ELFT::Sym> eSyms = this->getELFSyms<ELFT>();
-  SymbolTable &symtab = *elf::symtab;
 
   symbols.resize(eSyms.size());
   for (size_t i = firstGlobal, end = eSyms.size(); i != end; ++i)
     if (eSyms[i].st_shndx != SHN_UNDEF)
-      symbols[i] = symtab.insert(CHECK(eSyms[i].getName(stringTable), this));
+      symbols[i] = insertGlobal(i);
 
   // Replace existing symbols with LazyObject symbols.
   //
@@ -275,6 +275,8 @@ public:
   DWARFCache *getDwarf();
 
   void initializeLocalSymbols();
+  void prehashGlobalNames();
+  void releaseGlobalNames() { globalNames = {}; }
   void postParse();
 
 private:
@@ -282,6 +284,7 @@ private:
                           const llvm::object::ELFFile<ELFT> &obj);
   void initializeSymbols(const llvm::object::ELFFile<ELFT> &obj);
   void initializeJustSymbols();
+  Symbol *insertGlobal(size_t i);
 
   InputSectionBase *getRelocTarget(uint32_t idx, const Elf_Shdr &sec,
                                    uint32_t info);
@@ -304,6 +307,11 @@ private:
   // If the section does not exist (which is common), the array is empty.
   ArrayRef<Elf_Word> shndxTable;
 
+  // Names of global symbols computed by prehashGlobalNames, indexed by symbol
+  // index minus firstGlobal. Empty if they have not been computed or have
+  // already been consumed.
+  SmallVector<PrehashedName, 0> globalNames;
+
   // Storage for local symbols.
   std::unique_ptr<SymbolUnion[]> localSymStorage;
 
@@ -382,6 +390,15 @@ inline bool isBitcode(MemoryBufferRef mb) {
 
 std::string replaceThinLTOSuffix(StringRef path);
 
+// Once the contents of an input section have been written to the output,
+// we rarely look at them again. releaseInputPages() tells the kernel that
+// the pages of the mmapped input file backing `data` can be dropped from
+// our resident set. Later accesses are still valid; they just fault the
+// pages back in. collectMmappedBuffers() must be called after the last
+// input file is read.
+void collectMmappedBuffers();
+void releaseInputPages(ArrayRef<uint8_t> data);
+
 extern SmallVector<std::unique_ptr<MemoryBuffer>> memoryBuffers;
 extern SmallVector<BinaryFile *, 0> binaryFiles;
 extern SmallVector<BitcodeFile *, 0> bitcodeFiles;
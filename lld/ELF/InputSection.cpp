@@ -1240,6 +1240,7 @@ template <class ELFT> void InputSection::writeTo(uint8_t *buf) {
     if (Error e = zlib::uncompress(toStringRef(rawData), (char *)buf, size))
       fatal(toString(this) +
             ": uncompress failed: " + llvm::toString(std::move(e)));
+    releaseInputPages(rawData);
     uint8_t *bufEnd = buf + size;
     relocate<ELFT>(buf, bufEnd);
     return;
@@ -1249,6 +1250,7 @@ template <class ELFT> void InputSection::writeTo(uint8_t *buf) {
   // and then apply relocations.
   memcpy(buf, rawData.data(), rawData.size());
   relocate<ELFT>(buf, buf + rawData.size());
+  releaseInputPages(rawData);
 }
 
 void InputSection::replace(InputSection *other) {
@@ -27,6 +27,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include <algorithm>
 #include <cstddef>
 #include <memory>
@@ -157,6 +158,10 @@ static lto::Config createConfig() {
   for (const llvm::StringRef &name : config->thinLTOModulesToCompile)
     c.ThinLTOModulesToCompile.emplace_back(name);
 
+  // Read the summaries and compute imports with as many threads as the rest
+  // of the link (--threads).
+  c.ThinLinkParallelism = parallel::strategy;
+
   c.TimeTraceEnabled = config->timeTraceEnabled;
   c.TimeTraceGranularity = config->timeTraceGranularity;
 
@@ -197,7 +202,8 @@ BitcodeCompiler::BitcodeCompiler() {
         config->thinLTOEmitImportsFiles, indexFile.get(), onIndexWrite);
   } else {
     backend = lto::createInProcessThinBackend(
-        llvm::heavyweight_hardware_concurrency(config->thinLTOJobs));
+        llvm::heavyweight_hardware_concurrency(config->thinLTOJobs),
+        config->thinLTOMemoryBudget);
   }
 
   ltoObj = std::make_unique<lto::LTO>(createConfig(), backend,
@@ -17,6 +17,7 @@
 #include "lld/Common/Memory.h"
 #include "llvm/BinaryFormat/Dwarf.h"
 #include "llvm/Config/llvm-config.h" // LLVM_ENABLE_ZLIB
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TimeProfiler.h"
@@ -320,12 +321,18 @@ static SmallVector<uint8_t, 0> deflateShard(ArrayRef<uint8_t> in, int level,
 
 // Compress section contents if this section contains debug info.
 template <class ELFT> void OutputSection::maybeCompress() {
-#if LLVM_ENABLE_ZLIB
   using Elf_Chdr = typename ELFT::Chdr;
 
   // Compress only DWARF debug sections.
-  if (!config->compressDebugSections || (flags & SHF_ALLOC) ||
-      !name.startswith(".debug_") || size == 0)
+  if (config->compressDebugSections == DebugCompressionKind::None ||
+      (flags & SHF_ALLOC) || !name.startswith(".debug_") || size == 0)
+    return;
+
+  // The driver has already reported an unavailable library. Leave the section
+  // uncompressed rather than describe contents that were never compressed.
+  if (config->compressDebugSections == DebugCompressionKind::Zstd
+          ? !zstd::isAvailable()
+          : !zlib::isAvailable())
     return;
 
   llvm::TimeTraceScope timeScope("Compress debug sections");
@@ -333,44 +340,66 @@ template <class ELFT> void OutputSection::maybeCompress() {
   // Write uncompressed data to a temporary zero-initialized buffer.
   auto buf = std::make_unique<uint8_t[]>(size);
   writeTo<ELFT>(buf.get());
-  // We chose 1 (Z_BEST_SPEED) as the default compression level because it is
-  // the fastest. If -O2 is given, we use level 6 to compress debug info more by
-  // ~15%. We found that level 7 to 9 doesn't make much difference (~1% more
-  // compression) while they take significant amount of time (~2x), so level 6
-  // seems enough.
-  const int level = config->optimize >= 2 ? 6 : Z_BEST_SPEED;
 
   // Split input into 1-MiB shards.
   constexpr size_t shardSize = 1 << 20;
   auto shardsIn = split(makeArrayRef<uint8_t>(buf.get(), size), shardSize);
   const size_t numShards = shardsIn.size();
-
-  // Compress shards and compute Alder-32 checksums. Use Z_SYNC_FLUSH for all
-  // shards but the last to flush the output to a byte boundary to be
-  // concatenated with the next shard.
   auto shardsOut = std::make_unique<SmallVector<uint8_t, 0>[]>(numShards);
-  auto shardsAdler = std::make_unique<uint32_t[]>(numShards);
-  parallelForEachN(0, numShards, [&](size_t i) {
-    shardsOut[i] = deflateShard(shardsIn[i], level,
-                                i != numShards - 1 ? Z_SYNC_FLUSH : Z_FINISH);
-    shardsAdler[i] = adler32(1, shardsIn[i].data(), shardsIn[i].size());
-  });
 
-  // Update section size and combine Alder-32 checksums.
-  uint32_t checksum = 1;       // Initial Adler-32 value
   compressed.uncompressedSize = size;
-  size = sizeof(Elf_Chdr) + 2; // Elf_Chdir and zlib header
-  for (size_t i = 0; i != numShards; ++i) {
-    size += shardsOut[i].size();
-    checksum = adler32_combine(checksum, shardsAdler[i], shardsIn[i].size());
+  size = sizeof(Elf_Chdr);
+
+  if (config->compressDebugSections == DebugCompressionKind::Zstd) {
+    // A zstd stream may consist of multiple frames, so each shard is
+    // compressed into an independent frame and the frames are concatenated.
+    // Level 1 is the fastest; use the default level for -O2 as we do for
+    // zlib below.
+    const int level = config->optimize >= 2 ? zstd::DefaultCompression
+                                            : zstd::BestSpeedCompression;
+    parallelForEachN(0, numShards, [&](size_t i) {
+      SmallVector<char, 0> out;
+      zstd::compress(toStringRef(shardsIn[i]), out, level);
+      shardsOut[i].assign(out.begin(), out.end());
+    });
+    for (size_t i = 0; i != numShards; ++i)
+      size += shardsOut[i].size();
+    compressed.type = ELFCOMPRESS_ZSTD;
+  } else {
+#if LLVM_ENABLE_ZLIB
+    // We chose 1 (Z_BEST_SPEED) as the default compression level because it
+    // is the fastest. If -O2 is given, we use level 6 to compress debug info
+    // more by ~15%. We found that level 7 to 9 doesn't make much difference
+    // (~1% more compression) while they take significant amount of time
+    // (~2x), so level 6 seems enough.
+    const int level = config->optimize >= 2 ? 6 : Z_BEST_SPEED;
+
+    // Compress shards and compute Alder-32 checksums. Use Z_SYNC_FLUSH for
+    // all shards but the last to flush the output to a byte boundary to be
+    // concatenated with the next shard.
+    auto shardsAdler = std::make_unique<uint32_t[]>(numShards);
+    parallelForEachN(0, numShards, [&](size_t i) {
+      shardsOut[i] = deflateShard(shardsIn[i], level,
+                                  i != numShards - 1 ? Z_SYNC_FLUSH : Z_FINISH);
+      shardsAdler[i] = adler32(1, shardsIn[i].data(), shardsIn[i].size());
+    });
+
+    // Update section size and combine Alder-32 checksums.
+    uint32_t checksum = 1; // Initial Adler-32 value
+    size += 2;             // zlib header
+    for (size_t i = 0; i != numShards; ++i) {
+      size += shardsOut[i].size();
+      checksum = adler32_combine(checksum, shardsAdler[i], shardsIn[i].size());
+    }
+    size += 4; // checksum
+    compressed.type = ELFCOMPRESS_ZLIB;
+    compressed.checksum = checksum;
+#endif
   }
-  size += 4; // checksum
 
   compressed.shards = std::move(shardsOut);
   compressed.numShards = numShards;
-  compressed.checksum = checksum;
   flags |= SHF_COMPRESSED;
-#endif
 }
 
 static void writeInt(uint8_t *buf, uint64_t data, uint64_t size) {
@@ -396,25 +425,29 @@ template <class ELFT> void OutputSection::writeTo(uint8_t *buf) {
   // just write it down.
   if (compressed.shards) {
     auto *chdr = reinterpret_cast<typename ELFT::Chdr *>(buf);
-    chdr->ch_type = ELFCOMPRESS_ZLIB;
+    chdr->ch_type = compressed.type;
     chdr->ch_size = compressed.uncompressedSize;
     chdr->ch_addralign = alignment;
     buf += sizeof(*chdr);
 
     // Compute shard offsets.
+    bool isZlib = compressed.type == ELFCOMPRESS_ZLIB;
     auto offsets = std::make_unique<size_t[]>(compressed.numShards);
-    offsets[0] = 2; // zlib header
+    offsets[0] = isZlib ? 2 : 0; // zlib header
     for (size_t i = 1; i != compressed.numShards; ++i)
       offsets[i] = offsets[i - 1] + compressed.shards[i - 1].size();
 
-    buf[0] = 0x78; // CMF
-    buf[1] = 0x01; // FLG: best speed
+    if (isZlib) {
+      buf[0] = 0x78; // CMF
+      buf[1] = 0x01; // FLG: best speed
+    }
     parallelForEachN(0, compressed.numShards, [&](size_t i) {
       memcpy(buf + offsets[i], compressed.shards[i].data(),
              compressed.shards[i].size());
     });
 
-    write32be(buf + (size - sizeof(*chdr) - 4), compressed.checksum);
+    if (isZlib)
+      write32be(buf + (size - sizeof(*chdr) - 4), compressed.checksum);
     return;
   }
 
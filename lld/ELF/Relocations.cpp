@@ -55,6 +55,7 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Demangle/Demangle.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/Parallel.h"
 #include <algorithm>
 
 using namespace llvm;
@@ -296,17 +297,20 @@ static SmallSet<SharedSymbol *, 4> getSymbolsAt(SharedSymbol &ss) {
 // location.
 static void replaceWithDefined(Symbol &sym, SectionBase &sec, uint64_t value,
                                uint64_t size) {
-  Symbol old = sym;
+  uint32_t auxIdx = sym.auxIdx;
+  uint16_t verdefIndex = sym.verdefIndex;
+  bool needsGot = sym.hasFlag(NEEDS_GOT);
 
   sym.replace(Defined{sym.file, StringRef(), sym.binding, sym.stOther,
                       sym.type, value, size, &sec});
 
-  sym.auxIdx = old.auxIdx;
-  sym.verdefIndex = old.verdefIndex;
+  sym.auxIdx = auxIdx;
+  sym.verdefIndex = verdefIndex;
   sym.exportDynamic = true;
   sym.isUsedInRegularObj = true;
   // A copy relocated alias may need a GOT entry.
-  sym.needsGot = old.needsGot;
+  if (needsGot)
+    sym.setFlags(NEEDS_GOT);
 }
 
 // Reserve space in .bss or .bss.rel.ro for copy relocation.
@@ -394,6 +398,8 @@ template <class ELFT> static void addCopyRelSymbol(SharedSymbol &ss) {
 //
 // For sections other than .eh_frame, this class doesn't do anything.
 namespace {
+struct ScanResult;
+
 class OffsetGetter {
 public:
   explicit OffsetGetter(InputSectionBase &sec) {
@@ -431,14 +437,17 @@ private:
 // InputSectionBase.
 class RelocationScanner {
 public:
-  explicit RelocationScanner(InputSectionBase &sec)
-      : sec(sec), getter(sec), config(elf::config.get()), target(*elf::target) {
-  }
+  RelocationScanner(InputSectionBase &sec, ScanResult &result)
+      : sec(sec), getter(sec), result(result), config(elf::config.get()),
+        target(*elf::target) {}
   template <class ELFT, class RelTy> void scan(ArrayRef<RelTy> rels);
 
 private:
   InputSectionBase &sec;
   OffsetGetter getter;
+  // Receives the dynamic relocations and diagnostics that would otherwise
+  // modify state shared with other input sections.
+  ScanResult &result;
   const Configuration *const config;
   const TargetInfo &target;
 
@@ -454,6 +463,11 @@ private:
                                 uint64_t relOff) const;
   void processAux(RelExpr expr, RelType type, uint64_t offset, Symbol &sym,
                   int64_t addend) const;
+  unsigned handleTlsRelocation(RelType type, Symbol &sym, uint64_t offset,
+                               int64_t addend, RelExpr expr) const;
+  void addSymbolReloc(RelocationBaseSection &relSec, RelType dynType,
+                      uint64_t offset, Symbol &sym, int64_t addend,
+                      RelType addendRelType) const;
   template <class ELFT, class RelTy> void scanOne(RelTy *&i);
 };
 } // namespace
@@ -573,6 +587,31 @@ struct UndefinedDiag {
 
 static std::vector<UndefinedDiag> undefs;
 
+namespace {
+// Dynamic relocations and undefined symbol diagnostics created while scanning
+// the relocations of one input section. Input sections may be scanned in
+// parallel, so these are buffered per section and appended to the shared lists
+// by mergeScanResult() in input section order. This keeps the output
+// independent of thread scheduling.
+struct ScanResult {
+  SmallVector<std::pair<RelocationBaseSection *, DynamicReloc>, 0> relocs;
+  SmallVector<std::pair<RelrBaseSection *, RelativeReloc>, 0> relrRelocs;
+  std::vector<UndefinedDiag> undefs;
+};
+} // namespace
+
+static void mergeScanResult(ScanResult &result) {
+  for (const auto &p : result.relocs)
+    p.first->addReloc(p.second);
+  for (const auto &p : result.relrRelocs)
+    p.first->relocs.push_back(p.second);
+  for (UndefinedDiag &undef : result.undefs)
+    undefs.push_back(std::move(undef));
+  result.relocs.clear();
+  result.relrRelocs.clear();
+  result.undefs.clear();
+}
+
 // Check whether the definition name def is a mangled function name that matches
 // the reference name ref.
 static bool canSuggestExternCForCXX(StringRef ref, StringRef def) {
@@ -812,11 +851,11 @@ void elf::reportUndefinedSymbols() {
 // Report an undefined symbol if necessary.
 // Returns true if the undefined symbol will produce an error message.
 static bool maybeReportUndefined(Undefined &sym, InputSectionBase &sec,
-                                 uint64_t offset) {
+                                 uint64_t offset, ScanResult &result) {
   // If versioned, issue an error (even if the symbol is weak) because we don't
   // know the defining filename which is required to construct a Verneed entry.
   if (sym.hasVersionSuffix) {
-    undefs.push_back({&sym, {{&sec, offset}}, false});
+    result.undefs.push_back({&sym, {{&sec, offset}}, false});
     return true;
   }
   if (sym.isWeak())
@@ -841,7 +880,7 @@ static bool maybeReportUndefined(Undefined &sym, InputSectionBase &sec,
   bool isWarning =
       (config->unresolvedSymbols == UnresolvedPolicy::Warn && canBeExternal) ||
       config->noinhibitExec;
-  undefs.push_back({&sym, {{&sec, offset}}, isWarning});
+  result.undefs.push_back({&sym, {{&sec, offset}}, isWarning});
   return !isWarning;
 }
 
@@ -861,9 +900,11 @@ RelType RelocationScanner::getMipsN32RelType(RelTy *&rel) const {
   return type;
 }
 
+// If result is non-null, isec is being scanned by RelocationScanner and the
+// dynamic relocation is recorded in result instead of being added directly.
 static void addRelativeReloc(InputSectionBase &isec, uint64_t offsetInSec,
                              Symbol &sym, int64_t addend, RelExpr expr,
-                             RelType type) {
+                             RelType type, ScanResult *result = nullptr) {
   Partition &part = isec.getPartition();
 
   // Add a relative relocation. If relrDyn section is enabled, and the
@@ -874,11 +915,22 @@ static void addRelativeReloc(InputSectionBase &isec, uint64_t offsetInSec,
   // address.
   if (part.relrDyn && isec.alignment >= 2 && offsetInSec % 2 == 0) {
     isec.relocations.push_back({expr, type, offsetInSec, addend, &sym});
-    part.relrDyn->relocs.push_back({&isec, offsetInSec});
+    if (result)
+      result->relrRelocs.emplace_back(part.relrDyn.get(),
+                                      RelativeReloc{&isec, offsetInSec});
+    else
+      part.relrDyn->relocs.push_back({&isec, offsetInSec});
     return;
   }
-  part.relaDyn->addRelativeReloc(target->relativeRel, isec, offsetInSec, sym,
-                                 addend, type, expr);
+  if (result)
+    result->relocs.emplace_back(
+        part.relaDyn.get(),
+        RelocationBaseSection::prepareReloc(
+            DynamicReloc::AddendOnlyWithTargetVA, target->relativeRel, isec,
+            offsetInSec, sym, addend, expr, type));
+  else
+    part.relaDyn->addRelativeReloc(target->relativeRel, isec, offsetInSec, sym,
+                                   addend, type, expr);
 }
 
 template <class PltSection, class GotPltSection>
@@ -1047,13 +1099,13 @@ void RelocationScanner::processAux(RelExpr expr, RelType type, uint64_t offset,
   if (canWrite) {
     RelType rel = target.getDynRel(type);
     if (expr == R_GOT || (rel == target.symbolicRel && !sym.isPreemptible)) {
-      addRelativeReloc(sec, offset, sym, addend, expr, type);
+      addRelativeReloc(sec, offset, sym, addend, expr, type, &result);
       return;
     } else if (rel != 0) {
       if (config->emachine == EM_MIPS && rel == target.symbolicRel)
         rel = target.relativeRel;
-      sec.getPartition().relaDyn->addSymbolReloc(rel, sec, offset, sym, addend,
-                                                 type);
+      addSymbolReloc(*sec.getPartition().relaDyn, rel, offset, sym, addend,
+                     type);
 
       // MIPS ABI turns using of GOT and dynamic relocations inside out.
       // While regular ABI uses dynamic relocations to fill up GOT entries
@@ -1093,7 +1145,7 @@ void RelocationScanner::processAux(RelExpr expr, RelType type, uint64_t offset,
                 " against symbol '" + toString(*ss) +
                 "'; recompile with -fPIC or remove '-z nocopyreloc'" +
                 getLocation(sec, sym, offset));
-        sym.needsCopy = true;
+        sym.setFlags(NEEDS_COPY);
       }
       sec.relocations.push_back({expr, type, offset, addend, &sym});
       return;
@@ -1131,8 +1183,7 @@ void RelocationScanner::processAux(RelExpr expr, RelType type, uint64_t offset,
         errorOrWarn("symbol '" + toString(sym) +
                     "' cannot be preempted; recompile with -fPIE" +
                     getLocation(sec, sym, offset));
-      sym.needsCopy = true;
-      sym.needsPlt = true;
+      sym.setFlags(NEEDS_COPY | NEEDS_PLT);
       sec.relocations.push_back({expr, type, offset, addend, &sym});
       return;
     }
@@ -1173,21 +1224,21 @@ static unsigned handleMipsTlsRelocation(RelType type, Symbol &sym,
 // symbol in TLS block.
 //
 // Returns the number of relocations processed.
-static unsigned handleTlsRelocation(RelType type, Symbol &sym,
-                                    InputSectionBase &c, uint64_t offset,
-                                    int64_t addend, RelExpr expr) {
+unsigned RelocationScanner::handleTlsRelocation(RelType type, Symbol &sym,
+                                                uint64_t offset, int64_t addend,
+                                                RelExpr expr) const {
   if (!sym.isTls())
     return 0;
 
   if (config->emachine == EM_MIPS)
-    return handleMipsTlsRelocation(type, sym, c, offset, addend, expr);
+    return handleMipsTlsRelocation(type, sym, sec, offset, addend, expr);
 
   if (oneof<R_AARCH64_TLSDESC_PAGE, R_TLSDESC, R_TLSDESC_CALL, R_TLSDESC_PC,
             R_TLSDESC_GOTPLT>(expr) &&
       config->shared) {
     if (expr != R_TLSDESC_CALL) {
-      sym.needsTlsDesc = true;
-      c.relocations.push_back({expr, type, offset, addend, &sym});
+      sym.setFlags(NEEDS_TLSDESC);
+      sec.relocations.push_back({expr, type, offset, addend, &sym});
     }
     return 1;
   }
@@ -1198,7 +1249,7 @@ static unsigned handleTlsRelocation(RelType type, Symbol &sym,
   bool toExecRelax = !config->shared && config->emachine != EM_ARM &&
                      config->emachine != EM_HEXAGON &&
                      config->emachine != EM_RISCV &&
-                     !c.file->ppc64DisableTLSRelax;
+                     !sec.file->ppc64DisableTLSRelax;
 
   // If we are producing an executable and the symbol is non-preemptable, it
   // must be defined and the code sequence can be relaxed to use Local-Exec.
@@ -1217,55 +1268,55 @@ static unsigned handleTlsRelocation(RelType type, Symbol &sym,
           expr)) {
     // Local-Dynamic relocs can be relaxed to Local-Exec.
     if (toExecRelax) {
-      c.relocations.push_back(
-          {target->adjustTlsExpr(type, R_RELAX_TLS_LD_TO_LE), type, offset,
+      sec.relocations.push_back(
+          {target.adjustTlsExpr(type, R_RELAX_TLS_LD_TO_LE), type, offset,
            addend, &sym});
-      return target->getTlsGdRelaxSkip(type);
+      return target.getTlsGdRelaxSkip(type);
     }
     if (expr == R_TLSLD_HINT)
       return 1;
-    config->needsTlsLd = true;
-    c.relocations.push_back({expr, type, offset, addend, &sym});
+    elf::config->needsTlsLd = true;
+    sec.relocations.push_back({expr, type, offset, addend, &sym});
     return 1;
   }
 
   // Local-Dynamic relocs can be relaxed to Local-Exec.
   if (expr == R_DTPREL) {
     if (toExecRelax)
-      expr = target->adjustTlsExpr(type, R_RELAX_TLS_LD_TO_LE);
-    c.relocations.push_back({expr, type, offset, addend, &sym});
+      expr = target.adjustTlsExpr(type, R_RELAX_TLS_LD_TO_LE);
+    sec.relocations.push_back({expr, type, offset, addend, &sym});
     return 1;
   }
 
   // Local-Dynamic sequence where offset of tls variable relative to dynamic
   // thread pointer is stored in the got. This cannot be relaxed to Local-Exec.
   if (expr == R_TLSLD_GOT_OFF) {
-    sym.needsGotDtprel = true;
-    c.relocations.push_back({expr, type, offset, addend, &sym});
+    sym.setFlags(NEEDS_GOT_DTPREL);
+    sec.relocations.push_back({expr, type, offset, addend, &sym});
     return 1;
   }
 
   if (oneof<R_AARCH64_TLSDESC_PAGE, R_TLSDESC, R_TLSDESC_CALL, R_TLSDESC_PC,
             R_TLSDESC_GOTPLT, R_TLSGD_GOT, R_TLSGD_GOTPLT, R_TLSGD_PC>(expr)) {
     if (!toExecRelax) {
-      sym.needsTlsGd = true;
-      c.relocations.push_back({expr, type, offset, addend, &sym});
+      sym.setFlags(NEEDS_TLSGD);
+      sec.relocations.push_back({expr, type, offset, addend, &sym});
       return 1;
     }
 
     // Global-Dynamic relocs can be relaxed to Initial-Exec or Local-Exec
     // depending on the symbol being locally defined or not.
     if (sym.isPreemptible) {
-      sym.needsTlsGdToIe = true;
-      c.relocations.push_back(
-          {target->adjustTlsExpr(type, R_RELAX_TLS_GD_TO_IE), type, offset,
+      sym.setFlags(NEEDS_TLSGD_TO_IE);
+      sec.relocations.push_back(
+          {target.adjustTlsExpr(type, R_RELAX_TLS_GD_TO_IE), type, offset,
            addend, &sym});
     } else {
-      c.relocations.push_back(
-          {target->adjustTlsExpr(type, R_RELAX_TLS_GD_TO_LE), type, offset,
+      sec.relocations.push_back(
+          {target.adjustTlsExpr(type, R_RELAX_TLS_GD_TO_LE), type, offset,
            addend, &sym});
     }
-    return target->getTlsGdRelaxSkip(type);
+    return target.getTlsGdRelaxSkip(type);
   }
 
   if (oneof<R_GOT, R_GOTPLT, R_GOT_PC, R_AARCH64_GOT_PAGE_PC, R_GOT_OFF,
@@ -1273,15 +1324,15 @@ static unsigned handleTlsRelocation(RelType type, Symbol &sym,
     // Initial-Exec relocs can be relaxed to Local-Exec if the symbol is locally
     // defined.
     if (toExecRelax && isLocalInExecutable) {
-      c.relocations.push_back(
+      sec.relocations.push_back(
           {R_RELAX_TLS_IE_TO_LE, type, offset, addend, &sym});
     } else if (expr != R_TLSIE_HINT) {
-      sym.needsTlsIe = true;
+      sym.setFlags(NEEDS_TLSIE);
       // R_GOT needs a relative relocation for PIC on i386 and Hexagon.
-      if (expr == R_GOT && config->isPic && !target->usesOnlyLowPageBits(type))
-        addRelativeReloc(c, offset, sym, addend, expr, type);
+      if (expr == R_GOT && config->isPic && !target.usesOnlyLowPageBits(type))
+        addRelativeReloc(sec, offset, sym, addend, expr, type, &result);
       else
-        c.relocations.push_back({expr, type, offset, addend, &sym});
+        sec.relocations.push_back({expr, type, offset, addend, &sym});
     }
     return 1;
   }
@@ -1311,7 +1362,7 @@ template <class ELFT, class RelTy> void RelocationScanner::scanOne(RelTy *&i) {
   // Error if the target symbol is undefined. Symbol index 0 may be used by
   // marker relocations, e.g. R_*_NONE and R_ARM_V4BX. Don't error on them.
   if (sym.isUndefined() && symIndex != 0 &&
-      maybeReportUndefined(cast<Undefined>(sym), sec, offset))
+      maybeReportUndefined(cast<Undefined>(sym), sec, offset, result))
     return;
 
   const uint8_t *relocatedAddr = sec.rawData.begin() + offset;
@@ -1380,7 +1431,7 @@ template <class ELFT, class RelTy> void RelocationScanner::scanOne(RelTy *&i) {
       return;
     }
   } else if (unsigned processed =
-                 handleTlsRelocation(type, sym, sec, offset, addend, expr)) {
+                 handleTlsRelocation(type, sym, offset, addend, expr)) {
     i += (processed - 1);
     return;
   }
@@ -1415,7 +1466,7 @@ template <class ELFT, class RelTy> void RelocationScanner::scanOne(RelTy *&i) {
   // direct relocation on through.
   if (sym.isGnuIFunc() && config->zIfuncNoplt) {
     sym.exportDynamic = true;
-    mainPart->relaDyn->addSymbolReloc(type, sec, offset, sym, addend, type);
+    addSymbolReloc(*mainPart->relaDyn, type, offset, sym, addend, type);
     return;
   }
 
@@ -1430,17 +1481,27 @@ template <class ELFT, class RelTy> void RelocationScanner::scanOne(RelTy *&i) {
       // ftp://www.linux-mips.org/pub/linux/mips/doc/ABI/mipsabi.pdf
       in.mipsGot->addEntry(*sec.file, sym, addend, expr);
     } else {
-      sym.needsGot = true;
+      sym.setFlags(NEEDS_GOT);
     }
   } else if (needsPlt(expr)) {
-    sym.needsPlt = true;
+    sym.setFlags(NEEDS_PLT);
   } else {
-    sym.hasDirectReloc = true;
+    sym.setFlags(HAS_DIRECT_RELOC);
   }
 
   processAux(expr, type, offset, sym, addend);
 }
 
+void RelocationScanner::addSymbolReloc(RelocationBaseSection &relSec,
+                                       RelType dynType, uint64_t offset,
+                                       Symbol &sym, int64_t addend,
+                                       RelType addendRelType) const {
+  result.relocs.emplace_back(
+      &relSec, RelocationBaseSection::prepareReloc(
+                   DynamicReloc::AgainstSymbol, dynType, sec, offset, sym,
+                   addend, R_ADDEND, addendRelType));
+}
+
 // R_PPC64_TLSGD/R_PPC64_TLSLD is required to mark `bl __tls_get_addr` for
 // General Dynamic/Local Dynamic code sequences. If a GD/LD GOT relocation is
 // found but no R_PPC64_TLSGD/R_PPC64_TLSLD is seen, we assume that the
@@ -1507,8 +1568,9 @@ void RelocationScanner::scan(ArrayRef<RelTy> rels) {
                       });
 }
 
-template <class ELFT> void elf::scanRelocations(InputSectionBase &s) {
-  RelocationScanner scanner(s);
+template <class ELFT>
+static void scanSection(InputSectionBase &s, ScanResult &result) {
+  RelocationScanner scanner(s, result);
   const RelsOrRelas<ELFT> rels = s.template relsOrRelas<ELFT>();
   if (rels.areRelocsRel())
     scanner.template scan<ELFT>(rels.rels);
@@ -1516,6 +1578,48 @@ template <class ELFT> void elf::scanRelocations(InputSectionBase &s) {
     scanner.template scan<ELFT>(rels.relas);
 }
 
+template <class ELFT> void elf::scanRelocations() {
+  // Scan all relocations. Each relocation goes through a series of tests to
+  // determine if it needs special treatment, such as creating GOT, PLT,
+  // copy relocations, etc. Note that relocations for non-alloc sections are
+  // directly processed by InputSection::relocateNonAlloc.
+  SmallVector<InputSectionBase *, 0> sections;
+  for (InputSectionBase *sec : inputSections)
+    if (sec->isLive() && isa<InputSection>(sec) && (sec->flags & SHF_ALLOC))
+      sections.push_back(sec);
+  for (Partition &part : partitions) {
+    for (EhInputSection *sec : part.ehFrame->sections)
+      sections.push_back(sec);
+    if (part.armExidx && part.armExidx->isLive())
+      for (InputSection *sec : part.armExidx->exidxSections)
+        sections.push_back(sec);
+  }
+
+  // Input sections can be scanned independently: symbol flags are set
+  // atomically, and everything else that is shared between sections is
+  // buffered in a ScanResult and merged in input order. MIPS GOT entries,
+  // PPC64 TOC bookkeeping and -z ifunc-noplt modify shared state directly, so
+  // those configurations are scanned serially.
+  bool serial = parallel::strategy.ThreadsRequested == 1 ||
+                config->emachine == EM_MIPS || config->emachine == EM_PPC64 ||
+                config->zIfuncNoplt;
+  if (serial) {
+    ScanResult result;
+    for (InputSectionBase *sec : sections) {
+      scanSection<ELFT>(*sec, result);
+      mergeScanResult(result);
+    }
+    return;
+  }
+
+  std::vector<ScanResult> results(sections.size());
+  parallelForEachN(0, sections.size(), [&](size_t i) {
+    scanSection<ELFT>(*sections[i], results[i]);
+  });
+  for (ScanResult &result : results)
+    mergeScanResult(result);
+}
+
 static bool handleNonPreemptibleIfunc(Symbol &sym) {
   // Handle a reference to a non-preemptible ifunc. These are special in a
   // few ways:
@@ -1560,7 +1664,8 @@ static bool handleNonPreemptibleIfunc(Symbol &sym) {
   if (!sym.isGnuIFunc() || sym.isPreemptible || config->zIfuncNoplt)
     return false;
   // Skip unreferenced non-preemptible ifunc.
-  if (!(sym.needsGot || sym.needsPlt || sym.hasDirectReloc))
+  if (!sym.hasFlag(NEEDS_GOT) && !sym.hasFlag(NEEDS_PLT) &&
+      !sym.hasFlag(HAS_DIRECT_RELOC))
     return true;
 
   sym.isInIplt = true;
@@ -1569,16 +1674,18 @@ static bool handleNonPreemptibleIfunc(Symbol &sym) {
   // original section/value pairs. For non-GOT non-PLT relocation case below, we
   // may alter section/value, so create a copy of the symbol to make
   // section/value fixed.
-  auto *directSym = makeDefined(cast<Defined>(sym));
+  auto &d = cast<Defined>(sym);
+  auto *directSym =
+      makeDefined(d.file, d.getName(), uint8_t(d.binding), d.stOther,
+                  uint8_t(d.type), d.value, d.size, d.section);
   directSym->allocateAux();
   addPltEntry(*in.iplt, *in.igotPlt, *in.relaIplt, target->iRelativeRel,
               *directSym);
   sym.allocateAux();
   symAux.back().pltIdx = symAux[directSym->auxIdx].pltIdx;
 
-  if (sym.hasDirectReloc) {
+  if (sym.hasFlag(HAS_DIRECT_RELOC)) {
     // Change the value to the IPLT and redirect all references to it.
-    auto &d = cast<Defined>(sym);
     d.section = in.iplt.get();
     d.value = d.getPltIdx() * target->ipltEntrySize;
     d.size = 0;
@@ -1586,9 +1693,9 @@ static bool handleNonPreemptibleIfunc(Symbol &sym) {
     // don't try to call the PLT as if it were an ifunc resolver.
     d.type = STT_FUNC;
 
-    if (sym.needsGot)
+    if (sym.hasFlag(NEEDS_GOT))
       addGotEntry(sym);
-  } else if (sym.needsGot) {
+  } else if (sym.hasFlag(NEEDS_GOT)) {
     // Redirect GOT accesses to point to the Igot.
     sym.gotInIgot = true;
   }
@@ -1603,24 +1710,24 @@ void elf::postScanRelocations() {
       return;
     sym.allocateAux();
 
-    if (sym.needsGot)
+    if (sym.hasFlag(NEEDS_GOT))
       addGotEntry(sym);
-    if (sym.needsPlt)
+    if (sym.hasFlag(NEEDS_PLT))
       addPltEntry(*in.plt, *in.gotPlt, *in.relaPlt, target->pltRel, sym);
-    if (sym.needsCopy) {
+    if (sym.hasFlag(NEEDS_COPY)) {
       if (sym.isObject()) {
         invokeELFT(addCopyRelSymbol, cast<SharedSymbol>(sym));
-        // needsCopy is cleared for sym and its aliases so that in later
+        // NEEDS_COPY is cleared for sym and its aliases so that in later
         // iterations aliases won't cause redundant copies.
-        assert(!sym.needsCopy);
+        assert(!sym.hasFlag(NEEDS_COPY));
       } else {
-        assert(sym.isFunc() && sym.needsPlt);
+        assert(sym.isFunc() && sym.hasFlag(NEEDS_PLT));
         if (!sym.isDefined()) {
           replaceWithDefined(sym, *in.plt,
                              target->pltHeaderSize +
                                  target->pltEntrySize * sym.getPltIdx(),
                              0);
-          sym.needsCopy = true;
+          sym.setFlags(NEEDS_COPY);
           if (config->emachine == EM_PPC) {
             // PPC32 canonical PLT entries are at the beginning of .glink
             cast<Defined>(sym).value = in.plt->headerSize;
@@ -1635,13 +1742,13 @@ void elf::postScanRelocations() {
       return;
     bool isLocalInExecutable = !sym.isPreemptible && !config->shared;
 
-    if (sym.needsTlsDesc) {
+    if (sym.hasFlag(NEEDS_TLSDESC)) {
       in.got->addTlsDescEntry(sym);
       mainPart->relaDyn->addAddendOnlyRelocIfNonPreemptible(
           target->tlsDescRel, *in.got, in.got->getTlsDescOffset(sym), sym,
           target->tlsDescRel);
     }
-    if (sym.needsTlsGd) {
+    if (sym.hasFlag(NEEDS_TLSGD)) {
       in.got->addDynTlsEntry(sym);
       uint64_t off = in.got->getGlobalDynOffset(sym);
       if (isLocalInExecutable)
@@ -1662,18 +1769,18 @@ void elf::postScanRelocations() {
         in.got->relocations.push_back(
             {R_ABS, target->tlsOffsetRel, offsetOff, 0, &sym});
     }
-    if (sym.needsTlsGdToIe) {
+    if (sym.hasFlag(NEEDS_TLSGD_TO_IE)) {
       in.got->addEntry(sym);
       mainPart->relaDyn->addSymbolReloc(target->tlsGotRel, *in.got,
                                         sym.getGotOffset(), sym);
     }
-    if (sym.needsGotDtprel) {
+    if (sym.hasFlag(NEEDS_GOT_DTPREL)) {
       in.got->addEntry(sym);
       in.got->relocations.push_back(
           {R_ABS, target->tlsOffsetRel, sym.getGotOffset(), 0, &sym});
     }
 
-    if (sym.needsTlsIe && !sym.needsTlsGdToIe)
+    if (sym.hasFlag(NEEDS_TLSIE) && !sym.hasFlag(NEEDS_TLSGD_TO_IE))
       addTpOffsetGotEntry(sym);
   };
 
@@ -2221,7 +2328,7 @@ void elf::hexagonTLSSymbolUpdate(ArrayRef<OutputSection *> outputSections) {
       });
 }
 
-template void elf::scanRelocations<ELF32LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF32BE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64BE>(InputSectionBase &);
+template void elf::scanRelocations<ELF32LE>();
+template void elf::scanRelocations<ELF32BE>();
+template void elf::scanRelocations<ELF64LE>();
+template void elf::scanRelocations<ELF64BE>();
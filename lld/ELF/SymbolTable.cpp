@@ -61,8 +61,9 @@ void SymbolTable::wrap(Symbol *sym, Symbol *real, Symbol *wrap) {
   real->isUsedInRegularObj = false;
 }
 
-// Find an existing symbol or create a new one.
-Symbol *SymbolTable::insert(StringRef name) {
+// Splits off the "@@" version suffix of a symbol name and hashes the stem.
+// This does not touch the symbol table, so it is safe to call concurrently.
+PrehashedName SymbolTable::prehash(StringRef name) {
   // <name>@@<version> means the symbol is the default version. In that
   // case <name>@@<version> will be used to resolve references to <name>.
   //
@@ -74,7 +75,23 @@ Symbol *SymbolTable::insert(StringRef name) {
   if (pos != StringRef::npos && pos + 1 < name.size() && name[pos + 1] == '@')
     stem = name.take_front(pos);
 
-  auto p = symMap.insert({CachedHashStringRef(stem), (int)symVector.size()});
+  PrehashedName ret;
+  ret.data = name.data();
+  ret.size = name.size();
+  ret.stemSize = stem.size();
+  ret.hash = CachedHashStringRef(stem).hash();
+  ret.hasVersionSuffix = pos != StringRef::npos;
+  return ret;
+}
+
+// Find an existing symbol or create a new one.
+Symbol *SymbolTable::insert(StringRef name) { return insert(prehash(name)); }
+
+Symbol *SymbolTable::insert(const PrehashedName &pn) {
+  StringRef name = pn.name();
+  StringRef stem = pn.stem();
+  auto p = symMap.insert(
+      {CachedHashStringRef(stem, pn.hash), (int)symVector.size()});
   if (!p.second) {
     Symbol *sym = symVector[p.first->second];
     if (stem.size() != name.size()) {
@@ -100,7 +117,7 @@ Symbol *SymbolTable::insert(StringRef name) {
   sym->traced = false;
   sym->scriptDefined = false;
   sym->versionId = VER_NDX_GLOBAL;
-  if (pos != StringRef::npos)
+  if (pn.hasVersionSuffix)
     sym->hasVersionSuffix = true;
   return sym;
 }
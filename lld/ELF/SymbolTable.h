@@ -38,6 +38,9 @@ public:
   void wrap(Symbol *sym, Symbol *real, Symbol *wrap);
 
   Symbol *insert(StringRef name);
+  Symbol *insert(const PrehashedName &name);
+
+  static PrehashedName prehash(StringRef name);
 
   Symbol *addSymbol(const Symbol &newSym);
   Symbol *addAndCheckDuplicate(const Defined &newSym);
@@ -18,6 +18,7 @@
 #include "lld/Common/Memory.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Object/ELF.h"
+#include <atomic>
 #include <tuple>
 
 namespace lld {
@@ -50,6 +51,37 @@ struct SymbolAux {
 
 extern SmallVector<SymbolAux, 0> symAux;
 
+// A global symbol name whose "@@" version stem has already been located and
+// hashed. These are computed in parallel for all input files before symbol
+// resolution, so that SymbolTable::insert, which must run serially, only has
+// to probe its map. A null data pointer means the name could not be read and
+// must be looked up the slow way to get a proper diagnostic.
+struct PrehashedName {
+  const char *data = nullptr;
+  uint32_t size = 0;
+  uint32_t stemSize = 0;
+  uint32_t hash = 0;
+  bool hasVersionSuffix = false;
+
+  StringRef name() const { return StringRef(data, size); }
+  StringRef stem() const { return StringRef(data, stemSize); }
+};
+
+// Values for Symbol::flags.
+enum : uint16_t {
+  NEEDS_GOT = 1 << 0,
+  NEEDS_PLT = 1 << 1,
+  HAS_DIRECT_RELOC = 1 << 2,
+  // True if this symbol needs a canonical PLT entry, or (during
+  // postScanRelocations) a copy relocation.
+  NEEDS_COPY = 1 << 3,
+  NEEDS_TLSDESC = 1 << 4,
+  NEEDS_TLSGD = 1 << 5,
+  NEEDS_TLSGD_TO_IE = 1 << 6,
+  NEEDS_GOT_DTPREL = 1 << 7,
+  NEEDS_TLSIE = 1 << 8,
+};
+
 // The base class for real symbol classes.
 class Symbol {
 public:
@@ -238,8 +270,6 @@ private:
 
   bool shouldReplace(const Defined &other) const;
 
-  inline size_t getSymbolSize() const;
-
 protected:
   Symbol(Kind k, InputFile *file, StringRef name, uint8_t binding,
          uint8_t stOther, uint8_t type)
@@ -250,10 +280,26 @@ protected:
         inDynamicList(false), referenced(false), referencedAfterWrap(false),
         traced(false), hasVersionSuffix(false), isInIplt(false),
         gotInIgot(false), folded(false), needsTocRestore(false),
-        scriptDefined(false), needsCopy(false), needsGot(false),
-        needsPlt(false), needsTlsDesc(false), needsTlsGd(false),
-        needsTlsGdToIe(false), needsGotDtprel(false), needsTlsIe(false),
-        hasDirectReloc(false) {}
+        scriptDefined(false), flags(0) {}
+
+  // std::atomic is not copyable, so the fields are copied one by one. This is
+  // used by replace() through the copy constructors of the derived classes.
+  Symbol(const Symbol &other)
+      : file(other.file), nameData(other.nameData), nameSize(other.nameSize),
+        type(other.type), binding(other.binding), stOther(other.stOther),
+        symbolKind(other.symbolKind), partition(other.partition),
+        visibility(other.visibility), isPreemptible(other.isPreemptible),
+        isUsedInRegularObj(other.isUsedInRegularObj), used(other.used),
+        exportDynamic(other.exportDynamic),
+        inDynamicList(other.inDynamicList), referenced(other.referenced),
+        referencedAfterWrap(other.referencedAfterWrap), traced(other.traced),
+        hasVersionSuffix(other.hasVersionSuffix), isInIplt(other.isInIplt),
+        gotInIgot(other.gotInIgot), folded(other.folded),
+        needsTocRestore(other.needsTocRestore),
+        scriptDefined(other.scriptDefined),
+        flags(other.flags.load(std::memory_order_relaxed)),
+        auxIdx(other.auxIdx), dynsymIndex(other.dynsymIndex),
+        verdefIndex(other.verdefIndex), versionId(other.versionId) {}
 
 public:
   // True if this symbol is in the Iplt sub-section of the Plt and the Igot
@@ -277,20 +323,11 @@ public:
   // of the symbol.
   uint8_t scriptDefined : 1;
 
-  // True if this symbol needs a canonical PLT entry, or (during
-  // postScanRelocations) a copy relocation.
-  uint8_t needsCopy : 1;
-
   // Temporary flags used to communicate which symbol entries need PLT and GOT
-  // entries during postScanRelocations();
-  uint8_t needsGot : 1;
-  uint8_t needsPlt : 1;
-  uint8_t needsTlsDesc : 1;
-  uint8_t needsTlsGd : 1;
-  uint8_t needsTlsGdToIe : 1;
-  uint8_t needsGotDtprel : 1;
-  uint8_t needsTlsIe : 1;
-  uint8_t hasDirectReloc : 1;
+  // entries during postScanRelocations(). They are set by scanRelocations(),
+  // which may run on multiple threads, so they are kept out of the bit-fields
+  // above and updated atomically.
+  std::atomic<uint16_t> flags;
 
   // A symAux index used to access GOT/PLT entry indexes. This is allocated in
   // postScanRelocations().
@@ -303,9 +340,18 @@ public:
   // Version definition index.
   uint16_t versionId;
 
+  void setFlags(uint16_t bits) {
+    flags.fetch_or(bits, std::memory_order_relaxed);
+  }
+  bool hasFlag(uint16_t bit) const {
+    assert(bit && (bit & (bit - 1)) == 0 && "bit must be a power of 2");
+    return flags.load(std::memory_order_relaxed) & bit;
+  }
+
   bool needsDynReloc() const {
-    return needsCopy || needsGot || needsPlt || needsTlsDesc || needsTlsGd ||
-           needsTlsGdToIe || needsGotDtprel || needsTlsIe;
+    return flags.load(std::memory_order_relaxed) &
+           (NEEDS_COPY | NEEDS_GOT | NEEDS_PLT | NEEDS_TLSDESC | NEEDS_TLSGD |
+            NEEDS_TLSGD_TO_IE | NEEDS_GOT_DTPREL | NEEDS_TLSIE);
   }
   void allocateAux() {
     assert(auxIdx == uint32_t(-1));
@@ -497,30 +543,31 @@ union SymbolUnion {
 
 void printTraceSymbol(const Symbol &sym, StringRef name);
 
-size_t Symbol::getSymbolSize() const {
-  switch (kind()) {
+// replace() replaces "this" object with a copy of a given symbol. This
+// function is called as a result of name resolution, e.g. to replace an
+// undefind symbol with a defined symbol.
+void Symbol::replace(const Symbol &other) {
+  Symbol old = *this;
+  switch (other.kind()) {
   case CommonKind:
-    return sizeof(CommonSymbol);
+    new (this) CommonSymbol(static_cast<const CommonSymbol &>(other));
+    break;
   case DefinedKind:
-    return sizeof(Defined);
+    new (this) Defined(static_cast<const Defined &>(other));
+    break;
   case LazyObjectKind:
-    return sizeof(LazyObject);
+    new (this) LazyObject(static_cast<const LazyObject &>(other));
+    break;
   case SharedKind:
-    return sizeof(SharedSymbol);
+    new (this) SharedSymbol(static_cast<const SharedSymbol &>(other));
+    break;
   case UndefinedKind:
-    return sizeof(Undefined);
+    new (this) Undefined(static_cast<const Undefined &>(other));
+    break;
   case PlaceholderKind:
-    return sizeof(Symbol);
+    new (this) Symbol(other);
+    break;
   }
-  llvm_unreachable("unknown symbol kind");
-}
-
-// replace() replaces "this" object with a given symbol by memcpy'ing
-// it over to "this". This function is called as a result of name
-// resolution, e.g. to replace an undefind symbol with a defined symbol.
-void Symbol::replace(const Symbol &other) {
-  Symbol old = *this;
-  memcpy(this, &other, other.getSymbolSize());
 
   // old may be a placeholder. The referenced fields must be initialized in
   // SymbolTable::insert.
@@ -52,6 +52,7 @@ using llvm::support::endian::read32le;
 using llvm::support::endian::write32le;
 using llvm::support::endian::write64le;
 
+constexpr size_t MergeTailSection::numShards;
 constexpr size_t MergeNoTailSection::numShards;
 
 static uint64_t readUint(uint8_t *buf) {
@@ -1641,17 +1642,16 @@ void RelocationBaseSection::addAddendOnlyRelocIfNonPreemptible(
              sym, 0, R_ABS, addendRelType);
 }
 
-void RelocationBaseSection::addReloc(DynamicReloc::Kind kind, RelType dynType,
-                                     InputSectionBase &inputSec,
-                                     uint64_t offsetInSec, Symbol &sym,
-                                     int64_t addend, RelExpr expr,
-                                     RelType addendRelType) {
+DynamicReloc RelocationBaseSection::prepareReloc(
+    DynamicReloc::Kind kind, RelType dynType, InputSectionBase &inputSec,
+    uint64_t offsetInSec, Symbol &sym, int64_t addend, RelExpr expr,
+    RelType addendRelType) {
   // Write the addends to the relocated address if required. We skip
   // it if the written value would be zero.
   if (config->writeAddends && (expr != R_ADDEND || addend != 0))
     inputSec.relocations.push_back(
         {expr, addendRelType, offsetInSec, addend, &sym});
-  addReloc({dynType, &inputSec, offsetInSec, kind, sym, addend, expr});
+  return {dynType, &inputSec, offsetInSec, kind, sym, addend, expr};
 }
 
 void RelocationBaseSection::partitionRels() {
@@ -2205,8 +2205,8 @@ static BssSection *getCommonSec(Symbol *sym) {
 }
 
 static uint32_t getSymSectionIndex(Symbol *sym) {
-  assert(!(sym->needsCopy && sym->isObject()));
-  if (!isa<Defined>(sym) || sym->needsCopy)
+  assert(!(sym->hasFlag(NEEDS_COPY) && sym->isObject()));
+  if (!isa<Defined>(sym) || sym->hasFlag(NEEDS_COPY))
     return SHN_UNDEF;
   if (const OutputSection *os = sym->getOutputSection())
     return os->sectionIndex >= SHN_LORESERVE ? (uint32_t)SHN_XINDEX
@@ -2275,7 +2275,7 @@ template <class ELFT> void SymbolTableSection<ELFT>::writeTo(uint8_t *buf) {
 
     for (SymbolTableEntry &ent : symbols) {
       Symbol *sym = ent.sym;
-      if (sym->isInPlt() && sym->needsCopy)
+      if (sym->isInPlt() && sym->hasFlag(NEEDS_COPY))
         eSym->st_other |= STO_MIPS_PLT;
       if (isMicroMips()) {
         // We already set the less-significant bit for symbols
@@ -2285,8 +2285,8 @@ template <class ELFT> void SymbolTableSection<ELFT>::writeTo(uint8_t *buf) {
         // clear that bit for non-dynamic symbol table, so tools
         // like `objdump` will be able to deal with a correct
         // symbol position.
-        if (sym->isDefined() &&
-            ((sym->stOther & STO_MIPS_MICROMIPS) || sym->needsCopy)) {
+        if (sym->isDefined() && ((sym->stOther & STO_MIPS_MICROMIPS) ||
+                                 sym->hasFlag(NEEDS_COPY))) {
           if (!strTabSec.isDynamic())
             eSym->st_value &= ~1;
           eSym->st_other |= STO_MIPS_MICROMIPS;
@@ -3259,31 +3259,69 @@ void MergeSyntheticSection::addSection(MergeInputSection *ms) {
 
 MergeTailSection::MergeTailSection(StringRef name, uint32_t type,
                                    uint64_t flags, uint32_t alignment)
-    : MergeSyntheticSection(name, type, flags, alignment),
-      builder(StringTableBuilder::RAW, alignment) {}
-
-size_t MergeTailSection::getSize() const { return builder.getSize(); }
+    : MergeSyntheticSection(name, type, flags, alignment) {}
 
-void MergeTailSection::writeTo(uint8_t *buf) { builder.write(buf); }
+void MergeTailSection::writeTo(uint8_t *buf) {
+  parallelForEachN(0, numShards,
+                   [&](size_t i) { shards[i].write(buf + shardOffsets[i]); });
+}
 
+// Tail merging sorts strings by their reversed contents, which is too slow
+// to do serially for large sections such as .debug_str. Since a string can
+// only be merged with strings in the same shard (see getShardId), we build
+// and optimize each shard independently, and then lay out the shards one
+// after another. The result does not depend on the number of threads.
 void MergeTailSection::finalizeContents() {
-  // Add all string pieces to the string table builder to create section
-  // contents.
-  for (MergeInputSection *sec : sections)
-    for (size_t i = 0, e = sec->pieces.size(); i != e; ++i)
-      if (sec->pieces[i].live)
-        builder.add(sec->getData(i));
+  for (size_t i = 0; i < numShards; ++i)
+    shards.emplace_back(StringTableBuilder::RAW, alignment);
 
-  // Fix the string table content. After this, the contents will never change.
-  builder.finalize();
+  // Add section pieces to the builders. As in MergeNoTailSection, each
+  // thread owns the shards whose IDs are congruent to its thread ID.
+  size_t concurrency = PowerOf2Floor(
+      std::min<size_t>(hardware_concurrency(parallel::strategy.ThreadsRequested)
+                           .compute_thread_count(),
+                       numShards));
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    for (MergeInputSection *sec : sections) {
+      for (size_t i = 0, e = sec->pieces.size(); i != e; ++i) {
+        if (!sec->pieces[i].live)
+          continue;
+        CachedHashStringRef data = sec->getData(i);
+        size_t shardId = getShardId(data.val());
+        if ((shardId & (concurrency - 1)) != threadId)
+          continue;
+        shards[shardId].add(data);
+        // Remember the shard ID until offsets are fixed below.
+        sec->pieces[i].outputOff = shardId;
+      }
+    }
+  });
 
-  // finalize() fixed tail-optimized strings, so we can now get
-  // offsets of strings. Get an offset for each string and save it
-  // to a corresponding SectionPiece for easy access.
-  for (MergeInputSection *sec : sections)
-    for (size_t i = 0, e = sec->pieces.size(); i != e; ++i)
-      if (sec->pieces[i].live)
-        sec->pieces[i].outputOff = builder.getOffset(sec->getData(i));
+  // Fix the string table contents of each shard. After this, the contents
+  // will never change.
+  parallelForEach(shards, [](StringTableBuilder &sb) { sb.finalize(); });
+
+  // Compute an in-section offset for each shard.
+  size_t off = 0;
+  for (size_t i = 0; i < numShards; ++i) {
+    if (shards[i].getSize() > 0)
+      off = alignTo(off, alignment);
+    shardOffsets[i] = off;
+    off += shards[i].getSize();
+  }
+  size = off;
+
+  // finalize() fixed tail-optimized strings, so we can now get offsets of
+  // strings. Get an offset for each string and save it to a corresponding
+  // SectionPiece for easy access.
+  parallelForEach(sections, [&](MergeInputSection *sec) {
+    for (size_t i = 0, e = sec->pieces.size(); i != e; ++i) {
+      SectionPiece &piece = sec->pieces[i];
+      if (piece.live)
+        piece.outputOff = shardOffsets[piece.outputOff] +
+                          shards[piece.outputOff].getOffset(sec->getData(i));
+    }
+  });
 }
 
 void MergeNoTailSection::writeTo(uint8_t *buf) {
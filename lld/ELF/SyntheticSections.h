@@ -139,7 +139,7 @@ public:
 
   // Flag to force GOT to be in output if we have relocations
   // that relies on its address.
-  bool hasGotOffRel = false;
+  std::atomic<bool> hasGotOffRel{false};
 
 protected:
   size_t numEntries = 0;
@@ -381,7 +381,7 @@ public:
 
   // Flag to force GotPlt to be in output if we have relocations
   // that relies on its address.
-  bool hasGotPltOffRel = false;
+  std::atomic<bool> hasGotPltOffRel{false};
 
 private:
   SmallVector<const Symbol *, 0> entries;
@@ -532,7 +532,19 @@ public:
                                           RelType addendRelType);
   void addReloc(DynamicReloc::Kind kind, RelType dynType,
                 InputSectionBase &inputSec, uint64_t offsetInSec, Symbol &sym,
-                int64_t addend, RelExpr expr, RelType addendRelType);
+                int64_t addend, RelExpr expr, RelType addendRelType) {
+    addReloc(prepareReloc(kind, dynType, inputSec, offsetInSec, sym, addend,
+                          expr, addendRelType));
+  }
+  /// Write the addend to \p inputSec if required and return the dynamic
+  /// relocation without adding it to any section. This is used by the
+  /// parallel relocation scanner, which only touches \p inputSec and adds the
+  /// relocation later in input order.
+  static DynamicReloc prepareReloc(DynamicReloc::Kind kind, RelType dynType,
+                                   InputSectionBase &inputSec,
+                                   uint64_t offsetInSec, Symbol &sym,
+                                   int64_t addend, RelExpr expr,
+                                   RelType addendRelType);
   bool isNeeded() const override { return !relocs.empty(); }
   size_t getSize() const override { return relocs.size() * this->entsize; }
   size_t getRelativeRelocCount() const { return numRelativeRelocs; }
@@ -932,12 +944,27 @@ public:
   MergeTailSection(StringRef name, uint32_t type, uint64_t flags,
                    uint32_t alignment);
 
-  size_t getSize() const override;
+  size_t getSize() const override { return size; }
   void writeTo(uint8_t *buf) override;
   void finalizeContents() override;
 
 private:
-  llvm::StringTableBuilder builder;
+  // If S is a suffix of T and S has a non-NUL byte, the last non-NUL bytes
+  // of S and T are the same byte at the same distance from the end, so
+  // strings that may be tail-merged always land in the same shard.
+  // All-NUL strings go to shard 0.
+  static size_t getShardId(StringRef s) {
+    size_t pos = s.find_last_not_of('\0');
+    return pos == StringRef::npos ? 0 : uint8_t(s[pos]) % numShards;
+  }
+
+  // Section size
+  size_t size;
+
+  // String table contents
+  constexpr static size_t numShards = 32;
+  SmallVector<llvm::StringTableBuilder, 0> shards;
+  size_t shardOffsets[numShards];
 };
 
 class MergeNoTailSection final : public MergeSyntheticSection {
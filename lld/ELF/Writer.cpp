@@ -24,9 +24,11 @@
 #include "lld/Common/CommonLinkerContext.h"
 #include "lld/Common/Filesystem.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Timer.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/BLAKE3.h"
 #include "llvm/Support/Parallel.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/RandomNumberGenerator.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/xxhash.h"
@@ -531,6 +533,32 @@ template <class ELFT> void elf::createSyntheticSections() {
     add(*in.strTab);
 }
 
+// Computes per-output-section and per-input-file statistics for
+// --link-report=. Write times have been recorded by writeSections().
+template <class ELFT> static void collectLinkStats() {
+  for (OutputSection *osec : outputSections) {
+    Ctx::SectionStats &osStats = ctx->outputSectionStats[osec];
+    for (InputSection *isec : getInputSections(*osec)) {
+      ++osStats.inputSections;
+      if (isa<SyntheticSection>(isec))
+        continue;
+
+      uint64_t numRelocs = isec->relocations.size();
+      if (!(isec->flags & SHF_ALLOC)) {
+        RelsOrRelas<ELFT> rels = isec->template relsOrRelas<ELFT>();
+        numRelocs = rels.rels.size() + rels.relas.size();
+      }
+      osStats.bytes += isec->getSize();
+      osStats.relocations += numRelocs;
+
+      Ctx::SectionStats &fileStats = ctx->inputFileStats[isec->file];
+      ++fileStats.inputSections;
+      fileStats.bytes += isec->getSize();
+      fileStats.relocations += numRelocs;
+    }
+  }
+}
+
 // The main function of the writer.
 template <class ELFT> void Writer<ELFT>::run() {
   copyLocalSymbols();
@@ -542,8 +570,14 @@ template <class ELFT> void Writer<ELFT>::run() {
   // completes section contents. For example, we need to add strings
   // to the string table, and add entries to .got and .plt.
   // finalizeSections does that.
-  finalizeSections();
-  checkExecuteOnly();
+  {
+    ScopedTimer t(ctx->finalizeTimer);
+    finalizeSections();
+    checkExecuteOnly();
+  }
+
+  // Input sections are written from here on; see releaseInputPages().
+  collectMmappedBuffers();
 
   // If --compressed-debug-sections is specified, compress .debug_* sections.
   // Do it right now because it changes the size of output sections.
@@ -581,6 +615,7 @@ template <class ELFT> void Writer<ELFT>::run() {
 
   {
     llvm::TimeTraceScope timeScope("Write output file");
+    ScopedTimer t(ctx->writeTimer);
     // Write the result down to a file.
     openFile();
     if (errorCount())
@@ -604,6 +639,9 @@ template <class ELFT> void Writer<ELFT>::run() {
     if (auto e = buffer->commit())
       error("failed to write to the output file: " + toString(std::move(e)));
   }
+
+  if (!config->linkReport.empty())
+    collectLinkStats<ELFT>();
 }
 
 template <class ELFT, class RelTy>
@@ -1904,27 +1942,14 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
 
   {
     llvm::TimeTraceScope timeScope("Scan relocations");
+    ScopedTimer t(ctx->scanRelocTimer);
     // Scan relocations. This must be done after every symbol is declared so
     // that we can correctly decide if a dynamic relocation is needed. This is
     // called after processSymbolAssignments() because it needs to know whether
     // a linker-script-defined symbol is absolute.
     ppc64noTocRelax.clear();
     if (!config->relocatable) {
-      // Scan all relocations. Each relocation goes through a series of tests to
-      // determine if it needs special treatment, such as creating GOT, PLT,
-      // copy relocations, etc. Note that relocations for non-alloc sections are
-      // directly processed by InputSection::relocateNonAlloc.
-      for (InputSectionBase *sec : inputSections)
-        if (sec->isLive() && isa<InputSection>(sec) && (sec->flags & SHF_ALLOC))
-          scanRelocations<ELFT>(*sec);
-      for (Partition &part : partitions) {
-        for (EhInputSection *sec : part.ehFrame->sections)
-          scanRelocations<ELFT>(*sec);
-        if (part.armExidx && part.armExidx->isLive())
-          for (InputSection *sec : part.armExidx->exidxSections)
-            scanRelocations<ELFT>(*sec);
-      }
-
+      scanRelocations<ELFT>();
       reportUndefinedSymbols();
       postScanRelocations();
     }
@@ -2886,13 +2911,28 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
   // In -r or --emit-relocs mode, write the relocation sections first as in
   // ELf_Rel targets we might find out that we need to modify the relocated
   // section while doing it.
+  auto write = [](OutputSection *sec) {
+    if (config->linkReport.empty()) {
+      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+    ctx->outputSectionStats[sec].writeMillis =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    ctx->peakMallocUsage =
+        std::max(ctx->peakMallocUsage, sys::Process::GetMallocUsage());
+  };
+
   for (OutputSection *sec : outputSections)
     if (sec->type == SHT_REL || sec->type == SHT_RELA)
-      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+      write(sec);
 
   for (OutputSection *sec : outputSections)
     if (sec->type != SHT_REL && sec->type != SHT_RELA)
-      sec->writeTo<ELFT>(Out::bufferStart + sec->offset);
+      write(sec);
 
   // Finally, check that all dynamic relocation addends were written correctly.
   if (config->checkDynamicRelocs && config->writeAddends) {
@@ -9,6 +9,7 @@
 #ifndef LLD_COMMON_TIMER_H
 #define LLD_COMMON_TIMER_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringRef.h"
 #include <assert.h>
@@ -45,6 +46,8 @@ public:
   void print();
 
   double millis() const;
+  llvm::StringRef getName() const { return name; }
+  llvm::ArrayRef<Timer *> getChildren() const { return children; }
 
 private:
   void print(int depth, double totalDuration, bool recurse = true) const;
@@ -0,0 +1,9 @@
+# REQUIRES: x86
+# UNSUPPORTED: zstd
+# RUN: llvm-mc -filetype=obj -triple=x86_64 %s -o %t.o
+# RUN: not ld.lld %t.o -o /dev/null --compress-debug-sections=zstd 2>&1 | \
+# RUN:   FileCheck %s
+# CHECK: error: --compress-debug-sections: zstd is not available
+
+.section .debug_str,"MS",@progbits,1
+  .asciz "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
@@ -0,0 +1,26 @@
+# REQUIRES: x86, zstd
+# RUN: llvm-mc -filetype=obj -triple=x86_64 %s -o %t.o
+
+# RUN: ld.lld %t.o -o %t --compress-debug-sections=zstd
+# RUN: llvm-readelf -S %t | FileCheck %s --check-prefix=SEC
+# RUN: llvm-objdump -s -j .debug_str %t | FileCheck %s
+# RUN: ld.lld %t.o -o %t.O2 -O2 --compress-debug-sections=zstd
+# RUN: llvm-objdump -s -j .debug_str %t.O2 | FileCheck %s
+
+## Allocated sections are not compressed.
+# SEC: .text
+# SEC-NOT: {{ }}C{{ }}
+# SEC: .debug_str PROGBITS {{.*}} MSC 0 0 1
+
+## The header has ch_type ELFCOMPRESS_ZSTD, ch_size 0x21 and ch_addralign 1,
+## and is followed by a zstd frame.
+# CHECK:      Contents of section .debug_str:
+# CHECK-NEXT: 0000 02000000 00000000 21000000 00000000
+# CHECK-NEXT: 0010 01000000 00000000 28b52ffd
+
+.globl _start
+_start:
+  ret
+
+.section .debug_str,"MS",@progbits,1
+  .asciz "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
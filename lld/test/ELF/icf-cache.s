@@ -0,0 +1,126 @@
+# REQUIRES: x86
+# RUN: rm -rf %t && split-file %s %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64 a.s -o a.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64 b.s -o b.o
+
+## The cache does not change the folds, whether it is missing, which creates it
+## without a warning, or written by the same link.
+# RUN: ld.lld a.o b.o -o nocache --icf=all --print-icf-sections > nocache.txt
+# RUN: ld.lld a.o b.o -o first --icf=all --print-icf-sections \
+# RUN:   --icf-cache=cache --fatal-warnings > first.txt
+# RUN: ld.lld a.o b.o -o second --icf=all --print-icf-sections \
+# RUN:   --icf-cache=cache --fatal-warnings > second.txt
+# RUN: FileCheck %s < nocache.txt
+# RUN: cmp nocache first
+# RUN: cmp nocache second
+# RUN: sort nocache.txt > nocache.sorted
+# RUN: sort first.txt > first.sorted
+# RUN: sort second.txt > second.sorted
+# RUN: diff nocache.sorted first.sorted
+# RUN: diff nocache.sorted second.sorted
+
+# CHECK-DAG: selected section a.o:(.text.f1)
+# CHECK-DAG:   removing identical section a.o:(.text.f2)
+# CHECK-DAG:   removing identical section b.o:(.text.k)
+# CHECK-DAG: selected section a.o:(.text.f3)
+# CHECK-DAG:   removing identical section a.o:(.text.f4)
+
+## A malformed cache is ignored with a warning, and written again.
+# RUN: echo garbage > bad
+# RUN: ld.lld a.o b.o -o bad.out --icf=all --print-icf-sections \
+# RUN:   --icf-cache=bad 2> warn.txt > bad.txt
+# RUN: FileCheck %s --check-prefix=WARN < warn.txt
+# RUN: cmp nocache bad.out
+# RUN: sort bad.txt > bad.sorted
+# RUN: diff nocache.sorted bad.sorted
+# RUN: ld.lld a.o b.o -o bad.out --icf=all --icf-cache=bad --fatal-warnings
+# WARN: warning: --icf-cache=: ignoring malformed file bad
+
+## After k changes, f3 and f4 call different functions and no longer fold,
+## although their own contents and the cache entries for them are unchanged,
+## while g1 and g2 become identical and fold.
+# RUN: llvm-mc -filetype=obj -triple=x86_64 b2.s -o b.o
+# RUN: ld.lld a.o b.o -o nocache --icf=all --print-icf-sections > nocache.txt
+# RUN: ld.lld a.o b.o -o cached --icf=all --print-icf-sections \
+# RUN:   --icf-cache=cache --fatal-warnings > cached.txt
+# RUN: FileCheck %s --check-prefix=EDIT --implicit-check-not='(.text.f4)' \
+# RUN:   --implicit-check-not='(.text.k)' < nocache.txt
+# RUN: cmp nocache cached
+# RUN: sort nocache.txt > nocache.sorted
+# RUN: sort cached.txt > cached.sorted
+# RUN: diff nocache.sorted cached.sorted
+
+# EDIT-DAG: selected section a.o:(.text.f1)
+# EDIT-DAG:   removing identical section a.o:(.text.f2)
+# EDIT-DAG: selected section b.o:(.text.g1)
+# EDIT-DAG:   removing identical section b.o:(.text.g2)
+
+#--- a.s
+.globl _start
+_start:
+  call f1
+  call f2
+  call f3
+  call f4
+  call k
+  call g1
+  call g2
+  ret
+
+.section .text.f1,"ax",@progbits
+f1:
+  mov $1, %eax
+  ret
+
+.section .text.f2,"ax",@progbits
+f2:
+  mov $1, %eax
+  ret
+
+.section .text.f3,"ax",@progbits
+f3:
+  call f1
+  ret
+
+.section .text.f4,"ax",@progbits
+f4:
+  call k
+  ret
+
+#--- b.s
+.section .text.k,"ax",@progbits
+.globl k
+k:
+  mov $1, %eax
+  ret
+
+.section .text.g1,"ax",@progbits
+.globl g1
+g1:
+  mov $2, %eax
+  ret
+
+.section .text.g2,"ax",@progbits
+.globl g2
+g2:
+  mov $3, %eax
+  ret
+
+#--- b2.s
+.section .text.k,"ax",@progbits
+.globl k
+k:
+  mov $4, %eax
+  ret
+
+.section .text.g1,"ax",@progbits
+.globl g1
+g1:
+  mov $2, %eax
+  ret
+
+.section .text.g2,"ax",@progbits
+.globl g2
+g2:
+  mov $2, %eax
+  ret
@@ -0,0 +1,31 @@
+# REQUIRES: x86
+# RUN: rm -rf %t && mkdir %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64 %s -o a.o
+
+# RUN: ld.lld --incremental a.o -o out -Map=out.map --dependency-file=out.d
+# RUN: ld.lld --incremental --verbose a.o -o out -Map=out.map \
+# RUN:   --dependency-file=out.d 2>&1 | FileCheck %s --check-prefix=SKIP
+# SKIP: --incremental: out is up to date
+
+## A link is not skipped when one of its side outputs is missing, and the side
+## output is written again.
+# RUN: rm out.map
+# RUN: ld.lld --incremental --verbose a.o -o out -Map=out.map \
+# RUN:   --dependency-file=out.d 2>&1 | FileCheck %s --check-prefix=LINK
+# RUN: FileCheck %s --check-prefix=MAP < out.map
+# RUN: rm out.d
+# RUN: ld.lld --incremental --verbose a.o -o out -Map=out.map \
+# RUN:   --dependency-file=out.d 2>&1 | FileCheck %s --check-prefix=LINK
+# RUN: FileCheck %s --check-prefix=DEP < out.d
+# LINK-NOT: is up to date
+# MAP: _start
+# DEP: out: \
+# DEP-NEXT: a.o
+
+## A map file written to stdout is written again on every link.
+# RUN: ld.lld --incremental a.o -o out -Map=- | FileCheck %s --check-prefix=MAP
+# RUN: ld.lld --incremental a.o -o out -Map=- | FileCheck %s --check-prefix=MAP
+
+.globl _start
+_start:
+  ret
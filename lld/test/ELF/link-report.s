@@ -0,0 +1,58 @@
+# REQUIRES: x86
+# RUN: rm -rf %t && mkdir %t && cd %t
+# RUN: llvm-mc -filetype=obj -triple=x86_64 %s -o a.o
+
+# RUN: ld.lld a.o -o out --link-report=report.json
+# RUN: FileCheck %s --check-prefix=JSON < report.json
+
+# JSON:      {
+# JSON-NEXT:   "phases": {
+# JSON-DAG:      "Input File Reading": {{.+}}
+# JSON-DAG:      "ICF": {{.+}}
+# JSON-DAG:      "Finalize Sections": {{.+}}
+# JSON-DAG:      "Scan Relocations": {{.+}}
+# JSON-DAG:      "Write Output File": {{.+}}
+# JSON-DAG:      "Total Link Time": {{.+}}
+# JSON:        },
+# JSON-NEXT:   "icfIterations": 0,
+# JSON-NEXT:   "duplicateSymbolCandidates": {{[0-9]+}},
+# JSON-NEXT:   "peakMallocUsage": {{[0-9]+}},
+# JSON-NEXT:   "outputSections": [
+# JSON:            "name": ".text",
+# JSON-NEXT:       "size": 6,
+# JSON-NEXT:       "bytesCopied": 6,
+# JSON-NEXT:       "relocations": 1,
+# JSON-NEXT:       "inputSections": 1,
+# JSON-NEXT:       "writeMillis": {{.+}}
+# JSON:        "inputFiles": [
+# JSON-NEXT:     {
+# JSON-NEXT:       "name": "a.o",
+# JSON-NEXT:       "bytesCopied": {{[0-9]+}},
+# JSON-NEXT:       "relocations": 1,
+# JSON-NEXT:       "inputSections": {{[0-9]+}}
+# JSON-NEXT:     }
+# JSON-NEXT:   ]
+# JSON-NEXT: }
+
+## A name ending in .csv, in any case, selects the CSV report.
+# RUN: ld.lld a.o -o out --link-report=report.CSV
+# RUN: FileCheck %s --check-prefix=CSV < report.CSV
+
+# CSV:      kind,name,bytes,relocations,input_sections,millis
+# CSV-DAG:  phase,"Input File Reading",,,,{{.+}}
+# CSV-DAG:  phase,"Total Link Time",,,,{{.+}}
+# CSV-DAG:  output_section,".text",6,1,1,{{.+}}
+# CSV-DAG:  input_file,"a.o",{{[0-9]+}},1,{{[0-9]+}},{{$}}
+
+# RUN: not ld.lld a.o -o out --link-report=nonexistent/report.json 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=ERR
+# ERR: error: --link-report=: cannot open nonexistent/report.json: {{.+}}
+
+.globl _start, f
+_start:
+  call f
+f:
+  ret
+
+.data
+.quad 0
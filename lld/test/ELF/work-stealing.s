@@ -0,0 +1,18 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64 %s -o %t.o
+
+## The executor that runs the parallel tasks does not change the output.
+# RUN: ld.lld --threads=4 %t.o -o %t.default
+# RUN: ld.lld --threads=4 --work-stealing %t.o -o %t.ws
+# RUN: ld.lld --threads=4 --work-stealing --no-work-stealing %t.o -o %t.nows
+# RUN: cmp %t.default %t.ws
+# RUN: cmp %t.default %t.nows
+
+.globl _start
+_start:
+  ret
+
+.section .data.a,"aw"
+.quad 1
+.section .data.b,"aw"
+.quad 2
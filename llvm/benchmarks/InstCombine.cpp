@@ -0,0 +1,78 @@
+//===- InstCombine.cpp - Compile-time benchmark for InstCombine -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures InstCombine on large straight-line functions. LLVM options on the
+// command line are honored, so the experimental worklist orderings can be
+// compared with, e.g.:
+//
+//   InstCombine -instcombine-batch-by-opcode
+//   InstCombine -instcombine-skip-unchanged-users
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+
+using namespace llvm;
+
+/// Return a straight-line function of \p N rounds of foldable arithmetic, each
+/// feeding the next one.
+static std::string makeFunction(unsigned N) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "define i32 @f(i32 %x0, i32 %y) {\n";
+  for (unsigned I = 1; I <= N; ++I) {
+    unsigned P = I - 1;
+    OS << "  %a" << I << " = add i32 %x" << P << ", 0\n"
+       << "  %b" << I << " = mul i32 %a" << I << ", 8\n"
+       << "  %c" << I << " = xor i32 %b" << I << ", -1\n"
+       << "  %d" << I << " = xor i32 %c" << I << ", -1\n"
+       << "  %e" << I << " = sub i32 %d" << I << ", %y\n"
+       << "  %f" << I << " = icmp eq i32 %e" << I << ", 0\n"
+       << "  %g" << I << " = zext i1 %f" << I << " to i32\n"
+       << "  %x" << I << " = or i32 %e" << I << ", %g" << I << "\n";
+  }
+  OS << "  ret i32 %x" << N << "\n}\n";
+  return OS.str();
+}
+
+static void BM_InstCombine(benchmark::State &State) {
+  std::string IR = makeFunction(State.range(0));
+  PassBuilder PB;
+  for (auto _ : State) {
+    State.PauseTiming();
+    LLVMContext Ctx;
+    SMDiagnostic Err;
+    std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+    if (!M) {
+      State.SkipWithError("invalid IR");
+      break;
+    }
+    FunctionAnalysisManager FAM;
+    PB.registerFunctionAnalyses(FAM);
+    FunctionPassManager FPM;
+    FPM.addPass(InstCombinePass());
+    State.ResumeTiming();
+
+    FPM.run(*M->getFunction("f"), FAM);
+  }
+}
+BENCHMARK(BM_InstCombine)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  cl::ParseCommandLineOptions(argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+}
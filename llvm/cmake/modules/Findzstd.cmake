@@ -0,0 +1,70 @@
+# Try to find the zstd library
+#
+# If successful, the following variables will be defined:
+# zstd_INCLUDE_DIR
+# zstd_LIBRARY
+# zstd_STATIC_LIBRARY
+# zstd_FOUND
+#
+# Additionally, one or both of the following import targets will be defined:
+# zstd::libzstd_shared
+# zstd::libzstd_static
+#
+# zstd's own CMake package defines the same targets and is used if it is
+# installed. Many distributions only ship the headers, the libraries and a
+# pkg-config file though, so otherwise we look for the files directly.
+
+find_package(zstd CONFIG QUIET)
+if(TARGET zstd::libzstd_shared OR TARGET zstd::libzstd_static)
+  set(zstd_FOUND TRUE)
+  return()
+endif()
+
+if(MSVC)
+  set(zstd_STATIC_LIBRARY_NAMES zstd_static)
+else()
+  set(zstd_STATIC_LIBRARY_NAMES
+    "${CMAKE_STATIC_LIBRARY_PREFIX}zstd${CMAKE_STATIC_LIBRARY_SUFFIX}")
+endif()
+
+find_path(zstd_INCLUDE_DIR NAMES zstd.h)
+find_library(zstd_LIBRARY NAMES zstd)
+find_library(zstd_STATIC_LIBRARY NAMES ${zstd_STATIC_LIBRARY_NAMES})
+unset(zstd_STATIC_LIBRARY_NAMES)
+
+# On platforms without shared libraries, or when only the archive is
+# installed, find_library(zstd) returns the archive itself.
+if(zstd_LIBRARY AND NOT zstd_STATIC_LIBRARY AND
+   zstd_LIBRARY MATCHES "${CMAKE_STATIC_LIBRARY_SUFFIX}$")
+  set(zstd_STATIC_LIBRARY "${zstd_LIBRARY}")
+endif()
+if(zstd_LIBRARY STREQUAL zstd_STATIC_LIBRARY)
+  unset(zstd_LIBRARY CACHE)
+  unset(zstd_LIBRARY)
+endif()
+
+include(FindPackageHandleStandardArgs)
+if(zstd_LIBRARY)
+  find_package_handle_standard_args(zstd DEFAULT_MSG
+    zstd_LIBRARY zstd_INCLUDE_DIR)
+else()
+  find_package_handle_standard_args(zstd DEFAULT_MSG
+    zstd_STATIC_LIBRARY zstd_INCLUDE_DIR)
+endif()
+
+if(zstd_FOUND)
+  if(zstd_LIBRARY)
+    add_library(zstd::libzstd_shared UNKNOWN IMPORTED)
+    set_target_properties(zstd::libzstd_shared PROPERTIES
+      INTERFACE_INCLUDE_DIRECTORIES "${zstd_INCLUDE_DIR}"
+      IMPORTED_LOCATION "${zstd_LIBRARY}")
+  endif()
+  if(zstd_STATIC_LIBRARY)
+    add_library(zstd::libzstd_static STATIC IMPORTED)
+    set_target_properties(zstd::libzstd_static PROPERTIES
+      INTERFACE_INCLUDE_DIRECTORIES "${zstd_INCLUDE_DIR}"
+      IMPORTED_LOCATION "${zstd_STATIC_LIBRARY}")
+  endif()
+endif()
+
+mark_as_advanced(zstd_INCLUDE_DIR zstd_LIBRARY zstd_STATIC_LIBRARY)
@@ -35,6 +35,20 @@ static cl::opt<unsigned> NumThreads("num-threads", cl::Optional,
                                     cl::desc("Number of compile threads"),
                                     cl::init(4));
 
+static cl::opt<unsigned> SpeculationBudget(
+    "speculation-budget", cl::Optional,
+    cl::desc("Maximum number of speculative compiles in flight (default = "
+             "all compile threads)"),
+    cl::init(0));
+
+static cl::opt<std::string>
+    CallTraceIn("call-trace-in", cl::Optional,
+                cl::desc("Speculate using the call trace of an earlier run"));
+
+static cl::opt<std::string>
+    CallTraceOut("call-trace-out", cl::Optional,
+                 cl::desc("Record the call trace of this run to a file"));
+
 ExitOnError ExitOnErr;
 
 // Add Layers
@@ -89,6 +103,8 @@ public:
     return ES->lookup({&MainJD}, Mangle(UnmangledName));
   }
 
+  Speculator &getSpeculator() { return S; }
+
   ~SpeculativeJIT() { CompileThreads.wait(); }
 
 private:
@@ -169,6 +185,13 @@ int main(int argc, char *argv[]) {
   // Create a JIT instance.
   auto SJ = ExitOnErr(SpeculativeJIT::Create());
 
+  auto &S = SJ->getSpeculator();
+  S.setSpeculationBudget(SpeculationBudget ? SpeculationBudget : NumThreads);
+  if (!CallTraceIn.empty())
+    ExitOnErr(S.loadCallTrace(CallTraceIn));
+  if (!CallTraceOut.empty())
+    S.enableCallTraceRecording();
+
   // Load the IR inputs.
   for (const auto &InputFile : InputFiles) {
     SMDiagnostic Err;
@@ -186,7 +209,10 @@ int main(int argc, char *argv[]) {
   auto Main =
       jitTargetAddressToFunction<int (*)(int, char *[])>(MainSym.getAddress());
 
-  return runAsMain(Main, InputArgv, StringRef(InputFiles.front()));
+  int Result = runAsMain(Main, InputArgv, StringRef(InputFiles.front()));
+
+  if (!CallTraceOut.empty())
+    ExitOnErr(S.saveCallTrace(CallTraceOut));
 
-  return 0;
+  return Result;
 }
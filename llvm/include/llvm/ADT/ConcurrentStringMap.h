@@ -0,0 +1,382 @@
+//===- ConcurrentStringMap.h - Lock-free string interning map ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines ConcurrentStringMap, a map from strings to values that
+/// supports concurrent insert-or-get from any number of threads without
+/// taking locks.
+///
+/// The map is a hash trie keyed by the 64-bit xxHash of the string. The root
+/// level has a fixed number of slots and every further level consumes a few
+/// more bits of the hash. A slot holds either nothing, a single entry, or a
+/// pointer to a deeper level. When two different hashes land in the same slot,
+/// the slot is atomically replaced by a new level holding the existing entry,
+/// so the table never needs to be rehashed and existing entries never move.
+/// Strings whose full 64-bit hashes collide are chained off the first one.
+///
+/// Entries, keys and trie levels are allocated from an arena owned by the map
+/// and freed all at once when the map is destroyed. Entries cannot be erased.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_CONCURRENTSTRINGMAP_H
+#define LLVM_ADT_CONCURRENTSTRINGMAP_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Alignment.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace llvm {
+
+template <typename ValueTy> class ConcurrentStringMap;
+
+namespace detail {
+
+/// A bump pointer allocator that can be shared between threads without
+/// locking. Space is claimed from the current slab with an atomic add; when a
+/// slab runs out, threads race to install a new one and the losers free
+/// theirs. Memory is only released when the allocator is destroyed.
+class ConcurrentBumpAllocator {
+public:
+  ConcurrentBumpAllocator() = default;
+  ConcurrentBumpAllocator(const ConcurrentBumpAllocator &) = delete;
+  ConcurrentBumpAllocator &operator=(const ConcurrentBumpAllocator &) = delete;
+
+  ~ConcurrentBumpAllocator() {
+    Slab *S = Current.load(std::memory_order_acquire);
+    while (S) {
+      Slab *Prev = S->Prev;
+      S->destroy();
+      S = Prev;
+    }
+  }
+
+  void *Allocate(size_t Size, size_t Alignment) {
+    // Every slab is aligned to BaseAlign and every reservation is a multiple
+    // of it, so only over-aligned requests need extra room for padding.
+    size_t Reserve = alignTo(Size, BaseAlign);
+    if (Alignment > BaseAlign)
+      Reserve += Alignment - BaseAlign;
+
+    Slab *S = Current.load(std::memory_order_acquire);
+    while (true) {
+      if (S) {
+        size_t Offset = S->Used.fetch_add(Reserve, std::memory_order_relaxed);
+        if (Offset + Reserve <= S->Size)
+          return reinterpret_cast<void *>(
+              alignAddr(S->data() + Offset, Align(Alignment)));
+      }
+
+      // The slab is exhausted. Install a new one with this request already
+      // carved out of it. If another thread beat us to it, S is updated to
+      // point to the winner's slab and we try again there.
+      Slab *New = Slab::create(std::max(Reserve, SlabSize), S);
+      New->Used.store(Reserve, std::memory_order_relaxed);
+      if (Current.compare_exchange_strong(S, New, std::memory_order_acq_rel,
+                                          std::memory_order_acquire))
+        return reinterpret_cast<void *>(
+            alignAddr(New->data(), Align(Alignment)));
+      New->destroy();
+    }
+  }
+
+private:
+  static constexpr size_t BaseAlign = alignof(std::max_align_t);
+  static constexpr size_t SlabSize = 64 * 1024;
+
+  struct Slab {
+    Slab *Prev;
+    size_t Size;
+    std::atomic<size_t> Used{0};
+
+    Slab(Slab *Prev, size_t Size) : Prev(Prev), Size(Size) {}
+
+    static size_t headerSize() { return alignTo(sizeof(Slab), BaseAlign); }
+    char *data() { return reinterpret_cast<char *>(this) + headerSize(); }
+
+    static Slab *create(size_t Size, Slab *Prev) {
+      void *Mem = allocate_buffer(headerSize() + Size, BaseAlign);
+      return new (Mem) Slab(Prev, Size);
+    }
+    void destroy() {
+      size_t Bytes = headerSize() + Size;
+      this->~Slab();
+      deallocate_buffer(this, Bytes, BaseAlign);
+    }
+  };
+
+  std::atomic<Slab *> Current{nullptr};
+};
+
+} // end namespace detail
+
+/// An entry of a ConcurrentStringMap. The key is stored inline, immediately
+/// after the entry, and is followed by a null terminator.
+template <typename ValueTy> class ConcurrentStringMapEntry {
+  friend class ConcurrentStringMap<ValueTy>;
+
+  uint64_t Hash;
+  size_t KeyLength;
+  // Next entry whose key has the same 64-bit hash as this one.
+  std::atomic<ConcurrentStringMapEntry *> Next{nullptr};
+  ValueTy Value;
+
+  template <typename... ArgsTy>
+  ConcurrentStringMapEntry(uint64_t Hash, size_t KeyLength, ArgsTy &&...Args)
+      : Hash(Hash), KeyLength(KeyLength), Value(std::forward<ArgsTy>(Args)...) {
+  }
+
+public:
+  ConcurrentStringMapEntry(const ConcurrentStringMapEntry &) = delete;
+  ConcurrentStringMapEntry &
+  operator=(const ConcurrentStringMapEntry &) = delete;
+
+  StringRef getKey() const { return StringRef(getKeyData(), KeyLength); }
+  const char *getKeyData() const {
+    return reinterpret_cast<const char *>(this + 1);
+  }
+  size_t getKeyLength() const { return KeyLength; }
+  uint64_t getHash() const { return Hash; }
+
+  const ValueTy &getValue() const { return Value; }
+  ValueTy &getValue() { return Value; }
+};
+
+/// A string to value map that can be read and extended concurrently by any
+/// number of threads. Lookups and insertions are lock-free, and pointers to
+/// entries stay valid until the map is destroyed, so the map can also serve as
+/// a string pool: the key of an entry is a stable, null-terminated copy of
+/// the inserted string.
+template <typename ValueTy> class ConcurrentStringMap {
+public:
+  using EntryTy = ConcurrentStringMapEntry<ValueTy>;
+
+  ConcurrentStringMap() {
+    for (Slot &S : Root)
+      S.store(0, std::memory_order_relaxed);
+  }
+  ConcurrentStringMap(const ConcurrentStringMap &) = delete;
+  ConcurrentStringMap &operator=(const ConcurrentStringMap &) = delete;
+
+  ~ConcurrentStringMap() {
+    if (!std::is_trivially_destructible<ValueTy>::value)
+      forEach([](EntryTy &E) { E.~EntryTy(); });
+  }
+
+  /// Returns the entry for \p Key, inserting one with a value constructed
+  /// from \p Args if there is none yet. The second member of the result is
+  /// true if this call inserted the entry.
+  ///
+  /// If several threads insert the same key at the same time, exactly one of
+  /// them wins. The values constructed by the others are destroyed, and the
+  /// others get the winner's entry back.
+  template <typename... ArgsTy>
+  std::pair<EntryTy *, bool> try_emplace(StringRef Key, ArgsTy &&...Args) {
+    uint64_t Hash = xxHash64(Key);
+    EntryTy *NewEntry = nullptr;
+    // A subtrie that lost the race to be installed, kept for the next split.
+    Subtrie *Spare = nullptr;
+    auto GetNewEntry = [&] {
+      if (!NewEntry)
+        NewEntry = createEntry(Key, Hash, std::forward<ArgsTy>(Args)...);
+      return NewEntry;
+    };
+
+    unsigned Shift = 64 - RootBits;
+    Slot *S = &Root[Hash >> Shift];
+    while (true) {
+      uintptr_t V = S->load(std::memory_order_acquire);
+      if (V & IsSubtrie) {
+        Shift -= SubtrieBits;
+        S = &getSubtrie(V)->Slots[(Hash >> Shift) & SubtrieMask];
+        continue;
+      }
+
+      if (!V) {
+        if (S->compare_exchange_strong(
+                V, reinterpret_cast<uintptr_t>(GetNewEntry()),
+                std::memory_order_release, std::memory_order_relaxed)) {
+          NumItems.fetch_add(1, std::memory_order_relaxed);
+          return {NewEntry, true};
+        }
+        continue;
+      }
+
+      EntryTy *E = reinterpret_cast<EntryTy *>(V);
+      if (E->Hash == Hash)
+        return insertIntoChain(E, Key, NewEntry, GetNewEntry);
+
+      // The slot holds an entry with a different hash. Push it one level down
+      // and retry. Because the hashes differ, there are bits left to tell the
+      // two apart.
+      assert(Shift >= SubtrieBits && "equal hashes must share a slot");
+      Subtrie *T = Spare ? Spare : createSubtrie();
+      T->Slots[(E->Hash >> (Shift - SubtrieBits)) & SubtrieMask].store(
+          V, std::memory_order_relaxed);
+      if (S->compare_exchange_strong(V, reinterpret_cast<uintptr_t>(T) |
+                                            IsSubtrie,
+                                     std::memory_order_release,
+                                     std::memory_order_relaxed)) {
+        Spare = nullptr;
+      } else {
+        clearSubtrie(T);
+        Spare = T;
+      }
+    }
+  }
+
+  /// Returns the entry for \p Key, or nullptr if there is none.
+  EntryTy *find(StringRef Key) const {
+    uint64_t Hash = xxHash64(Key);
+    unsigned Shift = 64 - RootBits;
+    const Slot *S = &Root[Hash >> Shift];
+    while (true) {
+      uintptr_t V = S->load(std::memory_order_acquire);
+      if (!V)
+        return nullptr;
+      if (V & IsSubtrie) {
+        Shift -= SubtrieBits;
+        S = &getSubtrie(V)->Slots[(Hash >> Shift) & SubtrieMask];
+        continue;
+      }
+      EntryTy *E = reinterpret_cast<EntryTy *>(V);
+      if (E->Hash != Hash)
+        return nullptr;
+      for (; E; E = E->Next.load(std::memory_order_acquire))
+        if (E->getKey() == Key)
+          return E;
+      return nullptr;
+    }
+  }
+
+  /// Returns the value for \p Key, or a default-constructed value if there
+  /// is none.
+  ValueTy lookup(StringRef Key) const {
+    if (EntryTy *E = find(Key))
+      return E->getValue();
+    return ValueTy();
+  }
+
+  size_t count(StringRef Key) const { return find(Key) ? 1 : 0; }
+
+  size_t size() const { return NumItems.load(std::memory_order_relaxed); }
+  bool empty() const { return size() == 0; }
+
+  /// Calls \p Callback on every entry in hash order. Entries inserted while
+  /// the walk is in progress may or may not be visited.
+  template <typename CallbackTy> void forEach(CallbackTy Callback) const {
+    for (const Slot &S : Root)
+      forEachInSlot(S, Callback);
+  }
+
+private:
+  using Slot = std::atomic<uintptr_t>;
+
+  // The root consumes the top RootBits bits of the hash and every subtrie the
+  // next SubtrieBits bits, so that the last level uses up the hash exactly.
+  static constexpr unsigned RootBits = 8;
+  static constexpr unsigned SubtrieBits = 4;
+  static constexpr uint64_t SubtrieMask = (1 << SubtrieBits) - 1;
+  static_assert((64 - RootBits) % SubtrieBits == 0,
+                "trie levels must use up the hash exactly");
+
+  // Entries and subtries are at least 8-byte aligned, so the low bit of a slot
+  // value tells what it points to.
+  static constexpr uintptr_t IsSubtrie = 1;
+  static_assert(alignof(EntryTy) > 1, "no room for the subtrie tag");
+
+  struct Subtrie {
+    Slot Slots[1 << SubtrieBits];
+  };
+
+  static Subtrie *getSubtrie(uintptr_t V) {
+    return reinterpret_cast<Subtrie *>(V & ~IsSubtrie);
+  }
+
+  static void clearSubtrie(Subtrie *T) {
+    for (Slot &S : T->Slots)
+      S.store(0, std::memory_order_relaxed);
+  }
+
+  Subtrie *createSubtrie() {
+    auto *T = static_cast<Subtrie *>(
+        Allocator.Allocate(sizeof(Subtrie), alignof(Subtrie)));
+    clearSubtrie(T);
+    return T;
+  }
+
+  template <typename... ArgsTy>
+  EntryTy *createEntry(StringRef Key, uint64_t Hash, ArgsTy &&...Args) {
+    void *Mem =
+        Allocator.Allocate(sizeof(EntryTy) + Key.size() + 1, alignof(EntryTy));
+    EntryTy *E =
+        new (Mem) EntryTy(Hash, Key.size(), std::forward<ArgsTy>(Args)...);
+    char *KeyData = reinterpret_cast<char *>(E + 1);
+    if (!Key.empty())
+      memcpy(KeyData, Key.data(), Key.size());
+    KeyData[Key.size()] = '\0';
+    return E;
+  }
+
+  template <typename GetNewEntryTy>
+  std::pair<EntryTy *, bool> insertIntoChain(EntryTy *E, StringRef Key,
+                                             EntryTy *&NewEntry,
+                                             GetNewEntryTy GetNewEntry) {
+    while (true) {
+      if (E->getKey() == Key) {
+        if (NewEntry)
+          NewEntry->~EntryTy();
+        return {E, false};
+      }
+      EntryTy *Next = E->Next.load(std::memory_order_acquire);
+      if (!Next) {
+        if (E->Next.compare_exchange_strong(Next, GetNewEntry(),
+                                            std::memory_order_release,
+                                            std::memory_order_acquire)) {
+          NumItems.fetch_add(1, std::memory_order_relaxed);
+          return {NewEntry, true};
+        }
+      }
+      E = Next;
+    }
+  }
+
+  template <typename CallbackTy>
+  static void forEachInSlot(const Slot &S, CallbackTy &Callback) {
+    uintptr_t V = S.load(std::memory_order_acquire);
+    if (!V)
+      return;
+    if (V & IsSubtrie) {
+      for (const Slot &Child : getSubtrie(V)->Slots)
+        forEachInSlot(Child, Callback);
+      return;
+    }
+    // Load the next pointer first so that the callback may destroy the entry.
+    EntryTy *Next;
+    for (EntryTy *E = reinterpret_cast<EntryTy *>(V); E; E = Next) {
+      Next = E->Next.load(std::memory_order_acquire);
+      Callback(*E);
+    }
+  }
+
+  Slot Root[1 << RootBits];
+  std::atomic<size_t> NumItems{0};
+  detail::ConcurrentBumpAllocator Allocator;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_CONCURRENTSTRINGMAP_H
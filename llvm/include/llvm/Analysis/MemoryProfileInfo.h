@@ -0,0 +1,120 @@
+//===- llvm/Analysis/MemoryProfileInfo.h - memory profile info ---*- C++ -*-==//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains utilities to analyze memory profile information, and to
+// attach it to allocation calls as metadata:
+//
+//   %call = call ptr @_Znam(i64 10), !memprof !0, !callsite !3
+//   !0 = !{!1, !2}                    ; list of MIBs (memory info blocks)
+//   !1 = !{!4, !"notcold"}            ; allocation context and its type
+//   !2 = !{!5, !"cold"}
+//   !3 = !{i64 1}                     ; stack id of the allocation call
+//   !4 = !{i64 1, i64 2}              ; stack ids, from the allocation call up
+//   !5 = !{i64 1, i64 3}
+//
+// When all the profiled contexts of an allocation have the same type, the
+// call gets a "memprof" string attribute with that type instead.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYPROFILEINFO_H
+#define LLVM_ANALYSIS_MEMORYPROFILEINFO_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Metadata.h"
+#include <map>
+
+namespace llvm {
+namespace memprof {
+
+/// The allocation type of a context, as a bitmask so that the types of the
+/// contexts sharing a prefix can be accumulated.
+enum class AllocationType : uint8_t {
+  None = 0,
+  NotCold = 1,
+  Cold = 2,
+  Hot = 4,
+};
+
+/// Return the allocation type of a context with the given profiled access
+/// count, allocation size and lifetime.
+AllocationType getAllocType(uint64_t MaxAccessCount, uint64_t MinSize,
+                            uint64_t MinLifetime);
+
+/// Return the string used for \p AllocType in the metadata and the attribute.
+StringRef getAllocTypeString(AllocationType AllocType);
+
+/// Build the metadata of a list of stack ids.
+MDNode *buildCallstackMetadata(ArrayRef<uint64_t> CallStack,
+                               LLVMContext &Ctx);
+
+/// Return the stack node of the MIB \p MIB.
+MDNode *getMIBStackNode(const MDNode *MIB);
+
+/// Return the allocation type of the MIB \p MIB.
+AllocationType getMIBAllocType(const MDNode *MIB);
+
+/// Trie of the profiled contexts of one allocation, along which each node
+/// accumulates the allocation types of the contexts going through it. It is
+/// used to attach only as much context as needed to tell the types apart.
+class CallStackTrie {
+private:
+  struct CallStackTrieNode {
+    // Allocation types of the contexts through this node.
+    uint8_t AllocTypes;
+    // Callers of this node, indexed by their stack id.
+    std::map<uint64_t, CallStackTrieNode *> Callers;
+    CallStackTrieNode(AllocationType Type)
+        : AllocTypes(static_cast<uint8_t>(Type)) {}
+  };
+
+  // The node for the allocation call itself, at the root of the trie.
+  CallStackTrieNode *Alloc = nullptr;
+  // The stack id of the allocation call.
+  uint64_t AllocStackId = 0;
+
+  void deleteTrieNode(CallStackTrieNode *Node) {
+    if (!Node)
+      return;
+    for (auto &Caller : Node->Callers)
+      deleteTrieNode(Caller.second);
+    delete Node;
+  }
+
+  bool buildMIBNodes(CallStackTrieNode *Node, LLVMContext &Ctx,
+                     std::vector<uint64_t> &MIBCallStack,
+                     std::vector<Metadata *> &MIBNodes,
+                     bool CalleeHasAmbiguousCallerContext);
+
+public:
+  CallStackTrie() = default;
+  CallStackTrie(const CallStackTrie &) = delete;
+  CallStackTrie &operator=(const CallStackTrie &) = delete;
+  ~CallStackTrie() { deleteTrieNode(Alloc); }
+
+  bool empty() const { return Alloc == nullptr; }
+
+  /// Add a context of type \p AllocType, given by the stack ids \p StackIds
+  /// from the allocation call up. All the contexts of a trie share the stack
+  /// id of the allocation call.
+  void addCallStack(AllocationType AllocType, ArrayRef<uint64_t> StackIds);
+
+  /// Add the context of the MIB \p MIB.
+  void addCallStack(MDNode *MIB);
+
+  /// Attach the contexts to \p CI: as a "memprof" attribute if they all have
+  /// the same type, otherwise as !memprof metadata with the shortest contexts
+  /// that tell the types apart. Return true if metadata was attached.
+  bool buildAndAttachMIBMetadata(CallBase *CI);
+};
+
+} // end namespace memprof
+} // end namespace llvm
+
+#endif // LLVM_ANALYSIS_MEMORYPROFILEINFO_H
@@ -169,6 +169,9 @@ public:
   /// such mapping exists, return the empty string.
   StringRef getVectorizedFunction(StringRef F, const ElementCount &VF) const;
 
+  /// Return the vectorization descriptors, sorted by scalar function name.
+  ArrayRef<VecDesc> getVectorDescs() const { return VectorDescs; }
+
   /// Set to true iff i32 parameters to library functions should have signext
   /// or zeroext attributes if they correspond to C-level int or unsigned int,
   /// respectively.
@@ -337,6 +340,7 @@ public:
   StringRef getVectorizedFunction(StringRef F, const ElementCount &VF) const {
     return Impl->getVectorizedFunction(F, VF);
   }
+  ArrayRef<VecDesc> getVectorDescs() const { return Impl->getVectorDescs(); }
 
   /// Tests if the function is both available and a candidate for optimized code
   /// generation.
@@ -22,6 +22,7 @@
 #include "llvm/Support/MemoryBufferRef.h"
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <vector>
@@ -116,9 +117,12 @@ typedef llvm::function_ref<Optional<std::string>(StringRef)>
     Expected<std::unique_ptr<ModuleSummaryIndex>> getSummary();
 
     /// Parse the specified bitcode buffer and merge its module summary index
-    /// into CombinedIndex.
+    /// into CombinedIndex. If \p IndexMutex is given, several modules may be
+    /// read into the same index concurrently; every access to CombinedIndex
+    /// is then made with the mutex held, and the order of the summaries in
+    /// each SummaryList depends on the order the threads reach it.
     Error readSummary(ModuleSummaryIndex &CombinedIndex, StringRef ModulePath,
-                      uint64_t ModuleId);
+                      uint64_t ModuleId, std::mutex *IndexMutex = nullptr);
   };
 
   struct BitcodeFileContents {
@@ -30,7 +30,6 @@ class Module;
 class raw_ostream;
 
   class BitcodeWriter {
-    SmallVectorImpl<char> &Buffer;
     std::unique_ptr<BitstreamWriter> Stream;
 
     StringTableBuilder StrtabBuilder{StringTableBuilder::RAW};
@@ -46,7 +45,10 @@ class raw_ostream;
     std::vector<Module *> Mods;
 
   public:
-    /// Create a BitcodeWriter that writes to Buffer.
+    /// Create a BitcodeWriter that writes to Buffer. If \p FS is not null,
+    /// Buffer is flushed to it at block boundaries once it grows past
+    /// -bitcode-flush-threshold, so that large modules are not held in memory
+    /// whole.
     BitcodeWriter(SmallVectorImpl<char> &Buffer, raw_fd_stream *FS = nullptr);
 
     ~BitcodeWriter();
@@ -15,6 +15,7 @@
 #define LLVM_BITSTREAM_BITSTREAMWRITER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -189,6 +190,40 @@ public:
     FS->seek(CurPos);
   }
 
+  /// Call \p Callback on the bytes written to the stream, from byte
+  /// \p StartByte up to the last complete word. The bytes that were already
+  /// flushed to the file stream are read back from it, in chunks.
+  void ReadWrittenBytes(uint64_t StartByte,
+                        function_ref<void(ArrayRef<uint8_t>)> Callback) {
+    uint64_t NumOfFlushedBytes = GetNumOfFlushedBytes();
+    if (StartByte < NumOfFlushedBytes) {
+      // Save the file position to restore later. Seeking also flushes the
+      // buffer of the file stream, so that it can be read from.
+      uint64_t CurPos = FS->tell();
+      FS->seek(StartByte);
+
+      SmallVector<char, 0> Chunk;
+      Chunk.resize(std::min<uint64_t>(NumOfFlushedBytes - StartByte, 1 << 20));
+      for (uint64_t Pos = StartByte; Pos < NumOfFlushedBytes;) {
+        size_t Size =
+            std::min<uint64_t>(Chunk.size(), NumOfFlushedBytes - Pos);
+        ssize_t BytesRead = FS->read(Chunk.data(), Size);
+        (void)BytesRead; // silence warning
+        assert(BytesRead >= 0 && static_cast<size_t>(BytesRead) == Size);
+        Callback(ArrayRef<uint8_t>((const uint8_t *)Chunk.data(), Size));
+        Pos += Size;
+      }
+
+      FS->seek(CurPos);
+      StartByte = NumOfFlushedBytes;
+    }
+
+    uint64_t StartInBuffer = StartByte - NumOfFlushedBytes;
+    assert(StartInBuffer <= Out.size() && "reading past the end of the stream");
+    Callback(ArrayRef<uint8_t>((const uint8_t *)Out.data() + StartInBuffer,
+                               Out.size() - StartInBuffer));
+  }
+
   void BackpatchWord64(uint64_t BitNo, uint64_t Val) {
     BackpatchWord(BitNo, (uint32_t)Val);
     BackpatchWord(BitNo + 32, (uint32_t)(Val >> 32));
@@ -0,0 +1,60 @@
+//== llvm/CodeGen/GlobalISel/FusedInstructionSelect.h -----------*- C++ -*-==//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file This file describes the interface of the MachineFunctionPass that
+/// assigns register banks and selects instructions in a single walk over the
+/// function, for the fast instruction selection of unoptimized code.
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_GLOBALISEL_FUSEDINSTRUCTIONSELECT_H
+#define LLVM_CODEGEN_GLOBALISEL_FUSEDINSTRUCTIONSELECT_H
+
+#include "llvm/CodeGen/GlobalISel/RegBankSelect.h"
+
+namespace llvm {
+
+/// This pass does the work of RegBankSelect, in its Fast mode, followed by
+/// that of InstructionSelect, one block at a time: blocks are visited in
+/// reverse post-order, and each one is selected as soon as its register banks
+/// have been assigned.
+///
+/// Since the definitions of the values a block uses, other than through PHIs,
+/// are selected before it, the selector cannot fold them across blocks.
+/// G_PHIs are selected last, once every block has its register banks; the
+/// instructions that repairing their operands inserts in predecessors that
+/// have been selected already are selected then too.
+///
+/// \pre for all inst in MF: inst is legal
+/// \post for all inst in MF: not isPreISelGenericOpcode(inst.opcode)
+class FusedInstructionSelect : public RegBankSelect {
+public:
+  static char ID;
+
+  FusedInstructionSelect();
+
+  StringRef getPassName() const override { return "FusedInstructionSelect"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+  MachineFunctionProperties getRequiredProperties() const override {
+    return MachineFunctionProperties()
+        .set(MachineFunctionProperties::Property::IsSSA)
+        .set(MachineFunctionProperties::Property::Legalized);
+  }
+
+  MachineFunctionProperties getSetProperties() const override {
+    return MachineFunctionProperties()
+        .set(MachineFunctionProperties::Property::RegBankSelected)
+        .set(MachineFunctionProperties::Property::Selected);
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_CODEGEN_GLOBALISEL_FUSEDINSTRUCTIONSELECT_H
@@ -13,6 +13,7 @@
 #ifndef LLVM_CODEGEN_GLOBALISEL_INSTRUCTIONSELECT_H
 #define LLVM_CODEGEN_GLOBALISEL_INSTRUCTIONSELECT_H
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
@@ -21,7 +22,11 @@
 namespace llvm {
 
 class BlockFrequencyInfo;
+class CodeGenCoverage;
+class InstructionSelector;
+class MachineOptimizationRemarkEmitter;
 class ProfileSummaryInfo;
+class TargetPassConfig;
 
 /// This pass is responsible for selecting generic machine instructions to
 /// target-specific instructions.  It relies on the InstructionSelector provided
@@ -54,6 +59,30 @@ public:
 
   bool runOnMachineFunction(MachineFunction &MF) override;
 
+  /// Select the instructions of \p MBB with \p ISel, in reverse order,
+  /// stopping at the PHIs unless \p SelectPHIs.
+  /// \return True on success, false otherwise, after reporting the failure.
+  static bool selectMachineBasicBlock(MachineBasicBlock &MBB,
+                                      InstructionSelector &ISel,
+                                      const TargetPassConfig &TPC,
+                                      MachineOptimizationRemarkEmitter &MORE,
+                                      bool SelectPHIs = true);
+
+  /// Finish the selection of \p MF once all of \p SelectedBlocks have been
+  /// selected: clear the other blocks, which are unreachable, remove the
+  /// copies that selection made redundant and finalize the lowering.
+  /// \return True on success, false otherwise, after reporting the failure.
+  static bool
+  finishSelection(MachineFunction &MF,
+                  const DenseSet<MachineBasicBlock *> &SelectedBlocks,
+                  const TargetPassConfig &TPC,
+                  MachineOptimizationRemarkEmitter &MORE);
+
+  /// Write the rules covered by selecting \p MF, as recorded in
+  /// \p CoverageInfo, to the file given by -gisel-coverage-prefix.
+  static void emitCoverage(const MachineFunction &MF,
+                           const CodeGenCoverage &CoverageInfo);
+
 protected:
   BlockFrequencyInfo *BFI = nullptr;
   ProfileSummaryInfo *PSI = nullptr;
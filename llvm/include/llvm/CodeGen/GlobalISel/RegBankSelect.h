@@ -517,9 +517,6 @@ private:
   /// \return True on success, false otherwise.
   bool assignInstr(MachineInstr &MI);
 
-  /// Initialize the field members using \p MF.
-  void init(MachineFunction &MF);
-
   /// Check if \p Reg is already assigned what is described by \p ValMapping.
   /// \p OnlyAssign == true means that \p Reg just needs to be assigned a
   /// register bank.  I.e., no repairing is necessary to have the
@@ -615,6 +612,19 @@ private:
                     const RegisterBankInfo::InstructionMapping &InstrMapping,
                     SmallVectorImpl<RepairingPlacement> &RepairPts);
 
+protected:
+  /// Create a pass with the identifier \p PassID that assigns register banks
+  /// like RegBankSelect in the specified \p RunningMode.
+  RegBankSelect(char &PassID, Mode RunningMode);
+
+  /// Initialize the field members using \p MF.
+  void init(MachineFunction &MF);
+
+  /// Assign the register bank of each operand of the instructions of \p MBB,
+  /// in order.
+  /// \return True on success, false otherwise, after reporting the failure.
+  bool assignRegisterBanks(MachineBasicBlock &MBB);
+
 public:
   /// Create a RegBankSelect pass with the specified \p RunningMode.
   RegBankSelect(Mode RunningMode = Fast);
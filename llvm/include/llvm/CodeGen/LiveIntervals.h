@@ -29,8 +29,10 @@
 #include "llvm/CodeGen/TargetRegisterInfo.h"
 #include "llvm/MC/LaneBitmask.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Recycler.h"
 #include <cassert>
 #include <cstdint>
 #include <utility>
@@ -67,6 +69,11 @@ class VirtRegMap;
     /// Live interval pointers for all the virtual registers.
     IndexedMap<LiveInterval*, VirtReg2IndexFunctor> VirtRegIntervals;
 
+    /// The virtual register intervals are allocated from slabs rather than
+    /// one heap block each, and the memory of removed intervals is reused.
+    BumpPtrAllocator LIAllocator;
+    Recycler<LiveInterval> LIRecycler;
+
     /// Sorted list of instructions with register mask operands. Always use the
     /// 'r' slot, RegMasks are normal clobbers, not early clobbers.
     SmallVector<SlotIndex, 8> RegMaskSlots;
@@ -143,7 +150,7 @@ class VirtRegMap;
 
     /// Interval removal.
     void removeInterval(Register Reg) {
-      delete VirtRegIntervals[Reg];
+      freeInterval(VirtRegIntervals[Reg]);
       VirtRegIntervals[Reg] = nullptr;
     }
 
@@ -462,7 +469,8 @@ class VirtRegMap;
     bool computeDeadValues(LiveInterval &LI,
                            SmallVectorImpl<MachineInstr*> *dead);
 
-    static LiveInterval *createInterval(Register Reg);
+    LiveInterval *createInterval(Register Reg);
+    void freeInterval(LiveInterval *LI);
 
     void printInstrs(raw_ostream &O) const;
     void dumpInstrs() const;
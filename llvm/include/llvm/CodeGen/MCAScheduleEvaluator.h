@@ -0,0 +1,78 @@
+//===- MCAScheduleEvaluator.h - Simulate machine schedules ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the MCAScheduleEvaluator class, which lets the machine
+// scheduler compare the throughput of candidate schedules of a region using
+// the pipeline simulation of llvm-mca.
+//
+// It is built as a library of its own, so that LLVMCodeGen does not depend on
+// LLVMMCA.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_MCASCHEDULEEVALUATOR_H
+#define LLVM_CODEGEN_MCASCHEDULEEVALUATOR_H
+
+#include "llvm/CodeGen/MachineScheduleEvaluator.h"
+
+namespace llvm {
+
+class MCInstrAnalysis;
+class Target;
+class TargetSubtargetInfo;
+
+namespace mca {
+class InstrBuilder;
+} // end namespace mca
+
+/// Estimates the number of cycles a sequence of machine instructions takes
+/// by simulating a number of back-to-back executions of it on the llvm-mca
+/// model of the subtarget's pipeline.
+///
+/// This is much more expensive than the TargetSchedModel heuristics, so it
+/// is only meant to be used on the blocks that the profile says are hot.
+class MCAScheduleEvaluator : public MachineScheduleEvaluator {
+  const TargetSubtargetInfo &STI;
+  const Target &TheTarget;
+  const MachineBlockFrequencyInfo &MBFI;
+  ProfileSummaryInfo &PSI;
+  std::unique_ptr<MCInstrAnalysis> MCIA;
+  std::unique_ptr<mca::InstrBuilder> IB;
+  unsigned Iterations;
+
+public:
+  MCAScheduleEvaluator(const MachineFunction &MF,
+                       const MachineBlockFrequencyInfo &MBFI,
+                       ProfileSummaryInfo &PSI, unsigned Iterations);
+  ~MCAScheduleEvaluator() override;
+
+  /// Return true if the subtarget of \p MF has a scheduling model detailed
+  /// enough to be simulated, and the function has profile counts.
+  static bool isSupported(const MachineFunction &MF, ProfileSummaryInfo &PSI);
+
+  /// Return an evaluator of \p MF if isSupported(), null otherwise.
+  static std::unique_ptr<MachineScheduleEvaluator>
+  create(const MachineFunction &MF, const MachineBlockFrequencyInfo &MBFI,
+         ProfileSummaryInfo &PSI, unsigned Iterations);
+
+  /// Return true if the profile count of \p MBB makes it hot enough to be
+  /// worth simulating.
+  bool shouldEvaluate(const MachineBasicBlock &MBB) const override;
+
+  /// Return the number of cycles the simulation of \p Sequence takes, or None
+  /// if some of its instructions cannot be simulated.
+  Optional<unsigned>
+  getCycles(ArrayRef<const MachineInstr *> Sequence) override;
+};
+
+/// Make -post-misched-mca use MCAScheduleEvaluator.
+void registerMCAScheduleEvaluator();
+
+} // end namespace llvm
+
+#endif // LLVM_CODEGEN_MCASCHEDULEEVALUATOR_H
@@ -0,0 +1,61 @@
+//===- MachineScheduleEvaluator.h - Compare machine schedules ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the interface the post-RA machine scheduler uses to
+// compare the throughput of candidate schedules of a region.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_MACHINESCHEDULEEVALUATOR_H
+#define LLVM_CODEGEN_MACHINESCHEDULEEVALUATOR_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include <memory>
+
+namespace llvm {
+
+class MachineBasicBlock;
+class MachineBlockFrequencyInfo;
+class MachineFunction;
+class MachineInstr;
+class ProfileSummaryInfo;
+
+/// Estimates the number of cycles a sequence of machine instructions takes.
+///
+/// CodeGen only knows of this interface. The implementations live in other
+/// libraries, such as the one simulating the llvm-mca pipeline model, and the
+/// tools that link one of them install its factory with setFactory().
+class MachineScheduleEvaluator {
+public:
+  /// Create the evaluator of the regions of \p MF, which simulates
+  /// \p Iterations back-to-back executions of each, or return null if \p MF
+  /// cannot be evaluated.
+  using FactoryFn = std::unique_ptr<MachineScheduleEvaluator> (*)(
+      const MachineFunction &MF, const MachineBlockFrequencyInfo &MBFI,
+      ProfileSummaryInfo &PSI, unsigned Iterations);
+
+  virtual ~MachineScheduleEvaluator();
+
+  /// Return true if \p MBB is worth evaluating.
+  virtual bool shouldEvaluate(const MachineBasicBlock &MBB) const = 0;
+
+  /// Return the number of cycles \p Sequence takes, or None if some of its
+  /// instructions cannot be evaluated.
+  virtual Optional<unsigned>
+  getCycles(ArrayRef<const MachineInstr *> Sequence) = 0;
+
+  /// Set the factory of the evaluators -post-misched-mca uses. This is not
+  /// thread-safe, and is meant to be called once at startup.
+  static void setFactory(FactoryFn Factory);
+  static FactoryFn getFactory();
+};
+
+} // end namespace llvm
+
+#endif // LLVM_CODEGEN_MACHINESCHEDULEEVALUATOR_H
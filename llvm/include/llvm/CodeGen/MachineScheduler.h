@@ -113,6 +113,7 @@ class MachineDominatorTree;
 class MachineFunction;
 class MachineInstr;
 class MachineLoopInfo;
+class MachineScheduleEvaluator;
 class RegisterClassInfo;
 class SchedDFSResult;
 class ScheduleHazardRecognizer;
@@ -129,6 +130,9 @@ struct MachineSchedContext {
   const TargetPassConfig *PassConfig = nullptr;
   AAResults *AA = nullptr;
   LiveIntervals *LIS = nullptr;
+  /// If set, the post-RA scheduler simulates the candidate schedules of hot
+  /// regions with it and keeps the fastest.
+  MachineScheduleEvaluator *MCAEvaluator = nullptr;
 
   RegisterClassInfo *RegClassInfo;
 
@@ -273,6 +277,7 @@ protected:
   AAResults *AA;
   LiveIntervals *LIS;
   std::unique_ptr<MachineSchedStrategy> SchedImpl;
+  MachineScheduleEvaluator *MCAEvaluator;
 
   /// Ordered list of DAG postprocessing steps.
   std::vector<std::unique_ptr<ScheduleDAGMutation>> Mutations;
@@ -297,7 +302,7 @@ public:
   ScheduleDAGMI(MachineSchedContext *C, std::unique_ptr<MachineSchedStrategy> S,
                 bool RemoveKillFlags)
       : ScheduleDAGInstrs(*C->MF, C->MLI, RemoveKillFlags), AA(C->AA),
-        LIS(C->LIS), SchedImpl(std::move(S)) {}
+        LIS(C->LIS), SchedImpl(std::move(S)), MCAEvaluator(C->MCAEvaluator) {}
 
   // Provide a vtable anchor
   ~ScheduleDAGMI() override;
@@ -370,6 +375,10 @@ protected:
   /// Reinsert debug_values recorded in ScheduleDAGInstrs::DbgValues.
   void placeDebugValues();
 
+  /// Restore the region to \p InputOrder if MCAEvaluator finds that it runs
+  /// faster than the schedule that was just made.
+  void keepFasterSchedule(ArrayRef<MachineInstr *> InputOrder);
+
   /// dump the scheduled Sequence.
   void dumpSchedule() const;
 
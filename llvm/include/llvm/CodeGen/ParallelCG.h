@@ -14,6 +14,7 @@
 #define LLVM_CODEGEN_PARALLELCG_H
 
 #include "llvm/Support/CodeGen.h"
+#include "llvm/Support/Error.h"
 #include <functional>
 #include <memory>
 
@@ -32,12 +33,28 @@ class raw_pwrite_stream;
 ///
 /// Writes bitcode for individual partitions into output streams in BCOSs, if
 /// BCOSs is not empty.
+///
+/// The diagnostics of the partitions are passed on, one at a time, to the
+/// diagnostic handler of the context of M.
 void splitCodeGen(
     Module &M, ArrayRef<raw_pwrite_stream *> OSs,
     ArrayRef<llvm::raw_pwrite_stream *> BCOSs,
     const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
     CodeGenFileType FileType = CGFT_ObjectFile, bool PreserveLocals = false);
 
+/// Split M into NumPartitions partitions, generate an object file for each in
+/// parallel as splitCodeGen does, and combine them into the single relocatable
+/// object file written to OS. The local symbols of M, which the split gives
+/// hidden visibility and external linkage, are local symbols of the combined
+/// object again, so that it is equivalent to the object file code generated
+/// from M. Only ELF targets other than MIPS are supported. If the objects of
+/// the partitions can't be combined, such as when they need section indices of
+/// SHN_LORESERVE or more, the split is undone and M is code generated as a
+/// whole instead.
+Error splitCodeGenToObject(
+    Module &M, unsigned NumPartitions, raw_pwrite_stream &OS,
+    const std::function<std::unique_ptr<TargetMachine>()> &TMFactory);
+
 } // namespace llvm
 
 #endif
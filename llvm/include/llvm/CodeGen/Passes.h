@@ -153,6 +153,9 @@ namespace llvm {
   /// Basic register allocator.
   extern char &RABasicID;
 
+  /// Linear scan register allocator.
+  extern char &RALinearScanID;
+
   /// VirtRegRewriter pass. Rewrite virtual registers to physical registers as
   /// assigned in VirtRegMap.
   extern char &VirtRegRewriterID;
@@ -190,6 +193,14 @@ namespace llvm {
   FunctionPass *createBasicRegisterAllocator();
   FunctionPass *createBasicRegisterAllocator(RegClassFilterFunc F);
 
+  /// LinearScanRegisterAllocation Pass - This pass allocates live ranges in
+  /// order of their start points, evicting, splitting around blocks and
+  /// spilling when it runs out of registers. It is much cheaper than the
+  /// greedy allocator and produces much better code than the fast one.
+  ///
+  FunctionPass *createLinearScanRegisterAllocator();
+  FunctionPass *createLinearScanRegisterAllocator(RegClassFilterFunc F);
+
   /// Greedy register allocation pass - This pass implements a global register
   /// allocator for optimized builds.
   ///
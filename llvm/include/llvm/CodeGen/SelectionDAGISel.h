@@ -14,6 +14,8 @@
 #ifndef LLVM_CODEGEN_SELECTIONDAGISEL_H
 #define LLVM_CODEGEN_SELECTIONDAGISEL_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/IR/BasicBlock.h"
@@ -361,6 +363,17 @@ private:
   /// state machines that start with a OPC_SwitchOpcode node.
   std::vector<unsigned> OpcodeOffset;
 
+  /// MatchCache - With -isel-match-cache, maps the shape of a node that was
+  /// selected before in the current function to the index of the outermost
+  /// Scope its match went through and to the index of the child of that Scope
+  /// that matched. Only matches whose failed checks all read the node shape
+  /// are recorded.
+  DenseMap<hash_code, std::pair<unsigned, unsigned>> MatchCache;
+
+  /// Set while a node is rematched without the cache because the child the
+  /// cache suggested, and the ones after it, failed to match.
+  bool InMatchCacheFallback = false;
+
   void UpdateChains(SDNode *NodeToMatch, SDValue InputChain,
                     SmallVectorImpl<SDNode *> &ChainNodesMatched,
                     bool isMorphNodeTo);
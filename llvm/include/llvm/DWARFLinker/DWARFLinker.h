@@ -299,6 +299,10 @@ public:
   /// Use specified number of threads for parallel files linking.
   void setNumThreads(unsigned NumThreads) { Options.Threads = NumThreads; }
 
+  /// Limit the memory held by objects that have been analyzed but not yet
+  /// cloned to approximately \p Bytes. Zero means no limit.
+  void setMemoryBudget(uint64_t Bytes) { Options.MemoryBudget = Bytes; }
+
   /// Set kind of accelerator tables to be generated.
   void setAccelTableKind(AccelTableKind Kind) {
     Options.TheAccelTableKind = Kind;
@@ -438,6 +442,20 @@ private:
     UnitListTy CompileUnits;
     bool Skip = false;
 
+    /// True if no compile unit of this object takes part in ODR uniquing.
+    /// Analyzing and marking such an object neither reads nor writes the
+    /// shared DeclContextTree, so it can be done concurrently with other
+    /// objects and in any order.
+    bool IsODRIndependent = false;
+
+    /// Unique ID of the first compile unit of this object.
+    unsigned FirstUnitID = 0;
+
+    /// Parseable Swift interfaces found in this object when objects are
+    /// analyzed concurrently. They are merged into
+    /// DWARFLinkerOptions::ParseableSwiftInterfaces in object order.
+    swiftInterfacesMap SwiftInterfaces;
+
     LinkContext(DWARFFile &File) : File(File) {}
 
     /// Clear part of the context that's no longer needed when we're done with
@@ -810,6 +828,10 @@ private:
     /// Number of threads.
     unsigned Threads = 1;
 
+    /// Soft limit, in bytes, on the parsed debug info held by objects that
+    /// have been analyzed but not yet cloned. Zero means no limit.
+    uint64_t MemoryBudget = 0;
+
     /// The accelerator table kind
     AccelTableKind TheAccelTableKind = AccelTableKind::Default;
 
@@ -87,14 +87,19 @@ public:
       HasODR = false;
       return;
     }
+    HasODR = CanUseODR && isODRLanguage(CUDie);
+  }
+
+  /// Returns true if the language of the unit described by \p CUDie has the
+  /// one definition rule, so that its types can be uniqued across units.
+  static bool isODRLanguage(const DWARFDie &CUDie) {
     if (auto Lang = dwarf::toUnsigned(CUDie.find(dwarf::DW_AT_language)))
-      HasODR = CanUseODR && (*Lang == dwarf::DW_LANG_C_plus_plus ||
-                             *Lang == dwarf::DW_LANG_C_plus_plus_03 ||
-                             *Lang == dwarf::DW_LANG_C_plus_plus_11 ||
-                             *Lang == dwarf::DW_LANG_C_plus_plus_14 ||
-                             *Lang == dwarf::DW_LANG_ObjC_plus_plus);
-    else
-      HasODR = false;
+      return *Lang == dwarf::DW_LANG_C_plus_plus ||
+             *Lang == dwarf::DW_LANG_C_plus_plus_03 ||
+             *Lang == dwarf::DW_LANG_C_plus_plus_11 ||
+             *Lang == dwarf::DW_LANG_C_plus_plus_14 ||
+             *Lang == dwarf::DW_LANG_ObjC_plus_plus;
+    return false;
   }
 
   DWARFUnit &getOrigUnit() const { return OrigUnit; }
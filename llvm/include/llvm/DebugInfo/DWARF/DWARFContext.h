@@ -333,6 +333,10 @@ public:
   getLineTableForUnit(DWARFUnit *U,
                       function_ref<void(Error)> RecoverableErrorHandler);
 
+  /// Drop the parsed line table of a compile unit, if there is one, to keep
+  /// memory usage low. It is parsed again by the next getLineTableForUnit.
+  void clearLineTableForUnit(DWARFUnit *U);
+
   DataExtractor getStringExtractor() const {
     return DataExtractor(DObj->getStrSection(), false, 0);
   }
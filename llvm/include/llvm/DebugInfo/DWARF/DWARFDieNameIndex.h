@@ -0,0 +1,97 @@
+//===- DWARFDieNameIndex.h --------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_DEBUGINFO_DWARF_DWARFDIENAMEINDEX_H
+#define LLVM_DEBUGINFO_DWARF_DWARFDIENAMEINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/DebugInfo/DWARF/DWARFDie.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Threading.h"
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace llvm {
+
+class DWARFContext;
+class raw_ostream;
+
+/// An in-memory index from names to the debug info entries of the normal
+/// (non-DWO) units of a DWARFContext that carry them.
+///
+/// This is meant for binaries that have no accelerator tables, or whose
+/// tables are incomplete. A DIE is indexed under its short name and its
+/// linkage name, as returned by DWARFDie::getShortName and
+/// DWARFDie::getLinkageName, so lookups find the same DIEs as a walk over
+/// all units that compares those names. The index is built with multiple
+/// threads and can be saved to a side file so that later runs on the same
+/// binary can skip building it.
+class DWARFDieNameIndex {
+public:
+  /// A reference to an indexed DIE: the index of its unit in
+  /// DWARFContext::normal_units() and its index within that unit.
+  struct Entry {
+    uint32_t UnitIndex;
+    uint32_t DieIndex;
+
+    friend bool operator<(const Entry &LHS, const Entry &RHS) {
+      return std::tie(LHS.UnitIndex, LHS.DieIndex) <
+             std::tie(RHS.UnitIndex, RHS.DieIndex);
+    }
+    friend bool operator==(const Entry &LHS, const Entry &RHS) {
+      return LHS.UnitIndex == RHS.UnitIndex && LHS.DieIndex == RHS.DieIndex;
+    }
+  };
+
+  /// Build the index for the normal units of \p Ctx. The DIEs of different
+  /// units are extracted and scanned for names concurrently, using a thread
+  /// pool created with strategy \p S. The result does not depend on the
+  /// number of threads.
+  ///
+  /// This extracts the DIEs of every normal unit of \p Ctx, which must not
+  /// be used by other threads while the index is being built.
+  static DWARFDieNameIndex build(DWARFContext &Ctx,
+                                 ThreadPoolStrategy S = hardware_concurrency());
+
+  /// Read an index previously written by write() for the same binary. Fails
+  /// if \p Data is malformed or if it does not match the units of \p Ctx.
+  static Expected<DWARFDieNameIndex> read(DWARFContext &Ctx, StringRef Data);
+
+  /// Write the index to \p OS in a form that read() accepts.
+  void write(raw_ostream &OS) const;
+
+  /// Return the DIEs indexed under \p Name, ordered by unit and then by
+  /// their position in the unit.
+  ArrayRef<Entry> lookup(StringRef Name) const;
+
+  /// Return the DIE that \p E refers to in \p Ctx, or an invalid DIE if
+  /// there is no such DIE.
+  static DWARFDie getDIE(DWARFContext &Ctx, Entry E);
+
+  /// Return the number of distinct names in the index.
+  size_t getNumNames() const { return Names.size(); }
+
+private:
+  /// A summary of the layout of the normal units, used to detect side files
+  /// that were written for a different binary.
+  struct UnitsSignature {
+    uint32_t NumUnits = 0;
+    uint64_t TotalLength = 0;
+
+    static UnitsSignature get(DWARFContext &Ctx);
+  };
+
+  UnitsSignature Signature;
+  StringMap<std::vector<Entry>> Names;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_DEBUGINFO_DWARF_DWARFDIENAMEINDEX_H
@@ -92,6 +92,23 @@ private:
   raw_ostream &note() const;
   raw_ostream &dump(const DWARFDie &Die, unsigned indent = 0) const;
 
+  /// Runs \p Task for each index in [0, NumTasks) and returns the sum of the
+  /// errors it reports. If DumpOpts.VerifyThreads allows it, the tasks run in
+  /// parallel, each with a verifier that writes to its own buffer; the
+  /// buffers are printed to OS in task order, so the output is the same as
+  /// that of a serial run.
+  unsigned
+  verifyInParallel(size_t NumTasks,
+                   function_ref<unsigned(DWARFVerifier &, size_t)> Task);
+
+  /// Whether verifyInParallel may run tasks on more than one thread.
+  bool isParallel() const;
+
+  /// Parses everything that DWARFContext and DWARFUnit otherwise compute
+  /// lazily and that parallel tasks may reach: the unit vectors, the
+  /// abbreviations and DIEs of every unit and their line tables.
+  void prepareForParallelVerification();
+
   /// Verifies the abbreviations section.
   ///
   /// This function currently checks that:
@@ -20,6 +20,7 @@
 #include "llvm/DebugInfo/Symbolize/DIFetcher.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cstdint>
 #include <map>
@@ -62,6 +63,7 @@ public:
     std::string FallbackDebugPath;
     std::string DWPName;
     std::vector<std::string> DebugFileDirectory;
+    std::string GsymCacheDirectory;
     size_t MaxCacheSize =
         sizeof(size_t) == 4
             ? 512 * 1024 * 1024 /* 512 MiB */
@@ -104,6 +106,18 @@ public:
   Expected<std::vector<DILocal>>
   symbolizeFrame(ArrayRef<uint8_t> BuildID,
                  object::SectionedAddress ModuleOffset);
+
+  // Symbolize each (module name, offset) pair of Requests as symbolizeCode
+  // would, and return the results in the same order. The requests are grouped
+  // by module and sorted by offset, and different modules are queried
+  // concurrently on a thread pool created with strategy S. Modules are still
+  // loaded one at a time on the calling thread, and the binary cache is pruned
+  // as needed to stay under the maximum size given in the options, which can
+  // invalidate references in previously returned DI... objects.
+  std::vector<Expected<DILineInfo>> symbolizeCodeBatch(
+      ArrayRef<std::pair<std::string, object::SectionedAddress>> Requests,
+      ThreadPoolStrategy S = hardware_concurrency());
+
   void flush();
 
   // Evict entries from the binary cache until it is under the maximum size
@@ -128,6 +142,8 @@ private:
   Expected<DILineInfo>
   symbolizeCodeCommon(const T &ModuleSpecifier,
                       object::SectionedAddress ModuleOffset);
+  DILineInfo symbolizeCodeInModule(SymbolizableModule *Info,
+                                   object::SectionedAddress ModuleOffset);
   template <typename T>
   Expected<DIInliningInfo>
   symbolizeInlinedCodeCommon(const T &ModuleSpecifier,
@@ -158,6 +174,12 @@ private:
   createModuleInfo(const ObjectFile *Obj, std::unique_ptr<DIContext> Context,
                    StringRef ModuleName);
 
+  /// Returns a context that answers queries from the GSYM conversion of the
+  /// debug info in \p Objects, converting it into the GSYM cache directory
+  /// first if needed. Returns nullptr if the objects have no build ID or
+  /// UUID to key the cache entry, or if the conversion fails.
+  std::unique_ptr<DIContext> getOrCreateGsymContext(const ObjectPair &Objects);
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -0,0 +1,72 @@
+//===-- llvm/Debuginfod/HTTPCacheStore.h - HTTP cache store -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares a RemoteCacheStore which keeps cache entries on an HTTP
+/// server, for use as the remote tier of a tieredCache.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_DEBUGINFOD_HTTPCACHESTORE_H
+#define LLVM_DEBUGINFOD_HTTPCACHESTORE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Caching.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include <chrono>
+#include <future>
+#include <mutex>
+
+namespace llvm {
+
+/// A RemoteCacheStore backed by a plain HTTP server. The entry for a key is
+/// read with GET and written with PUT on <BaseUrl>/<Key>. A 404 response is a
+/// miss. HTTPClient::initialize() must have been called before the store is
+/// used.
+class HTTPCacheStore : public RemoteCacheStore {
+public:
+  HTTPCacheStore(StringRef BaseUrl, std::chrono::milliseconds Timeout,
+                 ThreadPoolStrategy PrefetchParallelism = hardware_concurrency(
+                     8));
+
+  Expected<std::unique_ptr<MemoryBuffer>> get(StringRef Key) override;
+  Error put(StringRef Key, StringRef Data) override;
+
+  /// Starts downloading the entry for \p Key on the prefetch thread pool.
+  void prefetch(StringRef Key) override;
+
+  /// Frees the downloaded entry for \p Key, or drops the download's result if
+  /// it is still running.
+  void discard(StringRef Key) override;
+
+private:
+  Expected<std::unique_ptr<MemoryBuffer>> fetch(StringRef Key);
+  std::string getUrl(StringRef Key) const;
+
+  std::string BaseUrl;
+  std::chrono::milliseconds Timeout;
+
+  /// Guards Pending and Prefetched.
+  std::mutex Mutex;
+  /// Downloads started by prefetch() that neither get() nor discard() has
+  /// consumed yet.
+  StringMap<std::shared_future<void>> Pending;
+  /// Results of completed prefetches, held until get() or discard() releases
+  /// them. A null buffer records a miss; failed prefetches leave no entry, so
+  /// get() retries them.
+  StringMap<std::unique_ptr<MemoryBuffer>> Prefetched;
+
+  /// Declared last so that it is destroyed, and its tasks waited for, before
+  /// the state they write to.
+  ThreadPool PrefetchPool;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_DEBUGINFOD_HTTPCACHESTORE_H
@@ -22,13 +22,15 @@
 
 namespace llvm {
 
-enum class HTTPMethod { GET };
+enum class HTTPMethod { GET, PUT };
 
 /// A stateless description of an outbound HTTP request.
 struct HTTPRequest {
   SmallString<128> Url;
   HTTPMethod Method = HTTPMethod::GET;
   bool FollowRedirects = true;
+  /// The body sent with a PUT request. The data must outlive the request.
+  StringRef Body;
   HTTPRequest(StringRef Url);
 };
 
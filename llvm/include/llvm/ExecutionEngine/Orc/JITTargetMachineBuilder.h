@@ -106,6 +106,9 @@ public:
     return *this;
   }
 
+  /// Get the LLVM CodeGen optimization level.
+  CodeGenOpt::Level getCodeGenOptLevel() const { return OptLevel; }
+
   /// Set subtarget features.
   JITTargetMachineBuilder &setFeatures(StringRef FeatureString) {
     Features = SubtargetFeatures(FeatureString);
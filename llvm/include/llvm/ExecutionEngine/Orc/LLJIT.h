@@ -268,6 +268,7 @@ public:
   CompileFunctionCreator CreateCompileFunction;
   PlatformSetupFunction SetUpPlatform;
   unsigned NumCompileThreads = 0;
+  ObjectCache *ObjCache = nullptr;
 
   /// Called prior to JIT class construcion to fix up defaults.
   Error prepareForConstruction();
@@ -361,6 +362,17 @@ public:
     return impl();
   }
 
+  /// Set an ObjectCache for the default compile function to look objects up
+  /// in before compiling modules, and to store the objects it compiles in.
+  /// See PersistentObjectCache for a cache that outlives the process.
+  ///
+  /// The cache is not owned by the JIT, and must outlive it. It is not used
+  /// if a CompileFunctionCreator has been set.
+  SetterImpl &setObjectCache(ObjectCache *ObjCache) {
+    impl().ObjCache = ObjCache;
+    return impl();
+  }
+
   /// Set an ExecutorProcessControl object.
   ///
   /// If the platform uses ObjectLinkingLayer by default and no
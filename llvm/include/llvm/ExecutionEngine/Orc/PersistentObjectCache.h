@@ -0,0 +1,73 @@
+//===- PersistentObjectCache.h - On-disk cache of JIT'd objects -*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// An ObjectCache that keeps the objects compiled by the JIT in a directory, so
+// that they can be reused by later processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/Error.h"
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace llvm {
+namespace orc {
+
+class JITTargetMachineBuilder;
+
+/// An ObjectCache that stores the relocatable object compiled for each module
+/// in a file of a directory, named after a hash of the module's bitcode and of
+/// the target configuration it was compiled for. A module with the same
+/// contents, compiled for the same target by another process, then loads its
+/// object from the file, which is memory mapped, without running codegen.
+///
+/// The cache is safe to use from concurrent compile threads and processes:
+/// objects are written to a temporary file that is then renamed. Errors while
+/// reading or writing the cache are not reported, and only make the module be
+/// compiled again.
+class PersistentObjectCache : public ObjectCache {
+public:
+  /// Create a cache for the objects compiled with the target configuration of
+  /// \p JTMB in \p CacheDir, which is created if it does not exist.
+  static Expected<std::unique_ptr<PersistentObjectCache>>
+  Create(StringRef CacheDir, const JITTargetMachineBuilder &JTMB);
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Return the key under which the object compiled for \p M is stored, as a
+  /// hexadecimal string.
+  std::string getKey(const Module &M) const;
+
+  /// Return the path of the file that holds the object for \p Key.
+  std::string getObjectPath(StringRef Key) const;
+
+private:
+  PersistentObjectCache(std::string CacheDir, std::string TargetKey)
+      : CacheDir(std::move(CacheDir)), TargetKey(std::move(TargetKey)) {}
+
+  std::string CacheDir;
+  /// The target configuration that goes into the key of each module.
+  std::string TargetKey;
+
+  /// The keys computed by getObject() for the modules being compiled, so that
+  /// notifyObjectCompiled() does not hash them again.
+  std::mutex PendingKeysMutex;
+  DenseMap<const Module *, std::string> PendingKeys;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
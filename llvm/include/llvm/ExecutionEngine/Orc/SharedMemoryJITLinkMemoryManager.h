@@ -0,0 +1,82 @@
+//===- SharedMemoryJITLinkMemoryManager.h - Link into shm -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A JITLinkMemoryManager that links into memory shared with an executor
+// process running on the same host.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYJITLINKMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYJITLINKMEMORYMANAGER_H
+
+#include "llvm/ExecutionEngine/JITLink/JITLinkMemoryManager.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+
+namespace llvm {
+namespace orc {
+
+/// Allocates memory in the executor with a SharedMemoryExecutorMemoryManager,
+/// and maps the same pages in this process, so that JITLink writes the linked
+/// code straight into the executor's memory. Unlike with the
+/// EPCGenericJITLinkMemoryManager, finalization then only sends the
+/// protections and the allocation actions to the executor, not the content.
+///
+/// Memory is reserved and finalized with asynchronous calls, whose results are
+/// run as tasks on the ExecutorProcessControl's dispatcher, so that many graphs
+/// can be linked at the same time.
+///
+/// The executor must run on the same host. Shared memory is only supported on
+/// Unix-like systems other than Android.
+class SharedMemoryJITLinkMemoryManager : public jitlink::JITLinkMemoryManager {
+public:
+  /// Function addresses for memory access.
+  struct SymbolAddrs {
+    ExecutorAddr Allocator;
+    ExecutorAddr Reserve;
+    ExecutorAddr Finalize;
+    ExecutorAddr Deallocate;
+  };
+
+  /// Create a SharedMemoryJITLinkMemoryManager using the
+  /// SharedMemoryExecutorMemoryManager functions in the bootstrap symbols of
+  /// \p EPC.
+  static Expected<std::unique_ptr<SharedMemoryJITLinkMemoryManager>>
+  CreateWithDefaultBootstrapSymbols(ExecutorProcessControl &EPC);
+
+  /// Create a SharedMemoryJITLinkMemoryManager instance from a given set of
+  /// function addrs.
+  SharedMemoryJITLinkMemoryManager(ExecutorProcessControl &EPC, SymbolAddrs SAs)
+      : EPC(EPC), SAs(SAs) {}
+
+  void allocate(const jitlink::JITLinkDylib *JD, jitlink::LinkGraph &G,
+                OnAllocatedFunction OnAllocated) override;
+
+  // Use overloads from base class.
+  using JITLinkMemoryManager::allocate;
+
+  void deallocate(std::vector<FinalizedAlloc> Allocs,
+                  OnDeallocatedFunction OnDeallocated) override;
+
+  // Use overloads from base class.
+  using JITLinkMemoryManager::deallocate;
+
+private:
+  class InFlightAlloc;
+
+  void completeAllocation(ExecutorAddr AllocAddr, StringRef SharedMemoryName,
+                          uint64_t AllocSize, jitlink::BasicLayout BL,
+                          OnAllocatedFunction OnAllocated);
+
+  ExecutorProcessControl &EPC;
+  SymbolAddrs SAs;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYJITLINKMEMORYMANAGER_H
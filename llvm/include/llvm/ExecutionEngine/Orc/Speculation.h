@@ -14,11 +14,13 @@
 #define LLVM_EXECUTIONENGINE_ORC_SPECULATION_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
 #include "llvm/ExecutionEngine/Orc/DebugUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/Support/Debug.h"
+#include <deque>
 #include <mutex>
 #include <type_traits>
 #include <utility>
@@ -65,59 +67,17 @@ public:
   using StubAddrLikelies = DenseMap<TargetFAddr, SymbolNameSet>;
 
 private:
-  void registerSymbolsWithAddr(TargetFAddr ImplAddr,
+  void registerSymbolsWithAddr(TargetFAddr ImplAddr, SymbolStringPtr Target,
                                SymbolNameSet likelySymbols) {
     std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
     GlobalSpecMap.insert({ImplAddr, std::move(likelySymbols)});
+    ImplAddrToSymbol.insert({ImplAddr, std::move(Target)});
   }
 
-  void launchCompile(JITTargetAddress FAddr) {
-    SymbolNameSet CandidateSet;
-    // Copy CandidateSet is necessary, to avoid unsynchronized access to
-    // the datastructure.
-    {
-      std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
-      auto It = GlobalSpecMap.find(FAddr);
-      if (It == GlobalSpecMap.end())
-        return;
-      CandidateSet = It->getSecond();
-    }
-
-    SymbolDependenceMap SpeculativeLookUpImpls;
-
-    for (auto &Callee : CandidateSet) {
-      auto ImplSymbol = AliaseeImplTable.getImplFor(Callee);
-      // try to distinguish already compiled & library symbols
-      if (!ImplSymbol.hasValue())
-        continue;
-      const auto &ImplSymbolName = ImplSymbol.getPointer()->first;
-      JITDylib *ImplJD = ImplSymbol.getPointer()->second;
-      auto &SymbolsInJD = SpeculativeLookUpImpls[ImplJD];
-      SymbolsInJD.insert(ImplSymbolName);
-    }
+  void launchCompile(JITTargetAddress FAddr);
 
-    DEBUG_WITH_TYPE("orc", {
-      for (auto &I : SpeculativeLookUpImpls) {
-        llvm::dbgs() << "\n In " << I.first->getName() << " JITDylib ";
-        for (auto &N : I.second)
-          llvm::dbgs() << "\n Likely Symbol : " << N;
-      }
-    });
-
-    // for a given symbol, there may be no symbol qualified for speculatively
-    // compile try to fix this before jumping to this code if possible.
-    for (auto &LookupPair : SpeculativeLookUpImpls)
-      ES.lookup(
-          LookupKind::Static,
-          makeJITDylibSearchOrder(LookupPair.first,
-                                  JITDylibLookupFlags::MatchAllSymbols),
-          SymbolLookupSet(LookupPair.second), SymbolState::Ready,
-          [this](Expected<SymbolMap> Result) {
-            if (auto Err = Result.takeError())
-              ES.reportError(std::move(Err));
-          },
-          NoDependenciesToRegister);
-  }
+  // Issue lookups for the pending speculations, as long as the budget allows.
+  void issueSpeculativeLookups();
 
 public:
   Speculator(ImplSymbolMap &Impl, ExecutionSession &ref)
@@ -136,17 +96,57 @@ public:
   // destination of __orc_speculate_for jump
   void speculateFor(TargetFAddr StubAddr) { launchCompile(StubAddr); }
 
+  /// Limit the number of speculative compiles in flight to \p MaxInFlight, so
+  /// that speculation keeps at most that many of the dispatcher's threads
+  /// busy. Zero, the default, means no limit.
+  void setSpeculationBudget(unsigned MaxInFlight) {
+    std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+    SpeculationBudget = MaxInFlight;
+  }
+
+  /// Record the order in which functions are first entered, for
+  /// saveCallTrace. This must be enabled before the modules are added: it
+  /// makes the IRSpeculationLayer instrument every function.
+  void enableCallTraceRecording() {
+    std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+    RecordTrace = true;
+  }
+
+  /// Write the call trace recorded in this run to \p Path, one symbol name
+  /// per line.
+  Error saveCallTrace(StringRef Path);
+
+  /// Load a call trace written by saveCallTrace in an earlier run. The next
+  /// \p Lookahead functions entered after a function in the trace are then
+  /// speculatively compiled when that function is entered.
+  Error loadCallTrace(StringRef Path, unsigned Lookahead = 4);
+
+  /// Returns true if the function \p Target should be instrumented even if
+  /// the speculation query found no likely callees for it.
+  bool shouldInstrument(const SymbolStringPtr &Target) {
+    std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+    return RecordTrace || TraceLikelies.count(Target);
+  }
+
   // FIXME : Register with Stub Address, after JITLink Fix.
   void registerSymbols(FunctionCandidatesMap Candidates, JITDylib *JD) {
     for (auto &SymPair : Candidates) {
       auto Target = SymPair.first;
       auto Likely = SymPair.second;
 
+      // Add the functions that followed this one in a recorded trace.
+      {
+        std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+        auto It = TraceLikelies.find(Target);
+        if (It != TraceLikelies.end())
+          Likely.insert(It->second.begin(), It->second.end());
+      }
+
       auto OnReadyFixUp = [Likely, Target,
                            this](Expected<SymbolMap> ReadySymbol) {
         if (ReadySymbol) {
           auto RAddr = (*ReadySymbol)[Target].getAddress();
-          registerSymbolsWithAddr(RAddr, std::move(Likely));
+          registerSymbolsWithAddr(RAddr, Target, std::move(Likely));
         } else
           this->getES().reportError(ReadySymbol.takeError());
       };
@@ -167,6 +167,18 @@ private:
   ImplSymbolMap &AliaseeImplTable;
   ExecutionSession &ES;
   StubAddrLikelies GlobalSpecMap;
+
+  using SpeculationTarget = std::pair<JITDylib *, SymbolStringPtr>;
+  std::deque<SpeculationTarget> PendingSpeculations;
+  DenseSet<SpeculationTarget> QueuedSpeculations;
+  unsigned SpeculationBudget = 0;
+  unsigned InFlightSpeculations = 0;
+  bool IssuingLookups = false;
+
+  bool RecordTrace = false;
+  DenseMap<TargetFAddr, SymbolStringPtr> ImplAddrToSymbol;
+  std::vector<SymbolStringPtr> RecordedTrace;
+  FunctionCandidatesMap TraceLikelies;
 };
 
 class IRSpeculationLayer : public IRLayer {
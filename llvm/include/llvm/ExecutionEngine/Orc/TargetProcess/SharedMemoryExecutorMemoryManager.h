@@ -0,0 +1,81 @@
+//===----------- SharedMemoryExecutorMemoryManager.h ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// An executor-side allocator that hands out shared memory, for controllers
+// running on the same host to write the linked code into directly.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_TARGETPROCESS_SHAREDMEMORYEXECUTORMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_ORC_TARGETPROCESS_SHAREDMEMORYEXECUTORMEMORYMANAGER_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/Orc/Shared/ExecutorAddress.h"
+#include "llvm/ExecutionEngine/Orc/Shared/TargetProcessControlTypes.h"
+#include "llvm/ExecutionEngine/Orc/Shared/WrapperFunctionUtils.h"
+#include "llvm/ExecutionEngine/Orc/TargetProcess/ExecutorBootstrapService.h"
+#include "llvm/Support/Error.h"
+
+#include <mutex>
+#include <string>
+
+namespace llvm {
+namespace orc {
+namespace rt_bootstrap {
+
+/// Page-based allocator backed by named shared memory objects.
+///
+/// Each reservation is a new shared memory object, which the controller maps
+/// too and links into. Finalization then only has to apply the protections and
+/// run the allocation actions: unlike SimpleExecutorMemoryManager, the content
+/// of the segments is not sent over the transport.
+class SharedMemoryExecutorMemoryManager : public ExecutorBootstrapService {
+public:
+  virtual ~SharedMemoryExecutorMemoryManager();
+
+  /// Reserve \p Size bytes, and return their address and the name of the
+  /// shared memory object to map them from.
+  Expected<std::pair<ExecutorAddr, std::string>> reserve(uint64_t Size);
+  Error finalize(tpctypes::FinalizeRequest &FR);
+  Error deallocate(const std::vector<ExecutorAddr> &Bases);
+
+  Error shutdown() override;
+  void addBootstrapSymbols(StringMap<ExecutorAddr> &M) override;
+
+private:
+  struct Allocation {
+    size_t Size = 0;
+    /// The name of the shared memory object, until it is unlinked on
+    /// finalization.
+    std::string SharedMemoryName;
+    std::vector<shared::WrapperFunctionCall> DeallocationActions;
+  };
+
+  using AllocationsMap = DenseMap<void *, Allocation>;
+
+  Error deallocateImpl(void *Base, Allocation &A);
+
+  static llvm::orc::shared::CWrapperFunctionResult
+  reserveWrapper(const char *ArgData, size_t ArgSize);
+
+  static llvm::orc::shared::CWrapperFunctionResult
+  finalizeWrapper(const char *ArgData, size_t ArgSize);
+
+  static llvm::orc::shared::CWrapperFunctionResult
+  deallocateWrapper(const char *ArgData, size_t ArgSize);
+
+  std::mutex M;
+  AllocationsMap Allocations;
+  unsigned NextSharedMemoryId = 0;
+};
+
+} // end namespace rt_bootstrap
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_TARGETPROCESS_SHAREDMEMORYEXECUTORMEMORYMANAGER_H
@@ -0,0 +1,117 @@
+//===--- TieredCompileLayer.h - Recompile hot functions ---------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// An IR layer that compiles modules quickly first, then recompiles the ones
+// whose functions turn out to be hot.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+#define LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/Layer.h"
+#include "llvm/ExecutionEngine/Orc/LazyReexports.h"
+#include "llvm/ExecutionEngine/Orc/Mangling.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+namespace orc {
+
+/// A layer that emits each module in two tiers.
+///
+/// The module is first emitted to the tier-0 layer, typically an IRCompileLayer
+/// compiling at CodeGenOpt::None with FastISel. Each of its functions is called
+/// through a stub, and counts its calls. When a function of the module has been
+/// called HotCallThreshold times, the module is emitted again, on a task of the
+/// ExecutionSession, to the tier-1 layer, typically an IRTransformLayer running
+/// the O2 pipeline in front of an IRCompileLayer compiling at
+/// CodeGenOpt::Default. The stubs of the module's functions are then pointed at
+/// the tier-1 code, which calls the other functions through their stubs too.
+///
+/// Tier-up compiles run on the ExecutionSession's TaskDispatcher, and so only
+/// run in the background if the dispatcher has threads.
+///
+/// The instrumented code calls the runtime that addTieringRuntime() defines.
+///
+/// The tier-1 bitcode of a module is released once the module has tiered up,
+/// or when the resources of the module are removed.
+class TieredCompileLayer : public IRLayer, private ResourceManager {
+public:
+  /// Builder for IndirectStubsManagers.
+  using IndirectStubsManagerBuilder =
+      std::function<std::unique_ptr<IndirectStubsManager>()>;
+
+  /// Construct a TieredCompileLayer.
+  TieredCompileLayer(ExecutionSession &ES, IRLayer &Tier0Layer,
+                     IRLayer &Tier1Layer, LazyCallThroughManager &LCTMgr,
+                     IndirectStubsManagerBuilder BuildIndirectStubsManager,
+                     uint64_t HotCallThreshold = 1000);
+
+  ~TieredCompileLayer();
+
+  /// Define symbols for this layer (__orc_tiered_layer) and the tier-up
+  /// runtime entry point (__orc_tier_up) in the given JITDylib, which must be
+  /// visible from the JITDylibs that modules are added to.
+  Error addTieringRuntime(JITDylib &JD, MangleAndInterner &Mangle);
+
+  /// Emits the given module. This should not be called by clients: it will be
+  /// called by the JIT when a definition added via the add method is requested.
+  void emit(std::unique_ptr<MaterializationResponsibility> R,
+            ThreadSafeModule TSM) override;
+
+private:
+  class TierStubsManager;
+
+  /// The tier-1 version of a module, waiting for its functions to get hot.
+  struct TierUpInfo {
+    JITDylib *JD = nullptr;
+    TierStubsManager *ISMgr = nullptr;
+    /// The bitcode of the tier-1 module.
+    SmallVector<char, 0> Bitcode;
+    /// The stub and the tier-1 symbol of each function of the module.
+    std::vector<std::pair<SymbolStringPtr, SymbolStringPtr>> Stubs;
+  };
+
+  static void tierUpEntryPoint(TieredCompileLayer *Layer, uint64_t ModuleId);
+
+  TierStubsManager &getISManager(JITDylib &JD);
+
+  void tierUp(uint64_t ModuleId);
+
+  void emitTier1(TierUpInfo Info);
+
+  Error handleRemoveResources(ResourceKey K) override;
+  void handleTransferResources(ResourceKey DstK, ResourceKey SrcK) override;
+
+  std::mutex TieredLayerMutex;
+
+  IRLayer &Tier0Layer;
+  IRLayer &Tier1Layer;
+  LazyCallThroughManager &LCTMgr;
+  IndirectStubsManagerBuilder BuildIndirectStubsManager;
+  uint64_t HotCallThreshold;
+  std::map<const JITDylib *, std::unique_ptr<TierStubsManager>> ISMgrs;
+  /// The modules that have not tiered up yet, by id.
+  DenseMap<uint64_t, TierUpInfo> TierUps;
+  /// The ids of the modules that each resource key is responsible for.
+  DenseMap<ResourceKey, std::vector<uint64_t>> ModuleIds;
+  uint64_t NextModuleId = 0;
+  SymbolLinkagePromoter PromoteSymbols;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
@@ -36,6 +36,7 @@ template <typename T> class SmallVectorImpl;
 template <typename T> class StringMapEntry;
 class StringRef;
 class Twine;
+class UserArena;
 class LLVMRemarkStreamer;
 
 namespace remarks {
@@ -323,6 +324,29 @@ public:
   /// Whether typed pointers are supported. If false, all pointers are opaque.
   bool supportsTypedPointers() const;
 
+  /// Whether the Users created in this context inside a UserArenaScope are
+  /// allocated from a recycling arena owned by the context.
+  bool shouldUseUserArena() const;
+
+  /// Set whether this context allocates its Users from an arena. Memory in
+  /// the arena is reused for later Users of a similar size, and is only given
+  /// back to the system when the context is destroyed.
+  void setUseUserArena(bool Enable);
+
+  /// Whether the uniquing tables of this context are guarded by locks, so
+  /// that several threads may look up and create types, attributes, constants,
+  /// inline asm and metadata at the same time. The names of values without a
+  /// symbol table, operand bundle tags, sync scopes and GC names are guarded
+  /// as well.
+  bool hasConcurrentUniquing() const;
+
+  /// Enable or disable the locks guarding the uniquing tables. This must only
+  /// be called while a single thread uses the context. It does not make the
+  /// rest of the context thread-safe: the use lists of constants and globals
+  /// shared between threads, for instance, still must not be changed
+  /// concurrently.
+  void setConcurrentUniquing(bool Enable);
+
   /// Optionally target-spcific data can be attached to the context for lifetime
   /// management and bypassing layering restrictions.
   llvm::Any &getTargetData() const;
@@ -339,6 +363,19 @@ private:
   void removeModule(Module*);
 };
 
+/// Makes the Users created during its lifetime come from the arena of \p C,
+/// if C uses one (see LLVMContext::setUseUserArena). Everything created in the
+/// scope must belong to C. Scopes may be nested, also for different contexts.
+class UserArenaScope {
+  UserArena *Prev;
+
+public:
+  explicit UserArenaScope(LLVMContext &C);
+  UserArenaScope(const UserArenaScope &) = delete;
+  UserArenaScope &operator=(const UserArenaScope &) = delete;
+  ~UserArenaScope();
+};
+
 // Create wrappers for C Binding types (see CBindingWrapping.h).
 DEFINE_SIMPLE_CONVERSION_FUNCTIONS(LLVMContext, LLVMContextRef)
 
@@ -48,6 +48,16 @@ class User : public Value {
   LLVM_ATTRIBUTE_ALWAYS_INLINE static void *
   allocateFixedOperandUser(size_t, unsigned, unsigned);
 
+  /// Allocate \p Size bytes for a User and its operands, from the current
+  /// UserArena if there is one.
+  static void *allocateStorage(size_t Size, bool &IsArenaAllocated);
+
+  /// Return the start of the memory allocated for this User.
+  void *getStorage();
+
+  /// Whether Users are currently allocated from the arena of \p C.
+  static bool isArenaOf(LLVMContext &C);
+
 protected:
   /// Allocate a User with an operand pointer co-allocated.
   ///
@@ -73,6 +83,8 @@ protected:
   User(Type *ty, unsigned vty, Use *, unsigned NumOps)
       : Value(ty, vty) {
     assert(NumOps < (1u << NumUserOperandsBits) && "Too many operands");
+    assert((!IsArenaAllocated || isArenaOf(getContext())) &&
+           "User allocated from the arena of another context");
     NumUserOperands = NumOps;
     // If we have hung off uses, then the operand list should initially be
     // null.
@@ -110,7 +110,7 @@ protected:
   ///
   /// Note, this should *NOT* be used directly by any class other than User.
   /// User uses this value to find the Use list.
-  enum : unsigned { NumUserOperandsBits = 27 };
+  enum : unsigned { NumUserOperandsBits = 26 };
   unsigned NumUserOperands : NumUserOperandsBits;
 
   // Use the same type as the bitfield above so that MSVC will pack them.
@@ -119,6 +119,7 @@ protected:
   unsigned HasMetadata : 1; // Has metadata attached to this?
   unsigned HasHungOffUses : 1;
   unsigned HasDescriptor : 1;
+  unsigned IsArenaAllocated : 1; // Allocated from a context's UserArena?
 
 private:
   template <typename UseT> // UseT == 'Use' or 'const Use'
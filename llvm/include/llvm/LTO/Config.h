@@ -22,6 +22,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/CodeGen.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Target/TargetOptions.h"
 
 #include <functional>
@@ -165,6 +166,11 @@ struct Config {
   /// Specific thinLTO modules to compile.
   std::vector<std::string> ThinLTOModulesToCompile;
 
+  /// Parallelism of the thin link: reading the summaries of the ThinLTO
+  /// modules into the combined index, and computing the cross-module imports.
+  /// The combined index and the import lists do not depend on it.
+  ThreadPoolStrategy ThinLinkParallelism = hardware_concurrency(1);
+
   /// Time trace enabled.
   bool TimeTraceEnabled = false;
 
@@ -248,6 +254,13 @@ struct Config {
       const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols)>;
   CombinedIndexHookFn CombinedIndexHook;
 
+  /// If set, this hook is called on the thread driving the link with the cache
+  /// key of each in-process ThinLTO backend task, before the task is scheduled.
+  /// A cache with a high-latency tier can use it to start fetching the entries
+  /// a link will need that its local tier lacks (see
+  /// RemoteCacheStore::prefetch).
+  std::function<void(StringRef Key)> CachePrefetchHook;
+
   /// This is a convenience function that configures this Config object to write
   /// temporary files named after the given OutputFileName for each of the LTO
   /// phases to disk. A client can use this function to implement -save-temps.
@@ -197,7 +197,13 @@ using ThinBackend = std::function<std::unique_ptr<ThinBackendProc>(
 
 /// This ThinBackend runs the individual backend jobs in-process.
 /// The default value means to use one job per hardware core (not hyper-thread).
-ThinBackend createInProcessThinBackend(ThreadPoolStrategy Parallelism);
+///
+/// If \p MemoryBudget is nonzero, a backend job only starts while the
+/// estimated peak memory of the running jobs, derived from the instruction
+/// counts in the function summaries, stays within \p MemoryBudget bytes. A job
+/// whose estimate alone exceeds the budget runs by itself.
+ThinBackend createInProcessThinBackend(ThreadPoolStrategy Parallelism,
+                                       uint64_t MemoryBudget = 0);
 
 /// This ThinBackend writes individual module indexes to files, instead of
 /// running the individual backend jobs. This backend is for distributed builds
@@ -315,6 +321,20 @@ private:
     // The bitcode modules to compile, if specified by the LTO Config.
     Optional<ModuleMapType> ModulesToCompile;
     DenseMap<GlobalValue::GUID, StringRef> PrevailingModuleForGUID;
+
+    // A module whose summary has not been read into CombinedIndex yet, along
+    // with the changes the symbol resolutions make to that summary.
+    struct PendingSummary {
+      BitcodeModule BM;
+      uint64_t ModuleId;
+      // Linker redefined symbols (via --wrap or --defsym) that prevail.
+      std::vector<GlobalValue::GUID> LinkerRedefined;
+      // Symbols resolved to a definition in the linkage unit.
+      std::vector<GlobalValue::GUID> FinalDefinitionInLinkageUnit;
+    };
+    // Summaries are read in one batch by readThinLTOSummaries, in input
+    // order.
+    std::vector<PendingSummary> PendingSummaries;
   } ThinLTO;
 
   // The global resolution for a particular (mangled) symbol name. This is in
@@ -397,6 +417,11 @@ private:
   Error addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
                    const SymbolResolution *&ResI, const SymbolResolution *ResE);
 
+  /// Read the pending ThinLTO summaries into the combined index, in parallel
+  /// according to Conf.ThinLinkParallelism, and apply the symbol resolutions
+  /// to them.
+  Error readThinLTOSummaries();
+
   Error runRegularLTO(AddStreamFn AddStream);
   Error runThinLTO(AddStreamFn AddStream, FileCache Cache,
                    const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols);
@@ -0,0 +1,51 @@
+//===- RelocatableLink.h - Combine relocatable object files -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Declares the linkRelocatableObjects function, which combines relocatable
+// object files into a single one.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_OBJECT_RELOCATABLELINK_H
+#define LLVM_OBJECT_RELOCATABLELINK_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBufferRef.h"
+
+namespace llvm {
+
+class raw_ostream;
+
+namespace object {
+
+/// Combines the relocatable ELF objects \p Inputs, which must share their
+/// machine and ABI, into a single relocatable object written to \p OS.
+///
+/// This is meant for objects generated from the partitions of a module, as by
+/// splitCodeGen, and is simpler than a relocatable link by a linker: the
+/// sections of the inputs are copied to the output as is, without merging the
+/// ones with the same name, and the global symbols of the same name are
+/// resolved to a single symbol. The defined symbols named in
+/// \p LocalizedSymbols become local symbols of the output, which undoes the
+/// externalization of the local symbols of a module split into partitions.
+///
+/// Fails with errc::not_supported on inputs this does not support, which are
+/// MIPS objects and links with section indices of SHN_LORESERVE or more, in
+/// the inputs or in the output, so that callers can produce the object some
+/// other way. Fails with other errors on invalid inputs and on symbols defined
+/// more than once.
+Error linkRelocatableObjects(ArrayRef<MemoryBufferRef> Inputs,
+                             const StringSet<> &LocalizedSymbols,
+                             raw_ostream &OS);
+
+} // end namespace object
+} // end namespace llvm
+
+#endif // LLVM_OBJECT_RELOCATABLELINK_H
@@ -15,6 +15,7 @@
 #ifndef LLVM_PASSES_STANDARDINSTRUMENTATIONS_H
 #define LLVM_PASSES_STANDARDINSTRUMENTATIONS_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -25,6 +26,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Transforms/IPO/SampleProfileProbe.h"
 
+#include <chrono>
 #include <string>
 #include <utility>
 
@@ -79,6 +81,48 @@ public:
   void registerCallbacks(PassInstrumentationCallbacks &PIC);
 };
 
+/// Instrumentation that enforces a per-function compile-time budget, set by
+/// -compile-time-budget-ms=.
+///
+/// The time spent in the function and loop passes is charged to the function
+/// they run on. Once a function has used up its budget, it has the
+/// "compile-time-budget-exceeded" attribute while function and loop passes run
+/// on it, which makes expensive passes such as GVN and InstCombine run in
+/// cheaper modes, and the vectorizers and loop unrolling are skipped on it.
+/// Once it has used up twice its budget, no further optional pass runs on it.
+/// Both are reported by an analysis remark.
+class CompileTimeBudgetInstrumentation {
+public:
+  CompileTimeBudgetInstrumentation();
+  CompileTimeBudgetInstrumentation(std::chrono::milliseconds Budget)
+      : Budget(Budget) {}
+  void registerCallbacks(PassInstrumentationCallbacks &PIC);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct FunctionCost {
+    /// The time spent in the passes that have finished running.
+    Clock::duration Spent = Clock::duration::zero();
+    /// When the outermost running pass started, if Running is nonzero.
+    Clock::time_point Start;
+    /// The number of nested passes running on the function.
+    unsigned Running = 0;
+    bool Degraded = false;
+    bool Skipped = false;
+  };
+
+  bool shouldRun(StringRef PassID, Any IR);
+  void startPass(Any IR);
+  void finishPass();
+
+  std::chrono::milliseconds Budget;
+  DenseMap<const Function *, FunctionCost> Costs;
+  /// The functions of the running passes, or null for passes that do not run
+  /// on a function or loop.
+  SmallVector<const Function *, 8> RunningPasses;
+};
+
 struct PrintPassOptions {
   /// Print adaptors and pass managers.
   bool Verbose = false;
@@ -488,6 +532,7 @@ class StandardInstrumentations {
   TimePassesHandler TimePasses;
   OptNoneInstrumentation OptNone;
   OptBisectInstrumentation OptBisect;
+  CompileTimeBudgetInstrumentation CompileTimeBudget;
   PreservedCFGCheckerInstrumentation PreservedCFGChecker;
   IRChangedPrinter PrintChangedIR;
   PseudoProbeVerifier PseudoProbeVerification;
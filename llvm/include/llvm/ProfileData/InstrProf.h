@@ -160,6 +160,24 @@ inline StringRef getInstrProfCounterBiasVarName() {
   return INSTR_PROF_QUOTE(INSTR_PROF_PROFILE_COUNTER_BIAS_VAR);
 }
 
+/// Return the name of the per-thread variable that holds the distance from the
+/// counter section to the calling thread's copy of it.
+inline StringRef getInstrProfThreadCounterBiasVarName() {
+  return INSTR_PROF_QUOTE(INSTR_PROF_PROFILE_THREAD_COUNTER_BIAS_VAR);
+}
+
+/// Return the name of the profile runtime entry point that allocates the
+/// calling thread's copy of the counters.
+inline StringRef getInstrProfThreadCountersAllocFuncName() {
+  return INSTR_PROF_THREAD_COUNTERS_ALLOC_FUNC_STR;
+}
+
+/// Return the name of the per-thread variable that gates the counter updates
+/// of sampled instrumentation.
+inline StringRef getInstrProfSampleGateVarName() {
+  return INSTR_PROF_QUOTE(INSTR_PROF_PROFILE_SAMPLE_GATE_VAR);
+}
+
 /// Return the marker used to separate PGO names during serialization.
 inline StringRef getInstrProfNameSeparator() { return "\01"; }
 
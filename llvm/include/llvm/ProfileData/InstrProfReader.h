@@ -605,6 +605,11 @@ public:
 
   bool functionEntryOnly() const override { return Index->functionEntryOnly(); }
 
+  /// Return true if the profile has memprof data.
+  bool hasMemoryProfile() const {
+    return static_cast<bool>(getProfileKind() & InstrProfKind::MemProf);
+  }
+
   /// Returns a BitsetEnum describing the attributes of the indexed instr
   /// profile.
   InstrProfKind getProfileKind() const override {
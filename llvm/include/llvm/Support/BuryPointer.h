@@ -24,6 +24,14 @@ template <typename T> void BuryPointer(std::unique_ptr<T> Ptr) {
   BuryPointer(Ptr.release());
 }
 
+// Tools that are done with their work can call this right before tearing
+// down their state. From then on, objects that own a lot of memory, such as
+// LLVMContext and lto::LTO, bury it instead of freeing it piece by piece.
+// Nothing is ever freed by these objects after this, so it must not be called
+// while the process still creates and destroys them.
+void enableLeakOnExit();
+bool isLeakOnExitEnabled();
+
 } // namespace llvm
 
 #endif
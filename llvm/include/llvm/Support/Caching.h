@@ -8,7 +8,9 @@
 //
 // This file defines the CachedFileStream and the localCache function, which
 // simplifies caching files on the local filesystem in a directory whose
-// contents are managed by a CachePruningPolicy.
+// contents are managed by a CachePruningPolicy. It also defines the
+// RemoteCacheStore interface and the tieredCache function, which put a shared
+// remote store behind a local cache.
 //
 //===----------------------------------------------------------------------===//
 
@@ -17,6 +19,8 @@
 
 #include "llvm/Support/Error.h"
 
+#include <memory>
+
 namespace llvm {
 
 class MemoryBuffer;
@@ -71,6 +75,45 @@ Expected<FileCache> localCache(
     Twine CacheNameRef, Twine TempFilePrefixRef, Twine CacheDirectoryPathRef,
     AddBufferFn AddBuffer = [](size_t Task, std::unique_ptr<MemoryBuffer> MB) {
     });
+
+/// Returns true if the cache that localCache() keeps in \p CacheDirectoryPath
+/// has an entry for \p Key.
+bool hasLocalCacheEntry(const Twine &CacheDirectoryPath, StringRef Key);
+
+/// Interface to a content-addressed store that backs a local cache, such as a
+/// cache server shared by the machines of a build farm. Keys are the strings
+/// passed to a FileCache. Implementations must be thread safe.
+class RemoteCacheStore {
+public:
+  virtual ~RemoteCacheStore() = default;
+
+  /// Looks up \p Key. Returns nullptr if the store has no entry for it.
+  virtual Expected<std::unique_ptr<MemoryBuffer>> get(StringRef Key) = 0;
+
+  /// Stores \p Data as the entry for \p Key.
+  virtual Error put(StringRef Key, StringRef Data) = 0;
+
+  /// Hints that \p Key will be looked up soon. High-latency stores may start
+  /// fetching the entry in the background so that the later get() does not
+  /// block. The default implementation does nothing.
+  virtual void prefetch(StringRef Key) {}
+
+  /// Hints that \p Key will not be looked up after all, because the local
+  /// tier had it. Stores that prefetch should free what they fetched for it.
+  /// The default implementation does nothing.
+  virtual void discard(StringRef Key) {}
+};
+
+/// Create a two-level cache which consults \p Local first and \p Remote on a
+/// local miss. Remote hits are written through to \p Local, which adds them to
+/// the link. Files produced after a miss in both tiers are committed to
+/// \p Local and then uploaded to \p Remote.
+///
+/// The remote tier is best effort: errors from \p Remote are passed to
+/// \p ReportRemoteError, if set, and are otherwise treated as misses so that
+/// an unreachable server never fails a build.
+FileCache tieredCache(FileCache Local, std::shared_ptr<RemoteCacheStore> Remote,
+                      std::function<void(Error)> ReportRemoteError = nullptr);
 } // namespace llvm
 
 #endif
@@ -1976,6 +1976,20 @@ StringMap<Option *> &getRegisteredOptions(SubCommand &Sub = *TopLevelSubCommand)
 iterator_range<typename SmallPtrSet<SubCommand *, 4>::iterator>
 getRegisteredSubcommands();
 
+/// An argument that set an option.
+struct OptionOccurrence {
+  Option *Opt;
+  std::string ArgName;
+  std::string Value;
+};
+
+/// Use this to get the arguments that set options, in the order in which they
+/// were parsed since the options were last reset.
+///
+/// This interface is useful for clients that must account for the options the
+/// user set, whatever their types, such as caches of optimization results.
+ArrayRef<OptionOccurrence> getOptionOccurrences();
+
 //===----------------------------------------------------------------------===//
 // Standalone command line processing utilities.
 //
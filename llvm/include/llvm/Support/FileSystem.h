@@ -1299,6 +1299,7 @@ private:
 
   void unmapImpl();
   void dontNeedImpl();
+  void dontNeedImpl(size_t Offset, size_t Length);
 
   std::error_code init(sys::fs::file_t FD, uint64_t Offset, mapmode Mode);
 
@@ -1329,6 +1330,11 @@ public:
     copyFrom(mapped_file_region());
   }
   void dontNeed() { dontNeedImpl(); }
+  /// Like dontNeed(), but only for the pages lying entirely within
+  /// [Offset, Offset + Length) of the mapping.
+  void dontNeed(size_t Offset, size_t Length) {
+    dontNeedImpl(Offset, Length);
+  }
 
   size_t size() const;
   char *data() const;
@@ -81,6 +81,10 @@ public:
   /// function should not be called on a writable buffer.
   virtual void dontNeedIfMmap() {}
 
+  /// Like dontNeedIfMmap(), but only for the pages lying entirely within
+  /// [Offset, Offset + Length) of the buffer.
+  virtual void dontNeedIfMmap(size_t Offset, size_t Length) {}
+
   /// Open the specified file as a MemoryBuffer, returning a new MemoryBuffer
   /// if successful, otherwise returning null.
   ///
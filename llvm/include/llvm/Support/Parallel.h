@@ -29,6 +29,22 @@ namespace parallel {
 // initialized before the first use of parallel routines.
 extern ThreadPoolStrategy strategy;
 
+// The kind of executor that runs the tasks spawned by the parallel routines
+// provided by this file.
+enum class ExecutorKind {
+  // A thread pool with a single task stack shared by all worker threads.
+  SharedQueue,
+  // A thread pool in which each worker thread has its own task deque and
+  // steals tasks from the other workers when its own deque is empty.
+  WorkStealing,
+};
+
+// Executor used by the parallel routines provided by this file. Each kind of
+// executor is created on first use with the current strategy, so this may be
+// changed at any time. Tasks go to the executor selected when they are
+// spawned.
+extern ExecutorKind executorKind;
+
 namespace detail {
 
 #if LLVM_ENABLE_THREADS
@@ -0,0 +1,73 @@
+//===- llvm/Support/SuffixArray.h - Array of sorted suffixes ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SuffixArray class.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_SUFFIXARRAY_H
+#define LLVM_SUPPORT_SUFFIXARRAY_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <vector>
+
+namespace llvm {
+
+/// The suffixes of a string of unsigned integers, in lexicographical order,
+/// together with the length of the longest common prefix of each suffix and
+/// the one before it.
+///
+/// The array is built with the SA-IS algorithm described by Ge Nong, Sen
+/// Zhang and Wai Hong Chan in "Two Efficient Algorithms for Linear Suffix
+/// Array Construction", and the longest common prefixes with the algorithm
+/// of Kasai et al. Both take linear time and, unlike a suffix tree, only a few
+/// words of memory per element of the string. The integers of the string are
+/// first renamed to a dense alphabet, using a parallel sort.
+///
+/// This answers the same repeated substring queries as SuffixTree: the
+/// internal nodes of the suffix tree are the intervals of the array over
+/// which the common prefix is at least as long as the node's string.
+class SuffixArray {
+public:
+  /// A repeated substring of the string, as SuffixTree finds them.
+  struct RepeatedSubstring {
+    /// The length of the string.
+    unsigned Length;
+
+    /// The start indices of each occurrence.
+    std::vector<unsigned> StartIndices;
+  };
+
+  /// Construct the suffix array of \p Str.
+  SuffixArray(ArrayRef<unsigned> Str);
+
+  /// The start index of each suffix, in lexicographical order.
+  ArrayRef<unsigned> suffixes() const { return SA; }
+
+  /// The length of the longest common prefix of the suffix at each position
+  /// of suffixes() and of the one before it, or 0 for the first one.
+  ArrayRef<unsigned> longestCommonPrefixes() const { return LCP; }
+
+  /// Return the repeated substrings of at least \p MinLength elements that
+  /// correspond to the internal nodes of the suffix tree of the string.
+  ///
+  /// Each substring is reported once, with the start indices of the suffixes
+  /// that are leaves directly below its node, and only if there are at least
+  /// two of them.
+  std::vector<RepeatedSubstring>
+  getRepeatedSubstrings(unsigned MinLength = 2) const;
+
+private:
+  ArrayRef<unsigned> Str;
+  std::vector<unsigned> SA;
+  std::vector<unsigned> LCP;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_SUFFIXARRAY_H
@@ -13,8 +13,8 @@
 #ifndef LLVM_SUPPORT_TOOLOUTPUTFILE_H
 #define LLVM_SUPPORT_TOOLOUTPUTFILE_H
 
-#include "llvm/ADT/Optional.h"
 #include "llvm/Support/raw_ostream.h"
+#include <memory>
 
 namespace llvm {
 
@@ -43,10 +43,10 @@ class ToolOutputFile {
 
   /// Storage for the stream, if we're owning our own stream. This is
   /// intentionally declared after Installer.
-  Optional<raw_fd_ostream> OSHolder;
+  std::unique_ptr<raw_fd_ostream> OSHolder;
 
   /// The actual stream to use.
-  raw_fd_ostream *OS;
+  raw_fd_ostream *OS = nullptr;
 
 public:
   /// This constructor's arguments are passed to raw_fd_ostream's
@@ -54,6 +54,14 @@ public:
   ToolOutputFile(StringRef Filename, std::error_code &EC,
                  sys::fs::OpenFlags Flags);
 
+  /// If \p Seekable is true, open \p Filename as a raw_fd_stream, which also
+  /// supports reading and seeking. Writers that backpatch their output, like
+  /// the bitcode writer, can then flush it incrementally instead of buffering
+  /// it whole. Falls back to a raw_fd_ostream if the file is not a regular
+  /// file.
+  ToolOutputFile(StringRef Filename, std::error_code &EC,
+                 sys::fs::OpenFlags Flags, bool Seekable);
+
   ToolOutputFile(StringRef Filename, int FD);
 
   /// Return the contained raw_fd_ostream.
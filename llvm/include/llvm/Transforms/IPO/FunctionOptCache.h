@@ -0,0 +1,71 @@
+//===- FunctionOptCache.h - Cache optimized function bodies -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides a function pass that runs a function pass pipeline only
+// on functions it has not seen before. The optimized body of every function
+// is stored in an on-disk cache, keyed by the function's unoptimized IR and
+// by what the pipeline can observe about the rest of the module. When a later
+// compilation presents the same function in the same context again, the
+// cached body is substituted instead of running the pipeline.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_FUNCTIONOPTCACHE_H
+#define LLVM_TRANSFORMS_IPO_FUNCTIONOPTCACHE_H
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/Caching.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+class MemoryBuffer;
+
+/// Runs \c FPM on the functions it visits, reusing the results of earlier
+/// runs from the cache in \c CacheDir.
+///
+/// The cache key covers the function itself, the declarations and attributes
+/// of the globals it refers to, the contents of the constants it reads, the
+/// module's data layout, triple and flags, the library functions available to
+/// the function, the hidden options set on the command line, the pipeline and
+/// \c Context, which should describe anything else the pipeline depends on,
+/// such as the target options. Functions whose optimization may depend on more than that, for
+/// instance because they use internal variables that alias analysis reasons
+/// about module-wide, or because they carry debug info, are always optimized
+/// without the cache.
+class FunctionOptCachePass : public PassInfoMixin<FunctionOptCachePass> {
+public:
+  FunctionOptCachePass(FunctionPassManager FPM, std::string CacheDir,
+                       std::string Context = "");
+
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+
+  void printPipeline(raw_ostream &OS,
+                     function_ref<StringRef(StringRef)> MapClassName2PassName) {
+    FPM.printPipeline(OS, MapClassName2PassName);
+  }
+
+  static bool isRequired() { return true; }
+
+private:
+  FunctionPassManager FPM;
+  std::string CacheDir;
+  std::string Context;
+
+  /// The textual form of \c FPM, computed on first use.
+  std::string PipelineText;
+  Optional<FileCache> Cache;
+  /// The entry found by the last cache lookup.
+  std::unique_ptr<MemoryBuffer> Entry;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_IPO_FUNCTIONOPTCACHE_H
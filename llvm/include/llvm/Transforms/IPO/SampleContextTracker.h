@@ -26,6 +26,7 @@ class CallBase;
 class DILocation;
 class Function;
 class Instruction;
+class Module;
 
 // Internal trie tree representation used for tracking context tree and sample
 // profiles. The path from root node to a given node represents the context of
@@ -105,8 +106,11 @@ public:
   // deterministically.
   using ContextSamplesTy = std::set<FunctionSamples *, ProfileComparer>;
 
+  // When \p M is given, only the contexts that involve one of its functions
+  // are added to the trie, as the others can't be queried while compiling it.
   SampleContextTracker(SampleProfileMap &Profiles,
-                       const DenseMap<uint64_t, StringRef> *GUIDToFuncNameMap);
+                       const DenseMap<uint64_t, StringRef> *GUIDToFuncNameMap,
+                       const Module *M = nullptr);
   // Query context profile for a specific callee with given name at a given
   // call-site. The full context is identified by location of call instruction.
   FunctionSamples *getCalleeContextSamplesFor(const CallBase &Inst,
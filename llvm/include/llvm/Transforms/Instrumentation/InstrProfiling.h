@@ -68,6 +68,13 @@ private:
   // vector of counter load/store pairs to be register promoted.
   std::vector<LoadStorePair> PromotionCandidates;
 
+  // The sample gate of the function being lowered, once it is loaded.
+  Value *FunctionSampleGate = nullptr;
+
+  // The distance to the running thread's counters, in the function being
+  // lowered.
+  Value *FunctionThreadCounterBias = nullptr;
+
   int64_t TotalCountersPromoted = 0;
 
   /// Lower instrumentation intrinsics in the function. Returns true if there
@@ -102,6 +109,14 @@ private:
   /// acts on.
   Value *getCounterAddress(InstrProfInstBase *I);
 
+  /// Emit the load of the distance to the running thread's counters at the
+  /// start of \p F, allocating them if the thread has none yet.
+  Value *emitThreadCounterBias(Function *F);
+
+  /// Return whether the sample gate of the calling thread is set, reading it
+  /// in the entry block of \p F on first use.
+  Value *getSampleGate(Function *F);
+
   /// Get the region counters for an increment, creating them if necessary.
   ///
   /// If the counter array doesn't yet exist, the profile data variables
@@ -82,6 +82,8 @@ bool LLParser::Run(bool UpgradeDebugInfo,
   if (!Context.hasSetOpaquePointersValue())
     setContextOpaquePointers(OPLex, Context);
 
+  UserArenaScope ArenaScope(Context);
+
   // Prime the lexer.
   Lex.Lex();
 
@@ -72,14 +72,18 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <system_error>
@@ -89,6 +93,12 @@
 
 using namespace llvm;
 
+static cl::opt<unsigned> BitcodeReaderThreads(
+    "bitcode-reader-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads decoding function blocks ahead of their "
+             "materialization when reading a whole module (0 = all "
+             "hardware threads)"));
+
 static cl::opt<bool> PrintSummaryGUIDs(
     "print-summary-global-ids", cl::init(false), cl::Hidden,
     cl::desc(
@@ -471,6 +481,200 @@ BitcodeReaderBase::readNameFromStrtab(ArrayRef<uint64_t> Record) {
   return {StringRef(Strtab.data() + Record[0], Record[1]), Record.slice(2)};
 }
 
+//===----------------------------------------------------------------------===//
+// Function block staging
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// The entries of a function block, decoded ahead of its materialization.
+/// Decoding a block only reads the bitstream, so it does not need the
+/// LLVMContext. Records are replayed from their decoded operands, while nested
+/// blocks are still parsed from the stream of the reader.
+class StagedFunctionBlock {
+public:
+  /// Decode the function block whose body starts at \p BitNo with \p Cursor.
+  static Expected<StagedFunctionBlock> decode(BitstreamCursor &Cursor,
+                                              uint64_t BitNo);
+
+  /// Return the next entry of the block. \p Stream is moved to the start of
+  /// nested blocks so they can be parsed from it, and past the end of the
+  /// function block once it is reached.
+  Expected<BitstreamEntry> advance(BitstreamCursor &Stream);
+
+  /// Read the record returned by the last call to advance, and return its
+  /// code.
+  unsigned readRecord(SmallVectorImpl<uint64_t> &Record);
+
+private:
+  struct Entry {
+    decltype(BitstreamEntry::Kind) Kind;
+    /// The code of a record, or the ID of a nested block.
+    unsigned ID;
+    /// The number of operands of a record.
+    unsigned NumOps;
+    /// The index of the first operand of a record in Ops. For nested blocks
+    /// and the end of the block, the bit at which the stream resumes.
+    uint64_t Offset;
+  };
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+  size_t NextEntry = 0;
+};
+
+/// Decodes function blocks on a thread pool, ahead of the materialization of
+/// their functions. The functions are expected to be materialized in about
+/// the order they were given in, and only a bounded window of blocks ahead of
+/// the last materialized one are decoded, to bound the memory held by the
+/// staged records.
+class FunctionBlockStager {
+public:
+  FunctionBlockStager(const BitstreamCursor &Stream,
+                      ArrayRef<std::pair<Function *, uint64_t>> Blocks,
+                      unsigned NumThreads);
+
+  /// Return the staged block of \p F, waiting for it to be decoded if
+  /// necessary. Returns None if \p F was not given to the stager or its block
+  /// failed to decode, in which case it should be parsed from the stream.
+  Optional<StagedFunctionBlock> take(Function *F);
+
+private:
+  /// Start decoding the blocks up to \p End.
+  void scheduleUpTo(size_t End);
+
+  struct Item {
+    uint64_t BitNo;
+    Optional<StagedFunctionBlock> Block;
+    std::shared_future<void> Decoded;
+  };
+
+  /// A cursor that the cursors of the decoding threads are copied from.
+  BitstreamCursor Stream;
+  std::vector<Item> Items;
+  DenseMap<Function *, size_t> ItemIndices;
+  size_t NumScheduled = 0;
+  size_t WindowSize;
+
+  /// The pool decoding the blocks. This is declared last so that it is
+  /// destroyed, and its tasks finished, before the items they write to.
+  ThreadPool Pool;
+};
+
+} // end anonymous namespace
+
+Expected<StagedFunctionBlock>
+StagedFunctionBlock::decode(BitstreamCursor &Cursor, uint64_t BitNo) {
+  if (Error JumpFailed = Cursor.JumpToBit(BitNo))
+    return std::move(JumpFailed);
+  if (Error Err = Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+    return std::move(Err);
+
+  StagedFunctionBlock Block;
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    uint64_t EntryBitNo = Cursor.GetCurrentBitNo();
+    Expected<BitstreamEntry> MaybeEntry = Cursor.advance();
+    if (!MaybeEntry)
+      return MaybeEntry.takeError();
+    BitstreamEntry Entry = MaybeEntry.get();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      // The stream of the reader reads the end of the block itself, so that
+      // it leaves the block like it would without staging.
+      Block.Entries.push_back({Entry.Kind, 0, 0, EntryBitNo});
+      return std::move(Block);
+    case BitstreamEntry::SubBlock:
+      Block.Entries.push_back(
+          {Entry.Kind, Entry.ID, 0, Cursor.GetCurrentBitNo()});
+      if (Error Err = Cursor.SkipBlock())
+        return std::move(Err);
+      break;
+    case BitstreamEntry::Record: {
+      Record.clear();
+      Expected<unsigned> MaybeCode = Cursor.readRecord(Entry.ID, Record);
+      if (!MaybeCode)
+        return MaybeCode.takeError();
+      Block.Entries.push_back({Entry.Kind, MaybeCode.get(),
+                               static_cast<unsigned>(Record.size()),
+                               Block.Ops.size()});
+      Block.Ops.insert(Block.Ops.end(), Record.begin(), Record.end());
+      break;
+    }
+    }
+  }
+}
+
+Expected<BitstreamEntry>
+StagedFunctionBlock::advance(BitstreamCursor &Stream) {
+  assert(NextEntry < Entries.size() && "advancing past the end of the block");
+  const Entry &E = Entries[NextEntry++];
+  switch (E.Kind) {
+  case BitstreamEntry::SubBlock:
+    if (Error JumpFailed = Stream.JumpToBit(E.Offset))
+      return std::move(JumpFailed);
+    return BitstreamEntry::getSubBlock(E.ID);
+  case BitstreamEntry::EndBlock:
+    if (Error JumpFailed = Stream.JumpToBit(E.Offset))
+      return std::move(JumpFailed);
+    return Stream.advance();
+  default:
+    return BitstreamEntry::getRecord(/*AbbrevID=*/0);
+  }
+}
+
+unsigned StagedFunctionBlock::readRecord(SmallVectorImpl<uint64_t> &Record) {
+  const Entry &E = Entries[NextEntry - 1];
+  assert(E.Kind == BitstreamEntry::Record && "expected a record");
+  Record.append(Ops.begin() + E.Offset, Ops.begin() + E.Offset + E.NumOps);
+  return E.ID;
+}
+
+FunctionBlockStager::FunctionBlockStager(
+    const BitstreamCursor &Stream,
+    ArrayRef<std::pair<Function *, uint64_t>> Blocks, unsigned NumThreads)
+    : Stream(Stream), Pool(hardware_concurrency(NumThreads)) {
+  Items.reserve(Blocks.size());
+  for (const auto &Block : Blocks) {
+    ItemIndices[Block.first] = Items.size();
+    Items.push_back({Block.second, None, {}});
+  }
+  WindowSize = Pool.getThreadCount() * 4;
+  scheduleUpTo(WindowSize);
+}
+
+void FunctionBlockStager::scheduleUpTo(size_t End) {
+  for (End = std::min(End, Items.size()); NumScheduled < End; ++NumScheduled) {
+    Item &I = Items[NumScheduled];
+    // Each task reads with its own copy of the cursor, which shares the block
+    // info and the underlying buffer of the reader.
+    I.Decoded = Pool.async([&I, Cursor = Stream]() mutable {
+      Expected<StagedFunctionBlock> Block =
+          StagedFunctionBlock::decode(Cursor, I.BitNo);
+      if (Block)
+        I.Block = std::move(*Block);
+      else
+        consumeError(Block.takeError());
+    });
+  }
+}
+
+Optional<StagedFunctionBlock> FunctionBlockStager::take(Function *F) {
+  auto It = ItemIndices.find(F);
+  if (It == ItemIndices.end())
+    return None;
+  size_t Index = It->second;
+  ItemIndices.erase(It);
+
+  // Keep the window ahead of the block being materialized busy.
+  scheduleUpTo(Index + 1 + WindowSize);
+  Item &I = Items[Index];
+  I.Decoded.wait();
+  return std::move(I.Block);
+}
+
 namespace {
 
 class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
@@ -547,6 +751,10 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// When a whole module is materialized, this may decode the function blocks
+  /// of DeferredFunctionInfo on other threads ahead of their materialization.
+  std::unique_ptr<FunctionBlockStager> Stager;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -803,10 +1011,15 @@ class ModuleSummaryIndexBitcodeReader : public BitcodeReaderBase {
   /// this module by the client.
   unsigned ModuleId;
 
+  /// If set, TheIndex is shared with readers running on other threads and
+  /// every access to it is made with this mutex held.
+  std::mutex *IndexMutex;
+
 public:
   ModuleSummaryIndexBitcodeReader(BitstreamCursor Stream, StringRef Strtab,
                                   ModuleSummaryIndex &TheIndex,
-                                  StringRef ModulePath, unsigned ModuleId);
+                                  StringRef ModulePath, unsigned ModuleId,
+                                  std::mutex *IndexMutex = nullptr);
 
   Error parseModule();
 
@@ -835,6 +1048,11 @@ private:
 
   void addThisModule();
   ModuleSummaryIndex::ModuleInfo *getThisModule();
+
+  std::unique_lock<std::mutex> lockIndex() {
+    return IndexMutex ? std::unique_lock<std::mutex>(*IndexMutex)
+                      : std::unique_lock<std::mutex>();
+  }
 };
 
 } // end anonymous namespace
@@ -3795,6 +4013,7 @@ Error BitcodeReader::parseGlobalIndirectSymbolRecord(
 Error BitcodeReader::parseModule(uint64_t ResumeBit,
                                  bool ShouldLazyLoadMetadata,
                                  DataLayoutCallbackTy DataLayoutCallback) {
+  UserArenaScope ArenaScope(Context);
   if (ResumeBit) {
     if (Error JumpFailed = Stream.JumpToBit(ResumeBit))
       return JumpFailed;
@@ -4200,6 +4419,11 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
   if (Error Err = Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
     return Err;
 
+  // Replay the records of the block if they were decoded ahead of time.
+  Optional<StagedFunctionBlock> Staged;
+  if (Stager)
+    Staged = Stager->take(F);
+
   // Unexpected unresolved metadata when parsing function.
   if (MDLoader->hasFwdRefs())
     return error("Invalid function metadata: incoming forward references");
@@ -4238,7 +4462,8 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
   SmallVector<uint64_t, 64> Record;
 
   while (true) {
-    Expected<llvm::BitstreamEntry> MaybeEntry = Stream.advance();
+    Expected<llvm::BitstreamEntry> MaybeEntry =
+        Staged ? Staged->advance(Stream) : Stream.advance();
     if (!MaybeEntry)
       return MaybeEntry.takeError();
     llvm::BitstreamEntry Entry = MaybeEntry.get();
@@ -4290,7 +4515,9 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     Record.clear();
     Instruction *I = nullptr;
     unsigned ResTypeID = InvalidTypeID;
-    Expected<unsigned> MaybeBitCode = Stream.readRecord(Entry.ID, Record);
+    Expected<unsigned> MaybeBitCode =
+        Staged ? Expected<unsigned>(Staged->readRecord(Record))
+               : Stream.readRecord(Entry.ID, Record);
     if (!MaybeBitCode)
       return MaybeBitCode.takeError();
     switch (unsigned BitCode = MaybeBitCode.get()) {
@@ -6018,6 +6245,8 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   if (!F || !F->isMaterializable())
     return Error::success();
 
+  UserArenaScope ArenaScope(Context);
+
   DenseMap<Function*, uint64_t>::iterator DFII = DeferredFunctionInfo.find(F);
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
   // If its position is recorded as 0, its body is somewhere in the stream
@@ -6123,12 +6352,29 @@ Error BitcodeReader::materializeModule() {
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  // Decode the function blocks whose position is known on other threads,
+  // ahead of their materialization, if requested.
+  if (BitcodeReaderThreads != 1) {
+    std::vector<std::pair<Function *, uint64_t>> Blocks;
+    for (Function &F : *TheModule) {
+      auto It = DeferredFunctionInfo.find(&F);
+      if (F.isMaterializable() && It != DeferredFunctionInfo.end() &&
+          It->second != 0)
+        Blocks.emplace_back(&F, It->second);
+    }
+    if (Blocks.size() > 1)
+      Stager = std::make_unique<FunctionBlockStager>(Stream, Blocks,
+                                                     BitcodeReaderThreads);
+  }
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Function &F : *TheModule) {
     if (Error Err = materialize(&F))
       return Err;
   }
+  Stager.reset();
+
   // At this point, if there are any function bodies, parse the rest of
   // the bits in the module past the last function block we have recorded
   // through either lazy scanning or the VST.
@@ -6179,16 +6425,18 @@ std::vector<StructType *> BitcodeReader::getIdentifiedStructTypes() const {
 
 ModuleSummaryIndexBitcodeReader::ModuleSummaryIndexBitcodeReader(
     BitstreamCursor Cursor, StringRef Strtab, ModuleSummaryIndex &TheIndex,
-    StringRef ModulePath, unsigned ModuleId)
+    StringRef ModulePath, unsigned ModuleId, std::mutex *IndexMutex)
     : BitcodeReaderBase(std::move(Cursor), Strtab), TheIndex(TheIndex),
-      ModulePath(ModulePath), ModuleId(ModuleId) {}
+      ModulePath(ModulePath), ModuleId(ModuleId), IndexMutex(IndexMutex) {}
 
 void ModuleSummaryIndexBitcodeReader::addThisModule() {
+  auto Lock = lockIndex();
   TheIndex.addModule(ModulePath, ModuleId);
 }
 
 ModuleSummaryIndex::ModuleInfo *
 ModuleSummaryIndexBitcodeReader::getThisModule() {
+  auto Lock = lockIndex();
   return TheIndex.getModule(ModulePath);
 }
 
@@ -6215,6 +6463,7 @@ void ModuleSummaryIndexBitcodeReader::setValueGUID(
   // UseStrtab is false for legacy summary formats and value names are
   // created on stack. In that case we save the name in a string saver in
   // the index so that the value name can be recorded.
+  auto Lock = lockIndex();
   ValueIdToValueInfoMap[ValueID] = std::make_pair(
       TheIndex.getOrInsertValueInfo(
           ValueGUID,
@@ -6307,6 +6556,7 @@ Error ModuleSummaryIndexBitcodeReader::parseValueSymbolTable(
       GlobalValue::GUID RefGUID = Record[1];
       // The "original name", which is the second value of the pair will be
       // overriden later by a FS_COMBINED_ORIGINAL_NAME in the combined index.
+      auto Lock = lockIndex();
       ValueIdToValueInfoMap[ValueID] =
           std::make_pair(TheIndex.getOrInsertValueInfo(RefGUID), RefGUID);
       break;
@@ -6585,6 +6835,7 @@ void ModuleSummaryIndexBitcodeReader::parseTypeIdCompatibleVtableInfo(
 void ModuleSummaryIndexBitcodeReader::parseTypeIdCompatibleVtableSummaryRecord(
     ArrayRef<uint64_t> Record) {
   size_t Slot = 0;
+  auto Lock = lockIndex();
   TypeIdCompatibleVtableInfo &TypeId =
       TheIndex.getOrInsertTypeIdCompatibleVtableSummary(
           {Strtab.data() + Record[Slot],
@@ -6685,12 +6936,14 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
     default: // Default behavior: ignore.
       break;
     case bitc::FS_FLAGS: {  // [flags]
+      auto Lock = lockIndex();
       TheIndex.setFlags(Record[0]);
       break;
     }
     case bitc::FS_VALUE_GUID: { // [valueid, refguid]
       uint64_t ValueID = Record[0];
       GlobalValue::GUID RefGUID = Record[1];
+      auto Lock = lockIndex();
       ValueIdToValueInfoMap[ValueID] =
           std::make_pair(TheIndex.getOrInsertValueInfo(RefGUID), RefGUID);
       break;
@@ -6755,7 +7008,10 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       auto VIAndOriginalGUID = getValueInfoFromValueId(ValueID);
       FS->setModulePath(getThisModule()->first());
       FS->setOriginalName(VIAndOriginalGUID.second);
-      TheIndex.addGlobalValueSummary(VIAndOriginalGUID.first, std::move(FS));
+      {
+        auto Lock = lockIndex();
+        TheIndex.addGlobalValueSummary(VIAndOriginalGUID.first, std::move(FS));
+      }
       break;
     }
     // FS_ALIAS: [valueid, flags, valueid]
@@ -6775,14 +7031,21 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       AS->setModulePath(getThisModule()->first());
 
       auto AliaseeVI = getValueInfoFromValueId(AliaseeID).first;
-      auto AliaseeInModule = TheIndex.findSummaryInModule(AliaseeVI, ModulePath);
+      GlobalValueSummary *AliaseeInModule;
+      {
+        auto Lock = lockIndex();
+        AliaseeInModule = TheIndex.findSummaryInModule(AliaseeVI, ModulePath);
+      }
       if (!AliaseeInModule)
         return error("Alias expects aliasee summary to be parsed");
       AS->setAliasee(AliaseeVI, AliaseeInModule);
 
       auto GUID = getValueInfoFromValueId(ValueID);
       AS->setOriginalName(GUID.second);
-      TheIndex.addGlobalValueSummary(GUID.first, std::move(AS));
+      {
+        auto Lock = lockIndex();
+        TheIndex.addGlobalValueSummary(GUID.first, std::move(AS));
+      }
       break;
     }
     // FS_PERMODULE_GLOBALVAR_INIT_REFS: [valueid, flags, varflags, n x valueid]
@@ -6806,7 +7069,10 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       FS->setModulePath(getThisModule()->first());
       auto GUID = getValueInfoFromValueId(ValueID);
       FS->setOriginalName(GUID.second);
-      TheIndex.addGlobalValueSummary(GUID.first, std::move(FS));
+      {
+        auto Lock = lockIndex();
+        TheIndex.addGlobalValueSummary(GUID.first, std::move(FS));
+      }
       break;
     }
     // FS_PERMODULE_VTABLE_GLOBALVAR_INIT_REFS: [valueid, flags, varflags,
@@ -6834,7 +7100,10 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       VS->setVTableFuncs(VTableFuncs);
       auto GUID = getValueInfoFromValueId(ValueID);
       VS->setOriginalName(GUID.second);
-      TheIndex.addGlobalValueSummary(GUID.first, std::move(VS));
+      {
+        auto Lock = lockIndex();
+        TheIndex.addGlobalValueSummary(GUID.first, std::move(VS));
+      }
       break;
     }
     // FS_COMBINED: [valueid, modid, flags, instcount, fflags, numrefs,
@@ -6898,7 +7167,10 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       LastSeenSummary = FS.get();
       LastSeenGUID = VI.getGUID();
       FS->setModulePath(ModuleIdMap[ModuleId]);
-      TheIndex.addGlobalValueSummary(VI, std::move(FS));
+      {
+        auto Lock = lockIndex();
+        TheIndex.addGlobalValueSummary(VI, std::move(FS));
+      }
       break;
     }
     // FS_COMBINED_ALIAS: [valueid, modid, flags, valueid]
@@ -6915,12 +7187,20 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       AS->setModulePath(ModuleIdMap[ModuleId]);
 
       auto AliaseeVI = getValueInfoFromValueId(AliaseeValueId).first;
-      auto AliaseeInModule = TheIndex.findSummaryInModule(AliaseeVI, AS->modulePath());
+      GlobalValueSummary *AliaseeInModule;
+      {
+        auto Lock = lockIndex();
+        AliaseeInModule =
+            TheIndex.findSummaryInModule(AliaseeVI, AS->modulePath());
+      }
       AS->setAliasee(AliaseeVI, AliaseeInModule);
 
       ValueInfo VI = getValueInfoFromValueId(ValueID).first;
       LastSeenGUID = VI.getGUID();
-      TheIndex.addGlobalValueSummary(VI, std::move(AS));
+      {
+        auto Lock = lockIndex();
+        TheIndex.addGlobalValueSummary(VI, std::move(AS));
+      }
       break;
     }
     // FS_COMBINED_GLOBALVAR_INIT_REFS: [valueid, modid, flags, n x valueid]
@@ -6946,7 +7226,10 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       FS->setModulePath(ModuleIdMap[ModuleId]);
       ValueInfo VI = getValueInfoFromValueId(ValueID).first;
       LastSeenGUID = VI.getGUID();
-      TheIndex.addGlobalValueSummary(VI, std::move(FS));
+      {
+        auto Lock = lockIndex();
+        TheIndex.addGlobalValueSummary(VI, std::move(FS));
+      }
       break;
     }
     // FS_COMBINED_ORIGINAL_NAME: [original_name]
@@ -6955,7 +7238,10 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       if (!LastSeenSummary)
         return error("Name attachment that does not follow a combined record");
       LastSeenSummary->setOriginalName(OriginalName);
-      TheIndex.addOriginalName(LastSeenGUID, OriginalName);
+      {
+        auto Lock = lockIndex();
+        TheIndex.addOriginalName(LastSeenGUID, OriginalName);
+      }
       // Reset the LastSeenSummary
       LastSeenSummary = nullptr;
       LastSeenGUID = 0;
@@ -6989,6 +7275,7 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       break;
 
     case bitc::FS_CFI_FUNCTION_DEFS: {
+      auto Lock = lockIndex();
       std::set<std::string> &CfiFunctionDefs = TheIndex.cfiFunctionDefs();
       for (unsigned I = 0; I != Record.size(); I += 2)
         CfiFunctionDefs.insert(
@@ -6997,6 +7284,7 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
     }
 
     case bitc::FS_CFI_FUNCTION_DECLS: {
+      auto Lock = lockIndex();
       std::set<std::string> &CfiFunctionDecls = TheIndex.cfiFunctionDecls();
       for (unsigned I = 0; I != Record.size(); I += 2)
         CfiFunctionDecls.insert(
@@ -7004,17 +7292,21 @@ Error ModuleSummaryIndexBitcodeReader::parseEntireSummary(unsigned ID) {
       break;
     }
 
-    case bitc::FS_TYPE_ID:
+    case bitc::FS_TYPE_ID: {
+      auto Lock = lockIndex();
       parseTypeIdSummaryRecord(Record, Strtab, TheIndex);
       break;
+    }
 
     case bitc::FS_TYPE_ID_METADATA:
       parseTypeIdCompatibleVtableSummaryRecord(Record);
       break;
 
-    case bitc::FS_BLOCK_COUNT:
+    case bitc::FS_BLOCK_COUNT: {
+      auto Lock = lockIndex();
       TheIndex.addBlockCount(Record[0]);
       break;
+    }
 
     case bitc::FS_PARAM_ACCESS: {
       PendingParamAccesses = parseParamAccesses(Record);
@@ -7067,7 +7359,10 @@ Error ModuleSummaryIndexBitcodeReader::parseModuleStringTable() {
       if (convertToString(Record, 1, ModulePath))
         return error("Invalid record");
 
-      LastSeenModule = TheIndex.addModule(ModulePath, ModuleId);
+      {
+        auto Lock = lockIndex();
+        LastSeenModule = TheIndex.addModule(ModulePath, ModuleId);
+      }
       ModuleIdMap[ModuleId] = LastSeenModule->first();
 
       ModulePath.clear();
@@ -7341,13 +7636,14 @@ BitcodeModule::getLazyModule(LLVMContext &Context, bool ShouldLazyLoadMetadata,
 // module path used in the combined summary (e.g. when reading summaries for
 // regular LTO modules).
 Error BitcodeModule::readSummary(ModuleSummaryIndex &CombinedIndex,
-                                 StringRef ModulePath, uint64_t ModuleId) {
+                                 StringRef ModulePath, uint64_t ModuleId,
+                                 std::mutex *IndexMutex) {
   BitstreamCursor Stream(Buffer);
   if (Error JumpFailed = Stream.JumpToBit(ModuleBit))
     return JumpFailed;
 
   ModuleSummaryIndexBitcodeReader R(std::move(Stream), Strtab, CombinedIndex,
-                                    ModulePath, ModuleId);
+                                    ModulePath, ModuleId, IndexMutex);
   return R.parseModule();
 }
 
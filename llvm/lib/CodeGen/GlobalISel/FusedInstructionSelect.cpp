@@ -0,0 +1,200 @@
+//===- llvm/CodeGen/GlobalISel/FusedInstructionSelect.cpp -----------------==//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the FusedInstructionSelect class.
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/GlobalISel/FusedInstructionSelect.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/CodeGen/GlobalISel/GISelKnownBits.h"
+#include "llvm/CodeGen/GlobalISel/InstructionSelect.h"
+#include "llvm/CodeGen/GlobalISel/InstructionSelector.h"
+#include "llvm/CodeGen/GlobalISel/LegalizerInfo.h"
+#include "llvm/CodeGen/GlobalISel/Utils.h"
+#include "llvm/CodeGen/MachineOptimizationRemarkEmitter.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/CodeGen/TargetSubtargetInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/CodeGenCoverage.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "fused-instruction-select"
+
+using namespace llvm;
+
+char FusedInstructionSelect::ID = 0;
+INITIALIZE_PASS_BEGIN(FusedInstructionSelect, DEBUG_TYPE,
+                      "Assign register banks and select instructions in a "
+                      "single walk",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_DEPENDENCY(GISelKnownBitsAnalysis)
+INITIALIZE_PASS_END(FusedInstructionSelect, DEBUG_TYPE,
+                    "Assign register banks and select instructions in a "
+                    "single walk",
+                    false, false)
+
+namespace {
+
+/// Records the instructions inserted into blocks that have been selected
+/// already, such as the copies that repair PHI operands in predecessors, so
+/// that they get selected too.
+class SelectedBlockInsertions : public MachineFunction::Delegate {
+  const DenseSet<MachineBasicBlock *> &SelectedBlocks;
+
+public:
+  SmallSetVector<MachineInstr *, 8> Instrs;
+  /// Whether to record insertions. Selection itself is never recorded.
+  bool Enabled = true;
+
+  SelectedBlockInsertions(const DenseSet<MachineBasicBlock *> &SelectedBlocks)
+      : SelectedBlocks(SelectedBlocks) {}
+
+  void MF_HandleInsertion(MachineInstr &MI) override {
+    if (Enabled && SelectedBlocks.contains(MI.getParent()))
+      Instrs.insert(&MI);
+  }
+
+  void MF_HandleRemoval(MachineInstr &MI) override { Instrs.remove(&MI); }
+};
+
+} // end anonymous namespace
+
+/// Select the instructions recorded by \p Insertions.
+static bool selectInsertions(SelectedBlockInsertions &Insertions,
+                             InstructionSelector &ISel,
+                             const TargetPassConfig &TPC,
+                             MachineOptimizationRemarkEmitter &MORE) {
+  Insertions.Enabled = false;
+  while (!Insertions.Instrs.empty()) {
+    MachineInstr &MI = *Insertions.Instrs.pop_back_val();
+    LLVM_DEBUG(dbgs() << "Selecting late insertion: \n  " << MI);
+    ISel.CurMBB = MI.getParent();
+    if (!ISel.select(MI)) {
+      reportGISelFailure(*MI.getMF(), TPC, MORE, "gisel-select",
+                         "cannot select", MI);
+      return false;
+    }
+  }
+  Insertions.Enabled = true;
+  return true;
+}
+
+FusedInstructionSelect::FusedInstructionSelect() : RegBankSelect(ID, Fast) {}
+
+void FusedInstructionSelect::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.addRequired<GISelKnownBitsAnalysis>();
+  AU.addPreserved<GISelKnownBitsAnalysis>();
+  RegBankSelect::getAnalysisUsage(AU);
+}
+
+bool FusedInstructionSelect::runOnMachineFunction(MachineFunction &MF) {
+  // If the ISel pipeline failed, do not bother running that pass.
+  if (MF.getProperties().hasProperty(
+          MachineFunctionProperties::Property::FailedISel))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Assign register banks and select function: "
+                    << MF.getName() << '\n');
+  init(MF);
+
+  const TargetPassConfig &TPC = getAnalysis<TargetPassConfig>();
+  InstructionSelector *ISel = MF.getSubtarget().getInstructionSelector();
+  assert(ISel && "Cannot work without InstructionSelector");
+  GISelKnownBits *KB = &getAnalysis<GISelKnownBitsAnalysis>().get(MF);
+  CodeGenCoverage CoverageInfo;
+  ISel->setupMF(MF, KB, CoverageInfo, /*PSI=*/nullptr, /*BFI=*/nullptr);
+
+  // An optimization remark emitter. Used to report failures.
+  MachineOptimizationRemarkEmitter MORE(MF, /*MBFI=*/nullptr);
+
+#ifndef NDEBUG
+  // Check that our input is fully legal: we require the function to have the
+  // Legalized property, so it should be.
+  if (!DisableGISelLegalityCheck)
+    if (const MachineInstr *MI = machineFunctionIsIllegal(MF)) {
+      reportGISelFailure(MF, TPC, MORE, "gisel-select",
+                         "instruction is not legal", *MI);
+      return false;
+    }
+  const size_t NumBlocks = MF.size();
+#endif
+
+  DenseSet<MachineBasicBlock *> SelectedBlocks;
+  SelectedBlockInsertions Insertions(SelectedBlocks);
+  MF.setDelegate(&Insertions);
+  auto ResetDelegate =
+      make_scope_exit([&]() { MF.resetDelegate(&Insertions); });
+
+  // Visit the blocks in reverse post-order so that every register but the
+  // PHI operands coming in through back-edges has a register bank before its
+  // uses are mapped. The G_PHIs are left for the end, as the target may need
+  // to look at the banks of all of their operands.
+  ReversePostOrderTraversal<MachineFunction *> RPOT(&MF);
+  for (MachineBasicBlock *MBB : RPOT) {
+    if (!assignRegisterBanks(*MBB) ||
+        !selectInsertions(Insertions, *ISel, TPC, MORE))
+      return false;
+
+    Insertions.Enabled = false;
+    if (!InstructionSelect::selectMachineBasicBlock(*MBB, *ISel, TPC, MORE,
+                                                    /*SelectPHIs=*/false))
+      return false;
+    Insertions.Enabled = true;
+    SelectedBlocks.insert(MBB);
+  }
+
+  // Let the target look at the PHIs again now that every register has a bank;
+  // that may insert copies into the predecessors.
+  ISel->setupMF(MF, KB, CoverageInfo, /*PSI=*/nullptr, /*BFI=*/nullptr);
+  Insertions.Enabled = false;
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  for (MachineBasicBlock *MBB : RPOT) {
+    ISel->CurMBB = MBB;
+    for (MachineInstr &MI : make_early_inc_range(MBB->phis())) {
+      if (MI.getOpcode() != TargetOpcode::G_PHI)
+        continue;
+      LLVM_DEBUG(dbgs() << "Selecting: \n  " << MI);
+      if (isTriviallyDead(MI, MRI)) {
+        MI.eraseFromParent();
+        continue;
+      }
+      if (!ISel->select(MI)) {
+        reportGISelFailure(MF, TPC, MORE, "gisel-select", "cannot select", MI);
+        return false;
+      }
+    }
+  }
+  Insertions.Enabled = true;
+  if (!selectInsertions(Insertions, *ISel, TPC, MORE))
+    return false;
+
+#ifndef NDEBUG
+  if (MF.size() != NumBlocks) {
+    MachineOptimizationRemarkMissed R("gisel-select", "GISelFailure",
+                                      MF.getFunction().getSubprogram(),
+                                      /*MBB=*/nullptr);
+    R << "inserting blocks is not supported yet";
+    reportGISelFailure(MF, TPC, MORE, R);
+    return false;
+  }
+#endif
+  if (!InstructionSelect::finishSelection(MF, SelectedBlocks, TPC, MORE))
+    return false;
+  InstructionSelect::emitCoverage(MF, CoverageInfo);
+
+  // If we successfully selected the function nothing is going to use the vreg
+  // types after us (otherwise MIRPrinter would need them). Make sure the types
+  // disappear.
+  MRI.clearVirtRegTypes();
+  return true;
+}
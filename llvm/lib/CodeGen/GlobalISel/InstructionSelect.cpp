@@ -131,83 +131,136 @@ bool InstructionSelect::runOnMachineFunction(MachineFunction &MF) {
   DenseSet<MachineBasicBlock *> SelectedBlocks;
 
   for (MachineBasicBlock *MBB : post_order(&MF)) {
-    ISel->CurMBB = MBB;
     SelectedBlocks.insert(MBB);
-    if (MBB->empty())
-      continue;
+    if (!selectMachineBasicBlock(*MBB, *ISel, TPC, MORE))
+      return false;
+  }
 
-    // Select instructions in reverse block order. We permit erasing so have
-    // to resort to manually iterating and recognizing the begin (rend) case.
-    bool ReachedBegin = false;
-    for (auto MII = std::prev(MBB->end()), Begin = MBB->begin();
-         !ReachedBegin;) {
 #ifndef NDEBUG
-      // Keep track of the insertion range for debug printing.
-      const auto AfterIt = std::next(MII);
+  if (MF.size() != NumBlocks) {
+    MachineOptimizationRemarkMissed R("gisel-select", "GISelFailure",
+                                      MF.getFunction().getSubprogram(),
+                                      /*MBB=*/nullptr);
+    R << "inserting blocks is not supported yet";
+    reportGISelFailure(MF, TPC, MORE, R);
+    return false;
+  }
 #endif
-      // Select this instruction.
-      MachineInstr &MI = *MII;
+  if (!finishSelection(MF, SelectedBlocks, TPC, MORE))
+    return false;
 
-      // And have our iterator point to the next instruction, if there is one.
-      if (MII == Begin)
-        ReachedBegin = true;
-      else
-        --MII;
+  emitCoverage(MF, CoverageInfo);
 
-      LLVM_DEBUG(dbgs() << "Selecting: \n  " << MI);
+  // If we successfully selected the function nothing is going to use the vreg
+  // types after us (otherwise MIRPrinter would need them). Make sure the types
+  // disappear.
+  MRI.clearVirtRegTypes();
 
-      // We could have folded this instruction away already, making it dead.
-      // If so, erase it.
-      if (isTriviallyDead(MI, MRI)) {
-        LLVM_DEBUG(dbgs() << "Is dead; erasing.\n");
-        MI.eraseFromParent();
-        continue;
-      }
+  // FIXME: Should we accurately track changes?
+  return true;
+}
 
-      // Eliminate hints.
-      if (isPreISelGenericOptimizationHint(MI.getOpcode())) {
-        Register DstReg = MI.getOperand(0).getReg();
-        Register SrcReg = MI.getOperand(1).getReg();
-
-        // At this point, the destination register class of the hint may have
-        // been decided.
-        //
-        // Propagate that through to the source register.
-        const TargetRegisterClass *DstRC = MRI.getRegClassOrNull(DstReg);
-        if (DstRC)
-          MRI.setRegClass(SrcReg, DstRC);
-        assert(canReplaceReg(DstReg, SrcReg, MRI) &&
-               "Must be able to replace dst with src!");
-        MI.eraseFromParent();
-        MRI.replaceRegWith(DstReg, SrcReg);
-        continue;
-      }
+void InstructionSelect::emitCoverage(const MachineFunction &MF,
+                                     const CodeGenCoverage &CoverageInfo) {
+  auto &TLI = *MF.getSubtarget().getTargetLowering();
+  LLVM_DEBUG({
+    dbgs() << "Rules covered by selecting function: " << MF.getName() << ":";
+    for (auto RuleID : CoverageInfo.covered())
+      dbgs() << " id" << RuleID;
+    dbgs() << "\n\n";
+  });
+  CoverageInfo.emit(CoveragePrefix,
+                    TLI.getTargetMachine().getTarget().getBackendName());
+}
 
-      if (!ISel->select(MI)) {
-        // FIXME: It would be nice to dump all inserted instructions.  It's
-        // not obvious how, esp. considering select() can insert after MI.
-        reportGISelFailure(MF, TPC, MORE, "gisel-select", "cannot select", MI);
-        return false;
-      }
+bool InstructionSelect::selectMachineBasicBlock(
+    MachineBasicBlock &MBB, InstructionSelector &ISel,
+    const TargetPassConfig &TPC, MachineOptimizationRemarkEmitter &MORE,
+    bool SelectPHIs) {
+  MachineFunction &MF = *MBB.getParent();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  ISel.CurMBB = &MBB;
+  if (MBB.empty())
+    return true;
+
+  // Select instructions in reverse block order. We permit erasing so have
+  // to resort to manually iterating and recognizing the begin (rend) case.
+  bool ReachedBegin = false;
+  for (auto MII = std::prev(MBB.end()), Begin = MBB.begin(); !ReachedBegin;) {
+#ifndef NDEBUG
+    // Keep track of the insertion range for debug printing.
+    const auto AfterIt = std::next(MII);
+#endif
+    // Select this instruction.
+    MachineInstr &MI = *MII;
+    if (!SelectPHIs && MI.isPHI())
+      break;
+
+    // And have our iterator point to the next instruction, if there is one.
+    if (MII == Begin)
+      ReachedBegin = true;
+    else
+      --MII;
+
+    LLVM_DEBUG(dbgs() << "Selecting: \n  " << MI);
+
+    // We could have folded this instruction away already, making it dead.
+    // If so, erase it.
+    if (isTriviallyDead(MI, MRI)) {
+      LLVM_DEBUG(dbgs() << "Is dead; erasing.\n");
+      MI.eraseFromParent();
+      continue;
+    }
+
+    // Eliminate hints.
+    if (isPreISelGenericOptimizationHint(MI.getOpcode())) {
+      Register DstReg = MI.getOperand(0).getReg();
+      Register SrcReg = MI.getOperand(1).getReg();
+
+      // At this point, the destination register class of the hint may have
+      // been decided.
+      //
+      // Propagate that through to the source register.
+      const TargetRegisterClass *DstRC = MRI.getRegClassOrNull(DstReg);
+      if (DstRC)
+        MRI.setRegClass(SrcReg, DstRC);
+      assert(canReplaceReg(DstReg, SrcReg, MRI) &&
+             "Must be able to replace dst with src!");
+      MI.eraseFromParent();
+      MRI.replaceRegWith(DstReg, SrcReg);
+      continue;
+    }
 
-      // Dump the range of instructions that MI expanded into.
-      LLVM_DEBUG({
-        auto InsertedBegin = ReachedBegin ? MBB->begin() : std::next(MII);
-        dbgs() << "Into:\n";
-        for (auto &InsertedMI : make_range(InsertedBegin, AfterIt))
-          dbgs() << "  " << InsertedMI;
-        dbgs() << '\n';
-      });
+    if (!ISel.select(MI)) {
+      // FIXME: It would be nice to dump all inserted instructions.  It's
+      // not obvious how, esp. considering select() can insert after MI.
+      reportGISelFailure(MF, TPC, MORE, "gisel-select", "cannot select", MI);
+      return false;
     }
+
+    // Dump the range of instructions that MI expanded into.
+    LLVM_DEBUG({
+      auto InsertedBegin = ReachedBegin ? MBB.begin() : std::next(MII);
+      dbgs() << "Into:\n";
+      for (auto &InsertedMI : make_range(InsertedBegin, AfterIt))
+        dbgs() << "  " << InsertedMI;
+      dbgs() << '\n';
+    });
   }
+  return true;
+}
 
+bool InstructionSelect::finishSelection(
+    MachineFunction &MF, const DenseSet<MachineBasicBlock *> &SelectedBlocks,
+    const TargetPassConfig &TPC, MachineOptimizationRemarkEmitter &MORE) {
+  MachineRegisterInfo &MRI = MF.getRegInfo();
   for (MachineBasicBlock &MBB : MF) {
     if (MBB.empty())
       continue;
 
     if (!SelectedBlocks.contains(&MBB)) {
       // This is an unreachable block and therefore hasn't been selected, since
-      // the main selection loop above uses a postorder block traversal.
+      // the main selection loop uses a traversal from the entry block.
       // We delete all the instructions in this block since it's unreachable.
       MBB.clear();
       // Don't delete the block in case the block has it's address taken or is
@@ -276,15 +329,6 @@ bool InstructionSelect::runOnMachineFunction(MachineFunction &MF) {
       return false;
     }
   }
-
-  if (MF.size() != NumBlocks) {
-    MachineOptimizationRemarkMissed R("gisel-select", "GISelFailure",
-                                      MF.getFunction().getSubprogram(),
-                                      /*MBB=*/nullptr);
-    R << "inserting blocks is not supported yet";
-    reportGISelFailure(MF, TPC, MORE, R);
-    return false;
-  }
 #endif
   // Determine if there are any calls in this machine function. Ported from
   // SelectionDAG.
@@ -302,23 +346,6 @@ bool InstructionSelect::runOnMachineFunction(MachineFunction &MF) {
   }
 
   // FIXME: FinalizeISel pass calls finalizeLowering, so it's called twice.
-  auto &TLI = *MF.getSubtarget().getTargetLowering();
-  TLI.finalizeLowering(MF);
-
-  LLVM_DEBUG({
-    dbgs() << "Rules covered by selecting function: " << MF.getName() << ":";
-    for (auto RuleID : CoverageInfo.covered())
-      dbgs() << " id" << RuleID;
-    dbgs() << "\n\n";
-  });
-  CoverageInfo.emit(CoveragePrefix,
-                    TLI.getTargetMachine().getTarget().getBackendName());
-
-  // If we successfully selected the function nothing is going to use the vreg
-  // types after us (otherwise MIRPrinter would need them). Make sure the types
-  // disappear.
-  MRI.clearVirtRegTypes();
-
-  // FIXME: Should we accurately track changes?
+  MF.getSubtarget().getTargetLowering()->finalizeLowering(MF);
   return true;
 }
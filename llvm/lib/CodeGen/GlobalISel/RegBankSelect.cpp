@@ -70,7 +70,10 @@ INITIALIZE_PASS_END(RegBankSelect, DEBUG_TYPE,
                     false)
 
 RegBankSelect::RegBankSelect(Mode RunningMode)
-    : MachineFunctionPass(ID), OptMode(RunningMode) {
+    : RegBankSelect(ID, RunningMode) {}
+
+RegBankSelect::RegBankSelect(char &PassID, Mode RunningMode)
+    : MachineFunctionPass(PassID), OptMode(RunningMode) {
   if (RegBankSelectMode.getNumOccurrences() != 0) {
     OptMode = RegBankSelectMode;
     if (RegBankSelectMode != RunningMode)
@@ -696,46 +699,51 @@ bool RegBankSelect::runOnMachineFunction(MachineFunction &MF) {
   // Use a RPOT to make sure all registers are assigned before we choose
   // the best mapping of the current instruction.
   ReversePostOrderTraversal<MachineFunction*> RPOT(&MF);
-  for (MachineBasicBlock *MBB : RPOT) {
-    // Set a sensible insertion point so that subsequent calls to
-    // MIRBuilder.
-    MIRBuilder.setMBB(*MBB);
-    SmallVector<MachineInstr *> WorkList(
-        make_pointer_range(reverse(MBB->instrs())));
-
-    while (!WorkList.empty()) {
-      MachineInstr &MI = *WorkList.pop_back_val();
-
-      // Ignore target-specific post-isel instructions: they should use proper
-      // regclasses.
-      if (isTargetSpecificOpcode(MI.getOpcode()) && !MI.isPreISelOpcode())
-        continue;
-
-      // Ignore inline asm instructions: they should use physical
-      // registers/regclasses
-      if (MI.isInlineAsm())
-        continue;
-
-      // Ignore debug info.
-      if (MI.isDebugInstr())
-        continue;
-
-      // Ignore IMPLICIT_DEF which must have a regclass.
-      if (MI.isImplicitDef())
-        continue;
-
-      if (!assignInstr(MI)) {
-        reportGISelFailure(MF, *TPC, *MORE, "gisel-regbankselect",
-                           "unable to map instruction", MI);
-        return false;
-      }
-    }
-  }
+  for (MachineBasicBlock *MBB : RPOT)
+    if (!assignRegisterBanks(*MBB))
+      return false;
 
   OptMode = SaveOptMode;
   return false;
 }
 
+bool RegBankSelect::assignRegisterBanks(MachineBasicBlock &MBB) {
+  // Set a sensible insertion point so that subsequent calls to
+  // MIRBuilder.
+  MIRBuilder.setMBB(MBB);
+  SmallVector<MachineInstr *> WorkList(
+      make_pointer_range(reverse(MBB.instrs())));
+
+  while (!WorkList.empty()) {
+    MachineInstr &MI = *WorkList.pop_back_val();
+
+    // Ignore target-specific post-isel instructions: they should use proper
+    // regclasses.
+    if (isTargetSpecificOpcode(MI.getOpcode()) && !MI.isPreISelOpcode())
+      continue;
+
+    // Ignore inline asm instructions: they should use physical
+    // registers/regclasses
+    if (MI.isInlineAsm())
+      continue;
+
+    // Ignore debug info.
+    if (MI.isDebugInstr())
+      continue;
+
+    // Ignore IMPLICIT_DEF which must have a regclass.
+    if (MI.isImplicitDef())
+      continue;
+
+    if (!assignInstr(MI)) {
+      reportGISelFailure(*MBB.getParent(), *TPC, *MORE, "gisel-regbankselect",
+                         "unable to map instruction", MI);
+      return false;
+    }
+  }
+  return true;
+}
+
 //------------------------------------------------------------------------------
 //                  Helper Classes Implementation
 //------------------------------------------------------------------------------
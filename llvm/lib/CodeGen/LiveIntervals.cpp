@@ -102,13 +102,20 @@ LiveIntervals::LiveIntervals() : MachineFunctionPass(ID) {
   initializeLiveIntervalsPass(*PassRegistry::getPassRegistry());
 }
 
-LiveIntervals::~LiveIntervals() { delete LICalc; }
+LiveIntervals::~LiveIntervals() {
+  delete LICalc;
+  LIRecycler.clear(LIAllocator);
+}
 
 void LiveIntervals::releaseMemory() {
-  // Free the live intervals themselves.
+  // Free the live intervals themselves. Their memory goes back to the
+  // allocator all at once.
   for (unsigned i = 0, e = VirtRegIntervals.size(); i != e; ++i)
-    delete VirtRegIntervals[Register::index2VirtReg(i)];
+    if (LiveInterval *LI = VirtRegIntervals[Register::index2VirtReg(i)])
+      LI->~LiveInterval();
   VirtRegIntervals.clear();
+  LIRecycler.clear(LIAllocator);
+  LIAllocator.Reset();
   RegMaskSlots.clear();
   RegMaskBits.clear();
   RegMaskBlocks.clear();
@@ -186,7 +193,14 @@ LLVM_DUMP_METHOD void LiveIntervals::dumpInstrs() const {
 
 LiveInterval *LiveIntervals::createInterval(Register reg) {
   float Weight = Register::isPhysicalRegister(reg) ? huge_valf : 0.0F;
-  return new LiveInterval(reg, Weight);
+  return new (LIRecycler.Allocate(LIAllocator)) LiveInterval(reg, Weight);
+}
+
+void LiveIntervals::freeInterval(LiveInterval *LI) {
+  if (!LI)
+    return;
+  LI->~LiveInterval();
+  LIRecycler.Deallocate(LIAllocator, LI);
 }
 
 /// Compute the live interval of a virtual register, based on defs and uses.
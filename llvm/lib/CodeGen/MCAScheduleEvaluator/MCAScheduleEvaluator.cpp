@@ -0,0 +1,132 @@
+//===- MCAScheduleEvaluator.cpp - Simulate machine schedules --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MCAScheduleEvaluator class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/MCAScheduleEvaluator.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/TargetInstrInfo.h"
+#include "llvm/CodeGen/TargetRegisterInfo.h"
+#include "llvm/CodeGen/TargetSubtargetInfo.h"
+#include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCInstrAnalysis.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/MCA/Context.h"
+#include "llvm/MCA/CustomBehaviour.h"
+#include "llvm/MCA/InstrBuilder.h"
+#include "llvm/MCA/Pipeline.h"
+#include "llvm/MCA/SourceMgr.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+
+MCAScheduleEvaluator::MCAScheduleEvaluator(
+    const MachineFunction &MF, const MachineBlockFrequencyInfo &MBFI,
+    ProfileSummaryInfo &PSI, unsigned Iterations)
+    : STI(MF.getSubtarget()), TheTarget(MF.getTarget().getTarget()),
+      MBFI(MBFI), PSI(PSI), Iterations(Iterations) {
+  const MCInstrInfo &MCII = *STI.getInstrInfo();
+  MCIA.reset(TheTarget.createMCInstrAnalysis(&MCII));
+  IB = std::make_unique<mca::InstrBuilder>(STI, MCII, *STI.getRegisterInfo(),
+                                           MCIA.get());
+}
+
+MCAScheduleEvaluator::~MCAScheduleEvaluator() = default;
+
+bool MCAScheduleEvaluator::isSupported(const MachineFunction &MF,
+                                       ProfileSummaryInfo &PSI) {
+  return MF.getSubtarget().getSchedModel().hasInstrSchedModel() &&
+         PSI.hasProfileSummary() && MF.getFunction().hasProfileData();
+}
+
+std::unique_ptr<MachineScheduleEvaluator>
+MCAScheduleEvaluator::create(const MachineFunction &MF,
+                             const MachineBlockFrequencyInfo &MBFI,
+                             ProfileSummaryInfo &PSI, unsigned Iterations) {
+  if (!isSupported(MF, PSI))
+    return nullptr;
+  return std::make_unique<MCAScheduleEvaluator>(MF, MBFI, PSI, Iterations);
+}
+
+void llvm::registerMCAScheduleEvaluator() {
+  MachineScheduleEvaluator::setFactory(MCAScheduleEvaluator::create);
+}
+
+bool MCAScheduleEvaluator::shouldEvaluate(const MachineBasicBlock &MBB) const {
+  Optional<uint64_t> Count = MBFI.getBlockProfileCount(&MBB);
+  return Count && PSI.isHotCount(*Count);
+}
+
+/// Lower \p MI to an MCInst that has the operands llvm-mca looks at: the
+/// explicit registers and immediates. Other operands are only placeholders.
+static void lowerForSimulation(const MachineInstr &MI, MCInst &Inst) {
+  Inst.setOpcode(MI.getOpcode());
+  for (const MachineOperand &MO : MI.explicit_operands()) {
+    if (MO.isReg())
+      Inst.addOperand(MCOperand::createReg(MO.getReg()));
+    else if (MO.isImm())
+      Inst.addOperand(MCOperand::createImm(MO.getImm()));
+    else
+      Inst.addOperand(MCOperand::createImm(0));
+  }
+}
+
+Optional<unsigned>
+MCAScheduleEvaluator::getCycles(ArrayRef<const MachineInstr *> Sequence) {
+  // The variant descriptors of the builder are keyed by MCInst address, which
+  // does not outlive this call.
+  IB->clear();
+
+  SmallVector<MCInst, 32> Insts;
+  for (const MachineInstr *MI : Sequence) {
+    if (MI->isMetaInstruction())
+      continue;
+    if (MI->isBundle() || MI->isPseudo())
+      return None;
+    Insts.emplace_back();
+    lowerForSimulation(*MI, Insts.back());
+  }
+  if (Insts.empty())
+    return None;
+
+  SmallVector<std::unique_ptr<mca::Instruction>, 32> Lowered;
+  for (const MCInst &Inst : Insts) {
+    Expected<std::unique_ptr<mca::Instruction>> I = IB->createInstruction(Inst);
+    if (!I) {
+      consumeError(I.takeError());
+      return None;
+    }
+    Lowered.push_back(std::move(*I));
+  }
+
+  const MCInstrInfo &MCII = *STI.getInstrInfo();
+  mca::SourceMgr S(Lowered, Iterations);
+  std::unique_ptr<mca::CustomBehaviour> CB(
+      TheTarget.createCustomBehaviour(STI, S, MCII));
+  if (!CB)
+    CB = std::make_unique<mca::CustomBehaviour>(STI, S, MCII);
+
+  // Leave every buffer but the dispatch width to the scheduling model, as
+  // llvm-mca does by default.
+  mca::PipelineOptions PO(/*UOPQSize=*/0, /*DecThr=*/0,
+                          STI.getSchedModel().IssueWidth, /*RFS=*/0,
+                          /*LQS=*/0, /*SQS=*/0, /*NoAlias=*/true);
+  mca::Context Ctx(*STI.getRegisterInfo(), STI);
+  std::unique_ptr<mca::Pipeline> P = Ctx.createDefaultPipeline(PO, S, *CB);
+  Expected<unsigned> Cycles = P->run();
+  if (!Cycles) {
+    consumeError(Cycles.takeError());
+    return None;
+  }
+  return *Cycles;
+}
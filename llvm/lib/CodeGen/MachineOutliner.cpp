@@ -72,6 +72,8 @@
 #include "llvm/InitializePasses.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/SuffixArray.h"
 #include "llvm/Support/SuffixTree.h"
 #include "llvm/Support/raw_ostream.h"
 #include <functional>
@@ -113,6 +115,15 @@ static cl::opt<unsigned> OutlinerReruns(
     cl::desc(
         "Number of times to rerun the outliner after the initial outline"));
 
+/// Find the repeated sequences with a suffix array instead of a suffix tree,
+/// and compute their benefit in parallel. This requires the target's
+/// getOutliningCandidateInfo to be safe to call concurrently; the in-tree
+/// implementations only read the MIR.
+static cl::opt<bool> ParallelCandidateDiscovery(
+    "machine-outliner-parallel-discovery", cl::init(false), cl::Hidden,
+    cl::desc("Find outlining candidates with a suffix array and evaluate "
+             "them in parallel"));
+
 namespace {
 
 /// Maps \p MachineInstrs to unsigned integers and stores the mappings.
@@ -401,6 +412,11 @@ struct MachineOutliner : public ModulePass {
   void findCandidates(InstructionMapper &Mapper,
                       std::vector<OutlinedFunction> &FunctionList);
 
+  /// Like findCandidates, but with a suffix array, evaluating the repeated
+  /// substrings in parallel.
+  void findCandidatesInParallel(InstructionMapper &Mapper,
+                                std::vector<OutlinedFunction> &FunctionList);
+
   /// Replace the sequences of instructions represented by \p OutlinedFunctions
   /// with calls to functions.
   ///
@@ -525,9 +541,58 @@ void MachineOutliner::emitOutlinedFunctionRemark(OutlinedFunction &OF) {
   MORE.emit(R);
 }
 
+/// Collect the occurrences of the sequence of length \p StringLen at each of
+/// \p StartIndices that do not overlap the ones before as \p Candidates for
+/// the function at \p FunctionIdx.
+static void collectCandidates(InstructionMapper &Mapper, unsigned StringLen,
+                              ArrayRef<unsigned> StartIndices,
+                              unsigned FunctionIdx,
+                              std::vector<Candidate> &Candidates) {
+  for (unsigned StartIdx : StartIndices) {
+    unsigned EndIdx = StartIdx + StringLen - 1;
+    // Trick: Discard some candidates that would be incompatible with the
+    // ones we've already found for this sequence. This will save us some
+    // work in candidate selection.
+    //
+    // If two candidates overlap, then we can't outline them both. This
+    // happens when we have candidates that look like, say
+    //
+    // AA (where each "A" is an instruction).
+    //
+    // We might have some portion of the module that looks like this:
+    // AAAAAA (6 A's)
+    //
+    // In this case, there are 5 different copies of "AA" in this range, but
+    // at most 3 can be outlined. If only outlining 3 of these is going to
+    // be unbeneficial, then we ought to not bother.
+    //
+    // Note that two things DON'T overlap when they look like this:
+    // start1...end1 .... start2...end2
+    // That is, one must either
+    // * End before the other starts
+    // * Start after the other ends
+    if (llvm::all_of(Candidates, [&StartIdx, &EndIdx](const Candidate &C) {
+          return (EndIdx < C.getStartIdx() || StartIdx > C.getEndIdx());
+        })) {
+      // It doesn't overlap with anything, so we can outline it.
+      // Each sequence is over [StartIt, EndIt].
+      // Save the candidate and its location.
+
+      MachineBasicBlock::iterator StartIt = Mapper.InstrList[StartIdx];
+      MachineBasicBlock::iterator EndIt = Mapper.InstrList[EndIdx];
+      MachineBasicBlock *MBB = StartIt->getParent();
+
+      Candidates.emplace_back(StartIdx, StringLen, StartIt, EndIt, MBB,
+                              FunctionIdx, Mapper.MBBFlagsMap.lookup(MBB));
+    }
+  }
+}
+
 void MachineOutliner::findCandidates(
     InstructionMapper &Mapper, std::vector<OutlinedFunction> &FunctionList) {
   FunctionList.clear();
+  if (ParallelCandidateDiscovery)
+    return findCandidatesInParallel(Mapper, FunctionList);
   SuffixTree ST(Mapper.UnsignedVec);
 
   // First, find all of the repeated substrings in the tree of minimum length
@@ -536,46 +601,8 @@ void MachineOutliner::findCandidates(
   for (const SuffixTree::RepeatedSubstring &RS : ST) {
     CandidatesForRepeatedSeq.clear();
     unsigned StringLen = RS.Length;
-    for (const unsigned &StartIdx : RS.StartIndices) {
-      unsigned EndIdx = StartIdx + StringLen - 1;
-      // Trick: Discard some candidates that would be incompatible with the
-      // ones we've already found for this sequence. This will save us some
-      // work in candidate selection.
-      //
-      // If two candidates overlap, then we can't outline them both. This
-      // happens when we have candidates that look like, say
-      //
-      // AA (where each "A" is an instruction).
-      //
-      // We might have some portion of the module that looks like this:
-      // AAAAAA (6 A's)
-      //
-      // In this case, there are 5 different copies of "AA" in this range, but
-      // at most 3 can be outlined. If only outlining 3 of these is going to
-      // be unbeneficial, then we ought to not bother.
-      //
-      // Note that two things DON'T overlap when they look like this:
-      // start1...end1 .... start2...end2
-      // That is, one must either
-      // * End before the other starts
-      // * Start after the other ends
-      if (llvm::all_of(CandidatesForRepeatedSeq, [&StartIdx,
-                                                  &EndIdx](const Candidate &C) {
-            return (EndIdx < C.getStartIdx() || StartIdx > C.getEndIdx());
-          })) {
-        // It doesn't overlap with anything, so we can outline it.
-        // Each sequence is over [StartIt, EndIt].
-        // Save the candidate and its location.
-
-        MachineBasicBlock::iterator StartIt = Mapper.InstrList[StartIdx];
-        MachineBasicBlock::iterator EndIt = Mapper.InstrList[EndIdx];
-        MachineBasicBlock *MBB = StartIt->getParent();
-
-        CandidatesForRepeatedSeq.emplace_back(StartIdx, StringLen, StartIt,
-                                              EndIt, MBB, FunctionList.size(),
-                                              Mapper.MBBFlagsMap[MBB]);
-      }
-    }
+    collectCandidates(Mapper, StringLen, RS.StartIndices, FunctionList.size(),
+                      CandidatesForRepeatedSeq);
 
     // We've found something we might want to outline.
     // Create an OutlinedFunction to store it and check if it'd be beneficial
@@ -606,6 +633,40 @@ void MachineOutliner::findCandidates(
   }
 }
 
+void MachineOutliner::findCandidatesInParallel(
+    InstructionMapper &Mapper, std::vector<OutlinedFunction> &FunctionList) {
+  std::vector<SuffixArray::RepeatedSubstring> Repeats =
+      SuffixArray(Mapper.UnsignedVec).getRepeatedSubstrings();
+
+  // Evaluate every repeated substring independently...
+  std::vector<std::vector<Candidate>> CandidateLists(Repeats.size());
+  std::vector<OutlinedFunction> Functions(Repeats.size());
+  parallelForEachN(0, Repeats.size(), [&](size_t I) {
+    std::vector<Candidate> &Candidates = CandidateLists[I];
+    collectCandidates(Mapper, Repeats[I].Length, Repeats[I].StartIndices,
+                      /*FunctionIdx=*/0, Candidates);
+    if (Candidates.size() < 2)
+      return;
+    const TargetInstrInfo *TII =
+        Candidates[0].getMF()->getSubtarget().getInstrInfo();
+    Functions[I] = TII->getOutliningCandidateInfo(Candidates);
+  });
+
+  // ...then keep the beneficial ones, in order, and emit the remarks.
+  for (unsigned I = 0, E = Repeats.size(); I != E; ++I) {
+    OutlinedFunction &OF = Functions[I];
+    if (CandidateLists[I].size() < 2 || OF.Candidates.size() < 2)
+      continue;
+    if (OF.getBenefit() < 1) {
+      emitNotOutliningCheaperRemark(Repeats[I].Length, CandidateLists[I], OF);
+      continue;
+    }
+    for (Candidate &C : OF.Candidates)
+      C.FunctionIdx = FunctionList.size();
+    FunctionList.push_back(std::move(OF));
+  }
+}
+
 MachineFunction *MachineOutliner::createOutlinedFunction(
     Module &M, OutlinedFunction &OF, InstructionMapper &Mapper, unsigned Name) {
 
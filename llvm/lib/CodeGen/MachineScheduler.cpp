@@ -21,9 +21,11 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/CodeGen/LiveInterval.h"
 #include "llvm/CodeGen/LiveIntervals.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
@@ -32,6 +34,7 @@
 #include "llvm/CodeGen/MachineOperand.h"
 #include "llvm/CodeGen/MachinePassRegistry.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/MachineScheduleEvaluator.h"
 #include "llvm/CodeGen/RegisterClassInfo.h"
 #include "llvm/CodeGen/RegisterPressure.h"
 #include "llvm/CodeGen/ScheduleDAG.h"
@@ -74,6 +77,10 @@ using namespace llvm;
 #define DEBUG_TYPE "machine-scheduler"
 
 STATISTIC(NumClustered, "Number of load/store pairs clustered");
+STATISTIC(NumMCAEvaluatedRegions,
+          "Number of hot post-RA regions whose schedules were simulated");
+STATISTIC(NumMCAInputOrderKept,
+          "Number of hot post-RA regions kept in their incoming order");
 
 namespace llvm {
 
@@ -142,6 +149,17 @@ static cl::opt<unsigned>
                          cl::desc("The threshold for fast cluster"),
                          cl::init(1000));
 
+static cl::opt<bool> EnablePostRAMCAEvaluation(
+    "post-misched-mca",
+    cl::desc("Simulate the post-ra schedules of the blocks that the profile "
+             "says are hot with llvm-mca, and keep the fastest"),
+    cl::init(false), cl::Hidden);
+
+static cl::opt<unsigned> PostRAMCAIterations(
+    "post-misched-mca-iterations",
+    cl::desc("Number of executions of a region to simulate with llvm-mca"),
+    cl::init(10), cl::Hidden);
+
 // DAG subtrees must have at least this many nodes.
 static const unsigned MinSubtreeSize = 8;
 
@@ -248,6 +266,8 @@ INITIALIZE_PASS_BEGIN(PostMachineScheduler, "postmisched",
 INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
 INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
 INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(MachineBlockFrequencyInfo)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
 INITIALIZE_PASS_END(PostMachineScheduler, "postmisched",
                     "PostRA Machine Instruction Scheduler", false, false)
 
@@ -261,6 +281,10 @@ void PostMachineScheduler::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<MachineLoopInfo>();
   AU.addRequired<AAResultsWrapperPass>();
   AU.addRequired<TargetPassConfig>();
+  if (EnablePostRAMCAEvaluation) {
+    AU.addRequired<MachineBlockFrequencyInfo>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+  }
   MachineFunctionPass::getAnalysisUsage(AU);
 }
 
@@ -439,10 +463,21 @@ bool PostMachineScheduler::runOnMachineFunction(MachineFunction &mf) {
   if (VerifyScheduling)
     MF->verify(this, "Before post machine scheduling.");
 
+  // The evaluator is only available in the tools that link it.
+  std::unique_ptr<MachineScheduleEvaluator> Evaluator;
+  if (EnablePostRAMCAEvaluation)
+    if (MachineScheduleEvaluator::FactoryFn Factory =
+            MachineScheduleEvaluator::getFactory())
+      Evaluator = Factory(*MF, getAnalysis<MachineBlockFrequencyInfo>(),
+                          getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI(),
+                          PostRAMCAIterations);
+  MCAEvaluator = Evaluator.get();
+
   // Instantiate the selected scheduler for this target, function, and
   // optimization level.
   std::unique_ptr<ScheduleDAGInstrs> Scheduler(createPostMachineScheduler());
   scheduleRegions(*Scheduler, true);
+  MCAEvaluator = nullptr;
 
   if (VerifyScheduling)
     MF->verify(this, "After post machine scheduling.");
@@ -769,6 +804,13 @@ void ScheduleDAGMI::schedule() {
   LLVM_DEBUG(dbgs() << "ScheduleDAGMI::schedule starting\n");
   LLVM_DEBUG(SchedImpl->dumpPolicy());
 
+  // Remember the incoming order of a hot region, which is the other candidate
+  // schedule the simulation compares against.
+  SmallVector<MachineInstr *, 32> InputOrder;
+  if (MCAEvaluator && MCAEvaluator->shouldEvaluate(*BB))
+    for (MachineInstr &MI : make_range(RegionBegin, RegionEnd))
+      InputOrder.push_back(&MI);
+
   // Build the DAG.
   buildSchedGraph(AA);
 
@@ -830,6 +872,9 @@ void ScheduleDAGMI::schedule() {
 
   placeDebugValues();
 
+  if (!InputOrder.empty())
+    keepFasterSchedule(InputOrder);
+
   LLVM_DEBUG({
     dbgs() << "*** Final schedule for "
            << printMBBReference(*begin()->getParent()) << " ***\n";
@@ -838,6 +883,40 @@ void ScheduleDAGMI::schedule() {
   });
 }
 
+static MachineScheduleEvaluator::FactoryFn ScheduleEvaluatorFactory = nullptr;
+
+MachineScheduleEvaluator::~MachineScheduleEvaluator() = default;
+
+void MachineScheduleEvaluator::setFactory(FactoryFn Factory) {
+  ScheduleEvaluatorFactory = Factory;
+}
+
+MachineScheduleEvaluator::FactoryFn MachineScheduleEvaluator::getFactory() {
+  return ScheduleEvaluatorFactory;
+}
+
+void ScheduleDAGMI::keepFasterSchedule(ArrayRef<MachineInstr *> InputOrder) {
+  SmallVector<const MachineInstr *, 32> NewOrder;
+  for (MachineInstr &MI : make_range(RegionBegin, RegionEnd))
+    NewOrder.push_back(&MI);
+  Optional<unsigned> NewCycles = MCAEvaluator->getCycles(NewOrder);
+  Optional<unsigned> InputCycles = MCAEvaluator->getCycles(InputOrder);
+  if (!NewCycles || !InputCycles)
+    return;
+  ++NumMCAEvaluatedRegions;
+  LLVM_DEBUG(dbgs() << "Simulated cycles: " << *NewCycles << " scheduled, "
+                    << *InputCycles << " in incoming order\n");
+  if (*InputCycles >= *NewCycles)
+    return;
+
+  // Splicing every instruction before the region end, in order, rebuilds the
+  // incoming sequence, debug values included.
+  ++NumMCAInputOrderKept;
+  for (MachineInstr *MI : InputOrder)
+    BB->splice(RegionEnd, BB, MI);
+  RegionBegin = InputOrder.front()->getIterator();
+}
+
 /// Apply each ScheduleDAGMutation step in order.
 void ScheduleDAGMI::postprocessDAG() {
   for (auto &m : Mutations)
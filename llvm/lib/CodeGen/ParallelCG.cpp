@@ -13,16 +13,52 @@
 #include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DiagnosticHandler.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Object/RelocatableLink.h"
+#include "llvm/Support/Errc.h"
 #include "llvm/Support/MemoryBufferRef.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
+#include <mutex>
 
 using namespace llvm;
 
+namespace {
+/// Passes the diagnostics of the context of a partition on to the context of
+/// the module that was split, one at a time, so that they are handled as if
+/// the module had been code generated as a whole.
+struct ForwardingDiagnosticHandler : public DiagnosticHandler {
+  LLVMContext &Ctx;
+  std::mutex &Mutex;
+
+  ForwardingDiagnosticHandler(LLVMContext &Ctx, std::mutex &Mutex)
+      : Ctx(Ctx), Mutex(Mutex) {}
+
+  bool handleDiagnostics(const DiagnosticInfo &DI) override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Ctx.diagnose(DI);
+    return true;
+  }
+  bool isAnalysisRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isAnalysisRemarkEnabled(PassName);
+  }
+  bool isMissedOptRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isMissedOptRemarkEnabled(PassName);
+  }
+  bool isPassedOptRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isPassedOptRemarkEnabled(PassName);
+  }
+  bool isAnyRemarkEnabled() const override {
+    return Ctx.getDiagHandlerPtr()->isAnyRemarkEnabled();
+  }
+};
+} // end anonymous namespace
+
 static void codegen(Module *M, llvm::raw_pwrite_stream &OS,
                     function_ref<std::unique_ptr<TargetMachine>()> TMFactory,
                     CodeGenFileType FileType) {
@@ -51,6 +87,8 @@ void llvm::splitCodeGen(
 
   // Create ThreadPool in nested scope so that threads will be joined
   // on destruction.
+  std::mutex DiagMutex;
+  LLVMContext &DiagCtx = M.getContext();
   {
     ThreadPool CodegenThreadPool(hardware_concurrency(OSs.size()));
     int ThreadCount = 0;
@@ -76,8 +114,12 @@ void llvm::splitCodeGen(
           llvm::raw_pwrite_stream *ThreadOS = OSs[ThreadCount++];
           // Enqueue the task
           CodegenThreadPool.async(
-              [TMFactory, FileType, ThreadOS](const SmallString<0> &BC) {
+              [TMFactory, FileType, ThreadOS, &DiagCtx,
+               &DiagMutex](const SmallString<0> &BC) {
                 LLVMContext Ctx;
+                Ctx.setDiagnosticHandler(
+                    std::make_unique<ForwardingDiagnosticHandler>(DiagCtx,
+                                                                  DiagMutex));
                 Expected<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
                     MemoryBufferRef(StringRef(BC.data(), BC.size()),
                                     "<split-module>"),
@@ -95,3 +137,63 @@ void llvm::splitCodeGen(
         PreserveLocals);
   }
 }
+
+Error llvm::splitCodeGenToObject(
+    Module &M, unsigned NumPartitions, raw_pwrite_stream &OS,
+    const std::function<std::unique_ptr<TargetMachine>()> &TMFactory) {
+  // The split gives the local symbols external linkage and hidden visibility,
+  // and names the unnamed symbols. Remember the symbols rather than their
+  // names, which are only final after the split, and what the split changes,
+  // to undo it if the partitions can't be combined.
+  struct SavedSymbol {
+    GlobalValue *GV;
+    GlobalValue::LinkageTypes Linkage;
+    GlobalValue::VisibilityTypes Visibility;
+    bool HasName;
+  };
+  SmallVector<SavedSymbol, 0> Saved;
+  for (GlobalValue &GV : M.global_values())
+    if (GV.hasLocalLinkage() || !GV.hasName())
+      Saved.push_back(
+          {&GV, GV.getLinkage(), GV.getVisibility(), GV.hasName()});
+
+  SmallVector<SmallString<0>, 0> Objects(NumPartitions);
+  SmallVector<std::unique_ptr<raw_svector_ostream>, 0> ObjectStreams;
+  SmallVector<raw_pwrite_stream *, 0> OSs;
+  for (SmallString<0> &Object : Objects) {
+    ObjectStreams.push_back(std::make_unique<raw_svector_ostream>(Object));
+    OSs.push_back(ObjectStreams.back().get());
+  }
+  splitCodeGen(M, OSs, /*BCOSs=*/{}, TMFactory, CGFT_ObjectFile,
+               /*PreserveLocals=*/false);
+
+  StringSet<> LocalizedSymbols;
+  for (const SavedSymbol &S : Saved)
+    if (GlobalValue::isLocalLinkage(S.Linkage))
+      LocalizedSymbols.insert(S.GV->getName());
+  SmallVector<MemoryBufferRef, 0> Inputs;
+  for (const SmallString<0> &Object : Objects)
+    Inputs.emplace_back(Object.str(), "<split-module>");
+  Error E = object::linkRelocatableObjects(Inputs, LocalizedSymbols, OS);
+  if (!E)
+    return Error::success();
+
+  // If the objects are valid but can't be combined, for instance because they
+  // need more section indices than symbols can refer to directly, code
+  // generate the module as a whole instead.
+  E = handleErrors(std::move(E), [](std::unique_ptr<StringError> SE) -> Error {
+    if (SE->convertToErrorCode() != errc::not_supported)
+      return Error(std::move(SE));
+    return Error::success();
+  });
+  if (E)
+    return E;
+  for (const SavedSymbol &S : Saved) {
+    S.GV->setLinkage(S.Linkage);
+    S.GV->setVisibility(S.Visibility);
+    if (!S.HasName)
+      S.GV->setName("");
+  }
+  codegen(&M, OS, TMFactory, CGFT_ObjectFile);
+  return Error::success();
+}
@@ -0,0 +1,414 @@
+//===-- RegAllocLinearScan.cpp - Linear Scan Register Allocator -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the RALinearScan function pass, a register allocator that
+// sits between the fast and the greedy allocator in both compile time and
+// code quality.
+//
+//===----------------------------------------------------------------------===//
+
+#include "AllocationOrder.h"
+#include "LiveDebugVariables.h"
+#include "RegAllocBase.h"
+#include "SplitKit.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/IndexedMap.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CalcSpillWeights.h"
+#include "llvm/CodeGen/LiveIntervals.h"
+#include "llvm/CodeGen/LiveRangeEdit.h"
+#include "llvm/CodeGen/LiveRegMatrix.h"
+#include "llvm/CodeGen/LiveStacks.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineDominators.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/CodeGen/RegAllocRegistry.h"
+#include "llvm/CodeGen/Spiller.h"
+#include "llvm/CodeGen/TargetRegisterInfo.h"
+#include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <functional>
+#include <queue>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "regalloc"
+
+STATISTIC(NumEvicted, "Number of interferences evicted");
+STATISTIC(NumSplit, "Number of live ranges split around blocks");
+
+static RegisterRegAlloc linearRegAlloc("linear",
+                                       "linear scan register allocator",
+                                       createLinearScanRegisterAllocator);
+
+namespace {
+/// RALinearScan assigns live virtual registers in the order of their start
+/// points, using the LiveRegMatrix to check for interference. When no register
+/// is free it evicts interfering ranges of lower spill weight, then splits a
+/// range that crosses blocks around each block that uses it, and spills it
+/// only after that. Evictions follow the cascade rule of RAGreedy, so that
+/// they cannot go on forever. Unlike RAGreedy it has no region splitting, interference
+/// cache or eviction advisor, so each live range takes a single pass over its
+/// allocation order.
+class RALinearScan : public MachineFunctionPass,
+                     public RegAllocBase,
+                     private LiveRangeEdit::Delegate {
+  // context
+  MachineFunction *MF;
+  LiveDebugVariables *DebugVars;
+
+  // state
+  std::unique_ptr<Spiller> SpillerInstance;
+  std::unique_ptr<SplitAnalysis> SA;
+  std::unique_ptr<SplitEditor> SE;
+
+  /// Registers waiting for allocation, earliest start point first.
+  using QueueEntry = std::pair<SlotIndex, Register>;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      Queue;
+
+  /// Ranges that were created by splitting. They are evicted or spilled, but
+  /// never split again.
+  DenseSet<Register> SplitProducts;
+
+  /// The eviction cascade of each virtual register, 0 until it evicts or is
+  /// evicted. As in RAGreedy, a range may only evict ranges of an older
+  /// cascade, and the evicted ranges join the cascade of the range that
+  /// evicted them. Cascade numbers only grow, so eviction chains end even when
+  /// the spill weights change as ranges are split and shrunk.
+  IndexedMap<unsigned, VirtReg2IndexFunctor> Cascades;
+  unsigned NextCascade = 1;
+
+  unsigned getCascade(Register Reg) const {
+    return Cascades.inBounds(Reg) ? Cascades[Reg] : 0;
+  }
+  void setCascade(Register Reg, unsigned Cascade) {
+    Cascades.grow(Reg);
+    Cascades[Reg] = Cascade;
+  }
+
+  bool LRE_CanEraseVirtReg(Register) override;
+  void LRE_WillShrinkVirtReg(Register) override;
+  void LRE_DidCloneVirtReg(Register, Register) override;
+
+public:
+  RALinearScan(const RegClassFilterFunc F = allocateAllRegClasses);
+
+  /// Return the pass name.
+  StringRef getPassName() const override {
+    return "Linear Scan Register Allocator";
+  }
+
+  /// RALinearScan analysis usage.
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+  void releaseMemory() override;
+
+  Spiller &spiller() override { return *SpillerInstance; }
+
+  void enqueueImpl(const LiveInterval *LI) override {
+    SlotIndex Start =
+        LI->empty() ? LIS->getSlotIndexes()->getZeroIndex() : LI->beginIndex();
+    Queue.push(std::make_pair(Start, LI->reg()));
+  }
+
+  const LiveInterval *dequeue() override {
+    if (Queue.empty())
+      return nullptr;
+    Register Reg = Queue.top().second;
+    Queue.pop();
+    return &LIS->getInterval(Reg);
+  }
+
+  MCRegister selectOrSplit(const LiveInterval &VirtReg,
+                           SmallVectorImpl<Register> &SplitVRegs) override;
+
+  /// Perform register allocation.
+  bool runOnMachineFunction(MachineFunction &mf) override;
+
+  MachineFunctionProperties getRequiredProperties() const override {
+    return MachineFunctionProperties().set(
+        MachineFunctionProperties::Property::NoPHIs);
+  }
+
+  MachineFunctionProperties getClearedProperties() const override {
+    return MachineFunctionProperties().set(
+      MachineFunctionProperties::Property::IsSSA);
+  }
+
+  static char ID;
+
+private:
+  MCRegister tryEvict(const LiveInterval &VirtReg,
+                      ArrayRef<MCRegister> Candidates);
+  bool trySplit(const LiveInterval &VirtReg,
+                SmallVectorImpl<Register> &SplitVRegs);
+};
+
+char RALinearScan::ID = 0;
+
+} // end anonymous namespace
+
+char &llvm::RALinearScanID = RALinearScan::ID;
+
+INITIALIZE_PASS_BEGIN(RALinearScan, "regalloclinear",
+                      "Linear Scan Register Allocator", false, false)
+INITIALIZE_PASS_DEPENDENCY(LiveDebugVariables)
+INITIALIZE_PASS_DEPENDENCY(SlotIndexes)
+INITIALIZE_PASS_DEPENDENCY(LiveIntervals)
+INITIALIZE_PASS_DEPENDENCY(RegisterCoalescer)
+INITIALIZE_PASS_DEPENDENCY(MachineScheduler)
+INITIALIZE_PASS_DEPENDENCY(LiveStacks)
+INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_DEPENDENCY(VirtRegMap)
+INITIALIZE_PASS_DEPENDENCY(LiveRegMatrix)
+INITIALIZE_PASS_END(RALinearScan, "regalloclinear",
+                    "Linear Scan Register Allocator", false, false)
+
+bool RALinearScan::LRE_CanEraseVirtReg(Register VirtReg) {
+  LiveInterval &LI = LIS->getInterval(VirtReg);
+  if (VRM->hasPhys(VirtReg)) {
+    Matrix->unassign(LI);
+    aboutToRemoveInterval(LI);
+    return true;
+  }
+  // Unassigned virtreg is probably in the priority queue.
+  // RegAllocBase will erase it after dequeueing.
+  // Nonetheless, clear the live-range so that the debug
+  // dump will show the right state for that VirtReg.
+  LI.clear();
+  return false;
+}
+
+void RALinearScan::LRE_WillShrinkVirtReg(Register VirtReg) {
+  if (!VRM->hasPhys(VirtReg))
+    return;
+
+  // Register is assigned, put it back on the queue for reassignment.
+  LiveInterval &LI = LIS->getInterval(VirtReg);
+  Matrix->unassign(LI);
+  enqueue(&LI);
+}
+
+void RALinearScan::LRE_DidCloneVirtReg(Register New, Register Old) {
+  if (SplitProducts.count(Old))
+    SplitProducts.insert(New);
+  setCascade(New, getCascade(Old));
+}
+
+RALinearScan::RALinearScan(RegClassFilterFunc F)
+    : MachineFunctionPass(ID), RegAllocBase(F) {}
+
+void RALinearScan::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+  AU.addRequired<AAResultsWrapperPass>();
+  AU.addPreserved<AAResultsWrapperPass>();
+  AU.addRequired<LiveIntervals>();
+  AU.addPreserved<LiveIntervals>();
+  AU.addPreserved<SlotIndexes>();
+  AU.addRequired<LiveDebugVariables>();
+  AU.addPreserved<LiveDebugVariables>();
+  AU.addRequired<LiveStacks>();
+  AU.addPreserved<LiveStacks>();
+  AU.addRequired<MachineBlockFrequencyInfo>();
+  AU.addPreserved<MachineBlockFrequencyInfo>();
+  AU.addRequired<MachineDominatorTree>();
+  AU.addPreserved<MachineDominatorTree>();
+  AU.addRequired<MachineLoopInfo>();
+  AU.addPreserved<MachineLoopInfo>();
+  AU.addRequired<VirtRegMap>();
+  AU.addPreserved<VirtRegMap>();
+  AU.addRequired<LiveRegMatrix>();
+  AU.addPreserved<LiveRegMatrix>();
+  MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+void RALinearScan::releaseMemory() {
+  SpillerInstance.reset();
+  SE.reset();
+  SA.reset();
+  SplitProducts.clear();
+  Cascades.clear();
+  NextCascade = 1;
+}
+
+// Find the candidate register whose interferences all have a lower spill
+// weight than VirtReg and an older cascade, preferring the one whose heaviest
+// interference is the lightest, and evict them. Evicted ranges go back on the
+// queue with the cascade of VirtReg, so they can't evict it in turn.
+MCRegister RALinearScan::tryEvict(const LiveInterval &VirtReg,
+                                  ArrayRef<MCRegister> Candidates) {
+  // The cascade that VirtReg gets if it evicts anything.
+  unsigned Cascade = getCascade(VirtReg.reg());
+  if (!Cascade)
+    Cascade = NextCascade;
+
+  MCRegister BestPhys;
+  float BestWeight = VirtReg.weight();
+  for (MCRegister PhysReg : Candidates) {
+    float MaxWeight = 0;
+    bool CanEvict = true;
+    for (MCRegUnitIterator Units(PhysReg, TRI); CanEvict && Units.isValid();
+         ++Units) {
+      LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+      for (const LiveInterval *Intf : Q.interferingVRegs()) {
+        MaxWeight = std::max(MaxWeight, Intf->weight());
+        if (MaxWeight >= BestWeight || getCascade(Intf->reg()) >= Cascade) {
+          CanEvict = false;
+          break;
+        }
+      }
+    }
+    if (CanEvict) {
+      BestPhys = PhysReg;
+      BestWeight = MaxWeight;
+    }
+  }
+  if (!BestPhys)
+    return MCRegister();
+
+  if (Cascade == NextCascade)
+    ++NextCascade;
+  setCascade(VirtReg.reg(), Cascade);
+
+  // Collect the interferences before mutating the union.
+  SmallVector<const LiveInterval *, 8> Intfs;
+  for (MCRegUnitIterator Units(BestPhys, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    append_range(Intfs, Q.interferingVRegs());
+  }
+  for (const LiveInterval *Intf : Intfs) {
+    // Skip duplicates.
+    if (!VRM->hasPhys(Intf->reg()))
+      continue;
+    LLVM_DEBUG(dbgs() << "evicting " << printReg(Intf->reg(), TRI) << " from "
+                      << printReg(BestPhys, TRI) << '\n');
+    Matrix->unassign(*Intf);
+    setCascade(Intf->reg(), Cascade);
+    enqueue(Intf);
+    ++NumEvicted;
+  }
+  assert(!Matrix->checkInterference(VirtReg, BestPhys) &&
+         "Interference after eviction.");
+  return BestPhys;
+}
+
+// Split a range that is live across several blocks around each block that
+// uses it, so that the pieces can be allocated or spilled independently.
+bool RALinearScan::trySplit(const LiveInterval &VirtReg,
+                            SmallVectorImpl<Register> &SplitVRegs) {
+  if (SplitProducts.count(VirtReg.reg()) || LIS->intervalIsInOneMBB(VirtReg))
+    return false;
+
+  Register Reg = VirtReg.reg();
+  SA->analyze(&VirtReg);
+  bool SingleInstrs = RegClassInfo.isProperSubClass(MRI->getRegClass(Reg));
+  LiveRangeEdit LREdit(&VirtReg, SplitVRegs, *MF, *LIS, VRM, this, &DeadRemats);
+  SE->reset(LREdit);
+  for (const SplitAnalysis::BlockInfo &BI : SA->getUseBlocks())
+    if (SA->shouldSplitSingleBlock(BI, SingleInstrs))
+      SE->splitSingleBlock(BI);
+  if (LREdit.empty())
+    return false;
+
+  SE->finish();
+  DebugVars->splitRegister(Reg, LREdit.regs(), *LIS);
+  for (Register NewReg : LREdit.regs())
+    SplitProducts.insert(NewReg);
+  LLVM_DEBUG(dbgs() << "split " << printReg(Reg, TRI) << " into "
+                    << LREdit.size() << " ranges\n");
+  ++NumSplit;
+  return true;
+}
+
+MCRegister RALinearScan::selectOrSplit(const LiveInterval &VirtReg,
+                                       SmallVectorImpl<Register> &SplitVRegs) {
+  SmallVector<MCRegister, 8> EvictCands;
+
+  // Take the first free register in the allocation order, which starts with
+  // the hints.
+  auto Order =
+      AllocationOrder::create(VirtReg.reg(), *VRM, RegClassInfo, Matrix);
+  for (MCRegister PhysReg : Order) {
+    assert(PhysReg.isValid());
+    switch (Matrix->checkInterference(VirtReg, PhysReg)) {
+    case LiveRegMatrix::IK_Free:
+      return PhysReg;
+
+    case LiveRegMatrix::IK_VirtReg:
+      // Only virtual registers in the way, we may be able to evict them.
+      EvictCands.push_back(PhysReg);
+      continue;
+
+    default:
+      // RegMask or RegUnit interference.
+      continue;
+    }
+  }
+
+  if (MCRegister PhysReg = tryEvict(VirtReg, EvictCands))
+    return PhysReg;
+
+  if (trySplit(VirtReg, SplitVRegs))
+    return 0;
+
+  LLVM_DEBUG(dbgs() << "spilling: " << VirtReg << '\n');
+  if (!VirtReg.isSpillable())
+    return ~0u;
+  LiveRangeEdit LRE(&VirtReg, SplitVRegs, *MF, *LIS, VRM, this, &DeadRemats);
+  spiller().spill(LRE);
+
+  // The live virtual register requesting allocation was spilled, so tell
+  // the caller not to allocate anything during this round.
+  return 0;
+}
+
+bool RALinearScan::runOnMachineFunction(MachineFunction &mf) {
+  LLVM_DEBUG(dbgs() << "********** LINEAR SCAN REGISTER ALLOCATION **********\n"
+                    << "********** Function: " << mf.getName() << '\n');
+
+  MF = &mf;
+  RegAllocBase::init(getAnalysis<VirtRegMap>(),
+                     getAnalysis<LiveIntervals>(),
+                     getAnalysis<LiveRegMatrix>());
+  DebugVars = &getAnalysis<LiveDebugVariables>();
+  MachineLoopInfo &Loops = getAnalysis<MachineLoopInfo>();
+  MachineBlockFrequencyInfo &MBFI = getAnalysis<MachineBlockFrequencyInfo>();
+  AAResults &AA = getAnalysis<AAResultsWrapperPass>().getAAResults();
+  VirtRegAuxInfo VRAI(*MF, *LIS, *VRM, Loops, MBFI);
+  VRAI.calculateSpillWeightsAndHints();
+
+  SpillerInstance.reset(createInlineSpiller(*this, *MF, *VRM, VRAI));
+  SA.reset(new SplitAnalysis(*VRM, *LIS, Loops));
+  SE.reset(new SplitEditor(*SA, AA, *LIS, *VRM,
+                           getAnalysis<MachineDominatorTree>(), MBFI, VRAI));
+
+  allocatePhysRegs();
+  postOptimization();
+
+  // Diagnostic output before rewriting
+  LLVM_DEBUG(dbgs() << "Post alloc VirtRegMap:\n" << *VRM << "\n");
+
+  releaseMemory();
+  return true;
+}
+
+FunctionPass *llvm::createLinearScanRegisterAllocator() {
+  return new RALinearScan();
+}
+
+FunctionPass *llvm::createLinearScanRegisterAllocator(RegClassFilterFunc F) {
+  return new RALinearScan(F);
+}
@@ -118,6 +118,10 @@ STATISTIC(NumDAGIselRetries,"Number of times dag isel has to try another path");
 STATISTIC(NumEntryBlocks, "Number of entry blocks encountered");
 STATISTIC(NumFastIselFailLowerArguments,
           "Number of entry blocks where fast isel failed to lower arguments");
+STATISTIC(NumMatchCacheHits,
+          "Number of nodes matched starting at a cached Scope child");
+STATISTIC(NumMatchCacheFallbacks,
+          "Number of nodes rematched because the cached Scope child failed");
 
 static cl::opt<int> EnableFastISelAbort(
     "fast-isel-abort", cl::Hidden,
@@ -132,6 +136,11 @@ static cl::opt<bool> EnableFastISelFallbackReport(
     cl::desc("Emit a diagnostic when \"fast\" instruction selection "
              "falls back to SelectionDAG."));
 
+static cl::opt<bool> EnableMatchCache(
+    "isel-match-cache", cl::Hidden,
+    cl::desc("Start matching a node at the outermost pattern that matched "
+             "the last node of the same shape"));
+
 static cl::opt<bool>
 UseMBPI("use-mbpi",
         cl::desc("use Machine Branch Probability Info"),
@@ -421,6 +430,9 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
 
   const Function &Fn = mf.getFunction();
   MF = &mf;
+  // What the patterns check outside of the node shapes may differ between
+  // functions, such as the subtarget and the optimization level.
+  MatchCache.clear();
 
   // Decide what flavour of variable location debug-info will be used, before
   // we change the optimisation level.
@@ -2670,6 +2682,116 @@ static unsigned IsPredicateKnownToFail(const unsigned char *Table,
 
 namespace {
 
+/// Return whether the patterns that match \p N depend only on what
+/// hashMatchShape sees. Nodes with chains or glue are not, since folding them
+/// depends on the rest of the DAG.
+static bool isMatchCacheable(SDValue N) {
+  auto HasChainOrGlue = [](const SDNode *Node) {
+    return any_of(Node->values(), [](EVT VT) {
+      return VT == MVT::Other || VT == MVT::Glue;
+    });
+  };
+  if (HasChainOrGlue(N.getNode()))
+    return false;
+  return none_of(N->op_values(), [&](SDValue Op) {
+    return HasChainOrGlue(Op.getNode());
+  });
+}
+
+/// The number of operand levels below the node being matched that
+/// hashMatchShape hashes.
+static const unsigned MatchShapeDepth = 2;
+
+/// Hash what the patterns for \p N usually check: the opcodes, types, flags,
+/// constants and use counts of \p N and of its operands, \p Depth levels
+/// deep.
+static hash_code hashMatchShape(SDValue N, unsigned Depth) {
+  const SDNode *Node = N.getNode();
+  const SDNodeFlags Flags = Node->getFlags();
+  hash_code Hash = hash_combine(
+      Node->getOpcode(), N.getResNo(), Node->getNumOperands(),
+      Node->hasOneUse(), Flags.hasNoUnsignedWrap(), Flags.hasNoSignedWrap(),
+      Flags.hasExact(), Flags.hasNoNaNs(), Flags.hasNoInfs(),
+      Flags.hasNoSignedZeros(), Flags.hasAllowReciprocal(),
+      Flags.hasAllowContract(), Flags.hasApproximateFuncs(),
+      Flags.hasAllowReassociation(), Flags.hasNoFPExcept());
+  for (EVT VT : Node->values())
+    Hash = hash_combine(Hash, VT.getRawBits());
+
+  if (auto *C = dyn_cast<ConstantSDNode>(Node))
+    Hash = hash_combine(Hash, C->getAPIntValue());
+  else if (auto *C = dyn_cast<ConstantFPSDNode>(Node))
+    Hash = hash_combine(Hash, C->getValueAPF());
+  else if (auto *CC = dyn_cast<CondCodeSDNode>(Node))
+    Hash = hash_combine(Hash, CC->get());
+  else if (auto *VT = dyn_cast<VTSDNode>(Node))
+    Hash = hash_combine(Hash, VT->getVT().getRawBits());
+  else if (auto *Reg = dyn_cast<RegisterSDNode>(Node))
+    Hash = hash_combine(Hash, Reg->getReg().id());
+
+  if (Depth != 0)
+    for (SDValue Op : Node->op_values())
+      Hash = hash_combine(Hash, hashMatchShape(Op, Depth - 1));
+  return Hash;
+}
+
+/// Return whether the matcher check \p Opcode, made on a node \p Depth levels
+/// below the node being matched, only reads what hashMatchShape hashes. A
+/// pattern that fails such a check fails for every node of the same shape,
+/// which is what allows the match cache to skip it. Checks that run arbitrary
+/// code, such as predicates and complex patterns, never qualify.
+static bool isCheckInMatchShape(unsigned Opcode, unsigned Depth) {
+  switch (Opcode) {
+  case SelectionDAGISel::OPC_Scope:
+    // All of the children failed, and each failure was checked on its own.
+    return true;
+  case SelectionDAGISel::OPC_CheckOpcode:
+  case SelectionDAGISel::OPC_SwitchOpcode:
+  case SelectionDAGISel::OPC_CheckType:
+  case SelectionDAGISel::OPC_CheckTypeRes:
+  case SelectionDAGISel::OPC_SwitchType:
+  case SelectionDAGISel::OPC_CheckInteger:
+  case SelectionDAGISel::OPC_CheckCondCode:
+  case SelectionDAGISel::OPC_CheckValueType:
+    return Depth <= MatchShapeDepth;
+  case SelectionDAGISel::OPC_RecordChild0:
+  case SelectionDAGISel::OPC_RecordChild1:
+  case SelectionDAGISel::OPC_RecordChild2:
+  case SelectionDAGISel::OPC_RecordChild3:
+  case SelectionDAGISel::OPC_RecordChild4:
+  case SelectionDAGISel::OPC_RecordChild5:
+  case SelectionDAGISel::OPC_RecordChild6:
+  case SelectionDAGISel::OPC_RecordChild7:
+  case SelectionDAGISel::OPC_MoveChild:
+  case SelectionDAGISel::OPC_MoveChild0:
+  case SelectionDAGISel::OPC_MoveChild1:
+  case SelectionDAGISel::OPC_MoveChild2:
+  case SelectionDAGISel::OPC_MoveChild3:
+  case SelectionDAGISel::OPC_MoveChild4:
+  case SelectionDAGISel::OPC_MoveChild5:
+  case SelectionDAGISel::OPC_MoveChild6:
+  case SelectionDAGISel::OPC_MoveChild7:
+  case SelectionDAGISel::OPC_CheckChild0Type:
+  case SelectionDAGISel::OPC_CheckChild1Type:
+  case SelectionDAGISel::OPC_CheckChild2Type:
+  case SelectionDAGISel::OPC_CheckChild3Type:
+  case SelectionDAGISel::OPC_CheckChild4Type:
+  case SelectionDAGISel::OPC_CheckChild5Type:
+  case SelectionDAGISel::OPC_CheckChild6Type:
+  case SelectionDAGISel::OPC_CheckChild7Type:
+  case SelectionDAGISel::OPC_CheckChild0Integer:
+  case SelectionDAGISel::OPC_CheckChild1Integer:
+  case SelectionDAGISel::OPC_CheckChild2Integer:
+  case SelectionDAGISel::OPC_CheckChild3Integer:
+  case SelectionDAGISel::OPC_CheckChild4Integer:
+  case SelectionDAGISel::OPC_CheckChild2CondCode:
+    // These fail on what they read from an operand of the node.
+    return Depth < MatchShapeDepth;
+  default:
+    return false;
+  }
+}
+
 struct MatchScope {
   /// FailIndex - If this match fails, this is the index to continue with.
   unsigned FailIndex;
@@ -2865,6 +2987,38 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
       MatcherIndex = OpcodeOffset[N.getOpcode()];
   }
 
+  // With -isel-match-cache, the first child of the outermost Scope that is
+  // tried is the one that matched the last node of the same shape.  A match is
+  // only cached if every check that failed on the way to it is one that
+  // fails for every node of the same shape, so skipping the children before
+  // it selects the same pattern as matching from the start.  If the cached
+  // child and all after it fail anyway, the node is matched again from the
+  // start.
+  bool UseMatchCache = EnableMatchCache && !ComplexPatternFuncMutatesDAG() &&
+                       isMatchCacheable(N);
+  hash_code MatchShape;
+  const std::pair<unsigned, unsigned> *CachedMatch = nullptr;
+  bool StartedAtCachedMatch = false;
+  // Whether every check that failed so far only read the node shape.
+  bool FailuresInMatchShape = true;
+  auto NoteFailedCheck = [&](unsigned FailedOpcode) {
+    if (UseMatchCache &&
+        !isCheckInMatchShape(FailedOpcode, NodeStack.size() - 1))
+      FailuresInMatchShape = false;
+  };
+  // The Scope and Scope child the match is currently in, if any.
+  unsigned OuterScopeIndex = ~0U, OuterChildIndex = ~0U;
+  if (UseMatchCache) {
+    MatchShape = hashMatchShape(N, MatchShapeDepth);
+    auto It = MatchCache.find(MatchShape);
+    if (!InMatchCacheFallback && It != MatchCache.end())
+      CachedMatch = &It->second;
+  }
+  auto RecordMatch = [&]() {
+    if (UseMatchCache && FailuresInMatchShape && OuterScopeIndex != ~0U)
+      MatchCache[MatchShape] = std::make_pair(OuterScopeIndex, OuterChildIndex);
+  };
+
   while (true) {
     assert(MatcherIndex < TableSize && "Invalid index");
 #ifndef NDEBUG
@@ -2880,7 +3034,21 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
       // immediately fail, don't even bother pushing a scope for them.
       unsigned FailIndex;
 
+      bool IsOuterScope = MatchScopes.empty();
+      if (IsOuterScope) {
+        OuterScopeIndex = MatcherIndex - 1;
+        if (CachedMatch && CachedMatch->first == OuterScopeIndex) {
+          LLVM_DEBUG(dbgs() << "  Starting scope at cached child index "
+                            << CachedMatch->second << "\n");
+          MatcherIndex = CachedMatch->second;
+          StartedAtCachedMatch = true;
+          ++NumMatchCacheHits;
+        }
+      }
+
       while (true) {
+        if (IsOuterScope)
+          OuterChildIndex = MatcherIndex;
         unsigned NumToSkip = MatcherTable[MatcherIndex++];
         if (NumToSkip & 128)
           NumToSkip = GetVBR(NumToSkip, MatcherTable, MatcherIndex);
@@ -2893,7 +3061,6 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
         FailIndex = MatcherIndex+NumToSkip;
 
         unsigned MatcherIndexOfPredicate = MatcherIndex;
-        (void)MatcherIndexOfPredicate; // silence warning.
 
         // If we can't evaluate this predicate without pushing a scope (e.g. if
         // it is a 'MoveParent') or if the predicate succeeds on this node, we
@@ -2903,6 +3070,7 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
                                               Result, *this, RecordedNodes);
         if (!Result)
           break;
+        NoteFailedCheck(MatcherTable[MatcherIndexOfPredicate]);
 
         LLVM_DEBUG(
             dbgs() << "  Skipped scope entry (due to false predicate) at "
@@ -3542,6 +3710,7 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
       if (IsMorphNodeTo) {
         // Update chain uses.
         UpdateChains(Res, InputChain, ChainNodesMatched, true);
+        RecordMatch();
         return;
       }
       continue;
@@ -3590,7 +3759,7 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
       assert(NodeToMatch->use_empty() &&
              "Didn't replace all uses of the node?");
       CurDAG->RemoveDeadNode(NodeToMatch);
-
+      RecordMatch();
       return;
     }
     }
@@ -3601,8 +3770,19 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
     LLVM_DEBUG(dbgs() << "  Match failed at index " << CurrentOpcodeIndex
                       << "\n");
     ++NumDAGIselRetries;
+    NoteFailedCheck(Opcode);
     while (true) {
       if (MatchScopes.empty()) {
+        if (StartedAtCachedMatch) {
+          // The patterns before the cached one were skipped; try them too.
+          LLVM_DEBUG(dbgs() << "  Cached scope child failed, rematching\n");
+          ++NumMatchCacheFallbacks;
+          MatchCache.erase(MatchShape);
+          InMatchCacheFallback = true;
+          SelectCodeCommon(NodeToMatch, MatcherTable, TableSize);
+          InMatchCacheFallback = false;
+          return;
+        }
         CannotYetSelect(NodeToMatch);
         return;
       }
@@ -3629,6 +3809,8 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
       // Check to see what the offset is at the new MatcherIndex.  If it is zero
       // we have reached the end of this scope, otherwise we have another child
       // in the current scope to try.
+      if (MatchScopes.size() == 1 && OuterScopeIndex != ~0U)
+        OuterChildIndex = MatcherIndex;
       unsigned NumToSkip = MatcherTable[MatcherIndex++];
       if (NumToSkip & 128)
         NumToSkip = GetVBR(NumToSkip, MatcherTable, MatcherIndex);
@@ -2390,9 +2390,15 @@ bool DWARFLinker::link() {
     OptContext.CompileUnits.reserve(
         OptContext.File.Dwarf->getNumCompileUnits());
 
+    // Verbose output is printed while DIEs are analyzed and marked, so keep
+    // it in object order.
+    OptContext.IsODRIndependent = Options.Threads != 1 && !Options.Verbose;
     for (const auto &CU : OptContext.File.Dwarf->compile_units()) {
       updateDwarfVersion(CU->getVersion());
       auto CUDie = CU->getUnitDIE(false);
+      if (CUDie && !Options.NoODR && !Options.Update &&
+          CompileUnit::isODRLanguage(CUDie))
+        OptContext.IsODRIndependent = false;
       if (Options.Verbose) {
         outs() << "Input compilation unit:";
         DIDumpOptions DumpOpts;
@@ -2411,6 +2417,14 @@ bool DWARFLinker::link() {
   if (MaxDwarfVersion == 0)
     MaxDwarfVersion = 3;
 
+  // Reserve unit IDs for each object up front so that objects can be
+  // analyzed out of order.
+  for (LinkContext &OptContext : ObjectContexts) {
+    OptContext.FirstUnitID = UnitID;
+    if (!OptContext.Skip && OptContext.File.Dwarf)
+      UnitID += OptContext.File.Dwarf->getNumCompileUnits();
+  }
+
   // At this point we know how much data we have emitted. We use this value to
   // compare canonical DIE offsets in analyzeContextInfo to see if a definition
   // is already emitted, without being affected by canonical die offsets set
@@ -2425,6 +2439,46 @@ bool DWARFLinker::link() {
   std::condition_variable ProcessedFilesConditionVariable;
   BitVector ProcessedFiles(NumObjects, false);
 
+  // Estimated memory held by each object from its analysis until the end of
+  // its cloning, the sum over all objects in that state, and the index of the
+  // object that is cloned next. Guarded by ProcessedFilesMutex.
+  std::vector<uint64_t> ObjectMemory(NumObjects);
+  uint64_t InFlightMemory = 0;
+  size_t NextToClone = 0;
+
+  auto MarkProcessed = [&](size_t I) {
+    uint64_t Size = 0;
+    for (auto &CurrentUnit : ObjectContexts[I].CompileUnits)
+      Size += CurrentUnit->getOrigUnit().getNumDIEs() *
+              (sizeof(DWARFDebugInfoEntry) + sizeof(CompileUnit::DIEInfo));
+
+    std::unique_lock<std::mutex> LockGuard(ProcessedFilesMutex);
+    ProcessedFiles.set(I);
+    ObjectMemory[I] = Size;
+    InFlightMemory += Size;
+    ProcessedFilesConditionVariable.notify_all();
+  };
+
+  // Wait until there is room in the memory budget to analyze object I. The
+  // object that is cloned next is always let through so that the link makes
+  // progress even if a single object does not fit.
+  auto WaitForMemoryBudget = [&](size_t I) {
+    if (!Options.MemoryBudget)
+      return;
+    std::unique_lock<std::mutex> LockGuard(ProcessedFilesMutex);
+    ProcessedFilesConditionVariable.wait(LockGuard, [&]() {
+      return InFlightMemory < Options.MemoryBudget || I <= NextToClone;
+    });
+  };
+
+  // When objects are analyzed concurrently, Swift interfaces are collected
+  // per object and merged in object order afterwards.
+  auto GetSwiftInterfaces = [&](LinkContext &Context) {
+    if (Options.Threads == 1 || !Options.ParseableSwiftInterfaces)
+      return Options.ParseableSwiftInterfaces;
+    return &Context.SwiftInterfaces;
+  };
+
   //  Analyzing the context info is particularly expensive so it is executed in
   //  parallel with emitting the previous compile unit.
   auto AnalyzeLambda = [&](size_t I) {
@@ -2433,8 +2487,12 @@ bool DWARFLinker::link() {
     if (Context.Skip || !Context.File.Dwarf)
       return;
 
+    unsigned NextUnitID = Context.FirstUnitID;
     for (const auto &CU : Context.File.Dwarf->compile_units()) {
-      updateDwarfVersion(CU->getVersion());
+      // The first phase has already seen the versions of ODR-independent
+      // objects, which may be analyzed concurrently.
+      if (!Context.IsODRIndependent)
+        updateDwarfVersion(CU->getVersion());
       // The !registerModuleReference() condition effectively skips
       // over fully resolved skeleton units. This second pass of
       // registerModuleReferences doesn't do any new work, but it
@@ -2444,11 +2502,12 @@ bool DWARFLinker::link() {
       auto CUDie = CU->getUnitDIE(false);
       if (!CUDie || LLVM_UNLIKELY(Options.Update) ||
           !registerModuleReference(CUDie, *CU, Context.File, OffsetsStringPool,
-                                   ODRContexts, ModulesEndOffset, UnitID,
+                                   ODRContexts, ModulesEndOffset, NextUnitID,
                                    Quiet)) {
         Context.CompileUnits.push_back(std::make_unique<CompileUnit>(
-            *CU, UnitID++, !Options.NoODR && !Options.Update, ""));
+            *CU, NextUnitID, !Options.NoODR && !Options.Update, ""));
       }
+      ++NextUnitID;
     }
 
     // Now build the DIE parent links that we will use during the next phase.
@@ -2458,34 +2517,26 @@ bool DWARFLinker::link() {
         continue;
       analyzeContextInfo(CurrentUnit->getOrigUnit().getUnitDIE(), 0,
                          *CurrentUnit, &ODRContexts.getRoot(), ODRContexts,
-                         ModulesEndOffset, Options.ParseableSwiftInterfaces,
+                         ModulesEndOffset, GetSwiftInterfaces(Context),
                          [&](const Twine &Warning, const DWARFDie &DIE) {
                            reportWarning(Warning, Context.File, &DIE);
                          });
     }
   };
 
-  // For each object file map how many bytes were emitted.
-  StringMap<DebugInfoSize> SizeByObject;
-
-  // And then the remaining work in serial again.
-  // Note, although this loop runs in serial, it can run in parallel with
-  // the analyzeContextInfo loop so long as we process files with indices >=
-  // than those processed by analyzeContextInfo.
-  auto CloneLambda = [&](size_t I) {
+  // Mark all the DIEs that need to be present in the generated output and
+  // collect some information about them.
+  // Note that this loop can not be merged with the previous one because
+  // cross-cu references require the ParentIdx to be setup for every CU in
+  // the object file before calling this.
+  auto MarkLambda = [&](size_t I) {
     auto &OptContext = ObjectContexts[I];
     if (OptContext.Skip || !OptContext.File.Dwarf)
       return;
 
-    // Then mark all the DIEs that need to be present in the generated output
-    // and collect some information about them.
-    // Note that this loop can not be merged with the previous one because
-    // cross-cu references require the ParentIdx to be setup for every CU in
-    // the object file before calling this.
     if (LLVM_UNLIKELY(Options.Update)) {
       for (auto &CurrentUnit : OptContext.CompileUnits)
         CurrentUnit->markEverythingAsKept();
-      copyInvariantDebugSection(*OptContext.File.Dwarf);
     } else {
       for (auto &CurrentUnit : OptContext.CompileUnits)
         lookForDIEsToKeep(*OptContext.File.Addresses,
@@ -2494,6 +2545,27 @@ bool DWARFLinker::link() {
                           CurrentUnit->getOrigUnit().getUnitDIE(),
                           OptContext.File, *CurrentUnit, 0);
     }
+  };
+
+  // For each object file map how many bytes were emitted.
+  StringMap<DebugInfoSize> SizeByObject;
+
+  // And then the remaining work in serial again.
+  // Note, although this loop runs in serial, it can run in parallel with
+  // the analyzeContextInfo loop so long as we process files with indices >=
+  // than those processed by analyzeContextInfo.
+  auto CloneLambda = [&](size_t I) {
+    auto &OptContext = ObjectContexts[I];
+    if (OptContext.Skip || !OptContext.File.Dwarf)
+      return;
+
+    // Marking an object that takes part in ODR uniquing depends on what the
+    // previous objects cloned, so it has to happen here. Other objects have
+    // already been marked.
+    if (!OptContext.IsODRIndependent)
+      MarkLambda(I);
+    if (LLVM_UNLIKELY(Options.Update))
+      copyInvariantDebugSection(*OptContext.File.Dwarf);
 
     // The calls to applyValidRelocs inside cloneDIE will walk the reloc
     // array again (in the same way findValidRelocsInDebugInfo() did). We
@@ -2518,6 +2590,14 @@ bool DWARFLinker::link() {
 
     // Clean-up before starting working on the next object.
     cleanupAuxiliarryData(OptContext);
+
+    // Nothing reads the input debug info of this object once it has been
+    // cloned, so release the parsed DIEs and line tables now instead of when
+    // the object is destroyed at the end of the link.
+    for (const auto &CU : OptContext.File.Dwarf->compile_units()) {
+      OptContext.File.Dwarf->clearLineTableForUnit(CU.get());
+      CU->clearDIEs(/*KeepCUDie=*/false);
+    }
   };
 
   auto EmitLambda = [&]() {
@@ -2547,11 +2627,11 @@ bool DWARFLinker::link() {
 
   auto AnalyzeAll = [&]() {
     for (unsigned I = 0, E = NumObjects; I != E; ++I) {
+      if (ObjectContexts[I].IsODRIndependent)
+        continue;
+      WaitForMemoryBudget(I);
       AnalyzeLambda(I);
-
-      std::unique_lock<std::mutex> LockGuard(ProcessedFilesMutex);
-      ProcessedFiles.set(I);
-      ProcessedFilesConditionVariable.notify_one();
+      MarkProcessed(I);
     }
   };
 
@@ -2559,6 +2639,8 @@ bool DWARFLinker::link() {
     for (unsigned I = 0, E = NumObjects; I != E; ++I) {
       {
         std::unique_lock<std::mutex> LockGuard(ProcessedFilesMutex);
+        NextToClone = I;
+        ProcessedFilesConditionVariable.notify_all();
         if (!ProcessedFiles[I]) {
           ProcessedFilesConditionVariable.wait(
               LockGuard, [&]() { return ProcessedFiles[I]; });
@@ -2566,6 +2648,10 @@ bool DWARFLinker::link() {
       }
 
       CloneLambda(I);
+
+      std::unique_lock<std::mutex> LockGuard(ProcessedFilesMutex);
+      InFlightMemory -= ObjectMemory[I];
+      ProcessedFilesConditionVariable.notify_all();
     }
     EmitLambda();
   };
@@ -2573,6 +2659,12 @@ bool DWARFLinker::link() {
   // To limit memory usage in the single threaded case, analyze and clone are
   // run sequentially so the OptContext is freed after processing each object
   // in endDebugObject.
+  //
+  // Otherwise, objects that take part in ODR uniquing are analyzed in order on
+  // one thread and everything is cloned in order on another, so that the
+  // output is deterministic. All other objects are analyzed and marked on the
+  // remaining threads in any order, because nothing they do depends on other
+  // objects.
   if (Options.Threads == 1) {
     for (unsigned I = 0, E = NumObjects; I != E; ++I) {
       AnalyzeLambda(I);
@@ -2580,10 +2672,42 @@ bool DWARFLinker::link() {
     }
     EmitLambda();
   } else {
-    ThreadPool Pool(hardware_concurrency(2));
+    // CloneAll waits for the other tasks, so it needs a thread of its own.
+    // With a memory budget, AnalyzeAll may wait for an ODR-independent
+    // object to be cloned, which needs a third thread to be analyzed on.
+    ThreadPoolStrategy S = hardware_concurrency(Options.Threads);
+    S.ThreadsRequested =
+        std::max(S.compute_thread_count(), Options.MemoryBudget ? 3u : 2u);
+    ThreadPool Pool(S);
     Pool.async(AnalyzeAll);
     Pool.async(CloneAll);
+    for (unsigned I = 0, E = NumObjects; I != E; ++I) {
+      if (!ObjectContexts[I].IsODRIndependent)
+        continue;
+      Pool.async([&, I]() {
+        WaitForMemoryBudget(I);
+        AnalyzeLambda(I);
+        MarkLambda(I);
+        MarkProcessed(I);
+      });
+    }
     Pool.wait();
+
+    // Merge the Swift interfaces found in each object in object order, as if
+    // the objects had been analyzed serially.
+    if (Options.ParseableSwiftInterfaces) {
+      for (LinkContext &OptContext : ObjectContexts) {
+        for (auto &Entry : OptContext.SwiftInterfaces) {
+          std::string &Path = (*Options.ParseableSwiftInterfaces)[Entry.first];
+          if (!Path.empty() && Path != Entry.second)
+            reportWarning(
+                Twine("Conflicting parseable interfaces for Swift Module ") +
+                    Entry.first + ": " + Path + " and " + Entry.second,
+                OptContext.File);
+          Path = Entry.second;
+        }
+      }
+    }
   }
 
   if (Options.Statistics) {
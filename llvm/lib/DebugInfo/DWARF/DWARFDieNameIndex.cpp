@@ -0,0 +1,197 @@
+//===- DWARFDieNameIndex.cpp ----------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/DWARF/DWARFDieNameIndex.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFDebugInfoEntry.h"
+#include "llvm/DebugInfo/DWARF/DWARFUnit.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cinttypes>
+#include <utility>
+
+using namespace llvm;
+
+// Layout of a side file, all integers little-endian:
+//   char[4]  Magic
+//   uint32   Version
+//   uint32   NumUnits         } UnitsSignature of the indexed binary
+//   uint64   TotalLength      }
+//   uint32   NumNames
+// followed by NumNames records, sorted by name:
+//   ULEB128  Length, then Length bytes of name
+//   ULEB128  NumEntries, then NumEntries pairs of ULEB128 UnitIndex, DieIndex
+static const char IndexMagic[4] = {'D', 'N', 'I', 'X'};
+static const uint32_t IndexVersion = 1;
+
+DWARFDieNameIndex::UnitsSignature
+DWARFDieNameIndex::UnitsSignature::get(DWARFContext &Ctx) {
+  UnitsSignature Sig;
+  for (const auto &U : Ctx.normal_units()) {
+    ++Sig.NumUnits;
+    Sig.TotalLength += U->getNextUnitOffset() - U->getOffset();
+  }
+  return Sig;
+}
+
+DWARFDieNameIndex DWARFDieNameIndex::build(DWARFContext &Ctx,
+                                           ThreadPoolStrategy S) {
+  DWARFDieNameIndex Index;
+  Index.Signature = UnitsSignature::get(Ctx);
+
+  SmallVector<DWARFUnit *, 0> Units;
+  for (const auto &U : Ctx.normal_units()) {
+    // The abbreviation sets are parsed lazily into a map shared by all
+    // units, so resolve them before extracting DIEs in parallel.
+    U->getAbbreviations();
+    Units.push_back(U.get());
+  }
+  // Names can also be resolved through DW_AT_signature references, whose type
+  // units are looked up in a map that the context builds on first use, along
+  // with the DWO units and the type unit index. Build them all now too.
+  Ctx.getTypeUnitForHash(/*Version=*/0, /*Hash=*/0, /*IsDWO=*/false);
+
+  // Extracting the DIEs of a unit only touches that unit. Names, however,
+  // can be reached through DW_AT_specification and DW_AT_abstract_origin
+  // references into other units, so every unit has to be fully extracted
+  // before any of them is scanned.
+  ThreadPool Pool(S);
+  std::vector<uint32_t> NumDIEs(Units.size());
+  for (size_t I = 0, E = Units.size(); I != E; ++I)
+    Pool.async([&, I] { NumDIEs[I] = Units[I]->getNumDIEs(); });
+  Pool.wait();
+
+  std::vector<std::vector<std::pair<const char *, uint32_t>>> UnitNames(
+      Units.size());
+  for (size_t I = 0, E = Units.size(); I != E; ++I) {
+    Pool.async([&, I] {
+      DWARFUnit *U = Units[I];
+      auto &Out = UnitNames[I];
+      for (uint32_t DieIndex = 0; DieIndex != NumDIEs[I]; ++DieIndex) {
+        DWARFDie Die = U->getDIEAtIndex(DieIndex);
+        if (!Die.getAbbreviationDeclarationPtr())
+          continue;
+        const char *ShortName = Die.getShortName();
+        if (ShortName)
+          Out.emplace_back(ShortName, DieIndex);
+        if (const char *LinkageName = Die.getLinkageName())
+          if (!ShortName || StringRef(ShortName) != LinkageName)
+            Out.emplace_back(LinkageName, DieIndex);
+      }
+    });
+  }
+  Pool.wait();
+
+  // Merge in unit order, so that each list of entries is sorted.
+  for (size_t I = 0, E = UnitNames.size(); I != E; ++I) {
+    for (const auto &Name : UnitNames[I])
+      Index.Names[Name.first].push_back({uint32_t(I), Name.second});
+    UnitNames[I] = {};
+  }
+  return Index;
+}
+
+Expected<DWARFDieNameIndex> DWARFDieNameIndex::read(DWARFContext &Ctx,
+                                                    StringRef Data) {
+  if (!Data.startswith(StringRef(IndexMagic, sizeof(IndexMagic))))
+    return createStringError(errc::invalid_argument,
+                             "not a DIE name index file");
+
+  DataExtractor Extractor(Data, /*IsLittleEndian=*/true, 0);
+  DataExtractor::Cursor C(sizeof(IndexMagic));
+  uint32_t Version = Extractor.getU32(C);
+  if (C && Version != IndexVersion)
+    return createStringError(errc::invalid_argument,
+                             "unsupported DIE name index version %" PRIu32,
+                             Version);
+
+  DWARFDieNameIndex Index;
+  Index.Signature.NumUnits = Extractor.getU32(C);
+  Index.Signature.TotalLength = Extractor.getU64(C);
+  uint32_t NumNames = Extractor.getU32(C);
+  if (!C)
+    return C.takeError();
+
+  UnitsSignature Actual = UnitsSignature::get(Ctx);
+  if (Index.Signature.NumUnits != Actual.NumUnits ||
+      Index.Signature.TotalLength != Actual.TotalLength)
+    return createStringError(errc::invalid_argument,
+                             "DIE name index does not match the debug info");
+
+  for (uint32_t I = 0; I != NumNames && C; ++I) {
+    uint64_t Length = Extractor.getULEB128(C);
+    StringRef Name = Extractor.getBytes(C, Length);
+    uint64_t NumEntries = Extractor.getULEB128(C);
+    if (!C)
+      break;
+    std::vector<Entry> &Entries = Index.Names[Name];
+    for (uint64_t J = 0; J != NumEntries && C; ++J) {
+      uint64_t UnitIndex = Extractor.getULEB128(C);
+      uint64_t DieIndex = Extractor.getULEB128(C);
+      if (C && (UnitIndex >= Actual.NumUnits || DieIndex > UINT32_MAX))
+        return createStringError(errc::invalid_argument,
+                                 "invalid entry for '%s' in DIE name index",
+                                 Name.str().c_str());
+      Entries.push_back({uint32_t(UnitIndex), uint32_t(DieIndex)});
+    }
+  }
+  if (!C)
+    return C.takeError();
+  return std::move(Index);
+}
+
+void DWARFDieNameIndex::write(raw_ostream &OS) const {
+  support::endian::Writer W(OS, support::little);
+  OS.write(IndexMagic, sizeof(IndexMagic));
+  W.write<uint32_t>(IndexVersion);
+  W.write<uint32_t>(Signature.NumUnits);
+  W.write<uint64_t>(Signature.TotalLength);
+  W.write<uint32_t>(Names.size());
+
+  // StringMap iteration order depends on hashing, so sort the names to keep
+  // the output independent of the order in which they were inserted.
+  std::vector<const StringMapEntry<std::vector<Entry>> *> Sorted;
+  Sorted.reserve(Names.size());
+  for (const auto &Name : Names)
+    Sorted.push_back(&Name);
+  llvm::sort(Sorted, [](const auto *LHS, const auto *RHS) {
+    return LHS->getKey() < RHS->getKey();
+  });
+
+  for (const auto *Name : Sorted) {
+    encodeULEB128(Name->getKeyLength(), OS);
+    OS << Name->getKey();
+    encodeULEB128(Name->getValue().size(), OS);
+    for (const Entry &E : Name->getValue()) {
+      encodeULEB128(E.UnitIndex, OS);
+      encodeULEB128(E.DieIndex, OS);
+    }
+  }
+}
+
+ArrayRef<DWARFDieNameIndex::Entry>
+DWARFDieNameIndex::lookup(StringRef Name) const {
+  auto It = Names.find(Name);
+  if (It == Names.end())
+    return {};
+  return It->getValue();
+}
+
+DWARFDie DWARFDieNameIndex::getDIE(DWARFContext &Ctx, Entry E) {
+  if (E.UnitIndex >= Ctx.getNumCompileUnits() + Ctx.getNumTypeUnits())
+    return DWARFDie();
+  DWARFUnit *U = Ctx.getUnitAtIndex(E.UnitIndex);
+  if (E.DieIndex >= U->getNumDIEs())
+    return DWARFDie();
+  return U->getDIEAtIndex(E.DieIndex);
+}
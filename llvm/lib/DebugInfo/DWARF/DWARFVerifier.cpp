@@ -29,6 +29,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
@@ -337,19 +338,30 @@ unsigned DWARFVerifier::verifyUnits(const DWARFUnitVector &Units) {
   unsigned NumDebugInfoErrors = 0;
   ReferenceMap CrossUnitReferences;
 
-  unsigned Index = 1;
-  for (const auto &Unit : Units) {
-    OS << "Verifying unit: " << Index << " / " << Units.getNumUnits();
-    if (const char* Name = Unit->getUnitDIE(true).getShortName())
-      OS << ", \"" << Name << '\"';
-    OS << '\n';
-    OS.flush();
-    ReferenceMap UnitLocalReferences;
-    NumDebugInfoErrors +=
-        verifyUnitContents(*Unit, UnitLocalReferences, CrossUnitReferences);
-    NumDebugInfoErrors += verifyDebugInfoReferences(
-        UnitLocalReferences, [&](uint64_t Offset) { return Unit.get(); });
-    ++Index;
+  // Cross-unit references can only be checked once every unit has been
+  // verified, so each unit collects its own and they are merged afterwards.
+  std::vector<ReferenceMap> UnitCrossReferences(Units.getNumUnits());
+  NumDebugInfoErrors += verifyInParallel(
+      Units.getNumUnits(), [&](DWARFVerifier &V, size_t Index) {
+        DWARFUnit *Unit = Units[Index].get();
+        V.OS << "Verifying unit: " << Index + 1 << " / "
+             << Units.getNumUnits();
+        if (const char *Name = Unit->getUnitDIE(true).getShortName())
+          V.OS << ", \"" << Name << '\"';
+        V.OS << '\n';
+        V.OS.flush();
+        ReferenceMap UnitLocalReferences;
+        unsigned NumUnitErrors = V.verifyUnitContents(
+            *Unit, UnitLocalReferences, UnitCrossReferences[Index]);
+        NumUnitErrors += V.verifyDebugInfoReferences(
+            UnitLocalReferences, [&](uint64_t Offset) { return Unit; });
+        return NumUnitErrors;
+      });
+  for (ReferenceMap &Refs : UnitCrossReferences) {
+    for (auto &Pair : Refs)
+      CrossUnitReferences[Pair.first].insert(Pair.second.begin(),
+                                             Pair.second.end());
+    Refs.clear();
   }
 
   NumDebugInfoErrors += verifyDebugInfoReferences(
@@ -461,6 +473,9 @@ bool DWARFVerifier::handleDebugInfo() {
     NumErrors += verifyUnitSection(S);
   });
 
+  if (isParallel())
+    prepareForParallelVerification();
+
   OS << "Verifying non-dwo Units...\n";
   NumErrors += verifyUnits(DCtx.getNormalUnitsVector());
 
@@ -1577,21 +1592,48 @@ unsigned DWARFVerifier::verifyDebugNames(const DWARFSection &AccelSection,
   // Don't attempt Entry validation if any of the previous checks found errors
   if (NumErrors > 0)
     return NumErrors;
+
+  // Split the name tables into fixed-size chunks so that a single large name
+  // index is still spread across threads.
+  const uint32_t NamesPerTask = 1024;
+  std::vector<std::pair<const DWARFDebugNames::NameIndex *, uint32_t>>
+      NameChunks;
   for (const auto &NI : AccelTable)
-    for (const DWARFDebugNames::NameTableEntry &NTE : NI)
-      NumErrors += verifyNameIndexEntries(NI, NTE);
+    for (uint32_t First = 1; First <= NI.getNameCount(); First += NamesPerTask)
+      NameChunks.emplace_back(&NI, First);
+  NumErrors += verifyInParallel(
+      NameChunks.size(), [&](DWARFVerifier &V, size_t Index) {
+        const DWARFDebugNames::NameIndex &NI = *NameChunks[Index].first;
+        uint32_t First = NameChunks[Index].second;
+        uint32_t Last = std::min(NI.getNameCount(), First + NamesPerTask - 1);
+        unsigned NumChunkErrors = 0;
+        for (uint32_t Name = First; Name <= Last; ++Name)
+          NumChunkErrors +=
+              V.verifyNameIndexEntries(NI, NI.getNameTableEntry(Name));
+        return NumChunkErrors;
+      });
 
   if (NumErrors > 0)
     return NumErrors;
 
+  // getCUNameIndex builds its lookup map on first use; do that here rather
+  // than from the parallel tasks.
+  std::vector<std::pair<DWARFCompileUnit *, const DWARFDebugNames::NameIndex *>>
+      IndexedUnits;
   for (const std::unique_ptr<DWARFUnit> &U : DCtx.compile_units()) {
     if (const DWARFDebugNames::NameIndex *NI =
-            AccelTable.getCUNameIndex(U->getOffset())) {
-      auto *CU = cast<DWARFCompileUnit>(U.get());
-      for (const DWARFDebugInfoEntry &Die : CU->dies())
-        NumErrors += verifyNameIndexCompleteness(DWARFDie(CU, &Die), *NI);
-    }
+            AccelTable.getCUNameIndex(U->getOffset()))
+      IndexedUnits.emplace_back(cast<DWARFCompileUnit>(U.get()), NI);
   }
+  NumErrors += verifyInParallel(
+      IndexedUnits.size(), [&](DWARFVerifier &V, size_t Index) {
+        DWARFCompileUnit *CU = IndexedUnits[Index].first;
+        unsigned NumUnitErrors = 0;
+        for (const DWARFDebugInfoEntry &Die : CU->dies())
+          NumUnitErrors += V.verifyNameIndexCompleteness(
+              DWARFDie(CU, &Die), *IndexedUnits[Index].second);
+        return NumUnitErrors;
+      });
   return NumErrors;
 }
 
@@ -1599,24 +1641,95 @@ bool DWARFVerifier::handleAccelTables() {
   const DWARFObject &D = DCtx.getDWARFObj();
   DataExtractor StrData(D.getStrSection(), DCtx.isLittleEndian(), 0);
   unsigned NumErrors = 0;
+  if (isParallel())
+    prepareForParallelVerification();
+
+  // The Apple tables are independent of each other, so each is verified as a
+  // separate task.
+  std::vector<std::pair<const DWARFSection *, const char *>> AppleTables;
   if (!D.getAppleNamesSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleNamesSection(), &StrData,
-                                       ".apple_names");
+    AppleTables.emplace_back(&D.getAppleNamesSection(), ".apple_names");
   if (!D.getAppleTypesSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleTypesSection(), &StrData,
-                                       ".apple_types");
+    AppleTables.emplace_back(&D.getAppleTypesSection(), ".apple_types");
   if (!D.getAppleNamespacesSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleNamespacesSection(), &StrData,
-                                       ".apple_namespaces");
+    AppleTables.emplace_back(&D.getAppleNamespacesSection(),
+                             ".apple_namespaces");
   if (!D.getAppleObjCSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleObjCSection(), &StrData,
-                                       ".apple_objc");
+    AppleTables.emplace_back(&D.getAppleObjCSection(), ".apple_objc");
+  NumErrors += verifyInParallel(
+      AppleTables.size(), [&](DWARFVerifier &V, size_t Index) {
+        return V.verifyAppleAccelTable(AppleTables[Index].first, &StrData,
+                                       AppleTables[Index].second);
+      });
 
   if (!D.getNamesSection().Data.empty())
     NumErrors += verifyDebugNames(D.getNamesSection(), StrData);
   return NumErrors == 0;
 }
 
+bool DWARFVerifier::isParallel() const {
+  return DumpOpts.VerifyThreads != 1 &&
+         hardware_concurrency(DumpOpts.VerifyThreads).compute_thread_count() >
+             1;
+}
+
+void DWARFVerifier::prepareForParallelVerification() {
+  SmallVector<DWARFUnit *, 0> Units;
+  for (const auto &U : DCtx.normal_units())
+    Units.push_back(U.get());
+  for (const auto &U : DCtx.dwo_units())
+    Units.push_back(U.get());
+
+  // The abbreviation sets are cached in a map shared by all units, so they
+  // are parsed serially. DIE extraction only touches the unit itself.
+  for (DWARFUnit *U : Units)
+    U->getAbbreviations();
+  ThreadPool Pool(hardware_concurrency(DumpOpts.VerifyThreads));
+  for (DWARFUnit *U : Units)
+    Pool.async([U] { U->getNumDIEs(); });
+  Pool.wait();
+
+  // Line tables are cached in the context. Once parsed, looking them up does
+  // not modify the cache.
+  for (DWARFUnit *U : Units)
+    DCtx.getLineTableForUnit(U);
+}
+
+unsigned DWARFVerifier::verifyInParallel(
+    size_t NumTasks, function_ref<unsigned(DWARFVerifier &, size_t)> Task) {
+  unsigned NumErrors = 0;
+  if (NumTasks < 2 || !isParallel()) {
+    for (size_t I = 0; I != NumTasks; ++I)
+      NumErrors += Task(*this, I);
+    return NumErrors;
+  }
+
+  DIDumpOptions TaskDumpOpts = DumpOpts;
+  TaskDumpOpts.VerifyThreads = 1;
+  std::vector<std::string> Buffers(NumTasks);
+  std::vector<std::shared_future<unsigned>> Results;
+  Results.reserve(NumTasks);
+  ThreadPool Pool(hardware_concurrency(DumpOpts.VerifyThreads));
+  for (size_t I = 0; I != NumTasks; ++I) {
+    Results.push_back(Pool.async([&, I] {
+      raw_string_ostream BufferOS(Buffers[I]);
+      DWARFVerifier V(BufferOS, DCtx, TaskDumpOpts);
+      unsigned NumTaskErrors = Task(V, I);
+      BufferOS.flush();
+      return NumTaskErrors;
+    }));
+  }
+
+  // Print each buffer as soon as it and all the ones before it are complete.
+  for (size_t I = 0; I != NumTasks; ++I) {
+    NumErrors += Results[I].get();
+    OS << Buffers[I];
+    std::string().swap(Buffers[I]);
+  }
+  OS.flush();
+  return NumErrors;
+}
+
 raw_ostream &DWARFVerifier::error() const { return WithColor::error(OS); }
 
 raw_ostream &DWARFVerifier::warn() const { return WithColor::warning(OS); }
@@ -0,0 +1,114 @@
+//===-- GsymDIContext.cpp ---------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/GSYM/GsymDIContext.h"
+#include "llvm/DebugInfo/GSYM/GsymReader.h"
+#include "llvm/DebugInfo/GSYM/LookupResult.h"
+#include "llvm/Support/Path.h"
+
+using namespace llvm;
+using namespace llvm::gsym;
+
+GsymDIContext::GsymDIContext(std::unique_ptr<GsymReader> Reader)
+    : DIContext(CK_GSYM), Reader(std::move(Reader)) {}
+
+GsymDIContext::~GsymDIContext() = default;
+
+void GsymDIContext::dump(raw_ostream &OS, DIDumpOptions DumpOpts) {
+  Reader->dump(OS);
+}
+
+static void fillLineInfoFromLocation(const SourceLocation &Location,
+                                     DILineInfoSpecifier Specifier,
+                                     DILineInfo &LineInfo) {
+  // GSYM records a single name per function, so linkage and short name
+  // requests are answered alike.
+  if (Specifier.FNKind != DINameKind::None)
+    LineInfo.FunctionName = Location.Name.str();
+
+  switch (Specifier.FLIKind) {
+  case DILineInfoSpecifier::FileLineInfoKind::None:
+    break;
+  case DILineInfoSpecifier::FileLineInfoKind::BaseNameOnly:
+    LineInfo.FileName = Location.Base.str();
+    break;
+  case DILineInfoSpecifier::FileLineInfoKind::RawValue:
+  case DILineInfoSpecifier::FileLineInfoKind::RelativeFilePath:
+  case DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath: {
+    SmallString<128> Path(Location.Dir);
+    sys::path::append(Path, Location.Base);
+    LineInfo.FileName = std::string(Path.str());
+    break;
+  }
+  }
+  LineInfo.Line = Location.Line;
+}
+
+DILineInfo
+GsymDIContext::getLineInfoForAddress(object::SectionedAddress Address,
+                                     DILineInfoSpecifier Specifier) {
+  DILineInfo LineInfo;
+  Expected<LookupResult> Result = Reader->lookup(Address.Address);
+  if (!Result) {
+    consumeError(Result.takeError());
+    return LineInfo;
+  }
+
+  // The innermost inlined function comes first, as it does for DWARF. Only
+  // the start of the concrete function is known.
+  if (Result->Locations.size() <= 1)
+    LineInfo.StartAddress = Result->FuncRange.start();
+  if (!Result->Locations.empty())
+    fillLineInfoFromLocation(Result->Locations.front(), Specifier, LineInfo);
+  else if (Specifier.FNKind != DINameKind::None)
+    LineInfo.FunctionName = Result->FuncName.str();
+  return LineInfo;
+}
+
+DILineInfoTable
+GsymDIContext::getLineInfoForAddressRange(object::SectionedAddress Address,
+                                          uint64_t Size,
+                                          DILineInfoSpecifier Specifier) {
+  // Line tables are only reachable through per-address lookups in GSYM.
+  return DILineInfoTable();
+}
+
+DIInliningInfo
+GsymDIContext::getInliningInfoForAddress(object::SectionedAddress Address,
+                                         DILineInfoSpecifier Specifier) {
+  DIInliningInfo InlineInfo;
+  Expected<LookupResult> Result = Reader->lookup(Address.Address);
+  if (!Result) {
+    consumeError(Result.takeError());
+    return InlineInfo;
+  }
+
+  if (Result->Locations.empty()) {
+    DILineInfo LineInfo;
+    LineInfo.StartAddress = Result->FuncRange.start();
+    if (Specifier.FNKind != DINameKind::None)
+      LineInfo.FunctionName = Result->FuncName.str();
+    InlineInfo.addFrame(LineInfo);
+    return InlineInfo;
+  }
+
+  for (const SourceLocation &Location : Result->Locations) {
+    DILineInfo LineInfo;
+    fillLineInfoFromLocation(Location, Specifier, LineInfo);
+    InlineInfo.addFrame(LineInfo);
+  }
+  // The concrete function is the last frame.
+  InlineInfo.getMutableFrame(InlineInfo.getNumberOfFrames() - 1)
+      ->StartAddress = Result->FuncRange.start();
+  return InlineInfo;
+}
+
+std::vector<DILocal>
+GsymDIContext::getLocalsForAddress(object::SectionedAddress Address) {
+  return std::vector<DILocal>();
+}
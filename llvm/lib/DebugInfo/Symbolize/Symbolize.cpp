@@ -14,6 +14,11 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/GSYM/DwarfTransformer.h"
+#include "llvm/DebugInfo/GSYM/GsymCreator.h"
+#include "llvm/DebugInfo/GSYM/GsymDIContext.h"
+#include "llvm/DebugInfo/GSYM/GsymReader.h"
+#include "llvm/DebugInfo/GSYM/ObjectFileTransformer.h"
 #include "llvm/DebugInfo/PDB/PDB.h"
 #include "llvm/DebugInfo/PDB/PDBContext.h"
 #include "llvm/DebugInfo/Symbolize/DIFetcher.h"
@@ -30,9 +35,13 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <numeric>
+#include <tuple>
 
 namespace llvm {
 namespace codeview {
@@ -65,6 +74,12 @@ LLVMSymbolizer::symbolizeCodeCommon(const T &ModuleSpecifier,
   if (!Info)
     return DILineInfo();
 
+  return symbolizeCodeInModule(Info, ModuleOffset);
+}
+
+DILineInfo
+LLVMSymbolizer::symbolizeCodeInModule(SymbolizableModule *Info,
+                                      object::SectionedAddress ModuleOffset) {
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
@@ -96,6 +111,78 @@ LLVMSymbolizer::symbolizeCode(ArrayRef<uint8_t> BuildID,
   return symbolizeCodeCommon(BuildID, ModuleOffset);
 }
 
+std::vector<Expected<DILineInfo>> LLVMSymbolizer::symbolizeCodeBatch(
+    ArrayRef<std::pair<std::string, object::SectionedAddress>> Requests,
+    ThreadPoolStrategy S) {
+  // Visit the requests grouped by module and sorted by address within each
+  // module, so that every module is looked up once and its debug info is
+  // walked in address order.
+  std::vector<size_t> Order(Requests.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  llvm::stable_sort(Order, [&](size_t LHS, size_t RHS) {
+    const auto &L = Requests[LHS];
+    const auto &R = Requests[RHS];
+    return std::tie(L.first, L.second.SectionIndex, L.second.Address) <
+           std::tie(R.first, R.second.SectionIndex, R.second.Address);
+  });
+
+  std::vector<DILineInfo> LineInfos(Requests.size());
+  std::map<size_t, Error> LoadErrors;
+
+  // Modules are loaded on this thread, so the caches need no locking. Only
+  // the queries run in parallel, and all the queries for a module run in the
+  // same task, since a DIContext must not be used by several threads at once.
+  ThreadPool Pool(S);
+  for (auto GroupBegin = Order.begin(), End = Order.end(); GroupBegin != End;) {
+    const std::string &ModuleName = Requests[*GroupBegin].first;
+    auto GroupEnd = std::find_if(GroupBegin, End, [&](size_t I) {
+      return Requests[I].first != ModuleName;
+    });
+
+    // Keep the cache bounded. Evicting a binary destroys the modules that use
+    // it, so wait for the queries in flight first.
+    if (CacheSize > Opts.MaxCacheSize) {
+      Pool.wait();
+      pruneCache();
+    }
+
+    Expected<SymbolizableModule *> InfoOrErr =
+        getOrCreateModuleInfo(ModuleName);
+    if (!InfoOrErr) {
+      // Like the individual calls, report the error once, and leave the
+      // remaining results for the module empty.
+      LoadErrors.emplace(*GroupBegin, InfoOrErr.takeError());
+    } else if (SymbolizableModule *Info = *InfoOrErr) {
+      Pool.async([&, Info, GroupBegin, GroupEnd] {
+        const object::SectionedAddress *Prev = nullptr;
+        const DILineInfo *PrevInfo = nullptr;
+        for (auto It = GroupBegin; It != GroupEnd; ++It) {
+          const object::SectionedAddress &Offset = Requests[*It].second;
+          if (Prev && *Prev == Offset)
+            LineInfos[*It] = *PrevInfo;
+          else
+            LineInfos[*It] = symbolizeCodeInModule(Info, Offset);
+          Prev = &Offset;
+          PrevInfo = &LineInfos[*It];
+        }
+      });
+    }
+    GroupBegin = GroupEnd;
+  }
+  Pool.wait();
+
+  std::vector<Expected<DILineInfo>> Results;
+  Results.reserve(Requests.size());
+  for (size_t I = 0, E = Requests.size(); I != E; ++I) {
+    auto It = LoadErrors.find(I);
+    if (It != LoadErrors.end())
+      Results.push_back(std::move(It->second));
+    else
+      Results.push_back(std::move(LineInfos[I]));
+  }
+  return Results;
+}
+
 template <typename T>
 Expected<DIInliningInfo> LLVMSymbolizer::symbolizeInlinedCodeCommon(
     const T &ModuleSpecifier, object::SectionedAddress ModuleOffset) {
@@ -342,6 +429,62 @@ Optional<ArrayRef<uint8_t>> getBuildID(const ELFObjectFileBase *Obj) {
   return BuildID;
 }
 
+// Returns the identifier that a GSYM cache entry for Obj is keyed by.
+Optional<ArrayRef<uint8_t>> getGsymCacheKey(const ObjectFile *Obj) {
+  if (auto *ELFObj = dyn_cast<ELFObjectFileBase>(Obj))
+    return getBuildID(ELFObj);
+  if (auto *MachObj = dyn_cast<MachOObjectFile>(Obj))
+    if (!MachObj->getUuid().empty())
+      return MachObj->getUuid();
+  return None;
+}
+
+// Converts the debug info and symbol table of Obj into a GSYM file at Path,
+// recording UUID in its header.
+Error convertToGsym(const ObjectFile &Obj, ArrayRef<uint8_t> UUID,
+                    StringRef DWPName, StringRef Path) {
+  std::unique_ptr<DWARFContext> DICtx = DWARFContext::create(
+      Obj, DWARFContext::ProcessDebugRelocations::Process, nullptr,
+      DWPName.str());
+  if (DICtx->getNumCompileUnits() == 0)
+    return createStringError(errc::invalid_argument, "no debug info");
+
+  gsym::GsymCreator Gsym(/*Quiet=*/true);
+  AddressRanges TextRanges;
+  for (const SectionRef &Sect : Obj.sections()) {
+    if (!Sect.isText() || Sect.getSize() == 0)
+      continue;
+    TextRanges.insert(
+        AddressRange(Sect.getAddress(), Sect.getAddress() + Sect.getSize()));
+  }
+  if (!TextRanges.empty())
+    Gsym.SetValidTextRanges(TextRanges);
+
+  gsym::DwarfTransformer DT(*DICtx, nulls(), Gsym);
+  if (Error Err = DT.convert(hardware_concurrency().compute_thread_count()))
+    return Err;
+  if (Error Err = gsym::ObjectFileTransformer::convert(Obj, nulls(), Gsym))
+    return Err;
+  // A separate debug file carries the build ID of its binary, but be explicit
+  // so the header always matches the cache key.
+  Gsym.setUUID(UUID);
+  if (Error Err = Gsym.finalize(nulls()))
+    return Err;
+
+  // Move the file into place only once it is complete, so that concurrent
+  // symbolizers never open a partial one.
+  Expected<sys::fs::TempFile> Temp =
+      sys::fs::TempFile::create(Path + "-%%%%%%.tmp");
+  if (!Temp)
+    return Temp.takeError();
+  if (Error Err =
+          Gsym.save(Temp->TmpName, support::endian::system_endianness())) {
+    consumeError(Temp->discard());
+    return Err;
+  }
+  return Temp->keep(Path);
+}
+
 } // end anonymous namespace
 
 ObjectFile *LLVMSymbolizer::lookUpDsymFile(const std::string &ExePath,
@@ -584,6 +727,43 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
   return errorCodeToError(object_error::arch_not_found);
 }
 
+std::unique_ptr<DIContext>
+LLVMSymbolizer::getOrCreateGsymContext(const ObjectPair &Objects) {
+  Optional<ArrayRef<uint8_t>> Key = getGsymCacheKey(Objects.first);
+  if (!Key || Key->empty() || Key->size() > gsym::GSYM_MAX_UUID_SIZE)
+    return nullptr;
+
+  SmallString<128> Path(Opts.GsymCacheDirectory);
+  sys::path::append(Path, toHex(*Key, /*LowerCase=*/true) + ".gsym");
+
+  auto OpenCached = [&]() -> std::unique_ptr<gsym::GsymReader> {
+    Expected<gsym::GsymReader> ReaderOrErr = gsym::GsymReader::openFile(Path);
+    if (!ReaderOrErr) {
+      consumeError(ReaderOrErr.takeError());
+      return nullptr;
+    }
+    const gsym::Header &Hdr = ReaderOrErr->getHeader();
+    if (makeArrayRef(Hdr.UUID, Hdr.UUIDSize) != *Key)
+      return nullptr;
+    return std::make_unique<gsym::GsymReader>(std::move(*ReaderOrErr));
+  };
+
+  std::unique_ptr<gsym::GsymReader> Reader = OpenCached();
+  if (!Reader) {
+    // A missing, stale or corrupt entry is replaced by a fresh conversion.
+    if (sys::fs::create_directories(Opts.GsymCacheDirectory))
+      return nullptr;
+    if (Error Err = convertToGsym(*Objects.second, *Key, Opts.DWPName, Path)) {
+      consumeError(std::move(Err));
+      return nullptr;
+    }
+    Reader = OpenCached();
+    if (!Reader)
+      return nullptr;
+  }
+  return std::make_unique<gsym::GsymDIContext>(std::move(Reader));
+}
+
 Expected<SymbolizableModule *>
 LLVMSymbolizer::createModuleInfo(const ObjectFile *Obj,
                                  std::unique_ptr<DIContext> Context,
@@ -651,6 +831,10 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       Context.reset(new PDBContext(*CoffObject, std::move(Session)));
     }
   }
+  // Serve the DWARF through a cached GSYM conversion if asked to, and fall
+  // back to reading it directly if that is not possible.
+  if (!Context && !Opts.GsymCacheDirectory.empty())
+    Context = getOrCreateGsymContext(Objects);
   if (!Context)
     Context = DWARFContext::create(
         *Objects.second, DWARFContext::ProcessDebugRelocations::Process,
@@ -0,0 +1,159 @@
+//===-- llvm/Debuginfod/HTTPCacheStore.cpp - HTTP cache store ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines HTTPCacheStore, which implements the remote tier of a
+/// tieredCache on top of HTTPClient.
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Debuginfod/HTTPCacheStore.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Debuginfod/HTTPClient.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SmallVectorMemoryBuffer.h"
+
+using namespace llvm;
+
+namespace {
+
+/// Collects the response body in memory, discarding it unless the status is
+/// 200 OK.
+class BufferedHTTPResponseHandler : public HTTPResponseHandler {
+  HTTPClient &Client;
+
+public:
+  SmallString<0> Body;
+
+  BufferedHTTPResponseHandler(HTTPClient &Client) : Client(Client) {}
+  virtual ~BufferedHTTPResponseHandler() = default;
+
+  Error handleBodyChunk(StringRef BodyChunk) override {
+    if (Client.responseCode() == 200)
+      Body += BodyChunk;
+    return Error::success();
+  }
+};
+
+} // namespace
+
+static Error checkHTTPClient() {
+  if (!HTTPClient::isAvailable())
+    return createStringError(errc::io_error,
+                             "No working HTTP client is available.");
+  if (!HTTPClient::IsInitialized)
+    return createStringError(
+        errc::io_error,
+        "A working HTTP client is available, but it is not initialized. To "
+        "allow the remote cache to make HTTP requests, call "
+        "HTTPClient::initialize() at the beginning of main.");
+  return Error::success();
+}
+
+HTTPCacheStore::HTTPCacheStore(StringRef BaseUrl,
+                               std::chrono::milliseconds Timeout,
+                               ThreadPoolStrategy PrefetchParallelism)
+    : BaseUrl(BaseUrl.str()), Timeout(Timeout),
+      PrefetchPool(PrefetchParallelism) {}
+
+std::string HTTPCacheStore::getUrl(StringRef Key) const {
+  SmallString<128> Url;
+  sys::path::append(Url, sys::path::Style::posix, BaseUrl, Key);
+  return std::string(Url);
+}
+
+Expected<std::unique_ptr<MemoryBuffer>> HTTPCacheStore::fetch(StringRef Key) {
+  if (Error Err = checkHTTPClient())
+    return std::move(Err);
+
+  HTTPClient Client;
+  Client.setTimeout(Timeout);
+  BufferedHTTPResponseHandler Handler(Client);
+  HTTPRequest Request(getUrl(Key));
+  if (Error Err = Client.perform(Request, Handler))
+    return std::move(Err);
+
+  unsigned Code = Client.responseCode();
+  if (Code == 404)
+    return nullptr;
+  if (Code != 200)
+    return createStringError(errc::io_error, "%s: unexpected HTTP status %u",
+                             Request.Url.c_str(), Code);
+  return std::make_unique<SmallVectorMemoryBuffer>(
+      std::move(Handler.Body), Key, /*RequiresNullTerminator=*/false);
+}
+
+void HTTPCacheStore::prefetch(StringRef Key) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  if (Pending.count(Key) || Prefetched.count(Key))
+    return;
+  std::string KeyStr = Key.str();
+  Pending[Key] = PrefetchPool.async([this, KeyStr]() {
+    Expected<std::unique_ptr<MemoryBuffer>> MBOrErr = fetch(KeyStr);
+    if (!MBOrErr) {
+      // get() will fetch the entry again and report the error then.
+      consumeError(MBOrErr.takeError());
+      return;
+    }
+    std::lock_guard<std::mutex> Lock(Mutex);
+    // Drop the entry if it was discarded while it was being downloaded.
+    if (Pending.count(KeyStr))
+      Prefetched[KeyStr] = std::move(*MBOrErr);
+  });
+}
+
+void HTTPCacheStore::discard(StringRef Key) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Pending.erase(Key);
+  Prefetched.erase(Key);
+}
+
+Expected<std::unique_ptr<MemoryBuffer>> HTTPCacheStore::get(StringRef Key) {
+  std::shared_future<void> Prefetch;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto I = Pending.find(Key);
+    if (I != Pending.end())
+      Prefetch = I->second;
+  }
+
+  if (Prefetch.valid()) {
+    Prefetch.wait();
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Pending.erase(Key);
+    auto I = Prefetched.find(Key);
+    if (I != Prefetched.end()) {
+      std::unique_ptr<MemoryBuffer> MB = std::move(I->second);
+      Prefetched.erase(I);
+      return std::move(MB);
+    }
+  }
+  return fetch(Key);
+}
+
+Error HTTPCacheStore::put(StringRef Key, StringRef Data) {
+  if (Error Err = checkHTTPClient())
+    return Err;
+
+  HTTPClient Client;
+  Client.setTimeout(Timeout);
+  BufferedHTTPResponseHandler Handler(Client);
+  HTTPRequest Request(getUrl(Key));
+  Request.Method = HTTPMethod::PUT;
+  Request.Body = Data;
+  if (Error Err = Client.perform(Request, Handler))
+    return Err;
+
+  unsigned Code = Client.responseCode();
+  if (Code != 200 && Code != 201 && Code != 204)
+    return createStringError(errc::io_error, "%s: unexpected HTTP status %u",
+                             Request.Url.c_str(), Code);
+  return Error::success();
+}
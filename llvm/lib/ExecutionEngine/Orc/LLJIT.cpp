@@ -746,13 +746,13 @@ LLJIT::createCompileFunction(LLJITBuilderState &S,
   // Otherwise default to creating a SimpleCompiler, or ConcurrentIRCompiler,
   // depending on the number of threads requested.
   if (S.NumCompileThreads > 0)
-    return std::make_unique<ConcurrentIRCompiler>(std::move(JTMB));
+    return std::make_unique<ConcurrentIRCompiler>(std::move(JTMB), S.ObjCache);
 
   auto TM = JTMB.createTargetMachine();
   if (!TM)
     return TM.takeError();
 
-  return std::make_unique<TMOwningSimpleCompiler>(std::move(*TM));
+  return std::make_unique<TMOwningSimpleCompiler>(std::move(*TM), S.ObjCache);
 }
 
 LLJIT::LLJIT(LLJITBuilderState &S, Error &Err)
@@ -0,0 +1,126 @@
+//===------ PersistentObjectCache.cpp - On-disk cache of JIT'd objects ----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/BLAKE3.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "orc"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+/// Describe everything in \p JTMB that changes the code generated for a
+/// module. Two builders with the same description produce the same object.
+static std::string getTargetKey(const JITTargetMachineBuilder &JTMB) {
+  std::string Key;
+  raw_string_ostream OS(Key);
+  const TargetOptions &Opts = JTMB.getOptions();
+  OS << LLVM_VERSION_STRING << '\0' << JTMB.getTargetTriple().str() << '\0'
+     << JTMB.getCPU() << '\0' << JTMB.getFeatures().getString() << '\0'
+     << static_cast<int>(JTMB.getCodeGenOptLevel()) << ' '
+     << (JTMB.getRelocationModel() ? *JTMB.getRelocationModel() + 1 : 0) << ' '
+     << (JTMB.getCodeModel() ? *JTMB.getCodeModel() + 1 : 0) << ' '
+     << Opts.UnsafeFPMath << Opts.NoInfsFPMath << Opts.NoNaNsFPMath
+     << Opts.NoSignedZerosFPMath << Opts.EmulatedTLS << Opts.FunctionSections
+     << Opts.DataSections << Opts.EnableFastISel << Opts.EnableGlobalISel << ' '
+     << static_cast<int>(Opts.FloatABIType) << ' '
+     << static_cast<int>(Opts.AllowFPOpFusion) << ' '
+     << static_cast<int>(Opts.ExceptionModel) << ' '
+     << static_cast<int>(Opts.ThreadModel);
+  return OS.str();
+}
+
+Expected<std::unique_ptr<PersistentObjectCache>>
+PersistentObjectCache::Create(StringRef CacheDir,
+                              const JITTargetMachineBuilder &JTMB) {
+  if (auto EC = sys::fs::create_directories(CacheDir))
+    return createFileError(CacheDir, EC);
+  return std::unique_ptr<PersistentObjectCache>(
+      new PersistentObjectCache(CacheDir.str(), getTargetKey(JTMB)));
+}
+
+std::string PersistentObjectCache::getKey(const Module &M) const {
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+  BLAKE3 Hasher;
+  Hasher.update(TargetKey);
+  Hasher.update(ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(Bitcode.data()), Bitcode.size()));
+  return toHex(Hasher.final(), /*LowerCase=*/true);
+}
+
+std::string PersistentObjectCache::getObjectPath(StringRef Key) const {
+  SmallString<256> Path(CacheDir);
+  sys::path::append(Path, Key + ".o");
+  return std::string(Path);
+}
+
+std::unique_ptr<MemoryBuffer>
+PersistentObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+  std::string Path = getObjectPath(Key);
+
+  // Map the object rather than read it: the linker only touches the sections
+  // it loads.
+  auto Obj = MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                   /*RequiresNullTerminator=*/false);
+  if (Obj) {
+    LLVM_DEBUG(dbgs() << "Loaded " << M->getModuleIdentifier() << " from "
+                      << Path << "\n");
+    return std::move(*Obj);
+  }
+
+  // The module is about to be compiled, and passed to notifyObjectCompiled().
+  std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+  PendingKeys[M] = std::move(Key);
+  return nullptr;
+}
+
+void PersistentObjectCache::notifyObjectCompiled(const Module *M,
+                                                 MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getKey(*M);
+
+  // Write to a unique temporary file then rename it, so that other processes
+  // never see a partial object.
+  std::string Path = getObjectPath(Key);
+  SmallString<256> TempModel(Path);
+  TempModel += ".tmp-%%%%%%%%";
+  if (auto Err = writeFileAtomically(TempModel, Path, Obj.getBuffer())) {
+    std::string Msg = toString(std::move(Err));
+    LLVM_DEBUG(dbgs() << "Could not write " << Path << ": " << Msg << "\n");
+    (void)Msg;
+    return;
+  }
+  LLVM_DEBUG(dbgs() << "Stored " << M->getModuleIdentifier() << " in " << Path
+                    << "\n");
+}
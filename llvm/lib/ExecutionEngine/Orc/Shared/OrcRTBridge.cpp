@@ -26,6 +26,14 @@ const char *SimpleExecutorMemoryManagerFinalizeWrapperName =
     "__llvm_orc_SimpleExecutorMemoryManager_finalize_wrapper";
 const char *SimpleExecutorMemoryManagerDeallocateWrapperName =
     "__llvm_orc_SimpleExecutorMemoryManager_deallocate_wrapper";
+const char *SharedMemoryExecutorMemoryManagerInstanceName =
+    "__llvm_orc_SharedMemoryExecutorMemoryManager_Instance";
+const char *SharedMemoryExecutorMemoryManagerReserveWrapperName =
+    "__llvm_orc_SharedMemoryExecutorMemoryManager_reserve_wrapper";
+const char *SharedMemoryExecutorMemoryManagerFinalizeWrapperName =
+    "__llvm_orc_SharedMemoryExecutorMemoryManager_finalize_wrapper";
+const char *SharedMemoryExecutorMemoryManagerDeallocateWrapperName =
+    "__llvm_orc_SharedMemoryExecutorMemoryManager_deallocate_wrapper";
 const char *MemoryWriteUInt8sWrapperName =
     "__llvm_orc_bootstrap_mem_write_uint8s_wrapper";
 const char *MemoryWriteUInt16sWrapperName =
@@ -0,0 +1,248 @@
+//=== SharedMemoryJITLinkMemoryManager.cpp - Link into shared memory -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/SharedMemoryJITLinkMemoryManager.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/JITLink/JITLink.h"
+#include "llvm/ExecutionEngine/Orc/EPCGenericJITLinkMemoryManager.h"
+#include "llvm/ExecutionEngine/Orc/Shared/OrcRTBridge.h"
+
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm::jitlink;
+
+namespace llvm {
+namespace orc {
+
+/// Map \p Size bytes of the shared memory object \p Name in this process.
+static Expected<char *> mapSharedMemory(StringRef Name, uint64_t Size) {
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+  auto ErrnoError = []() {
+    return errorCodeToError(std::error_code(errno, std::generic_category()));
+  };
+  int FD = shm_open(Name.str().c_str(), O_RDWR, 0);
+  if (FD == -1)
+    return ErrnoError();
+  void *Mem = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, FD, 0);
+  if (Mem == MAP_FAILED) {
+    Error Err = ErrnoError();
+    close(FD);
+    return std::move(Err);
+  }
+  close(FD);
+  return static_cast<char *>(Mem);
+#else
+  return make_error<StringError>(
+      "shared memory allocation is not supported on this platform",
+      inconvertibleErrorCode());
+#endif
+}
+
+static void unmapSharedMemory(char *Mem, uint64_t Size) {
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+  munmap(Mem, Size);
+#endif
+}
+
+class SharedMemoryJITLinkMemoryManager::InFlightAlloc
+    : public jitlink::JITLinkMemoryManager::InFlightAlloc {
+public:
+  struct SegInfo {
+    ExecutorAddr Addr;
+    uint64_t Size = 0;
+  };
+
+  using SegInfoMap = AllocGroupSmallMap<SegInfo>;
+
+  InFlightAlloc(SharedMemoryJITLinkMemoryManager &Parent, LinkGraph &G,
+                ExecutorAddr AllocAddr, char *LocalMem, uint64_t AllocSize,
+                SegInfoMap Segs)
+      : Parent(Parent), G(G), AllocAddr(AllocAddr), LocalMem(LocalMem),
+        AllocSize(AllocSize), Segs(std::move(Segs)) {}
+
+  ~InFlightAlloc() {
+    if (LocalMem)
+      unmapSharedMemory(LocalMem, AllocSize);
+  }
+
+  void finalize(OnFinalizedFunction OnFinalize) override {
+    // The content is already in the executor's memory: only send the
+    // protections.
+    tpctypes::FinalizeRequest FR;
+    for (auto &KV : Segs)
+      FR.Segments.push_back(tpctypes::SegFinalizeRequest{
+          tpctypes::toWireProtectionFlags(
+              toSysMemoryProtectionFlags(KV.first.getMemProt())),
+          KV.second.Addr, KV.second.Size, {}});
+
+    // Transfer allocation actions.
+    std::swap(FR.Actions, G.allocActions());
+
+    // The working memory is no longer written to once the graph is finalized.
+    unmapSharedMemory(LocalMem, AllocSize);
+    LocalMem = nullptr;
+
+    Parent.EPC.callSPSWrapperAsync<
+        rt::SPSSharedMemoryExecutorMemoryManagerFinalizeSignature>(
+        Parent.SAs.Finalize,
+        [OnFinalize = std::move(OnFinalize), AllocAddr = this->AllocAddr](
+            Error SerializationErr, Error FinalizeErr) mutable {
+          if (SerializationErr) {
+            cantFail(std::move(FinalizeErr));
+            OnFinalize(std::move(SerializationErr));
+          } else if (FinalizeErr)
+            OnFinalize(std::move(FinalizeErr));
+          else
+            OnFinalize(FinalizedAlloc(AllocAddr));
+        },
+        Parent.SAs.Allocator, std::move(FR));
+  }
+
+  void abandon(OnAbandonedFunction OnAbandoned) override {
+    unmapSharedMemory(LocalMem, AllocSize);
+    LocalMem = nullptr;
+
+    Parent.EPC.callSPSWrapperAsync<
+        rt::SPSSharedMemoryExecutorMemoryManagerDeallocateSignature>(
+        Parent.SAs.Deallocate,
+        [OnAbandoned = std::move(OnAbandoned)](Error SerializationErr,
+                                               Error DeallocateErr) mutable {
+          if (SerializationErr) {
+            cantFail(std::move(DeallocateErr));
+            OnAbandoned(std::move(SerializationErr));
+          } else
+            OnAbandoned(std::move(DeallocateErr));
+        },
+        Parent.SAs.Allocator, ArrayRef<ExecutorAddr>(AllocAddr));
+  }
+
+private:
+  SharedMemoryJITLinkMemoryManager &Parent;
+  LinkGraph &G;
+  ExecutorAddr AllocAddr;
+  char *LocalMem;
+  uint64_t AllocSize;
+  SegInfoMap Segs;
+};
+
+Expected<std::unique_ptr<SharedMemoryJITLinkMemoryManager>>
+SharedMemoryJITLinkMemoryManager::CreateWithDefaultBootstrapSymbols(
+    ExecutorProcessControl &EPC) {
+  SymbolAddrs SAs;
+  if (auto Err = EPC.getBootstrapSymbols(
+          {{SAs.Allocator, rt::SharedMemoryExecutorMemoryManagerInstanceName},
+           {SAs.Reserve,
+            rt::SharedMemoryExecutorMemoryManagerReserveWrapperName},
+           {SAs.Finalize,
+            rt::SharedMemoryExecutorMemoryManagerFinalizeWrapperName},
+           {SAs.Deallocate,
+            rt::SharedMemoryExecutorMemoryManagerDeallocateWrapperName}}))
+    return std::move(Err);
+  return std::make_unique<SharedMemoryJITLinkMemoryManager>(EPC, SAs);
+}
+
+void SharedMemoryJITLinkMemoryManager::allocate(
+    const JITLinkDylib *JD, LinkGraph &G, OnAllocatedFunction OnAllocated) {
+  BasicLayout BL(G);
+
+  auto Pages = BL.getContiguousPageBasedLayoutSizes(EPC.getPageSize());
+  if (!Pages)
+    return OnAllocated(Pages.takeError());
+
+  uint64_t AllocSize = Pages->total();
+  EPC.callSPSWrapperAsync<
+      rt::SPSSharedMemoryExecutorMemoryManagerReserveSignature>(
+      SAs.Reserve,
+      [this, AllocSize, BL = std::move(BL),
+       OnAllocated = std::move(OnAllocated)](
+          Error SerializationErr,
+          Expected<std::pair<ExecutorAddr, std::string>> Reservation) mutable {
+        if (SerializationErr) {
+          cantFail(Reservation.takeError());
+          return OnAllocated(std::move(SerializationErr));
+        }
+        if (!Reservation)
+          return OnAllocated(Reservation.takeError());
+
+        completeAllocation(Reservation->first, Reservation->second, AllocSize,
+                           std::move(BL), std::move(OnAllocated));
+      },
+      SAs.Allocator, AllocSize);
+}
+
+void SharedMemoryJITLinkMemoryManager::deallocate(
+    std::vector<FinalizedAlloc> Allocs, OnDeallocatedFunction OnDeallocated) {
+  EPC.callSPSWrapperAsync<
+      rt::SPSSharedMemoryExecutorMemoryManagerDeallocateSignature>(
+      SAs.Deallocate,
+      [OnDeallocated = std::move(OnDeallocated)](Error SerErr,
+                                                 Error DeallocErr) mutable {
+        if (SerErr) {
+          cantFail(std::move(DeallocErr));
+          OnDeallocated(std::move(SerErr));
+        } else
+          OnDeallocated(std::move(DeallocErr));
+      },
+      SAs.Allocator, Allocs);
+  for (auto &A : Allocs)
+    A.release();
+}
+
+void SharedMemoryJITLinkMemoryManager::completeAllocation(
+    ExecutorAddr AllocAddr, StringRef SharedMemoryName, uint64_t AllocSize,
+    BasicLayout BL, OnAllocatedFunction OnAllocated) {
+  // Return the reservation, which nothing else refers to, on failure.
+  auto ReleaseReservation = [&]() {
+    std::vector<FinalizedAlloc> Reservation;
+    Reservation.push_back(FinalizedAlloc(AllocAddr));
+    deallocate(std::move(Reservation),
+               [](Error Err) { consumeError(std::move(Err)); });
+  };
+
+  auto LocalMem = mapSharedMemory(SharedMemoryName, AllocSize);
+  if (!LocalMem) {
+    ReleaseReservation();
+    return OnAllocated(LocalMem.takeError());
+  }
+
+  // Lay the segments out in the shared memory, which is zero-filled, so that
+  // the graph is linked in place.
+  InFlightAlloc::SegInfoMap SegInfos;
+  ExecutorAddr NextSegAddr = AllocAddr;
+  for (auto &KV : BL.segments()) {
+    const auto &AG = KV.first;
+    auto &Seg = KV.second;
+
+    Seg.Addr = NextSegAddr;
+    Seg.WorkingMem = *LocalMem + (NextSegAddr - AllocAddr);
+    NextSegAddr += ExecutorAddrDiff(
+        alignTo(Seg.ContentSize + Seg.ZeroFillSize, EPC.getPageSize()));
+
+    auto &SegInfo = SegInfos[AG];
+    SegInfo.Addr = ExecutorAddr(Seg.Addr);
+    SegInfo.Size = NextSegAddr - SegInfo.Addr;
+  }
+
+  if (auto Err = BL.apply()) {
+    unmapSharedMemory(*LocalMem, AllocSize);
+    ReleaseReservation();
+    return OnAllocated(std::move(Err));
+  }
+
+  OnAllocated(std::make_unique<InFlightAlloc>(*this, BL.getGraph(), AllocAddr,
+                                              *LocalMem, AllocSize,
+                                              std::move(SegInfos)));
+}
+
+} // end namespace orc
+} // end namespace llvm
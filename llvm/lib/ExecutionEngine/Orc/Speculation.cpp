@@ -16,6 +16,9 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 
 namespace llvm {
 
@@ -39,6 +42,123 @@ void Speculator::speculateForEntryPoint(Speculator *Ptr, uint64_t StubId) {
   Ptr->speculateFor(StubId);
 }
 
+void Speculator::launchCompile(JITTargetAddress FAddr) {
+  SymbolNameSet CandidateSet;
+  // Copy CandidateSet is necessary, to avoid unsynchronized access to
+  // the datastructure.
+  {
+    std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+    auto It = GlobalSpecMap.find(FAddr);
+    if (It == GlobalSpecMap.end())
+      return;
+    CandidateSet = It->getSecond();
+    if (RecordTrace)
+      RecordedTrace.push_back(ImplAddrToSymbol[FAddr]);
+  }
+
+  SmallVector<SpeculationTarget, 8> Targets;
+  for (auto &Callee : CandidateSet) {
+    auto ImplSymbol = AliaseeImplTable.getImplFor(Callee);
+    // try to distinguish already compiled & library symbols
+    if (!ImplSymbol.hasValue())
+      continue;
+    Targets.push_back({ImplSymbol->second, ImplSymbol->first});
+  }
+
+  {
+    std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+    for (auto &T : Targets)
+      if (QueuedSpeculations.insert(T).second)
+        PendingSpeculations.push_back(std::move(T));
+  }
+
+  issueSpeculativeLookups();
+}
+
+void Speculator::issueSpeculativeLookups() {
+  std::unique_lock<std::mutex> Lockit(ConcurrentAccess);
+  // Lookups that complete while this loop runs leave it to pick up the
+  // pending speculations, rather than recursing into it.
+  if (IssuingLookups)
+    return;
+  IssuingLookups = true;
+
+  // Each lookup is a separate materialization: limiting them to the budget
+  // leaves the other dispatcher threads free for the non-speculative
+  // compiles.
+  while (!PendingSpeculations.empty() &&
+         (!SpeculationBudget || InFlightSpeculations < SpeculationBudget)) {
+    SpeculationTarget T = std::move(PendingSpeculations.front());
+    PendingSpeculations.pop_front();
+    ++InFlightSpeculations;
+    Lockit.unlock();
+
+    DEBUG_WITH_TYPE("orc", {
+      dbgs() << "In " << T.first->getName()
+             << " JITDylib, speculatively compiling " << T.second << "\n";
+    });
+
+    ES.lookup(
+        LookupKind::Static,
+        makeJITDylibSearchOrder(T.first, JITDylibLookupFlags::MatchAllSymbols),
+        SymbolLookupSet(T.second), SymbolState::Ready,
+        [this](Expected<SymbolMap> Result) {
+          if (auto Err = Result.takeError())
+            ES.reportError(std::move(Err));
+          {
+            std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+            --InFlightSpeculations;
+          }
+          issueSpeculativeLookups();
+        },
+        NoDependenciesToRegister);
+
+    Lockit.lock();
+  }
+
+  IssuingLookups = false;
+}
+
+Error Speculator::saveCallTrace(StringRef Path) {
+  std::vector<SymbolStringPtr> Trace;
+  {
+    std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+    Trace = RecordedTrace;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::OF_Text);
+  if (EC)
+    return createFileError(Path, EC);
+  for (auto &Name : Trace)
+    OS << *Name << "\n";
+  return Error::success();
+}
+
+Error Speculator::loadCallTrace(StringRef Path, unsigned Lookahead) {
+  auto Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return createFileError(Path, Buffer.getError());
+
+  SmallVector<StringRef, 0> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n', -1, false);
+  std::vector<SymbolStringPtr> Trace;
+  for (auto Line : Lines) {
+    Line = Line.trim();
+    if (!Line.empty())
+      Trace.push_back(ES.intern(Line));
+  }
+
+  std::lock_guard<std::mutex> Lockit(ConcurrentAccess);
+  for (size_t I = 0, E = Trace.size(); I != E; ++I) {
+    auto &Likely = TraceLikelies[Trace[I]];
+    for (size_t J = I + 1; J != E && J <= I + Lookahead; ++J)
+      if (Trace[J] != Trace[I])
+        Likely.insert(Trace[J]);
+  }
+  return Error::success();
+}
+
 Error Speculator::addSpeculationRuntime(JITDylib &JD,
                                         MangleAndInterner &Mangle) {
   JITEvaluatedSymbol ThisPtr(pointerToJITTargetAddress(this),
@@ -84,6 +204,13 @@ void IRSpeculationLayer::emit(std::unique_ptr<MaterializationResponsibility> R,
       if (!Fn.isDeclaration()) {
 
         auto IRNames = QueryAnalysis(Fn);
+        // Functions without likely callees are still instrumented to enter
+        // them in the call trace, or to speculate on the functions that
+        // followed them in a recorded one.
+        if (!IRNames.hasValue() && S.shouldInstrument(Mangle(Fn.getName()))) {
+          IRNames.emplace();
+          (*IRNames)[Fn.getName()];
+        }
         // Instrument and register if Query has result
         if (IRNames.hasValue()) {
 
@@ -0,0 +1,309 @@
+//===- SharedMemoryExecutorMemoryManager.cpp - Shared memory allocator ----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/TargetProcess/SharedMemoryExecutorMemoryManager.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/Shared/OrcRTBridge.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/Process.h"
+
+#include <limits>
+
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define DEBUG_TYPE "orc"
+
+namespace llvm {
+namespace orc {
+namespace rt_bootstrap {
+
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+static Error errnoError() {
+  return errorCodeToError(std::error_code(errno, std::generic_category()));
+}
+#endif
+
+SharedMemoryExecutorMemoryManager::~SharedMemoryExecutorMemoryManager() {
+  assert(Allocations.empty() && "shutdown not called?");
+}
+
+Expected<std::pair<ExecutorAddr, std::string>>
+SharedMemoryExecutorMemoryManager::reserve(uint64_t Size) {
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+  std::string Name;
+  {
+    std::lock_guard<std::mutex> Lock(M);
+    Name = formatv("/llvm_orc_{0}_{1}", sys::Process::getProcessId(),
+                   NextSharedMemoryId++)
+               .str();
+  }
+
+  int FD = shm_open(Name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (FD == -1)
+    return errnoError();
+  if (ftruncate(FD, Size) == -1) {
+    Error Err = errnoError();
+    close(FD);
+    shm_unlink(Name.c_str());
+    return std::move(Err);
+  }
+  void *Base = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, FD, 0);
+  if (Base == MAP_FAILED) {
+    Error Err = errnoError();
+    close(FD);
+    shm_unlink(Name.c_str());
+    return std::move(Err);
+  }
+  close(FD);
+
+  std::lock_guard<std::mutex> Lock(M);
+  assert(!Allocations.count(Base) && "Duplicate allocation addr");
+  Allocations[Base].Size = Size;
+  Allocations[Base].SharedMemoryName = Name;
+  return std::make_pair(ExecutorAddr::fromPtr(Base), std::move(Name));
+#else
+  return make_error<StringError>(
+      "shared memory allocation is not supported on this platform",
+      inconvertibleErrorCode());
+#endif
+}
+
+Error SharedMemoryExecutorMemoryManager::finalize(
+    tpctypes::FinalizeRequest &FR) {
+  ExecutorAddr Base(~0ULL);
+  std::vector<shared::WrapperFunctionCall> DeallocationActions;
+  size_t SuccessfulFinalizationActions = 0;
+
+  if (FR.Segments.empty()) {
+    if (FR.Actions.empty())
+      return Error::success();
+    return make_error<StringError>("Finalization actions attached to empty "
+                                   "finalization request",
+                                   inconvertibleErrorCode());
+  }
+
+  for (auto &Seg : FR.Segments)
+    Base = std::min(Base, Seg.Addr);
+
+  for (auto &ActPair : FR.Actions)
+    if (ActPair.Dealloc)
+      DeallocationActions.push_back(ActPair.Dealloc);
+
+  // Get the Allocation for this finalization. The controller has mapped the
+  // shared memory by now, so its name is no longer needed.
+  size_t AllocSize = 0;
+  std::string SharedMemoryName;
+  {
+    std::lock_guard<std::mutex> Lock(M);
+    auto I = Allocations.find(Base.toPtr<void *>());
+    if (I == Allocations.end())
+      return make_error<StringError>("Attempt to finalize unrecognized "
+                                     "allocation " +
+                                         formatv("{0:x}", Base.getValue()),
+                                     inconvertibleErrorCode());
+    AllocSize = I->second.Size;
+    I->second.DeallocationActions = std::move(DeallocationActions);
+    SharedMemoryName = std::move(I->second.SharedMemoryName);
+    I->second.SharedMemoryName.clear();
+  }
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+  if (!SharedMemoryName.empty())
+    shm_unlink(SharedMemoryName.c_str());
+#endif
+  ExecutorAddr AllocEnd = Base + ExecutorAddrDiff(AllocSize);
+
+  // Bail-out function: this will run deallocation actions corresponding to any
+  // completed finalization actions, then deallocate memory.
+  auto BailOut = [&](Error Err) {
+    std::pair<void *, Allocation> AllocToDestroy;
+
+    // Get allocation to destroy.
+    {
+      std::lock_guard<std::mutex> Lock(M);
+      auto I = Allocations.find(Base.toPtr<void *>());
+
+      // Check for missing allocation (effective a double free).
+      if (I == Allocations.end())
+        return joinErrors(
+            std::move(Err),
+            make_error<StringError>("No allocation entry found "
+                                    "for " +
+                                        formatv("{0:x}", Base.getValue()),
+                                    inconvertibleErrorCode()));
+      AllocToDestroy = std::move(*I);
+      Allocations.erase(I);
+    }
+
+    // Run deallocation actions for all completed finalization actions.
+    while (SuccessfulFinalizationActions)
+      Err =
+          joinErrors(std::move(Err), FR.Actions[--SuccessfulFinalizationActions]
+                                         .Dealloc.runWithSPSRetErrorMerged());
+
+    // Deallocate memory.
+    AllocToDestroy.second.DeallocationActions.clear();
+    return joinErrors(std::move(Err), deallocateImpl(AllocToDestroy.first,
+                                                     AllocToDestroy.second));
+  };
+
+  // Apply permissions. The content has been written through the controller's
+  // mapping, except for any that comes with the request.
+  for (auto &Seg : FR.Segments) {
+    ExecutorAddr SegEnd = Seg.Addr + ExecutorAddrDiff(Seg.Size);
+    if (LLVM_UNLIKELY(Seg.Size < Seg.Content.size() || SegEnd > AllocEnd))
+      return BailOut(make_error<StringError>(
+          formatv("Segment {0:x} -- {1:x} crosses boundary of "
+                  "allocation {2:x} -- {3:x}",
+                  Seg.Addr.getValue(), SegEnd.getValue(), Base.getValue(),
+                  AllocEnd.getValue()),
+          inconvertibleErrorCode()));
+
+    char *Mem = Seg.Addr.toPtr<char *>();
+    if (!Seg.Content.empty())
+      memcpy(Mem, Seg.Content.data(), Seg.Content.size());
+    assert(Seg.Size <= std::numeric_limits<size_t>::max());
+    if (auto EC = sys::Memory::protectMappedMemory(
+            {Mem, static_cast<size_t>(Seg.Size)},
+            tpctypes::fromWireProtectionFlags(Seg.Prot)))
+      return BailOut(errorCodeToError(EC));
+    if (Seg.Prot & tpctypes::WPF_Exec)
+      sys::Memory::InvalidateInstructionCache(Mem, Seg.Size);
+  }
+
+  // Run finalization actions.
+  for (auto &ActPair : FR.Actions) {
+    if (auto Err = ActPair.Finalize.runWithSPSRetErrorMerged())
+      return BailOut(std::move(Err));
+    ++SuccessfulFinalizationActions;
+  }
+
+  return Error::success();
+}
+
+Error SharedMemoryExecutorMemoryManager::deallocate(
+    const std::vector<ExecutorAddr> &Bases) {
+  std::vector<std::pair<void *, Allocation>> AllocPairs;
+  AllocPairs.reserve(Bases.size());
+
+  // Get allocation to destroy.
+  Error Err = Error::success();
+  {
+    std::lock_guard<std::mutex> Lock(M);
+    for (auto &Base : Bases) {
+      auto I = Allocations.find(Base.toPtr<void *>());
+
+      // Check for missing allocation (effective a double free).
+      if (I != Allocations.end()) {
+        AllocPairs.push_back(std::move(*I));
+        Allocations.erase(I);
+      } else
+        Err = joinErrors(
+            std::move(Err),
+            make_error<StringError>("No allocation entry found "
+                                    "for " +
+                                        formatv("{0:x}", Base.getValue()),
+                                    inconvertibleErrorCode()));
+    }
+  }
+
+  while (!AllocPairs.empty()) {
+    auto &P = AllocPairs.back();
+    Err = joinErrors(std::move(Err), deallocateImpl(P.first, P.second));
+    AllocPairs.pop_back();
+  }
+
+  return Err;
+}
+
+Error SharedMemoryExecutorMemoryManager::shutdown() {
+  AllocationsMap AM;
+  {
+    std::lock_guard<std::mutex> Lock(M);
+    AM = std::move(Allocations);
+  }
+
+  Error Err = Error::success();
+  for (auto &KV : AM)
+    Err = joinErrors(std::move(Err), deallocateImpl(KV.first, KV.second));
+  return Err;
+}
+
+void SharedMemoryExecutorMemoryManager::addBootstrapSymbols(
+    StringMap<ExecutorAddr> &M) {
+  M[rt::SharedMemoryExecutorMemoryManagerInstanceName] =
+      ExecutorAddr::fromPtr(this);
+  M[rt::SharedMemoryExecutorMemoryManagerReserveWrapperName] =
+      ExecutorAddr::fromPtr(&reserveWrapper);
+  M[rt::SharedMemoryExecutorMemoryManagerFinalizeWrapperName] =
+      ExecutorAddr::fromPtr(&finalizeWrapper);
+  M[rt::SharedMemoryExecutorMemoryManagerDeallocateWrapperName] =
+      ExecutorAddr::fromPtr(&deallocateWrapper);
+}
+
+Error SharedMemoryExecutorMemoryManager::deallocateImpl(void *Base,
+                                                        Allocation &A) {
+  Error Err = Error::success();
+
+  while (!A.DeallocationActions.empty()) {
+    Err = joinErrors(std::move(Err),
+                     A.DeallocationActions.back().runWithSPSRetErrorMerged());
+    A.DeallocationActions.pop_back();
+  }
+
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+  if (munmap(Base, A.Size) == -1)
+    Err = joinErrors(std::move(Err), errnoError());
+  if (!A.SharedMemoryName.empty())
+    shm_unlink(A.SharedMemoryName.c_str());
+#endif
+
+  return Err;
+}
+
+llvm::orc::shared::CWrapperFunctionResult
+SharedMemoryExecutorMemoryManager::reserveWrapper(const char *ArgData,
+                                                  size_t ArgSize) {
+  return shared::WrapperFunction<
+             rt::SPSSharedMemoryExecutorMemoryManagerReserveSignature>::
+      handle(ArgData, ArgSize,
+             shared::makeMethodWrapperHandler(
+                 &SharedMemoryExecutorMemoryManager::reserve))
+          .release();
+}
+
+llvm::orc::shared::CWrapperFunctionResult
+SharedMemoryExecutorMemoryManager::finalizeWrapper(const char *ArgData,
+                                                   size_t ArgSize) {
+  return shared::WrapperFunction<
+             rt::SPSSharedMemoryExecutorMemoryManagerFinalizeSignature>::
+      handle(ArgData, ArgSize,
+             shared::makeMethodWrapperHandler(
+                 &SharedMemoryExecutorMemoryManager::finalize))
+          .release();
+}
+
+llvm::orc::shared::CWrapperFunctionResult
+SharedMemoryExecutorMemoryManager::deallocateWrapper(const char *ArgData,
+                                                     size_t ArgSize) {
+  return shared::WrapperFunction<
+             rt::SPSSharedMemoryExecutorMemoryManagerDeallocateSignature>::
+      handle(ArgData, ArgSize,
+             shared::makeMethodWrapperHandler(
+                 &SharedMemoryExecutorMemoryManager::deallocate))
+          .release();
+}
+
+} // namespace rt_bootstrap
+} // end namespace orc
+} // end namespace llvm
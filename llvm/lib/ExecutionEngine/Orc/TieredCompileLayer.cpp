@@ -0,0 +1,374 @@
+//===------ TieredCompileLayer.cpp - Recompile hot functions --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/TieredCompileLayer.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#define DEBUG_TYPE "orc"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+/// Rename each function of \p M called one of \p Names by appending \p Suffix
+/// to its name, and make every use of it, in \p M and outside, go through a
+/// declaration with the original name, which resolves to the stub. Return the
+/// renamed functions.
+static std::vector<GlobalValue *>
+redirectToStubs(Module &M, ArrayRef<std::string> Names, StringRef Suffix) {
+  std::vector<GlobalValue *> Renamed;
+  for (const auto &Name : Names) {
+    Function *F = M.getFunction(Name);
+    assert(F && !F->isDeclaration() && "No definition to redirect");
+    F->setName(Name + Suffix);
+    F->setVisibility(GlobalValue::HiddenVisibility);
+
+    Function *Decl =
+        Function::Create(F->getFunctionType(), GlobalValue::ExternalLinkage,
+                         F->getAddressSpace(), Name, &M);
+    Decl->setCallingConv(F->getCallingConv());
+    Decl->setAttributes(F->getAttributes());
+    F->replaceAllUsesWith(Decl);
+    Renamed.push_back(F);
+  }
+  return Renamed;
+}
+
+/// Make \p F count its calls, and call the tier-up runtime for \p ModuleId on
+/// the \p Threshold'th one.
+static void addCallCounter(Function &F, uint64_t ModuleId, uint64_t Threshold) {
+  Module &M = *F.getParent();
+  LLVMContext &Ctx = M.getContext();
+  Type *Int8Ty = Type::getInt8Ty(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+
+  auto *Counter = new GlobalVariable(
+      M, Int64Ty, false, GlobalValue::InternalLinkage,
+      ConstantInt::get(Int64Ty, 0), "__orc_tier.count." + F.getName());
+  Constant *Layer = M.getOrInsertGlobal("__orc_tiered_layer", Int8Ty);
+  FunctionCallee TierUp = M.getOrInsertFunction(
+      "__orc_tier_up", Type::getVoidTy(Ctx), Layer->getType(), Int64Ty);
+
+  // Count after the allocas, which must stay in the entry block to remain
+  // static.
+  BasicBlock::iterator IP = F.getEntryBlock().getFirstInsertionPt();
+  while (isa<AllocaInst>(IP))
+    ++IP;
+  IRBuilder<> Builder(&*IP);
+  Value *Count =
+      Builder.CreateAtomicRMW(AtomicRMWInst::Add, Counter,
+                              ConstantInt::get(Int64Ty, 1), MaybeAlign(),
+                              AtomicOrdering::Monotonic);
+  Value *IsHot = Builder.CreateICmpEQ(Count,
+                                      ConstantInt::get(Int64Ty, Threshold - 1));
+  Instruction *ThenTerm = SplitBlockAndInsertIfThen(
+      IsHot, &*IP, /*Unreachable=*/false,
+      MDBuilder(Ctx).createBranchWeights(1, (1U << 20) - 1));
+  Builder.SetInsertPoint(ThenTerm);
+  Builder.CreateCall(TierUp, {Layer, ConstantInt::get(Int64Ty, ModuleId)});
+}
+
+/// Forwards to the stubs manager built for a JITDylib, but keeps the stubs of
+/// the functions that tiered up pointed at their tier-1 code: the lazy
+/// call-through to a tier-0 function may report its address to the stubs
+/// manager only after the function got hot on another thread.
+class TieredCompileLayer::TierStubsManager final : public IndirectStubsManager {
+public:
+  TierStubsManager(std::unique_ptr<IndirectStubsManager> ISMgr)
+      : ISMgr(std::move(ISMgr)) {}
+
+  // A stub created again, for a module added again, starts over at tier 0.
+  Error createStub(StringRef StubName, JITTargetAddress StubAddr,
+                   JITSymbolFlags StubFlags) override {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    TieredUp.erase(StubName);
+    return ISMgr->createStub(StubName, StubAddr, StubFlags);
+  }
+
+  Error createStubs(const StubInitsMap &StubInits) override {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    for (auto &KV : StubInits)
+      TieredUp.erase(KV.first());
+    return ISMgr->createStubs(StubInits);
+  }
+
+  JITEvaluatedSymbol findStub(StringRef Name, bool ExportedStubsOnly) override {
+    return ISMgr->findStub(Name, ExportedStubsOnly);
+  }
+
+  JITEvaluatedSymbol findPointer(StringRef Name) override {
+    return ISMgr->findPointer(Name);
+  }
+
+  Error updatePointer(StringRef Name, JITTargetAddress NewAddr) override {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    if (TieredUp.count(Name))
+      return Error::success();
+    return ISMgr->updatePointer(Name, NewAddr);
+  }
+
+  /// Point the stub \p Name at \p Tier1Addr for good.
+  Error tierUp(StringRef Name, JITTargetAddress Tier1Addr) {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    TieredUp.insert(Name);
+    return ISMgr->updatePointer(Name, Tier1Addr);
+  }
+
+private:
+  std::mutex StubsMutex;
+  std::unique_ptr<IndirectStubsManager> ISMgr;
+  StringSet<> TieredUp;
+};
+
+TieredCompileLayer::TieredCompileLayer(
+    ExecutionSession &ES, IRLayer &Tier0Layer, IRLayer &Tier1Layer,
+    LazyCallThroughManager &LCTMgr,
+    IndirectStubsManagerBuilder BuildIndirectStubsManager,
+    uint64_t HotCallThreshold)
+    : IRLayer(ES, Tier0Layer.getManglingOptions()), Tier0Layer(Tier0Layer),
+      Tier1Layer(Tier1Layer), LCTMgr(LCTMgr),
+      BuildIndirectStubsManager(std::move(BuildIndirectStubsManager)),
+      HotCallThreshold(HotCallThreshold) {
+  assert(HotCallThreshold && "Functions would never get hot");
+  ES.registerResourceManager(*this);
+}
+
+TieredCompileLayer::~TieredCompileLayer() {
+  getExecutionSession().deregisterResourceManager(*this);
+}
+
+Error TieredCompileLayer::addTieringRuntime(JITDylib &JD,
+                                            MangleAndInterner &Mangle) {
+  JITEvaluatedSymbol ThisPtr(pointerToJITTargetAddress(this),
+                             JITSymbolFlags::Exported);
+  JITEvaluatedSymbol TierUpEntryPtr(
+      pointerToJITTargetAddress(&tierUpEntryPoint), JITSymbolFlags::Exported);
+  return JD.define(absoluteSymbols({
+      {Mangle("__orc_tiered_layer"), ThisPtr},  // Data Symbol
+      {Mangle("__orc_tier_up"), TierUpEntryPtr} // Callable Symbol
+  }));
+}
+
+void TieredCompileLayer::emit(std::unique_ptr<MaterializationResponsibility> R,
+                              ThreadSafeModule TSM) {
+  assert(TSM && "Null module");
+
+  auto &ES = getExecutionSession();
+  auto &JD = R->getTargetJITDylib();
+  auto &ISMgr = getISManager(JD);
+
+  SymbolAliasMap Stubs;
+  auto Err = TSM.withModuleDo([&](Module &M) -> Error {
+    MangleAndInterner Mangle(ES, M.getDataLayout());
+
+    // The tier-1 code refers to the definitions of the tier-0 code that are
+    // not redirected to stubs, so these have to be visible.
+    std::vector<GlobalValue *> PromotedGlobals;
+    {
+      std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+      PromotedGlobals = PromoteSymbols(M);
+    }
+    if (!PromotedGlobals.empty()) {
+      SymbolFlagsMap SymbolFlags;
+      IRSymbolMapper::add(ES, *getManglingOptions(), PromotedGlobals,
+                          SymbolFlags);
+      if (auto Err = R->defineMaterializing(std::move(SymbolFlags)))
+        return Err;
+    }
+
+    // Redirect the functions that this module is responsible for. Functions
+    // whose blocks have their address taken can not be separated from their
+    // body.
+    std::vector<std::string> Names;
+    for (auto &F : M) {
+      if (F.isDeclaration() || F.hasAvailableExternallyLinkage() ||
+          any_of(F, [](BasicBlock &BB) { return BB.hasAddressTaken(); }))
+        continue;
+      auto I = R->getSymbols().find(Mangle(F.getName()));
+      if (I != R->getSymbols().end() && I->second.isCallable())
+        Names.push_back(F.getName().str());
+    }
+    if (Names.empty())
+      return Error::success();
+
+    // Keep the tier-1 module as bitcode. The other functions are kept as
+    // available_externally to be inlined, and the variables as declarations.
+    TierUpInfo Info;
+    Info.JD = &JD;
+    Info.ISMgr = &ISMgr;
+    {
+      ValueToValueMapTy VMap;
+      auto Tier1M = CloneModule(
+          M, VMap, [](const GlobalValue *GV) { return isa<Function>(GV); });
+      for (auto &GV : make_early_inc_range(Tier1M->globals()))
+        if (GV.getName().startswith("llvm.") && GV.isDeclaration())
+          GV.eraseFromParent();
+      for (auto &F : *Tier1M)
+        if (!F.isDeclaration() && !is_contained(Names, F.getName())) {
+          F.setLinkage(GlobalValue::AvailableExternallyLinkage);
+          F.setComdat(nullptr);
+        }
+      redirectToStubs(*Tier1M, Names, ".__orc_tier1");
+      raw_svector_ostream OS(Info.Bitcode);
+      WriteBitcodeToFile(*Tier1M, OS);
+    }
+    for (auto &Name : Names)
+      Info.Stubs.push_back(
+          {Mangle(Name), Mangle((Twine(Name) + ".__orc_tier1").str())});
+
+    uint64_t ModuleId;
+    {
+      std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+      ModuleId = NextModuleId++;
+    }
+    if (auto Err = R->withResourceKeyDo([&](ResourceKey K) {
+          std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+          TierUps[ModuleId] = std::move(Info);
+          ModuleIds[K].push_back(ModuleId);
+        }))
+      return Err;
+
+    // Emit the module as tier 0, with its functions behind stubs.
+    auto Tier0Functions = redirectToStubs(M, Names, ".__orc_tier0");
+    for (auto *GV : Tier0Functions)
+      addCallCounter(cast<Function>(*GV), ModuleId, HotCallThreshold);
+
+    SymbolFlagsMap Tier0Flags;
+    IRSymbolMapper::add(ES, *getManglingOptions(), Tier0Functions, Tier0Flags);
+    for (auto &Name : Names) {
+      auto StubName = Mangle(Name);
+      Stubs[StubName] =
+          SymbolAliasMapEntry(Mangle((Twine(Name) + ".__orc_tier0").str()),
+                              R->getSymbols().lookup(StubName));
+    }
+    return R->defineMaterializing(std::move(Tier0Flags));
+  });
+
+  if (Err) {
+    ES.reportError(std::move(Err));
+    R->failMaterialization();
+    return;
+  }
+
+  if (!Stubs.empty())
+    if (auto Err = R->replace(lazyReexports(LCTMgr, ISMgr, JD,
+                                            std::move(Stubs)))) {
+      ES.reportError(std::move(Err));
+      R->failMaterialization();
+      return;
+    }
+
+  Tier0Layer.emit(std::move(R), std::move(TSM));
+}
+
+void TieredCompileLayer::tierUpEntryPoint(TieredCompileLayer *Layer,
+                                          uint64_t ModuleId) {
+  assert(Layer && "Null layer received in __orc_tier_up");
+  Layer->tierUp(ModuleId);
+}
+
+TieredCompileLayer::TierStubsManager &
+TieredCompileLayer::getISManager(JITDylib &JD) {
+  std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+  auto &ISMgr = ISMgrs[&JD];
+  if (!ISMgr)
+    ISMgr = std::make_unique<TierStubsManager>(BuildIndirectStubsManager());
+  return *ISMgr;
+}
+
+void TieredCompileLayer::tierUp(uint64_t ModuleId) {
+  TierUpInfo Info;
+  {
+    std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+    assert(ModuleId < NextModuleId && "Unknown module");
+    // Each function of the module reaches the threshold once, and the module
+    // may have been removed since.
+    auto I = TierUps.find(ModuleId);
+    if (I == TierUps.end())
+      return;
+    Info = std::move(I->second);
+    TierUps.erase(I);
+  }
+
+  getExecutionSession().dispatchTask(makeGenericNamedTask(
+      [this, Info = std::move(Info)]() mutable { emitTier1(std::move(Info)); },
+      "TieredCompileLayer tier-up"));
+}
+
+void TieredCompileLayer::emitTier1(TierUpInfo Info) {
+  auto &ES = getExecutionSession();
+
+  auto Ctx = std::make_unique<LLVMContext>();
+  auto M = parseBitcodeFile(
+      MemoryBufferRef(StringRef(Info.Bitcode.data(), Info.Bitcode.size()),
+                      "tier-1 module"),
+      *Ctx);
+  if (!M) {
+    ES.reportError(M.takeError());
+    return;
+  }
+  LLVM_DEBUG(dbgs() << "Tiering up " << (*M)->getModuleIdentifier() << "\n");
+  if (auto Err = Tier1Layer.add(
+          *Info.JD, ThreadSafeModule(std::move(*M), std::move(Ctx)))) {
+    ES.reportError(std::move(Err));
+    return;
+  }
+
+  // Point the stubs at the tier-1 functions once they are ready. Calls that
+  // are in flight finish in the tier-0 code, which stays in memory.
+  SymbolLookupSet Tier1Symbols;
+  for (auto &KV : Info.Stubs)
+    Tier1Symbols.add(KV.second);
+  ES.lookup(
+      LookupKind::Static,
+      makeJITDylibSearchOrder(Info.JD, JITDylibLookupFlags::MatchAllSymbols),
+      std::move(Tier1Symbols), SymbolState::Ready,
+      [&ES, ISMgr = Info.ISMgr,
+       Stubs = std::move(Info.Stubs)](Expected<SymbolMap> Result) {
+        if (!Result) {
+          ES.reportError(Result.takeError());
+          return;
+        }
+        for (auto &KV : Stubs)
+          if (auto Err =
+                  ISMgr->tierUp(*KV.first, (*Result)[KV.second].getAddress()))
+            ES.reportError(std::move(Err));
+      },
+      NoDependenciesToRegister);
+}
+
+Error TieredCompileLayer::handleRemoveResources(ResourceKey K) {
+  std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+  auto I = ModuleIds.find(K);
+  if (I == ModuleIds.end())
+    return Error::success();
+  for (uint64_t ModuleId : I->second)
+    TierUps.erase(ModuleId);
+  ModuleIds.erase(I);
+  return Error::success();
+}
+
+void TieredCompileLayer::handleTransferResources(ResourceKey DstK,
+                                                 ResourceKey SrcK) {
+  std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+  auto I = ModuleIds.find(SrcK);
+  if (I == ModuleIds.end())
+    return;
+  auto SrcIds = std::move(I->second);
+  ModuleIds.erase(I);
+  auto &DstIds = ModuleIds[DstK];
+  DstIds.insert(DstIds.end(), SrcIds.begin(), SrcIds.end());
+}
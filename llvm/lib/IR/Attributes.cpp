@@ -100,6 +100,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
   ID.AddInteger(Kind);
   if (Val) ID.AddInteger(Val);
 
+  UniquingLock Lock(pImpl->TypeLock);
   void *InsertPoint;
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -123,6 +124,7 @@ Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   ID.AddString(Kind);
   if (!Val.empty()) ID.AddString(Val);
 
+  UniquingLock Lock(pImpl->TypeLock);
   void *InsertPoint;
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -148,6 +150,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
   ID.AddInteger(Kind);
   ID.AddPointer(Ty);
 
+  UniquingLock Lock(pImpl->TypeLock);
   void *InsertPoint;
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -478,6 +481,7 @@ bool Attribute::hasParentContext(LLVMContext &C) const {
   assert(isValid() && "invalid Attribute doesn't refer to any context");
   FoldingSetNodeID ID;
   pImpl->Profile(ID);
+  UniquingLock Lock(C.pImpl->TypeLock);
   void *Unused;
   return C.pImpl->AttrsSet.FindNodeOrInsertPos(ID, Unused) == pImpl;
 }
@@ -743,6 +747,7 @@ bool AttributeSet::hasParentContext(LLVMContext &C) const {
   assert(hasAttributes() && "empty AttributeSet doesn't refer to any context");
   FoldingSetNodeID ID;
   SetNode->Profile(ID);
+  UniquingLock Lock(C.pImpl->TypeLock);
   void *Unused;
   return C.pImpl->AttrsSetNodes.FindNodeOrInsertPos(ID, Unused) == SetNode;
 }
@@ -800,6 +805,7 @@ AttributeSetNode *AttributeSetNode::getSorted(LLVMContext &C,
   for (const auto &Attr : SortedAttrs)
     Attr.Profile(ID);
 
+  UniquingLock Lock(pImpl->TypeLock);
   void *InsertPoint;
   AttributeSetNode *PA =
     pImpl->AttrsSetNodes.FindNodeOrInsertPos(ID, InsertPoint);
@@ -992,6 +998,7 @@ AttributeList AttributeList::getImpl(LLVMContext &C,
   FoldingSetNodeID ID;
   AttributeListImpl::Profile(ID, AttrSets);
 
+  UniquingLock Lock(pImpl->TypeLock);
   void *InsertPoint;
   AttributeListImpl *PA =
       pImpl->AttrsLists.FindNodeOrInsertPos(ID, InsertPoint);
@@ -1478,6 +1485,7 @@ bool AttributeList::hasParentContext(LLVMContext &C) const {
   assert(!isEmpty() && "an empty attribute list has no parent context");
   FoldingSetNodeID ID;
   pImpl->Profile(ID);
+  UniquingLock Lock(C.pImpl->TypeLock);
   void *Unused;
   return C.pImpl->AttrsLists.FindNodeOrInsertPos(ID, Unused) == pImpl;
 }
@@ -866,6 +866,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt &V)
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
   return pImpl->TheTrueVal;
@@ -873,6 +874,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
   return pImpl->TheFalseVal;
@@ -906,6 +908,7 @@ Constant *ConstantInt::getBool(Type *Ty, bool V) {
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   std::unique_ptr<ConstantInt> &Slot = pImpl->IntConstants[V];
   if (!Slot) {
     // Get the corresponding integer type for the bit width of the value.
@@ -1060,6 +1063,7 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
 
   std::unique_ptr<ConstantFP> &Slot = pImpl->FPConstants[V];
 
@@ -1282,6 +1286,7 @@ ConstantArray::ConstantArray(ArrayType *T, ArrayRef<Constant *> V)
 Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(Ty, V))
     return C;
+  UniquingLock Lock(Ty->getContext().pImpl->ConstantLock);
   return Ty->getContext().pImpl->ArrayConstants.getOrCreate(Ty, V);
 }
 
@@ -1376,6 +1381,7 @@ Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(ST);
 
+  UniquingLock Lock(ST->getContext().pImpl->ConstantLock);
   return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
 }
 
@@ -1390,6 +1396,7 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
   if (Constant *C = getImpl(V))
     return C;
   auto *Ty = FixedVectorType::get(V.front()->getType(), V.size());
+  UniquingLock Lock(Ty->getContext().pImpl->ConstantLock);
   return Ty->getContext().pImpl->VectorConstants.getOrCreate(Ty, V);
 }
 
@@ -1461,6 +1468,7 @@ Constant *ConstantVector::getSplat(ElementCount EC, Constant *V) {
 
 ConstantTokenNone *ConstantTokenNone::get(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   if (!pImpl->TheNoneToken)
     pImpl->TheNoneToken.reset(new ConstantTokenNone(Context));
   return pImpl->TheNoneToken.get();
@@ -1649,6 +1657,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
 
+  UniquingLock Lock(Ty->getContext().pImpl->ConstantLock);
   std::unique_ptr<ConstantAggregateZero> &Entry =
       Ty->getContext().pImpl->CAZConstants[Ty];
   if (!Entry)
@@ -1659,11 +1668,13 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 
 /// Remove the constant from the constant table.
 void ConstantAggregateZero::destroyConstantImpl() {
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   getContext().pImpl->CAZConstants.erase(getType());
 }
 
 /// Remove the constant from the constant table.
 void ConstantArray::destroyConstantImpl() {
+  UniquingLock Lock(getType()->getContext().pImpl->ConstantLock);
   getType()->getContext().pImpl->ArrayConstants.remove(this);
 }
 
@@ -1673,11 +1684,13 @@ void ConstantArray::destroyConstantImpl() {
 
 /// Remove the constant from the constant table.
 void ConstantStruct::destroyConstantImpl() {
+  UniquingLock Lock(getType()->getContext().pImpl->ConstantLock);
   getType()->getContext().pImpl->StructConstants.remove(this);
 }
 
 /// Remove the constant from the constant table.
 void ConstantVector::destroyConstantImpl() {
+  UniquingLock Lock(getType()->getContext().pImpl->ConstantLock);
   getType()->getContext().pImpl->VectorConstants.remove(this);
 }
 
@@ -1753,6 +1766,7 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  UniquingLock Lock(Ty->getContext().pImpl->ConstantLock);
   std::unique_ptr<ConstantPointerNull> &Entry =
       Ty->getContext().pImpl->CPNConstants[Ty];
   if (!Entry)
@@ -1763,10 +1777,12 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 
 /// Remove the constant from the constant table.
 void ConstantPointerNull::destroyConstantImpl() {
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   getContext().pImpl->CPNConstants.erase(getType());
 }
 
 UndefValue *UndefValue::get(Type *Ty) {
+  UniquingLock Lock(Ty->getContext().pImpl->ConstantLock);
   std::unique_ptr<UndefValue> &Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (!Entry)
     Entry.reset(new UndefValue(Ty));
@@ -1777,6 +1793,7 @@ UndefValue *UndefValue::get(Type *Ty) {
 /// Remove the constant from the constant table.
 void UndefValue::destroyConstantImpl() {
   // Free the constant and any dangling references to it.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   if (getValueID() == UndefValueVal) {
     getContext().pImpl->UVConstants.erase(getType());
   } else if (getValueID() == PoisonValueVal) {
@@ -1786,6 +1803,7 @@ void UndefValue::destroyConstantImpl() {
 }
 
 PoisonValue *PoisonValue::get(Type *Ty) {
+  UniquingLock Lock(Ty->getContext().pImpl->ConstantLock);
   std::unique_ptr<PoisonValue> &Entry = Ty->getContext().pImpl->PVConstants[Ty];
   if (!Entry)
     Entry.reset(new PoisonValue(Ty));
@@ -1796,6 +1814,7 @@ PoisonValue *PoisonValue::get(Type *Ty) {
 /// Remove the constant from the constant table.
 void PoisonValue::destroyConstantImpl() {
   // Free the constant and any dangling references to it.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   getContext().pImpl->PVConstants.erase(getType());
 }
 
@@ -1805,6 +1824,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  UniquingLock Lock(F->getContext().pImpl->ConstantLock);
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (!BA)
@@ -1828,6 +1848,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F && "Block must have a parent");
+  UniquingLock Lock(F->getContext().pImpl->ConstantLock);
   BlockAddress *BA =
       F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
@@ -1836,8 +1857,9 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
 /// Remove the constant from the constant table.
 void BlockAddress::destroyConstantImpl() {
-  getFunction()->getType()->getContext().pImpl
-    ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
+  pImpl->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
 }
 
@@ -1856,6 +1878,7 @@ Value *BlockAddress::handleOperandChangeImpl(Value *From, Value *To) {
 
   // See if the 'new' entry already exists, if not, just update this in place
   // and return early.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   BlockAddress *&NewBA =
     getContext().pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
   if (NewBA)
@@ -1878,6 +1901,7 @@ Value *BlockAddress::handleOperandChangeImpl(Value *From, Value *To) {
 }
 
 DSOLocalEquivalent *DSOLocalEquivalent::get(GlobalValue *GV) {
+  UniquingLock Lock(GV->getContext().pImpl->ConstantLock);
   DSOLocalEquivalent *&Equiv = GV->getContext().pImpl->DSOLocalEquivalents[GV];
   if (!Equiv)
     Equiv = new DSOLocalEquivalent(GV);
@@ -1895,12 +1919,14 @@ DSOLocalEquivalent::DSOLocalEquivalent(GlobalValue *GV)
 /// Remove the constant from the constant table.
 void DSOLocalEquivalent::destroyConstantImpl() {
   const GlobalValue *GV = getGlobalValue();
+  UniquingLock Lock(GV->getContext().pImpl->ConstantLock);
   GV->getContext().pImpl->DSOLocalEquivalents.erase(GV);
 }
 
 Value *DSOLocalEquivalent::handleOperandChangeImpl(Value *From, Value *To) {
   assert(From == getGlobalValue() && "Changing value does not match operand.");
   assert(isa<Constant>(To) && "Can only replace the operands with a constant");
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
 
   // The replacement is with another global value.
   if (const auto *ToObj = dyn_cast<GlobalValue>(To)) {
@@ -1936,6 +1962,7 @@ Value *DSOLocalEquivalent::handleOperandChangeImpl(Value *From, Value *To) {
 }
 
 NoCFIValue *NoCFIValue::get(GlobalValue *GV) {
+  UniquingLock Lock(GV->getContext().pImpl->ConstantLock);
   NoCFIValue *&NC = GV->getContext().pImpl->NoCFIValues[GV];
   if (!NC)
     NC = new NoCFIValue(GV);
@@ -1953,6 +1980,7 @@ NoCFIValue::NoCFIValue(GlobalValue *GV)
 /// Remove the constant from the constant table.
 void NoCFIValue::destroyConstantImpl() {
   const GlobalValue *GV = getGlobalValue();
+  UniquingLock Lock(GV->getContext().pImpl->ConstantLock);
   GV->getContext().pImpl->NoCFIValues.erase(GV);
 }
 
@@ -1961,6 +1989,7 @@ Value *NoCFIValue::handleOperandChangeImpl(Value *From, Value *To) {
 
   GlobalValue *GV = dyn_cast<GlobalValue>(To->stripPointerCasts());
   assert(GV && "Can only replace the operands with a global value");
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
 
   NoCFIValue *&NewNC = getContext().pImpl->NoCFIValues[GV];
   if (NewNC)
@@ -1996,6 +2025,7 @@ static Constant *getFoldedCast(Instruction::CastOps opc, Constant *C, Type *Ty,
   // Look up the constant in the table first to ensure uniqueness.
   ConstantExprKeyType Key(opc, C);
 
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(Ty, Key);
 }
 
@@ -2317,6 +2347,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C, unsigned Flags,
   ConstantExprKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(C->getType(), Key);
 }
 
@@ -2376,6 +2407,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ConstantExprKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -2456,6 +2488,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2,
   ConstantExprKeyType Key(Instruction::Select, ArgVec);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -2521,6 +2554,7 @@ Constant *ConstantExpr::getGetElementPtr(Type *Ty, Constant *C,
                                 SubClassOptionalData, None, None, Ty);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2546,6 +2580,7 @@ Constant *ConstantExpr::getICmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getElementCount());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2571,6 +2606,7 @@ Constant *ConstantExpr::getFCmp(unsigned short pred, Constant *LHS,
     ResultTy = VectorType::get(ResultTy, VT->getElementCount());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -2593,6 +2629,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx,
   const ConstantExprKeyType Key(Instruction::ExtractElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2616,6 +2653,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ConstantExprKeyType Key(Instruction::InsertElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -2642,6 +2680,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   ConstantExprKeyType Key(Instruction::ShuffleVector, ArgVec, 0, 0, None, Mask);
 
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -2666,6 +2705,7 @@ Constant *ConstantExpr::getInsertValue(Constant *Agg, Constant *Val,
   const ConstantExprKeyType Key(Instruction::InsertValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2690,6 +2730,7 @@ Constant *ConstantExpr::getExtractValue(Constant *Agg, ArrayRef<unsigned> Idxs,
   const ConstantExprKeyType Key(Instruction::ExtractValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  UniquingLock Lock(pImpl->ConstantLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2897,6 +2938,7 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 
 /// Remove the constant from the constant table.
 void ConstantExpr::destroyConstantImpl() {
+  UniquingLock Lock(getType()->getContext().pImpl->ConstantLock);
   getType()->getContext().pImpl->ExprConstants.remove(this);
 }
 
@@ -2998,6 +3040,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  UniquingLock Lock(Ty->getContext().pImpl->ConstantLock);
   auto &Slot =
       *Ty->getContext()
            .pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr))
@@ -3028,6 +3071,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 
 void ConstantDataSequential::destroyConstantImpl() {
   // Remove the constant from the StringMap.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   StringMap<std::unique_ptr<ConstantDataSequential>> &CDSConstants =
       getType()->getContext().pImpl->CDSConstants;
 
@@ -3425,6 +3469,7 @@ Value *ConstantArray::handleOperandChangeImpl(Value *From, Value *To) {
     return C;
 
   // Update to the new value.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   return getContext().pImpl->ArrayConstants.replaceOperandsInPlace(
       Values, this, From, ToC, NumUpdated, OperandNo);
 }
@@ -3461,6 +3506,7 @@ Value *ConstantStruct::handleOperandChangeImpl(Value *From, Value *To) {
     return UndefValue::get(getType());
 
   // Update to the new value.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   return getContext().pImpl->StructConstants.replaceOperandsInPlace(
       Values, this, From, ToC, NumUpdated, OperandNo);
 }
@@ -3487,6 +3533,7 @@ Value *ConstantVector::handleOperandChangeImpl(Value *From, Value *To) {
     return C;
 
   // Update to the new value.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   return getContext().pImpl->VectorConstants.replaceOperandsInPlace(
       Values, this, From, ToC, NumUpdated, OperandNo);
 }
@@ -3513,6 +3560,7 @@ Value *ConstantExpr::handleOperandChangeImpl(Value *From, Value *ToV) {
     return C;
 
   // Update to the new value.
+  UniquingLock Lock(getContext().pImpl->ConstantLock);
   return getContext().pImpl->ExprConstants.replaceOperandsInPlace(
       NewOps, this, From, To, NumUpdated, OperandNo);
 }
@@ -63,6 +63,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   // Fixup column.
   adjustColumn(Column);
 
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   if (Storage == Uniqued) {
     if (auto *N = getUniqued(Context.pImpl->DILocations,
                              DILocationInfo::KeyTy(Line, Column, Scope,
@@ -289,6 +290,7 @@ GenericDINode *GenericDINode::getImpl(LLVMContext &Context, unsigned Tag,
                                       MDString *Header,
                                       ArrayRef<Metadata *> DwarfOps,
                                       StorageType Storage, bool ShouldCreate) {
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     GenericDINodeInfo::KeyTy Key(Tag, Header, DwarfOps);
@@ -316,6 +318,7 @@ void GenericDINode::recalculateHash() {
 #define UNWRAP_ARGS_IMPL(...) __VA_ARGS__
 #define UNWRAP_ARGS(ARGS) UNWRAP_ARGS_IMPL ARGS
 #define DEFINE_GETIMPL_LOOKUP(CLASS, ARGS)                                     \
+  UniquingLock Lock(Context.pImpl->MetadataLock);                              \
   do {                                                                         \
     if (Storage == Uniqued) {                                                  \
       if (auto *N = getUniqued(Context.pImpl->CLASS##s,                        \
@@ -685,6 +688,7 @@ DICompositeType *DICompositeType::buildODRType(
   assert(!Identifier.getString().empty() && "Expected valid identifier");
   if (!Context.isODRUniquingDebugTypes())
     return nullptr;
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto *&CT = (*Context.pImpl->DITypeMap)[&Identifier];
   if (!CT)
     return CT = DICompositeType::getDistinct(
@@ -727,6 +731,7 @@ DICompositeType *DICompositeType::getODRType(
   assert(!Identifier.getString().empty() && "Expected valid identifier");
   if (!Context.isODRUniquingDebugTypes())
     return nullptr;
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto *&CT = (*Context.pImpl->DITypeMap)[&Identifier];
   if (!CT) {
     CT = DICompositeType::getDistinct(
@@ -746,6 +751,7 @@ DICompositeType *DICompositeType::getODRTypeIfExists(LLVMContext &Context,
   assert(!Identifier.getString().empty() && "Expected valid identifier");
   if (!Context.isODRUniquingDebugTypes())
     return nullptr;
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   return Context.pImpl->DITypeMap->lookup(&Identifier);
 }
 DISubroutineType::DISubroutineType(LLVMContext &C, StorageType Storage,
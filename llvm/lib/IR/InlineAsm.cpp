@@ -45,11 +45,17 @@ InlineAsm *InlineAsm::get(FunctionType *FTy, StringRef AsmString,
   InlineAsmKeyType Key(AsmString, Constraints, FTy, hasSideEffects,
                        isAlignStack, asmDialect, canThrow);
   LLVMContextImpl *pImpl = FTy->getContext().pImpl;
-  return pImpl->InlineAsms.getOrCreate(PointerType::getUnqual(FTy), Key);
+  PointerType *Ty = PointerType::getUnqual(FTy);
+  UniquingLock Lock(pImpl->ConstantLock);
+  return pImpl->InlineAsms.getOrCreate(Ty, Key);
 }
 
 void InlineAsm::destroyConstant() {
-  getType()->getContext().pImpl->InlineAsms.remove(this);
+  {
+    LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+    UniquingLock Lock(pImpl->ConstantLock);
+    pImpl->InlineAsms.remove(this);
+  }
   delete this;
 }
 
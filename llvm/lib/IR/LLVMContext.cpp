@@ -21,6 +21,7 @@
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMRemarkStreamer.h"
 #include "llvm/Remarks/RemarkStreamer.h"
+#include "llvm/Support/BuryPointer.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -100,7 +101,14 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
   (void)SystemSSID;
 }
 
-LLVMContext::~LLVMContext() { delete pImpl; }
+LLVMContext::~LLVMContext() {
+  // Leave everything the context owns, including its modules, to the OS if the
+  // process is exiting.
+  if (isLeakOnExitEnabled())
+    BuryPointer(pImpl);
+  else
+    delete pImpl;
+}
 
 void LLVMContext::addModule(Module *M) {
   pImpl->OwnedModules.insert(M);
@@ -274,6 +282,7 @@ void LLVMContext::emitError(uint64_t LocCookie, const Twine &ErrorStr) {
 /// Return a unique non-zero ID for the specified metadata kind.
 unsigned LLVMContext::getMDKindID(StringRef Name) const {
   // If this is new, assign it its ID.
+  UniquingLock Lock(pImpl->MetadataLock);
   return pImpl->CustomMDKindNames.insert(
                                      std::make_pair(
                                          Name, pImpl->CustomMDKindNames.size()))
@@ -283,6 +292,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client-supplied smallvector using custom
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  UniquingLock Lock(pImpl->MetadataLock);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
@@ -311,20 +321,27 @@ void LLVMContext::getSyncScopeNames(SmallVectorImpl<StringRef> &SSNs) const {
 }
 
 void LLVMContext::setGC(const Function &Fn, std::string GCName) {
-  auto It = pImpl->GCNames.find(&Fn);
-
-  if (It == pImpl->GCNames.end()) {
-    pImpl->GCNames.insert(std::make_pair(&Fn, std::move(GCName)));
+  UniquingLock Lock(pImpl->NameLock);
+  std::unique_ptr<std::string> &Name = pImpl->GCNames[&Fn];
+  if (!Name) {
+    Name = std::make_unique<std::string>(std::move(GCName));
     return;
   }
-  It->second = std::move(GCName);
+  *Name = std::move(GCName);
 }
 
 const std::string &LLVMContext::getGC(const Function &Fn) {
-  return pImpl->GCNames[&Fn];
+  // The names are allocated separately, so that the returned reference stays
+  // valid while other threads add names to the map.
+  UniquingLock Lock(pImpl->NameLock);
+  std::unique_ptr<std::string> &Name = pImpl->GCNames[&Fn];
+  if (!Name)
+    Name = std::make_unique<std::string>();
+  return *Name;
 }
 
 void LLVMContext::deleteGC(const Function &Fn) {
+  UniquingLock Lock(pImpl->NameLock);
   pImpl->GCNames.erase(&Fn);
 }
 
@@ -375,6 +392,32 @@ bool LLVMContext::supportsTypedPointers() const {
   return !pImpl->getOpaquePointers();
 }
 
+bool LLVMContext::shouldUseUserArena() const { return pImpl->UseUserArena; }
+
+void LLVMContext::setUseUserArena(bool Enable) {
+  pImpl->UseUserArena = Enable;
+}
+
+bool LLVMContext::hasConcurrentUniquing() const {
+  return pImpl->TypeLock.isEnabled();
+}
+
+void LLVMContext::setConcurrentUniquing(bool Enable) {
+  // The opaque pointer mode is decided lazily on first use; settle it now
+  // rather than racing on it later.
+  (void)pImpl->getOpaquePointers();
+  pImpl->TypeLock.setEnabled(Enable);
+  pImpl->ConstantLock.setEnabled(Enable);
+  pImpl->MetadataLock.setEnabled(Enable);
+  pImpl->NameLock.setEnabled(Enable);
+}
+
+UserArenaScope::UserArenaScope(LLVMContext &C) : Prev(UserArena::getCurrent()) {
+  UserArena::setCurrent(C.shouldUseUserArena() ? &C.pImpl->Users : nullptr);
+}
+
+UserArenaScope::~UserArenaScope() { UserArena::setCurrent(Prev); }
+
 Any &LLVMContext::getTargetData() const {
   return pImpl->TargetDataStorage;
 }
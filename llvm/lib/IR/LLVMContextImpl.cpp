@@ -38,8 +38,42 @@ static cl::opt<bool>
     OpaquePointersCL("opaque-pointers", cl::desc("Use opaque pointers"),
                      cl::init(false));
 
+static cl::opt<bool> UserArenaCL(
+    "use-user-arena", cl::Hidden,
+    cl::desc("Allocate instructions, constants and other Users from a "
+             "recycling arena owned by their context"),
+    cl::init(false));
+
+static LLVM_THREAD_LOCAL UserArena *CurrentUserArena;
+
+UserArena *UserArena::getCurrent() { return CurrentUserArena; }
+
+void UserArena::setCurrent(UserArena *Arena) { CurrentUserArena = Arena; }
+
+void *UserArena::allocate(size_t Size) {
+  assert(Size <= MaxSize && "Allocation too large for the arena");
+  Size = alignTo(Size, alignof(void *));
+  void **FreeList = &FreeLists[Size / alignof(void *)];
+  void **Block = static_cast<void **>(*FreeList);
+  if (Block)
+    *FreeList = *Block;
+  else
+    Block = static_cast<void **>(
+        Allocator.Allocate(Size + sizeof(void *), alignof(void *)));
+  *Block = FreeList;
+  return Block + 1;
+}
+
+void UserArena::deallocate(void *Ptr) {
+  void **Block = static_cast<void **>(Ptr) - 1;
+  void **FreeList = static_cast<void **>(*Block);
+  *Block = *FreeList;
+  *FreeList = Block;
+}
+
 LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
-    : DiagHandler(std::make_unique<DiagnosticHandler>()),
+    : UseUserArena(UserArenaCL),
+      DiagHandler(std::make_unique<DiagnosticHandler>()),
       VoidTy(C, Type::VoidTyID), LabelTy(C, Type::LabelTyID),
       HalfTy(C, Type::HalfTyID), BFloatTy(C, Type::BFloatTyID),
       FloatTy(C, Type::FloatTyID), DoubleTy(C, Type::DoubleTyID),
@@ -207,23 +241,27 @@ unsigned MDNodeOpsKey::calculateHash(ArrayRef<Metadata *> Ops) {
 }
 
 StringMapEntry<uint32_t> *LLVMContextImpl::getOrInsertBundleTag(StringRef Tag) {
+  UniquingLock Lock(NameLock);
   uint32_t NewIdx = BundleTagCache.size();
   return &*(BundleTagCache.insert(std::make_pair(Tag, NewIdx)).first);
 }
 
 void LLVMContextImpl::getOperandBundleTags(SmallVectorImpl<StringRef> &Tags) const {
+  UniquingLock Lock(NameLock);
   Tags.resize(BundleTagCache.size());
   for (const auto &T : BundleTagCache)
     Tags[T.second] = T.first();
 }
 
 uint32_t LLVMContextImpl::getOperandBundleTagID(StringRef Tag) const {
+  UniquingLock Lock(NameLock);
   auto I = BundleTagCache.find(Tag);
   assert(I != BundleTagCache.end() && "Unknown tag!");
   return I->second;
 }
 
 SyncScope::ID LLVMContextImpl::getOrInsertSyncScopeID(StringRef SSN) {
+  UniquingLock Lock(NameLock);
   auto NewSSID = SSC.size();
   assert(NewSSID < std::numeric_limits<SyncScope::ID>::max() &&
          "Hit the maximum number of synchronization scopes allowed!");
@@ -232,6 +270,7 @@ SyncScope::ID LLVMContextImpl::getOrInsertSyncScopeID(StringRef SSN) {
 
 void LLVMContextImpl::getSyncScopeNames(
     SmallVectorImpl<StringRef> &SSNs) const {
+  UniquingLock Lock(NameLock);
   SSNs.resize(SSC.size());
   for (const auto &SSE : SSC)
     SSNs[SSE.second] = SSE.first();
@@ -47,6 +47,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -1351,12 +1352,76 @@ public:
   }
 };
 
+/// Recycling allocator for the Users of a context. Every block is preceded by
+/// a pointer to the free list it goes back to, which lets User's operator
+/// delete release it without knowing its size or its context. Blocks are never
+/// returned to the system before the arena is destroyed.
+class UserArena {
+public:
+  /// Larger allocations are left to the global heap.
+  enum : size_t { MaxSize = 1024 };
+
+  /// Return the arena of the innermost UserArenaScope of this thread, if its
+  /// context uses one.
+  static UserArena *getCurrent();
+  static void setCurrent(UserArena *Arena);
+
+  void *allocate(size_t Size);
+  static void deallocate(void *Ptr);
+
+private:
+  void *FreeLists[MaxSize / alignof(void *) + 1] = {};
+  BumpPtrAllocator Allocator;
+};
+
+/// A recursive mutex guarding one group of uniquing tables, which is only
+/// acquired when the context has concurrent uniquing enabled.
+class UniquingMutex {
+public:
+  bool isEnabled() const { return Enabled; }
+  void setEnabled(bool Enable) { Enabled = Enable; }
+
+  void lock() {
+    if (Enabled)
+      M.lock();
+  }
+  void unlock() {
+    if (Enabled)
+      M.unlock();
+  }
+
+private:
+  std::recursive_mutex M;
+  bool Enabled = false;
+};
+
+using UniquingLock = std::lock_guard<UniquingMutex>;
+
 class LLVMContextImpl {
 public:
   /// OwnedModules - The set of modules instantiated in this context, and which
   /// will be automatically deleted if this context is deleted.
   SmallPtrSet<Module *, 4> OwnedModules;
 
+  /// Users allocated while UseUserArena is set. This comes before anything
+  /// that may own a User so that it is destroyed last.
+  UserArena Users;
+  bool UseUserArena;
+
+  /// Locks for the uniquing tables when concurrent uniquing is enabled. To
+  /// avoid deadlocks they are always acquired in the order MetadataLock,
+  /// ConstantLock, TypeLock: updating metadata may create constants, which may
+  /// create types. Constants are therefore only deleted after ConstantLock is
+  /// released. TypeLock also covers the attribute tables, which share Alloc
+  /// with the types, and ConstantLock covers the inline asm table. NameLock
+  /// guards the small tables that map values and strings to names and IDs
+  /// (ValueNames, BundleTagCache, SSC and GCNames); no other lock is acquired
+  /// while it is held.
+  UniquingMutex MetadataLock;
+  UniquingMutex ConstantLock;
+  UniquingMutex TypeLock;
+  mutable UniquingMutex NameLock;
+
   /// The main remark streamer used by all the other streamers (e.g. IR, MIR,
   /// frontends, etc.). This should only be used by the specific streamers, and
   /// never directly.
@@ -1537,7 +1602,7 @@ public:
   /// This saves allocating an additional word in Function for programs which
   /// do not use GC (i.e., most programs) at the cost of increased overhead for
   /// clients which do use GC.
-  DenseMap<const Function *, std::string> GCNames;
+  DenseMap<const Function *, std::unique_ptr<std::string>> GCNames;
 
   /// Flag to indicate if Value (other than GlobalValue) retains their name or
   /// not.
@@ -1396,6 +1396,7 @@ bool FPPassManager::runOnFunction(Function &F) {
 
   bool Changed = false;
   Module &M = *F.getParent();
+  UserArenaScope ArenaScope(M.getContext());
   // Collect inherited analysis from Module level pass manager.
   populateInheritedAnalysis(TPM->activeStack);
 
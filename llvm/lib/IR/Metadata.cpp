@@ -62,6 +62,7 @@ MetadataAsValue::MetadataAsValue(Type *Ty, Metadata *MD)
 }
 
 MetadataAsValue::~MetadataAsValue() {
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   getType()->getContext().pImpl->MetadataAsValues.erase(MD);
   untrack();
 }
@@ -101,6 +102,7 @@ static Metadata *canonicalizeMetadataForValue(LLVMContext &Context,
 
 MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto *&Entry = Context.pImpl->MetadataAsValues[MD];
   if (!Entry)
     Entry = new MetadataAsValue(Type::getMetadataTy(Context), MD);
@@ -110,6 +112,7 @@ MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
 MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
                                               Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->MetadataAsValues;
   return Store.lookup(MD);
 }
@@ -117,6 +120,7 @@ MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
 void MetadataAsValue::handleChangedMetadata(Metadata *MD) {
   LLVMContext &Context = getContext();
   MD = canonicalizeMetadataForValue(Context, MD);
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->MetadataAsValues;
 
   // Stop tracking the old metadata.
@@ -251,6 +255,7 @@ void ReplaceableMetadataImpl::SalvageDebugInfo(const Constant &C) {
   }
 
   LLVMContext &Context = C.getType()->getContext();
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(&C);
   ValueAsMetadata *MD = I->second;
@@ -395,6 +400,7 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
@@ -412,13 +418,17 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
 
 ValueAsMetadata *ValueAsMetadata::getIfExists(Value *V) {
   assert(V && "Unexpected null Value");
-  return V->getContext().pImpl->ValuesAsMetadata.lookup(V);
+  LLVMContextImpl *pImpl = V->getContext().pImpl;
+  UniquingLock Lock(pImpl->MetadataLock);
+  return pImpl->ValuesAsMetadata.lookup(V);
 }
 
 void ValueAsMetadata::handleDeletion(Value *V) {
   assert(V && "Expected valid value");
 
-  auto &Store = V->getType()->getContext().pImpl->ValuesAsMetadata;
+  LLVMContextImpl *pImpl = V->getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl->MetadataLock);
+  auto &Store = pImpl->ValuesAsMetadata;
   auto I = Store.find(V);
   if (I == Store.end())
     return;
@@ -441,6 +451,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   assert(From->getType() == To->getType() && "Unexpected type change");
 
   LLVMContext &Context = From->getType()->getContext();
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(From);
   if (I == Store.end()) {
@@ -497,6 +508,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.try_emplace(Str);
   auto &MapEntry = I.first->getValue();
@@ -825,6 +837,7 @@ template <class NodeTy> struct MDNode::HasCachedHash {
 
 MDNode *MDNode::uniquify() {
   assert(!hasSelfReference(this) && "Cannot uniquify a self-referencing node");
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
 
   // Try to insert into uniquing store.
   switch (getMetadataID()) {
@@ -843,6 +856,7 @@ MDNode *MDNode::uniquify() {
 }
 
 void MDNode::eraseFromStore() {
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   switch (getMetadataID()) {
   default:
     llvm_unreachable("Invalid or non-uniquable subclass of MDNode");
@@ -856,6 +870,7 @@ void MDNode::eraseFromStore() {
 
 MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
                           StorageType Storage, bool ShouldCreate) {
+  UniquingLock Lock(Context.pImpl->MetadataLock);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     MDTupleInfo::KeyTy Key(MDs);
@@ -897,6 +912,7 @@ void MDNode::storeDistinctInContext() {
 #include "llvm/IR/Metadata.def"
   }
 
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   getContext().pImpl->DistinctMDNodes.push_back(this);
 }
 
@@ -1223,6 +1239,7 @@ bool MDAttachments::erase(unsigned ID) {
 MDNode *Value::getMetadata(unsigned KindID) const {
   if (!hasMetadata())
     return nullptr;
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   const auto &Info = getContext().pImpl->ValueMetadata[this];
   assert(!Info.empty() && "bit out of sync with hash table");
   return Info.lookup(KindID);
@@ -1231,14 +1248,17 @@ MDNode *Value::getMetadata(unsigned KindID) const {
 MDNode *Value::getMetadata(StringRef Kind) const {
   if (!hasMetadata())
     return nullptr;
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   const auto &Info = getContext().pImpl->ValueMetadata[this];
   assert(!Info.empty() && "bit out of sync with hash table");
   return Info.lookup(getContext().getMDKindID(Kind));
 }
 
 void Value::getMetadata(unsigned KindID, SmallVectorImpl<MDNode *> &MDs) const {
-  if (hasMetadata())
+  if (hasMetadata()) {
+    UniquingLock Lock(getContext().pImpl->MetadataLock);
     getContext().pImpl->ValueMetadata[this].get(KindID, MDs);
+  }
 }
 
 void Value::getMetadata(StringRef Kind, SmallVectorImpl<MDNode *> &MDs) const {
@@ -1249,6 +1269,7 @@ void Value::getMetadata(StringRef Kind, SmallVectorImpl<MDNode *> &MDs) const {
 void Value::getAllMetadata(
     SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDs) const {
   if (hasMetadata()) {
+    UniquingLock Lock(getContext().pImpl->MetadataLock);
     assert(getContext().pImpl->ValueMetadata.count(this) &&
            "bit out of sync with hash table");
     const auto &Info = getContext().pImpl->ValueMetadata.find(this)->second;
@@ -1259,6 +1280,7 @@ void Value::getAllMetadata(
 
 void Value::setMetadata(unsigned KindID, MDNode *Node) {
   assert(isa<Instruction>(this) || isa<GlobalObject>(this));
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
 
   // Handle the case when we're adding/updating metadata on a value.
   if (Node) {
@@ -1293,6 +1315,7 @@ void Value::setMetadata(StringRef Kind, MDNode *Node) {
 
 void Value::addMetadata(unsigned KindID, MDNode &MD) {
   assert(isa<Instruction>(this) || isa<GlobalObject>(this));
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   if (!HasMetadata)
     HasMetadata = true;
   getContext().pImpl->ValueMetadata[this].insert(KindID, MD);
@@ -1307,6 +1330,7 @@ bool Value::eraseMetadata(unsigned KindID) {
   if (!HasMetadata)
     return false;
 
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   auto &Store = getContext().pImpl->ValueMetadata[this];
   bool Changed = Store.erase(KindID);
   if (Store.empty())
@@ -1317,6 +1341,7 @@ bool Value::eraseMetadata(unsigned KindID) {
 void Value::clearMetadata() {
   if (!HasMetadata)
     return;
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   assert(getContext().pImpl->ValueMetadata.count(this) &&
          "bit out of sync with hash table");
   getContext().pImpl->ValueMetadata.erase(this);
@@ -1346,6 +1371,7 @@ void Instruction::dropUnknownNonDebugMetadata(ArrayRef<unsigned> KnownIDs) {
   SmallSet<unsigned, 4> KnownSet;
   KnownSet.insert(KnownIDs.begin(), KnownIDs.end());
 
+  UniquingLock Lock(getContext().pImpl->MetadataLock);
   auto &MetadataStore = getContext().pImpl->ValueMetadata;
   auto &Info = MetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
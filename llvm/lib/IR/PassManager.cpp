@@ -9,6 +9,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/PassManagerImpl.h"
 
 using namespace llvm;
@@ -110,6 +111,7 @@ PreservedAnalyses ModuleToFunctionPassAdaptor::run(Module &M,
   // instrumenting callbacks for the passes later.
   PassInstrumentation PI = AM.getResult<PassInstrumentationAnalysis>(M);
 
+  UserArenaScope ArenaScope(M.getContext());
   PreservedAnalyses PA = PreservedAnalyses::all();
   for (Function &F : M) {
     if (F.isDeclaration())
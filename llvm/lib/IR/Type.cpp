@@ -324,6 +324,7 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
 
+  UniquingLock Lock(C.pImpl->TypeLock);
   IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
 
   if (!Entry)
@@ -368,6 +369,7 @@ FunctionType *FunctionType::get(Type *ReturnType,
   // one for inserting the newly allocated one), here we instead lookup based on
   // Key and update the reference to the function type in-place to a newly
   // allocated one if not found.
+  UniquingLock Lock(pImpl->TypeLock);
   auto Insertion = pImpl->FunctionTypes.insert_as(nullptr, Key);
   if (Insertion.second) {
     // The function type was not found. Allocate one and update FunctionTypes
@@ -414,6 +416,7 @@ StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes,
   // one for inserting the newly allocated one), here we instead lookup based on
   // Key and update the reference to the struct type in-place to a newly
   // allocated one if not found.
+  UniquingLock Lock(pImpl->TypeLock);
   auto Insertion = pImpl->AnonStructTypes.insert_as(nullptr, Key);
   if (Insertion.second) {
     // The struct type was not found. Allocate one and update AnonStructTypes
@@ -456,10 +459,12 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     return;
   }
 
+  UniquingLock Lock(getContext().pImpl->TypeLock);
   ContainedTys = Elements.copy(getContext().pImpl->Alloc).data();
 }
 
 void StructType::setName(StringRef Name) {
+  UniquingLock Lock(getContext().pImpl->TypeLock);
   if (Name == getName()) return;
 
   StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
@@ -511,6 +516,7 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
+  UniquingLock Lock(Context.pImpl->TypeLock);
   StructType *ST = new (Context.pImpl->Alloc) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
@@ -621,6 +627,7 @@ bool StructType::indexValid(const Value *V) const {
 }
 
 StructType *StructType::getTypeByName(LLVMContext &C, StringRef Name) {
+  UniquingLock Lock(C.pImpl->TypeLock);
   return C.pImpl->NamedStructTypes.lookup(Name);
 }
 
@@ -639,6 +646,7 @@ ArrayType *ArrayType::get(Type *ElementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  UniquingLock Lock(pImpl->TypeLock);
   ArrayType *&Entry =
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
 
@@ -690,6 +698,7 @@ FixedVectorType *FixedVectorType::get(Type *ElementType, unsigned NumElts) {
   auto EC = ElementCount::getFixed(NumElts);
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  UniquingLock Lock(pImpl->TypeLock);
   VectorType *&Entry = ElementType->getContext()
                            .pImpl->VectorTypes[std::make_pair(ElementType, EC)];
 
@@ -712,6 +721,7 @@ ScalableVectorType *ScalableVectorType::get(Type *ElementType,
   auto EC = ElementCount::getScalable(MinNumElts);
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  UniquingLock Lock(pImpl->TypeLock);
   VectorType *&Entry = ElementType->getContext()
                            .pImpl->VectorTypes[std::make_pair(ElementType, EC)];
 
@@ -735,6 +745,7 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
     return get(EltTy->getContext(), AddressSpace);
 
   // Since AddressSpace #0 is the common case, we special case it.
+  UniquingLock Lock(CImpl->TypeLock);
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
      : CImpl->ASPointerTypes[std::make_pair(EltTy, AddressSpace)];
 
@@ -749,6 +760,7 @@ PointerType *PointerType::get(LLVMContext &C, unsigned AddressSpace) {
          "Can only create opaque pointers in opaque pointer mode");
 
   // Since AddressSpace #0 is the common case, we special case it.
+  UniquingLock Lock(CImpl->TypeLock);
   PointerType *&Entry =
       AddressSpace == 0
           ? CImpl->PointerTypes[nullptr]
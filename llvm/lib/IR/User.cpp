@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/User.h"
+#include "LLVMContextImpl.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -114,6 +115,28 @@ bool User::isDroppable() const {
 //                         User operator new Implementations
 //===----------------------------------------------------------------------===//
 
+void *User::allocateStorage(size_t Size, bool &IsArenaAllocated) {
+  UserArena *Arena = UserArena::getCurrent();
+  IsArenaAllocated = Arena && Size <= UserArena::MaxSize;
+  if (IsArenaAllocated)
+    return Arena->allocate(Size);
+  return ::operator new(Size);
+}
+
+void *User::getStorage() {
+  if (HasHungOffUses)
+    return reinterpret_cast<Use **>(this) - 1;
+  Use *UseBegin = reinterpret_cast<Use *>(this) - NumUserOperands;
+  if (!HasDescriptor)
+    return UseBegin;
+  auto *DI = reinterpret_cast<DescriptorInfo *>(UseBegin) - 1;
+  return reinterpret_cast<uint8_t *>(DI) - DI->SizeInBytes;
+}
+
+bool User::isArenaOf(LLVMContext &C) {
+  return UserArena::getCurrent() == &C.pImpl->Users;
+}
+
 void *User::allocateFixedOperandUser(size_t Size, unsigned Us,
                                      unsigned DescBytes) {
   assert(Us < (1u << NumUserOperandsBits) && "Too many operands");
@@ -125,14 +148,16 @@ void *User::allocateFixedOperandUser(size_t Size, unsigned Us,
   assert(DescBytesToAllocate % sizeof(void *) == 0 &&
          "We need this to satisfy alignment constraints for Uses");
 
-  uint8_t *Storage = static_cast<uint8_t *>(
-      ::operator new(Size + sizeof(Use) * Us + DescBytesToAllocate));
+  bool IsArenaAllocated;
+  uint8_t *Storage = static_cast<uint8_t *>(allocateStorage(
+      Size + sizeof(Use) * Us + DescBytesToAllocate, IsArenaAllocated));
   Use *Start = reinterpret_cast<Use *>(Storage + DescBytesToAllocate);
   Use *End = Start + Us;
   User *Obj = reinterpret_cast<User*>(End);
   Obj->NumUserOperands = Us;
   Obj->HasHungOffUses = false;
   Obj->HasDescriptor = DescBytes != 0;
+  Obj->IsArenaAllocated = IsArenaAllocated;
   for (; Start != End; Start++)
     new (Start) Use(Obj);
 
@@ -154,12 +179,14 @@ void *User::operator new(size_t Size, unsigned Us, unsigned DescBytes) {
 
 void *User::operator new(size_t Size) {
   // Allocate space for a single Use*
-  void *Storage = ::operator new(Size + sizeof(Use *));
+  bool IsArenaAllocated;
+  void *Storage = allocateStorage(Size + sizeof(Use *), IsArenaAllocated);
   Use **HungOffOperandList = static_cast<Use **>(Storage);
   User *Obj = reinterpret_cast<User *>(HungOffOperandList + 1);
   Obj->NumUserOperands = 0;
   Obj->HasHungOffUses = true;
   Obj->HasDescriptor = false;
+  Obj->IsArenaAllocated = IsArenaAllocated;
   *HungOffOperandList = nullptr;
   return Obj;
 }
@@ -174,27 +201,23 @@ LLVM_NO_SANITIZE_MEMORY_ATTRIBUTE void User::operator delete(void *Usr) {
   // Hung off uses use a single Use* before the User, while other subclasses
   // use a Use[] allocated prior to the user.
   User *Obj = static_cast<User *>(Usr);
+  void *Storage = Obj->getStorage();
   if (Obj->HasHungOffUses) {
     assert(!Obj->HasDescriptor && "not supported!");
 
-    Use **HungOffOperandList = static_cast<Use **>(Usr) - 1;
+    Use **HungOffOperandList = static_cast<Use **>(Storage);
     // drop the hung off uses.
     Use::zap(*HungOffOperandList, *HungOffOperandList + Obj->NumUserOperands,
              /* Delete */ true);
-    ::operator delete(HungOffOperandList);
-  } else if (Obj->HasDescriptor) {
+  } else {
     Use *UseBegin = static_cast<Use *>(Usr) - Obj->NumUserOperands;
     Use::zap(UseBegin, UseBegin + Obj->NumUserOperands, /* Delete */ false);
+  }
 
-    auto *DI = reinterpret_cast<DescriptorInfo *>(UseBegin) - 1;
-    uint8_t *Storage = reinterpret_cast<uint8_t *>(DI) - DI->SizeInBytes;
+  if (Obj->IsArenaAllocated)
+    UserArena::deallocate(Storage);
+  else
     ::operator delete(Storage);
-  } else {
-    Use *Storage = static_cast<Use *>(Usr) - Obj->NumUserOperands;
-    Use::zap(Storage, Storage + Obj->NumUserOperands,
-             /* Delete */ false);
-    ::operator delete(Storage);
-  }
 }
 
 } // namespace llvm
@@ -278,6 +278,7 @@ ValueName *Value::getValueName() const {
   if (!HasName) return nullptr;
 
   LLVMContext &Ctx = getContext();
+  UniquingLock Lock(Ctx.pImpl->NameLock);
   auto I = Ctx.pImpl->ValueNames.find(this);
   assert(I != Ctx.pImpl->ValueNames.end() &&
          "No name entry found!");
@@ -287,6 +288,7 @@ ValueName *Value::getValueName() const {
 
 void Value::setValueName(ValueName *VN) {
   LLVMContext &Ctx = getContext();
+  UniquingLock Lock(Ctx.pImpl->NameLock);
 
   assert(HasName == Ctx.pImpl->ValueNames.count(this) &&
          "HasName bit out of sync!");
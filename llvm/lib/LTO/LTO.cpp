@@ -35,6 +35,7 @@
 #include "llvm/Linker/IRMover.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Object/IRObjectFile.h"
+#include "llvm/Support/BuryPointer.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
@@ -57,6 +58,8 @@
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
 
+#include <condition_variable>
+#include <mutex>
 #include <set>
 
 using namespace llvm;
@@ -69,6 +72,11 @@ static cl::opt<bool>
     DumpThinCGSCCs("dump-thin-cg-sccs", cl::init(false), cl::Hidden,
                    cl::desc("Dump the SCCs in the ThinLTO index's callgraph"));
 
+static cl::opt<unsigned> ThinBackendBytesPerInst(
+    "thinlto-backend-bytes-per-inst", cl::init(1024), cl::Hidden,
+    cl::desc("Estimated peak memory, in bytes, that an in-process ThinLTO "
+             "backend uses per IR instruction of its module and imports"));
+
 /// Enable global value internalization in LTO.
 cl::opt<bool> EnableLTOInternalization(
     "enable-lto-internalization", cl::init(true), cl::Hidden,
@@ -527,7 +535,11 @@ LTO::LTO(Config Conf, ThinBackend Backend,
       ThinLTO(std::move(Backend)) {}
 
 // Requires a destructor for MapVector<BitcodeModule>.
-LTO::~LTO() = default;
+LTO::~LTO() {
+  // The combined module is freed with LTO unless the process is exiting.
+  if (isLeakOnExitEnabled())
+    BuryPointer(std::move(RegularLTO.CombinedModule));
+}
 
 // Add the symbols in the given module to the GlobalResolutions map, and resolve
 // their partitions.
@@ -892,11 +904,9 @@ Error LTO::linkRegularLTO(RegularLTOState::AddedModule Mod,
 Error LTO::addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
                       const SymbolResolution *&ResI,
                       const SymbolResolution *ResE) {
-  if (Error Err =
-          BM.readSummary(ThinLTO.CombinedIndex, BM.getModuleIdentifier(),
-                         ThinLTO.ModuleMap.size()))
-    return Err;
-
+  // The summary itself is read later, together with those of all the other
+  // ThinLTO modules, so only record what the resolutions change in it.
+  ThinLTOState::PendingSummary Pending{BM, ThinLTO.ModuleMap.size(), {}, {}};
   for (const InputFile::Symbol &Sym : Syms) {
     assert(ResI != ResE);
     SymbolResolution Res = *ResI++;
@@ -906,25 +916,11 @@ Error LTO::addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
           Sym.getIRName(), GlobalValue::ExternalLinkage, ""));
       if (Res.Prevailing) {
         ThinLTO.PrevailingModuleForGUID[GUID] = BM.getModuleIdentifier();
-
-        // For linker redefined symbols (via --wrap or --defsym) we want to
-        // switch the linkage to `weak` to prevent IPOs from happening.
-        // Find the summary in the module for this very GV and record the new
-        // linkage so that we can switch it when we import the GV.
         if (Res.LinkerRedefined)
-          if (auto S = ThinLTO.CombinedIndex.findSummaryInModule(
-                  GUID, BM.getModuleIdentifier()))
-            S->setLinkage(GlobalValue::WeakAnyLinkage);
-      }
-
-      // If the linker resolved the symbol to a local definition then mark it
-      // as local in the summary for the module we are adding.
-      if (Res.FinalDefinitionInLinkageUnit) {
-        if (auto S = ThinLTO.CombinedIndex.findSummaryInModule(
-                GUID, BM.getModuleIdentifier())) {
-          S->setDSOLocal(true);
-        }
+          Pending.LinkerRedefined.push_back(GUID);
       }
+      if (Res.FinalDefinitionInLinkageUnit)
+        Pending.FinalDefinitionInLinkageUnit.push_back(GUID);
     }
   }
 
@@ -932,6 +928,7 @@ Error LTO::addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
     return make_error<StringError>(
         "Expected at most one ThinLTO module per bitcode file",
         inconvertibleErrorCode());
+  ThinLTO.PendingSummaries.push_back(std::move(Pending));
 
   if (!Conf.ThinLTOModulesToCompile.empty()) {
     if (!ThinLTO.ModulesToCompile)
@@ -950,6 +947,74 @@ Error LTO::addThinLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
   return Error::success();
 }
 
+Error LTO::readThinLTOSummaries() {
+  std::vector<ThinLTOState::PendingSummary> Pending =
+      std::move(ThinLTO.PendingSummaries);
+  ThinLTO.PendingSummaries.clear();
+  if (Pending.empty())
+    return Error::success();
+
+  // Decoding the summaries is the expensive part and runs in parallel. The
+  // readers share the combined index and serialize their updates to it.
+  ThreadPool Pool(Conf.ThinLinkParallelism);
+  std::mutex IndexMutex;
+  std::vector<Error> Errors;
+  Errors.reserve(Pending.size());
+  for (size_t I = 0, E = Pending.size(); I != E; ++I) {
+    Errors.push_back(Error::success());
+    Pool.async([&, I] {
+      BitcodeModule &BM = Pending[I].BM;
+      Errors[I] = BM.readSummary(ThinLTO.CombinedIndex,
+                                 BM.getModuleIdentifier(), Pending[I].ModuleId,
+                                 &IndexMutex);
+    });
+  }
+  Pool.wait();
+  Error Err = Error::success();
+  for (Error &E : Errors)
+    Err = joinErrors(std::move(Err), std::move(E));
+  if (Err)
+    return Err;
+
+  // The readers append to the summary list of a GUID in whatever order they
+  // reach it. Restore input order so that the index is the same as if the
+  // modules had been read one after the other. Summaries of regular LTO
+  // modules were read when those were added and stay in front.
+  if (Pool.getThreadCount() > 1) {
+    DenseMap<StringRef, uint64_t> InputOrder;
+    for (ThinLTOState::PendingSummary &P : Pending)
+      InputOrder[P.BM.getModuleIdentifier()] = P.ModuleId + 1;
+    auto getInputOrder = [&](const std::unique_ptr<GlobalValueSummary> &S) {
+      return InputOrder.lookup(S->modulePath());
+    };
+    for (auto &I : ThinLTO.CombinedIndex) {
+      GlobalValueSummaryList &SummaryList = I.second.SummaryList;
+      if (SummaryList.size() > 1)
+        llvm::stable_sort(SummaryList, [&](const auto &A, const auto &B) {
+          return getInputOrder(A) < getInputOrder(B);
+        });
+    }
+  }
+
+  for (ThinLTOState::PendingSummary &P : Pending) {
+    StringRef ModulePath = P.BM.getModuleIdentifier();
+    // For linker redefined symbols (via --wrap or --defsym) we want to
+    // switch the linkage to `weak` to prevent IPOs from happening.
+    // Find the summary in the module for this very GV and record the new
+    // linkage so that we can switch it when we import the GV.
+    for (GlobalValue::GUID GUID : P.LinkerRedefined)
+      if (auto S = ThinLTO.CombinedIndex.findSummaryInModule(GUID, ModulePath))
+        S->setLinkage(GlobalValue::WeakAnyLinkage);
+
+    // If the linker resolved the symbol to a local definition then mark it
+    // as local in the summary for the module we are adding.
+    for (GlobalValue::GUID GUID : P.FinalDefinitionInLinkageUnit)
+      if (auto S = ThinLTO.CombinedIndex.findSummaryInModule(GUID, ModulePath))
+        S->setDSOLocal(true);
+  }
+  return Error::success();
+}
+
 unsigned LTO::getMaxTasks() const {
   CalledGetMaxTasks = true;
   auto ModuleCount = ThinLTO.ModulesToCompile ? ThinLTO.ModulesToCompile->size()
@@ -997,6 +1062,9 @@ Error LTO::checkPartiallySplit() {
 }
 
 Error LTO::run(AddStreamFn AddStream, FileCache Cache) {
+  if (Error Err = readThinLTOSummaries())
+    return Err;
+
   // Compute "dead" symbols, we don't want to import/export these!
   DenseSet<GlobalValue::GUID> GUIDPreservedSymbols;
   DenseMap<GlobalValue::GUID, PrevailingType> GUIDPrevailingResolutions;
@@ -1178,6 +1246,27 @@ public:
   virtual unsigned getThreadCount() = 0;
 };
 
+/// Estimate the peak memory used by the backend for \p BM from the instruction
+/// counts in the summaries of the functions it defines and imports. The
+/// bitcode itself is counted too, so that modules without function summaries
+/// still get a nonzero estimate.
+static uint64_t
+estimateThinBackendMemory(const ModuleSummaryIndex &CombinedIndex,
+                          const BitcodeModule &BM,
+                          const GVSummaryMapTy &DefinedGlobals,
+                          const FunctionImporter::ImportMapTy &ImportList) {
+  uint64_t InstCount = 0;
+  for (auto &GV : DefinedGlobals)
+    if (auto *FS = dyn_cast<FunctionSummary>(GV.second))
+      InstCount += FS->instCount();
+  for (auto &FromModule : ImportList)
+    for (GlobalValue::GUID GUID : FromModule.second)
+      if (auto *FS = dyn_cast_or_null<FunctionSummary>(
+              CombinedIndex.findSummaryInModule(GUID, FromModule.first())))
+        InstCount += FS->instCount();
+  return InstCount * ThinBackendBytesPerInst + BM.getBuffer().size();
+}
+
 namespace {
 class InProcessThinBackend : public ThinBackendProc {
   ThreadPool BackendThreadPool;
@@ -1189,15 +1278,40 @@ class InProcessThinBackend : public ThinBackendProc {
   Optional<Error> Err;
   std::mutex ErrMu;
 
+  /// The estimated memory that running backends may use together, or zero
+  /// for no limit, and the estimate for the backends running now.
+  uint64_t MemoryBudget;
+  uint64_t MemoryInUse = 0;
+  std::mutex MemoryMu;
+  std::condition_variable MemoryCV;
+
+  void acquireMemory(uint64_t Estimate) {
+    std::unique_lock<std::mutex> L(MemoryMu);
+    // A backend whose estimate alone exceeds the budget runs once nothing
+    // else does, rather than never.
+    MemoryCV.wait(L, [&] {
+      return MemoryInUse == 0 || MemoryInUse + Estimate <= MemoryBudget;
+    });
+    MemoryInUse += Estimate;
+  }
+
+  void releaseMemory(uint64_t Estimate) {
+    {
+      std::lock_guard<std::mutex> L(MemoryMu);
+      MemoryInUse -= Estimate;
+    }
+    MemoryCV.notify_all();
+  }
+
 public:
   InProcessThinBackend(
       const Config &Conf, ModuleSummaryIndex &CombinedIndex,
-      ThreadPoolStrategy ThinLTOParallelism,
+      ThreadPoolStrategy ThinLTOParallelism, uint64_t MemoryBudget,
       const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
       AddStreamFn AddStream, FileCache Cache)
       : ThinBackendProc(Conf, CombinedIndex, ModuleToDefinedGVSummaries),
         BackendThreadPool(ThinLTOParallelism), AddStream(std::move(AddStream)),
-        Cache(std::move(Cache)) {
+        Cache(std::move(Cache)), MemoryBudget(MemoryBudget) {
     for (auto &Name : CombinedIndex.cfiFunctionDefs())
       CfiFunctionDefs.insert(
           GlobalValue::getGUID(GlobalValue::dropLLVMManglingEscape(Name)));
@@ -1206,6 +1320,15 @@ public:
           GlobalValue::getGUID(GlobalValue::dropLLVMManglingEscape(Name)));
   }
 
+  /// Returns true if the result of the backend for \p ModuleID may be cached.
+  bool isCacheable(StringRef ModuleID) const {
+    // The cache must be enabled and the combined index must have a module
+    // hash for this module.
+    return Cache && CombinedIndex.modulePaths().count(ModuleID) &&
+           !all_of(CombinedIndex.getModuleHash(ModuleID),
+                   [](uint32_t V) { return V == 0; });
+  }
+
   Error runThinLTOBackendThread(
       AddStreamFn AddStream, FileCache Cache, unsigned Task, BitcodeModule BM,
       ModuleSummaryIndex &CombinedIndex,
@@ -1213,7 +1336,7 @@ public:
       const FunctionImporter::ExportSetTy &ExportList,
       const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
       const GVSummaryMapTy &DefinedGlobals,
-      MapVector<StringRef, BitcodeModule> &ModuleMap) {
+      MapVector<StringRef, BitcodeModule> &ModuleMap, SmallString<40> Key) {
     auto RunThinBackend = [&](AddStreamFn AddStream) {
       LTOLLVMContext BackendContext(Conf);
       Expected<std::unique_ptr<Module>> MOrErr = BM.parseModule(BackendContext);
@@ -1226,18 +1349,17 @@ public:
 
     auto ModuleID = BM.getModuleIdentifier();
 
-    if (!Cache || !CombinedIndex.modulePaths().count(ModuleID) ||
-        all_of(CombinedIndex.getModuleHash(ModuleID),
-               [](uint32_t V) { return V == 0; }))
+    if (!isCacheable(ModuleID))
       // Cache disabled or no entry for this module in the combined index or
       // no module hash.
       return RunThinBackend(AddStream);
 
-    SmallString<40> Key;
-    // The module may be cached, this helps handling it.
-    computeLTOCacheKey(Key, Conf, CombinedIndex, ModuleID, ImportList,
-                       ExportList, ResolvedODR, DefinedGlobals, CfiFunctionDefs,
-                       CfiFunctionDecls);
+    // The module may be cached, this helps handling it. The key was computed
+    // up front if it had to be passed to the prefetch hook.
+    if (Key.empty())
+      computeLTOCacheKey(Key, Conf, CombinedIndex, ModuleID, ImportList,
+                         ExportList, ResolvedODR, DefinedGlobals,
+                         CfiFunctionDefs, CfiFunctionDecls);
     Expected<AddStreamFn> CacheAddStreamOrErr = Cache(Task, Key);
     if (Error Err = CacheAddStreamOrErr.takeError())
       return Err;
@@ -1258,6 +1380,17 @@ public:
     assert(ModuleToDefinedGVSummaries.count(ModulePath));
     const GVSummaryMapTy &DefinedGlobals =
         ModuleToDefinedGVSummaries.find(ModulePath)->second;
+    SmallString<40> Key;
+    if (Conf.CachePrefetchHook && isCacheable(ModulePath)) {
+      computeLTOCacheKey(Key, Conf, CombinedIndex, ModulePath, ImportList,
+                         ExportList, ResolvedODR, DefinedGlobals,
+                         CfiFunctionDefs, CfiFunctionDecls);
+      Conf.CachePrefetchHook(Key);
+    }
+    uint64_t MemoryEstimate =
+        MemoryBudget ? estimateThinBackendMemory(CombinedIndex, BM,
+                                                 DefinedGlobals, ImportList)
+                     : 0;
     BackendThreadPool.async(
         [=](BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
             const FunctionImporter::ImportMapTy &ImportList,
@@ -1269,9 +1402,13 @@ public:
           if (LLVM_ENABLE_THREADS && Conf.TimeTraceEnabled)
             timeTraceProfilerInitialize(Conf.TimeTraceGranularity,
                                         "thin backend");
+          if (MemoryBudget)
+            acquireMemory(MemoryEstimate);
           Error E = runThinLTOBackendThread(
               AddStream, Cache, Task, BM, CombinedIndex, ImportList, ExportList,
-              ResolvedODR, DefinedGlobals, ModuleMap);
+              ResolvedODR, DefinedGlobals, ModuleMap, Key);
+          if (MemoryBudget)
+            releaseMemory(MemoryEstimate);
           if (E) {
             std::unique_lock<std::mutex> L(ErrMu);
             if (Err)
@@ -1301,13 +1438,14 @@ public:
 };
 } // end anonymous namespace
 
-ThinBackend lto::createInProcessThinBackend(ThreadPoolStrategy Parallelism) {
+ThinBackend lto::createInProcessThinBackend(ThreadPoolStrategy Parallelism,
+                                            uint64_t MemoryBudget) {
   return [=](const Config &Conf, ModuleSummaryIndex &CombinedIndex,
              const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
              AddStreamFn AddStream, FileCache Cache) {
     return std::make_unique<InProcessThinBackend>(
-        Conf, CombinedIndex, Parallelism, ModuleToDefinedGVSummaries, AddStream,
-        Cache);
+        Conf, CombinedIndex, Parallelism, MemoryBudget,
+        ModuleToDefinedGVSummaries, AddStream, Cache);
   };
 }
 
@@ -1470,7 +1608,8 @@ Error LTO::runThinLTO(AddStreamFn AddStream, FileCache Cache,
 
   if (Conf.OptLevel > 0)
     ComputeCrossModuleImport(ThinLTO.CombinedIndex, ModuleToDefinedGVSummaries,
-                             ImportLists, ExportLists);
+                             ImportLists, ExportLists,
+                             Conf.ThinLinkParallelism);
 
   // Figure out which symbols need to be internalized. This also needs to happen
   // at -O0 because summary-based DCE is implemented using internalization, and
@@ -1559,15 +1698,24 @@ Error LTO::runThinLTO(AddStreamFn AddStream, FileCache Cache,
       if (Error E = ProcessOneModule(I))
         return E;
   } else {
-    // When executing in parallel, process largest bitsize modules first to
+    // When executing in parallel, process the most expensive modules first to
     // improve parallelism, and avoid starving the thread pool near the end.
     // This saves about 15 sec on a 36-core machine while link `clang.exe` (out
-    // of 100 sec).
-    std::vector<BitcodeModule *> ModulesVec;
-    ModulesVec.reserve(ModuleMap.size());
+    // of 100 sec). The cost is estimated from the summaries of the functions
+    // each backend defines and imports, which tracks both its run time and
+    // its peak memory better than the bitcode size alone.
+    std::vector<uint64_t> Costs;
+    Costs.reserve(ModuleMap.size());
     for (auto &Mod : ModuleMap)
-      ModulesVec.push_back(&Mod.second);
-    for (int I : generateModulesOrdering(ModulesVec))
+      Costs.push_back(estimateThinBackendMemory(
+          ThinLTO.CombinedIndex, Mod.second,
+          ModuleToDefinedGVSummaries[Mod.first], ImportLists[Mod.first]));
+    auto Seq = llvm::seq<int>(0, ModuleMap.size());
+    std::vector<int> ModulesOrdering(Seq.begin(), Seq.end());
+    llvm::stable_sort(ModulesOrdering, [&](int LeftIndex, int RightIndex) {
+      return Costs[LeftIndex] > Costs[RightIndex];
+    });
+    for (int I : ModulesOrdering)
       if (Error E = ProcessOneModule(I))
         return E;
   }
@@ -115,7 +115,9 @@ Error Config::addSaveTemps(std::string OutputFileName,
         PathPrefix = M.getModuleIdentifier() + ".";
       std::string Path = PathPrefix + PathSuffix + ".bc";
       std::error_code EC;
-      raw_fd_ostream OS(Path, EC, sys::fs::OpenFlags::OF_None);
+      // Open the file for seeking so that the bitcode writer can stream large
+      // modules to it instead of buffering them whole.
+      raw_fd_stream OS(Path, EC);
       // Because -save-temps is a debugging feature, we report the error
       // directly and exit.
       if (EC)
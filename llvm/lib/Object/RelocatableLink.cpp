@@ -0,0 +1,568 @@
+//===- RelocatableLink.cpp - Combine relocatable object files -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implements the linkRelocatableObjects function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/RelocatableLink.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Object/ELF.h"
+#include "llvm/Object/ELFTypes.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace llvm::ELF;
+
+namespace {
+
+/// The contents of an ELF string table being built.
+class StringTable {
+public:
+  StringTable() { Data.push_back('\0'); }
+
+  uint32_t add(StringRef S) {
+    if (S.empty())
+      return 0;
+    auto Inserted = Offsets.try_emplace(S, Data.size());
+    if (Inserted.second) {
+      Data.append(S.begin(), S.end());
+      Data.push_back('\0');
+    }
+    return Inserted.first->second;
+  }
+
+  ArrayRef<uint8_t> data() const {
+    return makeArrayRef(reinterpret_cast<const uint8_t *>(Data.data()),
+                        Data.size());
+  }
+
+private:
+  SmallVector<char, 0> Data;
+  StringMap<uint32_t> Offsets;
+};
+
+/// Returns an error for an input that is valid but that this doesn't support,
+/// which callers can tell apart from other errors.
+static Error createUnsupportedError(const Twine &Msg) {
+  return createStringError(errc::not_supported, Msg);
+}
+
+/// Returns the most restrictive of two symbol visibilities.
+static uint8_t mergeVisibility(uint8_t A, uint8_t B) {
+  if (A == STV_DEFAULT)
+    return B;
+  if (B == STV_DEFAULT)
+    return A;
+  // STV_INTERNAL < STV_HIDDEN < STV_PROTECTED.
+  return std::min(A, B);
+}
+
+template <class ELFT> class ELFRelocatableLinker {
+  LLVM_ELF_IMPORT_TYPES_ELFT(ELFT)
+
+  struct InputObject {
+    InputObject(ELFFile<ELFT> File) : File(File) {}
+
+    ELFFile<ELFT> File;
+    Elf_Shdr_Range Sections{nullptr, nullptr};
+    Elf_Sym_Range Symbols{nullptr, nullptr};
+    StringRef SectionNames;
+    StringRef SymbolNames;
+    unsigned FirstGlobal = 0;
+
+    /// The index of the output section of each section, or 0 for the sections
+    /// that are dropped.
+    std::vector<uint32_t> SectionMap;
+
+    /// The index of the output symbol of each local symbol, and of the global
+    /// symbol it resolves to for each global symbol, first into Globals, and
+    /// into the output symbol table once it is laid out.
+    std::vector<uint32_t> SymbolMap;
+  };
+
+  struct OutputSection {
+    Elf_Shdr Header;
+    StringRef Name;
+    ArrayRef<uint8_t> Contents;
+    /// The contents, if they were rewritten.
+    std::vector<uint8_t> Buffer;
+  };
+
+  struct OutputSymbol {
+    Elf_Sym Sym;
+    StringRef Name;
+  };
+
+  /// The index in InputObject::SymbolMap of the symbols that are dropped.
+  static constexpr uint32_t DroppedSymbol = ~0U;
+
+  const StringSet<> &LocalizedSymbols;
+  std::vector<InputObject> Inputs;
+  std::vector<OutputSection> Sections;
+  std::vector<OutputSymbol> Locals;
+  std::vector<OutputSymbol> Globals;
+  StringMap<uint32_t> GlobalIndex;
+  uint32_t SymTabIndex = 0;
+
+  Error readInput(MemoryBufferRef Buffer);
+  bool isDropped(const InputObject &In, const Elf_Shdr &Sec) const;
+  Error addSymbols(InputObject &In);
+  Error mergeGlobal(OutputSymbol &Old, const Elf_Sym &New);
+  void layOutSymbols();
+  Error rewriteSection(InputObject &In, const Elf_Shdr &Sec,
+                       OutputSection &Out);
+  Error write(raw_ostream &OS);
+
+public:
+  explicit ELFRelocatableLinker(const StringSet<> &LocalizedSymbols)
+      : LocalizedSymbols(LocalizedSymbols) {}
+
+  Error link(ArrayRef<MemoryBufferRef> Buffers, raw_ostream &OS);
+};
+
+} // end anonymous namespace
+
+template <class ELFT>
+Error ELFRelocatableLinker<ELFT>::readInput(MemoryBufferRef Buffer) {
+  Expected<ELFFile<ELFT>> File = ELFFile<ELFT>::create(Buffer.getBuffer());
+  if (!File)
+    return File.takeError();
+  const Elf_Ehdr &Header = File->getHeader();
+  if (Header.e_type != ET_REL)
+    return createError(Buffer.getBufferIdentifier() +
+                       ": not a relocatable object");
+  if (Header.e_machine == EM_MIPS)
+    return createUnsupportedError(Buffer.getBufferIdentifier() +
+                                  ": MIPS objects are not supported");
+  if (!Inputs.empty()) {
+    const Elf_Ehdr &First = Inputs.front().File.getHeader();
+    if (Header.e_machine != First.e_machine ||
+        Header.e_flags != First.e_flags ||
+        Header.e_ident[EI_OSABI] != First.e_ident[EI_OSABI] ||
+        Header.e_ident[EI_ABIVERSION] != First.e_ident[EI_ABIVERSION])
+      return createError(Buffer.getBufferIdentifier() +
+                         ": incompatible with the other inputs");
+  }
+
+  Inputs.emplace_back(*File);
+  InputObject &In = Inputs.back();
+  Expected<Elf_Shdr_Range> Sections = In.File.sections();
+  if (!Sections)
+    return Sections.takeError();
+  In.Sections = *Sections;
+  Expected<StringRef> SectionNames = In.File.getSectionStringTable(*Sections);
+  if (!SectionNames)
+    return SectionNames.takeError();
+  In.SectionNames = *SectionNames;
+
+  // Symbols store section indices in 16 bits, and larger ones in an extended
+  // section index table, which this does not support.
+  if (In.Sections.size() >= SHN_LORESERVE)
+    return createUnsupportedError(Buffer.getBufferIdentifier() +
+                                  ": too many sections");
+  for (const Elf_Shdr &Sec : In.Sections) {
+    if (Sec.sh_type == SHT_SYMTAB_SHNDX)
+      return createUnsupportedError(
+          Buffer.getBufferIdentifier() +
+          ": extended section indices are not supported");
+    if (Sec.sh_type != SHT_SYMTAB)
+      continue;
+    if (!In.Symbols.empty())
+      return createError(Buffer.getBufferIdentifier() +
+                         ": more than one symbol table");
+    Expected<Elf_Sym_Range> Symbols = In.File.symbols(&Sec);
+    if (!Symbols)
+      return Symbols.takeError();
+    Expected<StringRef> SymbolNames = In.File.getStringTableForSymtab(Sec);
+    if (!SymbolNames)
+      return SymbolNames.takeError();
+    In.Symbols = *Symbols;
+    In.SymbolNames = *SymbolNames;
+    In.FirstGlobal = Sec.sh_info;
+    if (In.FirstGlobal == 0 || In.FirstGlobal > In.Symbols.size())
+      return createError(Buffer.getBufferIdentifier() +
+                         ": invalid symbol table");
+  }
+  return Error::success();
+}
+
+/// Returns whether the section \p Sec of \p In is left out of the output.
+template <class ELFT>
+bool ELFRelocatableLinker<ELFT>::isDropped(const InputObject &In,
+                                           const Elf_Shdr &Sec) const {
+  switch (Sec.sh_type) {
+  case SHT_NULL:
+  case SHT_SYMTAB:
+  case SHT_STRTAB:
+  // The call graph profile is only a hint for the linker, and refers to
+  // symbols by index.
+  case SHT_LLVM_CALL_GRAPH_PROFILE:
+    return true;
+  case SHT_REL:
+  case SHT_RELA:
+    // Drop the relocations of the sections that are dropped.
+    return Sec.sh_info >= In.Sections.size() ||
+           isDropped(In, In.Sections[Sec.sh_info]);
+  default:
+    return false;
+  }
+}
+
+template <class ELFT>
+Error ELFRelocatableLinker<ELFT>::mergeGlobal(OutputSymbol &Old,
+                                              const Elf_Sym &New) {
+  uint8_t Visibility =
+      mergeVisibility(Old.Sym.getVisibility(), New.getVisibility());
+  bool OldDefined = !Old.Sym.isUndefined();
+  bool NewDefined = !New.isUndefined();
+  if (NewDefined && OldDefined) {
+    bool OldStrong = Old.Sym.getBinding() != STB_WEAK && !Old.Sym.isCommon();
+    bool NewStrong = New.getBinding() != STB_WEAK && !New.isCommon();
+    if (OldStrong && NewStrong)
+      return createError("duplicate symbol '" + Old.Name + "'");
+    if (NewStrong)
+      Old.Sym = New;
+  } else if (NewDefined) {
+    Old.Sym = New;
+  } else if (!OldDefined && New.getBinding() == STB_GLOBAL) {
+    // A strong reference takes precedence over weak ones.
+    Old.Sym.setBinding(STB_GLOBAL);
+  }
+  Old.Sym.setVisibility(Visibility);
+  return Error::success();
+}
+
+template <class ELFT>
+Error ELFRelocatableLinker<ELFT>::addSymbols(InputObject &In) {
+  In.SymbolMap.assign(In.Symbols.size(), DroppedSymbol);
+  for (unsigned I = 1, E = In.Symbols.size(); I != E; ++I) {
+    Elf_Sym Sym = In.Symbols[I];
+    Expected<StringRef> Name = Sym.getName(In.SymbolNames);
+    if (!Name)
+      return Name.takeError();
+
+    uint16_t Shndx = Sym.st_shndx;
+    if (Shndx == SHN_XINDEX)
+      return createUnsupportedError("extended section index of symbol '" +
+                                    *Name + "'");
+    if (Shndx != SHN_UNDEF && Shndx < SHN_LORESERVE) {
+      if (Shndx >= In.SectionMap.size())
+        return createError("invalid section index of symbol '" + *Name + "'");
+      // Symbols of dropped sections, such as the section symbol of the call
+      // graph profile, are only referred to by dropped sections.
+      if (!In.SectionMap[Shndx])
+        continue;
+      Sym.st_shndx = In.SectionMap[Shndx];
+    }
+
+    if (I < In.FirstGlobal) {
+      In.SymbolMap[I] = Locals.size();
+      Locals.push_back({Sym, *Name});
+      continue;
+    }
+    auto Inserted = GlobalIndex.try_emplace(*Name, Globals.size());
+    In.SymbolMap[I] = Inserted.first->second;
+    if (Inserted.second) {
+      Globals.push_back({Sym, Inserted.first->first()});
+      continue;
+    }
+    if (Error E = mergeGlobal(Globals[Inserted.first->second], Sym))
+      return E;
+  }
+  return Error::success();
+}
+
+/// Assigns the indices of the output symbol table: the local symbols of the
+/// inputs first, then the localized global symbols, then the global ones.
+template <class ELFT> void ELFRelocatableLinker<ELFT>::layOutSymbols() {
+  std::vector<uint32_t> GlobalMap(Globals.size(), 0);
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    OutputSymbol &G = Globals[I];
+    if (G.Sym.isUndefined() || !LocalizedSymbols.count(G.Name))
+      continue;
+    G.Sym.setBinding(STB_LOCAL);
+    G.Sym.setVisibility(STV_DEFAULT);
+    GlobalMap[I] = 1 + Locals.size();
+    Locals.push_back(G);
+  }
+  std::vector<OutputSymbol> Remaining;
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    if (GlobalMap[I])
+      continue;
+    GlobalMap[I] = 1 + Locals.size() + Remaining.size();
+    Remaining.push_back(Globals[I]);
+  }
+  Globals = std::move(Remaining);
+
+  for (InputObject &In : Inputs)
+    for (unsigned I = 1, E = In.SymbolMap.size(); I != E; ++I) {
+      uint32_t &Index = In.SymbolMap[I];
+      if (Index == DroppedSymbol)
+        Index = 0;
+      else
+        Index = I < In.FirstGlobal ? Index + 1 : GlobalMap[Index];
+    }
+}
+
+template <class ELFT>
+Error ELFRelocatableLinker<ELFT>::rewriteSection(InputObject &In,
+                                                 const Elf_Shdr &Sec,
+                                                 OutputSection &Out) {
+  auto MapSymbol = [&](uint32_t Index) -> Expected<uint32_t> {
+    if (Index >= In.SymbolMap.size())
+      return createError("invalid symbol index in section '" + Out.Name + "'");
+    return In.SymbolMap[Index];
+  };
+  auto Append = [&](const auto &Value) {
+    const uint8_t *Bytes = reinterpret_cast<const uint8_t *>(&Value);
+    Out.Buffer.insert(Out.Buffer.end(), Bytes, Bytes + sizeof(Value));
+  };
+
+  switch (Sec.sh_type) {
+  case SHT_REL:
+  case SHT_RELA: {
+    Out.Header.sh_link = SymTabIndex;
+    Out.Header.sh_info = In.SectionMap[Sec.sh_info];
+    if (Sec.sh_type == SHT_REL) {
+      Expected<Elf_Rel_Range> Rels = In.File.rels(Sec);
+      if (!Rels)
+        return Rels.takeError();
+      for (Elf_Rel R : *Rels) {
+        Expected<uint32_t> Sym = MapSymbol(R.getSymbol(false));
+        if (!Sym)
+          return Sym.takeError();
+        R.setSymbol(*Sym, false);
+        Append(R);
+      }
+    } else {
+      Expected<Elf_Rela_Range> Relas = In.File.relas(Sec);
+      if (!Relas)
+        return Relas.takeError();
+      for (Elf_Rela R : *Relas) {
+        Expected<uint32_t> Sym = MapSymbol(R.getSymbol(false));
+        if (!Sym)
+          return Sym.takeError();
+        R.setSymbol(*Sym, false);
+        Append(R);
+      }
+    }
+    break;
+  }
+  case SHT_GROUP: {
+    Expected<ArrayRef<Elf_Word>> Words =
+        In.File.template getSectionContentsAsArray<Elf_Word>(Sec);
+    if (!Words)
+      return Words.takeError();
+    if (Words->empty())
+      return createError("empty section group '" + Out.Name + "'");
+    Expected<uint32_t> Signature = MapSymbol(Sec.sh_info);
+    if (!Signature)
+      return Signature.takeError();
+    Out.Header.sh_link = SymTabIndex;
+    Out.Header.sh_info = *Signature;
+    Append(Words->front());
+    for (Elf_Word Member : Words->drop_front()) {
+      if (Member >= In.SectionMap.size())
+        return createError("invalid member of section group '" + Out.Name +
+                           "'");
+      if (uint32_t Index = In.SectionMap[Member])
+        Append(Elf_Word(Index));
+    }
+    break;
+  }
+  case SHT_LLVM_ADDRSIG: {
+    Out.Header.sh_link = SymTabIndex;
+    const uint8_t *Cur = Out.Contents.begin();
+    const uint8_t *End = Out.Contents.end();
+    while (Cur != End) {
+      unsigned Size;
+      const char *Error = nullptr;
+      uint64_t Index = decodeULEB128(Cur, &Size, End, &Error);
+      if (Error)
+        return createError("invalid address-significance table");
+      Cur += Size;
+      Expected<uint32_t> Sym = MapSymbol(Index);
+      if (!Sym)
+        return Sym.takeError();
+      uint8_t Encoded[16];
+      unsigned Length = encodeULEB128(*Sym, Encoded);
+      Out.Buffer.insert(Out.Buffer.end(), Encoded, Encoded + Length);
+    }
+    break;
+  }
+  default:
+    if (Sec.sh_flags & SHF_LINK_ORDER) {
+      if (Sec.sh_link >= In.SectionMap.size())
+        return createError("invalid linked section of section '" + Out.Name +
+                           "'");
+      Out.Header.sh_link = In.SectionMap[Sec.sh_link];
+    }
+    return Error::success();
+  }
+  Out.Contents = Out.Buffer;
+  return Error::success();
+}
+
+template <class ELFT>
+Error ELFRelocatableLinker<ELFT>::write(raw_ostream &OS) {
+  StringTable SectionNames, SymbolNames;
+  // Keep references to the sections added below valid.
+  Sections.reserve(Sections.size() + 3);
+
+  std::vector<Elf_Sym> SymTab(1 + Locals.size() + Globals.size());
+  std::memset(SymTab.data(), 0, SymTab.size() * sizeof(Elf_Sym));
+  unsigned I = 1;
+  for (const std::vector<OutputSymbol> *Symbols : {&Locals, &Globals})
+    for (const OutputSymbol &S : *Symbols) {
+      SymTab[I] = S.Sym;
+      // Section symbols are named after their section.
+      SymTab[I++].st_name =
+          S.Sym.getType() == STT_SECTION ? 0 : SymbolNames.add(S.Name);
+    }
+
+  auto AddTable = [&](StringRef Name, uint32_t Type) -> OutputSection & {
+    Sections.emplace_back();
+    OutputSection &Out = Sections.back();
+    std::memset(&Out.Header, 0, sizeof(Elf_Shdr));
+    Out.Name = Name;
+    Out.Header.sh_type = Type;
+    Out.Header.sh_addralign = 1;
+    return Out;
+  };
+  OutputSection &SymTabSec = AddTable(".symtab", SHT_SYMTAB);
+  SymTabSec.Contents = makeArrayRef(
+      reinterpret_cast<const uint8_t *>(SymTab.data()),
+      SymTab.size() * sizeof(Elf_Sym));
+  SymTabSec.Header.sh_link = Sections.size();
+  SymTabSec.Header.sh_info = 1 + Locals.size();
+  SymTabSec.Header.sh_entsize = sizeof(Elf_Sym);
+  SymTabSec.Header.sh_addralign = alignof(Elf_Addr);
+  AddTable(".strtab", SHT_STRTAB).Contents = SymbolNames.data();
+  unsigned ShStrTabIndex = Sections.size();
+  OutputSection &ShStrTab = AddTable(".shstrtab", SHT_STRTAB);
+  if (Sections.size() >= SHN_LORESERVE)
+    return createUnsupportedError("too many sections");
+
+  for (OutputSection &Out : Sections)
+    Out.Header.sh_name = SectionNames.add(Out.Name);
+  ShStrTab.Contents = SectionNames.data();
+
+  // Lay out the output: the ELF header, the contents of the sections, and the
+  // section header table.
+  SmallVector<char, 0> Data(sizeof(Elf_Ehdr));
+  for (OutputSection &Out : Sections) {
+    if (Out.Header.sh_type == SHT_NULL)
+      continue;
+    Data.resize(alignTo(Data.size(), std::max<uint64_t>(
+                                         Out.Header.sh_addralign, 1)));
+    Out.Header.sh_offset = Data.size();
+    if (Out.Header.sh_type == SHT_NOBITS)
+      continue;
+    Out.Header.sh_size = Out.Contents.size();
+    Data.append(Out.Contents.begin(), Out.Contents.end());
+  }
+  Data.resize(alignTo(Data.size(), alignof(Elf_Addr)));
+
+  Elf_Ehdr Header = Inputs.front().File.getHeader();
+  Header.e_phoff = 0;
+  Header.e_phnum = 0;
+  Header.e_phentsize = 0;
+  Header.e_shoff = Data.size();
+  Header.e_shentsize = sizeof(Elf_Shdr);
+  Header.e_shnum = Sections.size();
+  Header.e_shstrndx = ShStrTabIndex;
+  std::memcpy(Data.data(), &Header, sizeof(Header));
+  for (const OutputSection &Out : Sections)
+    Data.append(reinterpret_cast<const char *>(&Out.Header),
+                reinterpret_cast<const char *>(&Out.Header + 1));
+
+  OS.write(Data.data(), Data.size());
+  return Error::success();
+}
+
+template <class ELFT>
+Error ELFRelocatableLinker<ELFT>::link(ArrayRef<MemoryBufferRef> Buffers,
+                                       raw_ostream &OS) {
+  Inputs.reserve(Buffers.size());
+  for (MemoryBufferRef Buffer : Buffers)
+    if (Error E = readInput(Buffer))
+      return E;
+
+  // The null section comes first, and the symbol table, its strings and the
+  // section names last.
+  Sections.emplace_back();
+  std::memset(&Sections.back().Header, 0, sizeof(Elf_Shdr));
+  for (InputObject &In : Inputs) {
+    In.SectionMap.assign(In.Sections.size(), 0);
+    for (unsigned I = 0, E = In.Sections.size(); I != E; ++I) {
+      const Elf_Shdr &Sec = In.Sections[I];
+      if (isDropped(In, Sec))
+        continue;
+      In.SectionMap[I] = Sections.size();
+      Sections.emplace_back();
+    }
+  }
+  SymTabIndex = Sections.size();
+
+  for (InputObject &In : Inputs)
+    if (Error E = addSymbols(In))
+      return E;
+  layOutSymbols();
+
+  for (InputObject &In : Inputs) {
+    for (unsigned I = 0, E = In.Sections.size(); I != E; ++I) {
+      const Elf_Shdr &Sec = In.Sections[I];
+      if (!In.SectionMap[I])
+        continue;
+      OutputSection &Out = Sections[In.SectionMap[I]];
+      Out.Header = Sec;
+      Out.Header.sh_offset = 0;
+      Expected<StringRef> Name = In.File.getSectionName(Sec, In.SectionNames);
+      if (!Name)
+        return Name.takeError();
+      Out.Name = *Name;
+      if (Sec.sh_type != SHT_NOBITS) {
+        Expected<ArrayRef<uint8_t>> Contents = In.File.getSectionContents(Sec);
+        if (!Contents)
+          return Contents.takeError();
+        Out.Contents = *Contents;
+      }
+      if (Error E = rewriteSection(In, Sec, Out))
+        return E;
+    }
+  }
+  return write(OS);
+}
+
+Error object::linkRelocatableObjects(ArrayRef<MemoryBufferRef> Inputs,
+                                     const StringSet<> &LocalizedSymbols,
+                                     raw_ostream &OS) {
+  if (Inputs.empty())
+    return createError("no input objects");
+  std::pair<unsigned char, unsigned char> Type =
+      getElfArchType(Inputs.front().getBuffer());
+  if (Type.first == ELFCLASS32 && Type.second == ELFDATA2LSB)
+    return ELFRelocatableLinker<ELF32LE>(LocalizedSymbols).link(Inputs, OS);
+  if (Type.first == ELFCLASS32 && Type.second == ELFDATA2MSB)
+    return ELFRelocatableLinker<ELF32BE>(LocalizedSymbols).link(Inputs, OS);
+  if (Type.first == ELFCLASS64 && Type.second == ELFDATA2LSB)
+    return ELFRelocatableLinker<ELF64LE>(LocalizedSymbols).link(Inputs, OS);
+  if (Type.first == ELFCLASS64 && Type.second == ELFDATA2MSB)
+    return ELFRelocatableLinker<ELF64BE>(LocalizedSymbols).link(Inputs, OS);
+  return createError(Inputs.front().getBufferIdentifier() +
+                     ": not an ELF object");
+}
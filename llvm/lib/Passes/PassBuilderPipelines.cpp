@@ -47,6 +47,7 @@
 #include "llvm/Transforms/IPO/ElimAvailExtern.h"
 #include "llvm/Transforms/IPO/ForceFunctionAttrs.h"
 #include "llvm/Transforms/IPO/FunctionAttrs.h"
+#include "llvm/Transforms/IPO/FunctionOptCache.h"
 #include "llvm/Transforms/IPO/GlobalDCE.h"
 #include "llvm/Transforms/IPO/GlobalOpt.h"
 #include "llvm/Transforms/IPO/GlobalSplit.h"
@@ -183,6 +184,11 @@ static cl::opt<bool> EnableMergeFunctions(
     "enable-merge-functions", cl::init(false), cl::Hidden,
     cl::desc("Enable function merging as part of the optimization pipeline"));
 
+static cl::opt<std::string> FunctionOptCacheDir(
+    "function-opt-cache-dir", cl::Hidden,
+    cl::desc("Reuse the results of the per-function parts of the default "
+             "pipelines for unchanged functions from this directory"));
+
 PipelineTuningOptions::PipelineTuningOptions() {
   LoopInterleaving = true;
   LoopVectorization = true;
@@ -226,6 +232,24 @@ extern cl::opt<bool> DisablePreInliner;
 extern cl::opt<int> PreInlineThreshold;
 } // namespace llvm
 
+/// Makes \p FPM reuse its results from -function-opt-cache-dir, if given.
+static FunctionPassManager addFunctionOptCache(FunctionPassManager FPM,
+                                               TargetMachine *TM,
+                                               OptimizationLevel Level) {
+  if (FunctionOptCacheDir.empty())
+    return FPM;
+  std::string Context = "O" + utostr(Level.getSpeedupLevel()) + "s" +
+                        utostr(Level.getSizeLevel());
+  if (TM)
+    Context += (" " + TM->getTargetTriple().str() + " " +
+                TM->getTargetCPU() + " " + TM->getTargetFeatureString())
+                   .str();
+  FunctionPassManager CachedFPM;
+  CachedFPM.addPass(
+      FunctionOptCachePass(std::move(FPM), FunctionOptCacheDir, Context));
+  return CachedFPM;
+}
+
 void PassBuilder::invokePeepholeEPCallbacks(FunctionPassManager &FPM,
                                             OptimizationLevel Level) {
   for (auto &C : PeepholeEPCallbacks)
@@ -774,7 +798,8 @@ PassBuilder::buildInlinerPipeline(OptimizationLevel Level,
   // Lastly, add the core function simplification pipeline nested inside the
   // CGSCC walk.
   MainCGPipeline.addPass(createCGSCCToFunctionPassAdaptor(
-      buildFunctionSimplificationPipeline(Level, Phase),
+      addFunctionOptCache(buildFunctionSimplificationPipeline(Level, Phase), TM,
+                          Level),
       PTO.EagerlyInvalidateAnalyses, EnableNoRerunSimplificationPipeline));
 
   MainCGPipeline.addPass(CoroSplitPass(Level != OptimizationLevel::O0));
@@ -816,7 +841,8 @@ PassBuilder::buildModuleInlinerPipeline(OptimizationLevel Level,
   MPM.addPass(ModuleInlinerPass(IP, UseInlineAdvisor));
 
   MPM.addPass(createModuleToFunctionPassAdaptor(
-      buildFunctionSimplificationPipeline(Level, Phase),
+      addFunctionOptCache(buildFunctionSimplificationPipeline(Level, Phase), TM,
+                          Level),
       PTO.EagerlyInvalidateAnalyses));
 
   MPM.addPass(createModuleToPostOrderCGSCCPassAdaptor(
@@ -1249,8 +1275,9 @@ PassBuilder::buildModuleOptimizationPipeline(OptimizationLevel Level,
       SimplifyCFGPass(SimplifyCFGOptions().convertSwitchRangeToICmp(true)));
 
   // Add the core optimizing pipeline.
-  MPM.addPass(createModuleToFunctionPassAdaptor(std::move(OptimizePM),
-                                                PTO.EagerlyInvalidateAnalyses));
+  MPM.addPass(createModuleToFunctionPassAdaptor(
+      addFunctionOptCache(std::move(OptimizePM), TM, Level),
+      PTO.EagerlyInvalidateAnalyses));
 
   for (auto &C : OptimizerLastEPCallbacks)
     C(MPM, Level);
@@ -19,6 +19,7 @@
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/LazyCallGraph.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -165,6 +166,14 @@ static cl::opt<std::string> DotCfgDir(
     cl::desc("Generate dot files into specified directory for changed IRs"),
     cl::Hidden, cl::init("./"));
 
+// The time in milliseconds that the optional passes may spend on a function
+// before they get throttled on it. See CompileTimeBudgetInstrumentation.
+static cl::opt<unsigned> CompileTimeBudgetMs(
+    "compile-time-budget-ms", cl::init(0), cl::Hidden,
+    cl::desc("Time in milliseconds the optimization passes may spend on a "
+             "function before expensive passes run in cheaper modes or are "
+             "skipped on it (0 = unlimited)"));
+
 namespace {
 
 // Perform a system based diff between \p Before and \p After, using
@@ -900,6 +909,109 @@ void OptBisectInstrumentation::registerCallbacks(
   });
 }
 
+CompileTimeBudgetInstrumentation::CompileTimeBudgetInstrumentation()
+    : Budget(CompileTimeBudgetMs) {}
+
+void CompileTimeBudgetInstrumentation::registerCallbacks(
+    PassInstrumentationCallbacks &PIC) {
+  if (Budget.count() == 0)
+    return;
+  PIC.registerShouldRunOptionalPassCallback(
+      [this](StringRef P, Any IR) { return this->shouldRun(P, IR); });
+  PIC.registerBeforeNonSkippedPassCallback(
+      [this](StringRef, Any IR) { this->startPass(IR); });
+  PIC.registerAfterPassCallback([this](StringRef, Any,
+                                      const PreservedAnalyses &) {
+    this->finishPass();
+  });
+  PIC.registerAfterPassInvalidatedCallback(
+      [this](StringRef, const PreservedAnalyses &) { this->finishPass(); });
+}
+
+static constexpr StringLiteral BudgetExceededAttr =
+    "compile-time-budget-exceeded";
+
+static const Function *getFunctionOfIR(Any IR) {
+  if (any_isa<const Function *>(IR))
+    return any_cast<const Function *>(IR);
+  if (any_isa<const Loop *>(IR))
+    return any_cast<const Loop *>(IR)->getHeader()->getParent();
+  return nullptr;
+}
+
+bool CompileTimeBudgetInstrumentation::shouldRun(StringRef PassID, Any IR) {
+  const Function *F = getFunctionOfIR(IR);
+  if (!F)
+    return true;
+  auto It = Costs.find(F);
+  if (It == Costs.end())
+    return true;
+  FunctionCost &Cost = It->second;
+  if (Cost.Skipped)
+    return false;
+
+  Clock::duration Spent = Cost.Spent;
+  if (Cost.Running)
+    Spent += Clock::now() - Cost.Start;
+  if (Spent <= Budget)
+    return true;
+
+  auto Report = [&](StringRef RemarkName, StringRef Action) {
+    auto Millis = std::chrono::duration_cast<std::chrono::milliseconds>(Spent);
+    OptimizationRemarkAnalysis R("compile-time-budget", RemarkName, F);
+    R << "optimizations spent " << ore::NV("Time", Millis.count())
+      << " ms on the function, over its budget of "
+      << ore::NV("Budget", Budget.count()) << " ms, before " << PassID << "; "
+      << Action;
+    F->getContext().diagnose(R);
+  };
+
+  bool WasDegraded = Cost.Degraded;
+  if (!WasDegraded) {
+    Cost.Degraded = true;
+    // Attributes do not affect any analysis results, so this leaves the
+    // cached analyses of the function valid.
+    const_cast<Function *>(F)->addFnAttr(BudgetExceededAttr);
+  }
+  if (Spent > 2 * Budget) {
+    Cost.Skipped = true;
+    Report("CompileTimeBudgetExhausted", "skipping the remaining passes");
+    return false;
+  }
+  if (!WasDegraded)
+    Report("CompileTimeBudgetExceeded", "running cheaper optimizations");
+  return !(PassID == "LoopVectorizePass" || PassID == "SLPVectorizerPass" ||
+           PassID == "LoopUnrollPass" || PassID == "LoopFullUnrollPass");
+}
+
+void CompileTimeBudgetInstrumentation::startPass(Any IR) {
+  const Function *F = getFunctionOfIR(IR);
+  RunningPasses.push_back(F);
+  if (!F)
+    return;
+  FunctionCost &Cost = Costs[F];
+  if (Cost.Running++ == 0) {
+    Cost.Start = Clock::now();
+    if (Cost.Degraded)
+      const_cast<Function *>(F)->addFnAttr(BudgetExceededAttr);
+  }
+}
+
+void CompileTimeBudgetInstrumentation::finishPass() {
+  const Function *F = RunningPasses.pop_back_val();
+  if (!F)
+    return;
+  FunctionCost &Cost = Costs[F];
+  if (--Cost.Running == 0) {
+    Cost.Spent += Clock::now() - Cost.Start;
+    // The attribute is only meant for the passes run under this budget, so it
+    // doesn't stay in the IR once they are done, where it would throttle later
+    // compilations of the function, such as in LTO.
+    if (Cost.Degraded)
+      const_cast<Function *>(F)->removeFnAttr(BudgetExceededAttr);
+  }
+}
+
 raw_ostream &PrintPassInstrumentation::print() {
   if (Opts.Indent) {
     assert(Indent >= 0);
@@ -2122,6 +2234,7 @@ void StandardInstrumentations::registerCallbacks(
   TimePasses.registerCallbacks(PIC);
   OptNone.registerCallbacks(PIC);
   OptBisect.registerCallbacks(PIC);
+  CompileTimeBudget.registerCallbacks(PIC);
   if (FAM)
     PreservedCFGChecker.registerCallbacks(PIC, *FAM);
   PrintChangedIR.registerCallbacks(PIC);
@@ -727,7 +727,12 @@ std::error_code SampleProfileReaderExtBinaryBase::readFuncOffsetTable() {
   if (std::error_code EC = Size.getError())
     return EC;
 
-  FuncOffsetTable.reserve(*Size);
+  // Context-sensitive profiles are only loaded on demand by walking the
+  // ordered offsets, so don't hash every context of the profile into the
+  // table as well.
+  bool UseFuncOffsetTable = !(ProfileIsCS && FuncOffsetsOrdered);
+  if (UseFuncOffsetTable)
+    FuncOffsetTable.reserve(*Size);
 
   if (FuncOffsetsOrdered) {
     OrderedFuncOffsets =
@@ -744,7 +749,8 @@ std::error_code SampleProfileReaderExtBinaryBase::readFuncOffsetTable() {
     if (std::error_code EC = Offset.getError())
       return EC;
 
-    FuncOffsetTable[*FContext] = *Offset;
+    if (UseFuncOffsetTable)
+      FuncOffsetTable[*FContext] = *Offset;
     if (FuncOffsetsOrdered)
       OrderedFuncOffsets->emplace_back(*FContext, *Offset);
   }
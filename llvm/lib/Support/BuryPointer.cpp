@@ -27,4 +27,10 @@ void BuryPointer(const void *Ptr) {
   GraveYard[Idx] = Ptr;
 }
 
+static std::atomic<bool> LeakOnExit;
+
+void enableLeakOnExit() { LeakOnExit = true; }
+
+bool isLeakOnExitEnabled() { return LeakOnExit; }
+
 } // namespace llvm
@@ -9,10 +9,13 @@
 // This file implements the localCache function, which simplifies creating,
 // adding to, and querying a local file system cache. localCache takes care of
 // periodically pruning older files from the cache using a CachePruningPolicy.
+// It also implements tieredCache, which layers a RemoteCacheStore behind
+// another cache.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Caching.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -26,6 +29,19 @@
 
 using namespace llvm;
 
+// This choice of file name allows the cache to be pruned (see pruneCache() in
+// include/llvm/Support/CachePruning.h).
+static void getEntryPath(SmallVectorImpl<char> &EntryPath,
+                         const Twine &CacheDirectoryPath, StringRef Key) {
+  sys::path::append(EntryPath, CacheDirectoryPath, "llvmcache-" + Key);
+}
+
+bool llvm::hasLocalCacheEntry(const Twine &CacheDirectoryPath, StringRef Key) {
+  SmallString<64> EntryPath;
+  getEntryPath(EntryPath, CacheDirectoryPath, Key);
+  return sys::fs::exists(EntryPath);
+}
+
 Expected<FileCache> llvm::localCache(Twine CacheNameRef,
                                      Twine TempFilePrefixRef,
                                      Twine CacheDirectoryPathRef,
@@ -38,10 +54,8 @@ Expected<FileCache> llvm::localCache(Twine CacheNameRef,
   CacheDirectoryPathRef.toVector(CacheDirectoryPath);
 
   return [=](unsigned Task, StringRef Key) -> Expected<AddStreamFn> {
-    // This choice of file name allows the cache to be pruned (see pruneCache()
-    // in include/llvm/Support/CachePruning.h).
     SmallString<64> EntryPath;
-    sys::path::append(EntryPath, CacheDirectoryPath, "llvmcache-" + Key);
+    getEntryPath(EntryPath, CacheDirectoryPath, Key);
     // First, see if we have a cache hit.
     SmallString<64> ResultPath;
     Expected<sys::fs::file_t> FDOrErr = sys::fs::openNativeFileForRead(
@@ -162,3 +176,74 @@ Expected<FileCache> llvm::localCache(Twine CacheNameRef,
     };
   };
 }
+
+FileCache llvm::tieredCache(FileCache Local,
+                            std::shared_ptr<RemoteCacheStore> Remote,
+                            std::function<void(Error)> ReportRemoteError) {
+  assert(Local && Remote && "tieredCache needs both tiers");
+  if (!ReportRemoteError)
+    ReportRemoteError = [](Error E) { consumeError(std::move(E)); };
+
+  // This file stream buffers the produced file so that, once the local tier
+  // has committed it and added it to the link, it can be uploaded as well.
+  struct UploadingStream : CachedFileStream {
+    std::unique_ptr<CachedFileStream> LocalStream;
+    std::shared_ptr<RemoteCacheStore> Remote;
+    std::string Key;
+    std::function<void(Error)> ReportRemoteError;
+    SmallString<0> Buffer;
+
+    UploadingStream(std::unique_ptr<CachedFileStream> LocalStream,
+                    std::shared_ptr<RemoteCacheStore> Remote, std::string Key,
+                    std::function<void(Error)> ReportRemoteError)
+        : CachedFileStream(nullptr, LocalStream->ObjectPathName),
+          LocalStream(std::move(LocalStream)), Remote(std::move(Remote)),
+          Key(std::move(Key)), ReportRemoteError(std::move(ReportRemoteError)) {
+      OS = std::make_unique<raw_svector_ostream>(Buffer);
+    }
+
+    ~UploadingStream() {
+      OS.reset();
+      *LocalStream->OS << Buffer;
+      // Destroying the local stream commits the file to the local tier.
+      LocalStream.reset();
+      if (Error E = Remote->put(Key, Buffer))
+        ReportRemoteError(std::move(E));
+    }
+  };
+
+  return [=](unsigned Task, StringRef Key) -> Expected<AddStreamFn> {
+    Expected<AddStreamFn> LocalAddStreamOrErr = Local(Task, Key);
+    if (!LocalAddStreamOrErr || !*LocalAddStreamOrErr) {
+      // The remote entry won't be looked up, so free it if it was prefetched.
+      Remote->discard(Key);
+      return LocalAddStreamOrErr;
+    }
+    AddStreamFn LocalAddStream = std::move(*LocalAddStreamOrErr);
+
+    Expected<std::unique_ptr<MemoryBuffer>> MBOrErr = Remote->get(Key);
+    if (!MBOrErr) {
+      ReportRemoteError(MBOrErr.takeError());
+    } else if (*MBOrErr) {
+      // Write the remote entry through to the local tier, which adds it to
+      // the link once the stream is destroyed.
+      Expected<std::unique_ptr<CachedFileStream>> StreamOrErr =
+          LocalAddStream(Task);
+      if (!StreamOrErr)
+        return StreamOrErr.takeError();
+      *(*StreamOrErr)->OS << (*MBOrErr)->getBuffer();
+      StreamOrErr->reset();
+      return AddStreamFn();
+    }
+
+    std::string KeyStr = Key.str();
+    return [=](size_t Task) -> Expected<std::unique_ptr<CachedFileStream>> {
+      Expected<std::unique_ptr<CachedFileStream>> StreamOrErr =
+          LocalAddStream(Task);
+      if (!StreamOrErr)
+        return StreamOrErr.takeError();
+      return std::make_unique<UploadingStream>(std::move(*StreamOrErr), Remote,
+                                               KeyStr, ReportRemoteError);
+    };
+  };
+}
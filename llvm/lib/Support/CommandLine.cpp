@@ -166,6 +166,9 @@ public:
   // This collects the different subcommands that have been registered.
   SmallPtrSet<SubCommand *, 4> RegisteredSubCommands;
 
+  // This collects the arguments that set options, in the order they were seen.
+  SmallVector<OptionOccurrence, 0> Occurrences;
+
   CommandLineParser() : ActiveSubCommand(nullptr) {
     registerSubCommand(&*TopLevelSubCommand);
     registerSubCommand(&*AllSubCommands);
@@ -301,6 +304,8 @@ public:
   }
 
   void removeOption(Option *O) {
+    llvm::erase_if(Occurrences,
+                   [O](const OptionOccurrence &OO) { return OO.Opt == O; });
     if (O->Subs.empty())
       removeOption(O, &*TopLevelSubCommand);
     else {
@@ -1406,6 +1411,7 @@ void CommandLineParser::ResetAllOptionOccurrences() {
   // Reset all option values to look like they have never been seen before.
   // Options might be reset twice (they can be reference in both OptionsMap
   // and one of the other members), but that does not harm.
+  Occurrences.clear();
   for (auto *SC : RegisteredSubCommands) {
     for (auto &O : SC->OptionsMap)
       O.second->reset();
@@ -1776,6 +1782,7 @@ bool Option::addOccurrence(unsigned pos, StringRef ArgName, StringRef Value,
   if (!MultiArg)
     NumOccurrences++; // Increment the number of times we have been seen
 
+  GlobalParser->Occurrences.push_back({this, ArgName.str(), Value.str()});
   return handleOccurrence(pos, ArgName, Value);
 }
 
@@ -2703,6 +2710,10 @@ cl::getRegisteredSubcommands() {
   return GlobalParser->getRegisteredSubcommands();
 }
 
+ArrayRef<OptionOccurrence> cl::getOptionOccurrences() {
+  return GlobalParser->Occurrences;
+}
+
 void cl::HideUnrelatedOptions(cl::OptionCategory &Category, SubCommand &Sub) {
   initCommonOptions();
   for (auto &I : Sub.OptionsMap) {
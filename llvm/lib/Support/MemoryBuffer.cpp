@@ -224,6 +224,11 @@ public:
   }
 
   void dontNeedIfMmap() override { MFR.dontNeed(); }
+
+  void dontNeedIfMmap(size_t Offset, size_t Length) override {
+    MFR.dontNeed(MemoryBuffer::getBufferStart() - MFR.const_data() + Offset,
+                 Length);
+  }
 };
 } // namespace
 
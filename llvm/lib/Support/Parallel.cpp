@@ -12,12 +12,15 @@
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
+#include <deque>
 #include <future>
 #include <stack>
 #include <thread>
 #include <vector>
 
 llvm::ThreadPoolStrategy llvm::parallel::strategy;
+llvm::parallel::ExecutorKind llvm::parallel::executorKind =
+    llvm::parallel::ExecutorKind::SharedQueue;
 
 #if LLVM_ENABLE_THREADS
 
@@ -117,16 +120,157 @@ private:
   std::vector<std::thread> Threads;
 };
 
-Executor *Executor::getDefaultExecutor() {
-  // The ManagedStatic enables the ThreadPoolExecutor to be stopped via
+class WorkStealingExecutor;
+
+// The executor and worker index of the current thread, if it is a worker thread
+// of a WorkStealingExecutor.
+static LLVM_THREAD_LOCAL WorkStealingExecutor *CurrentExecutor = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentWorker = 0;
+
+/// An implementation of an Executor that gives every worker thread its own
+/// task deque. Tasks spawned by a worker are pushed to and popped from the back
+/// of its own deque; other tasks are distributed round-robin. A worker whose
+/// deque is empty steals from the front of the other deques. Each deque has its
+/// own lock, so workers only contend when stealing.
+class WorkStealingExecutor : public Executor {
+public:
+  explicit WorkStealingExecutor(ThreadPoolStrategy S = hardware_concurrency())
+      : ThreadCount(S.compute_thread_count()),
+        Queues(new WorkQueue[ThreadCount]) {
+    // Spawn all but one of the threads in another thread as spawning threads
+    // can take a while.
+    Threads.reserve(ThreadCount);
+    Threads.resize(1);
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Threads[0] = std::thread([this, S] {
+      for (unsigned I = 1; I < ThreadCount; ++I) {
+        Threads.emplace_back([=] { work(S, I); });
+        if (Stop)
+          break;
+      }
+      ThreadsCreated.set_value();
+      work(S, 0);
+    });
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      if (Stop)
+        return;
+      Stop = true;
+    }
+    Cond.notify_all();
+    ThreadsCreated.get_future().wait();
+  }
+
+  ~WorkStealingExecutor() override {
+    stop();
+    std::thread::id CurrentThreadId = std::this_thread::get_id();
+    for (std::thread &T : Threads)
+      if (T.get_id() == CurrentThreadId)
+        T.detach();
+      else
+        T.join();
+  }
+
+  struct Creator {
+    static void *call() { return new WorkStealingExecutor(strategy); }
+  };
+  struct Deleter {
+    static void call(void *Ptr) { ((WorkStealingExecutor *)Ptr)->stop(); }
+  };
+
+  void add(std::function<void()> F) override {
+    WorkQueue &Q = Queues[CurrentExecutor == this
+                              ? CurrentWorker
+                              : NextQueue.fetch_add(1) % ThreadCount];
+    {
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      // Count the task before it becomes visible so that Pending never
+      // underestimates the number of queued tasks.
+      ++Pending;
+      Q.Tasks.push_back(std::move(F));
+    }
+    // This pairs with the increment of Sleeping in work(): either the sleeping
+    // worker sees the new task, or we see the worker and wake it up.
+    if (Sleeping != 0) {
+      { std::lock_guard<std::mutex> Lock(Mutex); }
+      Cond.notify_one();
+    }
+  }
+
+private:
+  struct WorkQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+  };
+
+  // Take a task from the back of this worker's deque, or steal one from the
+  // front of another worker's deque.
+  bool pop(unsigned ThreadID, std::function<void()> &Task) {
+    for (unsigned N = 0; N != ThreadCount; ++N) {
+      WorkQueue &Q = Queues[(ThreadID + N) % ThreadCount];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (Q.Tasks.empty())
+        continue;
+      if (N == 0) {
+        Task = std::move(Q.Tasks.back());
+        Q.Tasks.pop_back();
+      } else {
+        Task = std::move(Q.Tasks.front());
+        Q.Tasks.pop_front();
+      }
+      --Pending;
+      return true;
+    }
+    return false;
+  }
+
+  void work(ThreadPoolStrategy S, unsigned ThreadID) {
+    S.apply_thread_strategy(ThreadID);
+    CurrentExecutor = this;
+    CurrentWorker = ThreadID;
+    std::function<void()> Task;
+    while (true) {
+      if (pop(ThreadID, Task)) {
+        Task();
+        Task = nullptr;
+        continue;
+      }
+      std::unique_lock<std::mutex> Lock(Mutex);
+      ++Sleeping;
+      Cond.wait(Lock, [&] { return Stop || Pending != 0; });
+      --Sleeping;
+      if (Stop)
+        break;
+    }
+  }
+
+  const unsigned ThreadCount;
+  std::unique_ptr<WorkQueue[]> Queues;
+  std::atomic<unsigned> NextQueue{0};
+  // The number of tasks in all deques, and the number of workers waiting for
+  // one.
+  std::atomic<size_t> Pending{0};
+  std::atomic<unsigned> Sleeping{0};
+  std::atomic<bool> Stop{false};
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  std::promise<void> ThreadsCreated;
+  std::vector<std::thread> Threads;
+};
+
+template <class ExecutorTy> static Executor *getManagedExecutor() {
+  // The ManagedStatic enables the executor to be stopped via
   // llvm_shutdown() which allows a "clean" fast exit, e.g. via _exit(). This
   // stops the thread pool and waits for any worker thread creation to complete
   // but does not wait for the threads to finish. The wait for worker thread
   // creation to complete is important as it prevents intermittent crashes on
   // Windows due to a race condition between thread creation and process exit.
   //
-  // The ThreadPoolExecutor will only be destroyed when the static unique_ptr to
-  // it is destroyed, i.e. in a normal full exit. The ThreadPoolExecutor
+  // The executor will only be destroyed when the static unique_ptr to
+  // it is destroyed, i.e. in a normal full exit. The executor
   // destructor ensures it has been stopped and waits for worker threads to
   // finish. The wait is important as it prevents intermittent crashes on
   // Windows when the process is doing a full exit.
@@ -136,12 +280,18 @@ Executor *Executor::getDefaultExecutor() {
   //
   // This also prevents intermittent deadlocks on exit with the MinGW runtime.
 
-  static ManagedStatic<ThreadPoolExecutor, ThreadPoolExecutor::Creator,
-                       ThreadPoolExecutor::Deleter>
+  static ManagedStatic<ExecutorTy, typename ExecutorTy::Creator,
+                       typename ExecutorTy::Deleter>
       ManagedExec;
-  static std::unique_ptr<ThreadPoolExecutor> Exec(&(*ManagedExec));
+  static std::unique_ptr<ExecutorTy> Exec(&(*ManagedExec));
   return Exec.get();
 }
+
+Executor *Executor::getDefaultExecutor() {
+  if (executorKind == ExecutorKind::WorkStealing)
+    return getManagedExecutor<WorkStealingExecutor>();
+  return getManagedExecutor<ThreadPoolExecutor>();
+}
 } // namespace
 
 static std::atomic<int> TaskGroupInstances;
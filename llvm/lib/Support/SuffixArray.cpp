@@ -0,0 +1,223 @@
+//===- llvm/Support/SuffixArray.cpp - Implement Suffix Array ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Suffix Array class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/SuffixArray.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Parallel.h"
+#include <algorithm>
+#include <functional>
+
+using namespace llvm;
+
+/// Marks a slot of a suffix array that holds no suffix yet.
+static const unsigned Empty = -1;
+
+namespace {
+
+/// The state of one level of the SA-IS recursion over the string \p S, whose
+/// last element is a sentinel that is smaller than all the others.
+struct SAIS {
+  ArrayRef<unsigned> S;
+  MutableArrayRef<unsigned> SA;
+  /// Whether each suffix is S-type, that is, smaller than the next one.
+  std::vector<bool> IsS;
+  std::vector<unsigned> Buckets;
+
+  SAIS(ArrayRef<unsigned> S, MutableArrayRef<unsigned> SA,
+       unsigned AlphabetSize)
+      : S(S), SA(SA), IsS(S.size()), Buckets(AlphabetSize) {}
+
+  /// Whether the suffix at \p I is a leftmost S-type one.
+  bool isLMS(unsigned I) const { return I > 0 && IsS[I] && !IsS[I - 1]; }
+
+  /// Point the bucket of each character at its start or at its end.
+  void computeBuckets(bool End) {
+    std::fill(Buckets.begin(), Buckets.end(), 0);
+    for (unsigned C : S)
+      ++Buckets[C];
+    unsigned Sum = 0;
+    for (unsigned &Bucket : Buckets) {
+      Sum += Bucket;
+      Bucket = End ? Sum : Sum - Bucket;
+    }
+  }
+
+  /// Sort the L-type suffixes from the sorted LMS ones, then the S-type
+  /// suffixes from the L-type ones.
+  void induce() {
+    computeBuckets(/*End=*/false);
+    for (unsigned I = 0, N = S.size(); I != N; ++I)
+      if (SA[I] != Empty && SA[I] > 0 && !IsS[SA[I] - 1])
+        SA[Buckets[S[SA[I] - 1]]++] = SA[I] - 1;
+    computeBuckets(/*End=*/true);
+    for (unsigned I = S.size(); I-- > 0;)
+      if (SA[I] != Empty && SA[I] > 0 && IsS[SA[I] - 1])
+        SA[--Buckets[S[SA[I] - 1]]] = SA[I] - 1;
+  }
+
+  /// Whether the LMS substrings starting at \p A and \p B are equal.
+  bool equalLMSSubstrings(unsigned A, unsigned B) const {
+    for (unsigned D = 0;; ++D) {
+      if (S[A + D] != S[B + D] || IsS[A + D] != IsS[B + D])
+        return false;
+      if (D > 0 && (isLMS(A + D) || isLMS(B + D)))
+        return true;
+    }
+  }
+
+  void run() {
+    const unsigned N = S.size();
+    IsS[N - 1] = true;
+    for (unsigned I = N - 1; I-- > 0;)
+      IsS[I] = S[I] < S[I + 1] || (S[I] == S[I + 1] && IsS[I + 1]);
+
+    // Sort the LMS substrings by placing the LMS suffixes at the end of their
+    // buckets, then inducing.
+    computeBuckets(/*End=*/true);
+    std::fill(SA.begin(), SA.end(), Empty);
+    for (unsigned I = 1; I != N; ++I)
+      if (isLMS(I))
+        SA[--Buckets[S[I]]] = I;
+    induce();
+
+    // Move the sorted LMS substrings to the front and name them; equal
+    // substrings get the same name. Since no two LMS suffixes are adjacent,
+    // the names fit in the back half of the array, indexed by position / 2.
+    unsigned NumLMS = 0;
+    for (unsigned I = 0; I != N; ++I)
+      if (isLMS(SA[I]))
+        SA[NumLMS++] = SA[I];
+    std::fill(SA.begin() + NumLMS, SA.end(), Empty);
+    unsigned NumNames = 0;
+    unsigned Prev = Empty;
+    for (unsigned I = 0; I != NumLMS; ++I) {
+      unsigned Pos = SA[I];
+      if (Prev == Empty || !equalLMSSubstrings(Pos, Prev)) {
+        ++NumNames;
+        Prev = Pos;
+      }
+      SA[NumLMS + Pos / 2] = NumNames - 1;
+    }
+    for (unsigned I = N, J = N; I-- > NumLMS;)
+      if (SA[I] != Empty)
+        SA[--J] = SA[I];
+
+    // Sort the LMS suffixes, recursing if their substrings are not all
+    // distinct.
+    MutableArrayRef<unsigned> Reduced = SA.take_back(NumLMS);
+    MutableArrayRef<unsigned> ReducedSA = SA.take_front(NumLMS);
+    if (NumNames < NumLMS)
+      SAIS(Reduced, ReducedSA, NumNames).run();
+    else
+      for (unsigned I = 0; I != NumLMS; ++I)
+        ReducedSA[Reduced[I]] = I;
+
+    // Map the reduced suffixes back to the LMS positions, put them at the
+    // end of their buckets in order and induce the rest.
+    for (unsigned I = 1, J = 0; I != N; ++I)
+      if (isLMS(I))
+        Reduced[J++] = I;
+    for (unsigned &Suffix : ReducedSA)
+      Suffix = Reduced[Suffix];
+    std::fill(SA.begin() + NumLMS, SA.end(), Empty);
+    computeBuckets(/*End=*/true);
+    for (unsigned I = NumLMS; I-- > 0;) {
+      unsigned Pos = SA[I];
+      SA[I] = Empty;
+      SA[--Buckets[S[Pos]]] = Pos;
+    }
+    induce();
+  }
+};
+
+} // end anonymous namespace
+
+SuffixArray::SuffixArray(ArrayRef<unsigned> Str) : Str(Str) {
+  const unsigned N = Str.size();
+  if (N == 0)
+    return;
+
+  // Rename the elements to a dense alphabet starting at 1, leaving 0 for the
+  // sentinel SA-IS needs.
+  std::vector<unsigned> Alphabet(Str.begin(), Str.end());
+  parallelSort(Alphabet, std::less<unsigned>());
+  Alphabet.erase(std::unique(Alphabet.begin(), Alphabet.end()),
+                 Alphabet.end());
+  std::vector<unsigned> S(N + 1);
+  parallelForEachN(0, N, [&](size_t I) {
+    S[I] = llvm::lower_bound(Alphabet, Str[I]) - Alphabet.begin() + 1;
+  });
+  S[N] = 0;
+
+  // The sentinel is the smallest suffix; drop it.
+  SA.resize(N + 1);
+  SAIS(S, SA, Alphabet.size() + 1).run();
+  SA.erase(SA.begin());
+
+  // Compute the longest common prefixes in the order of the suffixes of the
+  // string, in which each is at most one shorter than the one before.
+  std::vector<unsigned> Rank(N);
+  for (unsigned I = 0; I != N; ++I)
+    Rank[SA[I]] = I;
+  LCP.resize(N);
+  for (unsigned I = 0, Len = 0; I != N; ++I) {
+    if (Rank[I] == 0) {
+      Len = 0;
+      continue;
+    }
+    unsigned J = SA[Rank[I] - 1];
+    while (I + Len < N && J + Len < N && S[I + Len] == S[J + Len])
+      ++Len;
+    LCP[Rank[I]] = Len;
+    if (Len > 0)
+      --Len;
+  }
+}
+
+std::vector<SuffixArray::RepeatedSubstring>
+SuffixArray::getRepeatedSubstrings(unsigned MinLength) const {
+  std::vector<RepeatedSubstring> Result;
+  const unsigned N = SA.size();
+  if (N == 0)
+    return Result;
+
+  // Walk the intervals of common prefixes bottom-up, with a stack of the
+  // intervals that are still open; these are the internal nodes of the suffix
+  // tree. The suffix at each position is a leaf of the node whose string is
+  // the longest prefix it shares with either of its neighbours.
+  struct Interval {
+    unsigned Length;
+    std::vector<unsigned> Leaves;
+  };
+  std::vector<Interval> Stack;
+  Stack.push_back({0, {}});
+  auto Close = [&](Interval &I) {
+    if (I.Length >= MinLength && I.Leaves.size() >= 2)
+      Result.push_back({I.Length, std::move(I.Leaves)});
+  };
+  for (unsigned I = 1; I <= N; ++I) {
+    unsigned Length = I < N ? LCP[I] : 0;
+    if (Length > Stack.back().Length) {
+      Stack.push_back({Length, {SA[I - 1]}});
+      continue;
+    }
+    Stack.back().Leaves.push_back(SA[I - 1]);
+    while (Length < Stack.back().Length) {
+      Interval Child = std::move(Stack.back());
+      Stack.pop_back();
+      Close(Child);
+      if (Length > Stack.back().Length)
+        Stack.push_back({Length, {}});
+    }
+  }
+  return Result;
+}
@@ -39,14 +39,27 @@ ToolOutputFile::CleanupInstaller::~CleanupInstaller() {
 
 ToolOutputFile::ToolOutputFile(StringRef Filename, std::error_code &EC,
                                sys::fs::OpenFlags Flags)
+    : ToolOutputFile(Filename, EC, Flags, /*Seekable=*/false) {}
+
+ToolOutputFile::ToolOutputFile(StringRef Filename, std::error_code &EC,
+                               sys::fs::OpenFlags Flags, bool Seekable)
     : Installer(Filename) {
   if (isStdout(Filename)) {
     OS = &outs();
     EC = std::error_code();
     return;
   }
-  OSHolder.emplace(Filename, EC, Flags);
-  OS = OSHolder.getPointer();
+  // A raw_fd_stream can't be opened with flags, and fails on files that can't
+  // be seeked, like pipes.
+  if (Seekable && Flags == sys::fs::OF_None) {
+    OSHolder = std::make_unique<raw_fd_stream>(Filename, EC);
+    if (!EC)
+      OS = OSHolder.get();
+  }
+  if (!OS) {
+    OSHolder = std::make_unique<raw_fd_ostream>(Filename, EC, Flags);
+    OS = OSHolder.get();
+  }
   // If open fails, no cleanup is needed.
   if (EC)
     Installer.Keep = true;
@@ -54,6 +67,6 @@ ToolOutputFile::ToolOutputFile(StringRef Filename, std::error_code &EC,
 
 ToolOutputFile::ToolOutputFile(StringRef Filename, int FD)
     : Installer(Filename) {
-  OSHolder.emplace(FD, true);
-  OS = OSHolder.getPointer();
+  OSHolder = std::make_unique<raw_fd_ostream>(FD, true);
+  OS = OSHolder.get();
 }
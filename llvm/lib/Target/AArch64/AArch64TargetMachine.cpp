@@ -24,6 +24,7 @@
 #include "llvm/CodeGen/CFIFixup.h"
 #include "llvm/CodeGen/CSEConfigBase.h"
 #include "llvm/CodeGen/GlobalISel/CSEInfo.h"
+#include "llvm/CodeGen/GlobalISel/FusedInstructionSelect.h"
 #include "llvm/CodeGen/GlobalISel/IRTranslator.h"
 #include "llvm/CodeGen/GlobalISel/InstructionSelect.h"
 #include "llvm/CodeGen/GlobalISel/Legalizer.h"
@@ -146,6 +147,12 @@ static cl::opt<int> EnableGlobalISelAtO(
     cl::desc("Enable GlobalISel at or below an opt level (-1 to disable)"),
     cl::init(0));
 
+static cl::opt<bool> EnableGISelFusedSelect(
+    "aarch64-enable-gisel-fused-select", cl::Hidden,
+    cl::desc("At -O0, assign register banks and select instructions in a "
+             "single GlobalISel pass"),
+    cl::init(false));
+
 static cl::opt<bool>
     EnableSVEIntrinsicOpts("aarch64-enable-sve-intrinsic-opts", cl::Hidden,
                            cl::desc("Enable SVE intrinsic opts"),
@@ -460,6 +467,10 @@ public:
     return getTM<AArch64TargetMachine>();
   }
 
+  bool useGISelFusedSelect() const {
+    return EnableGISelFusedSelect && getOptLevel() == CodeGenOpt::None;
+  }
+
   ScheduleDAGInstrs *
   createMachineScheduler(MachineSchedContext *C) const override {
     const AArch64Subtarget &ST = C->MF->getSubtarget<AArch64Subtarget>();
@@ -668,7 +679,9 @@ void AArch64PassConfig::addPreRegBankSelect() {
 }
 
 bool AArch64PassConfig::addRegBankSelect() {
-  addPass(new RegBankSelect());
+  // The fused selector assigns the register banks itself.
+  if (!useGISelFusedSelect())
+    addPass(new RegBankSelect());
   return false;
 }
 
@@ -677,6 +690,10 @@ void AArch64PassConfig::addPreGlobalInstructionSelect() {
 }
 
 bool AArch64PassConfig::addGlobalInstructionSelect() {
+  if (useGISelFusedSelect()) {
+    addPass(new FusedInstructionSelect());
+    return false;
+  }
   addPass(new InstructionSelect(getOptLevel()));
   if (getOptLevel() != CodeGenOpt::None)
     addPass(createAArch64PostSelectOptimize());
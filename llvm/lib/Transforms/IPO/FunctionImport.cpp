@@ -41,11 +41,13 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
+#include <atomic>
 #include <cassert>
 #include <memory>
 #include <set>
@@ -354,7 +356,7 @@ static void computeImportForFunction(
     FunctionImporter::ImportThresholdsTy &ImportThresholds) {
   computeImportForReferencedGlobals(Summary, Index, DefinedGVSummaries,
                                     Worklist, ImportList, ExportLists);
-  static int ImportCount = 0;
+  static std::atomic<int> ImportCount(0);
   for (auto &Edge : Summary.calls()) {
     ValueInfo VI = Edge.first;
     LLVM_DEBUG(dbgs() << " edge -> " << VI << " Threshold:" << Threshold
@@ -649,72 +651,119 @@ checkVariableImport(const ModuleSummaryIndex &Index,
 }
 #endif
 
+/// Add the values referenced by the values in \p Exports, which are exported
+/// from \p ModulePath, to \p Exports if they are defined in that module.
+static void addReferencedExports(
+    const ModuleSummaryIndex &Index,
+    const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
+    StringRef ModulePath, FunctionImporter::ExportSetTy &Exports) {
+  FunctionImporter::ExportSetTy NewExports;
+  auto DefinedIt = ModuleToDefinedGVSummaries.find(ModulePath);
+  if (DefinedIt == ModuleToDefinedGVSummaries.end()) {
+    // Anything marked exported during the import computation must have been
+    // defined in the exporting module.
+    assert(Exports.empty());
+    return;
+  }
+  const GVSummaryMapTy &DefinedGVSummaries = DefinedIt->second;
+  for (auto &EI : Exports) {
+    // Find the copy defined in the exporting module so that we can mark the
+    // values it references in that specific definition as exported.
+    // Below we will add all references and called values, without regard to
+    // whether they are also defined in this module. We subsequently prune the
+    // list to only include those defined in the exporting module, see comment
+    // there as to why.
+    auto DS = DefinedGVSummaries.find(EI.getGUID());
+    // Anything marked exported during the import computation must have been
+    // defined in the exporting module.
+    assert(DS != DefinedGVSummaries.end());
+    auto *S = DS->getSecond();
+    S = S->getBaseObject();
+    if (auto *GVS = dyn_cast<GlobalVarSummary>(S)) {
+      // Export referenced functions and variables. We don't export/promote
+      // objects referenced by writeonly variable initializer, because
+      // we convert such variables initializers to "zeroinitializer".
+      // See processGlobalForThinLTO.
+      if (!Index.isWriteOnly(GVS))
+        for (const auto &VI : GVS->refs())
+          NewExports.insert(VI);
+    } else {
+      auto *FS = cast<FunctionSummary>(S);
+      for (auto &Edge : FS->calls())
+        NewExports.insert(Edge.first);
+      for (auto &Ref : FS->refs())
+        NewExports.insert(Ref);
+    }
+  }
+  // Prune list computed above to only include values defined in the exporting
+  // module. We do this after the above insertion since we may hit the same
+  // ref/call target multiple times in above loop, and it is more efficient to
+  // avoid a set lookup each time.
+  for (auto EI = NewExports.begin(); EI != NewExports.end();) {
+    if (!DefinedGVSummaries.count(EI->getGUID()))
+      NewExports.erase(EI++);
+    else
+      ++EI;
+  }
+  Exports.insert(NewExports.begin(), NewExports.end());
+}
+
 /// Compute all the import and export for every module using the Index.
 void llvm::ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    ThreadPoolStrategy Parallelism) {
+  // -import-cutoff counts imports across modules, and the per-module debug
+  // output is only readable if the modules are processed one at a time.
+  bool Serial = ImportCutoff >= 0 || PrintImportFailures;
+#ifndef NDEBUG
+  Serial |= DebugFlag;
+#endif
+  ThreadPool Pool(Serial ? hardware_concurrency(1) : Parallelism);
+
   // For each module that has function defined, compute the import/export lists.
+  // The import list of a module is only written by its own task. Exports are
+  // made on behalf of other modules, so each task records them separately and
+  // they are merged in module order once all tasks are done.
+  std::vector<const StringMapEntry<GVSummaryMapTy> *> Modules;
+  std::vector<FunctionImporter::ImportMapTy *> ModuleImportLists;
   for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportList = ImportLists[DefinedGVSummaries.first()];
-    LLVM_DEBUG(dbgs() << "Computing import for Module '"
-                      << DefinedGVSummaries.first() << "'\n");
-    ComputeImportForModule(DefinedGVSummaries.second, Index,
-                           DefinedGVSummaries.first(), ImportList,
-                           &ExportLists);
+    Modules.push_back(&DefinedGVSummaries);
+    ModuleImportLists.push_back(&ImportLists[DefinedGVSummaries.first()]);
+  }
+  std::vector<StringMap<FunctionImporter::ExportSetTy>> ModuleExportLists(
+      Modules.size());
+  for (size_t I = 0, E = Modules.size(); I != E; ++I) {
+    Pool.async([&, I] {
+      LLVM_DEBUG(dbgs() << "Computing import for Module '"
+                        << Modules[I]->first() << "'\n");
+      ComputeImportForModule(Modules[I]->second, Index, Modules[I]->first(),
+                             *ModuleImportLists[I], &ModuleExportLists[I]);
+    });
+  }
+  Pool.wait();
+  for (StringMap<FunctionImporter::ExportSetTy> &Exports : ModuleExportLists) {
+    for (auto &ELI : Exports)
+      ExportLists[ELI.first()].insert(ELI.second.begin(), ELI.second.end());
+    Exports.clear();
   }
 
   // When computing imports we only added the variables and functions being
   // imported to the export list. We also need to mark any references and calls
   // they make as exported as well. We do this here, as it is more efficient
   // since we may import the same values multiple times into different modules
-  // during the import computation.
+  // during the import computation. Each exporting module is handled by its own
+  // task.
   for (auto &ELI : ExportLists) {
-    FunctionImporter::ExportSetTy NewExports;
-    const auto &DefinedGVSummaries =
-        ModuleToDefinedGVSummaries.lookup(ELI.first());
-    for (auto &EI : ELI.second) {
-      // Find the copy defined in the exporting module so that we can mark the
-      // values it references in that specific definition as exported.
-      // Below we will add all references and called values, without regard to
-      // whether they are also defined in this module. We subsequently prune the
-      // list to only include those defined in the exporting module, see comment
-      // there as to why.
-      auto DS = DefinedGVSummaries.find(EI.getGUID());
-      // Anything marked exported during the import computation must have been
-      // defined in the exporting module.
-      assert(DS != DefinedGVSummaries.end());
-      auto *S = DS->getSecond();
-      S = S->getBaseObject();
-      if (auto *GVS = dyn_cast<GlobalVarSummary>(S)) {
-        // Export referenced functions and variables. We don't export/promote
-        // objects referenced by writeonly variable initializer, because
-        // we convert such variables initializers to "zeroinitializer".
-        // See processGlobalForThinLTO.
-        if (!Index.isWriteOnly(GVS))
-          for (const auto &VI : GVS->refs())
-            NewExports.insert(VI);
-      } else {
-        auto *FS = cast<FunctionSummary>(S);
-        for (auto &Edge : FS->calls())
-          NewExports.insert(Edge.first);
-        for (auto &Ref : FS->refs())
-          NewExports.insert(Ref);
-      }
-    }
-    // Prune list computed above to only include values defined in the exporting
-    // module. We do this after the above insertion since we may hit the same
-    // ref/call target multiple times in above loop, and it is more efficient to
-    // avoid a set lookup each time.
-    for (auto EI = NewExports.begin(); EI != NewExports.end();) {
-      if (!DefinedGVSummaries.count(EI->getGUID()))
-        NewExports.erase(EI++);
-      else
-        ++EI;
-    }
-    ELI.second.insert(NewExports.begin(), NewExports.end());
+    StringMapEntry<FunctionImporter::ExportSetTy> *Entry = &ELI;
+    Pool.async([&, Entry] {
+      addReferencedExports(Index, ModuleToDefinedGVSummaries, Entry->first(),
+                           Entry->second);
+    });
   }
+  Pool.wait();
 
   assert(checkVariableImport(Index, ImportLists, ExportLists));
 #ifndef NDEBUG
@@ -0,0 +1,721 @@
+//===- FunctionOptCache.cpp - Cache optimized function bodies -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A cache entry is a bitcode module that holds two copies of a function: its
+// body before optimization, which is unnamed, and its optimized body, which
+// carries the function's name. They come with declarations of the globals the
+// copies refer to, with the definitions of the constants they read, and with
+// the module flags of the original module.
+//
+// The cache key hashes the bitcode of the same module as built from the
+// function before optimization, so functions with equal keys were optimized
+// from identical IR. It also hashes the library functions the target provides
+// and the tuning options given on the command line. On a hit, the globals
+// referred to by the optimized body are resolved by name in the current module,
+// and the struct types of the entry are paired with those of the current module
+// by walking the two unoptimized copies side by side.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionOptCache.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/VCSRevision.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "function-opt-cache"
+
+STATISTIC(NumHits, "Number of functions whose optimized body was reused");
+STATISTIC(NumMisses, "Number of functions optimized and added to the cache");
+STATISTIC(NumUncached, "Number of functions optimized without the cache");
+
+/// Returns false if optimizing \p F may depend on more than its cache key
+/// records, or if its body cannot be moved between modules.
+static bool isCacheable(const Function &F) {
+  // FIXME: Debug info ties every function to its compile unit, which would
+  // make the whole compile unit part of every key.
+  if (F.isDeclaration() || F.getSubprogram() || F.hasPrefixData() ||
+      F.hasPrologueData())
+    return false;
+  return none_of(F, [](const BasicBlock &BB) { return BB.hasAddressTaken(); });
+}
+
+/// Collects the globals \p F refers to, including through the initializers of
+/// the constants it reads. Returns false if one of them cannot be resolved by
+/// name in another module, or if the pipeline may learn more about it than the
+/// cache key records.
+static bool collectGlobals(const Function &F,
+                           SetVector<const GlobalValue *> &Globals) {
+  SmallVector<const Metadata *, 8> MDWorklist;
+  SmallPtrSet<const Metadata *, 8> VisitedMD;
+  auto PushMD = [&](const Metadata *MD) {
+    if (MD && VisitedMD.insert(MD).second)
+      MDWorklist.push_back(MD);
+  };
+  SmallVector<const Constant *, 16> Worklist;
+  SmallPtrSet<const Constant *, 16> Visited;
+  auto Push = [&](const Value *V) {
+    if (auto *MAV = dyn_cast<MetadataAsValue>(V))
+      PushMD(MAV->getMetadata());
+    else if (auto *C = dyn_cast<Constant>(V))
+      if (Visited.insert(C).second)
+        Worklist.push_back(C);
+  };
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  F.getAllMetadata(MDs);
+  for (const auto &MD : MDs)
+    PushMD(MD.second);
+  if (F.hasPersonalityFn())
+    Push(F.getPersonalityFn());
+  for (const Instruction &I : instructions(F)) {
+    for (const Value *Op : I.operands())
+      Push(Op);
+    I.getAllMetadata(MDs);
+    for (const auto &MD : MDs)
+      PushMD(MD.second);
+  }
+
+  while (!MDWorklist.empty()) {
+    const Metadata *MD = MDWorklist.pop_back_val();
+    if (auto *N = dyn_cast<MDNode>(MD))
+      for (const MDOperand &Op : N->operands())
+        PushMD(Op);
+    else if (auto *CAM = dyn_cast<ConstantAsMetadata>(MD))
+      Push(CAM->getValue());
+  }
+
+  while (!Worklist.empty()) {
+    const Constant *C = Worklist.pop_back_val();
+    if (isa<BlockAddress>(C))
+      return false;
+    auto *GV = dyn_cast<GlobalValue>(C);
+    if (!GV) {
+      for (const Value *Op : C->operands())
+        Push(Op);
+      continue;
+    }
+    if (GV == &F)
+      continue;
+    if (!GV->hasName() || !(isa<Function>(GV) || isa<GlobalVariable>(GV)))
+      return false;
+    Globals.insert(GV);
+    if (auto *Var = dyn_cast<GlobalVariable>(GV)) {
+      // Alias analysis tracks the uses of internal variables throughout the
+      // module, which the key does not cover.
+      if (Var->hasLocalLinkage() && !Var->isConstant())
+        return false;
+      if (Var->isConstant() && Var->hasDefinitiveInitializer())
+        Push(Var->getInitializer());
+    }
+  }
+  return true;
+}
+
+/// Returns true if \p MD only holds strings and integers.
+static bool isPlainMetadata(const Metadata *MD) {
+  if (!MD || isa<MDString>(MD))
+    return true;
+  if (auto *CAM = dyn_cast<ConstantAsMetadata>(MD))
+    return isa<ConstantInt>(CAM->getValue());
+  auto *N = dyn_cast<MDNode>(MD);
+  return N && N->isUniqued() &&
+         all_of(N->operands(),
+                [](const MDOperand &Op) { return isPlainMetadata(Op); });
+}
+
+/// Rewrites the types of the type attributes in \p Attrs.
+static AttributeList remapAttributeTypes(LLVMContext &C, AttributeList Attrs,
+                                         ValueMapTypeRemapper &TypeMapper) {
+  for (unsigned I = 0; I < Attrs.getNumAttrSets(); ++I)
+    for (int AttrIdx = Attribute::FirstTypeAttr;
+         AttrIdx <= Attribute::LastTypeAttr; ++AttrIdx) {
+      Attribute::AttrKind TypedAttr = (Attribute::AttrKind)AttrIdx;
+      if (Type *Ty = Attrs.getAttributeAtIndex(I, TypedAttr).getValueAsType())
+        Attrs = Attrs.replaceAttributeTypeAtIndex(C, I, TypedAttr,
+                                                  TypeMapper.remapType(Ty));
+    }
+  return Attrs;
+}
+
+/// Declares a function like \p Fn in \p M.
+static Function *declareFunction(const Function &Fn, FunctionType *Ty,
+                                 AttributeList Attrs, Module &M) {
+  Function *Decl = Function::Create(Ty, GlobalValue::ExternalLinkage,
+                                    Fn.getAddressSpace(), Fn.getName(), &M);
+  Decl->setCallingConv(Fn.getCallingConv());
+  Decl->setAttributes(Attrs);
+  Decl->setVisibility(Fn.getVisibility());
+  Decl->setUnnamedAddr(Fn.getUnnamedAddr());
+  Decl->setDLLStorageClass(Fn.getDLLStorageClass());
+  Decl->setDSOLocal(Fn.isDSOLocal());
+  return Decl;
+}
+
+namespace {
+
+/// Recreates the globals a function refers to in the module that stands in
+/// for the function's surroundings.
+class SnapshotMaterializer final : public ValueMaterializer {
+public:
+  SnapshotMaterializer(Module &Snapshot) : Snapshot(Snapshot) {}
+
+  Value *materialize(Value *V) override;
+
+  /// Maps the initializers of the constants created since the last call.
+  void mapInitializers(ValueToValueMapTy &VMap);
+
+  /// The globals created so far, with their counterparts in the source module.
+  SmallVector<std::pair<const GlobalValue *, GlobalValue *>, 16> Globals;
+  /// Whether variables may be created. Once the key has been computed, only
+  /// function declarations can be added.
+  bool AllowVariables = true;
+  /// Set when a global could not be created.
+  bool Failed = false;
+
+private:
+  Module &Snapshot;
+  SmallVector<std::pair<const GlobalVariable *, GlobalVariable *>, 4> Pending;
+};
+
+/// Maps the struct types of a cache entry to those of the current module.
+class EntryTypeMapper final : public ValueMapTypeRemapper {
+public:
+  /// Pairs the types of \p Entry with those of \p Snapshot. The keys being
+  /// equal, the unoptimized copy in the entry and the function in the
+  /// snapshot only differ in the names of their struct types, so the types
+  /// are paired by where the two use them.
+  bool init(Module &Entry, Module &Snapshot, StringRef Name);
+
+  Type *remapType(Type *SrcTy) override;
+
+private:
+  /// Records that \p From stands for \p To. Returns false if the two differ
+  /// in more than the names of their structs.
+  bool pair(Type *From, Type *To);
+  bool pair(AttributeList From, AttributeList To);
+  bool pair(const Value *From, const Value *To);
+
+  DenseMap<Type *, Type *> MappedTypes;
+  SmallPtrSet<const Constant *, 16> PairedConstants;
+};
+
+} // end anonymous namespace
+
+Value *SnapshotMaterializer::materialize(Value *V) {
+  auto *GV = dyn_cast<GlobalValue>(V);
+  if (!GV)
+    return nullptr;
+
+  GlobalValue *NewGV;
+  if (auto *Fn = dyn_cast<Function>(GV)) {
+    NewGV = declareFunction(*Fn, Fn->getFunctionType(), Fn->getAttributes(),
+                            Snapshot);
+  } else {
+    auto *Var = dyn_cast<GlobalVariable>(GV);
+    if (!Var || !AllowVariables) {
+      Failed = true;
+      return nullptr;
+    }
+    // Only the contents of constants can be relied upon by the pipeline.
+    bool HasContents = Var->isConstant() && Var->hasDefinitiveInitializer();
+    auto *NewVar = new GlobalVariable(
+        Snapshot, Var->getValueType(), Var->isConstant(),
+        HasContents ? Var->getLinkage() : GlobalValue::ExternalLinkage,
+        /*Initializer=*/nullptr, Var->getName(), /*InsertBefore=*/nullptr,
+        Var->getThreadLocalMode(), Var->getAddressSpace());
+    NewVar->copyAttributesFrom(Var);
+    if (HasContents)
+      Pending.emplace_back(Var, NewVar);
+    NewGV = NewVar;
+  }
+  Globals.emplace_back(GV, NewGV);
+  return NewGV;
+}
+
+void SnapshotMaterializer::mapInitializers(ValueToValueMapTy &VMap) {
+  while (!Pending.empty()) {
+    std::pair<const GlobalVariable *, GlobalVariable *> Var =
+        Pending.pop_back_val();
+    Var.second->setInitializer(
+        MapValue(Var.first->getInitializer(), VMap, RF_None, nullptr, this));
+  }
+}
+
+bool EntryTypeMapper::pair(Type *From, Type *To) {
+  auto Inserted = MappedTypes.try_emplace(From, To);
+  if (!Inserted.second)
+    return Inserted.first->second == To;
+  if (From == To)
+    return true;
+  if (From->getTypeID() != To->getTypeID() ||
+      From->getNumContainedTypes() != To->getNumContainedTypes())
+    return false;
+  switch (From->getTypeID()) {
+  case Type::IntegerTyID:
+    return false;
+  case Type::ArrayTyID:
+    if (From->getArrayNumElements() != To->getArrayNumElements())
+      return false;
+    break;
+  case Type::FixedVectorTyID:
+  case Type::ScalableVectorTyID:
+    if (cast<VectorType>(From)->getElementCount() !=
+        cast<VectorType>(To)->getElementCount())
+      return false;
+    break;
+  case Type::PointerTyID:
+    if (From->getPointerAddressSpace() != To->getPointerAddressSpace())
+      return false;
+    break;
+  case Type::FunctionTyID:
+    if (cast<FunctionType>(From)->isVarArg() !=
+        cast<FunctionType>(To)->isVarArg())
+      return false;
+    break;
+  case Type::StructTyID: {
+    auto *FromSTy = cast<StructType>(From), *ToSTy = cast<StructType>(To);
+    if (FromSTy->isLiteral() != ToSTy->isLiteral() ||
+        FromSTy->isPacked() != ToSTy->isPacked() ||
+        FromSTy->isOpaque() != ToSTy->isOpaque())
+      return false;
+    break;
+  }
+  default:
+    // Other types are unique in the context.
+    return false;
+  }
+  // Mapped first, recursive structs end here when they are visited again.
+  for (unsigned I = 0, E = From->getNumContainedTypes(); I != E; ++I)
+    if (!pair(From->getContainedType(I), To->getContainedType(I)))
+      return false;
+  return true;
+}
+
+bool EntryTypeMapper::pair(AttributeList From, AttributeList To) {
+  if (From.getNumAttrSets() != To.getNumAttrSets())
+    return false;
+  for (unsigned I = 0; I < From.getNumAttrSets(); ++I)
+    for (int AttrIdx = Attribute::FirstTypeAttr;
+         AttrIdx <= Attribute::LastTypeAttr; ++AttrIdx) {
+      Attribute::AttrKind TypedAttr = (Attribute::AttrKind)AttrIdx;
+      Type *FromTy = From.getAttributeAtIndex(I, TypedAttr).getValueAsType();
+      Type *ToTy = To.getAttributeAtIndex(I, TypedAttr).getValueAsType();
+      if (!FromTy != !ToTy || (FromTy && !pair(FromTy, ToTy)))
+        return false;
+    }
+  return true;
+}
+
+bool EntryTypeMapper::pair(const Value *From, const Value *To) {
+  if (!pair(From->getType(), To->getType()))
+    return false;
+  // Globals are paired by name, the operands of constants in place.
+  auto *FromC = dyn_cast<Constant>(From);
+  if (!FromC || isa<GlobalValue>(FromC) ||
+      !PairedConstants.insert(FromC).second)
+    return true;
+  auto *ToC = dyn_cast<Constant>(To);
+  if (!ToC || FromC->getValueID() != ToC->getValueID() ||
+      FromC->getNumOperands() != ToC->getNumOperands())
+    return false;
+  if (auto *GEP = dyn_cast<GEPOperator>(FromC))
+    if (!pair(GEP->getSourceElementType(),
+              cast<GEPOperator>(ToC)->getSourceElementType()))
+      return false;
+  for (unsigned I = 0, E = FromC->getNumOperands(); I != E; ++I)
+    if (!pair(FromC->getOperand(I), ToC->getOperand(I)))
+      return false;
+  return true;
+}
+
+bool EntryTypeMapper::init(Module &Entry, Module &Snapshot, StringRef Name) {
+  // The unoptimized copy is the only unnamed definition of the entry.
+  auto It = find_if(Entry, [](const Function &Fn) {
+    return !Fn.hasName() && !Fn.isDeclaration();
+  });
+  Function *To = Snapshot.getFunction(Name);
+  if (It == Entry.end() || !To)
+    return false;
+  Function &From = *It;
+
+  for (GlobalValue &ToGV : Snapshot.global_values()) {
+    if (&ToGV == To)
+      continue;
+    GlobalValue *FromGV = Entry.getNamedValue(ToGV.getName());
+    if (!FromGV || FromGV->getValueID() != ToGV.getValueID() ||
+        !pair(FromGV->getValueType(), ToGV.getValueType()))
+      return false;
+    if (auto *FromFn = dyn_cast<Function>(FromGV))
+      if (!pair(FromFn->getAttributes(), cast<Function>(ToGV).getAttributes()))
+        return false;
+    if (auto *FromVar = dyn_cast<GlobalVariable>(FromGV)) {
+      auto &ToVar = cast<GlobalVariable>(ToGV);
+      if (FromVar->hasInitializer() != ToVar.hasInitializer() ||
+          (FromVar->hasInitializer() &&
+           !pair(FromVar->getInitializer(), ToVar.getInitializer())))
+        return false;
+    }
+  }
+
+  if (!pair(From.getFunctionType(), To->getFunctionType()) ||
+      !pair(From.getAttributes(), To->getAttributes()) ||
+      From.size() != To->size() ||
+      From.hasPersonalityFn() != To->hasPersonalityFn() ||
+      (From.hasPersonalityFn() &&
+       !pair(From.getPersonalityFn(), To->getPersonalityFn())))
+    return false;
+  for (auto BBs : zip(From, *To)) {
+    const BasicBlock &FromBB = std::get<0>(BBs), &ToBB = std::get<1>(BBs);
+    if (FromBB.size() != ToBB.size())
+      return false;
+    for (auto Insts : zip(FromBB, ToBB)) {
+      const Instruction &FromI = std::get<0>(Insts), &ToI = std::get<1>(Insts);
+      if (FromI.getOpcode() != ToI.getOpcode() ||
+          FromI.getNumOperands() != ToI.getNumOperands() ||
+          !pair(FromI.getType(), ToI.getType()))
+        return false;
+      for (unsigned I = 0, E = FromI.getNumOperands(); I != E; ++I)
+        if (!pair(FromI.getOperand(I), ToI.getOperand(I)))
+          return false;
+      if (auto *Alloca = dyn_cast<AllocaInst>(&FromI)) {
+        if (!pair(Alloca->getAllocatedType(),
+                  cast<AllocaInst>(ToI).getAllocatedType()))
+          return false;
+      } else if (auto *GEP = dyn_cast<GetElementPtrInst>(&FromI)) {
+        if (!pair(GEP->getSourceElementType(),
+                  cast<GetElementPtrInst>(ToI).getSourceElementType()))
+          return false;
+      } else if (auto *Call = dyn_cast<CallBase>(&FromI)) {
+        auto &ToCall = cast<CallBase>(ToI);
+        if (!pair(Call->getFunctionType(), ToCall.getFunctionType()) ||
+            !pair(Call->getAttributes(), ToCall.getAttributes()))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+Type *EntryTypeMapper::remapType(Type *SrcTy) {
+  auto It = MappedTypes.find(SrcTy);
+  if (It != MappedTypes.end())
+    return It->second;
+
+  // Identified structs that only the optimized body uses are kept as they are,
+  // everything else is rebuilt from its remapped subtypes.
+  Type *Result = SrcTy;
+  auto *STy = dyn_cast<StructType>(SrcTy);
+  if (!STy || STy->isLiteral()) {
+    SmallVector<Type *, 4> Elements;
+    bool Changed = false;
+    for (Type *Ty : SrcTy->subtypes()) {
+      Elements.push_back(remapType(Ty));
+      Changed |= Elements.back() != Ty;
+    }
+    if (Changed) {
+      switch (SrcTy->getTypeID()) {
+      case Type::ArrayTyID:
+        Result = ArrayType::get(Elements[0], SrcTy->getArrayNumElements());
+        break;
+      case Type::FixedVectorTyID:
+      case Type::ScalableVectorTyID:
+        Result = VectorType::get(Elements[0],
+                                 cast<VectorType>(SrcTy)->getElementCount());
+        break;
+      case Type::PointerTyID:
+        Result = PointerType::get(Elements[0],
+                                  SrcTy->getPointerAddressSpace());
+        break;
+      case Type::FunctionTyID:
+        Result = FunctionType::get(Elements[0], makeArrayRef(Elements).slice(1),
+                                   cast<FunctionType>(SrcTy)->isVarArg());
+        break;
+      case Type::StructTyID:
+        Result = StructType::get(SrcTy->getContext(), Elements,
+                                 STy->isPacked());
+        break;
+      default:
+        llvm_unreachable("unexpected type with subtypes");
+      }
+    }
+  }
+  MappedTypes[SrcTy] = Result;
+  return Result;
+}
+
+/// Writes \p Snapshot as bitcode. Cache entries are never linked, so they do
+/// without a symbol table.
+static void writeSnapshot(const Module &Snapshot,
+                          SmallVectorImpl<char> &Buffer) {
+  BitcodeWriter Writer(Buffer);
+  Writer.writeModule(Snapshot);
+  Writer.writeStrtab();
+}
+
+/// Adds a copy of \p F to \p Snapshot.
+static Function *cloneIntoSnapshot(const Function &F, Module &Snapshot,
+                                   ValueToValueMapTy &VMap,
+                                   SnapshotMaterializer &Materializer) {
+  Function *NewF = Function::Create(F.getFunctionType(), F.getLinkage(),
+                                    F.getAddressSpace(), F.getName(),
+                                    &Snapshot);
+  VMap[&F] = NewF;
+  Function::arg_iterator NewArg = NewF->arg_begin();
+  for (const Argument &Arg : F.args()) {
+    NewArg->setName(Arg.getName());
+    VMap[&Arg] = &*NewArg++;
+  }
+  SmallVector<ReturnInst *, 4> Returns;
+  CloneFunctionInto(NewF, &F, VMap, CloneFunctionChangeType::ClonedModule,
+                    Returns, "", nullptr, nullptr, &Materializer);
+  Materializer.mapInitializers(VMap);
+  return NewF;
+}
+
+/// Replaces the body of \p F by the optimized body held by \p Entry, whose
+/// unoptimized copy of \p F is the one in \p Snapshot. Returns false, leaving
+/// \p F alone, if the entry does not fit into the current module.
+static bool substituteCachedBody(Function &F, Module &Entry,
+                                 Module &Snapshot) {
+  Module &M = *F.getParent();
+  Function *Cached = Entry.getFunction(F.getName());
+  if (!Cached || !isCacheable(*Cached))
+    return false;
+  EntryTypeMapper TypeMapper;
+  if (!TypeMapper.init(Entry, Snapshot, F.getName()) ||
+      TypeMapper.remapType(Cached->getFunctionType()) != F.getFunctionType())
+    return false;
+
+  // Resolve everything before touching F. The key guarantees that the
+  // variables and the functions referred to before optimization are there;
+  // functions the pipeline started to use may have to be declared.
+  SetVector<const GlobalValue *> Globals;
+  if (!collectGlobals(*Cached, Globals))
+    return false;
+  ValueToValueMapTy VMap;
+  SmallVector<const Function *, 4> Missing;
+  for (const GlobalValue *GV : Globals) {
+    Type *Ty = TypeMapper.remapType(GV->getValueType());
+    GlobalValue *Target = M.getNamedValue(GV->getName());
+    if (!Target) {
+      // Intrinsics overloaded on struct types are named after the types
+      // of the entry.
+      auto *Fn = dyn_cast<Function>(GV);
+      if (!Fn || (Fn->isIntrinsic() && Ty != Fn->getValueType()))
+        return false;
+      Missing.push_back(Fn);
+      continue;
+    }
+    if (Target == &F || isa<Function>(Target) != isa<Function>(GV) ||
+        Target->getValueType() != Ty)
+      return false;
+    VMap[GV] = Target;
+  }
+  for (const Function *Fn : Missing) {
+    VMap[Fn] = declareFunction(
+        *Fn, cast<FunctionType>(TypeMapper.remapType(Fn->getFunctionType())),
+        remapAttributeTypes(M.getContext(), Fn->getAttributes(), TypeMapper),
+        M);
+  }
+
+  VMap[Cached] = &F;
+  Function::arg_iterator Arg = F.arg_begin();
+  for (const Argument &CachedArg : Cached->args())
+    VMap[&CachedArg] = &*Arg++;
+  F.dropAllReferences();
+  SmallVector<ReturnInst *, 4> Returns;
+  CloneFunctionInto(&F, Cached, VMap, CloneFunctionChangeType::ClonedModule,
+                    Returns, "", nullptr, &TypeMapper);
+  F.setAttributes(
+      remapAttributeTypes(M.getContext(), F.getAttributes(), TypeMapper));
+  return true;
+}
+
+FunctionOptCachePass::FunctionOptCachePass(FunctionPassManager FPM,
+                                           std::string CacheDir,
+                                           std::string Context)
+    : FPM(std::move(FPM)), CacheDir(std::move(CacheDir)),
+      Context(std::move(Context)) {}
+
+PreservedAnalyses FunctionOptCachePass::run(Function &F,
+                                            FunctionAnalysisManager &AM) {
+  SetVector<const GlobalValue *> Globals;
+  if (!isCacheable(F) || !collectGlobals(F, Globals)) {
+    ++NumUncached;
+    return FPM.run(F, AM);
+  }
+
+  LLVMContext &Ctx = F.getContext();
+  if (!Cache) {
+    Expected<FileCache> CacheOrErr =
+        localCache("FunctionOptCache", "FunctionOpt", CacheDir,
+                   [this](size_t Task, std::unique_ptr<MemoryBuffer> MB) {
+                     Entry = std::move(MB);
+                   });
+    if (!CacheOrErr) {
+      Ctx.emitError(toString(CacheOrErr.takeError()));
+      return FPM.run(F, AM);
+    }
+    Cache = std::move(*CacheOrErr);
+  }
+  if (PipelineText.empty()) {
+    raw_string_ostream OS(PipelineText);
+    FPM.printPipeline(OS, [](StringRef ClassName) { return ClassName; });
+  }
+
+  // Build the stand-in for F's surroundings.
+  Module &M = *F.getParent();
+  Module Snapshot("function-opt-cache", Ctx);
+  Snapshot.setDataLayout(M.getDataLayout());
+  Snapshot.setTargetTriple(M.getTargetTriple());
+  ValueToValueMapTy VMap;
+  SnapshotMaterializer Materializer(Snapshot);
+  Function *Unoptimized = cloneIntoSnapshot(F, Snapshot, VMap, Materializer);
+  if (NamedMDNode *Flags = M.getModuleFlagsMetadata()) {
+    NamedMDNode *NewFlags = Snapshot.getOrInsertModuleFlagsMetadata();
+    for (MDNode *Flag : Flags->operands())
+      if (isPlainMetadata(Flag))
+        NewFlags->addOperand(Flag);
+  }
+  if (Materializer.Failed) {
+    ++NumUncached;
+    return FPM.run(F, AM);
+  }
+
+  // Compute the key from the snapshot and from what the snapshot leaves out.
+  SHA1 Hasher;
+  Hasher.update(LLVM_VERSION_STRING);
+#ifdef LLVM_REVISION
+  Hasher.update(LLVM_REVISION);
+#endif
+  auto AddString = [&](StringRef Str) {
+    Hasher.update(Str);
+    Hasher.update(ArrayRef<uint8_t>{0});
+  };
+  auto AddUnsigned = [&](unsigned I) {
+    uint8_t Data[4];
+    support::endian::write32le(Data, I);
+    Hasher.update(ArrayRef<uint8_t>{Data, 4});
+  };
+  AddString(PipelineText);
+  AddString(Context);
+  AddUnsigned(F.hasComdat());
+  // The library functions the pipeline may recognize or introduce, as
+  // selected by -fno-builtin and -fveclib.
+  const TargetLibraryInfo &TLI = AM.getResult<TargetLibraryAnalysis>(F);
+  for (unsigned I = 0; I != NumLibFuncs; ++I)
+    AddString(TLI.getName(LibFunc(I)));
+  AddUnsigned(TLI.getExtAttrForI32Param(/*Signed=*/true));
+  AddUnsigned(TLI.getExtAttrForI32Param(/*Signed=*/false));
+  AddUnsigned(TLI.getExtAttrForI32Return(/*Signed=*/true));
+  AddUnsigned(TLI.getExtAttrForI32Return(/*Signed=*/false));
+  AddUnsigned(TLI.getIntSize());
+  for (const VecDesc &Desc : TLI.getVectorDescs()) {
+    AddString(Desc.ScalarFnName);
+    AddString(Desc.VectorFnName);
+    AddUnsigned(Desc.VectorizationFactor.getKnownMinValue());
+    AddUnsigned(Desc.VectorizationFactor.isScalable());
+  }
+  // The tuning options given on the command line, directly or through -mllvm.
+  // They are hidden, unlike those that name files.
+  for (const cl::OptionOccurrence &Occurrence : cl::getOptionOccurrences()) {
+    if (Occurrence.Opt->getOptionHiddenFlag() == cl::NotHidden ||
+        Occurrence.Opt->ArgStr == "function-opt-cache-dir")
+      continue;
+    AddString(Occurrence.ArgName);
+    AddString(Occurrence.Value);
+  }
+  AAResults &AA = AM.getResult<AAManager>(F);
+  for (const GlobalValue *GV : Globals) {
+    AddString(GV->getName());
+    AddUnsigned(GV->getLinkage());
+    AddUnsigned(GV->isDeclaration());
+    // This is what alias analysis knows about the callees' bodies.
+    if (auto *Fn = dyn_cast<Function>(GV))
+      AddUnsigned(AA.getModRefBehavior(Fn));
+  }
+  SmallString<0> Bitcode;
+  writeSnapshot(Snapshot, Bitcode);
+  Hasher.update(Bitcode.str());
+  std::string Key = toHex(Hasher.result());
+
+  Expected<AddStreamFn> AddStreamOrErr = (*Cache)(/*Task=*/0, Key);
+  if (!AddStreamOrErr) {
+    Ctx.emitError(toString(AddStreamOrErr.takeError()));
+    return FPM.run(F, AM);
+  }
+  AddStreamFn AddStream = std::move(*AddStreamOrErr);
+  if (!AddStream) {
+    std::unique_ptr<MemoryBuffer> Buffer = std::move(Entry);
+    Expected<std::unique_ptr<Module>> EntryOrErr =
+        parseBitcodeFile(Buffer->getMemBufferRef(), Ctx);
+    if (!EntryOrErr) {
+      consumeError(EntryOrErr.takeError());
+    } else if (substituteCachedBody(F, **EntryOrErr, Snapshot)) {
+      ++NumHits;
+      return PreservedAnalyses::none();
+    }
+    // Leave stale or damaged entries to the cache pruner.
+    LLVM_DEBUG(dbgs() << "function-opt-cache: unusable entry " << Key
+                      << " for " << F.getName() << "\n");
+    ++NumUncached;
+    return FPM.run(F, AM);
+  }
+
+  PreservedAnalyses PA = FPM.run(F, AM);
+  ++NumMisses;
+  if (!isCacheable(F))
+    return PA;
+
+  // Add the optimized copy under F's name. It may only use the variables the
+  // key accounts for.
+  Unoptimized->setName("");
+  Materializer.AllowVariables = false;
+  ValueToValueMapTy OptimizedMap;
+  for (const auto &Global : Materializer.Globals)
+    OptimizedMap[Global.first] = Global.second;
+  cloneIntoSnapshot(F, Snapshot, OptimizedMap, Materializer);
+  if (Materializer.Failed)
+    return PA;
+
+  Expected<std::unique_ptr<CachedFileStream>> StreamOrErr = AddStream(0);
+  if (!StreamOrErr) {
+    Ctx.emitError(toString(StreamOrErr.takeError()));
+    return PA;
+  }
+  Bitcode.clear();
+  writeSnapshot(Snapshot, Bitcode);
+  *(*StreamOrErr)->OS << Bitcode;
+  // Committing the entry hands it back to us.
+  StreamOrErr->reset();
+  Entry.reset();
+  return PA;
+}
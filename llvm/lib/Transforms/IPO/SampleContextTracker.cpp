@@ -13,9 +13,11 @@
 #include "llvm/Transforms/IPO/SampleContextTracker.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
 #include "llvm/ProfileData/SampleProf.h"
 #include <map>
 #include <queue>
@@ -196,11 +198,36 @@ ContextTrieNode *ContextTrieNode::getOrCreateChildContext(
 // Profiler tracker than manages profiles and its associated context
 SampleContextTracker::SampleContextTracker(
     SampleProfileMap &Profiles,
-    const DenseMap<uint64_t, StringRef> *GUIDToFuncNameMap)
+    const DenseMap<uint64_t, StringRef> *GUIDToFuncNameMap, const Module *M)
     : GUIDToFuncNameMap(GUIDToFuncNameMap) {
+  // Queries made while compiling the module always involve one of its
+  // functions: they are rooted at the function being compiled, or they are
+  // for the contexts of a callee, which need to be merged into its base
+  // profile. Only track the contexts that have a frame for a function of the
+  // module, named as in the profile, so that the trie scales with the module
+  // rather than with the profile.
+  StringSet<> ModuleFuncs;
+  if (M) {
+    for (const Function &F : *M) {
+      std::string FGUID;
+      ModuleFuncs.insert(
+          getRepInFormat(F.getName(), FunctionSamples::UseMD5, FGUID));
+      ModuleFuncs.insert(getRepInFormat(FunctionSamples::getCanonicalFnName(F),
+                                        FunctionSamples::UseMD5, FGUID));
+    }
+  }
+  auto IsTracked = [&](const SampleContext &Context) {
+    return !M || any_of(Context.getContextFrames(),
+                        [&](const SampleContextFrame &Frame) {
+                          return ModuleFuncs.count(Frame.FuncName);
+                        });
+  };
+
   for (auto &FuncSample : Profiles) {
     FunctionSamples *FSamples = &FuncSample.second;
     SampleContext Context = FuncSample.first;
+    if (!IsTracked(Context))
+      continue;
     LLVM_DEBUG(dbgs() << "Tracking Context for function: " << Context.toString()
                       << "\n");
     if (!Context.isBaseContext())
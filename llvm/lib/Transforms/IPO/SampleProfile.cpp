@@ -2041,7 +2041,7 @@ bool SampleProfileLoader::doInitialization(Module &M,
   if (Reader->profileIsCS()) {
     // Tracker for profiles under different context
     ContextTracker = std::make_unique<SampleContextTracker>(
-        Reader->getProfiles(), &GUIDToFuncNameMap);
+        Reader->getProfiles(), &GUIDToFuncNameMap, &M);
   }
 
   // Load pseudo probe descriptors for probe-based function samples.
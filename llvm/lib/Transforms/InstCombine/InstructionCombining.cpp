@@ -38,6 +38,7 @@
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -123,6 +124,8 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumUsersNotRequeued,
+          "Number of modified insts whose users were not revisited");
 DEBUG_COUNTER(VisitCounter, "instcombine-visit",
               "Controls which instructions are visited");
 
@@ -157,6 +160,18 @@ static cl::opt<unsigned>
 MaxArraySize("instcombine-maxarray-size", cl::init(1024),
              cl::desc("Maximum array size considered when doing a combine"));
 
+// Experimental worklist orderings, meant for compile-time measurements (see
+// llvm/benchmarks/InstCombine.cpp). Both may change which folds apply.
+static cl::opt<bool> BatchByOpcode(
+    "instcombine-batch-by-opcode", cl::Hidden, cl::init(false),
+    cl::desc("Seed the worklist with the instructions of a function grouped "
+             "by opcode"));
+
+static cl::opt<bool> SkipUnchangedUsers(
+    "instcombine-skip-unchanged-users", cl::Hidden, cl::init(false),
+    cl::desc("Don't revisit the users of an instruction that was modified in "
+             "a way they cannot observe"));
+
 // FIXME: Remove this flag when it is no longer necessary to convert
 // llvm.dbg.declare to avoid inaccurate debug info. Setting this to false
 // increases variable availability at the cost of accuracy. Variables that
@@ -4047,6 +4062,20 @@ static bool TryToSinkInstruction(Instruction *I, BasicBlock *DestBlock,
   return true;
 }
 
+/// Hash what the users of \p I can observe of it: what it computes and from
+/// which operands. Metadata, attributes and alignment are left out.
+static hash_code hashUserVisibleState(const Instruction &I) {
+  hash_code Hash = hash_combine(
+      I.getOpcode(), I.getType(), I.getRawSubclassOptionalData(),
+      hash_combine_range(I.value_op_begin(), I.value_op_end()));
+  if (auto *Cmp = dyn_cast<CmpInst>(&I))
+    Hash = hash_combine(Hash, Cmp->getPredicate());
+  else if (auto *SVI = dyn_cast<ShuffleVectorInst>(&I))
+    Hash = hash_combine(Hash, hash_combine_range(SVI->getShuffleMask().begin(),
+                                                 SVI->getShuffleMask().end()));
+  return Hash;
+}
+
 bool InstCombinerImpl::run() {
   while (!Worklist.isEmpty()) {
     // Walk deferred instructions in reverse order, and push them to the
@@ -4193,6 +4222,8 @@ bool InstCombinerImpl::run() {
     LLVM_DEBUG(raw_string_ostream SS(OrigI); I->print(SS); OrigI = SS.str(););
     LLVM_DEBUG(dbgs() << "IC: Visiting: " << OrigI << '\n');
 
+    hash_code OrigHash =
+        SkipUnchangedUsers ? hashUserVisibleState(*I) : hash_code(0);
     if (Instruction *Result = visit(*I)) {
       ++NumCombined;
       // Should we replace the old instruction with a new one?
@@ -4237,7 +4268,10 @@ bool InstCombinerImpl::run() {
         if (isInstructionTriviallyDead(I, &TLI)) {
           eraseInstFromFunction(*I);
         } else {
-          Worklist.pushUsersToWorkList(*I);
+          if (SkipUnchangedUsers && hashUserVisibleState(*I) == OrigHash)
+            ++NumUsersNotRequeued;
+          else
+            Worklist.pushUsersToWorkList(*I);
           Worklist.push(I);
         }
       }
@@ -4410,6 +4444,7 @@ static bool prepareICWorklistFromFunction(Function &F, const DataLayout &DL,
   // of instructions to the worklist after doing a transformation, thus avoiding
   // some N^2 behavior in pathological cases.
   ICWorklist.reserve(InstrsForInstructionWorklist.size());
+  SmallVector<Instruction *, 128> Live;
   for (Instruction *Inst : reverse(InstrsForInstructionWorklist)) {
     // DCE instruction if trivially dead. As we iterate in reverse program
     // order here, we will clean up whole chains of dead instructions.
@@ -4423,7 +4458,20 @@ static bool prepareICWorklistFromFunction(Function &F, const DataLayout &DL,
       continue;
     }
 
-    ICWorklist.push(Inst);
+    if (BatchByOpcode)
+      Live.push_back(Inst);
+    else
+      ICWorklist.push(Inst);
+  }
+
+  // Keep program order within each opcode, and visit the groups in opcode
+  // order, so that the same visitor runs over a contiguous set.
+  if (BatchByOpcode) {
+    llvm::stable_sort(Live, [](Instruction *A, Instruction *B) {
+      return A->getOpcode() > B->getOpcode();
+    });
+    for (Instruction *Inst : Live)
+      ICWorklist.push(Inst);
   }
 
   return MadeIRChange;
@@ -4436,6 +4484,9 @@ static bool combineInstructionsOverFunction(
     ProfileSummaryInfo *PSI, unsigned MaxIterations, LoopInfo *LI) {
   auto &DL = F.getParent()->getDataLayout();
   MaxIterations = std::min(MaxIterations, LimitMaxIterations.getValue());
+  // Functions over their compile-time budget only get a single iteration.
+  if (F.hasFnAttribute("compile-time-budget-exceeded"))
+    MaxIterations = 1;
 
   /// Builder - This is an IRBuilder that automatically inserts new
   /// instructions into the worklist when they are created.
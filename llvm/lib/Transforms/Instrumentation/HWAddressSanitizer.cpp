@@ -214,6 +214,12 @@ static cl::opt<bool> ClUsePageAliases("hwasan-experimental-use-page-aliases",
                                       cl::desc("Use page aliasing in HWASan"),
                                       cl::Hidden, cl::init(false));
 
+static cl::opt<bool> ClSampleChecks(
+    "hwasan-sample-checks",
+    cl::desc("Only check the memory accesses of the calls sampled by the "
+             "thread's __hwasan_sample_countdown"),
+    cl::Hidden, cl::init(false));
+
 namespace {
 
 bool shouldUsePageAliases(const Triple &TargetTriple) {
@@ -306,6 +312,7 @@ public:
   Value *getUARTag(IRBuilder<> &IRB, Value *StackTag);
 
   Value *getHwasanThreadSlotPtr(IRBuilder<> &IRB, Type *Ty);
+  Value *emitSampleGate(Function &F);
   Value *applyTagMask(IRBuilder<> &IRB, Value *OldTag);
   unsigned retagMask(unsigned AllocaNo);
 
@@ -364,6 +371,7 @@ private:
   bool InstrumentStack;
   bool DetectUseAfterScope;
   bool UsePageAliases;
+  bool SampleChecks;
 
   bool HasMatchAllTag = false;
   uint8_t MatchAllTag = 0;
@@ -378,12 +386,15 @@ private:
 
   FunctionCallee HwasanTagMemoryFunc;
   FunctionCallee HwasanGenerateTagFunc;
+  FunctionCallee HwasanSampleRefillFunc;
 
   Constant *ShadowGlobal;
 
   Value *ShadowBase = nullptr;
   Value *StackBaseTag = nullptr;
   GlobalValue *ThreadPtrGlobal = nullptr;
+  GlobalVariable *SampleCountdownGlobal = nullptr;
+  Value *SampleGate = nullptr;
 };
 
 } // end anonymous namespace
@@ -609,6 +620,19 @@ void HWAddressSanitizer::initializeModule() {
     });
     ThreadPtrGlobal = cast<GlobalVariable>(C);
   }
+
+  // Like __hwasan_tls, the countdown is an ELF TLS variable of the runtime,
+  // which is not used on Android or in the kernel.
+  SampleChecks = ClSampleChecks && !CompileKernel && !TargetTriple.isAndroid();
+  if (SampleChecks) {
+    const char *Name = "__hwasan_sample_countdown";
+    Constant *C = M.getOrInsertGlobal(Name, Int32Ty, [&] {
+      return new GlobalVariable(M, Int32Ty, /*isConstant=*/false,
+                                GlobalValue::ExternalLinkage, nullptr, Name,
+                                nullptr, GlobalVariable::InitialExecTLSModel);
+    });
+    SampleCountdownGlobal = cast<GlobalVariable>(C);
+  }
 }
 
 void HWAddressSanitizer::initializeCallbacks(Module &M) {
@@ -635,6 +659,8 @@ void HWAddressSanitizer::initializeCallbacks(Module &M) {
       "__hwasan_tag_memory", IRB.getVoidTy(), Int8PtrTy, Int8Ty, IntptrTy);
   HwasanGenerateTagFunc =
       M.getOrInsertFunction("__hwasan_generate_tag", Int8Ty);
+  HwasanSampleRefillFunc =
+      M.getOrInsertFunction("__hwasan_sample_refill", IRB.getVoidTy());
 
   ShadowGlobal = M.getOrInsertGlobal("__hwasan_shadow",
                                      ArrayType::get(IRB.getInt8Ty(), 0));
@@ -935,7 +961,13 @@ bool HWAddressSanitizer::instrumentMemAccess(InterestingMemoryOperand &O) {
   if (O.MaybeMask)
     return false; // FIXME
 
-  IRBuilder<> IRB(O.getInsn());
+  Instruction *InsertBefore = O.getInsn();
+  if (SampleGate)
+    InsertBefore = SplitBlockAndInsertIfThen(
+        SampleGate, InsertBefore, false,
+        MDBuilder(*C).createBranchWeights(1, 100000));
+
+  IRBuilder<> IRB(InsertBefore);
   if (isPowerOf2_64(O.TypeSize) &&
       (O.TypeSize / 8 <= (1ULL << (kNumberOfAccessSizes - 1))) &&
       (!O.Alignment || *O.Alignment >= (1ULL << Mapping.Scale) ||
@@ -945,9 +977,11 @@ bool HWAddressSanitizer::instrumentMemAccess(InterestingMemoryOperand &O) {
       IRB.CreateCall(HwasanMemoryAccessCallback[O.IsWrite][AccessSizeIndex],
                      IRB.CreatePointerCast(Addr, IntptrTy));
     } else if (OutlinedChecks) {
-      instrumentMemAccessOutline(Addr, O.IsWrite, AccessSizeIndex, O.getInsn());
+      instrumentMemAccessOutline(Addr, O.IsWrite, AccessSizeIndex,
+                                 InsertBefore);
     } else {
-      instrumentMemAccessInline(Addr, O.IsWrite, AccessSizeIndex, O.getInsn());
+      instrumentMemAccessInline(Addr, O.IsWrite, AccessSizeIndex,
+                                InsertBefore);
     }
   } else {
     IRB.CreateCall(HwasanMemoryAccessCallbackSized[O.IsWrite],
@@ -1124,6 +1158,30 @@ Value *HWAddressSanitizer::getHwasanThreadSlotPtr(IRBuilder<> &IRB, Type *Ty) {
   return nullptr;
 }
 
+Value *HWAddressSanitizer::emitSampleGate(Function &F) {
+  // Keep the static allocas at the start of the entry block.
+  BasicBlock::iterator InsertPt = F.getEntryBlock().getFirstInsertionPt();
+  while (isa<AllocaInst>(*InsertPt))
+    ++InsertPt;
+
+  // A positive countdown is the number of calls to skip, and a negative one the
+  // number of calls to check, before the next sample. The countdown steps
+  // toward 0, and the call that finds it at 0 is checked and has the runtime
+  // refill it.
+  IRBuilder<> IRB(&*InsertPt);
+  Value *Countdown = IRB.CreateLoad(Int32Ty, SampleCountdownGlobal);
+  Value *Sampled = IRB.CreateICmpSLT(Countdown, ConstantInt::get(Int32Ty, 1));
+  Value *Step = IRB.CreateSelect(Sampled, ConstantInt::get(Int32Ty, 1),
+                                 ConstantInt::getSigned(Int32Ty, -1));
+  IRB.CreateStore(IRB.CreateAdd(Countdown, Step), SampleCountdownGlobal);
+  Value *Refill = IRB.CreateICmpEQ(Countdown, ConstantInt::get(Int32Ty, 0));
+  Instruction *RefillTerm =
+      SplitBlockAndInsertIfThen(Refill, &*InsertPt, false,
+                                MDBuilder(*C).createBranchWeights(1, 100000));
+  IRBuilder<>(RefillTerm).CreateCall(HwasanSampleRefillFunc);
+  return Sampled;
+}
+
 void HWAddressSanitizer::emitPrologue(IRBuilder<> &IRB, bool WithFrameRecord) {
   if (!Mapping.InTls)
     ShadowBase = getShadowNonTls(IRB);
@@ -1435,6 +1493,11 @@ bool HWAddressSanitizer::sanitizeFunction(
     }
   }
 
+  // Only the checks are sampled: the stack is always tagged, as the sampled
+  // calls of other functions may access it.
+  if (SampleChecks && !OperandsToInstrument.empty())
+    SampleGate = emitSampleGate(F);
+
   for (auto &Operand : OperandsToInstrument)
     instrumentMemAccess(Operand);
 
@@ -1445,6 +1508,7 @@ bool HWAddressSanitizer::sanitizeFunction(
 
   ShadowBase = nullptr;
   StackBaseTag = nullptr;
+  SampleGate = nullptr;
 
   return true;
 }
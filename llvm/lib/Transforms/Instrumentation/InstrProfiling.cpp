@@ -34,9 +34,11 @@
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/InitializePasses.h"
@@ -47,6 +49,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/ModuleUtils.h"
 #include "llvm/Transforms/Utils/SSAUpdater.h"
 #include <algorithm>
@@ -77,6 +80,19 @@ cl::opt<bool>
                              cl::desc("Enable relocating counters at runtime."),
                              cl::init(false));
 
+cl::opt<bool> SampleGate(
+    "instrprof-sample-gate",
+    cl::desc("Only increment the profile counters in threads whose sample "
+             "gate is set with __llvm_profile_set_sample_gate()"),
+    cl::init(false));
+
+cl::opt<bool> PerThreadCounters(
+    "instrprof-per-thread-counters",
+    cl::desc("Increment a copy of the profile counters that belongs to the "
+             "running thread, which the runtime sums when writing the "
+             "profile"),
+    cl::init(false));
+
 cl::opt<bool> ValueProfileStaticAlloc(
     "vp-static-alloc",
     cl::desc("Do static counter allocation for value profiler"),
@@ -446,6 +462,12 @@ llvm::createInstrProfilingLegacyPass(const InstrProfOptions &Options,
 bool InstrProfiling::lowerIntrinsics(Function *F) {
   bool MadeChange = false;
   PromotionCandidates.clear();
+  FunctionSampleGate = nullptr;
+  FunctionThreadCounterBias = nullptr;
+  if (PerThreadCounters &&
+      any_of(instructions(*F),
+             [](Instruction &I) { return isa<InstrProfIncrementInst>(I); }))
+    FunctionThreadCounterBias = emitThreadCounterBias(F);
   for (BasicBlock &BB : *F) {
     for (Instruction &Instr : llvm::make_early_inc_range(BB)) {
       if (auto *IPIS = dyn_cast<InstrProfIncrementInstStep>(&Instr)) {
@@ -698,16 +720,29 @@ Value *InstrProfiling::getCounterAddress(InstrProfInstBase *I) {
   auto *Addr = Builder.CreateConstInBoundsGEP2_32(
       Counters->getValueType(), Counters, 0, I->getIndex()->getZExtValue());
 
+  Type *Int64Ty = Type::getInt64Ty(M->getContext());
+  // Increments go to the running thread's copy of the counters. That copy is
+  // summed into the counter section itself, which the relocation bias, if
+  // any, only needs to apply to when it is written. The address is computed
+  // next to the bias, so that it dominates the counter updates that promotion
+  // sinks out of loops.
+  if (FunctionThreadCounterBias && isa<InstrProfIncrementInst>(I)) {
+    auto *BiasPhi = cast<PHINode>(FunctionThreadCounterBias);
+    IRBuilder<> BiasBuilder(BiasPhi->getParent()->getFirstNonPHI());
+    auto *Add = BiasBuilder.CreateAdd(BiasBuilder.CreatePtrToInt(Addr, Int64Ty),
+                                      BiasPhi);
+    return BiasBuilder.CreateIntToPtr(Add, Addr->getType());
+  }
+
   if (!isRuntimeCounterRelocationEnabled())
     return Addr;
 
-  Type *Int64Ty = Type::getInt64Ty(M->getContext());
   Function *Fn = I->getParent()->getParent();
   Instruction &EntryI = Fn->getEntryBlock().front();
+  auto *Bias = M->getGlobalVariable(getInstrProfCounterBiasVarName());
   LoadInst *LI = dyn_cast<LoadInst>(&EntryI);
-  if (!LI) {
+  if (!LI || LI->getPointerOperand() != Bias) {
     IRBuilder<> EntryBuilder(&EntryI);
-    auto *Bias = M->getGlobalVariable(getInstrProfCounterBiasVarName());
     if (!Bias) {
       // Compiler must define this variable when runtime counter relocation
       // is being used. Runtime has a weak external reference that is used
@@ -729,6 +764,71 @@ Value *InstrProfiling::getCounterAddress(InstrProfInstBase *I) {
   return Builder.CreateIntToPtr(Add, Addr->getType());
 }
 
+Value *InstrProfiling::emitThreadCounterBias(Function *F) {
+  LLVMContext &Ctx = M->getContext();
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  auto *Bias = M->getGlobalVariable(getInstrProfThreadCounterBiasVarName());
+  if (!Bias) {
+    // The runtime defines the bias, and sets it once it has allocated the
+    // counters of the thread.
+    Bias = new GlobalVariable(*M, Int64Ty, false, GlobalValue::ExternalLinkage,
+                              nullptr, getInstrProfThreadCounterBiasVarName(),
+                              nullptr, GlobalVariable::GeneralDynamicTLSModel);
+    Bias->setVisibility(GlobalVariable::HiddenVisibility);
+  }
+
+  // Read the bias at the start of the function, after the static allocas. A
+  // thread that has no counters yet asks the runtime for them.
+  BasicBlock &Entry = F->getEntryBlock();
+  BasicBlock::iterator InsertPt = Entry.getFirstInsertionPt();
+  while (isa<AllocaInst>(InsertPt))
+    ++InsertPt;
+  IRBuilder<> Builder(&Entry, InsertPt);
+  auto *Load = Builder.CreateLoad(Int64Ty, Bias, "pgo.thread.bias");
+  auto *IsNull = Builder.CreateICmpEQ(Load, ConstantInt::get(Int64Ty, 0));
+  Instruction *Alloc = SplitBlockAndInsertIfThen(
+      IsNull, &*InsertPt, /*Unreachable=*/false,
+      MDBuilder(Ctx).createBranchWeights(1, (1U << 20) - 1));
+  Builder.SetInsertPoint(Alloc);
+  FunctionCallee AllocFn = M->getOrInsertFunction(
+      getInstrProfThreadCountersAllocFuncName(), Int64Ty);
+  auto *NewBias = Builder.CreateCall(AllocFn);
+
+  Builder.SetInsertPoint(&*InsertPt);
+  PHINode *Phi = Builder.CreatePHI(Int64Ty, 2, "pgo.thread.bias");
+  Phi->addIncoming(Load, Load->getParent());
+  Phi->addIncoming(NewBias, Alloc->getParent());
+  return Phi;
+}
+
+Value *InstrProfiling::getSampleGate(Function *F) {
+  if (FunctionSampleGate)
+    return FunctionSampleGate;
+
+  Type *Int8Ty = Type::getInt8Ty(M->getContext());
+  auto *Gate = M->getGlobalVariable(getInstrProfSampleGateVarName());
+  if (!Gate) {
+    // The runtime defines the gate, for __llvm_profile_set_sample_gate() to
+    // set it.
+    Gate = new GlobalVariable(*M, Int8Ty, false, GlobalValue::ExternalLinkage,
+                              nullptr, getInstrProfSampleGateVarName(),
+                              nullptr, GlobalVariable::GeneralDynamicTLSModel);
+    Gate->setVisibility(GlobalVariable::HiddenVisibility);
+  }
+
+  // Read the gate once per function. The counter bias is loaded by the first
+  // instruction of the entry block, which getCounterAddress() relies on, so
+  // keep it there.
+  BasicBlock &Entry = F->getEntryBlock();
+  BasicBlock::iterator InsertPt = Entry.getFirstInsertionPt();
+  if (isRuntimeCounterRelocationEnabled())
+    InsertPt = std::next(Entry.begin());
+  IRBuilder<> EntryBuilder(&Entry, InsertPt);
+  auto *Load = EntryBuilder.CreateLoad(Int8Ty, Gate, "pgogate");
+  FunctionSampleGate = EntryBuilder.CreateICmpNE(Load, EntryBuilder.getInt8(0));
+  return FunctionSampleGate;
+}
+
 void InstrProfiling::lowerCover(InstrProfCoverInst *CoverInstruction) {
   auto *Addr = getCounterAddress(CoverInstruction);
   IRBuilder<> Builder(CoverInstruction);
@@ -741,14 +841,19 @@ void InstrProfiling::lowerIncrement(InstrProfIncrementInst *Inc) {
   auto *Addr = getCounterAddress(Inc);
 
   IRBuilder<> Builder(Inc);
+  Value *IncStep = Inc->getStep();
+  // Add nothing while the thread's sample gate is off. This keeps the update
+  // free of branches, so that it can still be promoted out of loops.
+  if (SampleGate)
+    IncStep = Builder.CreateSelect(getSampleGate(Inc->getFunction()), IncStep,
+                                   Constant::getNullValue(IncStep->getType()));
   if (Options.Atomic || AtomicCounterUpdateAll ||
       (Inc->getIndex()->isZeroValue() && AtomicFirstCounter)) {
-    Builder.CreateAtomicRMW(AtomicRMWInst::Add, Addr, Inc->getStep(),
-                            MaybeAlign(), AtomicOrdering::Monotonic);
+    Builder.CreateAtomicRMW(AtomicRMWInst::Add, Addr, IncStep, MaybeAlign(),
+                            AtomicOrdering::Monotonic);
   } else {
-    Value *IncStep = Inc->getStep();
     Value *Load = Builder.CreateLoad(IncStep->getType(), Addr, "pgocount");
-    auto *Count = Builder.CreateAdd(Load, Inc->getStep());
+    auto *Count = Builder.CreateAdd(Load, IncStep);
     auto *Store = Builder.CreateStore(Count, Addr);
     if (isCounterPromotionEnabled())
       PromotionCandidates.emplace_back(cast<Instruction>(Load), Store);
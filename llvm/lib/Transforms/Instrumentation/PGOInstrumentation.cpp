@@ -65,6 +65,8 @@
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/EHPersonalities.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/MemoryBuiltins.h"
+#include "llvm/Analysis/MemoryProfileInfo.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
@@ -74,6 +76,7 @@
 #include "llvm/IR/Comdat.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
@@ -102,9 +105,11 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DOTGraphTraits.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GraphWriter.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Instrumentation.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
@@ -113,8 +118,10 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <numeric>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -148,6 +155,12 @@ STATISTIC(NumOfCSPGOFunc,
           "Number of functions having valid profile counts in CSPGO.");
 STATISTIC(NumOfCSPGOMismatch,
           "Number of functions having mismatch profile in CSPGO.");
+STATISTIC(NumOfMemProfFunc, "Number of functions having valid memprof.");
+STATISTIC(NumOfMemProfMissing, "Number of functions without memprof.");
+STATISTIC(NumOfMemProfAllocs,
+          "Number of allocations annotated with a memprof context.");
+STATISTIC(NumOfMemProfCallSites,
+          "Number of calls annotated with a memprof callsite.");
 STATISTIC(NumOfCSPGOMissing, "Number of functions without profile in CSPGO.");
 
 // Command line option to specify the file to read profile from. This is
@@ -299,6 +312,10 @@ extern cl::opt<std::string> ViewBlockFreqFuncName;
 extern cl::opt<bool> DebugInfoCorrelate;
 } // namespace llvm
 
+static cl::opt<bool>
+    PGOMatchMemProf("pgo-match-memprof", cl::init(true), cl::Hidden,
+                    cl::desc("Match and annotate memprof profiles."));
+
 static cl::opt<bool>
     PGOOldCFGHashing("pgo-instr-old-cfg-hashing", cl::init(false), cl::Hidden,
                      cl::desc("Use the old CFG function hashing"));
@@ -1722,6 +1739,201 @@ static void verifyFuncBFI(PGOUseFunc &Func, LoopInfo &LI,
     });
 }
 
+// Compute the stack id of a frame from the function, line offset and column
+// that identify it in the memprof profile, so that the call stacks in the
+// profile can be compared to the (inlined) debug locations of the calls.
+static uint64_t computeStackId(GlobalValue::GUID Function, uint32_t LineOffset,
+                               uint32_t Column) {
+  uint8_t Data[16];
+  support::endian::write64le(Data, Function);
+  support::endian::write32le(Data + 8, LineOffset);
+  support::endian::write32le(Data + 12, Column);
+  return MD5::hash(Data).low();
+}
+
+static uint64_t computeStackId(const memprof::Frame &Frame) {
+  return computeStackId(Frame.Function, Frame.LineOffset, Frame.Column);
+}
+
+// The memprof profile identifies functions by their symbolized linkage name.
+static GlobalValue::GUID getSubprogramGUID(const DISubprogram *SP) {
+  StringRef Name = SP->getLinkageName();
+  if (Name.empty())
+    Name = SP->getName();
+  return memprof::IndexedMemProfRecord::getGUID(Name);
+}
+
+static void addCallStack(memprof::CallStackTrie &AllocTrie,
+                         const memprof::AllocationInfo *AllocInfo) {
+  SmallVector<uint64_t> StackIds;
+  for (const auto &StackFrame : AllocInfo->CallStack)
+    StackIds.push_back(computeStackId(StackFrame));
+  auto AllocType = memprof::getAllocType(AllocInfo->Info.getMaxAccessCount(),
+                                         AllocInfo->Info.getMinSize(),
+                                         AllocInfo->Info.getMinLifetime());
+  AllocTrie.addCallStack(AllocType, StackIds);
+}
+
+// Return true if the frames of \p ProfileCallStack, starting at
+// \p StartIndex, match all the stack ids of \p InlinedCallStack, computed from
+// the debug location of a call.
+static bool
+stackFrameIncludesInlinedCallStack(ArrayRef<memprof::Frame> ProfileCallStack,
+                                   ArrayRef<uint64_t> InlinedCallStack,
+                                   unsigned StartIndex = 0) {
+  auto StackFrame = ProfileCallStack.begin() + StartIndex;
+  auto InlCallStackIter = InlinedCallStack.begin();
+  for (; StackFrame != ProfileCallStack.end() &&
+         InlCallStackIter != InlinedCallStack.end();
+       ++StackFrame, ++InlCallStackIter)
+    if (computeStackId(*StackFrame) != *InlCallStackIter)
+      return false;
+  return InlCallStackIter == InlinedCallStack.end();
+}
+
+// Match the memprof record of \p F to its calls: annotate the allocation calls
+// with their profiled contexts and allocation types, and the other calls on
+// profiled contexts with their stack ids, for context disambiguation.
+static void readMemprof(Module &M, Function &F,
+                        IndexedInstrProfReader *MemProfReader,
+                        const TargetLibraryInfo &TLI) {
+  // The profile can only be matched through the debug locations it was
+  // symbolized from.
+  const DISubprogram *SP = F.getSubprogram();
+  if (!SP)
+    return;
+
+  auto &Ctx = M.getContext();
+  Expected<memprof::MemProfRecord> MemProfResult =
+      MemProfReader->getMemProfRecord(getSubprogramGUID(SP));
+  if (Error E = MemProfResult.takeError()) {
+    handleAllErrors(std::move(E), [&](const InstrProfError &IPE) {
+      auto Err = IPE.get();
+      bool SkipWarning = false;
+      LLVM_DEBUG(dbgs() << "Error in reading memprof profile for Func "
+                        << F.getName() << ": ");
+      if (Err == instrprof_error::unknown_function) {
+        NumOfMemProfMissing++;
+        SkipWarning = !PGOWarnMissing;
+        LLVM_DEBUG(dbgs() << "unknown function");
+      } else if (Err == instrprof_error::hash_mismatch) {
+        SkipWarning =
+            NoPGOWarnMismatch ||
+            (NoPGOWarnMismatchComdat &&
+             (F.hasComdat() ||
+              F.getLinkage() == GlobalValue::AvailableExternallyLinkage));
+        LLVM_DEBUG(dbgs() << "hash mismatch (skip=" << SkipWarning << ")");
+      }
+      LLVM_DEBUG(dbgs() << "\n");
+
+      if (SkipWarning)
+        return;
+
+      std::string Msg = IPE.message() + std::string(" ") + F.getName().str();
+      Ctx.diagnose(
+          DiagnosticInfoPGOProfile(M.getName().data(), Msg, DS_Warning));
+    });
+    return;
+  }
+  NumOfMemProfFunc++;
+
+  // Map each allocation call's stack id to the allocation contexts that start
+  // with it, and each stack id of a call in this function to the profiled
+  // call stacks that go through it, along with the index of its frame.
+  std::map<uint64_t, std::set<const memprof::AllocationInfo *>>
+      LocHashToAllocInfo;
+  std::map<uint64_t, std::set<std::pair<const SmallVector<memprof::Frame> *,
+                                        unsigned>>>
+      LocHashToCallSites;
+  const memprof::MemProfRecord &MemProfRec = MemProfResult.get();
+  for (const auto &AI : MemProfRec.AllocSites) {
+    uint64_t StackId = computeStackId(AI.CallStack[0]);
+    LocHashToAllocInfo[StackId].insert(&AI);
+  }
+  GlobalValue::GUID FuncGUID = getSubprogramGUID(SP);
+  for (const auto &CS : MemProfRec.CallSites) {
+    // The frames of this function in the call stack are the ones attached
+    // to its calls: the leaf frames above it belong to its callees.
+    unsigned Idx = 0;
+    for (const auto &StackFrame : CS) {
+      if (StackFrame.Function == FuncGUID) {
+        LocHashToCallSites[computeStackId(StackFrame)].insert(
+            std::make_pair(&CS, Idx));
+        break;
+      }
+      Idx++;
+    }
+  }
+
+  // Compute the stack ids of the inlined call stack of a call, from the call
+  // up to this function.
+  auto GetInlinedCallStack = [](const DILocation *DIL,
+                                SmallVectorImpl<uint64_t> &InlinedCallStack) {
+    for (; DIL; DIL = DIL->getInlinedAt()) {
+      const DISubprogram *CalleeSP = DIL->getScope()->getSubprogram();
+      InlinedCallStack.push_back(computeStackId(
+          getSubprogramGUID(CalleeSP), DIL->getLine() - CalleeSP->getLine(),
+          DIL->getColumn()));
+    }
+  };
+
+  for (auto &BB : F) {
+    for (auto &I : BB) {
+      auto *CI = dyn_cast<CallBase>(&I);
+      if (!CI || isa<IntrinsicInst>(CI) || !I.getDebugLoc())
+        continue;
+
+      SmallVector<uint64_t, 8> InlinedCallStack;
+      GetInlinedCallStack(I.getDebugLoc().get(), InlinedCallStack);
+      uint64_t LeafStackId = InlinedCallStack.front();
+
+      if (isAllocLikeFn(CI, &TLI)) {
+        auto AllocInfoIter = LocHashToAllocInfo.find(LeafStackId);
+        if (AllocInfoIter == LocHashToAllocInfo.end())
+          continue;
+        // Add the contexts whose frames match the inlined call stack of the
+        // call: after inlining, the leading frames are already fixed.
+        memprof::CallStackTrie AllocTrie;
+        for (auto *AllocInfo : AllocInfoIter->second)
+          if (stackFrameIncludesInlinedCallStack(AllocInfo->CallStack,
+                                                 InlinedCallStack))
+            addCallStack(AllocTrie, AllocInfo);
+        if (AllocTrie.empty())
+          continue;
+        NumOfMemProfAllocs++;
+        // The !callsite metadata of the allocation call is the stack of its
+        // inlined frames, to be matched with the contexts of its MIBs.
+        if (AllocTrie.buildAndAttachMIBMetadata(CI))
+          CI->setMetadata(LLVMContext::MD_callsite,
+                          memprof::buildCallstackMetadata(InlinedCallStack,
+                                                          Ctx));
+        continue;
+      }
+
+      // The top frame of the inlined call stack belongs to this function.
+      auto CallSitesIter = LocHashToCallSites.find(InlinedCallStack.back());
+      if (CallSitesIter == LocHashToCallSites.end())
+        continue;
+      for (const auto &CallSite : CallSitesIter->second) {
+        // Only match against the frames from the leaf of the inlined call
+        // stack, which comes Idx frames below this function's frame.
+        unsigned InlinedDepth = InlinedCallStack.size() - 1;
+        if (CallSite.second < InlinedDepth)
+          continue;
+        if (stackFrameIncludesInlinedCallStack(
+                *CallSite.first, InlinedCallStack,
+                CallSite.second - InlinedDepth)) {
+          NumOfMemProfCallSites++;
+          CI->setMetadata(LLVMContext::MD_callsite,
+                          memprof::buildCallstackMetadata(InlinedCallStack,
+                                                          Ctx));
+          break;
+        }
+      }
+    }
+  }
+}
+
 static bool annotateAllFunctions(
     Module &M, StringRef ProfileFileName, StringRef ProfileRemappingFileName,
     function_ref<TargetLibraryInfo &(Function &)> LookupTLI,
@@ -1752,7 +1964,7 @@ static bool annotateAllFunctions(
     return false;
 
   // TODO: might need to change the warning once the clang option is finalized.
-  if (!PGOReader->isIRLevelProfile()) {
+  if (!PGOReader->isIRLevelProfile() && !PGOReader->hasMemoryProfile()) {
     Ctx.diagnose(DiagnosticInfoPGOProfile(
         ProfileFileName.data(), "Not an IR level instrumentation profile"));
     return false;
@@ -1773,10 +1985,12 @@ static bool annotateAllFunctions(
   // Add the profile summary (read from the header of the indexed summary) here
   // so that we can use it below when reading counters (which checks if the
   // function should be marked with a cold or inlinehint attribute).
-  M.setProfileSummary(PGOReader->getSummary(IsCS).getMD(M.getContext()),
-                      IsCS ? ProfileSummary::PSK_CSInstr
-                           : ProfileSummary::PSK_Instr);
-  PSI->refresh();
+  if (PGOReader->isIRLevelProfile()) {
+    M.setProfileSummary(PGOReader->getSummary(IsCS).getMD(M.getContext()),
+                        IsCS ? ProfileSummary::PSK_CSInstr
+                             : ProfileSummary::PSK_Instr);
+    PSI->refresh();
+  }
 
   std::unordered_multimap<Comdat *, GlobalValue *> ComdatMembers;
   collectComdatMembers(M, ComdatMembers);
@@ -1792,6 +2006,13 @@ static bool annotateAllFunctions(
     if (F.isDeclaration())
       continue;
     auto &TLI = LookupTLI(F);
+    // The memprof profile is matched once, before the context-sensitive
+    // profile is read.
+    if (PGOMatchMemProf && !IsCS && PGOReader->hasMemoryProfile())
+      readMemprof(M, F, PGOReader.get(), TLI);
+    // Nothing left to do if there is only a memprof profile.
+    if (!PGOReader->isIRLevelProfile())
+      continue;
     auto *BPI = LookupBPI(F);
     auto *BFI = LookupBFI(F);
     // Split indirectbr critical edges here before computing the MST rather than
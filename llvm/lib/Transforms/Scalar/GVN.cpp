@@ -1816,7 +1816,7 @@ bool GVNPass::processNonLocalLoad(LoadInst *Load) {
   }
 
   // Step 4: Eliminate partial redundancy.
-  if (!isPREEnabled() || !isLoadPREEnabled())
+  if (!isPREEnabled() || !isLoadPREEnabled() || OverBudget)
     return Changed;
   if (!isLoadInLoopPREEnabled() && LI && LI->getLoopFor(Load->getParent()))
     return Changed;
@@ -2604,6 +2604,9 @@ bool GVNPass::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
   InvalidBlockRPONumbers = true;
   MemorySSAUpdater Updater(MSSA);
   MSSAU = MSSA ? &Updater : nullptr;
+  // Functions over their compile-time budget only get a single iteration of
+  // value numbering, without PRE.
+  OverBudget = F.hasFnAttribute("compile-time-budget-exceeded");
 
   bool Changed = false;
   bool ShouldContinue = true;
@@ -2626,9 +2629,11 @@ bool GVNPass::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
     ShouldContinue = iterateOnFunction(F);
     Changed |= ShouldContinue;
     ++Iteration;
+    if (OverBudget)
+      break;
   }
 
-  if (isPREEnabled()) {
+  if (isPREEnabled() && !OverBudget) {
     // Fabricate val-num for dead-code in order to suppress assertion in
     // performPRE().
     assignValNumForDeadCode();
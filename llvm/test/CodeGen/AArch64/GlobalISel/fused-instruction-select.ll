@@ -0,0 +1,28 @@
+; RUN: llc -mtriple=aarch64-- -O0 -global-isel \
+; RUN:   -aarch64-enable-gisel-fused-select -verify-machineinstrs %s -o - \
+; RUN:   | FileCheck %s
+; RUN: llc -mtriple=aarch64-- -O0 -global-isel \
+; RUN:   -aarch64-enable-gisel-fused-select -debug-only=instruction-select \
+; RUN:   %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=COVERAGE
+; REQUIRES: asserts
+
+; The fused selector replaces RegBankSelect and InstructionSelect in the -O0
+; pipeline, and reports the rules it covered like InstructionSelect does.
+
+; CHECK-LABEL: sum:
+; CHECK: add w{{[0-9]+}}, w{{[0-9]+}}, w{{[0-9]+}}
+; CHECK: ret
+; COVERAGE: Rules covered by selecting function: sum:
+define i32 @sum(i32 %n, i32 %step) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, %step
+  %done = icmp uge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %i.next
+}
@@ -0,0 +1,63 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -o %t.ref
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -isel-match-cache -o %t.cached
+; RUN: diff %t.ref %t.cached
+
+; Starting the match of a node at the pattern that matched the last node of
+; the same shape must not change the selected instructions. The nodes below
+; repeat shapes whose patterns differ only in what their predicates check:
+; the immediate sizes, the use counts, the subtarget and the optimization
+; level.
+
+define i64 @imm_sizes(i64 %a, i64 %b) nounwind {
+  %x0 = add i64 %a, 1
+  %x1 = add i64 %x0, 127
+  %x2 = add i64 %x1, 128
+  %x3 = add i64 %x2, 2147483647
+  %x4 = add i64 %x3, 2147483648
+  %x5 = and i64 %x4, 255
+  %x6 = and i64 %x5, 4294967295
+  %x7 = and i64 %x6, %b
+  %x8 = shl i64 %x7, 1
+  %x9 = shl i64 %x8, 3
+  ret i64 %x9
+}
+
+define i32 @use_counts(i32 %a, i32 %b, ptr %p) nounwind {
+  %m0 = mul i32 %a, %b
+  %s0 = add i32 %m0, %a
+  %m1 = mul i32 %a, %b
+  store i32 %m1, ptr %p
+  %s1 = add i32 %m1, %s0
+  %l = shl i32 %s1, 2
+  %s2 = add i32 %l, %b
+  %s3 = add i32 %s2, %l
+  ret i32 %s3
+}
+
+define <4 x float> @sse(<4 x float> %a, <4 x float> %b, <4 x float> %c) nounwind {
+  %m = fmul <4 x float> %a, %b
+  %s = fadd <4 x float> %m, %c
+  %t = fadd <4 x float> %s, %m
+  ret <4 x float> %t
+}
+
+define <4 x float> @fma(<4 x float> %a, <4 x float> %b, <4 x float> %c) nounwind "target-features"="+avx2,+fma" {
+  %m = fmul contract <4 x float> %a, %b
+  %s = fadd contract <4 x float> %m, %c
+  %t = fadd contract <4 x float> %s, %m
+  ret <4 x float> %t
+}
+
+define i64 @minsize(i64 %a) nounwind minsize {
+  %x0 = mul i64 %a, 9
+  %x1 = mul i64 %x0, 5
+  %x2 = add i64 %x1, 1
+  ret i64 %x2
+}
+
+define i64 @speed(i64 %a) nounwind {
+  %x0 = mul i64 %a, 9
+  %x1 = mul i64 %x0, 5
+  %x2 = add i64 %x1, 1
+  ret i64 %x2
+}
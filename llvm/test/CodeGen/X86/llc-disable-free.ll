@@ -0,0 +1,16 @@
+; Leaking the IR on exit does not change the output, including when the
+; module is compiled several times and only the last compilation leaks.
+
+; RUN: llc -mtriple=x86_64 -disable-free %s -o %t.leak.s
+; RUN: llc -mtriple=x86_64 -disable-free=false %s -o %t.free.s
+; RUN: llc -mtriple=x86_64 -disable-free -time-compilations=2 %s -o %t.twice.s
+; RUN: cmp %t.leak.s %t.free.s
+; RUN: cmp %t.leak.s %t.twice.s
+; RUN: FileCheck %s < %t.leak.s
+
+; CHECK-LABEL: f:
+; CHECK:         leal 1(%rdi), %eax
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
@@ -0,0 +1,22 @@
+; RUN: rm -f %t.o
+; RUN: not llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj \
+; RUN:   -parallel-codegen=2 %s -o %t.o 2>&1 | FileCheck %s
+; RUN: not ls %t.o
+
+; The diagnostics of each partition reach the diagnostic handler of llc, which
+; prints the location cookie of inline asm errors, and an error fails the
+; compilation without writing the output.
+
+; CHECK: error: invalid instruction mnemonic 'bogus'
+; CHECK: note: !srcloc = 42
+
+define void @f() {
+  call void asm sideeffect "bogus", ""(), !srcloc !0
+  ret void
+}
+
+define void @g() {
+  ret void
+}
+
+!0 = !{i64 42}
@@ -0,0 +1,117 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -regalloc=linear \
+; RUN:   -verify-machineinstrs | FileCheck %s
+
+; Sixteen values live across a call don't fit in the six callee-saved
+; registers, so some of them are evicted and spilled around the call.
+; CHECK-LABEL: across_call:
+; CHECK: 8-byte Spill
+; CHECK: callq ext
+; CHECK: 8-byte Reload
+; CHECK: retq
+define i64 @across_call(ptr %p) nounwind {
+entry:
+  %p1 = getelementptr i64, ptr %p, i64 1
+  %p2 = getelementptr i64, ptr %p, i64 2
+  %p3 = getelementptr i64, ptr %p, i64 3
+  %p4 = getelementptr i64, ptr %p, i64 4
+  %p5 = getelementptr i64, ptr %p, i64 5
+  %p6 = getelementptr i64, ptr %p, i64 6
+  %p7 = getelementptr i64, ptr %p, i64 7
+  %p8 = getelementptr i64, ptr %p, i64 8
+  %p9 = getelementptr i64, ptr %p, i64 9
+  %p10 = getelementptr i64, ptr %p, i64 10
+  %p11 = getelementptr i64, ptr %p, i64 11
+  %p12 = getelementptr i64, ptr %p, i64 12
+  %p13 = getelementptr i64, ptr %p, i64 13
+  %p14 = getelementptr i64, ptr %p, i64 14
+  %p15 = getelementptr i64, ptr %p, i64 15
+  %v0 = load volatile i64, ptr %p
+  %v1 = load volatile i64, ptr %p1
+  %v2 = load volatile i64, ptr %p2
+  %v3 = load volatile i64, ptr %p3
+  %v4 = load volatile i64, ptr %p4
+  %v5 = load volatile i64, ptr %p5
+  %v6 = load volatile i64, ptr %p6
+  %v7 = load volatile i64, ptr %p7
+  %v8 = load volatile i64, ptr %p8
+  %v9 = load volatile i64, ptr %p9
+  %v10 = load volatile i64, ptr %p10
+  %v11 = load volatile i64, ptr %p11
+  %v12 = load volatile i64, ptr %p12
+  %v13 = load volatile i64, ptr %p13
+  %v14 = load volatile i64, ptr %p14
+  %v15 = load volatile i64, ptr %p15
+  call void @ext()
+  store volatile i64 %v0, ptr %p
+  store volatile i64 %v1, ptr %p1
+  store volatile i64 %v2, ptr %p2
+  store volatile i64 %v3, ptr %p3
+  store volatile i64 %v4, ptr %p4
+  store volatile i64 %v5, ptr %p5
+  store volatile i64 %v6, ptr %p6
+  store volatile i64 %v7, ptr %p7
+  store volatile i64 %v8, ptr %p8
+  store volatile i64 %v9, ptr %p9
+  store volatile i64 %v10, ptr %p10
+  store volatile i64 %v11, ptr %p11
+  store volatile i64 %v12, ptr %p12
+  store volatile i64 %v13, ptr %p13
+  store volatile i64 %v14, ptr %p14
+  store volatile i64 %v15, ptr %p15
+  ret i64 %v0
+}
+
+; Values live around a loop with more pressure than registers inside it are
+; split around the blocks that use them, and evictions between the pieces
+; must come to an end.
+; CHECK-LABEL: loop_pressure:
+; CHECK: retq
+define i64 @loop_pressure(ptr %p, i64 %n) nounwind {
+entry:
+  %a = load volatile i64, ptr %p
+  %b = load volatile i64, ptr %p
+  %c = load volatile i64, ptr %p
+  %d = load volatile i64, ptr %p
+  %e = load volatile i64, ptr %p
+  %f = load volatile i64, ptr %p
+  %g = load volatile i64, ptr %p
+  %h = load volatile i64, ptr %p
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i64 [ %a, %entry ], [ %acc.next, %loop ]
+  %x0 = load volatile i64, ptr %p
+  %x1 = load volatile i64, ptr %p
+  %x2 = load volatile i64, ptr %p
+  %x3 = load volatile i64, ptr %p
+  %x4 = load volatile i64, ptr %p
+  %x5 = load volatile i64, ptr %p
+  %x6 = load volatile i64, ptr %p
+  %x7 = load volatile i64, ptr %p
+  %s0 = add i64 %x0, %x1
+  %s1 = add i64 %x2, %x3
+  %s2 = add i64 %x4, %x5
+  %s3 = add i64 %x6, %x7
+  %s4 = mul i64 %s0, %s1
+  %s5 = mul i64 %s2, %s3
+  %s6 = xor i64 %s4, %s5
+  %acc.next = add i64 %acc, %s6
+  store volatile i64 %x0, ptr %p
+  store volatile i64 %x7, ptr %p
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r0 = add i64 %acc.next, %b
+  %r1 = add i64 %r0, %c
+  %r2 = add i64 %r1, %d
+  %r3 = add i64 %r2, %e
+  %r4 = add i64 %r3, %f
+  %r5 = add i64 %r4, %g
+  %r6 = add i64 %r5, %h
+  ret i64 %r6
+}
+
+declare void @ext()
@@ -0,0 +1,38 @@
+; Test the per-call gate of the memory access checks with -hwasan-sample-checks.
+;
+; RUN: opt < %s -passes=hwasan -hwasan-sample-checks \
+; RUN:   -hwasan-instrument-with-calls -S | FileCheck %s
+
+target datalayout = "e-m:e-i8:8:32-i16:16:32-i64:64-i128:128-n32:64-S128"
+target triple = "aarch64--linux-gnu"
+
+; CHECK: @__hwasan_sample_countdown = external thread_local(initialexec) global i32
+
+define i32 @load(ptr %p) sanitize_hwaddress {
+; CHECK-LABEL: @load(
+; CHECK:         %[[COUNTDOWN:[^ ]+]] = load i32, ptr @__hwasan_sample_countdown
+; CHECK-NEXT:    %[[SAMPLED:[^ ]+]] = icmp slt i32 %[[COUNTDOWN]], 1
+; CHECK-NEXT:    %[[STEP:[^ ]+]] = select i1 %[[SAMPLED]], i32 1, i32 -1
+; CHECK-NEXT:    %[[NEXT:[^ ]+]] = add i32 %[[COUNTDOWN]], %[[STEP]]
+; CHECK-NEXT:    store i32 %[[NEXT]], ptr @__hwasan_sample_countdown
+; CHECK-NEXT:    %[[REFILL:[^ ]+]] = icmp eq i32 %[[COUNTDOWN]], 0
+; CHECK-NEXT:    br i1 %[[REFILL]], label %{{.*}}, label %[[AFTER_REFILL:[^ ,]+]], !prof ![[UNLIKELY:[0-9]+]]
+; CHECK:         call void @__hwasan_sample_refill()
+; CHECK:       [[AFTER_REFILL]]:
+; CHECK:         br i1 %[[SAMPLED]], label %{{.*}}, label %[[AFTER_CHECK:[^ ,]+]], !prof ![[UNLIKELY]]
+; CHECK:         call void @__hwasan_load4(
+; CHECK:       [[AFTER_CHECK]]:
+; CHECK-NEXT:    load i32, ptr %p
+  %v = load i32, ptr %p
+  ret i32 %v
+}
+
+; Functions without checks do not touch the countdown.
+define i32 @no_access(i32 %x) sanitize_hwaddress {
+; CHECK-LABEL: @no_access(
+; CHECK-NOT:     @__hwasan_sample_countdown
+; CHECK:         ret i32 %x
+  ret i32 %x
+}
+
+; CHECK: ![[UNLIKELY]] = !{!"branch_weights", i32 1, i32 100000}
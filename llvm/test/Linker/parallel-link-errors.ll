@@ -0,0 +1,31 @@
+; RUN: rm -rf %t && split-file %s %t
+; RUN: not llvm-link -threads=2 -link-fan-in=2 %t/a.ll %t/b.ll %t/c.ll \
+; RUN:   %t/d.ll %t/e.ll -S -o - 2>&1 | FileCheck %s --implicit-check-not=error
+
+; The inputs are linked in groups of two on a thread pool. The errors of the
+; workers are reported once, in input order, and nothing is reported past the
+; first group that failed.
+
+; CHECK: c.ll:1:1: error: expected top-level entity
+; CHECK: error:  loading file '{{.*}}c.ll'
+
+;--- a.ll
+define void @a() {
+  ret void
+}
+
+;--- b.ll
+define void @b() {
+  ret void
+}
+
+;--- c.ll
+bogus
+
+;--- d.ll
+define void @d() {
+  ret void
+}
+
+;--- e.ll
+bogus
@@ -0,0 +1,13 @@
+; Leaking the IR on exit does not change the output.
+
+; RUN: opt -S -passes=instcombine -disable-free %s -o %t.leak.ll
+; RUN: opt -S -passes=instcombine -disable-free=false %s -o %t.free.ll
+; RUN: cmp %t.leak.ll %t.free.ll
+; RUN: FileCheck %s < %t.leak.ll
+
+; CHECK-LABEL: define i32 @f(
+; CHECK-NEXT:    ret i32 %x
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
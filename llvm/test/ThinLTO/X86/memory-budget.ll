@@ -0,0 +1,37 @@
+; Check that running the backends under a memory budget, here one small
+; enough that each backend runs alone, produces the same objects.
+
+; RUN: rm -rf %t && split-file %s %t
+; RUN: opt -module-summary %t/a.ll -o %t/a.bc
+; RUN: opt -module-summary %t/b.ll -o %t/b.bc
+
+; RUN: llvm-lto2 run %t/a.bc %t/b.bc -o %t/ref -thinlto-threads=2 \
+; RUN:   -r=%t/a.bc,main,plx -r=%t/a.bc,g, -r=%t/b.bc,g,pl
+; RUN: llvm-lto2 run %t/a.bc %t/b.bc -o %t/budget -thinlto-threads=2 \
+; RUN:   -thinlto-memory-budget=1 -thinlto-backend-bytes-per-inst=1048576 \
+; RUN:   -r=%t/a.bc,main,plx -r=%t/a.bc,g, -r=%t/b.bc,g,pl -save-temps
+; RUN: cmp %t/ref.1 %t/budget.1
+; RUN: cmp %t/ref.2 %t/budget.2
+
+; The budget doesn't get in the way of importing.
+; RUN: llvm-dis %t/budget.1.3.import.bc -o - | FileCheck %s
+; CHECK: define available_externally i32 @g()
+
+;--- a.ll
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @g()
+
+define i32 @main() {
+  %r = call i32 @g()
+  ret i32 %r
+}
+
+;--- b.ll
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @g() {
+  ret i32 42
+}
@@ -0,0 +1,88 @@
+; Check that the combined summaries and import lists of the thin link do not
+; depend on the number of threads that read the summaries and compute the
+; imports.
+
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: opt -module-summary a.ll -o a.bc
+; RUN: opt -module-summary b.ll -o b.bc
+; RUN: opt -module-summary c.ll -o c.bc
+; RUN: opt -module-summary d.ll -o d.bc
+
+; RUN: llvm-lto2 run a.bc b.bc c.bc d.bc -o out -thinlto-distributed-indexes \
+; RUN:   -thinlto-threads=1 -r=a.bc,main,plx -r=a.bc,f, -r=a.bc,g, \
+; RUN:   -r=b.bc,f,pl -r=b.bc,h, -r=c.bc,g,pl -r=c.bc,w,p -r=d.bc,h,pl \
+; RUN:   -r=d.bc,w,r
+; RUN: mkdir ref
+; RUN: mv a.bc.thinlto.bc b.bc.thinlto.bc c.bc.thinlto.bc d.bc.thinlto.bc ref
+; RUN: mv a.bc.imports b.bc.imports c.bc.imports d.bc.imports ref
+
+; RUN: llvm-lto2 run a.bc b.bc c.bc d.bc -o out -thinlto-distributed-indexes \
+; RUN:   -thinlto-threads=4 -r=a.bc,main,plx -r=a.bc,f, -r=a.bc,g, \
+; RUN:   -r=b.bc,f,pl -r=b.bc,h, -r=c.bc,g,pl -r=c.bc,w,p -r=d.bc,h,pl \
+; RUN:   -r=d.bc,w,r
+; RUN: cmp ref/a.bc.thinlto.bc a.bc.thinlto.bc
+; RUN: cmp ref/b.bc.thinlto.bc b.bc.thinlto.bc
+; RUN: cmp ref/c.bc.thinlto.bc c.bc.thinlto.bc
+; RUN: cmp ref/d.bc.thinlto.bc d.bc.thinlto.bc
+; RUN: cmp ref/a.bc.imports a.bc.imports
+; RUN: cmp ref/b.bc.imports b.bc.imports
+; RUN: cmp ref/c.bc.imports c.bc.imports
+; RUN: cmp ref/d.bc.imports d.bc.imports
+
+; a imports from the modules of f and g, and b from the module of h.
+; RUN: FileCheck %s --check-prefix=IMPORTS-A < a.bc.imports
+; RUN: FileCheck %s --check-prefix=IMPORTS-B < b.bc.imports
+; IMPORTS-A-DAG: b.bc
+; IMPORTS-A-DAG: c.bc
+; IMPORTS-B: d.bc
+
+;--- a.ll
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @f()
+declare i32 @g()
+
+define i32 @main() {
+  %a = call i32 @f()
+  %b = call i32 @g()
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+;--- b.ll
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @h()
+
+define i32 @f() {
+  %r = call i32 @h()
+  ret i32 %r
+}
+
+;--- c.ll
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @g() {
+  %r = call i32 @w()
+  ret i32 %r
+}
+
+define weak i32 @w() {
+  ret i32 1
+}
+
+;--- d.ll
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @h() {
+  %r = call i32 @w()
+  ret i32 %r
+}
+
+define weak i32 @w() {
+  ret i32 2
+}
@@ -0,0 +1,36 @@
+; RUN: opt < %s -passes=instcombine -S | FileCheck %s
+; RUN: opt < %s -passes=instcombine -instcombine-batch-by-opcode -S \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -passes=instcombine -instcombine-skip-unchanged-users -S \
+; RUN:   | FileCheck %s
+
+; The experimental worklist orderings still reach the same result on chains
+; of folds and on calls that are only annotated in place.
+
+declare ptr @g(ptr)
+
+define i32 @fold_chain(i32 %x, i32 %y) {
+; CHECK-LABEL: @fold_chain(
+; CHECK-NEXT:    [[E:%.*]] = sub i32 [[X:%.*]], [[Y:%.*]]
+; CHECK-NEXT:    [[M:%.*]] = shl i32 [[E]], 3
+; CHECK-NEXT:    ret i32 [[M]]
+;
+  %a = add i32 %x, 0
+  %c = xor i32 %a, -1
+  %d = xor i32 %c, -1
+  %e = sub i32 %d, %y
+  %m = mul i32 %e, 8
+  ret i32 %m
+}
+
+define ptr @annotated_call() {
+; CHECK-LABEL: @annotated_call(
+; CHECK-NEXT:    [[A:%.*]] = alloca i8, align 1
+; CHECK-NEXT:    [[R:%.*]] = call ptr @g(ptr nonnull [[A]])
+; CHECK-NEXT:    ret ptr [[R]]
+;
+  %a = alloca i8
+  %r = call ptr @g(ptr %a)
+  %s = getelementptr i8, ptr %r, i64 0
+  ret ptr %s
+}
@@ -0,0 +1,16 @@
+; RUN: opt < %s -passes=instcombine -instcombine-skip-unchanged-users \
+; RUN:   -stats -disable-output 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Adding nonnull to the argument changes nothing the users of the call can
+; observe, so they are not queued again.
+
+; CHECK: 1 instcombine - Number of modified insts whose users were not revisited
+
+declare ptr @g(ptr)
+
+define ptr @annotated_call() {
+  %a = alloca i8
+  %r = call ptr @g(ptr %a)
+  ret ptr %r
+}
@@ -0,0 +1,31 @@
+# REQUIRES: x86-registered-target
+# RUN: llvm-mca -mtriple=x86_64-unknown-unknown -mcpu=btver2 -iterations=10 %s -o %t.serial
+# RUN: llvm-mca -mtriple=x86_64-unknown-unknown -mcpu=btver2 -iterations=10 -j 4 %s -o %t.parallel
+# RUN: diff %t.serial %t.parallel
+# RUN: FileCheck %s --input-file=%t.parallel
+# RUN: llvm-mca -mtriple=x86_64-unknown-unknown -mcpu=btver2 -iterations=10 -json %s -o %t.serial.json
+# RUN: llvm-mca -mtriple=x86_64-unknown-unknown -mcpu=btver2 -iterations=10 -json -j 4 %s -o %t.parallel.json
+# RUN: diff %t.serial.json %t.parallel.json
+
+# Regions analyzed on several threads are reported as if analyzed in order.
+
+# LLVM-MCA-BEGIN first
+addl %ebx, %eax
+# LLVM-MCA-END
+
+# LLVM-MCA-BEGIN second
+imull %ecx, %edx
+addl %edx, %eax
+# LLVM-MCA-END
+
+# LLVM-MCA-BEGIN third
+vmulps %xmm0, %xmm1, %xmm2
+vaddps %xmm2, %xmm3, %xmm4
+# LLVM-MCA-END
+
+# CHECK:      [0] Code Region - first
+# CHECK:      addl %ebx, %eax
+# CHECK:      [1] Code Region - second
+# CHECK:      imull %ecx, %edx
+# CHECK:      [2] Code Region - third
+# CHECK:      vmulps %xmm0, %xmm1, %xmm2
@@ -52,6 +52,9 @@ struct LinkOptions {
   /// Number of threads.
   unsigned Threads = 1;
 
+  /// Soft limit, in bytes, on parsed debug info waiting to be linked.
+  uint64_t MemoryBudget = 0;
+
   // Output file type.
   OutputFileType FileType = OutputFileType::Object;
 
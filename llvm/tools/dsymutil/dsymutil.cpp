@@ -330,6 +330,15 @@ static Expected<DsymutilOptions> getOptions(opt::InputArgList &Args) {
   if (Options.DumpDebugMap || Options.LinkOpts.Verbose)
     Options.LinkOpts.Threads = 1;
 
+  if (opt::Arg *MemoryBudget = Args.getLastArg(OPT_memory_budget)) {
+    uint64_t Megabytes;
+    if (StringRef(MemoryBudget->getValue()).getAsInteger(10, Megabytes))
+      return make_error<StringError>(
+          Twine("invalid memory budget: ") + MemoryBudget->getValue(),
+          errc::invalid_argument);
+    Options.LinkOpts.MemoryBudget = Megabytes << 20;
+  }
+
   if (getenv("RC_DEBUG_OPTIONS"))
     Options.PaperTrailWarnings = true;
 
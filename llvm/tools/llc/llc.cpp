@@ -19,9 +19,11 @@
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/CodeGen/MCAScheduleEvaluator.h"
 #include "llvm/CodeGen/MIRParser/MIRParser.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/IR/AutoUpgrade.h"
@@ -41,6 +43,7 @@
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Pass.h"
 #include "llvm/Remarks/HotnessThresholdParser.h"
+#include "llvm/Support/BuryPointer.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
@@ -85,6 +88,11 @@ TimeCompilations("time-compilations", cl::Hidden, cl::init(1u),
                  cl::value_desc("N"),
                  cl::desc("Repeat compilation N times for timing"));
 
+static cl::opt<unsigned> ParallelCodeGen(
+    "parallel-codegen", cl::init(1u), cl::value_desc("N"),
+    cl::desc("Split the module into N partitions and generate code for them "
+             "in parallel (ELF object files only)"));
+
 static cl::opt<bool> TimeTrace("time-trace", cl::desc("Record time trace"));
 
 static cl::opt<unsigned> TimeTraceGranularity(
@@ -162,6 +170,17 @@ static cl::opt<bool> DiscardValueNames(
     cl::desc("Discard names from Value (other than GlobalValue)."),
     cl::init(false), cl::Hidden);
 
+// Defaults to the same as in opt.
+static cl::opt<bool> DisableFree("disable-free",
+                                 cl::desc("Leak the IR on exit instead of "
+                                          "freeing it"),
+#ifdef NDEBUG
+                                 cl::init(true),
+#else
+                                 cl::init(false),
+#endif
+                                 cl::Hidden);
+
 static cl::list<std::string> IncludeDirs("I", cl::desc("include search path"));
 
 static cl::opt<bool> RemarksWithHotness(
@@ -215,7 +234,7 @@ static cl::opt<RunPassOption, true, cl::parser<std::string>> RunPass(
     cl::desc("Run compiler only for specified passes (comma separated list)"),
     cl::value_desc("pass-name"), cl::ZeroOrMore, cl::location(RunPassOpt));
 
-static int compileModule(char **, LLVMContext &);
+static int compileModule(char **, LLVMContext &, bool LeakIR);
 
 [[noreturn]] static void reportError(Twine Msg, StringRef Filename = "") {
   SmallString<256> Prefix;
@@ -375,6 +394,9 @@ int main(int argc, char **argv) {
   // Initialize debugging passes.
   initializeScavengerTestPass(*Registry);
 
+  // Let -post-misched-mca simulate schedules with llvm-mca.
+  registerMCAScheduleEvaluator();
+
   // Register the target printer for --version.
   cl::AddExtraVersionPrinter(TargetRegistry::printRegisteredTargetsForVersion);
 
@@ -416,7 +438,7 @@ int main(int argc, char **argv) {
   // Compile the module TimeCompilations times to give better compile time
   // metrics.
   for (unsigned I = TimeCompilations; I; --I)
-    if (int RetVal = compileModule(argv, Context))
+    if (int RetVal = compileModule(argv, Context, DisableFree && I == 1))
       return RetVal;
 
   if (RemarksFile)
@@ -453,10 +475,17 @@ static bool addPass(PassManagerBase &PM, const char *argv0,
   return false;
 }
 
-static int compileModule(char **argv, LLVMContext &Context) {
+static int compileModule(char **argv, LLVMContext &Context, bool LeakIR) {
   // Load the module to be compiled...
   SMDiagnostic Err;
   std::unique_ptr<Module> M;
+  // Only the last compilation leaks its IR, see enableLeakOnExit().
+  auto BuryIR = make_scope_exit([&] {
+    if (!LeakIR)
+      return;
+    enableLeakOnExit();
+    BuryPointer(std::move(M));
+  });
   std::unique_ptr<MIRParser> MIR;
   Triple TheTriple;
   std::string CPUStr = codegen::getCPUStr(),
@@ -654,6 +683,34 @@ static int compileModule(char **argv, LLVMContext &Context) {
     WithColor::warning(errs(), argv[0])
         << ": warning: ignoring -mc-relax-all because filetype != obj";
 
+  // Generate code for the partitions of the module on a thread pool, and
+  // combine their object files into the output.
+  if (ParallelCodeGen > 1) {
+    if (MIR || !RunPassNames->empty())
+      reportError("-parallel-codegen is for IR files only");
+    if (codegen::getFileType() != CGFT_ObjectFile || DwoOut || CompileTwice)
+      reportError("-parallel-codegen only supports -filetype=obj without "
+                  "-split-dwarf-output or -compile-twice");
+    if (!TheTriple.isOSBinFormatELF() || TheTriple.isMIPS())
+      reportError("-parallel-codegen is not supported for this target");
+
+    auto CreateTargetMachine = [&]() {
+      return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+          TheTriple.getTriple(), CPUStr, FeaturesStr, Target->Options, RM,
+          codegen::getExplicitCodeModel(), OLvl));
+    };
+    cl::PrintOptionValues();
+    if (Error E = splitCodeGenToObject(*M, ParallelCodeGen, Out->os(),
+                                       CreateTargetMachine))
+      reportError(std::move(E), InputFilename);
+    // The diagnostics of the partitions went to the handler of Context.
+    if (*static_cast<const LLCDiagnosticHandler *>(Context.getDiagHandlerPtr())
+             ->HasError)
+      return 1;
+    Out->keep();
+    return 0;
+  }
+
   {
     raw_pwrite_stream *OS = &Out->os();
 
@@ -18,6 +18,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFAcceleratorTable.h"
 #include "llvm/DebugInfo/DWARF/DWARFCompileUnit.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFDieNameIndex.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Object/ObjectFile.h"
@@ -182,6 +183,13 @@ static list<std::string> Name(
     value_desc("pattern"), cat(DwarfDumpCategory));
 static alias NameAlias("n", desc("Alias for --name"), aliasopt(Name),
                        cl::NotHidden);
+static opt<std::string> NameIndexFile(
+    "name-index",
+    desc("Answer --name queries that use neither --regex nor --ignore-case "
+         "from an index of all DIE names, built using multiple threads. The "
+         "index is read from <filename> if that file was written for the "
+         "same input, and is written to it otherwise."),
+    value_desc("filename"), cat(DwarfDumpCategory));
 static opt<uint64_t>
     Lookup("lookup",
            desc("Lookup <address> in the debug information and print out any "
@@ -251,6 +259,12 @@ static opt<bool> Verify("verify", desc("Verify the DWARF debug info."),
                         cat(DwarfDumpCategory));
 static opt<bool> Quiet("quiet", desc("Use with -verify to not emit to STDOUT."),
                        cat(DwarfDumpCategory));
+static opt<unsigned> VerifyThreads(
+    "verify-threads", init(1),
+    desc("Use with -verify to verify units and accelerator tables on <n> "
+         "threads; 0 uses all hardware threads. The output is the same as "
+         "with one thread, but is printed without color."),
+    value_desc("n"), cat(DwarfDumpCategory));
 static opt<bool> DumpUUID("uuid", desc("Show the UUID for each architecture."),
                           cat(DwarfDumpCategory));
 static alias DumpUUIDAlias("u", desc("Alias for --uuid."), aliasopt(DumpUUID),
@@ -299,6 +313,7 @@ static DIDumpOptions getDumpOpts(DWARFContext &C) {
   // In -verify mode, print DIEs without children in error messages.
   if (Verify) {
     DumpOpts.Verbose = true;
+    DumpOpts.VerifyThreads = VerifyThreads;
     return DumpOpts.noImplicitRecursion();
   }
   return DumpOpts;
@@ -378,6 +393,48 @@ static void filterByName(const StringSet<> &Names,
     }
 }
 
+/// Build the DIE name index for \p DICtx, or read it from the --name-index
+/// file when that holds an index for the same debug info.
+static DWARFDieNameIndex getNameIndex(DWARFContext &DICtx) {
+  if (auto BufOrErr = MemoryBuffer::getFile(NameIndexFile)) {
+    Expected<DWARFDieNameIndex> IndexOrErr =
+        DWARFDieNameIndex::read(DICtx, (*BufOrErr)->getBuffer());
+    if (IndexOrErr)
+      return std::move(*IndexOrErr);
+    consumeError(IndexOrErr.takeError());
+  }
+
+  DWARFDieNameIndex Index = DWARFDieNameIndex::build(DICtx);
+  std::error_code EC;
+  ToolOutputFile Out(NameIndexFile, EC, sys::fs::OF_None);
+  if (EC) {
+    WithColor::warning() << "unable to write name index '" << NameIndexFile
+                         << "': " << EC.message() << '\n';
+    return Index;
+  }
+  Index.write(Out.os());
+  Out.keep();
+  return Index;
+}
+
+/// Print only DIEs of the normal units that have a certain name, using the
+/// DIE name index rather than a walk over all units.
+static void filterByNameIndex(const StringSet<> &Names, DWARFContext &DICtx,
+                              raw_ostream &OS) {
+  DWARFDieNameIndex Index = getNameIndex(DICtx);
+  std::vector<DWARFDieNameIndex::Entry> Entries;
+  for (StringRef Name : Names.keys())
+    llvm::append_range(Entries, Index.lookup(Name));
+  // Print each DIE once, in the order a walk over the units would.
+  llvm::sort(Entries);
+  Entries.erase(std::unique(Entries.begin(), Entries.end()), Entries.end());
+
+  DIDumpOptions DumpOpts = getDumpOpts(DICtx);
+  for (DWARFDieNameIndex::Entry Entry : Entries)
+    if (DWARFDie Die = DWARFDieNameIndex::getDIE(DICtx, Entry))
+      Die.dump(OS, 0, DumpOpts);
+}
+
 static void getDies(DWARFContext &DICtx, const AppleAcceleratorTable &Accel,
                     StringRef Name, SmallVectorImpl<DWARFDie> &Dies) {
   for (const auto &Entry : Accel.equal_range(Name)) {
@@ -484,7 +541,10 @@ static bool dumpObjectFile(ObjectFile &Obj, DWARFContext &DICtx,
     for (auto name : Name)
       Names.insert((IgnoreCase && !UseRegex) ? StringRef(name).lower() : name);
 
-    filterByName(Names, DICtx.normal_units(), OS);
+    if (!NameIndexFile.empty() && !UseRegex && !IgnoreCase)
+      filterByNameIndex(Names, DICtx, OS);
+    else
+      filterByName(Names, DICtx.normal_units(), OS);
     filterByName(Names, DICtx.dwo_units(), OS);
     return true;
   }
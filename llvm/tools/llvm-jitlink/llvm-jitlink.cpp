@@ -25,6 +25,7 @@
 #include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/MachOPlatform.h"
 #include "llvm/ExecutionEngine/Orc/ObjectFileInterface.h"
+#include "llvm/ExecutionEngine/Orc/SharedMemoryJITLinkMemoryManager.h"
 #include "llvm/ExecutionEngine/Orc/TargetProcess/JITLoaderGDB.h"
 #include "llvm/ExecutionEngine/Orc/TargetProcess/RegisterEHFrames.h"
 #include "llvm/MC/MCAsmInfo.h"
@@ -229,6 +230,12 @@ static cl::opt<bool>
                                cl::desc("Show FailedToMaterialize errors"),
                                cl::init(false), cl::cat(JITLinkCategory));
 
+static cl::opt<bool> UseSharedMemory(
+    "use-shared-memory",
+    cl::desc("Link into memory shared with the executor, which must run on "
+             "the same host"),
+    cl::init(false), cl::cat(JITLinkCategory));
+
 static ExitOnError ExitOnErr;
 
 static LLVM_ATTRIBUTE_USED void linkComponents() {
@@ -813,6 +820,17 @@ static Error loadDylibs(Session &S) {
   return Error::success();
 }
 
+static SimpleRemoteEPC::Setup createSimpleRemoteEPCSetup() {
+  SimpleRemoteEPC::Setup S;
+  if (UseSharedMemory)
+    S.CreateMemoryManager = [](SimpleRemoteEPC &EPC)
+        -> Expected<std::unique_ptr<jitlink::JITLinkMemoryManager>> {
+      return SharedMemoryJITLinkMemoryManager::
+          CreateWithDefaultBootstrapSymbols(EPC);
+    };
+  return S;
+}
+
 static Expected<std::unique_ptr<ExecutorProcessControl>> launchExecutor() {
 #ifndef LLVM_ON_UNIX
   // FIXME: Add support for Windows.
@@ -881,7 +899,8 @@ static Expected<std::unique_ptr<ExecutorProcessControl>> launchExecutor() {
 
   return SimpleRemoteEPC::Create<FDSimpleRemoteEPCTransport>(
       std::make_unique<DynamicThreadPoolTaskDispatcher>(),
-      SimpleRemoteEPC::Setup(), FromExecutor[ReadEnd], ToExecutor[WriteEnd]);
+      createSimpleRemoteEPCSetup(), FromExecutor[ReadEnd],
+      ToExecutor[WriteEnd]);
 #endif
 }
 
@@ -967,7 +986,7 @@ static Expected<std::unique_ptr<ExecutorProcessControl>> connectToExecutor() {
 
   return SimpleRemoteEPC::Create<FDSimpleRemoteEPCTransport>(
       std::make_unique<DynamicThreadPoolTaskDispatcher>(),
-      SimpleRemoteEPC::Setup(), *SockFD, *SockFD);
+      createSimpleRemoteEPCSetup(), *SockFD, *SockFD);
 #endif
 }
 
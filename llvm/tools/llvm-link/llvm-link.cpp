@@ -29,8 +29,11 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SmallVectorMemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
@@ -124,18 +127,32 @@ static cl::opt<bool> NoVerify("disable-verify",
                               cl::desc("Do not run the verifier"), cl::Hidden,
                               cl::cat(LinkCategory));
 
+static cl::opt<unsigned>
+    Threads("threads",
+            cl::desc("Number of threads used to link the input files "
+                     "(0 uses all available threads)"),
+            cl::init(1), cl::cat(LinkCategory));
+
+static cl::opt<unsigned> LinkFanIn(
+    "link-fan-in",
+    cl::desc("Number of modules linked together by each task when linking "
+             "with multiple threads"),
+    cl::init(16), cl::Hidden, cl::cat(LinkCategory));
+
 static ExitOnError ExitOnErr;
 
 // Read the specified bitcode file in and return it. This routine searches the
-// link path for the specified file to try to find it...
+// link path for the specified file to try to find it... Errors and verbose
+// output are written to \p OS.
 //
 static std::unique_ptr<Module> loadFile(const char *argv0,
                                         std::unique_ptr<MemoryBuffer> Buffer,
                                         LLVMContext &Context,
-                                        bool MaterializeMetadata = true) {
+                                        bool MaterializeMetadata = true,
+                                        raw_ostream &OS = errs()) {
   SMDiagnostic Err;
   if (Verbose)
-    errs() << "Loading '" << Buffer->getBufferIdentifier() << "'\n";
+    OS << "Loading '" << Buffer->getBufferIdentifier() << "'\n";
   std::unique_ptr<Module> Result;
   if (DisableLazyLoad)
     Result = parseIR(*Buffer, Err, Context);
@@ -144,12 +161,15 @@ static std::unique_ptr<Module> loadFile(const char *argv0,
         getLazyIRModule(std::move(Buffer), Err, Context, !MaterializeMetadata);
 
   if (!Result) {
-    Err.print(argv0, errs());
+    Err.print(argv0, OS);
     return nullptr;
   }
 
   if (MaterializeMetadata) {
-    ExitOnErr(Result->materializeMetadata());
+    if (Error E = Result->materializeMetadata()) {
+      logAllUnhandledErrors(std::move(E), OS, Twine(argv0) + ": ");
+      return nullptr;
+    }
     UpgradeDebugInfo(*Result);
   }
 
@@ -158,35 +178,38 @@ static std::unique_ptr<Module> loadFile(const char *argv0,
 
 static std::unique_ptr<Module> loadArFile(const char *Argv0,
                                           std::unique_ptr<MemoryBuffer> Buffer,
-                                          LLVMContext &Context) {
+                                          LLVMContext &Context,
+                                          raw_ostream &OS = errs()) {
   std::unique_ptr<Module> Result(new Module("ArchiveModule", Context));
   StringRef ArchiveName = Buffer->getBufferIdentifier();
   if (Verbose)
-    errs() << "Reading library archive file '" << ArchiveName
-           << "' to memory\n";
+    OS << "Reading library archive file '" << ArchiveName << "' to memory\n";
   Error Err = Error::success();
   object::Archive Archive(*Buffer, Err);
-  ExitOnErr(std::move(Err));
+  if (Err) {
+    logAllUnhandledErrors(std::move(Err), OS, Twine(Argv0) + ": ");
+    return nullptr;
+  }
   Linker L(*Result);
   for (const object::Archive::Child &C : Archive.children(Err)) {
     Expected<StringRef> Ename = C.getName();
     if (Error E = Ename.takeError()) {
-      errs() << Argv0 << ": ";
-      WithColor::error() << " failed to read name of archive member"
-                         << ArchiveName << "'\n";
+      OS << Argv0 << ": ";
+      WithColor::error(OS) << " failed to read name of archive member"
+                           << ArchiveName << "'\n";
       return nullptr;
     }
     std::string ChildName = Ename.get().str();
     if (Verbose)
-      errs() << "Parsing member '" << ChildName
-             << "' of archive library to module.\n";
+      OS << "Parsing member '" << ChildName
+         << "' of archive library to module.\n";
     SMDiagnostic ParseErr;
     Expected<MemoryBufferRef> MemBuf = C.getMemoryBufferRef();
     if (Error E = MemBuf.takeError()) {
-      errs() << Argv0 << ": ";
-      WithColor::error() << " loading memory for member '" << ChildName
-                         << "' of archive library failed'" << ArchiveName
-                         << "'\n";
+      OS << Argv0 << ": ";
+      WithColor::error(OS) << " loading memory for member '" << ChildName
+                           << "' of archive library failed'" << ArchiveName
+                           << "'\n";
       return nullptr;
     };
 
@@ -194,9 +217,9 @@ static std::unique_ptr<Module> loadArFile(const char *Argv0,
                        MemBuf.get().getBufferStart()),
                    reinterpret_cast<const unsigned char *>(
                        MemBuf.get().getBufferEnd()))) {
-      errs() << Argv0 << ": ";
-      WithColor::error() << "  member of archive is not a bitcode file: '"
-                         << ChildName << "'\n";
+      OS << Argv0 << ": ";
+      WithColor::error(OS) << "  member of archive is not a bitcode file: '"
+                           << ChildName << "'\n";
       return nullptr;
     }
 
@@ -208,18 +231,21 @@ static std::unique_ptr<Module> loadArFile(const char *Argv0,
                           ParseErr, Context);
 
     if (!M.get()) {
-      errs() << Argv0 << ": ";
-      WithColor::error() << " parsing member '" << ChildName
-                         << "' of archive library failed'" << ArchiveName
-                         << "'\n";
+      OS << Argv0 << ": ";
+      WithColor::error(OS) << " parsing member '" << ChildName
+                           << "' of archive library failed'" << ArchiveName
+                           << "'\n";
       return nullptr;
     }
     if (Verbose)
-      errs() << "Linking member '" << ChildName << "' of archive library.\n";
+      OS << "Linking member '" << ChildName << "' of archive library.\n";
     if (L.linkInModule(std::move(M)))
       return nullptr;
   } // end for each child
-  ExitOnErr(std::move(Err));
+  if (Err) {
+    logAllUnhandledErrors(std::move(Err), OS, Twine(Argv0) + ": ");
+    return nullptr;
+  }
   return Result;
 }
 
@@ -269,25 +295,29 @@ Module &ModuleLazyLoaderCache::operator()(const char *argv0,
 
 namespace {
 struct LLVMLinkDiagnosticHandler : public DiagnosticHandler {
+  raw_ostream &OS;
+
+  LLVMLinkDiagnosticHandler(raw_ostream &OS = errs()) : OS(OS) {}
+
   bool handleDiagnostics(const DiagnosticInfo &DI) override {
     unsigned Severity = DI.getSeverity();
     switch (Severity) {
     case DS_Error:
-      WithColor::error();
+      WithColor::error(OS);
       break;
     case DS_Warning:
       if (SuppressWarnings)
         return true;
-      WithColor::warning();
+      WithColor::warning(OS);
       break;
     case DS_Remark:
     case DS_Note:
       llvm_unreachable("Only expecting warnings and errors");
     }
 
-    DiagnosticPrinterRawOStream DP(errs());
+    DiagnosticPrinterRawOStream DP(OS);
     DI.print(DP);
-    errs() << '\n';
+    OS << '\n';
     return true;
   }
 };
@@ -361,6 +391,35 @@ static bool importFunctions(const char *argv0, Module &DestModule) {
   return true;
 }
 
+/// Load the module of an input file, which is either an IR file or an archive
+/// of bitcode files. Returns nullptr after reporting an error to \p OS on
+/// failure.
+static std::unique_ptr<Module>
+loadInputFile(const char *argv0, std::unique_ptr<MemoryBuffer> Buffer,
+              LLVMContext &Context, raw_ostream &OS = errs()) {
+  std::string File = Buffer->getBufferIdentifier().str();
+  std::unique_ptr<Module> M =
+      identify_magic(Buffer->getBuffer()) == file_magic::archive
+          ? loadArFile(argv0, std::move(Buffer), Context, OS)
+          : loadFile(argv0, std::move(Buffer), Context,
+                     /*MaterializeMetadata=*/true, OS);
+  if (!M.get()) {
+    OS << argv0 << ": ";
+    WithColor::error(OS) << " loading file '" << File << "'\n";
+    return nullptr;
+  }
+
+  // Note that when ODR merging types cannot verify input files in here When
+  // doing that debug metadata in the src module might already be pointing to
+  // the destination.
+  if (DisableDITypeMap && !NoVerify && verifyModule(*M, &OS)) {
+    OS << argv0 << ": " << File << ": ";
+    WithColor::error(OS) << "input module is broken!\n";
+    return nullptr;
+  }
+  return M;
+}
+
 static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
                       const cl::list<std::string> &Files, unsigned Flags) {
   // Filter out flags that don't apply to the first file we load.
@@ -368,27 +427,12 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
   // Similar to some flags, internalization doesn't apply to the first file.
   bool InternalizeLinkedSymbols = false;
   for (const auto &File : Files) {
-    std::unique_ptr<MemoryBuffer> Buffer =
-        ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(File)));
-
-    std::unique_ptr<Module> M =
-        identify_magic(Buffer->getBuffer()) == file_magic::archive
-            ? loadArFile(argv0, std::move(Buffer), Context)
-            : loadFile(argv0, std::move(Buffer), Context);
-    if (!M.get()) {
-      errs() << argv0 << ": ";
-      WithColor::error() << " loading file '" << File << "'\n";
+    std::unique_ptr<Module> M = loadInputFile(
+        argv0,
+        ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(File))),
+        Context);
+    if (!M)
       return false;
-    }
-
-    // Note that when ODR merging types cannot verify input files in here When
-    // doing that debug metadata in the src module might already be pointing to
-    // the destination.
-    if (DisableDITypeMap && !NoVerify && verifyModule(*M, &errs())) {
-      errs() << argv0 << ": " << File << ": ";
-      WithColor::error() << "input module is broken!\n";
-      return false;
-    }
 
     // If a module summary index is supplied, load it so linkInModule can treat
     // local functions/variables as exported and promote if necessary.
@@ -440,6 +484,85 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
   return true;
 }
 
+/// Link the regular input files as a tree reduction on a thread pool. LLVM
+/// contexts are not thread safe, and a module can only be linked into another
+/// module of the same context, so the inputs are split into consecutive groups
+/// of -link-fan-in files that are each linked in a context of their own, and
+/// the linked groups are written back to bitcode in memory. This repeats until
+/// at most -link-fan-in modules are left, which are linked into \p L.
+///
+/// The groups only depend on the order and the number of inputs, and modules
+/// are always linked in input order, so the result does not depend on the
+/// number of threads. The workers write their diagnostics to a buffer per
+/// group, which are printed in group order once the level is linked, up to
+/// the first group that failed.
+static bool linkFilesInParallel(const char *argv0, LLVMContext &Context,
+                                Linker &L, const cl::list<std::string> &Files) {
+  std::vector<std::unique_ptr<MemoryBuffer>> Parts;
+  for (const auto &File : Files)
+    Parts.push_back(
+        ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(File))));
+
+  unsigned FanIn = std::max(2u, unsigned(LinkFanIn));
+  ThreadPool Pool(hardware_concurrency(Threads));
+  for (unsigned Level = 0; Parts.size() > FanIn; ++Level) {
+    size_t NumGroups = divideCeil(Parts.size(), FanIn);
+    if (Verbose)
+      errs() << "Linking " << Parts.size() << " modules in " << NumGroups
+             << " groups\n";
+
+    std::vector<std::unique_ptr<MemoryBuffer>> Linked(NumGroups);
+    std::vector<std::string> Diags(NumGroups);
+    for (size_t G = 0; G != NumGroups; ++G) {
+      Pool.async([&, G] {
+        raw_string_ostream OS(Diags[G]);
+        LLVMContext GroupContext;
+        GroupContext.setDiagnosticHandler(
+            std::make_unique<LLVMLinkDiagnosticHandler>(OS), true);
+        if (!DisableDITypeMap)
+          GroupContext.enableDebugTypeODRUniquing();
+
+        auto Group = std::make_unique<Module>("llvm-link", GroupContext);
+        Linker GroupLinker(*Group);
+        size_t End = std::min(Parts.size(), (G + 1) * FanIn);
+        for (size_t I = G * FanIn; I != End; ++I) {
+          std::unique_ptr<Module> M =
+              loadInputFile(argv0, std::move(Parts[I]), GroupContext, OS);
+          if (!M || GroupLinker.linkInModule(std::move(M)))
+            return;
+        }
+
+        SmallVector<char, 0> Buffer;
+        raw_svector_ostream OS(Buffer);
+        WriteBitcodeToFile(*Group, OS, PreserveBitcodeUseListOrder);
+        Linked[G] = std::make_unique<SmallVectorMemoryBuffer>(
+            std::move(Buffer),
+            ("llvm-link.l" + Twine(Level) + "." + Twine(G) + ".bc").str(),
+            /*RequiresNullTerminator=*/false);
+      });
+    }
+    Pool.wait();
+    for (size_t G = 0; G != NumGroups; ++G) {
+      errs() << Diags[G];
+      if (!Linked[G])
+        return false;
+    }
+    Parts = std::move(Linked);
+  }
+
+  for (std::unique_ptr<MemoryBuffer> &Part : Parts) {
+    std::string Name = Part->getBufferIdentifier().str();
+    std::unique_ptr<Module> M = loadInputFile(argv0, std::move(Part), Context);
+    if (!M)
+      return false;
+    if (Verbose)
+      errs() << "Linking in '" << Name << "'\n";
+    if (L.linkInModule(std::move(M)))
+      return false;
+  }
+  return true;
+}
+
 int main(int argc, char **argv) {
   InitLLVM X(argc, argv);
   ExitOnErr.setBanner(std::string(argv[0]) + ": ");
@@ -460,9 +583,17 @@ int main(int argc, char **argv) {
   if (OnlyNeeded)
     Flags |= Linker::Flags::LinkOnlyNeeded;
 
-  // First add all the regular input files
-  if (!linkFiles(argv[0], Context, L, InputFilenames, Flags))
+  // First add all the regular input files. Linking in parallel only keeps the
+  // semantics of a serial link when every input is linked in whole and nothing
+  // is renamed or internalized.
+  bool LinkInParallel = Threads != 1 && InputFilenames.size() > LinkFanIn &&
+                        !OnlyNeeded && !Internalize && SummaryIndex.empty();
+  if (LinkInParallel) {
+    if (!linkFilesInParallel(argv[0], Context, L, InputFilenames))
+      return 1;
+  } else if (!linkFiles(argv[0], Context, L, InputFilenames, Flags)) {
     return 1;
+  }
 
   // Next the -override ones.
   if (!linkFiles(argv[0], Context, L, OverridingInputs,
@@ -477,9 +608,12 @@ int main(int argc, char **argv) {
     errs() << "Here's the assembly:\n" << *Composite;
 
   std::error_code EC;
+  // Open bitcode output for seeking when possible, so that the bitcode writer
+  // can stream large modules to it instead of buffering them whole.
   ToolOutputFile Out(OutputFilename, EC,
                      OutputAssembly ? sys::fs::OF_TextWithCRLF
-                                    : sys::fs::OF_None);
+                                    : sys::fs::OF_None,
+                     /*Seekable=*/!OutputAssembly);
   if (EC) {
     WithColor::error() << EC.message() << '\n';
     return 1;
@@ -18,6 +18,8 @@
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/Config/llvm-config.h"
+#include "llvm/Debuginfod/HTTPCacheStore.h"
+#include "llvm/Debuginfod/HTTPClient.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/LTO/LTO.h"
 #include "llvm/Passes/PassPlugin.h"
@@ -30,6 +32,7 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Threading.h"
 #include <atomic>
+#include <mutex>
 
 using namespace llvm;
 using namespace lto;
@@ -56,6 +59,12 @@ static cl::opt<std::string> OutputFilename("o", cl::Required,
 static cl::opt<std::string> CacheDir("cache-dir", cl::desc("Cache Directory"),
                                      cl::value_desc("directory"));
 
+static cl::opt<std::string>
+    RemoteCacheUrl("remote-cache-url",
+                   cl::desc("URL of an HTTP server used as a second cache tier "
+                            "behind --cache-dir"),
+                   cl::value_desc("url"));
+
 static cl::opt<std::string> OptPipeline("opt-pipeline",
                                         cl::desc("Optimizer Pipeline"),
                                         cl::value_desc("pipeline"));
@@ -78,6 +87,12 @@ static cl::opt<bool>
 // to use all hardware threads or cores in the system.
 static cl::opt<std::string> Threads("thinlto-threads");
 
+static cl::opt<uint64_t> ThinLTOMemoryBudget(
+    "thinlto-memory-budget", cl::init(0),
+    cl::desc("Limit the estimated memory of concurrently running ThinLTO "
+             "backends to this many MiB (0 means no limit)"),
+    cl::value_desc("MiB"));
+
 static cl::list<std::string> SymbolResolutions(
     "r",
     cl::desc("Specify a symbol resolution: filename,symbolname,resolution\n"
@@ -291,6 +306,23 @@ static int run(int argc, char **argv) {
   Conf.StatsFile = StatsFile;
   Conf.PTO.LoopVectorization = Conf.OptLevel > 1;
   Conf.PTO.SLPVectorization = Conf.OptLevel > 1;
+  Conf.ThinLinkParallelism = llvm::heavyweight_hardware_concurrency(Threads);
+
+  std::shared_ptr<HTTPCacheStore> Remote;
+  if (!RemoteCacheUrl.empty()) {
+    if (CacheDir.empty()) {
+      llvm::errs() << argv[0] << ": --remote-cache-url requires --cache-dir\n";
+      return 1;
+    }
+    HTTPClient::initialize();
+    Remote = std::make_shared<HTTPCacheStore>(RemoteCacheUrl,
+                                              std::chrono::seconds(30));
+    // Only fetch what the local tier doesn't have already.
+    Conf.CachePrefetchHook = [Remote](StringRef Key) {
+      if (!hasLocalCacheEntry(CacheDir, Key))
+        Remote->prefetch(Key);
+    };
+  }
 
   ThinBackend Backend;
   if (ThinLTODistributedIndexes)
@@ -301,7 +333,8 @@ static int run(int argc, char **argv) {
                                             /* OnWrite */ {});
   else
     Backend = createInProcessThinBackend(
-        llvm::heavyweight_hardware_concurrency(Threads));
+        llvm::heavyweight_hardware_concurrency(Threads),
+        ThinLTOMemoryBudget << 20);
   // Track whether we hit an error; in particular, in the multi-threaded case,
   // we can't exit() early because the rest of the threads wouldn't have had a
   // change to be join-ed, and that would result in a "terminate called without
@@ -383,6 +416,13 @@ static int run(int argc, char **argv) {
   if (!CacheDir.empty())
     Cache = check(localCache("ThinLTO", "Thin", CacheDir, AddBuffer),
                   "failed to create cache");
+  if (Remote)
+    Cache = tieredCache(std::move(Cache), Remote, [](Error E) {
+      static std::mutex ReportMutex;
+      std::lock_guard<std::mutex> Lock(ReportMutex);
+      logAllUnhandledErrors(std::move(E), llvm::errs(),
+                            "warning: remote cache: ");
+    });
 
   check(Lto.run(AddStream, Cache), "LTO::run failed");
   return static_cast<int>(HasErrors);
@@ -111,6 +111,12 @@ public:
   void addInstruction(const llvm::MCInst &Instruction);
   llvm::SourceMgr &getSourceMgr() const { return SM; }
 
+  /// Report an error in the input at \p Loc, which makes the regions invalid.
+  void reportError(llvm::SMLoc Loc, const llvm::Twine &Msg) {
+    SM.PrintMessage(Loc, llvm::SourceMgr::DK_Error, Msg);
+    FoundErrors = true;
+  }
+
   llvm::ArrayRef<llvm::MCInst> getInstructionSequence(unsigned Idx) const {
     return Regions[Idx]->getInstructions();
   }
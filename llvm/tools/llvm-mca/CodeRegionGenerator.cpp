@@ -15,11 +15,14 @@
 
 #include "CodeRegionGenerator.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/MC/MCDisassembler/MCDisassembler.h"
 #include "llvm/MC/MCParser/MCAsmLexer.h"
 #include "llvm/MC/MCParser/MCTargetAsmParser.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCTargetOptions.h"
+#include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/SMLoc.h"
 #include <memory>
@@ -147,5 +150,112 @@ Expected<const CodeRegions &> AsmCodeRegionGenerator::parseCodeRegions(
   return Regions;
 }
 
+Expected<const CodeRegions &> BinaryCodeRegionGenerator::parseCodeRegions(
+    const std::unique_ptr<MCInstPrinter> & /* unused */) {
+  Expected<std::unique_ptr<object::ObjectFile>> ObjOrErr =
+      object::ObjectFile::createObjectFile(Binary);
+  if (!ObjOrErr)
+    return ObjOrErr.takeError();
+
+  std::unique_ptr<MCDisassembler> DisAsm(
+      TheTarget.createMCDisassembler(STI, Ctx));
+  if (!DisAsm)
+    return make_error<StringError>(
+        "This target does not support disassembly.",
+        inconvertibleErrorCode());
+
+  struct TextSection {
+    StringRef Name;
+    uint64_t Address;
+    ArrayRef<uint8_t> Contents;
+  };
+  SmallVector<TextSection, 4> Sections;
+  for (const object::SectionRef &Section : (*ObjOrErr)->sections()) {
+    if (!Section.isText())
+      continue;
+    Expected<StringRef> Name = Section.getName();
+    if (!Name)
+      return Name.takeError();
+    Expected<StringRef> Contents = Section.getContents();
+    if (!Contents)
+      return Contents.takeError();
+    Sections.push_back(
+        {*Name, Section.getAddress(), arrayRefFromStringRef(*Contents)});
+  }
+
+  llvm::SourceMgr &SM = Regions.getSourceMgr();
+  SmallVector<StringRef, 64> Lines;
+  SM.getMemoryBuffer(SM.getMainFileID())->getBuffer().split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    Line = Line.trim();
+    if (Line.empty() || Line.startswith("#"))
+      continue;
+
+    // The section name is optional, and starts with something else than a
+    // digit.
+    SMLoc Loc = SMLoc::getFromPointer(Line.data());
+    StringRef SectionName, StartStr, EndStr, Rest;
+    std::tie(StartStr, Rest) = getToken(Line);
+    if (!isDigit(StartStr.front())) {
+      SectionName = StartStr;
+      std::tie(StartStr, Rest) = getToken(Rest);
+    }
+    std::tie(EndStr, Rest) = getToken(Rest);
+    uint64_t Start, End;
+    if (StartStr.getAsInteger(0, Start) || EndStr.getAsInteger(0, End) ||
+        End <= Start) {
+      Regions.reportError(
+          Loc, "expected a '[<section>] <start> <end>' address range");
+      continue;
+    }
+
+    // The sections of relocatable objects all start at address 0, so a range
+    // without a section name must be in a single one.
+    const TextSection *Section = nullptr;
+    bool Ambiguous = false;
+    for (const TextSection &S : Sections) {
+      if ((!SectionName.empty() && S.Name != SectionName) ||
+          Start < S.Address || S.Address + S.Contents.size() < End)
+        continue;
+      Ambiguous |= Section != nullptr;
+      Section = &S;
+    }
+    if (!Section) {
+      Regions.reportError(Loc, SectionName.empty()
+                                   ? "address range is not in a text section"
+                                   : "address range is not in text section '" +
+                                         SectionName + "'");
+      continue;
+    }
+    if (Ambiguous) {
+      Regions.reportError(Loc, "address range is in more than one text "
+                               "section, name the section to use");
+      continue;
+    }
+
+    // Every instruction of the region gets the location of its line, which
+    // is in the range of that region only.
+    Regions.beginRegion(Line, Loc);
+    ArrayRef<uint8_t> Bytes =
+        Section->Contents.slice(Start - Section->Address, End - Start);
+    for (uint64_t Offset = 0; Offset < Bytes.size();) {
+      MCInst Inst;
+      uint64_t Size;
+      if (DisAsm->getInstruction(Inst, Size, Bytes.slice(Offset),
+                                 Start + Offset,
+                                 nulls()) != MCDisassembler::Success) {
+        Regions.reportError(Loc, "unable to disassemble the instruction at 0x" +
+                                     Twine::utohexstr(Start + Offset));
+        break;
+      }
+      Inst.setLoc(Loc);
+      Regions.addInstruction(Inst);
+      Offset += Size;
+    }
+    Regions.endRegion(Line, SMLoc::getFromPointer(Line.end()));
+  }
+  return Regions;
+}
+
 } // namespace mca
 } // namespace llvm
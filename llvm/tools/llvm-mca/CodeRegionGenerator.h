@@ -22,6 +22,7 @@
 #include "llvm/MC/MCSubtargetInfo.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBufferRef.h"
 #include "llvm/Support/SourceMgr.h"
 #include <memory>
 
@@ -41,6 +42,10 @@ public:
   virtual ~CodeRegionGenerator();
   virtual Expected<const CodeRegions &>
   parseCodeRegions(const std::unique_ptr<MCInstPrinter> &IP) = 0;
+
+  /// The assembler dialect of the input, which llvm-mca uses by default to
+  /// print reports.
+  virtual unsigned getAssemblerDialect() const { return 0; }
 };
 
 /// This class is responsible for parsing input ASM and generating
@@ -60,7 +65,34 @@ public:
       : CodeRegionGenerator(SM), TheTarget(T), Ctx(C), MAI(A), STI(S), MCII(I),
         AssemblerDialect(0) {}
 
-  unsigned getAssemblerDialect() const { return AssemblerDialect; }
+  unsigned getAssemblerDialect() const override { return AssemblerDialect; }
+  Expected<const CodeRegions &>
+  parseCodeRegions(const std::unique_ptr<MCInstPrinter> &IP) override;
+};
+
+/// This class is responsible for disassembling address ranges of an object
+/// file, and generating a CodeRegions instance with one region per range.
+///
+/// The ranges are read from the main buffer of the source manager, one
+/// "[<section>] <start> <end>" range of addresses per line, with the end
+/// excluded. The section must be named if the range could be in more than one
+/// text section, as in relocatable objects, whose sections all start at 0.
+/// Blank lines and lines that start with '#' are ignored. Anything after the
+/// range is kept in the description of the region, along with the addresses;
+/// this is where tools that extract the hot blocks of a profile can put counts.
+class BinaryCodeRegionGenerator final : public CodeRegionGenerator {
+  const Target &TheTarget;
+  MCContext &Ctx;
+  const MCSubtargetInfo &STI;
+  MemoryBufferRef Binary;
+
+public:
+  BinaryCodeRegionGenerator(const Target &T, llvm::SourceMgr &SM,
+                            MCContext &C, const MCSubtargetInfo &S,
+                            MemoryBufferRef Binary)
+      : CodeRegionGenerator(SM), TheTarget(T), Ctx(C), STI(S), Binary(Binary) {
+  }
+
   Expected<const CodeRegions &>
   parseCodeRegions(const std::unique_ptr<MCInstPrinter> &IP) override;
 };
@@ -103,7 +103,9 @@ json::Object PipelinePrinter::getJSONTargetInfo() const {
 }
 
 void PipelinePrinter::printReport(json::Object &JO) const {
-  if (!RegionIdx) {
+  // Regions may be reported into separate objects that are merged later, so
+  // set up the first report of each object rather than that of region 0.
+  if (!JO.getArray("CodeRegions")) {
     JO.try_emplace("TargetInfo", getJSONTargetInfo());
     JO.try_emplace("SimulationParameters", getJSONSimulationParameters());
     // Construct an array of regions.
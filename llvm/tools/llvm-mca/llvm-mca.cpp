@@ -58,8 +58,11 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
+#include <atomic>
 
 using namespace llvm;
 
@@ -109,6 +112,21 @@ static cl::opt<bool>
     PrintImmHex("print-imm-hex", cl::cat(ToolOptions), cl::init(false),
                 cl::desc("Prefer hex format when printing immediate values"));
 
+static cl::opt<std::string> InputRanges(
+    "input-ranges",
+    cl::desc("Treat the input file as an object file, and analyze the address "
+             "ranges listed in this file, one '[<section>] <start> <end>' "
+             "range per line, as one region each"),
+    cl::value_desc("filename"), cl::cat(ToolOptions));
+
+static cl::opt<unsigned>
+    NumThreads("num-threads",
+               cl::desc("Number of threads to analyze the code regions with, "
+                        "or 0 to use all the available hardware threads"),
+               cl::cat(ToolOptions), cl::init(1));
+static cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                             cl::aliasopt(NumThreads), cl::cat(ToolOptions));
+
 static cl::opt<unsigned> Iterations("iterations",
                                     cl::desc("Number of iterations to run"),
                                     cl::cat(ToolOptions), cl::init(0));
@@ -313,6 +331,7 @@ int main(int argc, char **argv) {
   InitializeAllTargetInfos();
   InitializeAllTargetMCs();
   InitializeAllAsmParsers();
+  InitializeAllDisassemblers();
   InitializeAllTargetMCAs();
 
   // Enable printing of available targets when flag --version is specified.
@@ -379,6 +398,18 @@ int main(int argc, char **argv) {
 
   SourceMgr SrcMgr;
 
+  // With a list of address ranges, the input is the object file to
+  // disassemble them from, and the ranges are what the parser picks up.
+  std::unique_ptr<MemoryBuffer> Binary;
+  if (!InputRanges.empty()) {
+    Binary = std::move(*BufferPtr);
+    BufferPtr = MemoryBuffer::getFileOrSTDIN(InputRanges);
+    if (std::error_code EC = BufferPtr.getError()) {
+      WithColor::error() << InputRanges << ": " << EC.message() << '\n';
+      return 1;
+    }
+  }
+
   // Tell SrcMgr about this buffer, which is what the parser will pick up.
   SrcMgr.AddNewSourceBuffer(std::move(*BufferPtr), SMLoc());
 
@@ -392,9 +423,6 @@ int main(int argc, char **argv) {
   std::unique_ptr<MCInstrInfo> MCII(TheTarget->createMCInstrInfo());
   assert(MCII && "Unable to create instruction info!");
 
-  std::unique_ptr<MCInstrAnalysis> MCIA(
-      TheTarget->createMCInstrAnalysis(MCII.get()));
-
   // Need to initialize an MCInstPrinter as it is
   // required for initializing the MCTargetStreamer
   // which needs to happen within the CRG.parseCodeRegions() call below.
@@ -414,9 +442,15 @@ int main(int argc, char **argv) {
   }
 
   // Parse the input and create CodeRegions that llvm-mca can analyze.
-  mca::AsmCodeRegionGenerator CRG(*TheTarget, SrcMgr, Ctx, *MAI, *STI, *MCII);
+  std::unique_ptr<mca::CodeRegionGenerator> CRG;
+  if (Binary)
+    CRG = std::make_unique<mca::BinaryCodeRegionGenerator>(
+        *TheTarget, SrcMgr, Ctx, *STI, Binary->getMemBufferRef());
+  else
+    CRG = std::make_unique<mca::AsmCodeRegionGenerator>(*TheTarget, SrcMgr,
+                                                        Ctx, *MAI, *STI, *MCII);
   Expected<const mca::CodeRegions &> RegionsOrErr =
-      CRG.parseCodeRegions(std::move(IPtemp));
+      CRG->parseCodeRegions(std::move(IPtemp));
   if (!RegionsOrErr) {
     if (auto Err =
             handleErrors(RegionsOrErr.takeError(), [](const StringError &E) {
@@ -445,12 +479,18 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  unsigned AssemblerDialect = CRG.getAssemblerDialect();
+  unsigned AssemblerDialect = CRG->getAssemblerDialect();
   if (OutputAsmVariant >= 0)
     AssemblerDialect = static_cast<unsigned>(OutputAsmVariant);
-  std::unique_ptr<MCInstPrinter> IP(TheTarget->createMCInstPrinter(
-      Triple(TripleName), AssemblerDialect, *MAI, *MCII, *MRI));
-  if (!IP) {
+  auto CreateInstPrinter = [&]() {
+    std::unique_ptr<MCInstPrinter> IP(TheTarget->createMCInstPrinter(
+        Triple(TripleName), AssemblerDialect, *MAI, *MCII, *MRI));
+    // Set the display preference for hex vs. decimal immediates.
+    if (IP)
+      IP->setPrintImmHex(PrintImmHex);
+    return IP;
+  };
+  if (!CreateInstPrinter()) {
     WithColor::error()
         << "unable to create instruction printer for target triple '"
         << TheTriple.normalize() << "' with assembly variant "
@@ -458,59 +498,62 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  // Set the display preference for hex vs. decimal immediates.
-  IP->setPrintImmHex(PrintImmHex);
-
   std::unique_ptr<ToolOutputFile> TOF = std::move(*OF);
 
   const MCSchedModel &SM = STI->getSchedModel();
 
-  std::unique_ptr<mca::InstrPostProcess> IPP;
-  if (!DisableCustomBehaviour) {
-    // TODO: It may be a good idea to separate CB and IPP so that they can
-    // be used independently of each other. What I mean by this is to add
-    // an extra command-line arg --disable-ipp so that CB and IPP can be
-    // toggled without needing to toggle both of them together.
-    IPP = std::unique_ptr<mca::InstrPostProcess>(
-        TheTarget->createInstrPostProcess(*STI, *MCII));
-  }
-  if (!IPP) {
-    // If the target doesn't have its own IPP implemented (or the -disable-cb
-    // flag is set) then we use the base class (which does nothing).
-    IPP = std::make_unique<mca::InstrPostProcess>(*STI, *MCII);
-  }
-
-  // Create an instruction builder.
-  mca::InstrBuilder IB(*STI, *MCII, *MRI, MCIA.get());
-
-  // Create a context to control ownership of the pipeline hardware.
-  mca::Context MCA(*MRI, *STI);
-
   mca::PipelineOptions PO(MicroOpQueue, DecoderThroughput, DispatchWidth,
                           RegisterFileSize, LoadQueueSize, StoreQueueSize,
                           AssumeNoAlias, EnableBottleneckAnalysis);
 
-  // Number each region in the sequence.
-  unsigned RegionIdx = 0;
+  // Analyze a region and print its report to OS, or add it to JSONOutput.
+  // Everything that holds state about the analysis is created here, so that
+  // regions can be analyzed concurrently.
+  auto AnalyzeRegion = [&](const mca::CodeRegion &Region, unsigned RegionIdx,
+                           raw_ostream &OS, json::Object &JSONOutput) {
+    std::unique_ptr<MCInstPrinter> IP = CreateInstPrinter();
 
-  std::unique_ptr<MCCodeEmitter> MCE(
-      TheTarget->createMCCodeEmitter(*MCII, Ctx));
-  assert(MCE && "Unable to create code emitter!");
+    std::unique_ptr<mca::InstrPostProcess> IPP;
+    if (!DisableCustomBehaviour) {
+      // TODO: It may be a good idea to separate CB and IPP so that they can
+      // be used independently of each other. What I mean by this is to add
+      // an extra command-line arg --disable-ipp so that CB and IPP can be
+      // toggled without needing to toggle both of them together.
+      IPP = std::unique_ptr<mca::InstrPostProcess>(
+          TheTarget->createInstrPostProcess(*STI, *MCII));
+    }
+    if (!IPP) {
+      // If the target doesn't have its own IPP implemented (or the -disable-cb
+      // flag is set) then we use the base class (which does nothing).
+      IPP = std::make_unique<mca::InstrPostProcess>(*STI, *MCII);
+    }
 
-  std::unique_ptr<MCAsmBackend> MAB(TheTarget->createMCAsmBackend(
-      *STI, *MRI, mc::InitMCTargetOptionsFromFlags()));
-  assert(MAB && "Unable to create asm backend!");
+    // The code emitter creates symbols and fixups in its MCContext, and the
+    // instruction analysis of some targets keeps state, so each analysis has
+    // its own.
+    MCContext RegionCtx(TheTriple, MAI.get(), MRI.get(), STI.get(), &SrcMgr);
+    std::unique_ptr<MCObjectFileInfo> RegionMOFI(
+        TheTarget->createMCObjectFileInfo(RegionCtx, /*PIC=*/false));
+    RegionCtx.setObjectFileInfo(RegionMOFI.get());
+    std::unique_ptr<MCInstrAnalysis> RegionMCIA(
+        TheTarget->createMCInstrAnalysis(MCII.get()));
 
-  json::Object JSONOutput;
-  for (const std::unique_ptr<mca::CodeRegion> &Region : Regions) {
-    // Skip empty code regions.
-    if (Region->empty())
-      continue;
+    // Create an instruction builder.
+    mca::InstrBuilder IB(*STI, *MCII, *MRI, RegionMCIA.get());
+
+    // Create a context to control ownership of the pipeline hardware.
+    mca::Context MCA(*MRI, *STI);
 
-    IB.clear();
+    std::unique_ptr<MCCodeEmitter> MCE(
+        TheTarget->createMCCodeEmitter(*MCII, RegionCtx));
+    assert(MCE && "Unable to create code emitter!");
+
+    std::unique_ptr<MCAsmBackend> MAB(TheTarget->createMCAsmBackend(
+        *STI, *MRI, mc::InitMCTargetOptionsFromFlags()));
+    assert(MAB && "Unable to create asm backend!");
 
     // Lower the MCInst sequence into an mca::Instruction sequence.
-    ArrayRef<MCInst> Insts = Region->getInstructions();
+    ArrayRef<MCInst> Insts = Region.getInstructions();
     mca::CodeEmitter CE(*STI, *MAB, *MCE, Insts);
 
     IPP->resetState();
@@ -534,7 +577,7 @@ int main(int argc, char **argv) {
           // Default case.
           WithColor::error() << toString(std::move(NewE));
         }
-        return 1;
+        return false;
       }
 
       IPP->postProcessInstruction(Inst.get(), MCI);
@@ -550,7 +593,7 @@ int main(int argc, char **argv) {
       P->appendStage(std::make_unique<mca::EntryStage>(S));
       P->appendStage(std::make_unique<mca::InstructionTables>(SM));
 
-      mca::PipelinePrinter Printer(*P, *Region, RegionIdx, *STI, PO);
+      mca::PipelinePrinter Printer(*P, Region, RegionIdx, *STI, PO);
       if (PrintJson) {
         Printer.addView(
             std::make_unique<mca::InstructionView>(*STI, *IP, Insts));
@@ -566,16 +609,15 @@ int main(int argc, char **argv) {
           std::make_unique<mca::ResourcePressureView>(*STI, *IP, Insts));
 
       if (!runPipeline(*P))
-        return 1;
+        return false;
 
       if (PrintJson) {
         Printer.printReport(JSONOutput);
       } else {
-        Printer.printReport(TOF->os());
+        Printer.printReport(OS);
       }
 
-      ++RegionIdx;
-      continue;
+      return true;
     }
 
     // Create the CustomBehaviour object for enforcing Target Specific
@@ -596,7 +638,7 @@ int main(int argc, char **argv) {
     // Create a basic pipeline simulating an out-of-order backend.
     auto P = MCA.createDefaultPipeline(PO, S, *CB);
 
-    mca::PipelinePrinter Printer(*P, *Region, RegionIdx, *STI, PO);
+    mca::PipelinePrinter Printer(*P, Region, RegionIdx, *STI, PO);
 
     // Targets can define their own custom Views that exist within their
     // /lib/Target/ directory so that the View can utilize their CustomBehaviour
@@ -684,15 +726,56 @@ int main(int argc, char **argv) {
     }
 
     if (!runPipeline(*P))
-      return 1;
+      return false;
 
     if (PrintJson) {
       Printer.printReport(JSONOutput);
     } else {
-      Printer.printReport(TOF->os());
+      Printer.printReport(OS);
     }
 
-    ++RegionIdx;
+    return true;
+  };
+
+  // Number each region in the sequence.
+  std::vector<const mca::CodeRegion *> NonEmptyRegions;
+  for (const std::unique_ptr<mca::CodeRegion> &Region : Regions)
+    if (!Region->empty())
+      NonEmptyRegions.push_back(Region.get());
+
+  json::Object JSONOutput;
+  if (NumThreads == 1) {
+    for (unsigned I = 0, E = NonEmptyRegions.size(); I != E; ++I)
+      if (!AnalyzeRegion(*NonEmptyRegions[I], I, TOF->os(), JSONOutput))
+        return 1;
+  } else {
+    // Analyze each region into a report of its own, then print the reports
+    // in order.
+    std::vector<std::string> Reports(NonEmptyRegions.size());
+    std::vector<json::Object> JSONReports(NonEmptyRegions.size());
+    std::atomic<bool> Failed(false);
+    ThreadPool Pool(hardware_concurrency(NumThreads));
+    for (unsigned I = 0, E = NonEmptyRegions.size(); I != E; ++I)
+      Pool.async([&, I]() {
+        raw_string_ostream OS(Reports[I]);
+        if (!AnalyzeRegion(*NonEmptyRegions[I], I, OS, JSONReports[I]))
+          Failed = true;
+      });
+    Pool.wait();
+    if (Failed)
+      return 1;
+
+    for (unsigned I = 0, E = NonEmptyRegions.size(); I != E; ++I) {
+      if (!PrintJson) {
+        TOF->os() << Reports[I];
+      } else if (I == 0) {
+        JSONOutput = std::move(JSONReports[I]);
+      } else {
+        json::Array &CodeRegions = *JSONOutput.getArray("CodeRegions");
+        for (json::Value &Report : *JSONReports[I].getArray("CodeRegions"))
+          CodeRegions.push_back(std::move(Report));
+      }
+    }
   }
 
   if (PrintJson)
@@ -36,6 +36,7 @@
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/WithColor.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <queue>
@@ -237,6 +238,28 @@ static void overlapInput(const std::string &BaseFilename,
   }
 }
 
+/// Add \p I to the writer of \p WC, warning about the first error in the
+/// record.
+static void addRecordToContext(NamedInstrProfRecord &&I, uint64_t Weight,
+                               const std::string &Filename,
+                               WriterContext *WC) {
+  const StringRef FuncName = I.Name;
+  bool Reported = false;
+  WC->Writer.addRecord(std::move(I), Weight, [&](Error E) {
+    if (Reported) {
+      consumeError(std::move(E));
+      return;
+    }
+    Reported = true;
+    // Only show hint the first time an error occurs.
+    instrprof_error IPE = InstrProfError::take(std::move(E));
+    std::unique_lock<std::mutex> ErrGuard{WC->ErrLock};
+    bool firstTime = WC->WriterErrorCodes.insert(IPE).second;
+    handleMergeWriterError(make_error<InstrProfError>(IPE), Filename, FuncName,
+                           firstTime);
+  });
+}
+
 /// Load an input into a writer context.
 static void loadInput(const WeightedFile &Input, SymbolRemapper *Remapper,
                       const InstrProfCorrelator *Correlator,
@@ -313,21 +336,7 @@ static void loadInput(const WeightedFile &Input, SymbolRemapper *Remapper,
   for (auto &I : *Reader) {
     if (Remapper)
       I.Name = (*Remapper)(I.Name);
-    const StringRef FuncName = I.Name;
-    bool Reported = false;
-    WC->Writer.addRecord(std::move(I), Input.Weight, [&](Error E) {
-      if (Reported) {
-        consumeError(std::move(E));
-        return;
-      }
-      Reported = true;
-      // Only show hint the first time an error occurs.
-      instrprof_error IPE = InstrProfError::take(std::move(E));
-      std::unique_lock<std::mutex> ErrGuard{WC->ErrLock};
-      bool firstTime = WC->WriterErrorCodes.insert(IPE).second;
-      handleMergeWriterError(make_error<InstrProfError>(IPE), Input.Filename,
-                             FuncName, firstTime);
-    });
+    addRecordToContext(std::move(I), Input.Weight, Filename, WC);
   }
   if (Reader->hasError())
     if (Error E = Reader->getError())
@@ -349,6 +358,118 @@ static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
   });
 }
 
+/// Load an input, adding each record to the shard its function name hashes
+/// to. As the shards hold disjoint sets of functions, they never have to be
+/// merged record by record.
+static void loadInputIntoShards(
+    const WeightedFile &Input, SymbolRemapper *Remapper,
+    const InstrProfCorrelator *Correlator, const StringRef ProfiledBinary,
+    ArrayRef<std::unique_ptr<WriterContext>> Shards) {
+  // The first shard tracks the kind of the whole profile and collects the
+  // errors of all inputs.
+  WriterContext *First = Shards.front().get();
+
+  // MemProf profiles are not sharded.
+  if (memprof::RawMemProfReader::hasFormat(Input.Filename))
+    return loadInput(Input, Remapper, Correlator, ProfiledBinary, First);
+
+  std::string Filename = Input.Filename;
+  auto ReaderOrErr = InstrProfReader::create(Filename, Correlator);
+  if (Error E = ReaderOrErr.takeError()) {
+    // Skip the empty profiles by returning sliently.
+    instrprof_error IPE = InstrProfError::take(std::move(E));
+    if (IPE != instrprof_error::empty_raw_profile) {
+      std::unique_lock<std::mutex> CtxGuard{First->Lock};
+      First->Errors.emplace_back(make_error<InstrProfError>(IPE), Filename);
+    }
+    return;
+  }
+
+  auto Reader = std::move(ReaderOrErr.get());
+  {
+    std::unique_lock<std::mutex> CtxGuard{First->Lock};
+    if (Error E = First->Writer.mergeProfileKind(Reader->getProfileKind())) {
+      consumeError(std::move(E));
+      First->Errors.emplace_back(
+          make_error<StringError>(
+              "Merge IR generated profile with Clang generated profile.",
+              std::error_code()),
+          Filename);
+      return;
+    }
+  }
+
+  // Bucket the records first, so that each shard is locked once per input.
+  std::vector<std::vector<NamedInstrProfRecord>> Buckets(Shards.size());
+  for (auto &I : *Reader) {
+    if (Remapper)
+      I.Name = (*Remapper)(I.Name);
+    Buckets[xxHash64(I.Name) % Shards.size()].push_back(std::move(I));
+  }
+  if (Reader->hasError())
+    if (Error E = Reader->getError()) {
+      std::unique_lock<std::mutex> CtxGuard{First->Lock};
+      First->Errors.emplace_back(std::move(E), Filename);
+    }
+
+  for (size_t I = 0, E = Shards.size(); I != E; ++I) {
+    if (Buckets[I].empty())
+      continue;
+    WriterContext *WC = Shards[I].get();
+    std::unique_lock<std::mutex> CtxGuard{WC->Lock};
+    for (auto &Record : Buckets[I])
+      addRecordToContext(std::move(Record), Input.Weight, Filename, WC);
+  }
+}
+
+/// Load the inputs into \p NumShards writer contexts by function name hash
+/// with \p NumThreads threads, and return the number of input files. The
+/// files in directory inputs are loaded as the directories are walked.
+static size_t loadInputsIntoShards(
+    const WeightedFileVector &Inputs, SymbolRemapper *Remapper,
+    const InstrProfCorrelator *Correlator, const StringRef ProfiledBinary,
+    unsigned NumThreads, unsigned NumShards, bool OutputSparse,
+    std::mutex &ErrorLock, SmallSet<instrprof_error, 4> &WriterErrorCodes,
+    SmallVectorImpl<std::unique_ptr<WriterContext>> &Shards) {
+  for (unsigned I = 0; I < NumShards; ++I)
+    Shards.emplace_back(std::make_unique<WriterContext>(
+        OutputSparse, ErrorLock, WriterErrorCodes));
+
+  // Directories may hold many files: keep all threads busy.
+  if (NumThreads == 0)
+    NumThreads = hardware_concurrency().compute_thread_count();
+
+  size_t NumFiles = 0;
+  ThreadPool Pool(hardware_concurrency(NumThreads));
+  auto LoadFile = [&](const WeightedFile &Input) {
+    ++NumFiles;
+    Pool.async(loadInputIntoShards, Input, Remapper, Correlator,
+               ProfiledBinary,
+               ArrayRef<std::unique_ptr<WriterContext>>(Shards));
+  };
+
+  for (const auto &Input : Inputs) {
+    if (Input.Filename == "-" || !sys::fs::is_directory(Input.Filename)) {
+      LoadFile(Input);
+      continue;
+    }
+    std::error_code EC;
+    for (sys::fs::recursive_directory_iterator F(Input.Filename, EC), E;
+         F != E && !EC; F.increment(EC))
+      if (sys::fs::is_regular_file(F->path()))
+        LoadFile({F->path(), Input.Weight});
+    if (EC)
+      exitWithErrorCode(EC, Input.Filename);
+  }
+  Pool.wait();
+
+  // Gather the shards into the first one. Each function is in one shard only,
+  // so this only moves the records.
+  for (unsigned I = 1; I < NumShards; ++I)
+    mergeWriterContexts(Shards[0].get(), Shards[I].get());
+  return NumFiles;
+}
+
 static void writeInstrProfile(StringRef OutputFilename,
                               ProfileFormat OutputFormat,
                               InstrProfWriter &Writer) {
@@ -375,7 +496,8 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
                               SymbolRemapper *Remapper,
                               StringRef OutputFilename,
                               ProfileFormat OutputFormat, bool OutputSparse,
-                              unsigned NumThreads, FailureMode FailMode,
+                              unsigned NumThreads, unsigned NumShards,
+                              FailureMode FailMode,
                               const StringRef ProfiledBinary) {
   if (OutputFormat != PF_Binary && OutputFormat != PF_Compact_Binary &&
       OutputFormat != PF_Ext_Binary && OutputFormat != PF_Text)
@@ -392,54 +514,63 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
 
   std::mutex ErrorLock;
   SmallSet<instrprof_error, 4> WriterErrorCodes;
-
-  // If NumThreads is not specified, auto-detect a good default.
-  if (NumThreads == 0)
-    NumThreads = std::min(hardware_concurrency().compute_thread_count(),
-                          unsigned((Inputs.size() + 1) / 2));
-  // FIXME: There's a bug here, where setting NumThreads = Inputs.size() fails
-  // the merge_empty_profile.test because the InstrProfWriter.ProfileKind isn't
-  // merged, thus the emitted file ends up with a PF_Unknown kind.
-
-  // Initialize the writer contexts.
   SmallVector<std::unique_ptr<WriterContext>, 4> Contexts;
-  for (unsigned I = 0; I < NumThreads; ++I)
-    Contexts.emplace_back(std::make_unique<WriterContext>(
-        OutputSparse, ErrorLock, WriterErrorCodes));
+  size_t NumInputs = Inputs.size();
 
-  if (NumThreads == 1) {
-    for (const auto &Input : Inputs)
-      loadInput(Input, Remapper, Correlator.get(), ProfiledBinary,
-                Contexts[0].get());
+  if (NumShards > 0) {
+    NumInputs = loadInputsIntoShards(Inputs, Remapper, Correlator.get(),
+                                     ProfiledBinary, NumThreads, NumShards,
+                                     OutputSparse, ErrorLock, WriterErrorCodes,
+                                     Contexts);
   } else {
-    ThreadPool Pool(hardware_concurrency(NumThreads));
-
-    // Load the inputs in parallel (N/NumThreads serial steps).
-    unsigned Ctx = 0;
-    for (const auto &Input : Inputs) {
-      Pool.async(loadInput, Input, Remapper, Correlator.get(), ProfiledBinary,
-                 Contexts[Ctx].get());
-      Ctx = (Ctx + 1) % NumThreads;
-    }
-    Pool.wait();
-
-    // Merge the writer contexts together (~ lg(NumThreads) serial steps).
-    unsigned Mid = Contexts.size() / 2;
-    unsigned End = Contexts.size();
-    assert(Mid > 0 && "Expected more than one context");
-    do {
-      for (unsigned I = 0; I < Mid; ++I)
-        Pool.async(mergeWriterContexts, Contexts[I].get(),
-                   Contexts[I + Mid].get());
+    // If NumThreads is not specified, auto-detect a good default.
+    if (NumThreads == 0)
+      NumThreads = std::min(hardware_concurrency().compute_thread_count(),
+                            unsigned((Inputs.size() + 1) / 2));
+    // FIXME: There's a bug here, where setting NumThreads = Inputs.size()
+    // fails the merge_empty_profile.test because the
+    // InstrProfWriter.ProfileKind isn't merged, thus the emitted file ends up
+    // with a PF_Unknown kind.
+
+    // Initialize the writer contexts.
+    for (unsigned I = 0; I < NumThreads; ++I)
+      Contexts.emplace_back(std::make_unique<WriterContext>(
+          OutputSparse, ErrorLock, WriterErrorCodes));
+
+    if (NumThreads == 1) {
+      for (const auto &Input : Inputs)
+        loadInput(Input, Remapper, Correlator.get(), ProfiledBinary,
+                  Contexts[0].get());
+    } else {
+      ThreadPool Pool(hardware_concurrency(NumThreads));
+
+      // Load the inputs in parallel (N/NumThreads serial steps).
+      unsigned Ctx = 0;
+      for (const auto &Input : Inputs) {
+        Pool.async(loadInput, Input, Remapper, Correlator.get(), ProfiledBinary,
+                   Contexts[Ctx].get());
+        Ctx = (Ctx + 1) % NumThreads;
+      }
       Pool.wait();
-      if (End & 1) {
-        Pool.async(mergeWriterContexts, Contexts[0].get(),
-                   Contexts[End - 1].get());
+
+      // Merge the writer contexts together (~ lg(NumThreads) serial steps).
+      unsigned Mid = Contexts.size() / 2;
+      unsigned End = Contexts.size();
+      assert(Mid > 0 && "Expected more than one context");
+      do {
+        for (unsigned I = 0; I < Mid; ++I)
+          Pool.async(mergeWriterContexts, Contexts[I].get(),
+                     Contexts[I + Mid].get());
         Pool.wait();
-      }
-      End = Mid;
-      Mid /= 2;
-    } while (Mid > 0);
+        if (End & 1) {
+          Pool.async(mergeWriterContexts, Contexts[0].get(),
+                     Contexts[End - 1].get());
+          Pool.wait();
+        }
+        End = Mid;
+        Mid /= 2;
+      } while (Mid > 0);
+    }
   }
 
   // Handle deferred errors encountered during merging. If the number of errors
@@ -451,7 +582,7 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
       warn(toString(std::move(ErrorPair.first)), ErrorPair.second);
     }
   }
-  if (NumErrors == Inputs.size() ||
+  if (NumErrors == NumInputs ||
       (NumErrors > 0 && FailMode == failIfAnyAreInvalid))
     exitWithError("no profile can be merged");
 
@@ -854,7 +985,10 @@ static WeightedFile parseWeightedFile(const StringRef &WeightedFilename) {
   return {std::string(FileName), Weight};
 }
 
-static void addWeightedInput(WeightedFileVector &WNI, const WeightedFile &WF) {
+/// Add \p WF to \p WNI. Directories are expanded to the files they hold unless
+/// \p ExpandDirectories is false, in which case they are walked when merging.
+static void addWeightedInput(WeightedFileVector &WNI, const WeightedFile &WF,
+                             bool ExpandDirectories = true) {
   StringRef Filename = WF.Filename;
   uint64_t Weight = WF.Weight;
 
@@ -876,6 +1010,10 @@ static void addWeightedInput(WeightedFileVector &WNI, const WeightedFile &WF) {
   }
 
   if (llvm::sys::fs::is_directory(Status)) {
+    if (!ExpandDirectories) {
+      WNI.push_back({std::string(Filename), Weight});
+      return;
+    }
     std::error_code EC;
     for (llvm::sys::fs::recursive_directory_iterator F(Filename, EC), E;
          F != E && !EC; F.increment(EC)) {
@@ -889,7 +1027,8 @@ static void addWeightedInput(WeightedFileVector &WNI, const WeightedFile &WF) {
 }
 
 static void parseInputFilenamesFile(MemoryBuffer *Buffer,
-                                    WeightedFileVector &WFV) {
+                                    WeightedFileVector &WFV,
+                                    bool ExpandDirectories) {
   if (!Buffer)
     return;
 
@@ -903,9 +1042,11 @@ static void parseInputFilenamesFile(MemoryBuffer *Buffer,
       continue;
     // If there's no comma, it's an unweighted profile.
     else if (!SanitizedEntry.contains(','))
-      addWeightedInput(WFV, {std::string(SanitizedEntry), 1});
+      addWeightedInput(WFV, {std::string(SanitizedEntry), 1},
+                       ExpandDirectories);
     else
-      addWeightedInput(WFV, parseWeightedFile(SanitizedEntry));
+      addWeightedInput(WFV, parseWeightedFile(SanitizedEntry),
+                       ExpandDirectories);
   }
 }
 
@@ -958,6 +1099,12 @@ static int merge_main(int argc, const char *argv[]) {
       cl::desc("Number of merge threads to use (default: autodetect)"));
   cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
                         cl::aliasopt(NumThreads));
+  cl::opt<unsigned> NumShards(
+      "num-shards", cl::init(0),
+      cl::desc("Merge instrumentation profiles into this many writers, each "
+               "holding the functions whose names hash to it, and walk input "
+               "directories while merging (default: 0, merge one writer per "
+               "thread)"));
   cl::opt<std::string> ProfileSymbolListFile(
       "prof-sym-list", cl::init(""),
       cl::desc("Path to file containing the list of function symbols "
@@ -1019,16 +1166,23 @@ static int merge_main(int argc, const char *argv[]) {
 
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
+  // The sharded merge streams the files of directory inputs, rather than
+  // listing them all first.
+  bool ExpandDirectories = NumShards == 0 || ProfileKind != instr ||
+                           !SupplInstrWithSample.empty() || DumpInputFileList;
+
   WeightedFileVector WeightedInputs;
   for (StringRef Filename : InputFilenames)
-    addWeightedInput(WeightedInputs, {std::string(Filename), 1});
+    addWeightedInput(WeightedInputs, {std::string(Filename), 1},
+                     ExpandDirectories);
   for (StringRef WeightedFilename : WeightedInputFilenames)
-    addWeightedInput(WeightedInputs, parseWeightedFile(WeightedFilename));
+    addWeightedInput(WeightedInputs, parseWeightedFile(WeightedFilename),
+                     ExpandDirectories);
 
   // Make sure that the file buffer stays alive for the duration of the
   // weighted input vector's lifetime.
   auto Buffer = getInputFileBuf(InputFilenamesFile);
-  parseInputFilenamesFile(Buffer.get(), WeightedInputs);
+  parseInputFilenamesFile(Buffer.get(), WeightedInputs, ExpandDirectories);
 
   if (WeightedInputs.empty())
     exitWithError("no input files specified. See " +
@@ -1058,7 +1212,7 @@ static int merge_main(int argc, const char *argv[]) {
   if (ProfileKind == instr)
     mergeInstrProfile(WeightedInputs, DebugInfoFilename, Remapper.get(),
                       OutputFilename, OutputFormat, OutputSparse, NumThreads,
-                      FailureMode, ProfiledBinary);
+                      NumShards, FailureMode, ProfiledBinary);
   else
     mergeSampleProfile(WeightedInputs, Remapper.get(), OutputFilename,
                        OutputFormat, ProfileSymbolListFile, CompressAllSections,
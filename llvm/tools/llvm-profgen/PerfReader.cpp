@@ -10,6 +10,7 @@
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
 
 #define DEBUG_TYPE "perf-reader"
 
@@ -39,6 +40,11 @@ static cl::opt<bool>
     IgnoreStackSamples("ignore-stack-samples", cl::init(false), cl::ZeroOrMore,
                        cl::desc("Ignore call stack samples for hybrid samples "
                                 "and produce context-insensitive profile."));
+static cl::opt<unsigned> NumUnwindThreads(
+    "num-threads", cl::init(0), cl::ZeroOrMore,
+    cl::desc("Number of threads to unwind hybrid samples with pseudo probes "
+             "(0 = auto-detect)"));
+
 cl::opt<bool> ShowDetailedWarning("show-detailed-warning", cl::init(false),
                                   cl::ZeroOrMore,
                                   cl::desc("Show detailed warning message."));
@@ -482,12 +488,69 @@ static std::string getContextKeyStr(ContextKey *K,
 void HybridPerfReader::unwindSamples() {
   if (Binary->useFSDiscriminator())
     exitWithError("FS discriminator is not supported in CS profile.");
-  VirtualUnwinder Unwinder(&SampleCounters, Binary);
-  for (const auto &Item : AggregatedSamples) {
-    const PerfSample *Sample = Item.first.getPtr();
-    Unwinder.unwind(Sample, Item.second);
+
+  // Without pseudo probes, unwinding symbolizes addresses on demand into the
+  // binary's shared caches, so it has to stay on one thread. With probes, the
+  // binary is only read and the samples can be unwound in parallel, each
+  // thread into its own context counter map.
+  unsigned NumShards = 1;
+  if (Binary->usePseudoProbes()) {
+    NumShards = NumUnwindThreads;
+    if (NumShards == 0)
+      NumShards = hardware_concurrency().compute_thread_count();
+    NumShards = std::max<size_t>(
+        1, std::min<size_t>(NumShards, AggregatedSamples.size()));
+  }
+
+  std::vector<std::unique_ptr<VirtualUnwinder>> Unwinders;
+  if (NumShards == 1) {
+    Unwinders.push_back(
+        std::make_unique<VirtualUnwinder>(&SampleCounters, Binary));
+    for (const auto &Item : AggregatedSamples)
+      Unwinders[0]->unwind(Item.first.getPtr(), Item.second);
+  } else {
+    std::vector<std::pair<const PerfSample *, uint64_t>> Samples;
+    Samples.reserve(AggregatedSamples.size());
+    for (const auto &Item : AggregatedSamples)
+      Samples.emplace_back(Item.first.getPtr(), Item.second);
+
+    std::vector<ContextSampleCounterMap> ShardCounters(NumShards);
+    for (unsigned I = 0; I < NumShards; ++I)
+      Unwinders.push_back(
+          std::make_unique<VirtualUnwinder>(&ShardCounters[I], Binary));
+
+    ThreadPool Pool(hardware_concurrency(NumShards));
+    for (unsigned I = 0; I < NumShards; ++I)
+      Pool.async([&, I]() {
+        for (size_t J = I; J < Samples.size(); J += NumShards)
+          Unwinders[I]->unwind(Samples[J].first, Samples[J].second);
+      });
+    Pool.wait();
+
+    // Merge the per-thread counters.
+    for (auto &Shard : ShardCounters) {
+      for (auto &Item : Shard) {
+        auto Ret = SampleCounters.emplace(Item.first, SampleCounter());
+        if (Ret.second) {
+          Ret.first->second = std::move(Item.second);
+          continue;
+        }
+        SampleCounter &SCounter = Ret.first->second;
+        for (const auto &Range : Item.second.RangeCounter)
+          SCounter.recordRangeCount(Range.first.first, Range.first.second,
+                                    Range.second);
+        for (const auto &Branch : Item.second.BranchCounter)
+          SCounter.recordBranchCount(Branch.first.first, Branch.first.second,
+                                     Branch.second);
+      }
+      Shard.clear();
+    }
   }
 
+  VirtualUnwinder &Unwinder = *Unwinders[0];
+  for (unsigned I = 1; I < Unwinders.size(); ++I)
+    Unwinder.mergeStats(*Unwinders[I]);
+
   // Warn about untracked frames due to missing probes.
   if (ShowDetailedWarning) {
     for (auto Address : Unwinder.getUntrackedCallsites())
@@ -12,9 +12,10 @@
 #include "ProfiledBinary.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Regex.h"
 #include <cstdint>
-#include <fstream>
 #include <list>
 #include <map>
 #include <vector>
@@ -25,36 +26,39 @@ using namespace sampleprof;
 namespace llvm {
 namespace sampleprof {
 
-// Stream based trace line iterator
+// Line iterator over a memory-mapped perf trace. Long-running fleet profiles
+// can be many gigabytes, so the input is mapped instead of read line by line
+// through a stream.
 class TraceStream {
-  std::string CurrentLine;
-  std::ifstream Fin;
-  bool IsAtEoF = false;
+  std::unique_ptr<MemoryBuffer> Buffer;
+  line_iterator LineIt;
   uint64_t LineNumber = 0;
 
 public:
-  TraceStream(StringRef Filename) : Fin(Filename.str()) {
-    if (!Fin.good())
+  TraceStream(StringRef Filename) {
+    auto BufOrErr = MemoryBuffer::getFile(Filename, /*IsText=*/true);
+    if (!BufOrErr)
       exitWithError("Error read input perf script file", Filename);
-    advance();
+    Buffer = std::move(*BufOrErr);
+    LineIt = line_iterator(*Buffer, /*SkipBlanks=*/false);
+    if (!isAtEoF())
+      LineNumber++;
   }
 
   StringRef getCurrentLine() {
-    assert(!IsAtEoF && "Line iterator reaches the End-of-File!");
-    return CurrentLine;
+    assert(!isAtEoF() && "Line iterator reaches the End-of-File!");
+    return *LineIt;
   }
 
   uint64_t getLineNumber() { return LineNumber; }
 
-  bool isAtEoF() { return IsAtEoF; }
+  bool isAtEoF() { return LineIt.is_at_eof(); }
 
   // Read the next line
   void advance() {
-    if (!std::getline(Fin, CurrentLine)) {
-      IsAtEoF = true;
-      return;
-    }
-    LineNumber++;
+    ++LineIt;
+    if (!isAtEoF())
+      LineNumber++;
   }
 };
 
@@ -465,6 +469,19 @@ public:
       : CtxCounterMap(Counter), Binary(B) {}
   bool unwind(const PerfSample *Sample, uint64_t Repeat);
   std::set<uint64_t> &getUntrackedCallsites() { return UntrackedCallsites; }
+  // Accumulate the statistics and untracked callsites of an unwinder that ran
+  // over another part of the samples.
+  void mergeStats(const VirtualUnwinder &Other) {
+    NumTotalBranches += Other.NumTotalBranches;
+    NumExtCallBranch += Other.NumExtCallBranch;
+    NumMissingExternalFrame += Other.NumMissingExternalFrame;
+    NumMismatchedProEpiBranch += Other.NumMismatchedProEpiBranch;
+    NumMismatchedExtCallBranch += Other.NumMismatchedExtCallBranch;
+    NumUnpairedExtAddr += Other.NumUnpairedExtAddr;
+    NumPairedExtAddr += Other.NumPairedExtAddr;
+    UntrackedCallsites.insert(Other.UntrackedCallsites.begin(),
+                              Other.UntrackedCallsites.end());
+  }
 
   uint64_t NumTotalBranches = 0;
   uint64_t NumExtCallBranch = 0;
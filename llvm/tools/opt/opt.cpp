@@ -13,6 +13,7 @@
 
 #include "BreakpointPrinter.h"
 #include "NewPMDriver.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
@@ -41,6 +42,7 @@
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Remarks/HotnessThresholdParser.h"
+#include "llvm/Support/BuryPointer.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
@@ -248,6 +250,17 @@ static cl::opt<bool> DiscardValueNames(
     cl::desc("Discard names from Value (other than GlobalValue)."),
     cl::init(false), cl::Hidden);
 
+// Builds with assertions free the IR on exit, to check that nothing leaked.
+static cl::opt<bool> DisableFree("disable-free",
+                                 cl::desc("Leak the IR on exit instead of "
+                                          "freeing it"),
+#ifdef NDEBUG
+                                 cl::init(true),
+#else
+                                 cl::init(false),
+#endif
+                                 cl::Hidden);
+
 static cl::opt<bool> TimeTrace(
     "time-trace",
     cl::desc("Record time trace"));
@@ -646,6 +659,14 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  // The process exits when main returns, see enableLeakOnExit().
+  auto LeakIR = make_scope_exit([&] {
+    if (!DisableFree)
+      return;
+    enableLeakOnExit();
+    BuryPointer(std::move(M));
+  });
+
   // Strip debug info before running the verifier.
   if (StripDebug)
     StripDebugInfo(*M);
@@ -0,0 +1,147 @@
+//===- ConcurrentStringMapTest.cpp - ConcurrentStringMap unit tests -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ConcurrentStringMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "gtest/gtest.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ConcurrentStringMapTest, Empty) {
+  ConcurrentStringMap<int> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_EQ(nullptr, Map.find("foo"));
+  EXPECT_EQ(0u, Map.count("foo"));
+  EXPECT_EQ(0, Map.lookup("foo"));
+}
+
+TEST(ConcurrentStringMapTest, InsertOrGet) {
+  ConcurrentStringMap<int> Map;
+  auto R1 = Map.try_emplace("foo", 1);
+  EXPECT_TRUE(R1.second);
+  EXPECT_EQ("foo", R1.first->getKey());
+  EXPECT_EQ(1, R1.first->getValue());
+
+  // A second insertion returns the existing entry and leaves it unchanged.
+  auto R2 = Map.try_emplace("foo", 2);
+  EXPECT_FALSE(R2.second);
+  EXPECT_EQ(R1.first, R2.first);
+  EXPECT_EQ(1, R2.first->getValue());
+
+  EXPECT_TRUE(Map.try_emplace("bar", 3).second);
+  EXPECT_TRUE(Map.try_emplace("", 4).second);
+  EXPECT_EQ(3u, Map.size());
+  EXPECT_EQ(1, Map.lookup("foo"));
+  EXPECT_EQ(3, Map.lookup("bar"));
+  EXPECT_EQ(4, Map.lookup(""));
+  EXPECT_EQ(0u, Map.count("baz"));
+}
+
+TEST(ConcurrentStringMapTest, KeyIsStableCopy) {
+  ConcurrentStringMap<int> Map;
+  std::string Key = "hello";
+  auto *E = Map.try_emplace(Key, 0).first;
+  Key[0] = 'j';
+  EXPECT_EQ("hello", E->getKey());
+  EXPECT_NE(Key.data(), E->getKeyData());
+  EXPECT_EQ('\0', E->getKeyData()[E->getKeyLength()]);
+}
+
+TEST(ConcurrentStringMapTest, ManyKeys) {
+  // Enough keys to split the root and several levels of subtries.
+  ConcurrentStringMap<unsigned> Map;
+  const unsigned N = 100000;
+  for (unsigned I = 0; I != N; ++I)
+    EXPECT_TRUE(Map.try_emplace(("key" + Twine(I)).str(), I).second);
+  EXPECT_EQ(N, Map.size());
+
+  for (unsigned I = 0; I != N; ++I) {
+    auto *E = Map.find(("key" + Twine(I)).str());
+    ASSERT_NE(nullptr, E);
+    EXPECT_EQ(I, E->getValue());
+  }
+
+  // forEach visits every entry once.
+  std::vector<bool> Seen(N);
+  size_t Count = 0;
+  Map.forEach([&](ConcurrentStringMap<unsigned>::EntryTy &E) {
+    EXPECT_FALSE(Seen[E.getValue()]);
+    Seen[E.getValue()] = true;
+    ++Count;
+  });
+  EXPECT_EQ(N, Count);
+}
+
+TEST(ConcurrentStringMapTest, NonTrivialValue) {
+  auto Counter = std::make_shared<int>(0);
+  {
+    ConcurrentStringMap<std::shared_ptr<int>> Map;
+    Map.try_emplace("a", Counter);
+    Map.try_emplace("b", Counter);
+    Map.try_emplace("a", Counter);
+    EXPECT_EQ(3, Counter.use_count());
+  }
+  // The map destroys its values.
+  EXPECT_EQ(1, Counter.use_count());
+}
+
+TEST(ConcurrentStringMapTest, ConcurrentInsert) {
+  // Every thread inserts the same keys. Each key must end up with exactly
+  // one entry, and every thread must get that entry back.
+  ConcurrentStringMap<unsigned> Map;
+  const unsigned NumKeys = 20000;
+  const unsigned NumThreads = 8;
+  std::vector<std::string> Keys;
+  for (unsigned I = 0; I != NumKeys; ++I)
+    Keys.push_back(("sym" + Twine(I)).str());
+
+  using EntryTy = ConcurrentStringMap<unsigned>::EntryTy;
+  std::vector<std::vector<EntryTy *>> Results(NumThreads);
+  std::vector<unsigned> Inserted(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    Threads.emplace_back([&, T] {
+      // Walk the keys in a different order on every thread.
+      for (unsigned I = 0; I != NumKeys; ++I) {
+        unsigned K = (I * (2 * T + 1) + T) % NumKeys;
+        auto R = Map.try_emplace(Keys[K], K);
+        Results[T].push_back(R.first);
+        Inserted[T] += R.second;
+      }
+    });
+  }
+  for (std::thread &T : Threads)
+    T.join();
+
+  EXPECT_EQ(NumKeys, Map.size());
+  unsigned TotalInserted = 0;
+  for (unsigned N : Inserted)
+    TotalInserted += N;
+  EXPECT_EQ(NumKeys, TotalInserted);
+
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    for (unsigned I = 0; I != NumKeys; ++I) {
+      unsigned K = (I * (2 * T + 1) + T) % NumKeys;
+      EntryTy *E = Results[T][I];
+      EXPECT_EQ(Map.find(Keys[K]), E);
+      EXPECT_EQ(K, E->getValue());
+      EXPECT_EQ(Keys[K], E->getKey());
+    }
+  }
+}
+
+} // end anonymous namespace
@@ -0,0 +1,182 @@
+//===- MemoryProfileInfoTest.cpp - Memory Profile Info Unit Tests ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemoryProfileInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::memprof;
+
+extern cl::opt<float> MemProfAccessesPerByteColdThreshold;
+extern cl::opt<unsigned> MemProfMinLifetimeColdThreshold;
+extern cl::opt<float> MemProfAccessesPerByteHotThreshold;
+
+namespace {
+
+class MemoryProfileInfoTest : public testing::Test {
+protected:
+  std::unique_ptr<Module> makeLLVMModule(LLVMContext &C, const char *IR) {
+    SMDiagnostic Err;
+    std::unique_ptr<Module> Mod = parseAssemblyString(IR, Err, C);
+    if (!Mod)
+      Err.print("MemoryProfileInfoTest", errs());
+    return Mod;
+  }
+
+  // Return the stack ids of the stack node of an MIB.
+  std::vector<uint64_t> getStackIds(const MDNode *MIB) {
+    std::vector<uint64_t> StackIds;
+    for (const auto &Op : getMIBStackNode(MIB)->operands())
+      StackIds.push_back(mdconst::extract<ConstantInt>(Op)->getZExtValue());
+    return StackIds;
+  }
+
+  static constexpr const char *IR = R"IR(
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+define i32* @test() {
+entry:
+  %call1 = call noalias dereferenceable_or_null(40) i8* @malloc(i64 noundef 40)
+  %0 = bitcast i8* %call1 to i32*
+  %call2 = call noalias dereferenceable_or_null(40) i8* @malloc(i64 noundef 40)
+  %call3 = call noalias dereferenceable_or_null(40) i8* @malloc(i64 noundef 40)
+  %call4 = call noalias dereferenceable_or_null(40) i8* @malloc(i64 noundef 40)
+  ret i32* %0
+}
+declare dso_local noalias noundef i8* @malloc(i64 noundef)
+)IR";
+
+  std::vector<CallBase *> getCalls(Module &M) {
+    std::vector<CallBase *> Calls;
+    for (auto &I : M.getFunction("test")->getEntryBlock())
+      if (auto *CB = dyn_cast<CallBase>(&I))
+        Calls.push_back(CB);
+    return Calls;
+  }
+};
+
+// Test getAllocType helper.
+// Generally we use the same threshold values as the defaults, but set them
+// explicitly to ensure the test does not break if they change.
+TEST_F(MemoryProfileInfoTest, GetAllocType) {
+  MemProfAccessesPerByteColdThreshold = 10.0;
+  MemProfMinLifetimeColdThreshold = 200;
+  MemProfAccessesPerByteHotThreshold = 1000.0;
+
+  // Long lived with more accesses per byte than threshold is not cold.
+  EXPECT_EQ(getAllocType(/*MaxAccessCount=*/20, /*MinSize=*/1,
+                         /*MinLifetime=*/200 * 1000),
+            AllocationType::NotCold);
+  // Long lived with less accesses per byte than threshold is cold.
+  EXPECT_EQ(getAllocType(/*MaxAccessCount=*/9, /*MinSize=*/1,
+                         /*MinLifetime=*/200 * 1000),
+            AllocationType::Cold);
+  // Short lived with less accesses per byte than threshold is not cold.
+  EXPECT_EQ(getAllocType(/*MaxAccessCount=*/9, /*MinSize=*/1,
+                         /*MinLifetime=*/100),
+            AllocationType::NotCold);
+  // Accesses per byte at or above the hot threshold is hot.
+  EXPECT_EQ(getAllocType(/*MaxAccessCount=*/1000, /*MinSize=*/1,
+                         /*MinLifetime=*/100),
+            AllocationType::Hot);
+}
+
+// Test buildCallstackMetadata helper.
+TEST_F(MemoryProfileInfoTest, BuildCallStackMD) {
+  LLVMContext C;
+  MDNode *CallStack = buildCallstackMetadata({1, 2, 3}, C);
+  ASSERT_EQ(CallStack->getNumOperands(), 3u);
+  unsigned ExpectedId = 1;
+  for (auto &Op : CallStack->operands()) {
+    auto *StackId = mdconst::dyn_extract<ConstantInt>(Op);
+    EXPECT_EQ(StackId->getZExtValue(), ExpectedId++);
+  }
+}
+
+// Test CallStackTrie::addCallStack interface taking allocation type and list
+// of call stack ids.
+TEST_F(MemoryProfileInfoTest, Attribute) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = makeLLVMModule(C, IR);
+  std::vector<CallBase *> Calls = getCalls(*M);
+
+  // A single context, or contexts of a single type, are attached as an
+  // attribute.
+  CallStackTrie Trie1;
+  Trie1.addCallStack(AllocationType::Cold, {1, 2});
+  EXPECT_FALSE(Trie1.buildAndAttachMIBMetadata(Calls[0]));
+  EXPECT_TRUE(Calls[0]->hasFnAttr("memprof"));
+  EXPECT_EQ(Calls[0]->getFnAttr("memprof").getValueAsString(), "cold");
+  EXPECT_FALSE(Calls[0]->hasMetadata(LLVMContext::MD_memprof));
+
+  CallStackTrie Trie2;
+  Trie2.addCallStack(AllocationType::Hot, {1, 2});
+  Trie2.addCallStack(AllocationType::Hot, {1, 3});
+  EXPECT_FALSE(Trie2.buildAndAttachMIBMetadata(Calls[1]));
+  EXPECT_EQ(Calls[1]->getFnAttr("memprof").getValueAsString(), "hot");
+}
+
+// Test that contexts of different types are trimmed to the shortest prefixes
+// that tell them apart.
+TEST_F(MemoryProfileInfoTest, TrimmedMIBContext) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = makeLLVMModule(C, IR);
+  std::vector<CallBase *> Calls = getCalls(*M);
+
+  CallStackTrie Trie;
+  // 1 -> 2 -> 4 and 1 -> 2 -> 5 are both cold, so 1 -> 2 is enough to tell
+  // them apart from 1 -> 3.
+  Trie.addCallStack(AllocationType::Cold, {1, 2, 4});
+  Trie.addCallStack(AllocationType::Cold, {1, 2, 5});
+  Trie.addCallStack(AllocationType::NotCold, {1, 3, 6});
+  EXPECT_TRUE(Trie.buildAndAttachMIBMetadata(Calls[2]));
+  EXPECT_FALSE(Calls[2]->hasFnAttr("memprof"));
+
+  MDNode *MemProfMD = Calls[2]->getMetadata(LLVMContext::MD_memprof);
+  ASSERT_EQ(MemProfMD->getNumOperands(), 2u);
+  for (auto &MIBOp : MemProfMD->operands()) {
+    auto *MIB = cast<MDNode>(MIBOp);
+    std::vector<uint64_t> StackIds = getStackIds(MIB);
+    if (getMIBAllocType(MIB) == AllocationType::Cold) {
+      EXPECT_EQ(StackIds, std::vector<uint64_t>({1, 2}));
+    } else {
+      EXPECT_EQ(getMIBAllocType(MIB), AllocationType::NotCold);
+      EXPECT_EQ(StackIds, std::vector<uint64_t>({1, 3}));
+    }
+  }
+}
+
+// Test CallStackTrie::addCallStack interface taking memprof MIB metadata.
+TEST_F(MemoryProfileInfoTest, ReadMIBMetadata) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = makeLLVMModule(C, IR);
+  std::vector<CallBase *> Calls = getCalls(*M);
+
+  CallStackTrie Trie;
+  Trie.addCallStack(AllocationType::NotCold, {1, 2});
+  Trie.addCallStack(AllocationType::Cold, {1, 3});
+  EXPECT_TRUE(Trie.buildAndAttachMIBMetadata(Calls[3]));
+
+  // Rebuilding a trie from the attached MIBs gives the same metadata.
+  MDNode *MemProfMD = Calls[3]->getMetadata(LLVMContext::MD_memprof);
+  CallStackTrie Rebuilt;
+  for (auto &MIBOp : MemProfMD->operands())
+    Rebuilt.addCallStack(cast<MDNode>(MIBOp));
+  Calls[3]->setMetadata(LLVMContext::MD_memprof, nullptr);
+  EXPECT_TRUE(Rebuilt.buildAndAttachMIBMetadata(Calls[3]));
+  EXPECT_EQ(Calls[3]->getMetadata(LLVMContext::MD_memprof), MemProfMD);
+}
+
+} // end anonymous namespace
@@ -15,6 +15,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -255,4 +256,63 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// Tests that materializing a module with its function blocks decoded on other
+// threads produces the same module as reading them serially.
+TEST(BitReaderTest, MaterializeAllWithStagedFunctionBlocks) {
+  const char *Assembly =
+      "@g = global i32 0\n"
+      "define i32 @f(i32 %a) !dbg !4 {\n"
+      "entry:\n"
+      "  %x = add i32 %a, 42, !dbg !7\n"
+      "  %c = icmp eq i32 %x, 7\n"
+      "  br i1 %c, label %bb, label %exit\n"
+      "bb:\n"
+      "  store i32 %x, i32* @g\n"
+      "  br label %exit\n"
+      "exit:\n"
+      "  %p = phi i32 [ %x, %entry ], [ 3, %bb ]\n"
+      "  ret i32 %p\n"
+      "}\n"
+      "define i8* @h() {\n"
+      "  ret i8* blockaddress(@f, %bb)\n"
+      "}\n"
+      "define float @k(float %a) {\n"
+      "  %m = fmul float %a, 2.5\n"
+      "  ret float %m\n"
+      "}\n"
+      "!llvm.dbg.cu = !{!0}\n"
+      "!llvm.module.flags = !{!3}\n"
+      "!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, "
+      "emissionKind: FullDebug)\n"
+      "!1 = !DIFile(filename: \"f.c\", directory: \"/\")\n"
+      "!3 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+      "!4 = distinct !DISubprogram(name: \"f\", scope: !1, file: !1, line: 1, "
+      "type: !5, unit: !0, spFlags: DISPFlagDefinition)\n"
+      "!5 = !DISubroutineType(types: !6)\n"
+      "!6 = !{}\n"
+      "!7 = !DILocation(line: 2, scope: !4)\n";
+
+  auto PrintModule = [&](unsigned NumThreads) {
+    auto &Opts = cl::getRegisteredOptions();
+    auto *Threads =
+        static_cast<cl::opt<unsigned> *>(Opts["bitcode-reader-threads"]);
+    EXPECT_TRUE(Threads);
+    *Threads = NumThreads;
+
+    SmallString<1024> Mem;
+    LLVMContext Context;
+    std::unique_ptr<Module> M =
+        getLazyModuleFromAssembly(Context, Mem, Assembly);
+    EXPECT_FALSE(M->materializeAll());
+    EXPECT_FALSE(verifyModule(*M, &dbgs()));
+    *Threads = 1;
+
+    std::string Result;
+    raw_string_ostream OS(Result);
+    M->print(OS, nullptr);
+    return OS.str();
+  };
+  EXPECT_EQ(PrintModule(4), PrintModule(1));
+}
+
 } // end namespace
@@ -9,6 +9,9 @@
 #include "llvm/Bitstream/BitstreamWriter.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -55,4 +58,42 @@ TEST(BitstreamWriterTest, emitBlob4ByteAligned) {
   EXPECT_EQ(StringRef("str0"), Buffer);
 }
 
+TEST(BitstreamWriterTest, ReadWrittenBytesAfterFlush) {
+  SmallString<64> Path;
+  int FD;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("bitstream", "bc", FD, Path));
+  FileRemover Cleanup(Path);
+  std::error_code EC;
+  raw_fd_stream OS(Path, EC);
+  ASSERT_FALSE(EC);
+
+  SmallString<64> Buffer;
+  BitstreamWriter W(Buffer, &OS, /*FlushThreshold=*/0);
+  W.EnterSubblock(8, 3);
+  W.EnterSubblock(9, 3);
+  W.EmitRecord(1, ArrayRef<uint64_t>{1, 2, 3});
+  // Exiting the inner block flushes everything written so far.
+  W.ExitBlock();
+  EXPECT_TRUE(Buffer.empty());
+  uint64_t NumFlushed = OS.tell();
+  EXPECT_GT(NumFlushed, 0u);
+  W.EmitRecord(2, ArrayRef<uint64_t>{4, 5, 6, 7, 8, 9, 10, 11, 12, 13});
+  EXPECT_FALSE(Buffer.empty());
+
+  // Read both flushed and buffered bytes, after the header of the outer block
+  // whose size is backpatched when it exits.
+  std::string Written;
+  W.ReadWrittenBytes(8, [&](ArrayRef<uint8_t> Bytes) {
+    Written.append(Bytes.begin(), Bytes.end());
+  });
+  EXPECT_EQ(Written.size(), NumFlushed + Buffer.size() - 8);
+  EXPECT_EQ(OS.tell(), NumFlushed);
+  W.ExitBlock();
+
+  std::string File(OS.tell(), 0);
+  OS.seek(0);
+  EXPECT_EQ(OS.read(&File[0], File.size()), (ssize_t)File.size());
+  EXPECT_EQ(File.substr(8, Written.size()), Written);
+}
+
 } // end namespace
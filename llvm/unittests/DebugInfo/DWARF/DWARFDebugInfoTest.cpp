@@ -1983,6 +1983,82 @@ TEST(DWARFDebugInfo, TestErrorReporting) {
   EXPECT_TRUE(Errors == 2);
 }
 
+TEST(DWARFDebugInfo, TestParallelVerifyOutputIsOrdered) {
+  // Three units, each with a DW_AT_type reference: the first and the last
+  // point at the unit DIE, the second one is beyond the end of its unit.
+  const char *yamldata = R"(
+  debug_abbrev:
+    - Table:
+        - Code:            0x1
+          Tag:             DW_TAG_compile_unit
+          Children:        DW_CHILDREN_yes
+          Attributes:
+            - Attribute:       DW_AT_name
+              Form:            DW_FORM_string
+        - Code:            0x2
+          Tag:             DW_TAG_variable
+          Children:        DW_CHILDREN_no
+          Attributes:
+            - Attribute:       DW_AT_type
+              Form:            DW_FORM_ref4
+  debug_info:
+    - Version:         4
+      AddrSize:        8
+      Entries:
+        - AbbrCode:        0x1
+          Values:
+            - CStr:            a
+        - AbbrCode:        0x2
+          Values:
+            - Value:           0xb
+        - AbbrCode:        0x0
+    - Version:         4
+      AddrSize:        8
+      Entries:
+        - AbbrCode:        0x1
+          Values:
+            - CStr:            b
+        - AbbrCode:        0x2
+          Values:
+            - Value:           0x100
+        - AbbrCode:        0x0
+    - Version:         4
+      AddrSize:        8
+      Entries:
+        - AbbrCode:        0x1
+          Values:
+            - CStr:            c
+        - AbbrCode:        0x2
+          Values:
+            - Value:           0xb
+        - AbbrCode:        0x0
+)";
+  auto ErrOrSections = DWARFYAML::emitDebugSections(StringRef(yamldata));
+  ASSERT_THAT_EXPECTED(ErrOrSections, Succeeded());
+
+  auto Verify = [&](unsigned Threads, std::string &Output) {
+    std::unique_ptr<DWARFContext> DwarfContext =
+        DWARFContext::create(*ErrOrSections, 8);
+    DIDumpOptions DumpOpts;
+    DumpOpts.DumpType = DIDT_DebugInfo;
+    DumpOpts.VerifyThreads = Threads;
+    raw_string_ostream OS(Output);
+    bool Success = DwarfContext->verify(OS, DumpOpts.noImplicitRecursion());
+    OS.flush();
+    return Success;
+  };
+
+  std::string Serial, Parallel;
+  EXPECT_FALSE(Verify(1, Serial));
+  EXPECT_FALSE(Verify(4, Parallel));
+  EXPECT_THAT(Serial, HasSubstr("Verifying unit: 2 / 3, \"b\"\n"
+                                "error: DW_FORM_ref4 CU offset 0x00000100"));
+  EXPECT_THAT(Serial, HasSubstr("Verifying unit: 3 / 3, \"c\"\n"
+                                "error: DIE has DW_AT_type with incompatible "
+                                "tag DW_TAG_compile_unit"));
+  EXPECT_EQ(Serial, Parallel);
+}
+
 TEST(DWARFDebugInfo, TestDWARFDieRangeInfoContains) {
   DWARFVerifier::DieRangeInfo Empty;
   ASSERT_TRUE(Empty.contains(Empty));
@@ -0,0 +1,190 @@
+//===- llvm/unittest/DebugInfo/DWARFDieNameIndexTest.cpp ------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/DWARF/DWARFDieNameIndex.h"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/ObjectYAML/DWARFEmitter.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::dwarf;
+
+namespace {
+
+// Two units. The second one has a declaration of "foo" whose names are only
+// reachable through a DW_AT_specification into the first unit:
+//
+// 0x0000000b: DW_TAG_compile_unit
+// 0x0000000e:   DW_TAG_subprogram
+//                 DW_AT_name ("foo")
+//                 DW_AT_linkage_name ("_Z3foov")
+// 0x00000017:   DW_TAG_variable
+//                 DW_AT_name ("bar")
+// 0x0000001c:   NULL
+//
+// 0x00000028: DW_TAG_compile_unit
+// 0x0000002b:   DW_TAG_subprogram
+//                 DW_AT_specification (0x0000000e)
+// 0x00000030:   NULL
+const char *yamldata = R"(
+  debug_str:
+    - ''
+    - foo
+    - _Z3foov
+    - bar
+  debug_abbrev:
+    - Table:
+        - Code:            0x1
+          Tag:             DW_TAG_compile_unit
+          Children:        DW_CHILDREN_yes
+          Attributes:
+            - Attribute:       DW_AT_language
+              Form:            DW_FORM_data2
+        - Code:            0x2
+          Tag:             DW_TAG_subprogram
+          Children:        DW_CHILDREN_no
+          Attributes:
+            - Attribute:       DW_AT_name
+              Form:            DW_FORM_strp
+            - Attribute:       DW_AT_linkage_name
+              Form:            DW_FORM_strp
+        - Code:            0x3
+          Tag:             DW_TAG_subprogram
+          Children:        DW_CHILDREN_no
+          Attributes:
+            - Attribute:       DW_AT_specification
+              Form:            DW_FORM_ref_addr
+        - Code:            0x4
+          Tag:             DW_TAG_variable
+          Children:        DW_CHILDREN_no
+          Attributes:
+            - Attribute:       DW_AT_name
+              Form:            DW_FORM_strp
+  debug_info:
+    - Length:          0x19
+      Version:         4
+      AbbrevTableID:   0
+      AbbrOffset:      0x0
+      AddrSize:        8
+      Entries:
+        - AbbrCode:        0x1
+          Values:
+            - Value:           0x4
+        - AbbrCode:        0x2
+          Values:
+            - Value:           0x1
+            - Value:           0x5
+        - AbbrCode:        0x4
+          Values:
+            - Value:           0xd
+        - AbbrCode:        0x0
+    - Length:          0x10
+      Version:         4
+      AbbrevTableID:   0
+      AbbrOffset:      0x0
+      AddrSize:        8
+      Entries:
+        - AbbrCode:        0x1
+          Values:
+            - Value:           0x4
+        - AbbrCode:        0x3
+          Values:
+            - Value:           0xe
+        - AbbrCode:        0x0
+)";
+
+using Entry = DWARFDieNameIndex::Entry;
+
+class DWARFDieNameIndexTest : public testing::Test {
+protected:
+  void SetUp() override {
+    Expected<StringMap<std::unique_ptr<MemoryBuffer>>> SectionsOrErr =
+        DWARFYAML::emitDebugSections(StringRef(yamldata),
+                                     /*IsLittleEndian=*/true,
+                                     /*Is64BitAddrSize=*/true);
+    ASSERT_THAT_EXPECTED(SectionsOrErr, Succeeded());
+    Sections = std::move(*SectionsOrErr);
+  }
+
+  // The contexts refer to the section buffers, which outlive them.
+  std::unique_ptr<DWARFContext> createContext() {
+    return DWARFContext::create(Sections, 8, /*isLittleEndian=*/true);
+  }
+
+  StringMap<std::unique_ptr<MemoryBuffer>> Sections;
+};
+
+void checkIndex(DWARFContext &Ctx, const DWARFDieNameIndex &Index) {
+  EXPECT_EQ(3u, Index.getNumNames());
+  EXPECT_EQ(ArrayRef<Entry>({{0, 1}, {1, 1}}), Index.lookup("foo"));
+  EXPECT_EQ(ArrayRef<Entry>({{0, 1}, {1, 1}}), Index.lookup("_Z3foov"));
+  EXPECT_EQ(ArrayRef<Entry>({{0, 2}}), Index.lookup("bar"));
+  EXPECT_TRUE(Index.lookup("baz").empty());
+
+  DWARFDie Die = DWARFDieNameIndex::getDIE(Ctx, {1, 1});
+  ASSERT_TRUE(Die.isValid());
+  EXPECT_EQ(0x2bu, Die.getOffset());
+  EXPECT_FALSE(DWARFDieNameIndex::getDIE(Ctx, {2, 0}).isValid());
+  EXPECT_FALSE(DWARFDieNameIndex::getDIE(Ctx, {0, 100}).isValid());
+}
+
+std::string writeIndex(const DWARFDieNameIndex &Index) {
+  std::string Data;
+  raw_string_ostream OS(Data);
+  Index.write(OS);
+  return OS.str();
+}
+
+TEST_F(DWARFDieNameIndexTest, Build) {
+  std::unique_ptr<DWARFContext> Ctx = createContext();
+  checkIndex(*Ctx, DWARFDieNameIndex::build(*Ctx));
+}
+
+TEST_F(DWARFDieNameIndexTest, BuildIsDeterministic) {
+  std::unique_ptr<DWARFContext> Ctx1 = createContext();
+  std::unique_ptr<DWARFContext> Ctx2 = createContext();
+  DWARFDieNameIndex Serial =
+      DWARFDieNameIndex::build(*Ctx1, hardware_concurrency(1));
+  DWARFDieNameIndex Parallel =
+      DWARFDieNameIndex::build(*Ctx2, hardware_concurrency(4));
+  EXPECT_EQ(writeIndex(Serial), writeIndex(Parallel));
+}
+
+TEST_F(DWARFDieNameIndexTest, RoundTrip) {
+  std::unique_ptr<DWARFContext> Ctx = createContext();
+  std::string Data = writeIndex(DWARFDieNameIndex::build(*Ctx));
+
+  // Read into a fresh context whose DIEs have not been extracted yet.
+  std::unique_ptr<DWARFContext> ReadCtx = createContext();
+  Expected<DWARFDieNameIndex> Index = DWARFDieNameIndex::read(*ReadCtx, Data);
+  ASSERT_THAT_EXPECTED(Index, Succeeded());
+  checkIndex(*ReadCtx, *Index);
+}
+
+TEST_F(DWARFDieNameIndexTest, ReadErrors) {
+  std::unique_ptr<DWARFContext> Ctx = createContext();
+  std::string Data = writeIndex(DWARFDieNameIndex::build(*Ctx));
+
+  EXPECT_THAT_EXPECTED(DWARFDieNameIndex::read(*Ctx, "junk"),
+                       FailedWithMessage("not a DIE name index file"));
+
+  EXPECT_THAT_EXPECTED(
+      DWARFDieNameIndex::read(*Ctx, StringRef(Data).drop_back()), Failed());
+
+  // Claim a different number of units than the context has.
+  std::string Mismatch = Data;
+  Mismatch[8] = 3;
+  EXPECT_THAT_EXPECTED(
+      DWARFDieNameIndex::read(*Ctx, Mismatch),
+      FailedWithMessage("DIE name index does not match the debug info"));
+}
+
+} // end anonymous namespace
@@ -15,6 +15,7 @@
 #include "llvm/DebugInfo/GSYM/FileWriter.h"
 #include "llvm/DebugInfo/GSYM/FunctionInfo.h"
 #include "llvm/DebugInfo/GSYM/GsymCreator.h"
+#include "llvm/DebugInfo/GSYM/GsymDIContext.h"
 #include "llvm/DebugInfo/GSYM/GsymReader.h"
 #include "llvm/DebugInfo/GSYM/Header.h"
 #include "llvm/DebugInfo/GSYM/InlineInfo.h"
@@ -2414,3 +2415,67 @@ TEST(GSYMTest, TestGsymCreatorMultipleSymbolsWithNoSize) {
                    1, // NumAddresses
                    ArrayRef<uint8_t>(UUID));
 }
+
+TEST(GSYMTest, TestGsymDIContext) {
+  // Check that GsymDIContext answers DIContext queries the way DWARFContext
+  // does: innermost inlined function first, and the requested name and path
+  // styles.
+  GsymCreator GC;
+  FunctionInfo FI(0x1000, 0x100, GC.insertString("main"));
+  FI.OptLineTable = LineTable();
+  const uint32_t MainFileIndex = GC.insertFile("/tmp/main.c");
+  const uint32_t FooFileIndex = GC.insertFile("/tmp/foo.h");
+  FI.OptLineTable->push(LineEntry(0x1000, MainFileIndex, 5));
+  FI.OptLineTable->push(LineEntry(0x1010, FooFileIndex, 10));
+  FI.OptLineTable->push(LineEntry(0x1020, MainFileIndex, 8));
+  FI.Inline = InlineInfo();
+  FI.Inline->Name = GC.insertString("inline1");
+  FI.Inline->CallFile = MainFileIndex;
+  FI.Inline->CallLine = 6;
+  FI.Inline->Ranges.insert(AddressRange(0x1010, 0x1020));
+  GC.addFunctionInfo(std::move(FI));
+  ASSERT_FALSE(GC.finalize(llvm::nulls()));
+  SmallString<512> Str;
+  raw_svector_ostream OutStrm(Str);
+  FileWriter FW(OutStrm, support::endian::system_endianness());
+  ASSERT_FALSE(GC.encode(FW));
+  Expected<GsymReader> GR = GsymReader::copyBuffer(OutStrm.str());
+  ASSERT_THAT_EXPECTED(GR, Succeeded());
+  GsymDIContext Ctx(std::make_unique<GsymReader>(std::move(*GR)));
+
+  using FileLineInfoKind = DILineInfoSpecifier::FileLineInfoKind;
+  DILineInfoSpecifier Absolute(FileLineInfoKind::AbsoluteFilePath,
+                               DINameKind::LinkageName);
+  DILineInfo LI = Ctx.getLineInfoForAddress({0x1004}, Absolute);
+  EXPECT_EQ(LI.FunctionName, "main");
+  EXPECT_EQ(LI.FileName, "/tmp/main.c");
+  EXPECT_EQ(LI.Line, 5u);
+  EXPECT_EQ(LI.StartAddress, Optional<uint64_t>(0x1000));
+
+  LI = Ctx.getLineInfoForAddress({0x1010}, Absolute);
+  EXPECT_EQ(LI.FunctionName, "inline1");
+  EXPECT_EQ(LI.FileName, "/tmp/foo.h");
+  EXPECT_EQ(LI.Line, 10u);
+  EXPECT_FALSE(LI.StartAddress);
+
+  LI = Ctx.getLineInfoForAddress(
+      {0x1010}, DILineInfoSpecifier(FileLineInfoKind::BaseNameOnly,
+                                    DINameKind::None));
+  EXPECT_EQ(LI.FunctionName, DILineInfo::BadString);
+  EXPECT_EQ(LI.FileName, "foo.h");
+
+  DIInliningInfo Inlined = Ctx.getInliningInfoForAddress({0x1010}, Absolute);
+  ASSERT_EQ(Inlined.getNumberOfFrames(), 2u);
+  EXPECT_EQ(Inlined.getFrame(0).FunctionName, "inline1");
+  EXPECT_EQ(Inlined.getFrame(0).Line, 10u);
+  EXPECT_EQ(Inlined.getFrame(1).FunctionName, "main");
+  EXPECT_EQ(Inlined.getFrame(1).FileName, "/tmp/main.c");
+  EXPECT_EQ(Inlined.getFrame(1).Line, 6u);
+  EXPECT_EQ(Inlined.getFrame(1).StartAddress, Optional<uint64_t>(0x1000));
+
+  // Addresses outside of any function have no information.
+  EXPECT_FALSE(Ctx.getLineInfoForAddress({0x2000}, Absolute));
+  EXPECT_EQ(Ctx.getInliningInfoForAddress({0x2000}, Absolute)
+                .getNumberOfFrames(),
+            0u);
+}
@@ -0,0 +1,145 @@
+//===- SymbolizeTest.cpp - Tests for LLVMSymbolizer -----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/Symbolize/Symbolize.h"
+#include "llvm/ObjectYAML/yaml2obj.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Testing/Support/Error.h"
+#include "llvm/Testing/Support/SupportHelpers.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace llvm::symbolize;
+
+namespace {
+
+// An executable without debug info, so that the function names come from the
+// symbol table: foo covers [0x1000, 0x1010) and bar [0x1010, 0x1020).
+const char *const ExeYaml = R"(
+--- !ELF
+FileHeader:
+  Class:   ELFCLASS64
+  Data:    ELFDATA2LSB
+  Type:    ET_EXEC
+  Machine: EM_X86_64
+Sections:
+  - Name:    .text
+    Type:    SHT_PROGBITS
+    Flags:   [ SHF_ALLOC, SHF_EXECINSTR ]
+    Address: 0x1000
+    Size:    0x20
+Symbols:
+  - Name:    foo
+    Type:    STT_FUNC
+    Section: .text
+    Binding: STB_GLOBAL
+    Value:   0x1000
+    Size:    0x10
+  - Name:    bar
+    Type:    STT_FUNC
+    Section: .text
+    Binding: STB_GLOBAL
+    Value:   0x1010
+    Size:    0x10
+)";
+
+class SymbolizeCodeBatchTest : public testing::Test {
+protected:
+  void SetUp() override {
+    SmallString<0> Exe;
+    raw_svector_ostream OS(Exe);
+    yaml::Input YIn(ExeYaml);
+    ASSERT_TRUE(yaml::convertYAML(YIn, OS, [](const Twine &Msg) {}));
+    // Two copies, so that the batch has two modules to query concurrently.
+    for (unsigned I = 0; I != 2; ++I)
+      Exes.push_back(std::make_unique<unittest::TempFile>(
+          "symbolize", "o", Exe, /*Unique=*/true));
+  }
+
+  std::string exe(unsigned I) const { return Exes[I]->path().str(); }
+
+  static SectionedAddress addr(uint64_t Address) {
+    return {Address, SectionedAddress::UndefSection};
+  }
+
+  std::vector<std::unique_ptr<unittest::TempFile>> Exes;
+};
+
+TEST_F(SymbolizeCodeBatchTest, MatchesSymbolizeCode) {
+  std::vector<std::pair<std::string, SectionedAddress>> Requests = {
+      {exe(0), addr(0x1014)}, {exe(1), addr(0x1004)}, {exe(0), addr(0x1004)},
+      {exe(1), addr(0x1014)}, {exe(0), addr(0x1014)}, {exe(0), addr(0x2000)},
+  };
+
+  LLVMSymbolizer Batch;
+  std::vector<Expected<DILineInfo>> Results =
+      Batch.symbolizeCodeBatch(Requests, hardware_concurrency(2));
+  ASSERT_EQ(Results.size(), Requests.size());
+
+  // The results are in the order of the requests, including the repeated
+  // ones, and equal to the ones of individual calls.
+  LLVMSymbolizer Serial;
+  for (size_t I = 0, E = Requests.size(); I != E; ++I) {
+    ASSERT_THAT_EXPECTED(Results[I], Succeeded());
+    Expected<DILineInfo> Want =
+        Serial.symbolizeCode(Requests[I].first, Requests[I].second);
+    ASSERT_THAT_EXPECTED(Want, Succeeded());
+    EXPECT_EQ(*Results[I], *Want) << "request " << I;
+  }
+  EXPECT_EQ(Results[0]->FunctionName, "bar");
+  EXPECT_EQ(Results[1]->FunctionName, "foo");
+  EXPECT_EQ(Results[2]->FunctionName, "foo");
+  EXPECT_EQ(Results[3]->FunctionName, "bar");
+  EXPECT_EQ(Results[4]->FunctionName, "bar");
+  EXPECT_EQ(Results[5]->FunctionName, DILineInfo::BadString);
+}
+
+TEST_F(SymbolizeCodeBatchTest, ReportsLoadErrorOnce) {
+  SmallString<128> Missing(Exes[0]->path());
+  Missing += ".missing";
+  std::vector<std::pair<std::string, SectionedAddress>> Requests = {
+      {std::string(Missing), addr(0x1000)},
+      {exe(0), addr(0x1000)},
+      {std::string(Missing), addr(0x1010)},
+  };
+
+  LLVMSymbolizer Symbolizer;
+  std::vector<Expected<DILineInfo>> Results =
+      Symbolizer.symbolizeCodeBatch(Requests);
+  ASSERT_EQ(Results.size(), Requests.size());
+  // Like individual calls, only the first request for the module fails, and
+  // the next ones get an empty result.
+  EXPECT_THAT_EXPECTED(Results[0], Failed());
+  ASSERT_THAT_EXPECTED(Results[1], Succeeded());
+  EXPECT_EQ(Results[1]->FunctionName, "foo");
+  ASSERT_THAT_EXPECTED(Results[2], Succeeded());
+  EXPECT_EQ(*Results[2], DILineInfo());
+}
+
+TEST_F(SymbolizeCodeBatchTest, PrunesCache) {
+  // With no room in the cache, each module is evicted before the next one is
+  // loaded, which must wait for its queries.
+  LLVMSymbolizer::Options Opts;
+  Opts.MaxCacheSize = 0;
+  LLVMSymbolizer Symbolizer(Opts);
+  std::vector<std::pair<std::string, SectionedAddress>> Requests;
+  for (unsigned I = 0; I != 8; ++I)
+    Requests.push_back({exe(I % 2), addr(I % 4 < 2 ? 0x1000 : 0x1010)});
+
+  std::vector<Expected<DILineInfo>> Results =
+      Symbolizer.symbolizeCodeBatch(Requests, hardware_concurrency(2));
+  ASSERT_EQ(Results.size(), Requests.size());
+  for (size_t I = 0, E = Requests.size(); I != E; ++I) {
+    ASSERT_THAT_EXPECTED(Results[I], Succeeded());
+    EXPECT_EQ(Results[I]->FunctionName, I % 4 < 2 ? "foo" : "bar")
+        << "request " << I;
+  }
+}
+
+} // end anonymous namespace
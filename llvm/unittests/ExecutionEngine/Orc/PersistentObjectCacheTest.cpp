@@ -0,0 +1,88 @@
+//===--- PersistentObjectCacheTest.cpp - Test the on-disk object cache ---===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Testing/Support/Error.h"
+#include "llvm/Testing/Support/SupportHelpers.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+class PersistentObjectCacheTest : public testing::Test {
+protected:
+  PersistentObjectCacheTest()
+      : Dir("orc-object-cache", /*Unique=*/true),
+        JTMB(Triple("x86_64-unknown-linux-gnu")) {}
+
+  std::unique_ptr<PersistentObjectCache> createCache() {
+    auto Cache = PersistentObjectCache::Create(Dir.path(), JTMB);
+    EXPECT_THAT_EXPECTED(Cache, Succeeded());
+    return Cache ? std::move(*Cache) : nullptr;
+  }
+
+  std::unique_ptr<Module> createModule(StringRef FnName) {
+    auto M = std::make_unique<Module>("M", Ctx);
+    Function::Create(FunctionType::get(Type::getVoidTy(Ctx), false),
+                     GlobalValue::ExternalLinkage, FnName, *M);
+    return M;
+  }
+
+  unittest::TempDir Dir;
+  JITTargetMachineBuilder JTMB;
+  LLVMContext Ctx;
+};
+
+TEST_F(PersistentObjectCacheTest, RoundTrip) {
+  auto Cache = createCache();
+  ASSERT_TRUE(Cache);
+  auto M = createModule("foo");
+
+  // Nothing is cached yet.
+  EXPECT_EQ(Cache->getObject(M.get()), nullptr);
+
+  Cache->notifyObjectCompiled(M.get(), MemoryBufferRef("object", "foo.o"));
+  auto Obj = Cache->getObject(M.get());
+  ASSERT_TRUE(Obj);
+  EXPECT_EQ(Obj->getBuffer(), "object");
+
+  // The object is found by a new cache, for a new module with the same
+  // contents.
+  auto OtherCache = createCache();
+  ASSERT_TRUE(OtherCache);
+  auto SameM = createModule("foo");
+  Obj = OtherCache->getObject(SameM.get());
+  ASSERT_TRUE(Obj);
+  EXPECT_EQ(Obj->getBuffer(), "object");
+}
+
+TEST_F(PersistentObjectCacheTest, KeyDependsOnModuleAndTarget) {
+  auto Cache = createCache();
+  ASSERT_TRUE(Cache);
+  auto M = createModule("foo");
+  Cache->notifyObjectCompiled(M.get(), MemoryBufferRef("object", "foo.o"));
+
+  auto OtherM = createModule("bar");
+  EXPECT_NE(Cache->getKey(*M), Cache->getKey(*OtherM));
+  EXPECT_EQ(Cache->getObject(OtherM.get()), nullptr);
+
+  JTMB.setCPU("znver3");
+  auto OtherCache = createCache();
+  ASSERT_TRUE(OtherCache);
+  EXPECT_NE(Cache->getKey(*M), OtherCache->getKey(*M));
+  EXPECT_EQ(OtherCache->getObject(M.get()), nullptr);
+}
+
+} // namespace
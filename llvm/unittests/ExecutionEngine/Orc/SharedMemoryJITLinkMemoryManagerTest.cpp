@@ -0,0 +1,73 @@
+//===------------- SharedMemoryJITLinkMemoryManagerTest.cpp ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "OrcTestCommon.h"
+
+#include "llvm/ExecutionEngine/Orc/SharedMemoryJITLinkMemoryManager.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/Shared/OrcRTBridge.h"
+#include "llvm/ExecutionEngine/Orc/TargetProcess/SharedMemoryExecutorMemoryManager.h"
+#include "llvm/Testing/Support/Error.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+#if defined(LLVM_ON_UNIX) && !defined(__ANDROID__)
+
+TEST(SharedMemoryJITLinkMemoryManagerTest, AllocFinalizeFree) {
+  auto SelfEPC = cantFail(SelfExecutorProcessControl::Create());
+  rt_bootstrap::SharedMemoryExecutorMemoryManager ExecutorMemMgr;
+
+  StringMap<ExecutorAddr> BootstrapSymbols;
+  ExecutorMemMgr.addBootstrapSymbols(BootstrapSymbols);
+
+  SharedMemoryJITLinkMemoryManager::SymbolAddrs SAs;
+  SAs.Allocator =
+      BootstrapSymbols[rt::SharedMemoryExecutorMemoryManagerInstanceName];
+  SAs.Reserve =
+      BootstrapSymbols[rt::SharedMemoryExecutorMemoryManagerReserveWrapperName];
+  SAs.Finalize = BootstrapSymbols
+      [rt::SharedMemoryExecutorMemoryManagerFinalizeWrapperName];
+  SAs.Deallocate = BootstrapSymbols
+      [rt::SharedMemoryExecutorMemoryManagerDeallocateWrapperName];
+
+  auto MemMgr =
+      std::make_unique<SharedMemoryJITLinkMemoryManager>(*SelfEPC, SAs);
+
+  StringRef Hello = "hello";
+  auto SSA = jitlink::SimpleSegmentAlloc::Create(
+      *MemMgr, nullptr, {{jitlink::MemProt::Read, {Hello.size(), Align(1)}}});
+  EXPECT_THAT_EXPECTED(SSA, Succeeded());
+  auto SegInfo = SSA->getSegInfo(jitlink::MemProt::Read);
+  memcpy(SegInfo.WorkingMem.data(), Hello.data(), Hello.size());
+
+  ExecutorAddr TargetAddr(SegInfo.Addr);
+  const char *TargetMem = TargetAddr.toPtr<const char *>();
+  const char *WorkingMem = SegInfo.WorkingMem.data();
+
+  auto FA = SSA->finalize();
+  EXPECT_THAT_EXPECTED(FA, Succeeded());
+
+  // The working memory is a separate mapping of the executor's pages.
+  EXPECT_NE(TargetMem, WorkingMem);
+  StringRef TargetHello(TargetMem, Hello.size());
+  EXPECT_EQ(Hello, TargetHello);
+
+  auto Err2 = MemMgr->deallocate(std::move(*FA));
+  EXPECT_THAT_ERROR(std::move(Err2), Succeeded());
+
+  cantFail(ExecutorMemMgr.shutdown());
+  cantFail(SelfEPC->disconnect());
+}
+
+#endif
+
+} // namespace
@@ -0,0 +1,152 @@
+//===--- TieredCompileLayerTest.cpp - Test recompiling hot functions ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/TieredCompileLayer.h"
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+const char *const TestIR = R"(
+  define i32 @f() {
+    %r = call i32 @g()
+    ret i32 %r
+  }
+
+  define i32 @g() {
+    ret i32 1
+  }
+)";
+
+class TieredCompileLayerTest : public testing::Test {
+protected:
+  void SetUp() override {
+    OrcNativeTarget::initialize();
+    auto J = LLJITBuilder().create();
+    if (!J) {
+      consumeError(J.takeError());
+      return;
+    }
+    auto LCTMgr = createLocalLazyCallThroughManager(
+        (*J)->getTargetTriple(), (*J)->getExecutionSession(), 0);
+    auto ISMBuilder =
+        createLocalIndirectStubsManagerBuilder((*J)->getTargetTriple());
+    if (!LCTMgr || !ISMBuilder) {
+      if (!LCTMgr)
+        consumeError(LCTMgr.takeError());
+      return;
+    }
+    this->J = std::move(*J);
+    this->LCTMgr = std::move(*LCTMgr);
+    auto &ES = this->J->getExecutionSession();
+
+    // Tier-1 code returns 2 where tier-0 code returns 1.
+    Tier1Layer = std::make_unique<IRTransformLayer>(
+        ES, this->J->getIRCompileLayer(),
+        [this](ThreadSafeModule TSM, MaterializationResponsibility &)
+            -> Expected<ThreadSafeModule> {
+          ++Tier1Modules;
+          TSM.withModuleDo([](Module &M) {
+            for (auto &F : M)
+              for (auto &BB : F)
+                if (auto *RI = dyn_cast<ReturnInst>(BB.getTerminator()))
+                  if (isa<ConstantInt>(RI->getReturnValue()))
+                    RI->setOperand(0,
+                                   ConstantInt::get(RI->getType(), 2));
+          });
+          return std::move(TSM);
+        });
+    Layer = std::make_unique<TieredCompileLayer>(
+        ES, this->J->getIRCompileLayer(), *Tier1Layer, *this->LCTMgr,
+        std::move(ISMBuilder), /*HotCallThreshold=*/3);
+    MangleAndInterner Mangle(ES, this->J->getDataLayout());
+    cantFail(Layer->addTieringRuntime(this->J->getMainJITDylib(), Mangle));
+  }
+
+  ThreadSafeModule parseModule() {
+    auto Ctx = std::make_unique<LLVMContext>();
+    SMDiagnostic Err;
+    auto M = parseIR(MemoryBufferRef(TestIR, "test"), Err, *Ctx);
+    EXPECT_TRUE(M) << Err.getMessage();
+    M->setDataLayout(J->getDataLayout());
+    return ThreadSafeModule(std::move(M), std::move(Ctx));
+  }
+
+  std::unique_ptr<LLJIT> J;
+  std::unique_ptr<LazyCallThroughManager> LCTMgr;
+  std::unique_ptr<IRTransformLayer> Tier1Layer;
+  std::unique_ptr<TieredCompileLayer> Layer;
+  unsigned Tier1Modules = 0;
+};
+
+TEST_F(TieredCompileLayerTest, TiersUpHotModule) {
+  if (!Layer)
+    GTEST_SKIP();
+  ASSERT_THAT_ERROR(Layer->add(J->getMainJITDylib(), parseModule()),
+                    Succeeded());
+  auto F = J->lookup("f");
+  ASSERT_THAT_EXPECTED(F, Succeeded());
+  auto *FPtr = F->toPtr<int()>();
+
+  EXPECT_EQ(FPtr(), 1);
+  EXPECT_EQ(FPtr(), 1);
+  EXPECT_EQ(Tier1Modules, 0u);
+
+  // The third call to f tiers up the module on entry. The dispatcher runs the
+  // tier-up compile in place, so the tier-0 code of f that is still in flight
+  // then calls g through its repointed stub.
+  EXPECT_EQ(FPtr(), 2);
+  EXPECT_EQ(Tier1Modules, 1u);
+
+  // The stubs of both functions now point at the tier-1 code, which calls g
+  // through its stub too.
+  EXPECT_EQ(FPtr(), 2);
+  auto G = J->lookup("g");
+  ASSERT_THAT_EXPECTED(G, Succeeded());
+  EXPECT_EQ(G->toPtr<int()>()(), 2);
+
+  // Calls to g in the tier-1 code count no more, and the module is not
+  // recompiled again.
+  for (unsigned I = 0; I != 5; ++I)
+    EXPECT_EQ(FPtr(), 2);
+  EXPECT_EQ(Tier1Modules, 1u);
+}
+
+TEST_F(TieredCompileLayerTest, RemovedModulesDoNotTierUp) {
+  if (!Layer)
+    GTEST_SKIP();
+  auto &JD = J->getMainJITDylib();
+  auto RT = JD.createResourceTracker();
+  ASSERT_THAT_ERROR(Layer->add(RT, parseModule()), Succeeded());
+  auto F = J->lookup("f");
+  ASSERT_THAT_EXPECTED(F, Succeeded());
+  EXPECT_EQ(F->toPtr<int()>()(), 1);
+  ASSERT_THAT_ERROR(RT->remove(), Succeeded());
+
+  // The module can be added again, and tiers up on its own.
+  ASSERT_THAT_ERROR(Layer->add(JD, parseModule()), Succeeded());
+  F = J->lookup("f");
+  ASSERT_THAT_EXPECTED(F, Succeeded());
+  for (unsigned I = 0; I != 2; ++I)
+    EXPECT_EQ(F->toPtr<int()>()(), 1);
+  EXPECT_EQ(F->toPtr<int()>()(), 2);
+  EXPECT_EQ(Tier1Modules, 1u);
+}
+
+} // end anonymous namespace
@@ -9,13 +9,17 @@
 #include "llvm/IR/Constants.h"
 #include "llvm-c/Core.h"
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
+#include <thread>
 
 namespace llvm {
 namespace {
@@ -796,5 +800,45 @@ TEST(ConstantsTest, ComdatUserTracking) {
   EXPECT_TRUE(Users.size() == 0);
 }
 
+#if LLVM_ENABLE_THREADS
+TEST(ConstantsTest, ConcurrentUniquing) {
+  LLVMContext Context;
+  Context.setConcurrentUniquing(true);
+  EXPECT_TRUE(Context.hasConcurrentUniquing());
+
+  // Every thread creates the same objects; all of them must see the same set.
+  constexpr unsigned NumThreads = 4, NumObjects = 200;
+  std::vector<std::vector<const void *>> Results(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Threads.emplace_back([&Context, &Result = Results[T]] {
+      for (unsigned I = 0; I != NumObjects; ++I) {
+        IntegerType *Ty = IntegerType::get(Context, 7 + I % 50);
+        Result.push_back(Ty);
+        Result.push_back(ArrayType::get(Ty, I));
+        Result.push_back(ConstantInt::get(Ty, I));
+        Result.push_back(UndefValue::get(Ty));
+        MDString *S = MDString::get(Context, std::to_string(I));
+        Result.push_back(S);
+        Result.push_back(MDTuple::get(Context, S));
+        Result.push_back(
+            Attribute::get(Context, "attr", S->getString()).getRawPointer());
+        Result.push_back(InlineAsm::get(
+            FunctionType::get(Type::getVoidTy(Context), {Ty}, false),
+            "nop " + std::to_string(I), "r", /*hasSideEffects=*/true));
+        Result.push_back(
+            Context.getOrInsertBundleTag("tag" + std::to_string(I)));
+        Result.push_back(reinterpret_cast<const void *>(uintptr_t(
+            Context.getOrInsertSyncScopeID("scope" + std::to_string(I)))));
+      }
+    });
+  for (std::thread &T : Threads)
+    T.join();
+
+  for (unsigned T = 1; T != NumThreads; ++T)
+    EXPECT_EQ(Results[T], Results[0]);
+}
+#endif
+
 } // end anonymous namespace
 } // end namespace llvm
@@ -10,6 +10,7 @@
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
@@ -19,6 +20,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Transforms/Scalar/SimplifyCFG.h"
 #include "gtest/gtest.h"
+#include <thread>
 
 using namespace llvm;
 
@@ -950,4 +952,86 @@ TEST_F(PassManagerTest, FunctionPassCFGCheckerWrapped) {
   FPM.addPass(TestSimplifyCFGWrapperPass(InnerFPM));
   FPM.run(*F, FAM);
 }
+
+struct SleepingPass : PassInfoMixin<SleepingPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return PreservedAnalyses::all();
+  }
+};
+
+struct CountingPass : PassInfoMixin<CountingPass> {
+  CountingPass(int &RunCount) : RunCount(RunCount) {}
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+    ++RunCount;
+    return PreservedAnalyses::all();
+  }
+  int &RunCount;
+};
+
+// Records whether the function is marked as over its compile-time budget.
+struct BudgetAttrPass : PassInfoMixin<BudgetAttrPass> {
+  BudgetAttrPass(bool &HasAttr) : HasAttr(HasAttr) {}
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+    HasAttr = F.hasFnAttribute("compile-time-budget-exceeded");
+    return PreservedAnalyses::all();
+  }
+  static bool isRequired() { return true; }
+  bool &HasAttr;
+};
+
+struct BudgetRemarkHandler : DiagnosticHandler {
+  SmallVector<std::string, 2> RemarkNames;
+
+  bool isAnalysisRemarkEnabled(StringRef PassName) const override {
+    return PassName == "compile-time-budget";
+  }
+  bool handleDiagnostics(const DiagnosticInfo &DI) override {
+    if (auto *Remark = dyn_cast<OptimizationRemarkAnalysis>(&DI))
+      RemarkNames.push_back(Remark->getRemarkName().str());
+    return true;
+  }
+};
+
+// Optional passes stop running on a function once twice its budget has been
+// spent on it, but keep running on other functions.
+TEST_F(PassManagerTest, CompileTimeBudget) {
+  auto Handler = std::make_unique<BudgetRemarkHandler>();
+  BudgetRemarkHandler &Remarks = *Handler;
+  Context.setDiagnosticHandler(std::move(Handler));
+
+  int AnalysisRuns = 0;
+  FunctionAnalysisManager FAM;
+  PassInstrumentationCallbacks PIC;
+  CompileTimeBudgetInstrumentation Budget(std::chrono::milliseconds(5));
+  Budget.registerCallbacks(PIC);
+  FAM.registerPass([&] { return PassInstrumentationAnalysis(&PIC); });
+  FAM.registerPass([&] { return TestFunctionAnalysis(AnalysisRuns); });
+
+  int RunCount = 0;
+  bool HadAttr = false;
+  FunctionPassManager FPM;
+  FPM.addPass(SleepingPass());
+  FPM.addPass(CountingPass(RunCount));
+  FPM.addPass(RequireAnalysisPass<TestFunctionAnalysis, Function>());
+  FPM.addPass(BudgetAttrPass(HadAttr));
+
+  Function *F = M->getFunction("f");
+  FPM.run(*F, FAM);
+  EXPECT_EQ(RunCount, 0);
+  EXPECT_EQ(AnalysisRuns, 1);
+  // The required passes still run, and see the attribute, which is removed
+  // once they are done.
+  EXPECT_TRUE(HadAttr);
+  EXPECT_FALSE(F->hasFnAttribute("compile-time-budget-exceeded"));
+  EXPECT_EQ(Remarks.RemarkNames,
+            (SmallVector<std::string, 2>{"CompileTimeBudgetExhausted"}));
+
+  Function *G = M->getFunction("g");
+  FunctionPassManager OtherFPM;
+  OtherFPM.addPass(CountingPass(RunCount));
+  OtherFPM.run(*G, FAM);
+  EXPECT_EQ(RunCount, 1);
+  EXPECT_FALSE(G->hasFnAttribute("compile-time-budget-exceeded"));
+}
 }
@@ -9,6 +9,7 @@
 #include "llvm/IR/User.h"
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -173,4 +174,50 @@ TEST(UserTest, PersonalityUser) {
   EXPECT_TRUE(TestF->user_empty());
 }
 
+TEST(UserTest, UserArena) {
+  LLVMContext C;
+  C.setUseUserArena(true);
+
+  // Parsing allocates from the arena. Cover fixed, hung off and descriptor
+  // operands.
+  const char *ModuleString = "declare void @g()\n"
+                             "define i32 @f(i1 %c, i32 %x) {\n"
+                             "entry:\n"
+                             "  br i1 %c, label %a, label %b\n"
+                             "a:\n"
+                             "  call void @g() [ \"deopt\"(i32 %x) ]\n"
+                             "  br label %b\n"
+                             "b:\n"
+                             "  %p = phi i32 [ 0, %entry ], [ %x, %a ]\n"
+                             "  %r = add i32 %p, 1\n"
+                             "  ret i32 %r\n"
+                             "}\n";
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(ModuleString, Err, C);
+  ASSERT_TRUE(M);
+
+  // The memory of a deleted User is reused by the next one of its size.
+  Instruction *Ret = M->getFunction("f")->back().getTerminator();
+  auto *Add = cast<Instruction>(Ret->getOperand(0));
+  Value *P = Add->getOperand(0);
+  Ret->setOperand(0, P);
+  Add->eraseFromParent();
+  {
+    UserArenaScope Scope(C);
+    IRBuilder<> B(Ret);
+    Value *Sub = B.CreateSub(P, B.getInt32(1));
+    EXPECT_EQ(Sub, Add);
+    Ret->setOperand(0, Sub);
+  }
+
+  // A context without an arena keeps allocating from the heap.
+  C.setUseUserArena(false);
+  {
+    UserArenaScope Scope(C);
+    Instruction *Mul = BinaryOperator::CreateMul(P, P, "", Ret);
+    Ret->setOperand(0, Mul);
+  }
+  M.reset();
+}
+
 } // end anonymous namespace
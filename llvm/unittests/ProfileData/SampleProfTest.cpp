@@ -39,6 +39,13 @@ static ::testing::AssertionResult NoError(std::error_code EC) {
 
 namespace {
 
+// Exposes the table that maps each function to the offset of its profile.
+struct ExtBinaryReader : SampleProfileReaderExtBinary {
+  using SampleProfileReaderExtBinary::SampleProfileReaderExtBinary;
+  using SampleProfileReaderExtBinary::readHeader;
+  size_t getFuncOffsetTableSize() const { return FuncOffsetTable.size(); }
+};
+
 struct SampleProfTest : ::testing::Test {
   LLVMContext Context;
   std::unique_ptr<SampleProfileWriter> Writer;
@@ -396,6 +403,78 @@ struct SampleProfTest : ::testing::Test {
       ASSERT_EQ(I->getValue(), Esamples);
     }
   }
+
+  // Context-sensitive profiles of the functions of a module are loaded on
+  // demand by walking their ordered contexts, which lets the reader leave the
+  // function offset table empty.
+  void testCSOnDemandLoading(bool UseMD5) {
+    TempFile ProfileFile("profile", "", "", /*Unique*/ true);
+    createWriter(SampleProfileFormat::SPF_Ext_Binary, ProfileFile.path());
+    if (UseMD5)
+      static_cast<SampleProfileWriterExtBinary *>(Writer.get())->setUseMD5();
+
+    // main, foo and bar are defined in the module, ext and ext2 are not.
+    std::list<SampleContextFrameVector> CSNameTable;
+    SampleProfileMap Profiles;
+    auto AddProfile = [&](StringRef ContextStr, uint64_t Samples) {
+      SampleContext FContext(ContextStr, CSNameTable);
+      FunctionSamples &FSamples = Profiles[FContext];
+      FSamples.setContext(FContext);
+      FSamples.addTotalSamples(Samples);
+      FSamples.addBodySamples(1, 0, Samples);
+    };
+    AddProfile("[main:1 @ foo]", 100);
+    AddProfile("[main:1 @ foo:2 @ bar]", 50);
+    AddProfile("[ext:3 @ bar]", 20);
+    AddProfile("[ext:1 @ ext2]", 30);
+    AddProfile("[ext]", 10);
+
+    FunctionSamples::ProfileIsCS = true;
+    ASSERT_TRUE(NoError(Writer->write(Profiles)));
+    Writer->getOutputStream().flush();
+
+    Module M("my_module", Context);
+    FunctionType *FnType =
+        FunctionType::get(Type::getVoidTy(Context), {}, false);
+    for (StringRef Name : {"main", "foo", "bar"})
+      M.getOrInsertFunction(Name, FnType);
+
+    for (bool UseModule : {true, false}) {
+      auto BufferOrErr = MemoryBuffer::getFile(ProfileFile.path());
+      ASSERT_TRUE(NoError(BufferOrErr.getError()));
+      ExtBinaryReader CSReader(std::move(*BufferOrErr), Context);
+      ASSERT_TRUE(NoError(CSReader.readHeader()));
+      if (UseModule)
+        CSReader.setModule(&M);
+      ASSERT_TRUE(NoError(CSReader.read()));
+      ASSERT_TRUE(CSReader.profileIsCS());
+      EXPECT_EQ(CSReader.getFuncOffsetTableSize(), 0u);
+
+      SampleProfileMap &ReadProfiles = CSReader.getProfiles();
+      uint64_t Total = 0;
+      for (const auto &I : ReadProfiles)
+        Total += I.second.getTotalSamples();
+      if (!UseModule) {
+        // Without a module, every profile is loaded.
+        EXPECT_EQ(ReadProfiles.size(), 5u);
+        EXPECT_EQ(Total, 210u);
+        continue;
+      }
+
+      // The contexts of foo and bar are loaded, together with those of their
+      // callees, while the contexts of ext and ext2 alone are not.
+      EXPECT_EQ(ReadProfiles.size(), 3u);
+      EXPECT_EQ(Total, 170u);
+      if (!UseMD5) {
+        for (StringRef ContextStr :
+             {"[main:1 @ foo]", "[main:1 @ foo:2 @ bar]", "[ext:3 @ bar]"})
+          EXPECT_EQ(ReadProfiles.count(SampleContext(ContextStr, CSNameTable)),
+                    1u)
+              << ContextStr.str();
+      }
+    }
+    FunctionSamples::ProfileIsCS = false;
+  }
 };
 
 TEST_F(SampleProfTest, roundtrip_text_profile) {
@@ -430,6 +509,14 @@ TEST_F(SampleProfTest, remap_ext_binary_profile) {
   testRoundTrip(SampleProfileFormat::SPF_Ext_Binary, true, false);
 }
 
+TEST_F(SampleProfTest, cs_ext_binary_profile_on_demand_loading) {
+  testCSOnDemandLoading(false);
+}
+
+TEST_F(SampleProfTest, cs_md5_ext_binary_profile_on_demand_loading) {
+  testCSOnDemandLoading(true);
+}
+
 TEST_F(SampleProfTest, sample_overflow_saturation) {
   const uint64_t Max = std::numeric_limits<uint64_t>::max();
   sampleprof_error Result;
@@ -0,0 +1,104 @@
+//===- CachingTest.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Caching.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Testing/Support/Error.h"
+#include "llvm/Testing/Support/SupportHelpers.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using llvm::unittest::TempDir;
+
+namespace {
+
+class InMemoryStore : public RemoteCacheStore {
+public:
+  StringMap<std::string> Entries;
+  unsigned Gets = 0;
+  std::vector<std::string> Discarded;
+
+  Expected<std::unique_ptr<MemoryBuffer>> get(StringRef Key) override {
+    ++Gets;
+    auto I = Entries.find(Key);
+    if (I == Entries.end())
+      return nullptr;
+    return MemoryBuffer::getMemBufferCopy(I->second, Key);
+  }
+
+  Error put(StringRef Key, StringRef Data) override {
+    Entries[Key] = Data.str();
+    return Error::success();
+  }
+
+  void discard(StringRef Key) override { Discarded.push_back(Key.str()); }
+};
+
+struct TieredCacheTest : public ::testing::Test {
+  TempDir Dir{"tiered-cache", /*Unique=*/true};
+  std::shared_ptr<InMemoryStore> Remote = std::make_shared<InMemoryStore>();
+  std::vector<std::string> Added;
+
+  FileCache makeCache() {
+    Expected<FileCache> Local = localCache(
+        "Test", "Test", Dir.path(),
+        [this](size_t Task, std::unique_ptr<MemoryBuffer> MB) {
+          Added.push_back(MB->getBuffer().str());
+        });
+    EXPECT_THAT_EXPECTED(Local, Succeeded());
+    return tieredCache(std::move(*Local), Remote);
+  }
+
+  // Looks up Key, producing Contents on a miss. Returns true on a hit.
+  bool lookup(FileCache &Cache, StringRef Key, StringRef Contents) {
+    Expected<AddStreamFn> AddStream = Cache(0, Key);
+    EXPECT_THAT_EXPECTED(AddStream, Succeeded());
+    if (!*AddStream)
+      return true;
+    Expected<std::unique_ptr<CachedFileStream>> Stream = (*AddStream)(0);
+    EXPECT_THAT_EXPECTED(Stream, Succeeded());
+    *(*Stream)->OS << Contents;
+    return false;
+  }
+};
+
+} // namespace
+
+TEST_F(TieredCacheTest, MissUploadsToRemote) {
+  FileCache Cache = makeCache();
+  EXPECT_FALSE(lookup(Cache, "key", "contents"));
+  ASSERT_EQ(1u, Added.size());
+  EXPECT_EQ("contents", Added[0]);
+  EXPECT_EQ("contents", Remote->Entries.lookup("key"));
+
+  // The entry is now in the local tier, the remote one is not consulted and
+  // may free whatever it prefetched for it.
+  EXPECT_TRUE(hasLocalCacheEntry(Dir.path(), "key"));
+  EXPECT_FALSE(hasLocalCacheEntry(Dir.path(), "other"));
+  EXPECT_TRUE(lookup(Cache, "key", ""));
+  EXPECT_EQ(1u, Remote->Gets);
+  ASSERT_EQ(1u, Remote->Discarded.size());
+  EXPECT_EQ("key", Remote->Discarded[0]);
+  ASSERT_EQ(2u, Added.size());
+  EXPECT_EQ("contents", Added[1]);
+}
+
+TEST_F(TieredCacheTest, RemoteHitIsWrittenThrough) {
+  Remote->Entries["key"] = "remote";
+  FileCache Cache = makeCache();
+  EXPECT_TRUE(lookup(Cache, "key", ""));
+  ASSERT_EQ(1u, Added.size());
+  EXPECT_EQ("remote", Added[0]);
+
+  // Drop the remote entry; the local tier must now satisfy the lookup.
+  Remote->Entries.clear();
+  EXPECT_TRUE(lookup(Cache, "key", ""));
+  ASSERT_EQ(2u, Added.size());
+  EXPECT_EQ("remote", Added[1]);
+}
@@ -2012,6 +2012,35 @@ TEST(CommandLineTest, ResetAllOptionOccurrences) {
   EXPECT_EQ(0u, ExtraArgs.size());
 }
 
+TEST(CommandLineTest, GetOptionOccurrences) {
+  cl::ResetCommandLineParser();
+
+  StackOption<bool> Option("option");
+  StackOption<std::string> Str("str");
+  StackOption<std::string> Input(cl::Positional);
+
+  const char *Args[] = {"prog", "-str=a", "input", "-option", "-str=b"};
+  std::string Errs;
+  raw_string_ostream OS(Errs);
+  EXPECT_TRUE(cl::ParseCommandLineOptions(5, Args, StringRef(), &OS));
+  EXPECT_TRUE(OS.str().empty());
+
+  ArrayRef<cl::OptionOccurrence> Occurrences = cl::getOptionOccurrences();
+  ASSERT_EQ(4u, Occurrences.size());
+  EXPECT_EQ(&Str, Occurrences[0].Opt);
+  EXPECT_EQ("str", Occurrences[0].ArgName);
+  EXPECT_EQ("a", Occurrences[0].Value);
+  EXPECT_EQ(&Input, Occurrences[1].Opt);
+  EXPECT_EQ("input", Occurrences[1].Value);
+  EXPECT_EQ(&Option, Occurrences[2].Opt);
+  EXPECT_EQ("option", Occurrences[2].ArgName);
+  EXPECT_EQ(&Str, Occurrences[3].Opt);
+  EXPECT_EQ("b", Occurrences[3].Value);
+
+  cl::ResetAllOptionOccurrences();
+  EXPECT_TRUE(cl::getOptionOccurrences().empty());
+}
+
 TEST(CommandLineTest, DefaultValue) {
   cl::ResetCommandLineParser();
 
@@ -70,4 +70,62 @@ TEST(CompressionTest, ZlibCRC32) {
 
 #endif
 
+void TestZstdCompression(StringRef Input, int Level) {
+  SmallString<32> Compressed;
+  SmallString<32> Uncompressed;
+
+  zstd::compress(Input, Compressed, Level);
+
+  // Check that uncompressed buffer is the same as original.
+  Error E = zstd::uncompress(Compressed, Uncompressed, Input.size());
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+
+  EXPECT_EQ(Input, Uncompressed);
+  if (Input.size() > 0) {
+    // Uncompression fails if expected length is too short.
+    E = zstd::uncompress(Compressed, Uncompressed, Input.size() - 1);
+    EXPECT_EQ("Destination buffer is too small", llvm::toString(std::move(E)));
+  }
+}
+
+// LLVM_ENABLE_ZSTD is private to Compression.cpp, so check at run time.
+TEST(CompressionTest, Zstd) {
+  if (!zstd::isAvailable())
+    GTEST_SKIP();
+
+  TestZstdCompression("", zstd::DefaultCompression);
+
+  TestZstdCompression("hello, world!", zstd::NoCompression);
+  TestZstdCompression("hello, world!", zstd::BestSizeCompression);
+  TestZstdCompression("hello, world!", zstd::BestSpeedCompression);
+  TestZstdCompression("hello, world!", zstd::DefaultCompression);
+
+  const size_t kSize = 1024;
+  char BinaryData[kSize];
+  for (size_t i = 0; i < kSize; ++i)
+    BinaryData[i] = i & 255;
+  StringRef BinaryDataStr(BinaryData, kSize);
+
+  TestZstdCompression(BinaryDataStr, zstd::NoCompression);
+  TestZstdCompression(BinaryDataStr, zstd::BestSizeCompression);
+  TestZstdCompression(BinaryDataStr, zstd::BestSpeedCompression);
+  TestZstdCompression(BinaryDataStr, zstd::DefaultCompression);
+}
+
+TEST(CompressionTest, ZstdConcatenatedFrames) {
+  if (!zstd::isAvailable())
+    GTEST_SKIP();
+
+  // Independently compressed frames decompress as their concatenation.
+  SmallString<32> Frame1, Frame2, Uncompressed;
+  zstd::compress("hello, ", Frame1);
+  zstd::compress("world!", Frame2);
+  Frame1 += Frame2;
+  Error E = zstd::uncompress(Frame1, Uncompressed, 13);
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+  EXPECT_EQ("hello, world!", Uncompressed);
+}
+
 }
@@ -415,6 +415,34 @@ TEST_F(MemoryBufferTest, mmapVolatileNoNull) {
   EXPECT_TRUE(MB->getBuffer().startswith("01234567"));
 }
 
+TEST_F(MemoryBufferTest, dontNeedRange) {
+  // Verify that releasing a range of an mmapped buffer, including a range
+  // that is not page-aligned, keeps the contents readable.
+  int FD;
+  SmallString<64> TestPath;
+  ASSERT_NO_ERROR(sys::fs::createTemporaryFile(
+      "MemoryBufferTest_dontNeedRange", "temp", FD, TestPath));
+  FileRemover Cleanup(TestPath);
+  raw_fd_ostream OF(FD, true);
+  unsigned PageSize = sys::Process::getPageSizeEstimate();
+  unsigned FileWrites = (PageSize * 8) / 8;
+  for (unsigned i = 0; i < FileWrites; ++i)
+    OF << "01234567";
+  OF.close();
+
+  ErrorOr<OwningBuffer> MBOrError = MemoryBuffer::getFile(
+      TestPath, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+  ASSERT_NO_ERROR(MBOrError.getError())
+  OwningBuffer MB = std::move(*MBOrError);
+  EXPECT_EQ(MB->getBufferKind(), MemoryBuffer::MemoryBuffer_MMap);
+  std::string Before = MB->getBuffer().str();
+
+  MB->dontNeedIfMmap(PageSize + 3, PageSize * 4);
+  MB->dontNeedIfMmap(0, 5);
+  MB->dontNeedIfMmap(0, MB->getBufferSize());
+  EXPECT_EQ(Before, MB->getBuffer());
+}
+
 // Test that SmallVector without a null terminator gets one.
 TEST(SmallVectorMemoryBufferTest, WithoutNullTerminatorRequiresNullTerminator) {
   SmallString<0> Data("some data");
@@ -14,6 +14,7 @@
 #include "llvm/Support/Parallel.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
 #include <random>
 
 uint32_t array[1024 * 1024];
@@ -80,6 +81,41 @@ TEST(Parallel, TransformReduce) {
   EXPECT_EQ(sum, 3060U);
 }
 
+TEST(Parallel, WorkStealingExecutor) {
+  parallel::ExecutorKind saved = parallel::executorKind;
+  parallel::executorKind = parallel::ExecutorKind::WorkStealing;
+
+  uint32_t range[2050];
+  std::fill(range, range + 2050, 1);
+  parallelForEachN(0, 2049, [&range](size_t I) { ++range[I]; });
+  uint32_t expected[2049];
+  std::fill(expected, expected + 2049, 2);
+  ASSERT_TRUE(std::equal(range, range + 2049, expected));
+  ASSERT_EQ(range[2049], 1u);
+
+  // Tasks spawned from worker threads go to the worker's own deque and must
+  // still be run.
+  std::atomic<unsigned> count{0};
+  {
+    parallel::detail::TaskGroup tg;
+    for (int i = 0; i != 64; ++i)
+      tg.spawn([&] {
+        for (int j = 0; j != 16; ++j)
+          tg.spawn([&] { ++count; });
+      });
+  }
+  EXPECT_EQ(count, 64u * 16u);
+
+  std::mt19937 randEngine;
+  std::uniform_int_distribution<uint32_t> dist;
+  for (auto &i : array)
+    i = dist(randEngine);
+  parallelSort(std::begin(array), std::end(array));
+  ASSERT_TRUE(llvm::is_sorted(array));
+
+  parallel::executorKind = saved;
+}
+
 TEST(Parallel, ForEachError) {
   int nums[] = {1, 2, 3, 4, 5, 6};
   Error e = parallelForEachError(nums, [](int v) -> Error {
@@ -0,0 +1,95 @@
+//===- unittests/Support/SuffixArrayTest.cpp - suffix array tests ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/SuffixArray.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/SuffixTree.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+using Repeat = std::pair<unsigned, std::vector<unsigned>>;
+
+std::vector<Repeat> sorted(std::vector<Repeat> Repeats) {
+  for (Repeat &R : Repeats)
+    llvm::sort(R.second);
+  llvm::sort(Repeats);
+  return Repeats;
+}
+
+std::vector<unsigned> randomString(std::mt19937 &Gen, unsigned Length,
+                                   unsigned AlphabetSize) {
+  std::uniform_int_distribution<unsigned> Dist(0, AlphabetSize - 1);
+  std::vector<unsigned> Str;
+  for (unsigned I = 0; I != Length; ++I)
+    Str.push_back(Dist(Gen));
+  return Str;
+}
+
+TEST(SuffixArrayTest, SortsSuffixes) {
+  std::mt19937 Gen(0);
+  for (unsigned Length : {1u, 2u, 5u, 17u, 100u, 1000u}) {
+    for (unsigned AlphabetSize : {1u, 2u, 4u, 300u}) {
+      std::vector<unsigned> Str = randomString(Gen, Length, AlphabetSize);
+      SuffixArray SA(Str);
+
+      std::vector<unsigned> Expected(Length);
+      std::iota(Expected.begin(), Expected.end(), 0);
+      llvm::sort(Expected, [&](unsigned A, unsigned B) {
+        return std::lexicographical_compare(Str.begin() + A, Str.end(),
+                                            Str.begin() + B, Str.end());
+      });
+      ASSERT_EQ(SA.suffixes(), makeArrayRef(Expected));
+
+      ArrayRef<unsigned> LCP = SA.longestCommonPrefixes();
+      EXPECT_EQ(LCP[0], 0u);
+      for (unsigned I = 1; I < Length; ++I) {
+        unsigned A = Expected[I - 1], B = Expected[I], Len = 0;
+        while (A + Len < Length && B + Len < Length &&
+               Str[A + Len] == Str[B + Len])
+          ++Len;
+        EXPECT_EQ(LCP[I], Len);
+      }
+    }
+  }
+}
+
+TEST(SuffixArrayTest, LargeElements) {
+  std::vector<unsigned> Str = {-3u, 7, -4u, 7, -3u, 7, 0};
+  SuffixArray SA(Str);
+  EXPECT_EQ(SA.suffixes(), makeArrayRef<unsigned>({6, 5, 1, 3, 2, 4, 0}));
+}
+
+// The repeated substrings are those the suffix tree finds, as long as the
+// string ends with a unique element, as the outliner's strings do.
+TEST(SuffixArrayTest, MatchesSuffixTree) {
+  std::mt19937 Gen(1);
+  for (unsigned Length : {2u, 10u, 64u, 500u}) {
+    for (unsigned AlphabetSize : {1u, 2u, 3u, 10u}) {
+      std::vector<unsigned> Str = randomString(Gen, Length, AlphabetSize);
+      Str.push_back(AlphabetSize);
+
+      std::vector<Repeat> FromTree, FromArray;
+      SuffixTree ST(Str);
+      for (const SuffixTree::RepeatedSubstring &RS : ST)
+        FromTree.emplace_back(RS.Length, RS.StartIndices);
+      for (const SuffixArray::RepeatedSubstring &RS :
+           SuffixArray(Str).getRepeatedSubstrings())
+        FromArray.emplace_back(RS.Length, RS.StartIndices);
+      EXPECT_EQ(sorted(FromArray), sorted(FromTree));
+    }
+  }
+}
+
+} // namespace
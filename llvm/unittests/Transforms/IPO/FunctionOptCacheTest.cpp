@@ -0,0 +1,247 @@
+//===- FunctionOptCacheTest.cpp - Unit tests for FunctionOptCachePass -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionOptCache.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+namespace {
+
+/// Folds `add X, 0`, calls @trace on entry and counts the functions it ran on.
+struct TestOptPass : PassInfoMixin<TestOptPass> {
+  unsigned &Runs;
+
+  TestOptPass(unsigned &Runs) : Runs(Runs) {}
+
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &) {
+    ++Runs;
+    for (Instruction &I : make_early_inc_range(instructions(F)))
+      if (match(&I, m_Add(m_Value(), m_Zero()))) {
+        I.replaceAllUsesWith(I.getOperand(0));
+        I.eraseFromParent();
+      }
+    FunctionCallee Trace = F.getParent()->getOrInsertFunction(
+        "trace", Type::getVoidTy(F.getContext()));
+    IRBuilder<>(&*F.getEntryBlock().getFirstInsertionPt()).CreateCall(Trace);
+    return PreservedAnalyses::none();
+  }
+};
+
+class FunctionOptCacheTest : public testing::Test {
+  void SetUp() override {
+    ASSERT_FALSE(
+        sys::fs::createUniqueDirectory("function-opt-cache-test", CacheDir));
+  }
+
+  void TearDown() override { sys::fs::remove_directories(CacheDir); }
+
+public:
+  SmallString<256> CacheDir;
+  unsigned Runs = 0;
+
+  std::unique_ptr<Module> parse(LLVMContext &Ctx, StringRef IR) {
+    SMDiagnostic Err;
+    std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+    if (!M)
+      Err.print("FunctionOptCacheTest", errs());
+    return M;
+  }
+
+  /// Optimizes the definitions in \p M, as a separate compilation would, with
+  /// the library functions of \p TLII if given.
+  void optimize(Module &M, const TargetLibraryInfoImpl *TLII = nullptr) {
+    FunctionAnalysisManager FAM;
+    FAM.registerPass([] { return PassInstrumentationAnalysis(); });
+    if (TLII)
+      FAM.registerPass([&] { return TargetLibraryAnalysis(*TLII); });
+    else
+      FAM.registerPass([] { return TargetLibraryAnalysis(); });
+    FAM.registerPass([] { return AAManager(); });
+    FunctionPassManager FPM;
+    FPM.addPass(TestOptPass(Runs));
+    FunctionOptCachePass Pass(std::move(FPM), std::string(CacheDir));
+    for (Function &F : M)
+      if (!F.isDeclaration())
+        FAM.invalidate(F, Pass.run(F, FAM));
+    EXPECT_FALSE(verifyModule(M, &errs()));
+  }
+
+  static std::string print(const Function &F) {
+    std::string Str;
+    raw_string_ostream OS(Str);
+    F.print(OS);
+    return OS.str();
+  }
+};
+
+const char *const FunctionIR = R"(
+  %struct.S = type { i32, i32 }
+
+  @str = private unnamed_addr constant [4 x i8] c"abc\00"
+
+  declare i32 @use(%struct.S*, i8*)
+
+  define i32 @f(i32 %x) {
+    %s = alloca %struct.S
+    %a = add i32 %x, 0
+    %p = getelementptr %struct.S, %struct.S* %s, i32 0, i32 1
+    store i32 %a, i32* %p
+    %str = getelementptr [4 x i8], [4 x i8]* @str, i32 0, i32 0
+    %r = call i32 @use(%struct.S* %s, i8* %str)
+    ret i32 %r
+  }
+)";
+
+TEST_F(FunctionOptCacheTest, ReusesOptimizedBody) {
+  LLVMContext Ctx1;
+  std::unique_ptr<Module> M1 = parse(Ctx1, FunctionIR);
+  ASSERT_TRUE(M1);
+  optimize(*M1);
+  EXPECT_EQ(Runs, 1u);
+
+  // The entry is read into a context that has the module's struct types
+  // already, so its own are renamed and have to be mapped.
+  LLVMContext Ctx2;
+  std::unique_ptr<Module> M2 = parse(Ctx2, FunctionIR);
+  ASSERT_TRUE(M2);
+  optimize(*M2);
+  EXPECT_EQ(Runs, 1u);
+
+  EXPECT_EQ(print(*M2->getFunction("f")), print(*M1->getFunction("f")));
+  EXPECT_TRUE(M2->getFunction("trace"));
+  for (Instruction &I : instructions(M2->getFunction("f")))
+    if (auto *Alloca = dyn_cast<AllocaInst>(&I))
+      EXPECT_EQ(Alloca->getAllocatedType(),
+                StructType::getTypeByName(Ctx2, "struct.S"));
+}
+
+TEST_F(FunctionOptCacheTest, KeyCoversCallees) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M1 = parse(Ctx, FunctionIR);
+  ASSERT_TRUE(M1);
+  optimize(*M1);
+
+  // The callee's attributes are part of what the pipeline saw.
+  std::string IR = FunctionIR;
+  IR.replace(IR.find("i8*)"), 4, "i8*) readonly");
+  std::unique_ptr<Module> M2 = parse(Ctx, IR);
+  ASSERT_TRUE(M2);
+  optimize(*M2);
+  EXPECT_EQ(Runs, 2u);
+}
+
+TEST_F(FunctionOptCacheTest, KeyCoversLibraryInfo) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M1 = parse(Ctx, FunctionIR);
+  std::unique_ptr<Module> M2 = parse(Ctx, FunctionIR);
+  std::unique_ptr<Module> M3 = parse(Ctx, FunctionIR);
+  ASSERT_TRUE(M1 && M2 && M3);
+  Triple TT(M1->getTargetTriple());
+  optimize(*M1);
+
+  // As with -fno-builtin.
+  TargetLibraryInfoImpl NoBuiltins(TT);
+  NoBuiltins.disableAllFunctions();
+  optimize(*M2, &NoBuiltins);
+  EXPECT_EQ(Runs, 2u);
+
+  // As with -fveclib.
+  TargetLibraryInfoImpl VecLib(TT);
+  VecLib.addVectorizableFunctionsFromVecLib(TargetLibraryInfoImpl::SVML);
+  optimize(*M3, &VecLib);
+  EXPECT_EQ(Runs, 3u);
+}
+
+TEST_F(FunctionOptCacheTest, PairsStructsByUse) {
+  // The entry's structs are renamed when it is read, and pair up with the
+  // module's by where the function uses them, including those that are only
+  // reached through others.
+  const char *IR = R"(
+    %struct.Inner = type { i32 }
+    %struct.Outer = type { %struct.Inner, i64 }
+    %struct.List = type { %struct.List*, %struct.Inner }
+
+    @g = external global %struct.Outer
+
+    define i32 @f(i32 %x, %struct.List* %l) {
+      %i = alloca %struct.Inner
+      %a = add i32 %x, 0
+      %p = getelementptr %struct.Inner, %struct.Inner* %i, i32 0, i32 0
+      store i32 %a, i32* %p
+      %q = getelementptr %struct.Outer, %struct.Outer* @g, i32 0, i32 0, i32 0
+      %v = load i32, i32* %q
+      %n = getelementptr %struct.List, %struct.List* %l, i32 0, i32 1, i32 0
+      %w = load i32, i32* %n
+      %r = add i32 %v, %w
+      ret i32 %r
+    }
+  )";
+  LLVMContext Ctx1;
+  std::unique_ptr<Module> M1 = parse(Ctx1, IR);
+  ASSERT_TRUE(M1);
+  optimize(*M1);
+
+  LLVMContext Ctx2;
+  std::unique_ptr<Module> M2 = parse(Ctx2, IR);
+  ASSERT_TRUE(M2);
+  optimize(*M2);
+  EXPECT_EQ(Runs, 1u);
+
+  Function *F = M2->getFunction("f");
+  auto *Inner = cast<AllocaInst>(&*inst_begin(F))->getAllocatedType();
+  auto *Outer = M2->getNamedGlobal("g")->getValueType();
+  auto *List = F->getArg(1)->getType()->getPointerElementType();
+  for (Instruction &I : instructions(F)) {
+    auto *GEP = dyn_cast<GetElementPtrInst>(&I);
+    if (!GEP)
+      continue;
+    Type *Ty = GEP->getSourceElementType();
+    EXPECT_TRUE(Ty == Inner || Ty == Outer || Ty == List);
+    EXPECT_EQ(GEP->getPointerOperandType()->getPointerElementType(), Ty);
+  }
+}
+
+TEST_F(FunctionOptCacheTest, SkipsInternalVariables) {
+  const char *IR = R"(
+    @v = internal global i32 0
+
+    define i32 @f(i32 %x) {
+      %a = add i32 %x, 0
+      store i32 %a, i32* @v
+      ret i32 %a
+    }
+  )";
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M1 = parse(Ctx, IR);
+  std::unique_ptr<Module> M2 = parse(Ctx, IR);
+  ASSERT_TRUE(M1 && M2);
+  optimize(*M1);
+  optimize(*M2);
+  EXPECT_EQ(Runs, 2u);
+
+  std::error_code EC;
+  sys::fs::directory_iterator Entry(CacheDir, EC);
+  EXPECT_FALSE(EC);
+  EXPECT_EQ(Entry, sys::fs::directory_iterator());
+}
+
+} // end anonymous namespace
@@ -0,0 +1,129 @@
+//===- SampleContextTrackerTest.cpp - Unit tests for SampleContextTracker -===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/SampleContextTracker.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace sampleprof;
+
+namespace {
+
+// main, foo and bar are defined in the module, ext and ext2 are not.
+const char *const Profile = R"([main:1 @ foo]:100:0
+ 1: 100
+[main:1 @ foo:2 @ bar]:50:0
+ 1: 50
+[ext:3 @ bar]:20:0
+ 1: 20
+[ext:1 @ ext2]:30:0
+ 1: 30
+[ext]:10:0
+ 1: 10
+)";
+
+class SampleContextTrackerTest : public testing::Test {
+protected:
+  SampleContextTrackerTest() : M("my_module", C) {
+    FunctionType *FTy = FunctionType::get(Type::getVoidTy(C), false);
+    for (StringRef Name : {"main", "foo", "bar"})
+      Function::Create(FTy, Function::ExternalLinkage, Name, M);
+  }
+
+  // Each tracker gets its own profiles, as they are merged into base profiles
+  // in place.
+  std::unique_ptr<SampleContextTracker> createTracker(const Module *Mod) {
+    std::unique_ptr<MemoryBuffer> Buffer =
+        MemoryBuffer::getMemBuffer(Profile, "", false);
+    auto ReaderOrErr = SampleProfileReader::create(Buffer, C);
+    EXPECT_FALSE(ReaderOrErr.getError());
+    Readers.push_back(std::move(*ReaderOrErr));
+    EXPECT_FALSE(Readers.back()->read());
+    EXPECT_TRUE(Readers.back()->profileIsCS());
+    return std::make_unique<SampleContextTracker>(Readers.back()->getProfiles(),
+                                                  nullptr, Mod);
+  }
+
+  SampleContext getContext(StringRef ContextStr) {
+    return SampleContext(ContextStr, CSNameTable);
+  }
+
+  LLVMContext C;
+  Module M;
+  std::vector<std::unique_ptr<SampleProfileReader>> Readers;
+  std::list<SampleContextFrameVector> CSNameTable;
+};
+
+} // namespace
+
+TEST_F(SampleContextTrackerTest, SkipsContextsOutsideModule) {
+  std::unique_ptr<SampleContextTracker> Tracker = createTracker(&M);
+  EXPECT_EQ(Tracker->getContextSamplesFor(getContext("[ext:1 @ ext2]")),
+            nullptr);
+  EXPECT_EQ(Tracker->getContextSamplesFor(getContext("[ext]")), nullptr);
+  EXPECT_TRUE(Tracker->getAllContextSamplesFor("ext2").empty());
+  EXPECT_EQ(Tracker->getBaseSamplesFor("ext2"), nullptr);
+  EXPECT_EQ(Tracker->getBaseSamplesFor("ext"), nullptr);
+
+  // A context not named after a function of the module is kept when one of
+  // its callers is.
+  FunctionSamples *ExtBar =
+      Tracker->getContextSamplesFor(getContext("[ext:3 @ bar]"));
+  ASSERT_NE(ExtBar, nullptr);
+  EXPECT_EQ(ExtBar->getTotalSamples(), 20u);
+
+  // Without a module, every context is tracked.
+  std::unique_ptr<SampleContextTracker> FullTracker = createTracker(nullptr);
+  EXPECT_NE(FullTracker->getContextSamplesFor(getContext("[ext:1 @ ext2]")),
+            nullptr);
+  EXPECT_NE(FullTracker->getContextSamplesFor(getContext("[ext]")), nullptr);
+  EXPECT_EQ(FullTracker->getAllContextSamplesFor("ext2").size(), 1u);
+}
+
+TEST_F(SampleContextTrackerTest, ModuleFunctionsAreUnchanged) {
+  std::unique_ptr<SampleContextTracker> Tracker = createTracker(&M);
+  std::unique_ptr<SampleContextTracker> FullTracker = createTracker(nullptr);
+
+  for (StringRef Context : {"[main:1 @ foo]", "[main:1 @ foo:2 @ bar]"}) {
+    FunctionSamples *Samples =
+        Tracker->getContextSamplesFor(getContext(Context));
+    FunctionSamples *FullSamples =
+        FullTracker->getContextSamplesFor(getContext(Context));
+    ASSERT_NE(Samples, nullptr) << Context;
+    ASSERT_NE(FullSamples, nullptr) << Context;
+    EXPECT_EQ(Samples->getTotalSamples(), FullSamples->getTotalSamples())
+        << Context;
+  }
+
+  for (const Function &F : M) {
+    EXPECT_EQ(Tracker->getAllContextSamplesFor(F).size(),
+              FullTracker->getAllContextSamplesFor(F).size())
+        << F.getName();
+    FunctionSamples *Base = Tracker->getBaseSamplesFor(F);
+    FunctionSamples *FullBase = FullTracker->getBaseSamplesFor(F);
+    ASSERT_EQ(Base == nullptr, FullBase == nullptr) << F.getName();
+    if (Base)
+      EXPECT_EQ(Base->getTotalSamples(), FullBase->getTotalSamples())
+          << F.getName();
+  }
+
+  // The base profile of bar merges the contexts of both of its callers.
+  FunctionSamples *Bar = Tracker->getBaseSamplesFor("bar");
+  ASSERT_NE(Bar, nullptr);
+  EXPECT_EQ(Bar->getTotalSamples(), 70u);
+  FunctionSamples *Foo = Tracker->getBaseSamplesFor("foo");
+  ASSERT_NE(Foo, nullptr);
+  EXPECT_EQ(Foo->getTotalSamples(), 100u);
+}
@@ -0,0 +1,246 @@
+//===- MemProfUseTest.cpp - Matching of memprof profiles in PGO use -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemoryProfileInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/ProfileData/MemProf.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Testing/Support/Error.h"
+#include "llvm/Testing/Support/SupportHelpers.h"
+#include "llvm/Transforms/Instrumentation/PGOInstrumentation.h"
+#include "gtest/gtest.h"
+
+#include <set>
+
+using namespace llvm;
+using namespace llvm::memprof;
+
+namespace {
+
+// The calls of foo are at these lines and columns:
+// - %alloc:      3:10
+// - %unprofiled: 4:10, which is not in the profile
+// - %bar:        5:3
+// - %inlined:    2:5 in inlinee, which foo calls at 6:3
+const char *const TestIR = R"IR(
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @foo() !dbg !4 {
+entry:
+  %alloc = call ptr @malloc(i64 10), !dbg !7
+  %unprofiled = call ptr @malloc(i64 10), !dbg !8
+  %bar = call i32 @bar(), !dbg !9
+  %inlined = call ptr @malloc(i64 10), !dbg !10
+  ret void
+}
+
+declare noalias ptr @malloc(i64)
+declare i32 @bar()
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C_plus_plus_14, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "t.cc", directory: "/")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !DISubroutineType(types: !{})
+!4 = distinct !DISubprogram(name: "foo", linkageName: "foo", scope: !1, file: !1, line: 1, type: !3, scopeLine: 1, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0)
+!5 = distinct !DISubprogram(name: "inlinee", linkageName: "inlinee", scope: !1, file: !1, line: 1, type: !3, scopeLine: 1, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0)
+!6 = distinct !DILocation(line: 6, column: 3, scope: !4)
+!7 = !DILocation(line: 3, column: 10, scope: !4)
+!8 = !DILocation(line: 4, column: 10, scope: !4)
+!9 = !DILocation(line: 5, column: 3, scope: !4)
+!10 = !DILocation(line: 2, column: 5, scope: !5, inlinedAt: !6)
+)IR";
+
+// The frames of the profile, identified by the function, line offset and
+// column of their call.
+enum : FrameId {
+  AllocFrame,
+  Caller1Frame,
+  Caller2Frame,
+  BarCallFrame,
+  InlinedAllocFrame,
+  InlineeCallFrame,
+  // The column does not match the call of %alloc.
+  MismatchedAllocFrame,
+};
+
+class MemProfUseTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_THAT_ERROR(Writer.mergeProfileKind(InstrProfKind::MemProf),
+                      Succeeded());
+    addFrame(AllocFrame, "foo", 2, 10);
+    addFrame(Caller1Frame, "caller1", 1, 3);
+    addFrame(Caller2Frame, "caller2", 1, 3);
+    addFrame(BarCallFrame, "foo", 4, 3);
+    addFrame(InlinedAllocFrame, "inlinee", 1, 5, /*IsInlineFrame=*/true);
+    addFrame(InlineeCallFrame, "foo", 5, 3);
+    addFrame(MismatchedAllocFrame, "foo", 2, 11);
+
+    SMDiagnostic Err;
+    M = parseAssemblyString(TestIR, Err, C);
+    ASSERT_TRUE(M) << Err.getMessage();
+  }
+
+  void addFrame(FrameId Id, StringRef Function, uint32_t LineOffset,
+                uint32_t Column, bool IsInlineFrame = false) {
+    Writer.addMemProfFrame(
+        Id,
+        Frame(IndexedMemProfRecord::getGUID(Function), LineOffset, Column,
+              IsInlineFrame),
+        [](Error E) { ADD_FAILURE() << toString(std::move(E)); });
+  }
+
+  // Write the profile of foo and run PGO use with it.
+  void runPGOUse(const IndexedMemProfRecord &Record) {
+    Writer.addMemProfRecord(IndexedMemProfRecord::getGUID("foo"), Record);
+    std::unique_ptr<MemoryBuffer> Profile = Writer.writeBuffer();
+    unittest::TempFile ProfileFile("memprof", "profdata", Profile->getBuffer(),
+                                   /*Unique=*/true);
+
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    PassBuilder PB;
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    ModulePassManager MPM;
+    MPM.addPass(PGOInstrumentationUse(ProfileFile.path().str()));
+    MPM.run(*M, MAM);
+  }
+
+  CallBase *getCall(StringRef Name) {
+    for (Instruction &I : instructions(*M->getFunction("foo")))
+      if (I.getName() == Name)
+        return cast<CallBase>(&I);
+    return nullptr;
+  }
+
+  static uint64_t getStackId(const MDNode *Stack, unsigned I) {
+    return mdconst::extract<ConstantInt>(Stack->getOperand(I))->getZExtValue();
+  }
+
+  LLVMContext C;
+  std::unique_ptr<Module> M;
+  InstrProfWriter Writer;
+};
+
+// Cold: few accesses per byte and long lived.
+const MemInfoBlock ColdBlock(/*Size=*/100, /*AccessCount=*/10, /*AllocTs=*/0,
+                             /*DeallocTs=*/300000, /*AllocCpu=*/0,
+                             /*DeallocCpu=*/0);
+// Not cold: many accesses per byte and short lived.
+const MemInfoBlock NotColdBlock(/*Size=*/100, /*AccessCount=*/5000,
+                                /*AllocTs=*/0, /*DeallocTs=*/10,
+                                /*AllocCpu=*/0, /*DeallocCpu=*/0);
+
+// Check that \p CI has !memprof metadata with a cold and a not cold context,
+// which only differ in their last frame, and a !callsite stack of
+// \p NumInlinedFrames frames that the contexts start with.
+void expectColdAndNotColdContexts(const CallBase *CI,
+                                  unsigned NumInlinedFrames) {
+  ASSERT_TRUE(CI);
+  EXPECT_FALSE(CI->hasFnAttr("memprof"));
+  const MDNode *CallsiteMD = CI->getMetadata(LLVMContext::MD_callsite);
+  ASSERT_TRUE(CallsiteMD);
+  ASSERT_EQ(CallsiteMD->getNumOperands(), NumInlinedFrames);
+
+  const MDNode *MemProfMD = CI->getMetadata(LLVMContext::MD_memprof);
+  ASSERT_TRUE(MemProfMD);
+  ASSERT_EQ(MemProfMD->getNumOperands(), 2u);
+  std::set<AllocationType> Types;
+  std::set<uint64_t> CallerIds;
+  for (const MDOperand &MIBOp : MemProfMD->operands()) {
+    const MDNode *MIB = cast<MDNode>(MIBOp);
+    Types.insert(getMIBAllocType(MIB));
+    const MDNode *Stack = getMIBStackNode(MIB);
+    ASSERT_EQ(Stack->getNumOperands(), NumInlinedFrames + 1);
+    for (unsigned I = 0; I != NumInlinedFrames; ++I)
+      EXPECT_EQ(getStackId(Stack, I), getStackId(CallsiteMD, I));
+    CallerIds.insert(getStackId(Stack, NumInlinedFrames));
+  }
+  EXPECT_EQ(Types, (std::set<AllocationType>{AllocationType::Cold,
+                                             AllocationType::NotCold}));
+  EXPECT_EQ(CallerIds.size(), 2u);
+}
+
+TEST_F(MemProfUseTest, AnnotatesContexts) {
+  IndexedMemProfRecord Record;
+  Record.AllocSites.push_back(
+      IndexedAllocationInfo({AllocFrame, Caller1Frame}, ColdBlock));
+  Record.AllocSites.push_back(
+      IndexedAllocationInfo({AllocFrame, Caller2Frame}, NotColdBlock));
+  Record.AllocSites.push_back(IndexedAllocationInfo(
+      {InlinedAllocFrame, InlineeCallFrame, Caller1Frame}, ColdBlock));
+  Record.AllocSites.push_back(IndexedAllocationInfo(
+      {InlinedAllocFrame, InlineeCallFrame, Caller2Frame}, NotColdBlock));
+  Record.CallSites.push_back({BarCallFrame});
+  runPGOUse(Record);
+
+  expectColdAndNotColdContexts(getCall("alloc"), 1);
+  // The allocation inlined from inlinee is matched through both frames of its
+  // debug location.
+  expectColdAndNotColdContexts(getCall("inlined"), 2);
+
+  CallBase *Unprofiled = getCall("unprofiled");
+  EXPECT_FALSE(Unprofiled->getMetadata(LLVMContext::MD_memprof));
+  EXPECT_FALSE(Unprofiled->getMetadata(LLVMContext::MD_callsite));
+  EXPECT_FALSE(Unprofiled->hasFnAttr("memprof"));
+
+  // The other calls on profiled contexts get their stack id.
+  const MDNode *BarCallsite =
+      getCall("bar")->getMetadata(LLVMContext::MD_callsite);
+  ASSERT_TRUE(BarCallsite);
+  ASSERT_EQ(BarCallsite->getNumOperands(), 1u);
+  const MDNode *AllocCallsite =
+      getCall("alloc")->getMetadata(LLVMContext::MD_callsite);
+  EXPECT_NE(getStackId(BarCallsite, 0), getStackId(AllocCallsite, 0));
+}
+
+TEST_F(MemProfUseTest, SingleAllocTypeIsAnAttribute) {
+  IndexedMemProfRecord Record;
+  Record.AllocSites.push_back(
+      IndexedAllocationInfo({AllocFrame, Caller1Frame}, ColdBlock));
+  Record.AllocSites.push_back(
+      IndexedAllocationInfo({AllocFrame, Caller2Frame}, ColdBlock));
+  runPGOUse(Record);
+
+  CallBase *Alloc = getCall("alloc");
+  EXPECT_EQ(Alloc->getFnAttr("memprof").getValueAsString(), "cold");
+  EXPECT_FALSE(Alloc->getMetadata(LLVMContext::MD_memprof));
+  EXPECT_FALSE(Alloc->getMetadata(LLVMContext::MD_callsite));
+}
+
+TEST_F(MemProfUseTest, IgnoresMismatchedLocations) {
+  IndexedMemProfRecord Record;
+  Record.AllocSites.push_back(
+      IndexedAllocationInfo({MismatchedAllocFrame, Caller1Frame}, ColdBlock));
+  Record.AllocSites.push_back(IndexedAllocationInfo(
+      {MismatchedAllocFrame, Caller2Frame}, NotColdBlock));
+  runPGOUse(Record);
+
+  for (Instruction &I : instructions(*M->getFunction("foo"))) {
+    EXPECT_FALSE(I.getMetadata(LLVMContext::MD_memprof));
+    EXPECT_FALSE(I.getMetadata(LLVMContext::MD_callsite));
+  }
+}
+
+} // end anonymous namespace
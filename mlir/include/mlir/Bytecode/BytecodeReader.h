@@ -0,0 +1,78 @@
+//===- BytecodeReader.h - MLIR Bytecode Reader ------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This header defines interfaces to read MLIR bytecode files/streams.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_BYTECODEREADER_H
+#define MLIR_BYTECODE_BYTECODEREADER_H
+
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+class MemoryBufferRef;
+} // namespace llvm
+
+namespace mlir {
+class Block;
+class MLIRContext;
+class Operation;
+
+/// Returns true if the given buffer starts with the magic bytes that signal
+/// MLIR bytecode.
+bool isBytecode(llvm::MemoryBufferRef buffer);
+
+/// Read the operations defined within the given memory buffer, containing MLIR
+/// bytecode, into the provided block. The operations are verified once they
+/// have been read.
+LogicalResult readBytecodeFile(llvm::MemoryBufferRef buffer, Block *block,
+                               MLIRContext *context);
+
+/// This class reads an MLIR bytecode file and can defer reading the regions of
+/// isolated-from-above operations, such as function bodies, until they are
+/// needed. The buffer must outlive the reader, and operations whose regions
+/// have not been materialized must not be erased before they are.
+class BytecodeReader {
+public:
+  BytecodeReader(llvm::MemoryBufferRef buffer, MLIRContext *context);
+  ~BytecodeReader();
+
+  /// Read the top-level operations of the file into the provided block. The
+  /// regions of an isolated-from-above operation for which `lazyOpsCallback`
+  /// returns true are left empty until the operation is materialized. If no
+  /// callback is given, everything is read eagerly. The operations are not
+  /// verified.
+  LogicalResult
+  readTopLevel(Block *block,
+               std::function<bool(Operation *)> lazyOpsCallback = nullptr);
+
+  /// Return the number of operations whose regions are yet to be read.
+  int64_t getNumOpsToMaterialize() const;
+
+  /// Return true if the regions of the given operation are yet to be read.
+  bool isMaterializable(Operation *op) const;
+
+  /// Read the regions of the given operation. Lazily loadable operations found
+  /// inside are handled with the callback given to `readTopLevel`.
+  LogicalResult materialize(Operation *op);
+
+  /// Read the regions of all operations that are yet to be materialized.
+  LogicalResult materializeAll();
+
+private:
+  class Impl;
+  std::unique_ptr<Impl> impl;
+};
+
+} // namespace mlir
+
+#endif // MLIR_BYTECODE_BYTECODEREADER_H
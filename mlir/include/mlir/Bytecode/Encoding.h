@@ -0,0 +1,117 @@
+//===- Encoding.h - MLIR Bytecode Encoding ----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the constants shared by the reader and the writer of the
+// MLIR bytecode format.
+//
+// A bytecode file starts with the magic number and the format version, and is
+// followed by a sequence of sections. Each section is encoded as:
+//
+//   section ::= id:byte length:varint alignment:varint padding* payload
+//
+// where the padding bytes align the start of the payload, relative to the
+// start of the file, to `alignment`. All integers are encoded as unsigned
+// LEB128 (`varint`). Strings, operation names, attributes and types are stored
+// once in uniquing tables and referenced by index from the IR section.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_ENCODING_H
+#define MLIR_BYTECODE_ENCODING_H
+
+#include <cstdint>
+
+namespace mlir {
+namespace bytecode {
+
+/// The magic number identifying an MLIR bytecode file: "ML\xefR".
+constexpr uint8_t kMagic[] = {'M', 'L', 0xef, 'R'};
+
+/// The version of the format produced by the writer. The reader rejects files
+/// with a newer version.
+constexpr uint64_t kVersion = 0;
+
+/// The byte used to pad sections and resource blobs to their alignment.
+constexpr uint8_t kAlignmentByte = 0xcb;
+
+/// The sections of a bytecode file, in the order that they are written.
+namespace Section {
+enum ID : uint8_t {
+  /// The uniqued strings referenced by the other sections:
+  ///   numStrings:varint stringSize:varint* stringData:byte*
+  kString = 0,
+
+  /// The dialects and operation names:
+  ///   numDialects:varint dialectName:string*
+  ///   numOpNames:varint (dialect:varint opName:string)*
+  kDialect = 1,
+
+  /// The blobs holding the payloads of large attributes, such as dense
+  /// elements. Each blob is aligned relative to the start of the file so that
+  /// it can be used in place when the file is memory mapped:
+  ///   numBlobs:varint maxAlignment:varint padding*
+  ///   (alignment:varint size:varint padding* data:byte*)*
+  kResource = 2,
+
+  /// The attribute and type tables:
+  ///   numAttrs:varint numTypes:varint
+  ///   (kind:byte size:varint data:byte*)*    -- see AttrKind
+  ///   typeAsm:string*
+  kAttrType = 3,
+
+  /// The operations, see the bytecode writer for the encoding:
+  ///   numOps:varint op*
+  kIR = 4,
+
+  /// The number of sections, which must be last.
+  kNumSections = 5,
+};
+} // namespace Section
+
+/// The encodings of an entry of the attribute table.
+namespace AttrKind {
+enum ID : uint8_t {
+  /// The textual assembly form of the attribute:
+  ///   asm:string
+  kAsm = 0,
+
+  /// A StringAttr of NoneType:
+  ///   value:string
+  kString = 1,
+
+  /// A DictionaryAttr:
+  ///   numEntries:varint (name:string value:attr)*
+  kDictionary = 2,
+
+  /// A DenseIntOrFPElementsAttr whose payload is a resource blob:
+  ///   type:type blob:varint isSplat:byte
+  kDenseElements = 3,
+
+  /// The builtin locations:
+  ///   UnknownLoc:     (empty)
+  ///   FileLineColLoc: filename:string line:varint column:varint
+  ///   NameLoc:        name:string childLoc:attr
+  ///   CallSiteLoc:    callee:attr caller:attr
+  ///   FusedLoc:       metadata:(attr + 1, or 0) numLocs:varint loc:attr*
+  kUnknownLoc = 4,
+  kFileLineColLoc = 5,
+  kNameLoc = 6,
+  kCallSiteLoc = 7,
+  kFusedLoc = 8,
+
+  /// A DenseResourceElementsAttr, whose blob, if it has one, is a resource
+  /// blob:
+  ///   type:type key:string blob:(varint + 1, or 0)
+  kDenseResourceElements = 9,
+};
+} // namespace AttrKind
+
+} // namespace bytecode
+} // namespace mlir
+
+#endif // MLIR_BYTECODE_ENCODING_H
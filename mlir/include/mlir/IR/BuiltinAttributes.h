@@ -10,6 +10,7 @@
 #define MLIR_IR_BUILTINATTRIBUTES_H
 
 #include "mlir/IR/BuiltinAttributeInterfaces.h"
+#include "mlir/IR/DialectResourceBlobManager.h"
 #include "mlir/IR/SubElementInterfaces.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/Sequence.h"
@@ -27,6 +28,10 @@ class Location;
 class Operation;
 class ShapedType;
 
+/// The handle used by DenseResourceElementsAttr to refer to a blob of the
+/// builtin dialect's resource blob manager.
+using DenseResourceElementsHandle = DialectResourceBlobHandle;
+
 //===----------------------------------------------------------------------===//
 // Elements Attributes
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,319 @@
+//===- DialectResourceBlobManager.h - Dialect Blob Management ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines utility classes for referencing and managing binary blobs
+// of data, such as the payloads of large constants, that are owned outside of
+// the MLIRContext. Attributes refer to these blobs by handle, so the blob data
+// is never copied into or uniqued by the context.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_IR_DIALECTRESOURCEBLOBMANAGER_H
+#define MLIR_IR_DIALECTRESOURCEBLOBMANAGER_H
+
+#include "mlir/IR/DialectInterface.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/RWMutex.h"
+
+namespace llvm {
+class MemoryBuffer;
+} // namespace llvm
+
+namespace mlir {
+
+//===----------------------------------------------------------------------===//
+// AsmResourceBlob
+//===----------------------------------------------------------------------===//
+
+/// This class represents a blob of binary data, with an alignment and a
+/// deleter that is invoked when the blob is destroyed. The data is not owned
+/// by the MLIRContext, and may for example live in a memory mapped file.
+class AsmResourceBlob {
+public:
+  /// A deleter function that frees a blob given the data, size, and alignment.
+  using DeleterFn =
+      llvm::unique_function<void(const void *data, size_t size, size_t align)>;
+
+  /// The description of the file region that a blob was loaded from. Blobs
+  /// with an external source are printed as a reference to that region
+  /// instead of inline.
+  struct ExternalSource {
+    std::string path;
+    uint64_t offset = 0;
+  };
+
+  AsmResourceBlob() = default;
+  AsmResourceBlob(ArrayRef<char> data, size_t dataAlignment, DeleterFn deleter,
+                  bool dataIsMutable)
+      : data(data), dataAlignment(dataAlignment), deleter(std::move(deleter)),
+        dataIsMutable(dataIsMutable) {}
+  AsmResourceBlob(AsmResourceBlob &&other) { *this = std::move(other); }
+  AsmResourceBlob &operator=(AsmResourceBlob &&rhs) {
+    if (this == &rhs)
+      return *this;
+    release();
+    data = rhs.data;
+    dataAlignment = rhs.dataAlignment;
+    deleter = std::move(rhs.deleter);
+    dataIsMutable = rhs.dataIsMutable;
+    externalSource = std::move(rhs.externalSource);
+    rhs.data = {};
+    rhs.deleter = nullptr;
+    return *this;
+  }
+  AsmResourceBlob(const AsmResourceBlob &) = delete;
+  AsmResourceBlob &operator=(const AsmResourceBlob &) = delete;
+  ~AsmResourceBlob() { release(); }
+
+  /// Return the alignment of the underlying data.
+  size_t getDataAlignment() const { return dataAlignment; }
+
+  /// Return the raw underlying data of this blob.
+  ArrayRef<char> getData() const { return data; }
+
+  /// Return a mutable reference to the raw underlying data of this blob.
+  /// Asserts that the blob `isMutable`.
+  MutableArrayRef<char> getMutableData() {
+    assert(isMutable() &&
+           "cannot access mutable reference to non-mutable data");
+    return MutableArrayRef<char>(const_cast<char *>(data.data()), data.size());
+  }
+
+  /// Return if the data of this blob is mutable.
+  bool isMutable() const { return dataIsMutable; }
+
+  /// Return the file region that this blob was loaded from, or nullptr if the
+  /// blob was not loaded from an external file.
+  const ExternalSource *getExternalSource() const {
+    return externalSource ? &*externalSource : nullptr;
+  }
+
+  /// Set the file region that this blob was loaded from.
+  void setExternalSource(ExternalSource source) {
+    externalSource = std::move(source);
+  }
+
+private:
+  /// Invoke the deleter of this blob, if it has one.
+  void release() {
+    if (deleter)
+      deleter(data.data(), data.size(), dataAlignment);
+    deleter = nullptr;
+  }
+
+  /// The raw, properly aligned, blob data.
+  ArrayRef<char> data;
+
+  /// The alignment of the data.
+  size_t dataAlignment = 0;
+
+  /// An optional deleter function used to deallocate the underlying data when
+  /// necessary.
+  DeleterFn deleter;
+
+  /// Whether the data is mutable.
+  bool dataIsMutable = false;
+
+  /// The file region the data was loaded from, if any.
+  Optional<ExternalSource> externalSource;
+};
+
+/// This class provides a utility for creating blobs whose data is allocated on
+/// the heap and owned by the blob.
+struct HeapAsmResourceBlob {
+  /// Create a new heap allocated blob with the given size and alignment.
+  /// `dataIsMutable` indicates if the allocated data can be mutated.
+  static AsmResourceBlob allocate(size_t size, size_t align,
+                                  bool dataIsMutable = true);
+
+  /// Create a new heap allocated blob and copy the provided data into it.
+  static AsmResourceBlob allocateAndCopy(ArrayRef<char> data, size_t align,
+                                         bool dataIsMutable = true);
+};
+
+/// This class provides a utility for creating blobs that refer to data owned
+/// by the user. The data must outlive the blob, unless a deleter is provided
+/// to release it.
+struct UnmanagedAsmResourceBlob {
+  static AsmResourceBlob
+  allocate(ArrayRef<char> data, size_t align,
+           AsmResourceBlob::DeleterFn deleter = nullptr,
+           bool dataIsMutable = false) {
+    return AsmResourceBlob(data, align, std::move(deleter), dataIsMutable);
+  }
+};
+
+/// This class provides a utility for creating blobs backed by a region of a
+/// file on disk. Large regions are memory mapped, so creating the blob takes
+/// time proportional to the size of the file metadata, not of its data.
+struct MappedAsmResourceBlob {
+  /// Create a blob that owns the given buffer. If the buffer data is not
+  /// aligned to `align`, it is copied into an aligned heap allocation.
+  static AsmResourceBlob allocate(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                                  size_t align);
+
+  /// Create a blob for `size` bytes at `offset` within the file at `path`, or
+  /// for the remainder of the file if `size` is not provided. The external
+  /// source of the blob is set to the file region. Returns failure and sets
+  /// `errorMessage` if the file region could not be mapped.
+  static FailureOr<AsmResourceBlob> mapFile(StringRef path, uint64_t offset,
+                                            Optional<uint64_t> size,
+                                            size_t align,
+                                            std::string &errorMessage);
+};
+
+//===----------------------------------------------------------------------===//
+// DialectResourceBlobManager
+//===----------------------------------------------------------------------===//
+
+/// This class defines a manager for dialect resource blobs. Blobs are uniqued
+/// by a given key, and not by their contents, and entries remain at a stable
+/// address for the lifetime of the manager. The map of entries is thread
+/// safe, but the blob of an entry is not synchronized.
+class DialectResourceBlobManager {
+public:
+  /// The class represents an individual entry of a blob.
+  class BlobEntry {
+  public:
+    /// Return the key used to reference this blob.
+    StringRef getKey() const { return key; }
+
+    /// Return the blob owned by this entry if one has been initialized. Returns
+    /// nullptr otherwise.
+    const AsmResourceBlob *getBlob() const { return blob ? &*blob : nullptr; }
+    AsmResourceBlob *getBlob() { return blob ? &*blob : nullptr; }
+
+    /// Set the blob owned by this entry.
+    void setBlob(AsmResourceBlob &&newBlob) { blob = std::move(newBlob); }
+
+  private:
+    /// The key used for this blob.
+    StringRef key;
+
+    /// The blob that is referenced by this entry if it is valid.
+    Optional<AsmResourceBlob> blob;
+
+    friend class DialectResourceBlobManager;
+  };
+
+  /// Return the blob registered for the given name, or nullptr if no blob
+  /// is registered.
+  BlobEntry *lookup(StringRef name);
+  const BlobEntry *lookup(StringRef name) const {
+    return const_cast<DialectResourceBlobManager *>(this)->lookup(name);
+  }
+
+  /// Update the blob for the entry defined by the provided name. This method
+  /// asserts that an entry for the given name exists in the manager.
+  void update(StringRef name, AsmResourceBlob &&newBlob);
+
+  /// Insert a new entry with the provided name and optional blob data. The
+  /// name may be modified during insertion if another entry already exists
+  /// with that name. Returns the inserted entry.
+  BlobEntry &insert(StringRef name, Optional<AsmResourceBlob> blob = {});
+
+private:
+  /// A mutex to protect access to the blob map.
+  llvm::sys::SmartRWMutex<true> blobMapLock;
+
+  /// The internal map of tracked blobs. StringMap stores entries in distinct
+  /// allocations, so we can freely return references to the data without
+  /// worrying about invalidation.
+  llvm::StringMap<BlobEntry> blobMap;
+
+  /// The next suffix used to unique a colliding name.
+  unsigned nameCounter = 0;
+};
+
+/// This class represents a reference to a blob entry of the blob manager of a
+/// dialect. Handles are compared and hashed by the identity of the entry they
+/// refer to, never by the contents of its blob.
+class DialectResourceBlobHandle {
+public:
+  using BlobEntry = DialectResourceBlobManager::BlobEntry;
+
+  DialectResourceBlobHandle(BlobEntry *entry = nullptr,
+                            Dialect *dialect = nullptr)
+      : entry(entry), dialect(dialect) {}
+
+  /// Return the entry referenced by this handle.
+  BlobEntry *getEntry() const { return entry; }
+
+  /// Return the dialect that owns the referenced entry.
+  Dialect *getDialect() const { return dialect; }
+
+  /// Return the key of the referenced entry.
+  StringRef getKey() const { return entry->getKey(); }
+
+  /// Return the blob of the referenced entry, or nullptr if it has not been
+  /// initialized.
+  AsmResourceBlob *getBlob() const { return entry->getBlob(); }
+
+  explicit operator bool() const { return entry; }
+  bool operator==(const DialectResourceBlobHandle &other) const {
+    return entry == other.entry;
+  }
+  bool operator!=(const DialectResourceBlobHandle &other) const {
+    return !(*this == other);
+  }
+
+  friend llvm::hash_code hash_value(const DialectResourceBlobHandle &handle) {
+    return llvm::hash_value(handle.entry);
+  }
+
+private:
+  BlobEntry *entry;
+  Dialect *dialect;
+};
+
+/// This class implements a dialect interface that provides the blob manager
+/// of a dialect. The manager may be shared between the dialect instances of
+/// different contexts.
+class ResourceBlobManagerDialectInterface
+    : public DialectInterface::Base<ResourceBlobManagerDialectInterface> {
+public:
+  ResourceBlobManagerDialectInterface(Dialect *dialect)
+      : Base(dialect),
+        blobManager(std::make_shared<DialectResourceBlobManager>()) {}
+
+  /// Return the blob manager held by this interface. Dialect interfaces are
+  /// only handed out as const, but the manager itself is thread safe.
+  DialectResourceBlobManager &getBlobManager() const { return *blobManager; }
+
+  /// Set the blob manager held by this interface.
+  void
+  setBlobManager(std::shared_ptr<DialectResourceBlobManager> newBlobManager) {
+    blobManager = std::move(newBlobManager);
+  }
+
+  /// Insert a new blob entry, the name of which may be modified to be unique.
+  /// Returns a handle to the inserted entry.
+  DialectResourceBlobHandle insert(StringRef name,
+                                   Optional<AsmResourceBlob> blob = {}) const {
+    return {&blobManager->insert(name, std::move(blob)), getDialect()};
+  }
+
+  /// Return a handle to the entry with the given name, or a null handle if no
+  /// such entry exists.
+  DialectResourceBlobHandle lookup(StringRef name) const {
+    if (auto *entry = blobManager->lookup(name))
+      return {entry, getDialect()};
+    return {};
+  }
+
+private:
+  /// The blob manager owned by the dialect implementing this interface.
+  std::shared_ptr<DialectResourceBlobManager> blobManager;
+};
+
+} // namespace mlir
+
+#endif // MLIR_IR_DIALECTRESOURCEBLOBMANAGER_H
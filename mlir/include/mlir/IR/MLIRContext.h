@@ -226,6 +226,12 @@ public:
   /// (attributes, operations, types, etc.).
   llvm::hash_code getRegistryHash();
 
+  /// Returns the number of bytes allocated by the current thread for the
+  /// uniqued attribute, type, and affine storage instances of this context.
+  /// The difference between two calls on the same thread gives the volume of
+  /// storage created by the work done in between.
+  uint64_t getStorageBytesAllocatedOnCurrentThread();
+
 private:
   const std::unique_ptr<MLIRContextImpl> impl;
 
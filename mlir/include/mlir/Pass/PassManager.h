@@ -171,6 +171,19 @@ enum class PassDisplayMode {
   Pipeline,
 };
 
+/// An enum describing the different output formats of the pass profile.
+enum class PassProfileFormat {
+  // In this mode the profile is written in the Chrome trace event format, with
+  // one complete event per pass execution on an operation. It can be viewed
+  // with chrome://tracing or Perfetto.
+  ChromeTrace,
+
+  // In this mode the profile is written as folded stacks, with one line per
+  // unique nesting of pass executions and the exclusive time spent in it in
+  // nanoseconds. It can be rendered with flame graph tools.
+  FlameGraph,
+};
+
 /// The main pass manager and pipeline builder.
 class PassManager : public OpPassManager {
 public:
@@ -368,6 +381,23 @@ public:
   /// unintentionally included in the timing results.
   void enableTiming();
 
+  //===--------------------------------------------------------------------===//
+  // Pass Profiling
+
+  /// Add an instrumentation to profile each execution of a pass, or
+  /// computation of an analysis, on an operation. Each execution records its
+  /// wall time, the volume of storage uniqued in the context by the executing
+  /// thread, and the number of operations nested in the anchor operation
+  /// before and after the pass. This allows for finding the specific
+  /// operations that a pass is slow on. The profile is written to `os` in the
+  /// given format when the pass manager is destroyed.
+  ///
+  /// Note: Like timing, profiling should be enabled after all other
+  /// instrumentations.
+  void
+  enableProfiling(std::unique_ptr<raw_ostream> os,
+                  PassProfileFormat format = PassProfileFormat::ChromeTrace);
+
   //===--------------------------------------------------------------------===//
   // Pass Statistics
 
@@ -127,6 +127,9 @@ public:
       return allocator.identifyObject(ptr).hasValue();
     }
 
+    /// Returns the total number of bytes requested from this allocator.
+    size_t getBytesAllocated() const { return allocator.getBytesAllocated(); }
+
   private:
     /// The raw allocator for type storage objects.
     llvm::BumpPtrAllocator allocator;
@@ -138,6 +141,12 @@ public:
   /// Set the flag specifying if multi-threading is disabled within the uniquer.
   void disableMultithreading(bool disable = true);
 
+  /// Returns the number of bytes allocated for parametric storage instances
+  /// created on the current thread. This only accounts for instances created
+  /// while multi-threading was in the same state as it is now, and is mostly
+  /// useful for attributing allocations to the work done on a thread.
+  size_t getBytesAllocatedOnCurrentThread();
+
   /// Register a new parametric storage class, this is necessary to create
   /// instances of this class type. `id` is the type identifier that will be
   /// used to identify this type when creating instances of it via 'get'.
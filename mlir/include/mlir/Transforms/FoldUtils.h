@@ -111,6 +111,13 @@ public:
   /// Clear out any constants cached inside of the folder.
   void clear();
 
+  /// Never hoist the constants created or unified by this folder above the
+  /// given region. This allows disjoint parts of a region tree to be folded
+  /// independently.
+  void addInsertionBoundary(Region *region) {
+    insertionBoundaries.insert(region);
+  }
+
   /// Get or create a constant using the given builder. On success this returns
   /// the constant operation, nullptr otherwise.
   Value getOrCreateConstant(OpBuilder &builder, Dialect *dialect,
@@ -156,6 +163,9 @@ private:
   /// given that many dialects may generate the same constant.
   DenseMap<Operation *, SmallVector<Dialect *, 2>> referencedDialects;
 
+  /// The regions that constants are not hoisted out of.
+  DenseSet<Region *> insertionBoundaries;
+
   /// A collection of dialect folder interfaces.
   DialectInterfaceCollection<DialectFoldInterface> interfaces;
 };
@@ -37,6 +37,21 @@ public:
   /// to disable this iteration limit.
   int64_t maxIterations = 10;
 
+  /// When set, and multi-threading is enabled in the context, the regions of
+  /// each operation that is isolated from above and directly nested in the
+  /// rewritten regions are first simplified to a fixed point on their own
+  /// worklist, in parallel, before the whole region tree is processed as
+  /// usual. Constants are then hoisted no further than those regions until
+  /// that final step.
+  ///
+  /// As for passes that run on isolated operations in parallel, patterns
+  /// applied in those regions must not modify the operations around them.
+  bool enableParallelPartitions = false;
+
+  /// The minimum number of operations in a group of partitions for it to be
+  /// simplified in parallel. Smaller groups are left to the final step.
+  int64_t minOpsPerPartition = 256;
+
   static constexpr int64_t kNoIterationLimit = -1;
 };
 
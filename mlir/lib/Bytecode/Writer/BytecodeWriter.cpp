@@ -0,0 +1,474 @@
+//===- BytecodeWriter.cpp - MLIR Bytecode Writer --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The IR section encodes operations as follows, where `attr`, `type`, `string`
+// and `opName` are indices into the corresponding tables:
+//
+//   op ::= name:opName loc:attr attrs:attr
+//          numResults:varint type*
+//          numOperands:varint operand*
+//          numSuccessors:varint block:varint*
+//          numRegions:varint (isIsolated:byte regions)?
+//   operand ::= value:varint (type if the value is defined after its use)
+//   regions ::= region*                        -- if not isolated
+//             | size:varint region*            -- if isolated
+//   region ::= numBlocks:varint block-arguments* block-contents*
+//   block-arguments ::= numArgs:varint (type loc:attr)*
+//   block-contents ::= numOps:varint op*
+//
+// Values are numbered in the order in which they are defined: for each region,
+// the arguments of all its blocks first, then the results of each operation
+// followed by the values defined in its nested regions. The regions of an
+// isolated-from-above operation start a new numbering, and are prefixed with
+// their size so that a reader can skip them and materialize them later.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/BytecodeWriter.h"
+#include "mlir/Bytecode/Encoding.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/OpDefinition.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+
+namespace {
+//===----------------------------------------------------------------------===//
+// EncodingEmitter
+//===----------------------------------------------------------------------===//
+
+/// This class collects the encoded bytes of a section, or of a part of one.
+class EncodingEmitter {
+public:
+  void emitByte(uint8_t byte) { data.push_back(byte); }
+
+  void emitVarInt(uint64_t value) {
+    uint8_t buffer[16];
+    unsigned size = llvm::encodeULEB128(value, buffer);
+    data.append(buffer, buffer + size);
+  }
+
+  void emitBytes(ArrayRef<uint8_t> bytes) {
+    data.append(bytes.begin(), bytes.end());
+  }
+
+  /// Emit the given emitter's bytes prefixed with their size.
+  void emitSized(const EncodingEmitter &other) {
+    emitVarInt(other.size());
+    emitBytes(other.data);
+  }
+
+  /// Pad the data so that `offset + size()` is a multiple of `alignment`.
+  void alignTo(uint64_t offset, unsigned alignment) {
+    while ((offset + size()) % alignment)
+      emitByte(bytecode::kAlignmentByte);
+  }
+
+  size_t size() const { return data.size(); }
+
+  SmallVector<uint8_t, 0> data;
+};
+
+//===----------------------------------------------------------------------===//
+// BytecodeWriter
+//===----------------------------------------------------------------------===//
+
+class BytecodeWriter {
+public:
+  void write(Operation *rootOp, raw_ostream &os);
+
+private:
+  //===--------------------------------------------------------------------===//
+  // Uniquing tables
+
+  unsigned getStringID(StringRef str) {
+    auto it = stringIDs.try_emplace(str, stringIDs.size());
+    if (it.second)
+      strings.push_back(it.first->getKey());
+    return it.first->second;
+  }
+
+  unsigned getOpNameID(OperationName name) {
+    return opNames.insert({name, opNames.size()}).first->second;
+  }
+
+  unsigned getAttrID(Attribute attr) {
+    auto it = attrIDs.try_emplace(attr, attrs.size());
+    if (it.second)
+      attrs.push_back(attr);
+    return it.first->second;
+  }
+
+  unsigned getTypeID(Type type) {
+    auto it = typeIDs.try_emplace(type, types.size());
+    if (it.second)
+      types.push_back(type);
+    return it.first->second;
+  }
+
+  /// Encode the given attribute into the attribute table.
+  void writeAttr(EncodingEmitter &emitter, Attribute attr);
+
+  /// Add the given data to the resource section, and return its index.
+  unsigned writeResource(ArrayRef<char> data, unsigned alignment);
+
+  /// Returns true if the given attribute was added to the resource section.
+  bool writeDenseElements(EncodingEmitter &emitter,
+                          DenseIntOrFPElementsAttr attr);
+
+  //===--------------------------------------------------------------------===//
+  // IR
+
+  /// The values of an isolated-from-above region tree.
+  struct ValueScope {
+    DenseMap<Value, unsigned> ids;
+    /// The number of values whose definition has been emitted.
+    unsigned numDefined = 0;
+  };
+
+  /// Number the values defined in the given regions, and in their nested
+  /// regions that are not isolated from above.
+  void numberValues(ValueScope &scope, MutableArrayRef<Region> regions);
+
+  void writeOp(EncodingEmitter &emitter, ValueScope &scope, Operation *op);
+  void writeRegions(EncodingEmitter &emitter, ValueScope &scope,
+                    MutableArrayRef<Region> regions);
+
+  /// Emit a section with the given payload.
+  void emitSection(raw_ostream &os, uint64_t &offset, bytecode::Section::ID id,
+                   const EncodingEmitter &payload, unsigned alignment = 1);
+
+  /// The index of each block within its region.
+  DenseMap<Block *, unsigned> blockIDs;
+
+  llvm::StringMap<unsigned> stringIDs;
+  std::vector<StringRef> strings;
+  llvm::MapVector<OperationName, unsigned> opNames;
+  DenseMap<Attribute, unsigned> attrIDs;
+  std::vector<Attribute> attrs;
+  DenseMap<Type, unsigned> typeIDs;
+  std::vector<Type> types;
+
+  /// The blobs of the resource section, and the largest blob alignment.
+  EncodingEmitter resourceEmitter;
+  unsigned numResources = 0;
+  unsigned resourceAlignment = 1;
+
+  /// The resource index of each dialect resource blob that was written.
+  DenseMap<DialectResourceBlobManager::BlobEntry *, unsigned> blobIDs;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// Attributes and Types
+
+bool BytecodeWriter::writeDenseElements(EncodingEmitter &emitter,
+                                        DenseIntOrFPElementsAttr attr) {
+  // The payload is stored in the in-memory format of the attribute, which is
+  // only portable between little endian hosts.
+  if (llvm::support::endian::system_endianness() !=
+      llvm::support::endianness::little)
+    return false;
+  ArrayRef<char> rawData = attr.getRawData();
+  bool detectedSplat = false;
+  if (!DenseElementsAttr::isValidRawBuffer(attr.getType(), rawData,
+                                           detectedSplat) ||
+      detectedSplat != attr.isSplat())
+    return false;
+
+  constexpr unsigned kBlobAlignment = 8;
+  emitter.emitByte(bytecode::AttrKind::kDenseElements);
+  EncodingEmitter entry;
+  entry.emitVarInt(getTypeID(attr.getType()));
+  entry.emitVarInt(writeResource(rawData, kBlobAlignment));
+  entry.emitByte(attr.isSplat());
+  emitter.emitSized(entry);
+  return true;
+}
+
+unsigned BytecodeWriter::writeResource(ArrayRef<char> data,
+                                       unsigned alignment) {
+  // Align each blob so that it can be used in place. The resource section is
+  // aligned to the largest blob alignment, so offsets relative to its start
+  // are sufficient.
+  alignment = std::max(alignment, 1u);
+  resourceAlignment = std::max(resourceAlignment, alignment);
+  resourceEmitter.emitVarInt(alignment);
+  resourceEmitter.emitVarInt(data.size());
+  resourceEmitter.alignTo(/*offset=*/0, alignment);
+  resourceEmitter.emitBytes(ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+  return numResources++;
+}
+
+void BytecodeWriter::writeAttr(EncodingEmitter &emitter, Attribute attr) {
+  EncodingEmitter entry;
+  auto emitEntry = [&](bytecode::AttrKind::ID kind) {
+    emitter.emitByte(kind);
+    emitter.emitSized(entry);
+  };
+
+  if (auto loc = attr.dyn_cast<UnknownLoc>())
+    return emitEntry(bytecode::AttrKind::kUnknownLoc);
+  if (auto loc = attr.dyn_cast<FileLineColLoc>()) {
+    entry.emitVarInt(getStringID(loc.getFilename().getValue()));
+    entry.emitVarInt(loc.getLine());
+    entry.emitVarInt(loc.getColumn());
+    return emitEntry(bytecode::AttrKind::kFileLineColLoc);
+  }
+  if (auto loc = attr.dyn_cast<NameLoc>()) {
+    entry.emitVarInt(getStringID(loc.getName().getValue()));
+    entry.emitVarInt(getAttrID(loc.getChildLoc()));
+    return emitEntry(bytecode::AttrKind::kNameLoc);
+  }
+  if (auto loc = attr.dyn_cast<CallSiteLoc>()) {
+    entry.emitVarInt(getAttrID(loc.getCallee()));
+    entry.emitVarInt(getAttrID(loc.getCaller()));
+    return emitEntry(bytecode::AttrKind::kCallSiteLoc);
+  }
+  if (auto loc = attr.dyn_cast<FusedLoc>()) {
+    Attribute metadata = loc.getMetadata();
+    entry.emitVarInt(metadata ? getAttrID(metadata) + 1 : 0);
+    entry.emitVarInt(loc.getLocations().size());
+    for (Location childLoc : loc.getLocations())
+      entry.emitVarInt(getAttrID(childLoc));
+    return emitEntry(bytecode::AttrKind::kFusedLoc);
+  }
+  if (auto dict = attr.dyn_cast<DictionaryAttr>()) {
+    entry.emitVarInt(dict.size());
+    for (NamedAttribute namedAttr : dict) {
+      entry.emitVarInt(getStringID(namedAttr.getName().getValue()));
+      entry.emitVarInt(getAttrID(namedAttr.getValue()));
+    }
+    return emitEntry(bytecode::AttrKind::kDictionary);
+  }
+  if (auto str = attr.dyn_cast<StringAttr>()) {
+    if (str.getType().isa<NoneType>()) {
+      entry.emitVarInt(getStringID(str.getValue()));
+      return emitEntry(bytecode::AttrKind::kString);
+    }
+  }
+  if (auto dense = attr.dyn_cast<DenseIntOrFPElementsAttr>())
+    if (writeDenseElements(emitter, dense))
+      return;
+  if (auto resource = attr.dyn_cast<DenseResourceElementsAttr>()) {
+    // The blob of a resource is written once, however many attributes refer
+    // to it.
+    DenseResourceElementsHandle handle = resource.getRawHandle();
+    entry.emitVarInt(getTypeID(resource.getType()));
+    entry.emitVarInt(getStringID(handle.getKey()));
+    if (const AsmResourceBlob *blob = handle.getBlob()) {
+      auto it = blobIDs.try_emplace(handle.getEntry(), 0);
+      if (it.second)
+        it.first->second =
+            writeResource(blob->getData(), blob->getDataAlignment());
+      entry.emitVarInt(it.first->second + 1);
+    } else {
+      entry.emitVarInt(0);
+    }
+    return emitEntry(bytecode::AttrKind::kDenseResourceElements);
+  }
+
+  std::string asmStr;
+  llvm::raw_string_ostream asmOS(asmStr);
+  attr.print(asmOS);
+  entry.emitVarInt(getStringID(asmOS.str()));
+  emitEntry(bytecode::AttrKind::kAsm);
+}
+
+//===----------------------------------------------------------------------===//
+// IR
+
+void BytecodeWriter::numberValues(ValueScope &scope,
+                                  MutableArrayRef<Region> regions) {
+  for (Region &region : regions) {
+    for (Block &block : region)
+      for (BlockArgument arg : block.getArguments())
+        scope.ids.try_emplace(arg, scope.ids.size());
+    for (Block &block : region) {
+      for (Operation &op : block) {
+        for (OpResult result : op.getResults())
+          scope.ids.try_emplace(result, scope.ids.size());
+        if (!op.hasTrait<OpTrait::IsIsolatedFromAbove>())
+          numberValues(scope, op.getRegions());
+      }
+    }
+  }
+}
+
+void BytecodeWriter::writeOp(EncodingEmitter &emitter, ValueScope &scope,
+                             Operation *op) {
+  emitter.emitVarInt(getOpNameID(op->getName()));
+  emitter.emitVarInt(getAttrID(op->getLoc()));
+  emitter.emitVarInt(getAttrID(op->getAttrDictionary()));
+
+  emitter.emitVarInt(op->getNumResults());
+  for (Type type : op->getResultTypes())
+    emitter.emitVarInt(getTypeID(type));
+
+  emitter.emitVarInt(op->getNumOperands());
+  for (Value operand : op->getOperands()) {
+    auto it = scope.ids.find(operand);
+    assert(it != scope.ids.end() && "use of a value defined outside the IR");
+    emitter.emitVarInt(it->second);
+    // The reader needs the type to create a placeholder for forward uses.
+    if (it->second >= scope.numDefined)
+      emitter.emitVarInt(getTypeID(operand.getType()));
+  }
+  scope.numDefined += op->getNumResults();
+
+  emitter.emitVarInt(op->getNumSuccessors());
+  for (Block *successor : op->getSuccessors())
+    emitter.emitVarInt(blockIDs.lookup(successor));
+
+  emitter.emitVarInt(op->getNumRegions());
+  if (!op->getNumRegions())
+    return;
+  bool isIsolated = op->hasTrait<OpTrait::IsIsolatedFromAbove>();
+  emitter.emitByte(isIsolated);
+  if (!isIsolated)
+    return writeRegions(emitter, scope, op->getRegions());
+
+  ValueScope isolatedScope;
+  numberValues(isolatedScope, op->getRegions());
+  EncodingEmitter regionEmitter;
+  writeRegions(regionEmitter, isolatedScope, op->getRegions());
+  emitter.emitSized(regionEmitter);
+}
+
+void BytecodeWriter::writeRegions(EncodingEmitter &emitter, ValueScope &scope,
+                                  MutableArrayRef<Region> regions) {
+  for (Region &region : regions) {
+    emitter.emitVarInt(region.getBlocks().size());
+    for (auto &it : llvm::enumerate(region)) {
+      Block &block = it.value();
+      blockIDs[&block] = it.index();
+      emitter.emitVarInt(block.getNumArguments());
+      for (BlockArgument arg : block.getArguments()) {
+        emitter.emitVarInt(getTypeID(arg.getType()));
+        emitter.emitVarInt(getAttrID(arg.getLoc()));
+      }
+      scope.numDefined += block.getNumArguments();
+    }
+    for (Block &block : region) {
+      emitter.emitVarInt(block.getOperations().size());
+      for (Operation &op : block)
+        writeOp(emitter, scope, &op);
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// File
+
+void BytecodeWriter::emitSection(raw_ostream &os, uint64_t &offset,
+                                 bytecode::Section::ID id,
+                                 const EncodingEmitter &payload,
+                                 unsigned alignment) {
+  EncodingEmitter header;
+  header.emitByte(id);
+  header.emitVarInt(payload.size());
+  header.emitVarInt(alignment);
+  header.alignTo(offset, alignment);
+  os.write(reinterpret_cast<const char *>(header.data.data()), header.size());
+  os.write(reinterpret_cast<const char *>(payload.data.data()), payload.size());
+  offset += header.size() + payload.size();
+}
+
+void BytecodeWriter::write(Operation *rootOp, raw_ostream &os) {
+  // Encode the IR first, which populates the uniquing tables.
+  EncodingEmitter irEmitter;
+  {
+    ValueScope scope;
+    // The root operation is always written as if it was at the top level, so
+    // its results cannot be used and it has no operands or successors.
+    assert(rootOp->getNumOperands() == 0 && rootOp->getNumSuccessors() == 0 &&
+           "expected a top-level operation");
+    for (OpResult result : rootOp->getResults())
+      scope.ids.try_emplace(result, scope.ids.size());
+    if (!rootOp->hasTrait<OpTrait::IsIsolatedFromAbove>())
+      numberValues(scope, rootOp->getRegions());
+    irEmitter.emitVarInt(/*numOps=*/1);
+    writeOp(irEmitter, scope, rootOp);
+  }
+
+  // Encode the attribute and type tables. Entries may reference attributes,
+  // types and strings that have not been numbered yet, which grows the tables
+  // as they are walked.
+  EncodingEmitter attrEmitter;
+  for (size_t i = 0; i < attrs.size(); ++i)
+    writeAttr(attrEmitter, attrs[i]);
+  EncodingEmitter typeEmitter;
+  for (size_t i = 0; i < types.size(); ++i) {
+    std::string asmStr;
+    llvm::raw_string_ostream asmOS(asmStr);
+    types[i].print(asmOS);
+    typeEmitter.emitVarInt(getStringID(asmOS.str()));
+  }
+  EncodingEmitter attrTypeEmitter;
+  attrTypeEmitter.emitVarInt(attrs.size());
+  attrTypeEmitter.emitVarInt(types.size());
+  attrTypeEmitter.emitBytes(attrEmitter.data);
+  attrTypeEmitter.emitBytes(typeEmitter.data);
+
+  // Encode the dialect and operation names.
+  llvm::MapVector<StringRef, unsigned> dialects;
+  EncodingEmitter opNameEmitter;
+  for (auto &it : opNames) {
+    std::pair<StringRef, StringRef> nameParts =
+        it.first.getStringRef().split('.');
+    unsigned dialectID =
+        dialects.insert({nameParts.first, dialects.size()}).first->second;
+    opNameEmitter.emitVarInt(dialectID);
+    opNameEmitter.emitVarInt(getStringID(nameParts.second));
+  }
+  EncodingEmitter dialectEmitter;
+  dialectEmitter.emitVarInt(dialects.size());
+  for (auto &it : dialects)
+    dialectEmitter.emitVarInt(getStringID(it.first));
+  dialectEmitter.emitVarInt(opNames.size());
+  dialectEmitter.emitBytes(opNameEmitter.data);
+
+  // Encode the strings last, once every user has been encoded.
+  EncodingEmitter stringEmitter;
+  stringEmitter.emitVarInt(strings.size());
+  for (StringRef str : strings)
+    stringEmitter.emitVarInt(str.size());
+  for (StringRef str : strings)
+    stringEmitter.emitBytes(ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(str.data()), str.size()));
+
+  EncodingEmitter resourceSection;
+  resourceSection.emitVarInt(numResources);
+  // Keep the blobs at the alignment they were laid out for.
+  resourceSection.emitVarInt(resourceAlignment);
+  resourceSection.alignTo(/*offset=*/0, resourceAlignment);
+  resourceSection.emitBytes(resourceEmitter.data);
+
+  // Emit the header and the sections.
+  EncodingEmitter header;
+  header.emitBytes(bytecode::kMagic);
+  header.emitVarInt(bytecode::kVersion);
+  os.write(reinterpret_cast<const char *>(header.data.data()), header.size());
+  uint64_t offset = header.size();
+  emitSection(os, offset, bytecode::Section::kString, stringEmitter);
+  emitSection(os, offset, bytecode::Section::kDialect, dialectEmitter);
+  emitSection(os, offset, bytecode::Section::kResource, resourceSection,
+              resourceAlignment);
+  emitSection(os, offset, bytecode::Section::kAttrType, attrTypeEmitter);
+  emitSection(os, offset, bytecode::Section::kIR, irEmitter);
+}
+
+void mlir::writeBytecodeToFile(Operation *op, raw_ostream &os) {
+  BytecodeWriter().write(op, os);
+}
@@ -20,6 +20,7 @@
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/DialectImplementation.h"
+#include "mlir/IR/DialectResourceBlobManager.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/OpImplementation.h"
@@ -1285,6 +1286,20 @@ public:
       (*locationMap)[op] = std::make_pair(line, col);
   }
 
+  /// The resource blob entries referenced by the printed IR, grouped by the
+  /// dialect that owns them.
+  using ResourceMap =
+      llvm::MapVector<Dialect *,
+                      llvm::SetVector<DialectResourceBlobManager::BlobEntry *>>;
+
+  /// Register that the resource referenced by the given handle was printed.
+  void registerResourceUse(const DialectResourceBlobHandle &handle) {
+    usedResources[handle.getDialect()].insert(handle.getEntry());
+  }
+
+  /// Return the resources referenced by the printed IR.
+  const ResourceMap &getUsedResources() const { return usedResources; }
+
 private:
   /// Collection of OpAsm interfaces implemented in the context.
   DialectInterfaceCollection<OpAsmDialectInterface> interfaces;
@@ -1300,6 +1315,9 @@ private:
 
   /// An optional location map to be populated.
   AsmState::LocationMap *locationMap;
+
+  /// The resources referenced by the printed IR.
+  ResourceMap usedResources;
 };
 } // namespace detail
 } // namespace mlir
@@ -1838,6 +1856,15 @@ void AsmPrinter::Impl::printAttribute(Attribute attr,
       os << '>';
     }
 
+  } else if (auto resourceAttr = attr.dyn_cast<DenseResourceElementsAttr>()) {
+    // The blob data is printed once in the file metadata, so record the use.
+    DenseResourceElementsHandle handle = resourceAttr.getRawHandle();
+    if (state)
+      state->registerResourceUse(handle);
+    os << "dense_resource<";
+    ::printKeywordOrString(handle.getKey(), os);
+    os << '>';
+
   } else if (auto strEltAttr = attr.dyn_cast<DenseStringElementsAttr>()) {
     if (printerFlags.shouldElideElementsAttr(strEltAttr)) {
       printElidedElementsAttr(os);
@@ -2621,6 +2648,76 @@ private:
 };
 } // namespace
 
+/// Print the given resource blob as a file metadata value, either inline as a
+/// hex string of its alignment followed by its data, or as a reference to the
+/// external file region that it was loaded from.
+static void printResourceBlob(const AsmResourceBlob &blob, raw_ostream &os) {
+  ArrayRef<char> data = blob.getData();
+  if (const AsmResourceBlob::ExternalSource *source =
+          blob.getExternalSource()) {
+    os << "external(\"";
+    llvm::printEscapedString(source->path, os);
+    os << "\", " << source->offset << ", " << data.size() << ", "
+       << blob.getDataAlignment() << ')';
+    return;
+  }
+
+  char alignment[sizeof(uint32_t)];
+  llvm::support::endian::write32le(alignment, blob.getDataAlignment());
+  os << "\"0x" << llvm::toHex(StringRef(alignment, sizeof(alignment)));
+  // Stream the data in chunks to avoid materializing the hex form of large
+  // blobs in memory.
+  constexpr size_t kChunkSize = 4096;
+  for (size_t i = 0, e = data.size(); i < e; i += kChunkSize)
+    os << llvm::toHex(StringRef(data.data() + i, std::min(kChunkSize, e - i)));
+  os << '"';
+}
+
+/// Print the dialect resources referenced by the printed IR as a file metadata
+/// dictionary:
+///
+///   {-#
+///     dialect_resources: {
+///       builtin: {
+///         blob1: "0x08000000...",
+///         blob2: external("weights.bin", 0, 4096, 64)
+///       }
+///     }
+///   #-}
+///
+static void printDialectResources(const AsmStateImpl::ResourceMap &resources,
+                                  raw_ostream &os, NewLineCounter &newLine) {
+  // Entries without a blob have nothing to print.
+  auto hasBlob = [](DialectResourceBlobManager::BlobEntry *entry) {
+    return entry->getBlob() != nullptr;
+  };
+  auto hasBlobs = [&](const auto &it) {
+    return llvm::any_of(it.second, hasBlob);
+  };
+  auto dialectsWithBlobs = llvm::make_filter_range(resources, hasBlobs);
+  if (dialectsWithBlobs.begin() == dialectsWithBlobs.end())
+    return;
+
+  os << "{-#" << newLine << "  dialect_resources: {" << newLine;
+  llvm::interleave(
+      dialectsWithBlobs,
+      [&](const auto &it) {
+        os << "    " << it.first->getNamespace() << ": {" << newLine;
+        llvm::interleave(
+            llvm::make_filter_range(it.second, hasBlob),
+            [&](DialectResourceBlobManager::BlobEntry *entry) {
+              os << "      ";
+              ::printKeywordOrString(entry->getKey(), os);
+              os << ": ";
+              printResourceBlob(*entry->getBlob(), os);
+            },
+            [&] { os << ',' << newLine; });
+        os << newLine << "    }";
+      },
+      [&] { os << ',' << newLine; });
+  os << newLine << "  }" << newLine << "#-}" << newLine;
+}
+
 void OperationPrinter::printTopLevelOperation(Operation *op) {
   // Output the aliases at the top level that can't be deferred.
   state->getAliasState().printNonDeferredAliases(os, newLine);
@@ -2631,6 +2728,9 @@ void OperationPrinter::printTopLevelOperation(Operation *op) {
 
   // Output the aliases at the top level that can be deferred.
   state->getAliasState().printDeferredAliases(os, newLine);
+
+  // Output the resources referenced by the module.
+  printDialectResources(state->getUsedResources(), os, newLine);
 }
 
 /// Print a block argument in the usual format of:
@@ -1240,6 +1240,54 @@ bool DenseIntElementsAttr::classof(Attribute attr) {
          attr.getType().cast<ShapedType>().getElementType().isIntOrIndex();
 }
 
+//===----------------------------------------------------------------------===//
+// DenseResourceElementsAttr
+//===----------------------------------------------------------------------===//
+
+/// Return the blob manager interface of the builtin dialect.
+static const ResourceBlobManagerDialectInterface &
+getBuiltinBlobManager(MLIRContext *context) {
+  auto *dialect = context->getLoadedDialect<BuiltinDialect>();
+  using InterfaceT = ResourceBlobManagerDialectInterface;
+  return *dialect->getRegisteredInterface<InterfaceT>();
+}
+
+DenseResourceElementsAttr DenseResourceElementsAttr::get(ShapedType type,
+                                                         StringRef blobName,
+                                                         AsmResourceBlob blob) {
+  DenseResourceElementsHandle handle =
+      getBuiltinBlobManager(type.getContext())
+          .insert(blobName, std::move(blob));
+  return get(type, handle);
+}
+
+DenseResourceElementsAttr DenseResourceElementsAttr::getChecked(
+    function_ref<InFlightDiagnostic()> emitError, ShapedType type,
+    StringRef blobName, AsmResourceBlob blob) {
+  DenseResourceElementsHandle handle =
+      getBuiltinBlobManager(type.getContext())
+          .insert(blobName, std::move(blob));
+  return getChecked(emitError, type, handle);
+}
+
+ArrayRef<char> DenseResourceElementsAttr::getRawData() const {
+  if (AsmResourceBlob *blob = getBlob())
+    return blob->getData();
+  return {};
+}
+
+LogicalResult DenseResourceElementsAttr::verify(
+    function_ref<InFlightDiagnostic()> emitError, ShapedType type,
+    DenseResourceElementsHandle rawHandle) {
+  if (!type.hasStaticShape())
+    return emitError() << "expected a statically shaped type, but got "
+                       << type;
+  if (!rawHandle ||
+      !llvm::isa_and_nonnull<BuiltinDialect>(rawHandle.getDialect()))
+    return emitError() << "expected a handle to a builtin dialect resource";
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // OpaqueElementsAttr
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,138 @@
+//===- DialectResourceBlobManager.cpp - Dialect Blob Management -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/DialectResourceBlobManager.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace mlir;
+
+//===----------------------------------------------------------------------===//
+// AsmResourceBlob
+//===----------------------------------------------------------------------===//
+
+AsmResourceBlob HeapAsmResourceBlob::allocate(size_t size, size_t align,
+                                              bool dataIsMutable) {
+  char *data = static_cast<char *>(
+      llvm::allocate_buffer(size, std::max<size_t>(align, 1)));
+  auto deleter = [](const void *data, size_t size, size_t align) {
+    return llvm::deallocate_buffer(const_cast<void *>(data), size,
+                                   std::max<size_t>(align, 1));
+  };
+  return AsmResourceBlob(ArrayRef<char>(data, size), align, deleter,
+                         dataIsMutable);
+}
+
+AsmResourceBlob HeapAsmResourceBlob::allocateAndCopy(ArrayRef<char> data,
+                                                     size_t align,
+                                                     bool dataIsMutable) {
+  AsmResourceBlob blob = allocate(data.size(), align, dataIsMutable);
+  std::memcpy(const_cast<char *>(blob.getData().data()), data.data(),
+              data.size());
+  return blob;
+}
+
+AsmResourceBlob
+MappedAsmResourceBlob::allocate(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                                size_t align) {
+  ArrayRef<char> data(buffer->getBufferStart(), buffer->getBufferSize());
+  if (align > 1 && reinterpret_cast<uintptr_t>(data.data()) % align != 0)
+    return HeapAsmResourceBlob::allocateAndCopy(data, align,
+                                                /*dataIsMutable=*/false);
+
+  // The deleter takes ownership of the buffer, which unmaps it when the blob
+  // is destroyed.
+  llvm::MemoryBuffer *rawBuffer = buffer.release();
+  return UnmanagedAsmResourceBlob::allocate(
+      data, align, [rawBuffer](const void *, size_t, size_t) {
+        delete rawBuffer;
+      });
+}
+
+FailureOr<AsmResourceBlob>
+MappedAsmResourceBlob::mapFile(StringRef path, uint64_t offset,
+                               Optional<uint64_t> size, size_t align,
+                               std::string &errorMessage) {
+  uint64_t fileSize;
+  if (std::error_code error = llvm::sys::fs::file_size(path, fileSize)) {
+    errorMessage = "could not open '" + path.str() + "': " + error.message();
+    return failure();
+  }
+  if (offset > fileSize || (size && *size > fileSize - offset)) {
+    errorMessage = "region [" + std::to_string(offset) + ", " +
+                   std::to_string(offset + size.getValueOr(0)) +
+                   ") is out of bounds of '" + path.str() + "' of size " +
+                   std::to_string(fileSize);
+    return failure();
+  }
+  uint64_t mapSize = size ? *size : fileSize - offset;
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFileSlice(path, mapSize, offset);
+  if (std::error_code error = buffer.getError()) {
+    errorMessage = "could not map '" + path.str() + "': " + error.message();
+    return failure();
+  }
+  AsmResourceBlob blob = allocate(std::move(*buffer), align);
+  blob.setExternalSource({path.str(), offset});
+  return blob;
+}
+
+//===----------------------------------------------------------------------===//
+// DialectResourceBlobManager
+//===----------------------------------------------------------------------===//
+
+auto DialectResourceBlobManager::lookup(StringRef name) -> BlobEntry * {
+  llvm::sys::SmartScopedReader<true> reader(blobMapLock);
+
+  auto it = blobMap.find(name);
+  return it != blobMap.end() ? &it->second : nullptr;
+}
+
+void DialectResourceBlobManager::update(StringRef name,
+                                        AsmResourceBlob &&newBlob) {
+  BlobEntry *entry = lookup(name);
+  assert(entry && "`update` expects an existing entry for the provided name");
+  entry->setBlob(std::move(newBlob));
+}
+
+auto DialectResourceBlobManager::insert(StringRef name,
+                                        Optional<AsmResourceBlob> blob)
+    -> BlobEntry & {
+  llvm::sys::SmartScopedWriter<true> writer(blobMapLock);
+
+  // Functor used to attempt insertion with a given name.
+  auto tryInsertion = [&](StringRef name) -> BlobEntry * {
+    auto it = blobMap.try_emplace(name, BlobEntry());
+    if (it.second) {
+      it.first->second.key = it.first->getKey();
+      it.first->second.blob = std::move(blob);
+      return &it.first->second;
+    }
+    return nullptr;
+  };
+
+  // Try inserting with the name provided by the user.
+  if (BlobEntry *entry = tryInsertion(name))
+    return *entry;
+
+  // If an entry already exists for the user provided name, tweak the name and
+  // re-attempt insertion until we find one that is unique.
+  llvm::SmallString<32> nameStorage(name);
+  nameStorage.push_back('_');
+  size_t nameCounterPrefixLen = nameStorage.size();
+  while (true) {
+    Twine(nameCounter++).toVector(nameStorage);
+
+    // Try inserting with the new name.
+    if (BlobEntry *entry = tryInsertion(nameStorage))
+      return *entry;
+    nameStorage.resize(nameCounterPrefixLen);
+  }
+}
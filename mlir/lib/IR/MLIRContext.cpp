@@ -471,6 +471,12 @@ llvm::hash_code MLIRContext::getRegistryHash() {
   return hash;
 }
 
+uint64_t MLIRContext::getStorageBytesAllocatedOnCurrentThread() {
+  return impl->affineUniquer.getBytesAllocatedOnCurrentThread() +
+         impl->attributeUniquer.getBytesAllocatedOnCurrentThread() +
+         impl->typeUniquer.getBytesAllocatedOnCurrentThread();
+}
+
 bool MLIRContext::allowsUnregisteredDialects() {
   return impl->allowUnregisteredDialects;
 }
@@ -12,6 +12,7 @@
 
 #include "Parser.h"
 #include "mlir/IR/AffineMap.h"
+#include "mlir/IR/BuiltinDialect.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/IntegerSet.h"
@@ -35,6 +36,8 @@ using namespace mlir::detail;
 ///                    | symbol-ref-id (`::` symbol-ref-id)*
 ///                    | `dense` `<` tensor-literal `>` `:`
 ///                      (tensor-type | vector-type)
+///                    | `dense_resource` `<` resource-handle `>` `:`
+///                      (tensor-type | vector-type)
 ///                    | `sparse` `<` attribute-value `,` attribute-value `>`
 ///                      `:` (tensor-type | vector-type)
 ///                    | `opaque` `<` dialect-namespace  `,` hex-string-literal
@@ -90,6 +93,10 @@ Attribute Parser::parseAttribute(Type type) {
   case Token::kw_dense:
     return parseDenseElementsAttr(type);
 
+  // Parse a dense resource elements attribute.
+  case Token::kw_dense_resource:
+    return parseDenseResourceElementsAttr(type);
+
   // Parse a dictionary attribute.
   case Token::l_brace: {
     NamedAttrList elements;
@@ -227,6 +234,7 @@ OptionalParseResult Parser::parseOptionalAttribute(Attribute &attribute,
   case Token::kw_affine_map:
   case Token::kw_affine_set:
   case Token::kw_dense:
+  case Token::kw_dense_resource:
   case Token::kw_false:
   case Token::kw_loc:
   case Token::kw_opaque:
@@ -868,6 +876,32 @@ Attribute Parser::parseOpaqueElementsAttr(Type attrType) {
                                         data);
 }
 
+/// Parse a dense resource elements attribute.
+///
+///   dense-resource-elements-attr ::= `dense_resource` `<` resource-handle `>`
+///                                    `:` (tensor-type | vector-type)
+///
+Attribute Parser::parseDenseResourceElementsAttr(Type attrType) {
+  auto loc = getToken().getLoc();
+  consumeToken(Token::kw_dense_resource);
+  if (parseToken(Token::less, "expected '<' after 'dense_resource'"))
+    return nullptr;
+
+  // The resources of the attribute are held by the builtin dialect.
+  auto *dialect = getContext()->getLoadedDialect<BuiltinDialect>();
+  const auto *blobManager =
+      dialect->getRegisteredInterface<ResourceBlobManagerDialectInterface>();
+  FailureOr<DialectResourceBlobHandle> handle =
+      parseResourceHandle(*blobManager);
+  if (failed(handle) || parseToken(Token::greater, "expected '>'"))
+    return nullptr;
+
+  auto type = parseElementsLiteralType(attrType);
+  if (!type)
+    return nullptr;
+  return getChecked<DenseResourceElementsAttr>(loc, type, *handle);
+}
+
 /// Shaped type for elements attribute.
 ///
 ///   elements-literal-type ::= vector-type | ranked-tensor-type
@@ -0,0 +1,858 @@
+//===- BytecodeReader.cpp - MLIR Bytecode Reader --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the reader of the MLIR bytecode format. See
+// mlir/Bytecode/Encoding.h and the bytecode writer for the encoding.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/BytecodeReader.h"
+#include "mlir/Bytecode/Encoding.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinDialect.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Verifier.h"
+#include "mlir/Parser/Parser.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MemoryBufferRef.h"
+
+using namespace mlir;
+
+bool mlir::isBytecode(llvm::MemoryBufferRef buffer) {
+  return buffer.getBuffer().startswith(
+      StringRef(reinterpret_cast<const char *>(bytecode::kMagic),
+                sizeof(bytecode::kMagic)));
+}
+
+//===----------------------------------------------------------------------===//
+// EncodingReader
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// This class reads the primitive values of the encoding from a range of the
+/// file.
+class EncodingReader {
+public:
+  EncodingReader(ArrayRef<uint8_t> contents, const uint8_t *fileStart,
+                 Location fileLoc)
+      : dataIt(contents.begin()), dataEnd(contents.end()),
+        fileStart(fileStart), fileLoc(fileLoc) {}
+
+  bool empty() const { return dataIt == dataEnd; }
+  /// Return the number of bytes that remain to be read.
+  uint64_t size() const { return dataEnd - dataIt; }
+
+  InFlightDiagnostic emitError(const Twine &msg = {}) const {
+    return ::emitError(fileLoc, msg);
+  }
+
+  LogicalResult parseByte(uint8_t &value) {
+    if (empty())
+      return emitError("attempting to parse a byte at the end of the bytecode");
+    value = *dataIt++;
+    return success();
+  }
+
+  LogicalResult parseVarInt(uint64_t &value) {
+    unsigned size = 0;
+    const char *error = nullptr;
+    value = llvm::decodeULEB128(dataIt, &size, dataEnd, &error);
+    if (error)
+      return emitError("invalid varint in the bytecode: ") << error;
+    dataIt += size;
+    return success();
+  }
+
+  /// Parse a varint that must be less than `limit`, which is used for the
+  /// indices into the uniquing tables.
+  LogicalResult parseIndex(uint64_t &value, uint64_t limit, StringRef kind) {
+    if (failed(parseVarInt(value)))
+      return failure();
+    if (value >= limit)
+      return emitError("invalid ") << kind << " index " << value << ", only "
+                                   << limit << " are defined";
+    return success();
+  }
+
+  /// Parse the number of entries of a list, which is checked against the
+  /// remaining bytes before anything is allocated for the entries: every
+  /// entry takes at least one byte.
+  LogicalResult parseCount(uint64_t &count, StringRef kind) {
+    if (failed(parseVarInt(count)))
+      return failure();
+    if (count > size())
+      return emitError("invalid number of ")
+             << kind << " " << count << ", only " << size()
+             << " bytes remain";
+    return success();
+  }
+
+  LogicalResult parseBytes(uint64_t size, ArrayRef<uint8_t> &bytes) {
+    if (size > this->size())
+      return emitError("attempting to parse ")
+             << size << " bytes when only " << this->size() << " remain";
+    bytes = ArrayRef<uint8_t>(dataIt, size);
+    dataIt += size;
+    return success();
+  }
+
+  /// Parse a size-prefixed range of bytes.
+  LogicalResult parseSizedBytes(ArrayRef<uint8_t> &bytes) {
+    uint64_t size;
+    return failure(failed(parseVarInt(size)) || failed(parseBytes(size, bytes)));
+  }
+
+  /// Skip the padding that aligns the current position, relative to the start
+  /// of the file, to `alignment`.
+  LogicalResult alignTo(uint64_t alignment) {
+    if (!llvm::isPowerOf2_64(alignment))
+      return emitError("expected alignment to be a power-of-two");
+    while ((dataIt - fileStart) & (alignment - 1)) {
+      uint8_t padding;
+      if (failed(parseByte(padding)))
+        return failure();
+      if (padding != bytecode::kAlignmentByte)
+        return emitError("expected alignment byte (0xcb), but got: '0x")
+               << llvm::utohexstr(padding) << "'";
+    }
+    return success();
+  }
+
+private:
+  const uint8_t *dataIt, *dataEnd;
+  const uint8_t *fileStart;
+  Location fileLoc;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// BytecodeReader::Impl
+//===----------------------------------------------------------------------===//
+
+class BytecodeReader::Impl {
+public:
+  Impl(llvm::MemoryBufferRef buffer, MLIRContext *context)
+      : buffer(buffer), context(context),
+        fileLoc(FileLineColLoc::get(context, buffer.getBufferIdentifier(),
+                                    /*line=*/0, /*column=*/0)) {}
+
+  LogicalResult read(Block *block,
+                     std::function<bool(Operation *)> lazyOpsCallback);
+  LogicalResult materialize(Operation *op);
+
+  /// The operations whose regions are yet to be read, with the encoded
+  /// regions.
+  llvm::MapVector<Operation *, ArrayRef<uint8_t>> lazyOps;
+
+private:
+  //===--------------------------------------------------------------------===//
+  // Sections
+
+  LogicalResult parseStringSection(ArrayRef<uint8_t> data);
+  LogicalResult parseDialectSection(ArrayRef<uint8_t> data);
+  LogicalResult parseResourceSection(ArrayRef<uint8_t> data);
+  LogicalResult parseAttrTypeSection(ArrayRef<uint8_t> data);
+
+  EncodingReader getReader(ArrayRef<uint8_t> data) const {
+    return EncodingReader(data, fileStart(), fileLoc);
+  }
+  const uint8_t *fileStart() const {
+    return reinterpret_cast<const uint8_t *>(buffer.getBufferStart());
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Uniquing tables
+
+  LogicalResult parseString(EncodingReader &reader, StringRef &str) {
+    uint64_t index;
+    if (failed(reader.parseIndex(index, strings.size(), "string")))
+      return failure();
+    str = strings[index];
+    return success();
+  }
+
+  FailureOr<OperationName> parseOpName(EncodingReader &reader);
+
+  template <typename T = Attribute>
+  LogicalResult parseAttribute(EncodingReader &reader, T &result) {
+    uint64_t index;
+    if (failed(reader.parseIndex(index, attrs.size(), "attribute")))
+      return failure();
+    Attribute attr = resolveAttribute(index);
+    if (!attr)
+      return failure();
+    result = attr.dyn_cast<T>();
+    if (!result)
+      return reader.emitError("unexpected attribute kind: ") << attr;
+    return success();
+  }
+  LogicalResult parseLocation(EncodingReader &reader, LocationAttr &loc) {
+    return parseAttribute(reader, loc);
+  }
+
+  LogicalResult parseType(EncodingReader &reader, Type &result) {
+    uint64_t index;
+    if (failed(reader.parseIndex(index, types.size(), "type")))
+      return failure();
+    result = resolveType(index);
+    return success(static_cast<bool>(result));
+  }
+
+  /// Return the attribute or type with the given index, decoding it on first
+  /// use. Returns null on failure.
+  Attribute resolveAttribute(size_t index);
+  Type resolveType(size_t index);
+
+  //===--------------------------------------------------------------------===//
+  // IR
+
+  /// The values of an isolated-from-above region tree, in the order in which
+  /// they are defined, and the placeholders created for values that are used
+  /// before being defined.
+  struct ValueScope {
+    ~ValueScope() {
+      // Placeholders are left behind when reading fails.
+      for (auto &it : forwardRefs) {
+        it.second->dropAllUses();
+        it.second->destroy();
+      }
+    }
+
+    std::vector<Value> values;
+    DenseMap<uint64_t, Operation *> forwardRefs;
+  };
+
+  LogicalResult parseOperation(EncodingReader &reader, ValueScope &scope,
+                               Block *block);
+  LogicalResult parseRegions(EncodingReader &reader, ValueScope &scope,
+                             MutableArrayRef<Region> regions);
+  /// Parse the regions of an isolated operation in their own value scope.
+  LogicalResult parseIsolatedRegions(ArrayRef<uint8_t> data, Operation *op);
+  LogicalResult parseOperand(EncodingReader &reader, ValueScope &scope,
+                             Value &value);
+  void defineValue(ValueScope &scope, Value value);
+  LogicalResult finalizeScope(ValueScope &scope);
+
+  llvm::MemoryBufferRef buffer;
+  MLIRContext *context;
+  Location fileLoc;
+  std::function<bool(Operation *)> lazyOpsCallback;
+
+  std::vector<StringRef> strings;
+  struct OpNameEntry {
+    StringRef dialect, name;
+    Optional<OperationName> opName;
+  };
+  std::vector<OpNameEntry> opNames;
+  struct ResourceEntry {
+    ArrayRef<uint8_t> data;
+    uint64_t alignment;
+  };
+  std::vector<ResourceEntry> resources;
+  /// The dialect resource handles created for the resource keys of the file.
+  llvm::StringMap<DialectResourceBlobHandle> resourceHandles;
+  struct AttrEntry {
+    Attribute attr;
+    uint8_t kind;
+    ArrayRef<uint8_t> data;
+    /// Set while the entry is being decoded, to reject entries that refer to
+    /// themselves.
+    bool resolving = false;
+  };
+  std::vector<AttrEntry> attrs;
+  struct TypeEntry {
+    Type type;
+    StringRef asmStr;
+  };
+  std::vector<TypeEntry> types;
+};
+
+LogicalResult BytecodeReader::Impl::parseStringSection(ArrayRef<uint8_t> data) {
+  EncodingReader reader = getReader(data);
+  uint64_t numStrings;
+  if (failed(reader.parseCount(numStrings, "strings")))
+    return failure();
+  SmallVector<uint64_t> sizes(numStrings);
+  for (uint64_t &size : sizes)
+    if (failed(reader.parseVarInt(size)))
+      return failure();
+  strings.reserve(numStrings);
+  for (uint64_t size : sizes) {
+    ArrayRef<uint8_t> bytes;
+    if (failed(reader.parseBytes(size, bytes)))
+      return failure();
+    strings.emplace_back(reinterpret_cast<const char *>(bytes.data()),
+                         bytes.size());
+  }
+  return success();
+}
+
+LogicalResult
+BytecodeReader::Impl::parseDialectSection(ArrayRef<uint8_t> data) {
+  EncodingReader reader = getReader(data);
+  uint64_t numDialects;
+  if (failed(reader.parseCount(numDialects, "dialects")))
+    return failure();
+  SmallVector<StringRef> dialects(numDialects);
+  for (StringRef &dialect : dialects)
+    if (failed(parseString(reader, dialect)))
+      return failure();
+
+  uint64_t numOpNames;
+  if (failed(reader.parseCount(numOpNames, "operation names")))
+    return failure();
+  opNames.resize(numOpNames);
+  for (OpNameEntry &entry : opNames) {
+    uint64_t dialectIndex;
+    if (failed(reader.parseIndex(dialectIndex, numDialects, "dialect")) ||
+        failed(parseString(reader, entry.name)))
+      return failure();
+    entry.dialect = dialects[dialectIndex];
+  }
+  return success();
+}
+
+LogicalResult
+BytecodeReader::Impl::parseResourceSection(ArrayRef<uint8_t> data) {
+  EncodingReader reader = getReader(data);
+  uint64_t numBlobs, maxAlignment;
+  if (failed(reader.parseCount(numBlobs, "resources")) ||
+      failed(reader.parseVarInt(maxAlignment)) ||
+      failed(reader.alignTo(maxAlignment)))
+    return failure();
+  resources.reserve(numBlobs);
+  for (uint64_t i = 0; i < numBlobs; ++i) {
+    uint64_t alignment, size;
+    ArrayRef<uint8_t> blob;
+    if (failed(reader.parseVarInt(alignment)) ||
+        failed(reader.parseVarInt(size)) ||
+        failed(reader.alignTo(alignment)) ||
+        failed(reader.parseBytes(size, blob)))
+      return failure();
+    resources.push_back({blob, alignment});
+  }
+  return success();
+}
+
+LogicalResult
+BytecodeReader::Impl::parseAttrTypeSection(ArrayRef<uint8_t> data) {
+  EncodingReader reader = getReader(data);
+  uint64_t numAttrs, numTypes;
+  if (failed(reader.parseCount(numAttrs, "attributes")) ||
+      failed(reader.parseCount(numTypes, "types")))
+    return failure();
+
+  // Only record where each entry is, the entries are decoded on first use.
+  attrs.resize(numAttrs);
+  for (AttrEntry &entry : attrs)
+    if (failed(reader.parseByte(entry.kind)) ||
+        failed(reader.parseSizedBytes(entry.data)))
+      return failure();
+  types.resize(numTypes);
+  for (TypeEntry &entry : types)
+    if (failed(parseString(reader, entry.asmStr)))
+      return failure();
+  return success();
+}
+
+FailureOr<OperationName>
+BytecodeReader::Impl::parseOpName(EncodingReader &reader) {
+  uint64_t index;
+  if (failed(reader.parseIndex(index, opNames.size(), "operation name")))
+    return failure();
+  OpNameEntry &entry = opNames[index];
+  if (entry.opName)
+    return *entry.opName;
+
+  // Load the dialect of the operation, as the textual parser does.
+  std::string name = entry.name.empty()
+                         ? entry.dialect.str()
+                         : (entry.dialect + "." + entry.name).str();
+  OperationName opName(name, context);
+  if (!opName.isRegistered() && !context->getLoadedDialect(entry.dialect) &&
+      !context->getOrLoadDialect(entry.dialect) &&
+      !context->allowsUnregisteredDialects())
+    return reader.emitError("operation '")
+           << name
+           << "' being read with an unregistered dialect. If this is "
+              "intended, please use -allow-unregistered-dialect with the MLIR "
+              "tool used";
+  // The operation may have become registered when its dialect was loaded.
+  entry.opName = OperationName(name, context);
+  return *entry.opName;
+}
+
+Attribute BytecodeReader::Impl::resolveAttribute(size_t index) {
+  AttrEntry &entry = attrs[index];
+  if (entry.attr)
+    return entry.attr;
+  if (entry.resolving) {
+    emitError(fileLoc, "attribute ") << index << " refers to itself";
+    return {};
+  }
+  entry.resolving = true;
+  auto resetResolving = llvm::make_scope_exit([&] { entry.resolving = false; });
+
+  EncodingReader reader = getReader(entry.data);
+  Attribute result;
+  switch (entry.kind) {
+  case bytecode::AttrKind::kAsm: {
+    StringRef asmStr;
+    if (failed(parseString(reader, asmStr)))
+      return {};
+    size_t numRead = 0;
+    result = ::mlir::parseAttribute(asmStr, context, numRead);
+    if (result && numRead != asmStr.size()) {
+      reader.emitError("trailing characters found after attribute assembly "
+                       "format: ")
+          << asmStr.drop_front(numRead);
+      return {};
+    }
+    break;
+  }
+  case bytecode::AttrKind::kString: {
+    StringRef str;
+    if (failed(parseString(reader, str)))
+      return {};
+    result = StringAttr::get(context, str);
+    break;
+  }
+  case bytecode::AttrKind::kDictionary: {
+    uint64_t numEntries;
+    if (failed(reader.parseCount(numEntries, "dictionary entries")))
+      return {};
+    SmallVector<NamedAttribute> namedAttrs;
+    namedAttrs.reserve(numEntries);
+    for (uint64_t i = 0; i < numEntries; ++i) {
+      StringRef name;
+      Attribute value;
+      if (failed(parseString(reader, name)) ||
+          failed(parseAttribute(reader, value)))
+        return {};
+      namedAttrs.emplace_back(StringAttr::get(context, name), value);
+    }
+    result = DictionaryAttr::get(context, namedAttrs);
+    break;
+  }
+  case bytecode::AttrKind::kDenseElements: {
+    Type type;
+    uint64_t blobIndex;
+    uint8_t isSplat;
+    if (failed(parseType(reader, type)) ||
+        failed(reader.parseIndex(blobIndex, resources.size(), "resource")) ||
+        failed(reader.parseByte(isSplat)))
+      return {};
+    auto shapedType = type.dyn_cast<ShapedType>();
+    ArrayRef<uint8_t> blob = resources[blobIndex].data;
+    ArrayRef<char> rawData(reinterpret_cast<const char *>(blob.data()),
+                           blob.size());
+    bool detectedSplat = false;
+    if (!shapedType ||
+        !DenseElementsAttr::isValidRawBuffer(shapedType, rawData,
+                                             detectedSplat) ||
+        detectedSplat != bool(isSplat)) {
+      reader.emitError("invalid dense elements payload for type ") << type;
+      return {};
+    }
+    result = DenseElementsAttr::getFromRawBuffer(shapedType, rawData, isSplat);
+    break;
+  }
+  case bytecode::AttrKind::kDenseResourceElements: {
+    Type type;
+    StringRef key;
+    uint64_t blobIndex;
+    if (failed(parseType(reader, type)) || failed(parseString(reader, key)) ||
+        failed(reader.parseIndex(blobIndex, resources.size() + 1, "resource")))
+      return {};
+    auto shapedType = type.dyn_cast<ShapedType>();
+    if (!shapedType) {
+      reader.emitError("invalid dense resource elements type ") << type;
+      return {};
+    }
+
+    // Every attribute referring to the same key shares a single entry of the
+    // builtin blob manager. The bytecode buffer is not guaranteed to outlive
+    // the context, so the blob data is copied out of it.
+    DenseResourceElementsHandle &handle = resourceHandles[key];
+    if (!handle) {
+      auto *dialect = context->getLoadedDialect<BuiltinDialect>();
+      const auto *blobManager = dialect->getRegisteredInterface<
+          ResourceBlobManagerDialectInterface>();
+      Optional<AsmResourceBlob> blob;
+      if (blobIndex != 0) {
+        const ResourceEntry &resource = resources[blobIndex - 1];
+        blob = HeapAsmResourceBlob::allocateAndCopy(
+            ArrayRef<char>(reinterpret_cast<const char *>(resource.data.data()),
+                           resource.data.size()),
+            resource.alignment);
+      }
+      handle = blobManager->insert(key, std::move(blob));
+    }
+    result = DenseResourceElementsAttr::get(shapedType, handle);
+    break;
+  }
+  case bytecode::AttrKind::kUnknownLoc:
+    result = UnknownLoc::get(context);
+    break;
+  case bytecode::AttrKind::kFileLineColLoc: {
+    StringRef filename;
+    uint64_t line, column;
+    if (failed(parseString(reader, filename)) ||
+        failed(reader.parseVarInt(line)) || failed(reader.parseVarInt(column)))
+      return {};
+    result = FileLineColLoc::get(context, filename, line, column);
+    break;
+  }
+  case bytecode::AttrKind::kNameLoc: {
+    StringRef name;
+    LocationAttr childLoc;
+    if (failed(parseString(reader, name)) ||
+        failed(parseLocation(reader, childLoc)))
+      return {};
+    result = NameLoc::get(StringAttr::get(context, name), childLoc);
+    break;
+  }
+  case bytecode::AttrKind::kCallSiteLoc: {
+    LocationAttr callee, caller;
+    if (failed(parseLocation(reader, callee)) ||
+        failed(parseLocation(reader, caller)))
+      return {};
+    result = CallSiteLoc::get(callee, caller);
+    break;
+  }
+  case bytecode::AttrKind::kFusedLoc: {
+    uint64_t metadataIndex, numLocs;
+    if (failed(reader.parseIndex(metadataIndex, attrs.size() + 1, "attribute")))
+      return {};
+    Attribute metadata;
+    if (metadataIndex && !(metadata = resolveAttribute(metadataIndex - 1)))
+      return {};
+    if (failed(reader.parseCount(numLocs, "locations")))
+      return {};
+    SmallVector<Location> locs;
+    locs.reserve(numLocs);
+    for (uint64_t i = 0; i < numLocs; ++i) {
+      LocationAttr loc;
+      if (failed(parseLocation(reader, loc)))
+        return {};
+      locs.push_back(loc);
+    }
+    result = FusedLoc::get(locs, metadata, context);
+    break;
+  }
+  default:
+    reader.emitError("unknown attribute encoding ") << unsigned(entry.kind);
+    return {};
+  }
+  if (result && !reader.empty()) {
+    reader.emitError("unexpected trailing bytes in attribute entry");
+    return {};
+  }
+  return entry.attr = result;
+}
+
+Type BytecodeReader::Impl::resolveType(size_t index) {
+  TypeEntry &entry = types[index];
+  if (entry.type)
+    return entry.type;
+
+  size_t numRead = 0;
+  entry.type = ::mlir::parseType(entry.asmStr, context, numRead);
+  if (entry.type && numRead != entry.asmStr.size()) {
+    emitError(fileLoc, "trailing characters found after type assembly format: ")
+        << entry.asmStr.drop_front(numRead);
+    return entry.type = Type();
+  }
+  return entry.type;
+}
+
+//===----------------------------------------------------------------------===//
+// IR
+
+void BytecodeReader::Impl::defineValue(ValueScope &scope, Value value) {
+  uint64_t id = scope.values.size();
+  scope.values.push_back(value);
+  auto it = scope.forwardRefs.find(id);
+  if (it == scope.forwardRefs.end())
+    return;
+  Operation *placeholder = it->second;
+  placeholder->getResult(0).replaceAllUsesWith(value);
+  placeholder->destroy();
+  scope.forwardRefs.erase(it);
+}
+
+LogicalResult BytecodeReader::Impl::parseOperand(EncodingReader &reader,
+                                                 ValueScope &scope,
+                                                 Value &value) {
+  uint64_t id;
+  if (failed(reader.parseVarInt(id)))
+    return failure();
+  if (id < scope.values.size()) {
+    value = scope.values[id];
+    return success();
+  }
+
+  // This is a use before the definition, which is followed by the type.
+  Type type;
+  if (failed(parseType(reader, type)))
+    return failure();
+  Operation *&placeholder = scope.forwardRefs[id];
+  if (!placeholder) {
+    // Forward references are represented the same way as in the textual
+    // parser: as results of unlinked operations that are replaced once the
+    // value is defined.
+    placeholder = Operation::create(
+        fileLoc, OperationName("builtin.unrealized_conversion_cast", context),
+        type, /*operands=*/{}, /*attributes=*/llvm::None, /*successors=*/{},
+        /*numRegions=*/0);
+  }
+  value = placeholder->getResult(0);
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::finalizeScope(ValueScope &scope) {
+  if (scope.forwardRefs.empty())
+    return success();
+  return emitError(fileLoc, "use of a value that is never defined");
+}
+
+LogicalResult BytecodeReader::Impl::parseOperation(EncodingReader &reader,
+                                                   ValueScope &scope,
+                                                   Block *block) {
+  FailureOr<OperationName> opName = parseOpName(reader);
+  LocationAttr loc;
+  DictionaryAttr attrDict;
+  uint64_t numResults;
+  if (failed(opName) || failed(parseLocation(reader, loc)) ||
+      failed(parseAttribute(reader, attrDict)) ||
+      failed(reader.parseCount(numResults, "results")))
+    return failure();
+
+  SmallVector<Type> resultTypes(numResults);
+  for (Type &type : resultTypes)
+    if (failed(parseType(reader, type)))
+      return failure();
+
+  uint64_t numOperands;
+  if (failed(reader.parseCount(numOperands, "operands")))
+    return failure();
+  SmallVector<Value> operands(numOperands);
+  for (Value &operand : operands)
+    if (failed(parseOperand(reader, scope, operand)))
+      return failure();
+
+  // Successors are blocks of the region that contains the operation, which
+  // are all created before any of its operations is read.
+  uint64_t numSuccessors;
+  if (failed(reader.parseCount(numSuccessors, "successors")))
+    return failure();
+  SmallVector<Block *> successors(numSuccessors);
+  Region *parentRegion = block->getParent();
+  for (Block *&successor : successors) {
+    uint64_t index;
+    if (!parentRegion)
+      return reader.emitError("successors are not allowed at the top level");
+    if (failed(reader.parseIndex(index, parentRegion->getBlocks().size(),
+                                 "block")))
+      return failure();
+    successor = &*std::next(parentRegion->begin(), index);
+  }
+
+  uint64_t numRegions;
+  if (failed(reader.parseCount(numRegions, "regions")))
+    return failure();
+
+  Operation *op = Operation::create(loc, *opName, resultTypes, operands,
+                                    attrDict, successors, numRegions);
+  block->push_back(op);
+  for (OpResult result : op->getResults())
+    defineValue(scope, result);
+  if (!numRegions)
+    return success();
+
+  uint8_t isIsolated;
+  if (failed(reader.parseByte(isIsolated)))
+    return failure();
+  if (!isIsolated)
+    return parseRegions(reader, scope, op->getRegions());
+
+  ArrayRef<uint8_t> regionData;
+  if (failed(reader.parseSizedBytes(regionData)))
+    return failure();
+  if (lazyOpsCallback && lazyOpsCallback(op)) {
+    lazyOps.insert({op, regionData});
+    return success();
+  }
+  return parseIsolatedRegions(regionData, op);
+}
+
+LogicalResult
+BytecodeReader::Impl::parseRegions(EncodingReader &reader, ValueScope &scope,
+                                   MutableArrayRef<Region> regions) {
+  for (Region &region : regions) {
+    uint64_t numBlocks;
+    if (failed(reader.parseVarInt(numBlocks)))
+      return failure();
+
+    // Create all of the blocks and their arguments first, so that they can be
+    // referenced as successors and their arguments used anywhere.
+    for (uint64_t i = 0; i < numBlocks; ++i) {
+      Block *block = new Block();
+      region.push_back(block);
+      uint64_t numArgs;
+      if (failed(reader.parseVarInt(numArgs)))
+        return failure();
+      for (uint64_t j = 0; j < numArgs; ++j) {
+        Type type;
+        LocationAttr loc;
+        if (failed(parseType(reader, type)) || failed(parseLocation(reader, loc)))
+          return failure();
+        defineValue(scope, block->addArgument(type, loc));
+      }
+    }
+
+    for (Block &block : region) {
+      uint64_t numOps;
+      if (failed(reader.parseVarInt(numOps)))
+        return failure();
+      for (uint64_t i = 0; i < numOps; ++i)
+        if (failed(parseOperation(reader, scope, &block)))
+          return failure();
+    }
+  }
+  return success();
+}
+
+LogicalResult
+BytecodeReader::Impl::parseIsolatedRegions(ArrayRef<uint8_t> data,
+                                           Operation *op) {
+  EncodingReader reader = getReader(data);
+  ValueScope scope;
+  if (failed(parseRegions(reader, scope, op->getRegions())) ||
+      failed(finalizeScope(scope)))
+    return failure();
+  if (!reader.empty())
+    return reader.emitError("unexpected trailing bytes after the regions of '")
+           << op->getName() << "'";
+  return success();
+}
+
+LogicalResult
+BytecodeReader::Impl::read(Block *block,
+                           std::function<bool(Operation *)> lazyOpsCallback) {
+  this->lazyOpsCallback = std::move(lazyOpsCallback);
+  ArrayRef<uint8_t> contents(fileStart(), buffer.getBufferSize());
+  EncodingReader reader = getReader(contents);
+
+  ArrayRef<uint8_t> magic;
+  uint64_t version;
+  if (failed(reader.parseBytes(sizeof(bytecode::kMagic), magic)) ||
+      !llvm::equal(magic, bytecode::kMagic))
+    return reader.emitError("input buffer is not an MLIR bytecode file");
+  if (failed(reader.parseVarInt(version)))
+    return failure();
+  if (version > bytecode::kVersion)
+    return reader.emitError("bytecode version ")
+           << version << " is newer than the current version "
+           << bytecode::kVersion;
+
+  // Locate the sections, which must all be present.
+  Optional<ArrayRef<uint8_t>> sections[bytecode::Section::kNumSections];
+  while (!reader.empty()) {
+    uint8_t id;
+    uint64_t size, alignment;
+    ArrayRef<uint8_t> data;
+    if (failed(reader.parseByte(id)) || failed(reader.parseVarInt(size)) ||
+        failed(reader.parseVarInt(alignment)) ||
+        failed(reader.alignTo(alignment)) ||
+        failed(reader.parseBytes(size, data)))
+      return failure();
+    if (id >= bytecode::Section::kNumSections)
+      return reader.emitError("invalid section ID: ") << unsigned(id);
+    if (sections[id])
+      return reader.emitError("duplicate section ID: ") << unsigned(id);
+    sections[id] = data;
+  }
+  for (unsigned i = 0; i < bytecode::Section::kNumSections; ++i)
+    if (!sections[i])
+      return reader.emitError("missing section ID: ") << i;
+
+  if (failed(parseStringSection(*sections[bytecode::Section::kString])) ||
+      failed(parseDialectSection(*sections[bytecode::Section::kDialect])) ||
+      failed(parseResourceSection(*sections[bytecode::Section::kResource])) ||
+      failed(parseAttrTypeSection(*sections[bytecode::Section::kAttrType])))
+    return failure();
+
+  EncodingReader irReader = getReader(*sections[bytecode::Section::kIR]);
+  uint64_t numOps;
+  if (failed(irReader.parseVarInt(numOps)))
+    return failure();
+  ValueScope scope;
+  for (uint64_t i = 0; i < numOps; ++i)
+    if (failed(parseOperation(irReader, scope, block)))
+      return failure();
+  return finalizeScope(scope);
+}
+
+LogicalResult BytecodeReader::Impl::materialize(Operation *op) {
+  auto it = lazyOps.find(op);
+  assert(it != lazyOps.end() && "operation is not materializable");
+  ArrayRef<uint8_t> data = it->second;
+  lazyOps.erase(it);
+  return parseIsolatedRegions(data, op);
+}
+
+//===----------------------------------------------------------------------===//
+// BytecodeReader
+//===----------------------------------------------------------------------===//
+
+BytecodeReader::BytecodeReader(llvm::MemoryBufferRef buffer,
+                               MLIRContext *context)
+    : impl(std::make_unique<Impl>(buffer, context)) {}
+
+BytecodeReader::~BytecodeReader() = default;
+
+LogicalResult
+BytecodeReader::readTopLevel(Block *block,
+                             std::function<bool(Operation *)> lazyOpsCallback) {
+  return impl->read(block, std::move(lazyOpsCallback));
+}
+
+int64_t BytecodeReader::getNumOpsToMaterialize() const {
+  return impl->lazyOps.size();
+}
+
+bool BytecodeReader::isMaterializable(Operation *op) const {
+  return impl->lazyOps.count(op);
+}
+
+LogicalResult BytecodeReader::materialize(Operation *op) {
+  return impl->materialize(op);
+}
+
+LogicalResult BytecodeReader::materializeAll() {
+  while (!impl->lazyOps.empty())
+    if (failed(impl->materialize(impl->lazyOps.front().first)))
+      return failure();
+  return success();
+}
+
+LogicalResult mlir::readBytecodeFile(llvm::MemoryBufferRef buffer,
+                                     Block *block, MLIRContext *context) {
+  BytecodeReader reader(buffer, context);
+  if (failed(reader.readTopLevel(block)))
+    return failure();
+  for (Operation &op : *block)
+    if (failed(verify(&op)))
+      return failure();
+  return success();
+}
@@ -99,6 +99,10 @@ Token Lexer::lexToken() {
     case ')':
       return formToken(Token::r_paren, tokStart);
     case '{':
+      if (*curPtr == '-' && *(curPtr + 1) == '#') {
+        curPtr += 2;
+        return formToken(Token::file_metadata_begin, tokStart);
+      }
       return formToken(Token::l_brace, tokStart);
     case '}':
       return formToken(Token::r_brace, tokStart);
@@ -140,12 +144,16 @@ Token Lexer::lexToken() {
     case '@':
       return lexAtIdentifier(tokStart);
 
+    case '#':
+      if (*curPtr == '-' && *(curPtr + 1) == '}') {
+        curPtr += 2;
+        return formToken(Token::file_metadata_end, tokStart);
+      }
+      LLVM_FALLTHROUGH;
     case '!':
       LLVM_FALLTHROUGH;
     case '^':
       LLVM_FALLTHROUGH;
-    case '#':
-      LLVM_FALLTHROUGH;
     case '%':
       return lexPrefixedIdentifier(tokStart);
     case '"':
@@ -12,6 +12,7 @@
 
 #include "Parser.h"
 #include "AsmParserImpl.h"
+#include "mlir/Bytecode/BytecodeReader.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Dialect.h"
@@ -20,8 +21,12 @@
 #include "mlir/Parser/Parser.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/bit.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SourceMgr.h"
 #include <algorithm>
@@ -217,6 +222,17 @@ ParseResult Parser::parseToken(Token::Kind expectedToken,
   return emitWrongTokenError(message);
 }
 
+/// Parse a keyword, if present, into 'keyword'.
+ParseResult Parser::parseOptionalKeyword(StringRef *keyword) {
+  // Check that the current token is a keyword.
+  if (!isCurrentTokenAKeyword())
+    return failure();
+
+  *keyword = getTokenSpelling();
+  consumeToken();
+  return success();
+}
+
 /// Parse an optional integer value from the stream.
 OptionalParseResult Parser::parseOptionalInteger(APInt &result) {
   Token curToken = getToken();
@@ -2047,6 +2063,38 @@ ParseResult OperationParser::parseOptionalBlockArgList(Block *owner) {
   });
 }
 
+//===----------------------------------------------------------------------===//
+// Resource Parsing
+//===----------------------------------------------------------------------===//
+
+/// Parse a handle to a resource blob.
+///
+///   resource-handle ::= bare-id | string-literal
+///
+FailureOr<DialectResourceBlobHandle> Parser::parseResourceHandle(
+    const ResourceBlobManagerDialectInterface &blobManager) {
+  std::string name;
+  if (getToken().is(Token::string)) {
+    name = getToken().getStringValue();
+    consumeToken(Token::string);
+  } else if (isCurrentTokenAKeyword()) {
+    name = getTokenSpelling().str();
+    consumeToken();
+  } else {
+    return emitError("expected identifier key for resource handle");
+  }
+
+  // The first reference to a name creates a new entry in the blob manager.
+  // The manager may rename it to keep it unique among the resources that are
+  // already registered, so the mapping is kept for the rest of the file.
+  StringRef dialectName = blobManager.getDialect()->getNamespace();
+  auto &handles = state.symbols.dialectResources[dialectName];
+  auto it = handles.try_emplace(name);
+  if (it.second)
+    it.first->second = blobManager.insert(name);
+  return it.first->second;
+}
+
 //===----------------------------------------------------------------------===//
 // Top-level entity parsing.
 //===----------------------------------------------------------------------===//
@@ -2067,6 +2115,15 @@ private:
 
   /// Parse an attribute alias declaration.
   ParseResult parseTypeAliasDef();
+
+  /// Parse a top-level file metadata dictionary.
+  ParseResult parseFileMetadataDictionary();
+
+  /// Parse the dialect resources of a file metadata dictionary.
+  ParseResult parseDialectResourceFileMetadata();
+
+  /// Parse the value of a dialect resource entry.
+  FailureOr<AsmResourceBlob> parseResourceBlob(StringRef key);
 };
 } // namespace
 
@@ -2136,6 +2193,159 @@ ParseResult TopLevelOperationParser::parseTypeAliasDef() {
   return success();
 }
 
+/// Parse a top-level file metadata dictionary.
+///
+///   file-metadata-dict ::= '{-#' file-metadata-entry* `#-}'
+///   file-metadata-entry ::= `dialect_resources` `:` dialect-resources-dict
+///
+ParseResult TopLevelOperationParser::parseFileMetadataDictionary() {
+  consumeToken(Token::file_metadata_begin);
+  return parseCommaSeparatedListUntil(
+      Token::file_metadata_end, [&]() -> ParseResult {
+        // Parse the key of the metadata dictionary.
+        SMLoc keyLoc = getToken().getLoc();
+        StringRef key;
+        if (failed(parseOptionalKeyword(&key)))
+          return emitError("expected identifier key in file "
+                           "metadata dictionary");
+        if (parseToken(Token::colon, "expected ':'"))
+          return failure();
+
+        // Process the metadata entry.
+        if (key == "dialect_resources")
+          return parseDialectResourceFileMetadata();
+        return emitError(keyLoc, "unknown key '" + key +
+                                     "' in file metadata dictionary");
+      });
+}
+
+/// Parse the dialect resources of a file metadata dictionary.
+///
+///   dialect-resources-dict ::= `{` (dialect-resources (`,` ...)*)? `}`
+///   dialect-resources ::= dialect-namespace `:`
+///                         `{` (resource-handle `:` resource-value
+///                              (`,` ...)*)? `}`
+///
+ParseResult TopLevelOperationParser::parseDialectResourceFileMetadata() {
+  return parseCommaSeparatedList(Delimiter::Braces, [&]() -> ParseResult {
+    // Parse the dialect namespace.
+    SMLoc nameLoc = getToken().getLoc();
+    StringRef name;
+    if (failed(parseOptionalKeyword(&name)))
+      return emitError("expected identifier key for 'resource' entry");
+    if (parseToken(Token::colon, "expected ':'"))
+      return failure();
+
+    // Check that the dialect can hold resources.
+    Dialect *dialect = getContext()->getOrLoadDialect(name);
+    if (!dialect)
+      return emitError(nameLoc, "dialect '" + name + "' is unknown");
+    const auto *blobManager =
+        dialect->getRegisteredInterface<ResourceBlobManagerDialectInterface>();
+    if (!blobManager)
+      return emitError(nameLoc, "unexpected 'resource' section for dialect '")
+             << name << "'";
+
+    return parseCommaSeparatedList(Delimiter::Braces, [&]() -> ParseResult {
+      SMLoc keyLoc = getToken().getLoc();
+      FailureOr<DialectResourceBlobHandle> handle =
+          parseResourceHandle(*blobManager);
+      if (failed(handle) || parseToken(Token::colon, "expected ':'"))
+        return failure();
+      if (handle->getBlob())
+        return emitError(keyLoc, "redefinition of resource '")
+               << handle->getKey() << "'";
+
+      FailureOr<AsmResourceBlob> blob = parseResourceBlob(handle->getKey());
+      if (failed(blob))
+        return failure();
+      handle->getEntry()->setBlob(std::move(*blob));
+      return success();
+    });
+  });
+}
+
+/// Parse the value of a dialect resource entry.
+///
+///   resource-value ::= hex-string-literal
+///                    | `external` `(` string-literal
+///                      (`,` offset (`,` size (`,` alignment)?)?)? `)`
+///
+/// An inline hex string starts with the alignment of the blob, as a 32-bit
+/// little endian integer. A relative external path is relative to the
+/// directory of the parsed file.
+FailureOr<AsmResourceBlob>
+TopLevelOperationParser::parseResourceBlob(StringRef key) {
+  SMLoc valueLoc = getToken().getLoc();
+  if (getToken().is(Token::string)) {
+    Optional<std::string> data = getToken().getHexStringValue();
+    if (!data || data->size() < sizeof(uint32_t))
+      return emitError("expected hex string blob for key '" + key +
+                       "' to start with its alignment");
+    consumeToken(Token::string);
+
+    uint32_t align = llvm::support::endian::read32le(data->data());
+    if (!llvm::isPowerOf2_32(align))
+      return emitError(valueLoc, "expected hex string blob for key '" + key +
+                                     "' to start with a power of two "
+                                     "alignment, but got ")
+             << align;
+    return HeapAsmResourceBlob::allocateAndCopy(
+        ArrayRef<char>(data->data(), data->size()).drop_front(sizeof(uint32_t)),
+        align);
+  }
+
+  StringRef kind;
+  if (failed(parseOptionalKeyword(&kind)) || kind != "external")
+    return emitError(valueLoc, "expected hex string or 'external' reference "
+                               "for resource '" + key + "'");
+  if (parseToken(Token::l_paren, "expected '(' after 'external'"))
+    return failure();
+  if (getToken().isNot(Token::string))
+    return emitError("expected path of external resource");
+  SmallString<128> path(getToken().getStringValue());
+  consumeToken(Token::string);
+
+  // Parse the optional offset, size, and alignment of the file region.
+  uint64_t values[3] = {/*offset=*/0, /*size=*/0, /*alignment=*/1};
+  unsigned numValues = 0;
+  while (numValues < 3 && consumeIf(Token::comma)) {
+    Optional<uint64_t> value = getToken().getUInt64IntegerValue();
+    if (getToken().isNot(Token::integer) || !value)
+      return emitError("expected integer in external resource reference");
+    consumeToken(Token::integer);
+    values[numValues++] = *value;
+  }
+  if (parseToken(Token::r_paren, "expected ')' in external resource reference"))
+    return failure();
+  if (!llvm::isPowerOf2_64(values[2]))
+    return emitError(valueLoc, "expected power of two alignment for resource '")
+           << key << "', but got " << values[2];
+
+  if (llvm::sys::path::is_relative(path)) {
+    const llvm::MemoryBuffer *buffer =
+        getSourceMgr().getMemoryBuffer(getSourceMgr().getMainFileID());
+    StringRef directory =
+        llvm::sys::path::parent_path(buffer->getBufferIdentifier());
+    if (!directory.empty()) {
+      SmallString<128> resolved(directory);
+      llvm::sys::path::append(resolved, path);
+      path = std::move(resolved);
+    }
+  }
+
+  Optional<uint64_t> size;
+  if (numValues > 1)
+    size = values[1];
+  std::string errorMessage;
+  FailureOr<AsmResourceBlob> blob = MappedAsmResourceBlob::mapFile(
+      path, /*offset=*/values[0], size, /*align=*/values[2], errorMessage);
+  if (failed(blob))
+    return emitError(valueLoc, "failed to load resource '" + key +
+                                   "': " + errorMessage);
+  return blob;
+}
+
 ParseResult TopLevelOperationParser::parse(Block *topLevelBlock,
                                            Location parserLoc) {
   // Create a top-level operation to contain the parsed state.
@@ -2180,6 +2390,12 @@ ParseResult TopLevelOperationParser::parse(Block *topLevelBlock,
       if (parseTypeAliasDef())
         return failure();
       break;
+
+    // Parse a file-level metadata dictionary.
+    case Token::file_metadata_begin:
+      if (parseFileMetadataDictionary())
+        return failure();
+      break;
     }
   }
 }
@@ -2197,6 +2413,10 @@ LogicalResult mlir::parseSourceFile(const llvm::SourceMgr &sourceMgr,
   if (sourceFileLoc)
     *sourceFileLoc = parserLoc;
 
+  // Bytecode files are read directly, there is no assembly state for them.
+  if (isBytecode(sourceBuf->getMemBufferRef()))
+    return readBytecodeFile(sourceBuf->getMemBufferRef(), block, context);
+
   SymbolState aliasState;
   ParserState state(sourceMgr, context, aliasState, asmState);
   return TopLevelOperationParser(state).parse(block, parserLoc);
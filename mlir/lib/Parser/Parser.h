@@ -147,6 +147,15 @@ public:
   /// Parse an optional integer value from the stream.
   OptionalParseResult parseOptionalInteger(APInt &result);
 
+  /// Returns true if the current token corresponds to a keyword.
+  bool isCurrentTokenAKeyword() const {
+    return getToken().isAny(Token::bare_identifier, Token::inttype) ||
+           getToken().isKeyword();
+  }
+
+  /// Parse a keyword, if present, into 'keyword'.
+  ParseResult parseOptionalKeyword(StringRef *keyword);
+
   /// Parse a floating point value from an integer literal token.
   ParseResult parseFloatFromIntegerLiteral(Optional<APFloat> &result,
                                            const Token &tok, bool isNegative,
@@ -266,6 +275,19 @@ public:
   /// Parse a sparse elements attribute.
   Attribute parseSparseElementsAttr(Type attrType);
 
+  /// Parse a dense resource elements attribute.
+  Attribute parseDenseResourceElementsAttr(Type attrType);
+
+  //===--------------------------------------------------------------------===//
+  // Resource Parsing
+  //===--------------------------------------------------------------------===//
+
+  /// Parse a handle to a resource blob of the given blob manager. All of the
+  /// references to a resource name within the parsed file map to the same
+  /// handle.
+  FailureOr<DialectResourceBlobHandle>
+  parseResourceHandle(const ResourceBlobManagerDialectInterface &blobManager);
+
   //===--------------------------------------------------------------------===//
   // Location Parsing
   //===--------------------------------------------------------------------===//
@@ -11,6 +11,7 @@
 
 #include "Lexer.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/DialectResourceBlobManager.h"
 #include "llvm/ADT/StringMap.h"
 
 namespace mlir {
@@ -28,6 +29,10 @@ struct SymbolState {
   // A map from type alias identifier to Type.
   llvm::StringMap<Type> typeAliasDefinitions;
 
+  /// A map from dialect namespace to the handles of the dialect resources that
+  /// were referenced by name in the parsed file.
+  llvm::StringMap<llvm::StringMap<DialectResourceBlobHandle>> dialectResources;
+
   /// A set of locations into the main parser memory buffer for each of the
   /// active nested parsers. Given that some nested parsers, i.e. custom dialect
   /// parsers, operate on a temporary memory buffer, this provides an anchor
@@ -11,6 +11,7 @@
 #include "mlir/Pass/PassRegistry.h"
 #include "mlir/Support/Timing.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 
 using namespace mlir;
@@ -78,6 +79,26 @@ struct PassManagerOptions {
               "display the results in a merged list sorted by pass name"),
           clEnumValN(PassDisplayMode::Pipeline, "pipeline",
                      "display the results with a nested pipeline view"))};
+
+  //===--------------------------------------------------------------------===//
+  // Pass Profiling
+  //===--------------------------------------------------------------------===//
+  llvm::cl::opt<std::string> passProfileFile{
+      "mlir-pass-profile",
+      llvm::cl::desc("Write a profile of each pass execution on an operation "
+                     "to the given output path")};
+  llvm::cl::opt<PassProfileFormat> passProfileFormat{
+      "mlir-pass-profile-format",
+      llvm::cl::desc("Output format of the pass profile"),
+      llvm::cl::init(PassProfileFormat::ChromeTrace),
+      llvm::cl::values(
+          clEnumValN(PassProfileFormat::ChromeTrace, "chrome",
+                     "write a Chrome trace event file"),
+          clEnumValN(PassProfileFormat::FlameGraph, "flamegraph",
+                     "write folded stacks for flame graph tools"))};
+
+  /// Add a profiling instrumentation if enabled by the 'pass-profile' flag.
+  void addProfilingInstrumentation(PassManager &pm);
 };
 } // namespace
 
@@ -125,6 +146,22 @@ void PassManagerOptions::addPrinterInstrumentation(PassManager &pm) {
                       llvm::errs());
 }
 
+/// Add a profiling instrumentation if enabled by the 'pass-profile' flag.
+void PassManagerOptions::addProfilingInstrumentation(PassManager &pm) {
+  if (passProfileFile.empty())
+    return;
+
+  std::error_code error;
+  auto os = std::make_unique<llvm::raw_fd_ostream>(passProfileFile, error,
+                                                   llvm::sys::fs::OF_Text);
+  if (error) {
+    llvm::errs() << "could not open pass profile file '" << passProfileFile
+                 << "': " << error.message() << "\n";
+    return;
+  }
+  pm.enableProfiling(std::move(os), passProfileFormat);
+}
+
 void mlir::registerPassManagerCLOptions() {
   // Make sure that the options struct has been constructed.
   *options;
@@ -145,6 +182,10 @@ void mlir::applyPassManagerCLOptions(PassManager &pm) {
 
   // Add the IR printing instrumentation.
   options->addPrinterInstrumentation(pm);
+
+  // Add the profiling instrumentation last, so that it does not account for
+  // the other instrumentations.
+  options->addProfilingInstrumentation(pm);
 }
 
 void mlir::applyDefaultTimingPassManagerCLOptions(PassManager &pm) {
@@ -0,0 +1,357 @@
+//===- PassProfiling.cpp --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/PassManager.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/Threading.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+using namespace mlir;
+using namespace mlir::detail;
+
+//===----------------------------------------------------------------------===//
+// PassProfiling
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A single execution of a pipeline, pass, or analysis.
+struct ProfileEvent {
+  /// The kind of the execution, used as the category of the event.
+  enum class Kind { Pipeline, Pass, Analysis };
+
+  ProfileEvent(Kind kind, StringRef name, StringRef anchor, int parent,
+               uint64_t threadID)
+      : kind(kind), name(name), anchor(anchor), parent(parent),
+        threadID(threadID) {}
+
+  Kind kind;
+
+  /// The name of the pipeline, pass, or analysis.
+  StringRef name;
+
+  /// A description of the operation the event ran on, e.g. `func.func @foo`.
+  /// This is empty for pipelines.
+  StringRef anchor;
+
+  /// The index of the enclosing event, or -1 if this is a top-level event.
+  int parent;
+
+  /// The thread that the event ran on, as given by llvm::get_threadid().
+  uint64_t threadID;
+
+  /// The start time, relative to the start of the profile, and the duration
+  /// of the event in nanoseconds.
+  int64_t start = 0, duration = 0;
+
+  /// The summed duration of the children of this event that ran on the same
+  /// thread, used to compute the exclusive time of the event.
+  int64_t childDuration = 0;
+
+  /// The number of bytes of context storage allocated by the thread of the
+  /// event while it ran. While the event is active, this holds the counter of
+  /// the thread when the event started.
+  uint64_t storageBytes = 0;
+
+  /// The number of operations nested in the anchor before and after a pass,
+  /// or -1 if they were not counted.
+  int64_t numOpsBefore = -1, numOpsAfter = -1;
+
+  /// Whether the pass failed.
+  bool failed = false;
+};
+
+struct PassProfiling : public PassInstrumentation {
+  PassProfiling(std::unique_ptr<raw_ostream> os, PassProfileFormat format)
+      : os(std::move(os)), format(format), stringSaver(stringAllocator),
+        startTime(std::chrono::steady_clock::now()) {}
+  ~PassProfiling() override { print(); }
+
+  /// The stream the profile is written to.
+  std::unique_ptr<raw_ostream> os;
+
+  /// The format the profile is written in.
+  PassProfileFormat format;
+
+  /// The instrumentation callbacks run concurrently on the threads of the
+  /// OpToOpPassAdaptor, so all of the state below is guarded by this mutex.
+  /// Events refer to each other by index, as `events` may reallocate.
+  llvm::sys::SmartMutex<true> mutex;
+
+  /// The recorded events, in the order they started. Parents always precede
+  /// their children.
+  std::vector<ProfileEvent> events;
+
+  /// Storage for the names and anchors of the recorded events.
+  llvm::BumpPtrAllocator stringAllocator;
+  llvm::UniqueStringSaver stringSaver;
+
+  /// If a pass can spawn additional work on other threads, it records the
+  /// index of its event here. Pipelines that run on a newly-forked thread
+  /// check this map to find the event they are nested under.
+  DenseMap<PipelineParentInfo, int> parentEventIndices;
+
+  /// A stack of the currently active events per thread.
+  DenseMap<uint64_t, SmallVector<int, 8>> activeThreadEvents;
+
+  /// The time at which profiling started.
+  std::chrono::steady_clock::time_point startTime;
+
+  //===--------------------------------------------------------------------===//
+  // Events
+  //===--------------------------------------------------------------------===//
+
+  /// Return the number of nanoseconds since profiling started.
+  int64_t now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - startTime)
+        .count();
+  }
+
+  /// Start a new event on the current thread, nested under `parent` or under
+  /// the active event of the thread if `parent` is -1, and return its index.
+  /// The mutex must be held.
+  int startEvent(ProfileEvent::Kind kind, StringRef name, Operation *anchor,
+                 MLIRContext *context, int parent = -1) {
+    uint64_t tid = llvm::get_threadid();
+    SmallVector<int, 8> &activeEvents = activeThreadEvents[tid];
+    if (parent == -1 && !activeEvents.empty())
+      parent = activeEvents.back();
+
+    int index = events.size();
+    activeEvents.push_back(index);
+    events.emplace_back(kind, stringSaver.save(name),
+                        anchor ? describeAnchor(anchor) : StringRef(), parent,
+                        tid);
+    ProfileEvent &event = events.back();
+    event.storageBytes = context->getStorageBytesAllocatedOnCurrentThread();
+    event.start = now();
+    return index;
+  }
+
+  /// Finish the active event of the current thread and return its index. The
+  /// mutex must be held.
+  int finishEvent(MLIRContext *context, int64_t end) {
+    uint64_t tid = llvm::get_threadid();
+    SmallVector<int, 8> &activeEvents = activeThreadEvents[tid];
+    assert(!activeEvents.empty() && "expected active event");
+    int index = activeEvents.pop_back_val();
+    ProfileEvent &event = events[index];
+
+    event.duration = end - event.start;
+    event.storageBytes =
+        context->getStorageBytesAllocatedOnCurrentThread() - event.storageBytes;
+    if (event.parent != -1 && events[event.parent].threadID == tid)
+      events[event.parent].childDuration += event.duration;
+    return index;
+  }
+
+  /// Return a uniqued description of the given anchor operation.
+  StringRef describeAnchor(Operation *op) {
+    SmallString<64> description(op->getName().getStringRef());
+    if (auto symName = op->getAttrOfType<StringAttr>(
+            SymbolTable::getSymbolAttrName())) {
+      description += " @";
+      description += symName.getValue();
+    }
+    return stringSaver.save(description.str());
+  }
+
+  /// Return the number of operations nested within `op`.
+  static int64_t countNestedOps(Operation *op) {
+    int64_t numOps = 0;
+    op->walk([&](Operation *) { ++numOps; });
+    return numOps - 1;
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Pipeline
+  //===--------------------------------------------------------------------===//
+
+  void runBeforePipeline(StringAttr name,
+                         const PipelineParentInfo &parentInfo) override {
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    int parent = -1;
+    if (activeThreadEvents[llvm::get_threadid()].empty()) {
+      auto it = parentEventIndices.find(parentInfo);
+      if (it != parentEventIndices.end())
+        parent = it->second;
+    }
+    startEvent(ProfileEvent::Kind::Pipeline,
+               ("'" + name.strref() + "' Pipeline").str(), /*anchor=*/nullptr,
+               name.getContext(), parent);
+  }
+
+  void runAfterPipeline(StringAttr name, const PipelineParentInfo &) override {
+    int64_t end = now();
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    finishEvent(name.getContext(), end);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Pass
+  //===--------------------------------------------------------------------===//
+
+  void runBeforePass(Pass *pass, Operation *op) override {
+    if (auto *adaptor = dyn_cast<OpToOpPassAdaptor>(pass)) {
+      llvm::sys::SmartScopedLock<true> lock(mutex);
+      parentEventIndices[{llvm::get_threadid(), pass}] =
+          startEvent(ProfileEvent::Kind::Pass, adaptor->getAdaptorName(), op,
+                     op->getContext());
+      return;
+    }
+    // Count the operations before starting the event, to keep the walk out of
+    // the profile of the pass.
+    int64_t numOps = countNestedOps(op);
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    int index = startEvent(ProfileEvent::Kind::Pass, pass->getName(), op,
+                           op->getContext());
+    events[index].numOpsBefore = numOps;
+  }
+
+  void runAfterPass(Pass *pass, Operation *op) override {
+    int64_t end = now();
+    if (isa<OpToOpPassAdaptor>(pass)) {
+      llvm::sys::SmartScopedLock<true> lock(mutex);
+      finishEvent(op->getContext(), end);
+      parentEventIndices.erase({llvm::get_threadid(), pass});
+      return;
+    }
+    int64_t numOps = countNestedOps(op);
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    events[finishEvent(op->getContext(), end)].numOpsAfter = numOps;
+  }
+
+  void runAfterPassFailed(Pass *pass, Operation *op) override {
+    int64_t end = now();
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    events[finishEvent(op->getContext(), end)].failed = true;
+    if (isa<OpToOpPassAdaptor>(pass))
+      parentEventIndices.erase({llvm::get_threadid(), pass});
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Analysis
+  //===--------------------------------------------------------------------===//
+
+  void runBeforeAnalysis(StringRef name, TypeID, Operation *op) override {
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    startEvent(ProfileEvent::Kind::Analysis, "(A) " + name.str(), op,
+               op->getContext());
+  }
+
+  void runAfterAnalysis(StringRef, TypeID, Operation *op) override {
+    int64_t end = now();
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    finishEvent(op->getContext(), end);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Output
+  //===--------------------------------------------------------------------===//
+
+  /// Write the profile to the output stream.
+  void print() {
+    if (format == PassProfileFormat::ChromeTrace)
+      printChromeTrace();
+    else
+      printFlameGraph();
+    os->flush();
+  }
+
+  /// Write the profile in the Chrome trace event format.
+  void printChromeTrace() {
+    // Number the threads in the order they were first seen, as the values
+    // returned by llvm::get_threadid() are not meaningful to the reader.
+    DenseMap<uint64_t, unsigned> threadNumbers;
+
+    llvm::json::OStream json(*os, /*IndentSize=*/0);
+    json.object([&] {
+      json.attribute("displayTimeUnit", "ms");
+      json.attributeArray("traceEvents", [&] {
+        for (const ProfileEvent &event : events) {
+          unsigned tid =
+              threadNumbers.try_emplace(event.threadID, threadNumbers.size())
+                  .first->second;
+          json.object([&] {
+            json.attribute("name", event.name);
+            json.attribute("cat", event.kind == ProfileEvent::Kind::Pipeline
+                                      ? "pipeline"
+                                  : event.kind == ProfileEvent::Kind::Pass
+                                      ? "pass"
+                                      : "analysis");
+            json.attribute("ph", "X");
+            json.attribute("pid", 0);
+            json.attribute("tid", tid);
+            json.attribute("ts", event.start / 1000.0);
+            json.attribute("dur", event.duration / 1000.0);
+            json.attributeObject("args", [&] {
+              if (!event.anchor.empty())
+                json.attribute("op", event.anchor);
+              json.attribute("storage_bytes", event.storageBytes);
+              if (event.numOpsBefore != -1)
+                json.attribute("ops_before", event.numOpsBefore);
+              if (event.numOpsAfter != -1)
+                json.attribute("ops_after", event.numOpsAfter);
+              if (event.failed)
+                json.attribute("failed", true);
+            });
+          });
+        }
+      });
+    });
+    *os << "\n";
+  }
+
+  /// Write the profile as folded stacks, aggregating the exclusive time of
+  /// identical stacks.
+  void printFlameGraph() {
+    // Events are recorded after their parent, so the stacks of the parents
+    // are always computed first.
+    std::vector<std::string> stacks(events.size());
+    std::map<std::string, int64_t> stackTimes;
+    for (size_t i = 0, e = events.size(); i != e; ++i) {
+      const ProfileEvent &event = events[i];
+      std::string &stack = stacks[i];
+      if (event.parent != -1)
+        stack = stacks[event.parent] + ";";
+
+      // Semicolons separate frames in the folded format.
+      size_t frameStart = stack.size();
+      stack += event.name.str();
+      if (!event.anchor.empty())
+        stack += (" (" + event.anchor + ")").str();
+      std::replace(stack.begin() + frameStart, stack.end(), ';', ',');
+
+      stackTimes[stack] += std::max<int64_t>(
+          event.duration - event.childDuration, 0);
+    }
+    for (auto &it : stackTimes)
+      *os << it.first << " " << it.second << "\n";
+  }
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// PassManager
+//===----------------------------------------------------------------------===//
+
+/// Add an instrumentation to profile the execution of passes and the
+/// computation of analyses on each operation.
+void PassManager::enableProfiling(std::unique_ptr<raw_ostream> os,
+                                  PassProfileFormat format) {
+  addInstrumentation(std::make_unique<PassProfiling>(std::move(os), format));
+}
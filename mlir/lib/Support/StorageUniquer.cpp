@@ -11,7 +11,8 @@
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/ThreadLocalCache.h"
 #include "mlir/Support/TypeID.h"
-#include "llvm/Support/RWMutex.h"
+#include "llvm/Support/Mutex.h"
+#include <atomic>
 
 using namespace mlir;
 using namespace mlir::detail;
@@ -22,240 +23,181 @@ namespace {
 /// storage instances in a thread safe way. This allows for the main uniquer to
 /// bucket each of the individual sub-types removing the need to lock the main
 /// uniquer itself.
+///
+/// The instances are kept in an insert-only hash trie that is traversed and
+/// grown with atomic operations, without any lock. Each node has `kNodeSize`
+/// slots, indexed by successive bits of the hash value, which are either empty,
+/// an entry, or a child node. An entry is replaced by a child node when another
+/// hash value needs its slot. Once the bits of the hash value are exhausted,
+/// entries are chained instead.
+///
+/// A new instance is constructed before it is published to the trie, and is
+/// destroyed if another thread published an equal instance first.
 class ParametricStorageUniquer {
 public:
   using BaseStorage = StorageUniquer::BaseStorage;
   using StorageAllocator = StorageUniquer::StorageAllocator;
 
-  /// A lookup key for derived instances of storage objects.
-  struct LookupKey {
-    /// The known hash value of the key.
-    unsigned hashValue;
-
-    /// An equality function for comparing with an existing storage instance.
-    function_ref<bool(const BaseStorage *)> isEqual;
-  };
+  /// The number of hash bits used at each level of the trie.
+  static constexpr unsigned kNodeBits = 6;
+  static constexpr unsigned kNodeSize = 1u << kNodeBits;
 
 private:
-  /// A utility wrapper object representing a hashed storage object. This class
-  /// contains a storage object and an existing computed hash value.
-  struct HashedStorage {
-    HashedStorage(unsigned hashValue = 0, BaseStorage *storage = nullptr)
-        : hashValue(hashValue), storage(storage) {}
+  /// An instance in the trie, with its hash value.
+  struct Entry {
     unsigned hashValue;
     BaseStorage *storage;
+    /// The next entry with the same slot at the last level of the trie.
+    std::atomic<Entry *> next;
   };
 
-  /// Storage info for derived TypeStorage objects.
-  struct StorageKeyInfo {
-    static inline HashedStorage getEmptyKey() {
-      return HashedStorage(0, DenseMapInfo<BaseStorage *>::getEmptyKey());
-    }
-    static inline HashedStorage getTombstoneKey() {
-      return HashedStorage(0, DenseMapInfo<BaseStorage *>::getTombstoneKey());
-    }
-
-    static inline unsigned getHashValue(const HashedStorage &key) {
-      return key.hashValue;
-    }
-    static inline unsigned getHashValue(const LookupKey &key) {
-      return key.hashValue;
-    }
-
-    static inline bool isEqual(const HashedStorage &lhs,
-                               const HashedStorage &rhs) {
-      return lhs.storage == rhs.storage;
+  /// A slot of the trie is either null, an `Entry *`, or a `Node *` tagged
+  /// with the low bit.
+  using Slot = std::atomic<uintptr_t>;
+  struct Node {
+    Node() {
+      for (Slot &slot : slots)
+        slot.store(0, std::memory_order_relaxed);
     }
-    static inline bool isEqual(const LookupKey &lhs, const HashedStorage &rhs) {
-      if (isEqual(rhs, getEmptyKey()) || isEqual(rhs, getTombstoneKey()))
-        return false;
-      // Invoke the equality function on the lookup key.
-      return lhs.isEqual(rhs.storage);
-    }
-  };
-  using StorageTypeSet = DenseSet<HashedStorage, StorageKeyInfo>;
-
-  /// This class represents a single shard of the uniquer. The uniquer uses a
-  /// set of shards to allow for multiple threads to create instances with less
-  /// lock contention.
-  struct Shard {
-    /// The set containing the allocated storage instances.
-    StorageTypeSet instances;
-
-    /// Allocator to use when constructing derived instances.
-    StorageAllocator allocator;
-
-#if LLVM_ENABLE_THREADS != 0
-    /// A mutex to keep uniquing thread-safe.
-    llvm::sys::SmartRWMutex<true> mutex;
-#endif
+    Slot slots[kNodeSize];
   };
 
-  /// Get or create an instance of a param derived type in an thread-unsafe
-  /// fashion.
-  BaseStorage *
-  getOrCreateUnsafe(Shard &shard, LookupKey &key,
-                    function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
-    auto existing = shard.instances.insert_as({key.hashValue}, key);
-    BaseStorage *&storage = existing.first->storage;
-    if (existing.second)
-      storage = ctorFn(shard.allocator);
-    return storage;
+  static bool isNode(uintptr_t value) { return value & 1; }
+  static Node *getNode(uintptr_t value) {
+    return reinterpret_cast<Node *>(value & ~uintptr_t(1));
   }
-
-  /// Destroy all of the storage instances within the given shard.
-  void destroyShardInstances(Shard &shard) {
-    if (!destructorFn)
-      return;
-    for (HashedStorage &instance : shard.instances)
-      destructorFn(instance.storage);
+  static uintptr_t getSlotValue(Node *node) {
+    return reinterpret_cast<uintptr_t>(node) | 1;
   }
-
-public:
-#if LLVM_ENABLE_THREADS != 0
-  /// Initialize the storage uniquer with a given number of storage shards to
-  /// use. The provided shard number is required to be a valid power of 2. The
-  /// destructor function is used to destroy any allocated storage instances.
-  ParametricStorageUniquer(function_ref<void(BaseStorage *)> destructorFn,
-                           size_t numShards = 8)
-      : shards(new std::atomic<Shard *>[numShards]), numShards(numShards),
-        destructorFn(destructorFn) {
-    assert(llvm::isPowerOf2_64(numShards) &&
-           "the number of shards is required to be a power of 2");
-    for (size_t i = 0; i < numShards; i++)
-      shards[i].store(nullptr, std::memory_order_relaxed);
+  static uintptr_t getSlotValue(Entry *entry) {
+    return reinterpret_cast<uintptr_t>(entry);
   }
-  ~ParametricStorageUniquer() {
-    // Free all of the allocated shards.
-    for (size_t i = 0; i != numShards; ++i) {
-      if (Shard *shard = shards[i].load()) {
-        destroyShardInstances(*shard);
-        delete shard;
-      }
-    }
-  }
-  /// Get or create an instance of a parametric type.
-  BaseStorage *
-  getOrCreate(bool threadingIsEnabled, unsigned hashValue,
-              function_ref<bool(const BaseStorage *)> isEqual,
-              function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
-    Shard &shard = getShard(hashValue);
-    ParametricStorageUniquer::LookupKey lookupKey{hashValue, isEqual};
-    if (!threadingIsEnabled)
-      return getOrCreateUnsafe(shard, lookupKey, ctorFn);
-
-    // Check for a instance of this object in the local cache.
-    auto localIt = localCache->insert_as({hashValue}, lookupKey);
-    BaseStorage *&localInst = localIt.first->storage;
-    if (localInst)
-      return localInst;
-
-    // Check for an existing instance in read-only mode.
-    {
-      llvm::sys::SmartScopedReader<true> typeLock(shard.mutex);
-      auto it = shard.instances.find_as(lookupKey);
-      if (it != shard.instances.end())
-        return localInst = it->storage;
-    }
-
-    // Acquire a writer-lock so that we can safely create the new storage
-    // instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(shard.mutex);
-    return localInst = getOrCreateUnsafe(shard, lookupKey, ctorFn);
-  }
-  /// Run a mutation function on the provided storage object in a thread-safe
-  /// way.
-  LogicalResult
-  mutate(bool threadingIsEnabled, BaseStorage *storage,
-         function_ref<LogicalResult(StorageAllocator &)> mutationFn) {
-    Shard &shard = getShardFor(storage);
-    if (!threadingIsEnabled)
-      return mutationFn(shard.allocator);
-
-    llvm::sys::SmartScopedWriter<true> lock(shard.mutex);
-    return mutationFn(shard.allocator);
+  static unsigned getSlotIndex(unsigned hashValue, unsigned shift) {
+    return (hashValue >> shift) & (kNodeSize - 1);
   }
 
-private:
-  /// Return the shard used for the given hash value.
-  Shard &getShard(unsigned hashValue) {
-    // Get a shard number from the provided hashvalue.
-    unsigned shardNum = hashValue & (numShards - 1);
-
-    // Try to acquire an already initialized shard.
-    Shard *shard = shards[shardNum].load(std::memory_order_acquire);
-    if (shard)
-      return *shard;
-
-    // Otherwise, try to allocate a new shard.
-    Shard *newShard = new Shard();
-    if (shards[shardNum].compare_exchange_strong(shard, newShard))
-      return *newShard;
-
-    // If one was allocated before we can initialize ours, delete ours.
-    delete newShard;
-    return *shard;
+  /// Returns the entry of `chain` that is equal to the lookup key, if any.
+  static BaseStorage *
+  findInChain(Entry *chain, unsigned hashValue,
+              function_ref<bool(const BaseStorage *)> isEqual) {
+    for (; chain; chain = chain->next.load(std::memory_order_acquire))
+      if (chain->hashValue == hashValue && isEqual(chain->storage))
+        return chain->storage;
+    return nullptr;
   }
 
-  /// Return the shard that allocated the provided storage object.
-  Shard &getShardFor(BaseStorage *storage) {
-    for (size_t i = 0; i != numShards; ++i) {
-      if (Shard *shard = shards[i].load(std::memory_order_acquire)) {
-        llvm::sys::SmartScopedReader<true> lock(shard->mutex);
-        if (shard->allocator.allocated(storage))
-          return *shard;
+  /// Destroy the instances within the given node, and its child nodes.
+  void destroyNode(Node *node) {
+    for (Slot &slot : node->slots) {
+      uintptr_t value = slot.load(std::memory_order_relaxed);
+      if (isNode(value)) {
+        destroyNode(getNode(value));
+        delete getNode(value);
+        continue;
       }
+      if (!destructorFn)
+        continue;
+      for (Entry *entry = reinterpret_cast<Entry *>(value); entry;
+           entry = entry->next.load(std::memory_order_relaxed))
+        destructorFn(entry->storage);
     }
-    llvm_unreachable("expected storage object to have a valid shard");
   }
 
-  /// A thread local cache for storage objects. This helps to reduce the lock
-  /// contention when an object already existing in the cache.
-  ThreadLocalCache<StorageTypeSet> localCache;
-
-  /// A set of uniquer shards to allow for further bucketing accesses for
-  /// instances of this storage type. Each shard is lazily initialized to reduce
-  /// the overhead when only a small amount of shards are in use.
-  std::unique_ptr<std::atomic<Shard *>[]> shards;
-
-  /// The number of available shards.
-  size_t numShards;
-
-  /// Function to used to destruct any allocated storage instances.
-  function_ref<void(BaseStorage *)> destructorFn;
-
-#else
-  /// If multi-threading is disabled, ignore the shard parameter as we will
-  /// always use one shard. The destructor function is used to destroy any
-  /// allocated storage instances.
-  ParametricStorageUniquer(function_ref<void(BaseStorage *)> destructorFn,
-                           size_t numShards = 0)
+public:
+  /// The destructor function is used to destroy any allocated storage
+  /// instances.
+  ParametricStorageUniquer(function_ref<void(BaseStorage *)> destructorFn)
       : destructorFn(destructorFn) {}
-  ~ParametricStorageUniquer() { destroyShardInstances(shard); }
+  ~ParametricStorageUniquer() { destroyNode(&root); }
 
-  /// Get or create an instance of a parametric type.
+  /// Get or create an instance of a parametric type. New instances are
+  /// allocated with the allocator returned by `getAllocator`.
   BaseStorage *
-  getOrCreate(bool threadingIsEnabled, unsigned hashValue,
+  getOrCreate(unsigned hashValue,
               function_ref<bool(const BaseStorage *)> isEqual,
-              function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
-    ParametricStorageUniquer::LookupKey lookupKey{hashValue, isEqual};
-    return getOrCreateUnsafe(shard, lookupKey, ctorFn);
+              function_ref<BaseStorage *(StorageAllocator &)> ctorFn,
+              function_ref<StorageAllocator &()> getAllocator) {
+    Entry *newEntry = nullptr;
+    auto createEntry = [&] {
+      if (newEntry)
+        return;
+      StorageAllocator &allocator = getAllocator();
+      newEntry = allocator.allocate<Entry>();
+      newEntry->hashValue = hashValue;
+      newEntry->storage = ctorFn(allocator);
+      newEntry->next.store(nullptr, std::memory_order_relaxed);
+    };
+    // Return the given existing instance, discarding the new one if it lost
+    // the race to publish an equal instance.
+    auto useExisting = [&](BaseStorage *existing) {
+      if (newEntry && destructorFn)
+        destructorFn(newEntry->storage);
+      return existing;
+    };
+
+    Node *node = &root;
+    unsigned shift = 0;
+    while (true) {
+      Slot &slot = node->slots[getSlotIndex(hashValue, shift)];
+      uintptr_t value = slot.load(std::memory_order_acquire);
+
+      // Descend into child nodes.
+      if (isNode(value)) {
+        node = getNode(value);
+        shift += kNodeBits;
+        continue;
+      }
+
+      // Check for an existing instance.
+      Entry *entry = reinterpret_cast<Entry *>(value);
+      if (BaseStorage *existing = findInChain(entry, hashValue, isEqual))
+        return useExisting(existing);
+
+      // Publish a new instance in an empty slot, or at the head of the chain
+      // once all of the bits of the hash value have been used. If another
+      // thread changed the slot in the meantime, look at it again.
+      bool isLastLevel = shift + kNodeBits >= 32;
+      if (!entry || isLastLevel) {
+        createEntry();
+        newEntry->next.store(entry, std::memory_order_relaxed);
+        if (slot.compare_exchange_strong(value, getSlotValue(newEntry),
+                                         std::memory_order_acq_rel))
+          return newEntry->storage;
+        continue;
+      }
+
+      // Otherwise, push the existing entry down into a new child node, and
+      // look at the slot again.
+      auto *child = new Node();
+      child->slots[getSlotIndex(entry->hashValue, shift + kNodeBits)].store(
+          value, std::memory_order_relaxed);
+      if (!slot.compare_exchange_strong(value, getSlotValue(child),
+                                        std::memory_order_acq_rel))
+        delete child;
+    }
   }
+
   /// Run a mutation function on the provided storage object in a thread-safe
   /// way.
   LogicalResult
-  mutate(bool threadingIsEnabled, BaseStorage *storage,
+  mutate(bool threadingIsEnabled, StorageAllocator &allocator,
          function_ref<LogicalResult(StorageAllocator &)> mutationFn) {
-    return mutationFn(shard.allocator);
+    if (!threadingIsEnabled)
+      return mutationFn(allocator);
+
+    llvm::sys::SmartScopedLock<true> lock(mutationMutex);
+    return mutationFn(allocator);
   }
 
 private:
-  /// The main uniquer shard that is used for allocating storage instances.
-  Shard shard;
+  /// The root node of the trie.
+  Node root;
+
+  /// A mutex used to keep mutations of the instances thread-safe.
+  llvm::sys::SmartMutex<true> mutationMutex;
 
   /// Function to used to destruct any allocated storage instances.
   function_ref<void(BaseStorage *)> destructorFn;
-#endif
 };
 } // namespace
 
@@ -281,8 +223,10 @@ struct StorageUniquerImpl {
     assert(parametricUniquers.count(id) &&
            "creating unregistered storage instance");
     ParametricStorageUniquer &storageUniquer = *parametricUniquers[id];
-    return storageUniquer.getOrCreate(threadingIsEnabled, hashValue, isEqual,
-                                      ctorFn);
+    return storageUniquer.getOrCreate(hashValue, isEqual, ctorFn,
+                                      [&]() -> StorageAllocator & {
+                                        return getAllocator();
+                                      });
   }
 
   /// Run a mutation function on the provided storage object in a thread-safe
@@ -293,7 +237,38 @@ struct StorageUniquerImpl {
     assert(parametricUniquers.count(id) &&
            "mutating unregistered storage instance");
     ParametricStorageUniquer &storageUniquer = *parametricUniquers[id];
-    return storageUniquer.mutate(threadingIsEnabled, storage, mutationFn);
+    return storageUniquer.mutate(threadingIsEnabled, getAllocator(),
+                                 mutationFn);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Allocators
+  //===--------------------------------------------------------------------===//
+
+  /// Return the allocator to use for new instances on the current thread.
+  StorageAllocator &getAllocator() {
+    if (!threadingIsEnabled)
+      return mainAllocator;
+
+    // Each thread allocates from its own allocator, so that creating
+    // instances does not need any synchronization. The allocators are owned
+    // by the uniquer, as the instances outlive the threads.
+    StorageAllocator *&allocator = threadAllocators.get();
+    if (!allocator) {
+      llvm::sys::SmartScopedLock<true> lock(allocatorMutex);
+      allocators.push_back(std::make_unique<StorageAllocator>());
+      allocator = allocators.back().get();
+    }
+    return *allocator;
+  }
+
+  /// Return the number of bytes allocated by the current thread, without
+  /// creating an allocator for it.
+  size_t getBytesAllocatedOnCurrentThread() {
+    if (!threadingIsEnabled)
+      return mainAllocator.getBytesAllocated();
+    StorageAllocator *allocator = threadAllocators.get();
+    return allocator ? allocator->getBytesAllocated() : 0;
   }
 
   //===--------------------------------------------------------------------===//
@@ -314,6 +289,15 @@ struct StorageUniquerImpl {
   // Instance Storage
   //===--------------------------------------------------------------------===//
 
+  /// The allocators of parametric instances. These are declared first, as the
+  /// uniquers read their entries when destroyed.
+  StorageAllocator mainAllocator;
+  std::vector<std::unique_ptr<StorageAllocator>> allocators;
+  llvm::sys::SmartMutex<true> allocatorMutex;
+
+  /// The allocator used by each thread, from `allocators`.
+  ThreadLocalCache<StorageAllocator *> threadAllocators;
+
   /// Map of type ids to the storage uniquer to use for registered objects.
   DenseMap<TypeID, std::unique_ptr<ParametricStorageUniquer>>
       parametricUniquers;
@@ -339,6 +323,12 @@ void StorageUniquer::disableMultithreading(bool disable) {
   impl->threadingIsEnabled = !disable;
 }
 
+/// Returns the number of bytes allocated for parametric storage instances
+/// created on the current thread.
+size_t StorageUniquer::getBytesAllocatedOnCurrentThread() {
+  return impl->getBytesAllocatedOnCurrentThread();
+}
+
 /// Implementation for getting/creating an instance of a derived type with
 /// parametric storage.
 auto StorageUniquer::getParametricStorageTypeImpl(
@@ -35,6 +35,7 @@ struct Canonicalizer : public CanonicalizerBase<Canonicalizer> {
     config.useTopDownTraversal = topDownProcessingEnabled;
     config.enableRegionSimplification = enableRegionSimplification;
     config.maxIterations = maxIterations;
+    config.enableParallelPartitions = parallelPartitions;
   }
 
   /// Initialize the canonicalizer by building the set of patterns used during
@@ -23,14 +23,16 @@ using namespace mlir;
 /// inserted into.
 static Region *
 getInsertionRegion(DialectInterfaceCollection<DialectFoldInterface> &interfaces,
+                   const DenseSet<Region *> &insertionBoundaries,
                    Block *insertionBlock) {
   while (Region *region = insertionBlock->getParent()) {
     // Insert in this region for any of the following scenarios:
     //  * The parent is unregistered, or is known to be isolated from above.
     //  * The parent is a top-level operation.
+    //  * The region is an insertion boundary of the folder.
     auto *parentOp = region->getParentOp();
     if (parentOp->mightHaveTrait<OpTrait::IsIsolatedFromAbove>() ||
-        !parentOp->getBlock())
+        !parentOp->getBlock() || insertionBoundaries.count(region))
       return region;
 
     // Otherwise, check if this region is a desired insertion region.
@@ -137,7 +139,8 @@ bool OperationFolder::insertKnownConstant(Operation *op, Attribute constValue) {
   }
 
   // Check for an existing constant operation for the attribute value.
-  Region *insertRegion = getInsertionRegion(interfaces, opBlock);
+  Region *insertRegion =
+      getInsertionRegion(interfaces, insertionBoundaries, opBlock);
   auto &uniquedConstants = foldScopes[insertRegion];
   Operation *&folderConstOp = uniquedConstants[std::make_tuple(
       op->getDialect(), constValue, *op->result_type_begin())];
@@ -179,7 +182,8 @@ void OperationFolder::notifyRemoval(Operation *op) {
 
   // Get the constant map that this operation was uniqued in.
   auto &uniquedConstants =
-      foldScopes[getInsertionRegion(interfaces, op->getBlock())];
+      foldScopes[getInsertionRegion(interfaces, insertionBoundaries,
+                                    op->getBlock())];
 
   // Erase all of the references to this operation.
   auto type = op->getResult(0).getType();
@@ -204,7 +208,8 @@ Value OperationFolder::getOrCreateConstant(OpBuilder &builder, Dialect *dialect,
   // Use the builder insertion block to find an insertion point for the
   // constant.
   auto *insertRegion =
-      getInsertionRegion(interfaces, builder.getInsertionBlock());
+      getInsertionRegion(interfaces, insertionBoundaries,
+                         builder.getInsertionBlock());
   auto &entry = insertRegion->front();
   builder.setInsertionPoint(&entry, entry.begin());
 
@@ -270,7 +275,8 @@ LogicalResult OperationFolder::processFoldResults(
   // Create a builder to insert new operations into the entry block of the
   // insertion region.
   auto *insertRegion =
-      getInsertionRegion(interfaces, builder.getInsertionBlock());
+      getInsertionRegion(interfaces, insertionBoundaries,
+                         builder.getInsertionBlock());
   auto &entry = insertRegion->front();
   OpBuilder::InsertionGuard foldGuard(builder);
   builder.setInsertionPoint(&entry, entry.begin());
@@ -12,6 +12,7 @@
 
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/IR/Matchers.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Rewrite/PatternApplicator.h"
 #include "mlir/Transforms/FoldUtils.h"
@@ -40,7 +41,22 @@ public:
                                       const GreedyRewriteConfig &config);
 
   /// Simplify the operations within the given regions.
-  bool simplify(MutableArrayRef<Region> regions);
+  bool simplify(ArrayRef<Region *> regions);
+
+  /// Restrict the driver to the operations nested in the given regions. The
+  /// driver ignores the other operations, and stops if a rewrite modifies one
+  /// of them.
+  void setPartition(ArrayRef<Region *> regions);
+
+  /// Returns true if a rewrite modified an operation outside of the partition.
+  bool hasConflict() const { return conflict; }
+
+  /// Do not revisit the operations of the given regions, other than constants,
+  /// when first populating the worklist. This is used for partitions that were
+  /// already simplified to a fixed point.
+  void skipConvergedPartitions(const DenseSet<Region *> &regions) {
+    convergedPartitions = regions;
+  }
 
   /// Add the given operation to the worklist.
   void addToWorklist(Operation *op);
@@ -56,6 +72,9 @@ protected:
   // inserted ops are added to the worklist for processing.
   void notifyOperationInserted(Operation *op) override;
 
+  // Check that operations updated in place are within the partition.
+  void startRootUpdate(Operation *op) override;
+
   // Look over the provided operands for any defining operations that should
   // be re-added to the worklist. This function should be called when an
   // operation is modified or removed, as it may trigger further
@@ -94,9 +113,26 @@ protected:
   OperationFolder folder;
 
 private:
+  /// Returns true if the given operation is nested in the partition, or if
+  /// the driver is not restricted to a partition.
+  bool isInPartition(Operation *op) const;
+
+  /// Record a conflict if the given operation, which is being modified, is
+  /// outside of the partition.
+  void checkInPartition(Operation *op);
+
   /// Configuration information for how to simplify.
   GreedyRewriteConfig config;
 
+  /// The regions that this driver is restricted to, if any.
+  DenseSet<Region *> partition;
+
+  /// Set when an operation outside of the partition is modified.
+  bool conflict = false;
+
+  /// The regions skipped when first populating the worklist.
+  DenseSet<Region *> convergedPartitions;
+
 #ifndef NDEBUG
   /// A logger used to emit information during the application process.
   llvm::ScopedPrinter logger{llvm::dbgs()};
@@ -114,7 +150,75 @@ GreedyPatternRewriteDriver::GreedyPatternRewriteDriver(
   matcher.applyDefaultCostModel();
 }
 
-bool GreedyPatternRewriteDriver::simplify(MutableArrayRef<Region> regions) {
+void GreedyPatternRewriteDriver::setPartition(ArrayRef<Region *> regions) {
+  for (Region *region : regions) {
+    partition.insert(region);
+    // Constants must stay within the partition, other drivers may be working
+    // on the blocks above it.
+    folder.addInsertionBoundary(region);
+  }
+}
+
+bool GreedyPatternRewriteDriver::isInPartition(Operation *op) const {
+  if (partition.empty())
+    return true;
+  for (Region *region = op->getParentRegion(); region;
+       region = region->getParentRegion())
+    if (partition.count(region))
+      return true;
+  return false;
+}
+
+void GreedyPatternRewriteDriver::checkInPartition(Operation *op) {
+  if (conflict || isInPartition(op))
+    return;
+  LLVM_DEBUG(llvm::dbgs() << "** Conflict: '" << op->getName()
+                          << "' is modified outside of the partition\n");
+  conflict = true;
+}
+
+/// Invoke `callback` on the operations nested in `regions`, in post-order or
+/// pre-order. Only the constants of the regions in `skippedRegions`, which
+/// must be directly nested in the operations of `regions`, are visited.
+static void walkForWorklist(ArrayRef<Region *> regions,
+                            const DenseSet<Region *> &skippedRegions,
+                            bool preOrder,
+                            function_ref<void(Operation *)> callback) {
+  for (Region *region : regions) {
+    // Fast path for the common case.
+    if (skippedRegions.empty()) {
+      if (preOrder)
+        region->walk<WalkOrder::PreOrder>(callback);
+      else
+        region->walk(callback);
+      continue;
+    }
+
+    for (Block &block : *region) {
+      // Callbacks may erase the operation they are given.
+      for (Operation &op : llvm::make_early_inc_range(block)) {
+        if (preOrder)
+          callback(&op);
+        for (Region &nested : op.getRegions()) {
+          if (skippedRegions.count(&nested)) {
+            nested.walk([&](Operation *nestedOp) {
+              if (matchPattern(nestedOp, m_Constant()))
+                callback(nestedOp);
+            });
+          } else if (preOrder) {
+            nested.walk<WalkOrder::PreOrder>(callback);
+          } else {
+            nested.walk(callback);
+          }
+        }
+        if (!preOrder)
+          callback(&op);
+      }
+    }
+  }
+}
+
+bool GreedyPatternRewriteDriver::simplify(ArrayRef<Region *> regions) {
 #ifndef NDEBUG
   const char *logLineComment =
       "//===-------------------------------------------===//\n";
@@ -139,25 +243,30 @@ bool GreedyPatternRewriteDriver::simplify(MutableArrayRef<Region> regions) {
     worklist.clear();
     worklistMap.clear();
 
+    // Partitions that converged on their own only need to be revisited once
+    // something else changed.
+    DenseSet<Region *> noSkippedRegions;
+    const DenseSet<Region *> &skippedRegions =
+        iteration == 0 ? convergedPartitions : noSkippedRegions;
+
     if (!config.useTopDownTraversal) {
       // Add operations to the worklist in postorder.
-      for (auto &region : regions) {
-        region.walk([this](Operation *op) {
-          // If we aren't processing top-down, check for existing constants when
-          // populating the worklist. This avoids accidentally reversing the
-          // constant order during processing.
-          Attribute constValue;
-          if (matchPattern(op, m_Constant(&constValue)))
-            if (!folder.insertKnownConstant(op, constValue))
-              return;
-          addToWorklist(op);
-        });
-      }
+      walkForWorklist(regions, skippedRegions, /*preOrder=*/false,
+                      [this](Operation *op) {
+                        // If we aren't processing top-down, check for existing
+                        // constants when populating the worklist. This avoids
+                        // accidentally reversing the constant order during
+                        // processing.
+                        Attribute constValue;
+                        if (matchPattern(op, m_Constant(&constValue)))
+                          if (!folder.insertKnownConstant(op, constValue))
+                            return;
+                        addToWorklist(op);
+                      });
     } else {
       // Add all nested operations to the worklist in preorder.
-      for (auto &region : regions)
-        region.walk<WalkOrder::PreOrder>(
-            [this](Operation *op) { worklist.push_back(op); });
+      walkForWorklist(regions, skippedRegions, /*preOrder=*/true,
+                      [this](Operation *op) { worklist.push_back(op); });
 
       // Reverse the list so our pop-back loop processes them in-order.
       std::reverse(worklist.begin(), worklist.end());
@@ -170,7 +279,7 @@ bool GreedyPatternRewriteDriver::simplify(MutableArrayRef<Region> regions) {
     SmallVector<Value, 8> originalOperands, resultValues;
 
     changed = false;
-    while (!worklist.empty()) {
+    while (!worklist.empty() && !conflict) {
       auto *op = popFromWorklist();
 
       // Nulls get added to the worklist when operations are removed, ignore
@@ -269,10 +378,15 @@ bool GreedyPatternRewriteDriver::simplify(MutableArrayRef<Region> regions) {
       changed |= succeeded(matchResult);
     }
 
+    // A partition is abandoned as soon as it conflicts with another.
+    if (conflict)
+      return false;
+
     // After applying patterns, make sure that the CFG of each of the regions
     // is kept up to date.
     if (config.enableRegionSimplification)
-      changed |= succeeded(simplifyRegions(*this, regions));
+      for (Region *region : regions)
+        changed |= succeeded(simplifyRegions(*this, *region));
   } while (changed &&
            (iteration++ < config.maxIterations ||
             config.maxIterations == GreedyRewriteConfig::kNoIterationLimit));
@@ -282,8 +396,9 @@ bool GreedyPatternRewriteDriver::simplify(MutableArrayRef<Region> regions) {
 }
 
 void GreedyPatternRewriteDriver::addToWorklist(Operation *op) {
-  // Check to see if the worklist already contains this op.
-  if (worklistMap.count(op))
+  // Check to see if the worklist already contains this op, or if it is left
+  // to another driver.
+  if (worklistMap.count(op) || !isInPartition(op))
     return;
 
   worklistMap[op] = worklist.size();
@@ -314,9 +429,14 @@ void GreedyPatternRewriteDriver::notifyOperationInserted(Operation *op) {
     logger.startLine() << "** Insert  : '" << op->getName() << "'(" << op
                        << ")\n";
   });
+  checkInPartition(op);
   addToWorklist(op);
 }
 
+void GreedyPatternRewriteDriver::startRootUpdate(Operation *op) {
+  checkInPartition(op);
+}
+
 template <typename Operands>
 void GreedyPatternRewriteDriver::addToWorklist(Operands &&operands) {
   for (Value operand : operands) {
@@ -333,6 +453,7 @@ void GreedyPatternRewriteDriver::addToWorklist(Operands &&operands) {
 }
 
 void GreedyPatternRewriteDriver::notifyOperationRemoved(Operation *op) {
+  checkInPartition(op);
   addToWorklist(op->getOperands());
   op->walk([this](Operation *operation) {
     removeFromWorklist(operation);
@@ -345,6 +466,7 @@ void GreedyPatternRewriteDriver::notifyRootReplaced(Operation *op) {
     logger.startLine() << "** Replace : '" << op->getName() << "'(" << op
                        << ")\n";
   });
+  checkInPartition(op);
   for (auto result : op->getResults())
     for (auto *user : result.getUsers())
       addToWorklist(user);
@@ -368,6 +490,75 @@ LogicalResult GreedyPatternRewriteDriver::notifyMatchFailure(
   return failure();
 }
 
+/// Partition the regions of the operations directly nested in `regions` into
+/// groups that can be simplified independently. Only operations that are
+/// isolated from above are partitioned, and the regions of each one form a
+/// group. No value is shared between two groups, so a rewrite in one group
+/// never touches a use list or an operation that another group can see, as
+/// long as the patterns stay within the operations they match like they must
+/// for passes running on isolated operations in parallel. Groups with fewer
+/// than `minOps` operations are dropped.
+static std::vector<SmallVector<Region *>>
+computeParallelPartitions(MutableArrayRef<Region> regions, int64_t minOps) {
+  std::vector<SmallVector<Region *>> result;
+  for (Region &region : regions) {
+    for (Block &block : region) {
+      for (Operation &op : block) {
+        if (op.getNumRegions() == 0 ||
+            !op.hasTrait<OpTrait::IsIsolatedFromAbove>())
+          continue;
+        SmallVector<Region *> group;
+        int64_t numOps = 0;
+        for (Region &nested : op.getRegions()) {
+          if (nested.empty())
+            continue;
+          group.push_back(&nested);
+          nested.walk([&](Operation *) { ++numOps; });
+        }
+        if (!group.empty() && numOps >= minOps)
+          result.push_back(std::move(group));
+      }
+    }
+  }
+  if (result.size() < 2)
+    return {};
+  return result;
+}
+
+/// Simplify independent partitions of `regions` in parallel, see
+/// `computeParallelPartitions`. Returns the regions of the partitions that
+/// reached a fixed point.
+static DenseSet<Region *>
+simplifyPartitionsInParallel(MutableArrayRef<Region> regions,
+                             const FrozenRewritePatternSet &patterns,
+                             const GreedyRewriteConfig &config) {
+  std::vector<SmallVector<Region *>> groups =
+      computeParallelPartitions(regions, config.minOpsPerPartition);
+  if (groups.empty())
+    return {};
+
+  // The order of the operations in a block is computed lazily when queried,
+  // do it upfront for the blocks that the partitions may query concurrently.
+  for (Region &region : regions)
+    for (Block &block : region)
+      if (!block.isOpOrderValid())
+        block.recomputeOpOrder();
+
+  MLIRContext *context = regions[0].getContext();
+  std::vector<char> groupConverged(groups.size());
+  parallelForEachN(context, 0, groups.size(), [&](size_t i) {
+    GreedyPatternRewriteDriver driver(context, patterns, config);
+    driver.setPartition(groups[i]);
+    groupConverged[i] = driver.simplify(groups[i]) && !driver.hasConflict();
+  });
+
+  DenseSet<Region *> convergedPartitions;
+  for (unsigned i = 0, e = groups.size(); i != e; ++i)
+    if (groupConverged[i])
+      convergedPartitions.insert(groups[i].begin(), groups[i].end());
+  return convergedPartitions;
+}
+
 /// Rewrite the regions of the specified operation, which must be isolated from
 /// above, by repeatedly applying the highest benefit patterns in a greedy
 /// work-list driven manner. Return success if no more patterns can be matched
@@ -391,9 +582,19 @@ mlir::applyPatternsAndFoldGreedily(MutableArrayRef<Region> regions,
   assert(llvm::all_of(regions, regionIsIsolated) &&
          "patterns can only be applied to operations IsolatedFromAbove");
 
+  MLIRContext *context = regions[0].getContext();
+  DenseSet<Region *> convergedPartitions;
+  if (config.enableParallelPartitions && context->isMultithreadingEnabled())
+    convergedPartitions =
+        simplifyPartitionsInParallel(regions, patterns, config);
+
   // Start the pattern driver.
-  GreedyPatternRewriteDriver driver(regions[0].getContext(), patterns, config);
-  bool converged = driver.simplify(regions);
+  GreedyPatternRewriteDriver driver(context, patterns, config);
+  driver.skipConvergedPartitions(convergedPartitions);
+  SmallVector<Region *> regionPtrs;
+  for (Region &region : regions)
+    regionPtrs.push_back(&region);
+  bool converged = driver.simplify(regionPtrs);
   LLVM_DEBUG(if (!converged) {
     llvm::dbgs() << "The pattern rewrite doesn't converge after scanning "
                  << config.maxIterations << " times\n";
@@ -0,0 +1,245 @@
+//===- BytecodeTest.cpp - MLIR bytecode round-trip unit tests -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/BytecodeReader.h"
+#include "mlir/Bytecode/BytecodeWriter.h"
+#include "mlir/Bytecode/Encoding.h"
+#include "mlir/Dialect/ControlFlow/IR/ControlFlowOps.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Parser/Parser.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+static const char *const kIR = R"MLIR(
+module {
+  func.func @dense() -> tensor<4xi32> {
+    %0 = "test.constant"() {value = dense<[1, 2, 3, 4]> : tensor<4xi32>} : () -> tensor<4xi32> loc(fused["a.mlir":1:2, "b"("c.mlir":3:4)])
+    %1 = "test.constant"() {value = dense<7> : tensor<16xi32>, name = "splat"} : () -> tensor<16xi32>
+    return %0 : tensor<4xi32>
+  }
+  func.func @forward(%arg0: i1) -> i64 {
+    cf.br ^bb2
+  ^bb1(%a: i64):
+    %s = "test.use"(%v, %a) : (i64, i64) -> i64
+    return %s : i64
+  ^bb2:
+    %v = "test.def"() ({
+      "test.inner"(%arg0) : (i1) -> ()
+    }) : () -> i64
+    cf.br ^bb1(%v : i64)
+  }
+}
+)MLIR";
+
+namespace {
+class BytecodeTest : public ::testing::Test {
+protected:
+  BytecodeTest() {
+    context.allowUnregisteredDialects();
+    context.loadDialect<cf::ControlFlowDialect, func::FuncDialect>();
+  }
+
+  /// Parse the given IR and return its bytecode.
+  std::string writeBytecode(StringRef ir) {
+    OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(ir, &context);
+    EXPECT_TRUE(module);
+    text = print(module->getOperation());
+
+    std::string bytecode;
+    llvm::raw_string_ostream os(bytecode);
+    writeBytecodeToFile(module->getOperation(), os);
+    return os.str();
+  }
+
+  static std::string print(Operation *op) {
+    std::string result;
+    llvm::raw_string_ostream os(result);
+    op->print(os, OpPrintingFlags().enableDebugInfo());
+    return os.str();
+  }
+
+  /// Return a bytecode file made of the given sections, in section order.
+  static std::string makeBytecode(ArrayRef<std::string> sections) {
+    std::string bytecode;
+    llvm::raw_string_ostream os(bytecode);
+    os.write(reinterpret_cast<const char *>(bytecode::kMagic),
+             sizeof(bytecode::kMagic));
+    llvm::encodeULEB128(bytecode::kVersion, os);
+    for (const auto &it : llvm::enumerate(sections)) {
+      os << char(it.index());
+      llvm::encodeULEB128(it.value().size(), os);
+      llvm::encodeULEB128(/*alignment=*/1, os);
+      os << it.value();
+    }
+    return os.str();
+  }
+
+  /// Read the given bytecode, which is expected to fail, and return the
+  /// diagnostic that was emitted.
+  std::string readInvalidBytecode(StringRef bytecode) {
+    std::string diagnostic;
+    ScopedDiagnosticHandler handler(&context, [&](Diagnostic &diag) {
+      diagnostic = diag.str();
+      return success();
+    });
+    Block block;
+    EXPECT_TRUE(failed(readBytecodeFile(
+        llvm::MemoryBufferRef(bytecode, "invalid"), &block, &context)));
+    EXPECT_TRUE(block.empty());
+    return diagnostic;
+  }
+
+  MLIRContext context;
+  /// The textual form of the last module written as bytecode.
+  std::string text;
+};
+} // namespace
+
+TEST_F(BytecodeTest, RoundTrip) {
+  std::string bytecode = writeBytecode(kIR);
+  llvm::MemoryBufferRef buffer(bytecode, "roundtrip");
+  ASSERT_TRUE(isBytecode(buffer));
+
+  OwningOpRef<ModuleOp> module =
+      parseSourceString<ModuleOp>(bytecode, &context);
+  ASSERT_TRUE(module);
+  EXPECT_EQ(print(module->getOperation()), text);
+}
+
+TEST_F(BytecodeTest, LazyMaterialization) {
+  std::string bytecode = writeBytecode(kIR);
+  llvm::MemoryBufferRef buffer(bytecode, "lazy");
+
+  Block block;
+  BytecodeReader reader(buffer, &context);
+  ASSERT_TRUE(succeeded(reader.readTopLevel(
+      &block, [](Operation *op) { return isa<func::FuncOp>(op); })));
+  ASSERT_EQ(block.getOperations().size(), 1u);
+  auto module = cast<ModuleOp>(block.front());
+  OwningOpRef<ModuleOp> owner(module);
+  module->remove();
+
+  // The functions are read, but their bodies are not.
+  SmallVector<func::FuncOp> funcs(module.getOps<func::FuncOp>());
+  ASSERT_EQ(funcs.size(), 2u);
+  EXPECT_EQ(reader.getNumOpsToMaterialize(), 2);
+  for (func::FuncOp func : funcs) {
+    EXPECT_TRUE(reader.isMaterializable(func));
+    EXPECT_TRUE(func.getBody().empty());
+  }
+
+  ASSERT_TRUE(succeeded(reader.materialize(funcs[1])));
+  EXPECT_FALSE(reader.isMaterializable(funcs[1]));
+  EXPECT_FALSE(funcs[1].getBody().empty());
+  EXPECT_EQ(reader.getNumOpsToMaterialize(), 1);
+
+  ASSERT_TRUE(succeeded(reader.materializeAll()));
+  EXPECT_EQ(reader.getNumOpsToMaterialize(), 0);
+  EXPECT_EQ(print(module), text);
+}
+
+TEST_F(BytecodeTest, RejectsNewerVersion) {
+  std::string bytecode = writeBytecode(kIR);
+  // The version directly follows the magic number.
+  bytecode[4] = 0x7f;
+
+  std::string diagnostic;
+  ScopedDiagnosticHandler handler(&context, [&](Diagnostic &diag) {
+    diagnostic = diag.str();
+    return success();
+  });
+  Block block;
+  EXPECT_TRUE(failed(readBytecodeFile(llvm::MemoryBufferRef(bytecode, "new"),
+                                      &block, &context)));
+  EXPECT_NE(diagnostic.find("is newer than the current version"),
+            std::string::npos);
+}
+
+TEST_F(BytecodeTest, RejectsTruncatedFile) {
+  std::string bytecode = writeBytecode(kIR);
+  bytecode.resize(bytecode.size() / 2);
+
+  ScopedDiagnosticHandler handler(&context,
+                                  [](Diagnostic &) { return success(); });
+  Block block;
+  EXPECT_TRUE(failed(readBytecodeFile(
+      llvm::MemoryBufferRef(bytecode, "truncated"), &block, &context)));
+  EXPECT_TRUE(block.empty());
+}
+
+TEST_F(BytecodeTest, RejectsCountLargerThanData) {
+  // A string table claiming 2^40 strings must be rejected before anything is
+  // allocated for it.
+  std::string strings;
+  llvm::raw_string_ostream os(strings);
+  llvm::encodeULEB128(uint64_t(1) << 40, os);
+  std::string bytecode = makeBytecode({os.str(), "", "", "", ""});
+  EXPECT_NE(readInvalidBytecode(bytecode).find("invalid number of strings"),
+            std::string::npos);
+}
+
+TEST_F(BytecodeTest, RejectsSelfReferentialAttribute) {
+  std::string bytecode = makeBytecode({
+      // One string: "a".
+      std::string("\x01\x01a", 3),
+      // One dialect, "a", and one operation name, "a.a".
+      std::string("\x01\x00\x01\x00\x00", 5),
+      // No resources, with an alignment of 1.
+      std::string("\x00\x01", 2),
+      // One attribute, a NameLoc whose child location is itself.
+      std::string("\x01\x00\x06\x02\x00\x00", 6),
+      // One "a.a" operation located at the attribute.
+      std::string("\x01\x00\x00", 3),
+  });
+  EXPECT_NE(readInvalidBytecode(bytecode).find("refers to itself"),
+            std::string::npos);
+}
+
+TEST_F(BytecodeTest, DenseResourceRoundTrip) {
+  static const char *const kResourceIR = R"MLIR(
+module {
+  "test.constant"() {value = dense_resource<blob> : tensor<2xi32>} : () -> ()
+  "test.constant"() {value = dense_resource<blob> : tensor<1x2xi32>} : () -> ()
+}
+{-#
+  dialect_resources: {
+    builtin: {
+      blob: "0x040000000100000002000000"
+    }
+  }
+#-}
+)MLIR";
+  std::string bytecode = writeBytecode(kResourceIR);
+  EXPECT_NE(text.find("dense_resource<blob> : tensor<2xi32>"),
+            std::string::npos);
+  EXPECT_NE(text.find("blob: \"0x040000000100000002000000\""),
+            std::string::npos);
+
+  // Read the bytecode into a fresh context, so that the resource keeps its
+  // name.
+  MLIRContext other;
+  other.allowUnregisteredDialects();
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(bytecode, &other);
+  ASSERT_TRUE(module);
+  EXPECT_EQ(print(module->getOperation()), text);
+
+  // Both attributes refer to a single blob.
+  SmallVector<DenseResourceElementsAttr> attrs;
+  module->walk([&](Operation *op) {
+    if (auto attr = op->getAttrOfType<DenseResourceElementsAttr>("value"))
+      attrs.push_back(attr);
+  });
+  ASSERT_EQ(attrs.size(), 2u);
+  EXPECT_EQ(attrs[0].getRawHandle(), attrs[1].getRawHandle());
+  EXPECT_EQ(attrs[0].getBlob()->getDataAlignment(), 4u);
+  EXPECT_EQ(attrs[0].getRawData().size(), 2 * sizeof(int32_t));
+}
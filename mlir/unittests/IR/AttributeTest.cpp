@@ -8,6 +8,9 @@
 
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace mlir;
@@ -250,4 +253,52 @@ TEST(SparseElementsAttrTest, GetZero) {
   EXPECT_TRUE(zeroStringValue.getType() == stringTy);
 }
 
+TEST(DenseResourceElementsAttrTest, UniquedByHandle) {
+  MLIRContext context;
+  RankedTensorType type =
+      RankedTensorType::get({2}, IntegerType::get(&context, 32));
+  static const int32_t data[] = {1, 2};
+  ArrayRef<char> rawData(reinterpret_cast<const char *>(data), sizeof(data));
+
+  // The blob data is referenced in place, never copied into the context.
+  auto attr = DenseResourceElementsAttr::get(
+      type, "blob", UnmanagedAsmResourceBlob::allocate(rawData, alignof(int)));
+  EXPECT_EQ(attr.getRawData().data(), rawData.data());
+  EXPECT_EQ(attr.getRawHandle().getKey(), "blob");
+
+  // Attributes with the same contents but different handles are distinct, and
+  // colliding names are made unique.
+  auto other = DenseResourceElementsAttr::get(
+      type, "blob", UnmanagedAsmResourceBlob::allocate(rawData, alignof(int)));
+  EXPECT_NE(attr, other);
+  EXPECT_NE(other.getRawHandle().getKey(), "blob");
+  EXPECT_EQ(DenseResourceElementsAttr::get(type, attr.getRawHandle()), attr);
+}
+
+TEST(DenseResourceElementsAttrTest, MappedExternalBlob) {
+  llvm::SmallString<128> path;
+  int fd;
+  ASSERT_FALSE(
+      llvm::sys::fs::createTemporaryFile("resource", "bin", fd, path));
+  llvm::FileRemover remover(path);
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os << "headerpayload";
+  }
+
+  std::string errorMessage;
+  FailureOr<AsmResourceBlob> blob = MappedAsmResourceBlob::mapFile(
+      path, /*offset=*/6, /*size=*/llvm::None, /*align=*/1, errorMessage);
+  ASSERT_TRUE(succeeded(blob)) << errorMessage;
+  EXPECT_EQ(StringRef(blob->getData().data(), blob->getData().size()),
+            "payload");
+  ASSERT_TRUE(blob->getExternalSource());
+  EXPECT_EQ(blob->getExternalSource()->path, path.str().str());
+  EXPECT_EQ(blob->getExternalSource()->offset, 6u);
+
+  // Regions past the end of the file are rejected.
+  EXPECT_TRUE(failed(MappedAsmResourceBlob::mapFile(
+      path, /*offset=*/6, /*size=*/100, /*align=*/1, errorMessage)));
+}
+
 } // namespace
@@ -11,6 +11,8 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/Pass/Pass.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/JSON.h"
 #include "gtest/gtest.h"
 
 #include <memory>
@@ -84,6 +86,127 @@ TEST(PassManagerTest, OpSpecificAnalysis) {
   }
 }
 
+/// Create a module with two functions and run the annotation pass on it
+/// with profiling enabled. Returns the written profile.
+static std::string profileAnnotation(MLIRContext &context,
+                                     PassProfileFormat format) {
+  Builder builder(&context);
+  OwningOpRef<ModuleOp> module(ModuleOp::create(UnknownLoc::get(&context)));
+  for (StringRef name : {"secret", "not_secret"}) {
+    auto func =
+        func::FuncOp::create(builder.getUnknownLoc(), name,
+                             builder.getFunctionType(llvm::None, llvm::None));
+    func.setPrivate();
+    module->push_back(func);
+  }
+
+  std::string profile;
+  {
+    PassManager pm(&context);
+    pm.addNestedPass<func::FuncOp>(std::make_unique<AnnotateFunctionPass>());
+    pm.enableProfiling(std::make_unique<llvm::raw_string_ostream>(profile),
+                       format);
+    EXPECT_TRUE(succeeded(pm.run(module.get())));
+  }
+  return profile;
+}
+
+TEST(PassManagerTest, ProfilingChromeTrace) {
+  MLIRContext context;
+  context.loadDialect<func::FuncDialect>();
+  std::string profile =
+      profileAnnotation(context, PassProfileFormat::ChromeTrace);
+
+  llvm::Expected<llvm::json::Value> trace = llvm::json::parse(profile);
+  ASSERT_TRUE(bool(trace)) << llvm::toString(trace.takeError());
+  const llvm::json::Array *events =
+      trace->getAsObject()->getArray("traceEvents");
+  ASSERT_TRUE(events);
+
+  // Each function gets its own event for the pass, with the operation it ran
+  // on and the number of nested operations.
+  SmallVector<std::string> anchors;
+  for (const llvm::json::Value &value : *events) {
+    const llvm::json::Object *event = value.getAsObject();
+    if (!event->getString("name")->contains("AnnotateFunctionPass"))
+      continue;
+    EXPECT_EQ(event->getString("ph"), llvm::Optional<StringRef>("X"));
+    const llvm::json::Object *args = event->getObject("args");
+    anchors.push_back(args->getString("op")->str());
+    EXPECT_EQ(args->getInteger("ops_before"), llvm::Optional<int64_t>(0));
+    EXPECT_EQ(args->getInteger("ops_after"), llvm::Optional<int64_t>(0));
+    EXPECT_TRUE(args->getInteger("storage_bytes").hasValue());
+  }
+  llvm::sort(anchors);
+  EXPECT_EQ(anchors, (SmallVector<std::string>{"func.func @not_secret",
+                                               "func.func @secret"}));
+}
+
+TEST(PassManagerTest, ProfilingFlameGraph) {
+  MLIRContext context;
+  context.loadDialect<func::FuncDialect>();
+  std::string profile =
+      profileAnnotation(context, PassProfileFormat::FlameGraph);
+
+  // The analyses computed by the pass are nested under it.
+  SmallVector<StringRef> lines;
+  StringRef(profile).split(lines, '\n', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  bool sawPass = false, sawAnalysis = false;
+  for (StringRef line : lines) {
+    StringRef stack = line.rsplit(' ').first;
+    StringRef frame = stack.rsplit(';').second;
+    if (frame.contains("AnnotateFunctionPass (func.func @secret)"))
+      sawPass = true;
+    if (frame.contains("(A)") && frame.contains("GenericAnalysis") &&
+        stack.contains("AnnotateFunctionPass (func.func @secret);"))
+      sawAnalysis = true;
+  }
+  EXPECT_TRUE(sawPass) << profile;
+  EXPECT_TRUE(sawAnalysis) << profile;
+}
+
+TEST(PassManagerTest, ProfilingMultithreaded) {
+  MLIRContext context;
+  context.loadDialect<func::FuncDialect>();
+  Builder builder(&context);
+  OwningOpRef<ModuleOp> module(ModuleOp::create(UnknownLoc::get(&context)));
+  const unsigned numFuncs = 64;
+  for (unsigned i = 0; i != numFuncs; ++i) {
+    auto func =
+        func::FuncOp::create(builder.getUnknownLoc(), "f" + std::to_string(i),
+                             builder.getFunctionType(llvm::None, llvm::None));
+    func.setPrivate();
+    module->push_back(func);
+  }
+
+  std::string profile;
+  {
+    PassManager pm(&context);
+    pm.addNestedPass<func::FuncOp>(std::make_unique<AnnotateFunctionPass>());
+    pm.enableProfiling(std::make_unique<llvm::raw_string_ostream>(profile),
+                       PassProfileFormat::ChromeTrace);
+    EXPECT_TRUE(succeeded(pm.run(module.get())));
+  }
+
+  // The functions are processed on several threads, and each of them still
+  // gets exactly one event for the pass.
+  llvm::Expected<llvm::json::Value> trace = llvm::json::parse(profile);
+  ASSERT_TRUE(bool(trace)) << llvm::toString(trace.takeError());
+  const llvm::json::Array *events =
+      trace->getAsObject()->getArray("traceEvents");
+  ASSERT_TRUE(events);
+  llvm::StringSet<> anchors;
+  for (const llvm::json::Value &value : *events) {
+    const llvm::json::Object *event = value.getAsObject();
+    if (!event->getString("name")->contains("AnnotateFunctionPass"))
+      continue;
+    EXPECT_TRUE(
+        anchors.insert(event->getObject("args")->getString("op")->str())
+            .second);
+  }
+  EXPECT_EQ(anchors.size(), numFuncs);
+}
+
 namespace {
 struct InvalidPass : Pass {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(InvalidPass)
@@ -8,6 +8,7 @@
 
 #include "mlir/Support/StorageUniquer.h"
 #include "gmock/gmock.h"
+#include <thread>
 
 using namespace mlir;
 
@@ -58,3 +59,54 @@ TEST(StorageUniquerTest, NonTrivialDestructor) {
 
   EXPECT_TRUE(wasDestructed);
 }
+
+TEST(StorageUniquerTest, HashCollisions) {
+  // Storage whose hash values only differ in their upper bits, or not at all.
+  struct CollidingStorage : public SimpleStorage<CollidingStorage, int> {
+    using Base::Base;
+    static unsigned hashKey(const KeyTy &key) {
+      return std::get<0>(key) < 64 ? unsigned(std::get<0>(key)) << 26 : 0;
+    }
+  };
+
+  StorageUniquer uniquer;
+  uniquer.registerParametricStorageType<CollidingStorage>();
+  std::vector<CollidingStorage *> instances;
+  for (int i = 0; i < 128; ++i)
+    instances.push_back(CollidingStorage::get(uniquer, i));
+  for (int i = 0; i < 128; ++i) {
+    EXPECT_EQ(std::get<0>(instances[i]->key), i);
+    EXPECT_EQ(CollidingStorage::get(uniquer, i), instances[i]);
+  }
+}
+
+TEST(StorageUniquerTest, ConcurrentCreation) {
+  struct IntStorage : public SimpleStorage<IntStorage, int> {
+    using Base::Base;
+  };
+
+  StorageUniquer uniquer;
+  uniquer.registerParametricStorageType<IntStorage>();
+
+  // Every thread creates the same instances, in a different order.
+  constexpr int kNumThreads = 8, kNumKeys = 4096;
+  std::vector<std::vector<IntStorage *>> instances(
+      kNumThreads, std::vector<IntStorage *>(kNumKeys));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kNumKeys; ++i) {
+        int key = (i * (2 * t + 1)) % kNumKeys;
+        instances[t][key] = IntStorage::get(uniquer, key);
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+
+  for (int i = 0; i < kNumKeys; ++i) {
+    EXPECT_EQ(std::get<0>(instances[0][i]->key), i);
+    for (int t = 1; t < kNumThreads; ++t)
+      EXPECT_EQ(instances[t][i], instances[0][i]);
+  }
+}
@@ -83,4 +83,50 @@ TEST(CanonicalizerTest, TestDisablePatterns) {
   EXPECT_FALSE(module->lookupSymbol("A"));
 }
 
+TEST(CanonicalizerTest, TestParallelPartitions) {
+  MLIRContext context;
+  context.getOrLoadDialect<TestDialect>();
+  RewritePatternSet patterns(&context);
+  patterns.add<EnabledPattern>(&context);
+  FrozenRewritePatternSet frozenPatterns(std::move(patterns));
+
+  // The nested modules are isolated from above and are simplified in
+  // parallel. The region that uses a value defined above it is only
+  // simplified by the final step.
+  const char *const code = R"mlir(
+    %0 = "test.value"() : () -> i32
+    module {
+      %1 = "test.value"() : () -> i32
+      "test.foo"(%1) : (i32) -> ()
+      "test.foo"() : () -> ()
+    }
+    module {
+      "test.region"() ({
+        "test.foo"() : () -> ()
+      }) : () -> ()
+    }
+    "test.region"() ({
+      "test.use"(%0) : (i32) -> ()
+      "test.foo"(%0) : (i32) -> ()
+    }) : () -> ()
+    "test.foo"() : () -> ()
+  )mlir";
+
+  OwningOpRef<ModuleOp> module = parseSourceString<ModuleOp>(code, &context);
+  ASSERT_TRUE(module);
+  GreedyRewriteConfig config;
+  config.enableParallelPartitions = true;
+  config.minOpsPerPartition = 1;
+  ASSERT_TRUE(succeeded(
+      applyPatternsAndFoldGreedily(*module, frozenPatterns, config)));
+
+  unsigned numFoo = 0, numUse = 0;
+  module->walk([&](Operation *op) {
+    numFoo += op->getName().getStringRef() == "test.foo";
+    numUse += op->getName().getStringRef() == "test.use";
+  });
+  EXPECT_EQ(numFoo, 0u);
+  EXPECT_EQ(numUse, 1u);
+}
+
 } // end anonymous namespace